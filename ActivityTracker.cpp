@@ -0,0 +1,124 @@
+﻿/**
+ * @file ActivityTracker.cpp
+ * @brief 操作状態追跡サービスの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "ActivityTracker.h"
+
+#include <chrono>
+#include <cmath>
+
+/**
+ * @brief CActivityTrackerクラスのコンストラクタ
+ * @details 入力がまだない状態では、構築時刻を最終入力時刻として扱います。
+ */
+CActivityTracker::CActivityTracker(ClockFunc clock)
+    : m_clock(clock != nullptr ? clock : &CActivityTracker::SteadyClockMs), m_nHoldMs(DEFAULT_HOLD_MS),
+      m_nLastInputMs(0), m_nInputCount(0), m_bWakeRequested(false), m_nState(STATE_IDLE),
+      m_nCountAtTick(0), m_nLastTickMs(0), m_nCountAtIdle(0), m_dRate(0.0), m_dPeakRate(0.0)
+{
+    const std::uint64_t nNow = m_clock();
+    m_nLastInputMs.store(nNow, std::memory_order_relaxed);
+    m_nLastTickMs = nNow;
+}
+
+/**
+ * @brief 単調増加する現在時刻 (ミリ秒) を返します。
+ */
+std::uint64_t CActivityTracker::SteadyClockMs()
+{
+    using namespace std::chrono;
+    return static_cast<std::uint64_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief 入力があったことを記録します。
+ * @details 最終入力時刻 → 入力数 → 起床要求の順に更新します。
+ * Tick() は起床要求を下ろした後に入力数を読み直すため、この順序によって
+ * 「起床要求が既に立っていたのでポストしなかった入力」を取りこぼすことはありません。
+ */
+bool CActivityTracker::NotifyInput()
+{
+    m_nLastInputMs.store(m_clock());
+    m_nInputCount.fetch_add(1);
+    return !m_bWakeRequested.exchange(true);
+}
+
+/**
+ * @brief 最終入力からの経過時間 (ミリ秒) を返します。
+ */
+std::uint64_t CActivityTracker::GetIdleTime() const
+{
+    const std::uint64_t nNow = m_clock();
+    const std::uint64_t nLast = m_nLastInputMs.load(std::memory_order_relaxed);
+    return (nNow > nLast) ? nNow - nLast : 0;
+}
+
+/**
+ * @brief 入力レートの統計を更新します。
+ * @details 前回の Tick() からの入力数を経過時間で割った瞬間値を、
+ * 経過時間に応じた重み 1 - e^(-Δt/τ) で指数移動平均に反映します。
+ * Tick() の間隔が不揃いでも、同じ入力列に対してはほぼ同じ値になります。
+ */
+void CActivityTracker::UpdateRate(std::uint64_t nNow, std::uint64_t nCount)
+{
+    if (nNow <= m_nLastTickMs)
+        return;
+    const double dElapsed = static_cast<double>(nNow - m_nLastTickMs);
+    const double dInstant = static_cast<double>(nCount - m_nCountAtTick) * 1000.0 / dElapsed;
+    const double dAlpha = 1.0 - std::exp(-dElapsed / RATE_TIME_CONSTANT_MS);
+    m_dRate += dAlpha * (dInstant - m_dRate);
+    if (m_dRate > m_dPeakRate)
+        m_dPeakRate = m_dRate;
+    m_nLastTickMs = nNow;
+    m_nCountAtTick = nCount;
+}
+
+/**
+ * @brief 状態機械を現在時刻まで進めます。
+ * @details アイドル中に新しい入力があり、それが保持時間内であれば操作中へ遷移します。
+ * 操作中に最終入力から保持時間が経過したらアイドルへ遷移し、起床要求を下ろして次の入力を待ちます。
+ * 起床要求を下ろした直後に入力数を読み直し、その間に入力があった場合は遷移を取り消します。
+ */
+CActivityTracker::Transition CActivityTracker::Tick()
+{
+    const std::uint64_t nNow = m_clock();
+    const std::uint64_t nCount = m_nInputCount.load();
+    const std::uint64_t nLast = m_nLastInputMs.load();
+    const std::uint64_t nElapsed = (nNow > nLast) ? nNow - nLast : 0;
+    UpdateRate(nNow, nCount);
+
+    if (GetState() == STATE_IDLE)
+    {
+        if (nCount == m_nCountAtIdle)
+            return TRANSITION_NONE;
+        if (nElapsed < m_nHoldMs)
+        {
+            m_nState.store(STATE_OPERATING, std::memory_order_relaxed);
+            return TRANSITION_TO_OPERATING;
+        }
+
+        // 起床が遅れ、入力が既に保持時間を過ぎていた場合はアイドルのまま次の入力を待つ
+        m_nCountAtIdle = nCount;
+        m_bWakeRequested.store(false);
+        if (m_nInputCount.load() == nCount)
+            return TRANSITION_NONE;
+        m_bWakeRequested.store(true);
+        m_nState.store(STATE_OPERATING, std::memory_order_relaxed);
+        return TRANSITION_TO_OPERATING;
+    }
+
+    if (nElapsed < m_nHoldMs)
+        return TRANSITION_NONE;
+
+    m_nCountAtIdle = nCount;
+    m_bWakeRequested.store(false);
+    if (m_nInputCount.load() != nCount)
+    {
+        // 起床要求を下ろす直前に入力があった (その入力はポストしていない) ため、操作中のまま続ける
+        m_bWakeRequested.store(true);
+        return TRANSITION_NONE;
+    }
+    m_nState.store(STATE_IDLE, std::memory_order_relaxed);
+    return TRANSITION_TO_IDLE;
+}
@@ -0,0 +1,122 @@
+﻿/**
+ * @file ActivityTracker.h
+ * @brief ユーザー操作の有無 (操作中/アイドル) を追跡するサービスのクラス宣言
+ * @details 入力フィルタは NotifyInput() で最終入力時刻と入力数をアトミックに更新するだけで、
+ * 状態遷移 (アイドル → 操作中 → アイドル) の判定は UI スレッドの Tick() がまとめて行います。
+ * タイトル表示などの UI 更新は Tick() が遷移を返したときだけ行えばよいため、
+ * 連続したタップでもウィンドウタイトルの書き換えやタイマーの再設定が繰り返されることはありません。
+ * 最終入力からの経過時間を問い合わせられるため、画面の減光や自動ログアウトなどにも再利用できます。
+ * 時刻は差し替え可能な時計関数から取得するため、テストでは任意の時刻列で決定的に動作を再現できます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class CActivityTracker
+ * @brief 最終入力時刻・入力レートと操作中/アイドルの状態機械
+ * @details NotifyInput() と各種の問い合わせ関数は任意のスレッドから呼び出せます。
+ * Tick() と入力レートの取得は、状態機械を駆動する1つのスレッド (UIスレッド) からのみ呼び出してください。
+ */
+class CActivityTracker
+{
+public:
+    /// @brief 単調増加する現在時刻 (ミリ秒) を返す時計関数
+    typedef std::uint64_t (*ClockFunc)();
+
+    /// @brief 操作状態
+    enum State
+    {
+        STATE_IDLE,      ///< 最終入力から保持時間以上が経過している
+        STATE_OPERATING  ///< 保持時間内に入力がある
+    };
+
+    /// @brief Tick() で発生した状態遷移
+    enum Transition
+    {
+        TRANSITION_NONE,          ///< 遷移なし
+        TRANSITION_TO_OPERATING,  ///< アイドル → 操作中
+        TRANSITION_TO_IDLE        ///< 操作中 → アイドル
+    };
+
+    /// @brief 最後の入力から操作中とみなし続ける既定の時間 (ミリ秒)
+    static constexpr std::uint64_t DEFAULT_HOLD_MS = 3000;
+    /// @brief 操作中に Tick() を呼び出す推奨周期 (ミリ秒)
+    static constexpr std::uint64_t TICK_INTERVAL_MS = 250;
+    /// @brief 入力レートの指数移動平均の時定数 (ミリ秒)
+    static constexpr double RATE_TIME_CONSTANT_MS = 1000.0;
+
+    /**
+     * @brief コンストラクタ
+     * @param[in] clock 時計関数 (nullptrなら SteadyClockMs)
+     */
+    explicit CActivityTracker(ClockFunc clock = nullptr);
+
+    /// @brief 操作中とみなし続ける時間 (ミリ秒) を設定します。
+    void SetHoldTime(std::uint64_t nHoldMs) { m_nHoldMs = nHoldMs; }
+    /// @brief 操作中とみなし続ける時間 (ミリ秒) を取得します。
+    std::uint64_t GetHoldTime() const { return m_nHoldMs; }
+
+    /**
+     * @brief 入力があったことを記録します。
+     * @details 最終入力時刻と入力数をアトミックに更新します。
+     * アイドル状態で最初の入力のときだけ true を返すので、呼び出し側はそのときだけ
+     * 状態機械を駆動するスレッドを起こせば (メッセージを1回ポストすれば) 十分です。
+     * @return 状態機械の駆動スレッドを起こす必要がある場合はtrue
+     */
+    bool NotifyInput();
+
+    /**
+     * @brief 状態機械を現在時刻まで進めます。
+     * @details 操作中は TICK_INTERVAL_MS 程度の周期で、アイドル中は NotifyInput() が true を返したときに呼び出します。
+     * 入力レートの統計もここで更新します。
+     * @return 発生した状態遷移
+     */
+    Transition Tick();
+
+    /// @brief 現在の状態 (最後の Tick() の時点) を返します。
+    State GetState() const { return static_cast<State>(m_nState.load(std::memory_order_relaxed)); }
+
+    /// @brief 最終入力時刻 (時計関数の値、入力がなければ構築時刻) を返します。
+    std::uint64_t GetLastInputTime() const { return m_nLastInputMs.load(std::memory_order_relaxed); }
+
+    /// @brief 最終入力からの経過時間 (ミリ秒) を返します。
+    std::uint64_t GetIdleTime() const;
+
+    /**
+     * @brief 最終入力から指定時間以上が経過しているかを返します。
+     * @param[in] nMs 判定する時間 (ミリ秒)。画面の減光や自動ログアウトの閾値など。
+     */
+    bool IsIdleFor(std::uint64_t nMs) const { return GetIdleTime() >= nMs; }
+
+    /// @brief これまでの入力数を返します。
+    std::uint64_t GetInputCount() const { return m_nInputCount.load(std::memory_order_relaxed); }
+
+    /// @brief 入力レート (回/秒) の指数移動平均を返します (最後の Tick() の時点)。
+    double GetInputRate() const { return m_dRate; }
+    /// @brief 入力レートの指数移動平均の最大値を返します。
+    double GetPeakInputRate() const { return m_dPeakRate; }
+
+    /// @brief 単調増加する現在時刻 (ミリ秒) を返す既定の時計関数です。
+    static std::uint64_t SteadyClockMs();
+
+private:
+    /// @brief 入力レートの統計を更新します。
+    void UpdateRate(std::uint64_t nNow, std::uint64_t nCount);
+
+    ClockFunc m_clock;                          ///< 時計関数
+    std::uint64_t m_nHoldMs;                    ///< 操作中とみなし続ける時間
+    std::atomic<std::uint64_t> m_nLastInputMs;  ///< 最終入力時刻
+    std::atomic<std::uint64_t> m_nInputCount;   ///< これまでの入力数
+    std::atomic<bool> m_bWakeRequested;         ///< 駆動スレッドを起こす要求を出したか (アイドル中の最初の入力で立つ)
+    std::atomic<int> m_nState;                  ///< 現在の状態 (State)
+
+    // --- 以下は駆動スレッドのみが読み書きする ---
+    std::uint64_t m_nCountAtTick;  ///< 前回の Tick() の時点の入力数
+    std::uint64_t m_nLastTickMs;   ///< 前回の Tick() の時刻
+    std::uint64_t m_nCountAtIdle;  ///< アイドルへ遷移した時点の入力数
+    double m_dRate;                ///< 入力レートの指数移動平均 (回/秒)
+    double m_dPeakRate;            ///< 入力レートの最大値 (回/秒)
+};
@@ -6,6 +6,7 @@
 #include "MFCApplication4.h"
 #include "afxdialogex.h"
 #include "CMyDialog.h"
+#include "InputTrace.h"
 
 // CMyDialogクラスが動的生成可能であることをフレームワークに伝えます。
 IMPLEMENT_DYNAMIC(CMyDialog, CDialogEx)
@@ -15,8 +16,9 @@ IMPLEMENT_DYNAMIC(CMyDialog, CDialogEx)
  * @param pParent 親ウィンドウへのポインタ
  */
 CMyDialog::CMyDialog(CWnd *pParent /*=nullptr*/)
-    : CDialogEx(IDD, pParent), m_pActiveGrid(nullptr), m_nTotalWidth(0), m_nTotalHeight(0), m_nHScrollPos(0), m_nVScrollPos(0)
+    : CDialogEx(IDD, pParent), m_pActiveGrid(nullptr), m_scroll(KINETIC_TIMER_ID, LINE_SCROLL_AMOUNT)
 {
+    m_scroll.Attach(this);
 }
 
 /**
@@ -45,6 +47,11 @@ BEGIN_MESSAGE_MAP(CMyDialog, CDialogEx)
 	ON_WM_VSCROLL()
 	ON_WM_SIZE()
 	ON_WM_MOUSEWHEEL()
+	ON_WM_LBUTTONDOWN()
+	ON_WM_LBUTTONUP()
+	ON_WM_MOUSEMOVE()
+	ON_WM_CAPTURECHANGED()
+	ON_WM_TIMER()
 END_MESSAGE_MAP()
 
 /**
@@ -55,6 +62,8 @@ END_MESSAGE_MAP()
  */
 LRESULT CMyDialog::OnGridCellChanged(WPARAM wParam, LPARAM lParam)
 {
+    CInputTraceScope trace("CMyDialog::OnGridCellChanged");
+
     UINT nCtrlID = (UINT)wParam;
     int row = LOWORD(lParam);
     int col = HIWORD(lParam);
@@ -86,126 +95,59 @@ BOOL CMyDialog::OnInitDialog()
     ModifyStyle(0, WS_VSCROLL | WS_HSCROLL);
     m_pActiveGrid = nullptr;
 
-    const int margin = 10;
-    int currentY = margin;
-    int rightmostX = 0;
-    CRect gridRect;
-    int gridHeight;
-    int gridWidth;
+    // グリッド間ナビゲーション用の空間インデックスに登録する矩形 (生成に失敗したグリッドは空のまま除外)
+    CGridSpatialIndex::Rect gridRects[TOTAL_GRIDS] = {};
 
-	// 定義された行数・列数に基づき、全てのグリッドコントロールをループで生成・配置
-    for (int row = 0; row < GRID_ARRAY_ROWS; ++row)
+    // コンパイル時に生成済みのレイアウト表 (LAYOUT) に従い、全てのグリッドコントロールを生成・配置
+    // 位置・ID・キャプションは全て表から参照するため、ここでは書式化やレイアウト計算を行いません。
+    for (int index = 0; index < TOTAL_GRIDS; ++index)
     {
-        int currentX = margin;
-        for (int col = 0; col < GRID_ARRAY_COLS; ++col)
+        CGridCtrl &grid = m_grids[index];
+        const GridLayout::GridPlacement &place = LAYOUT.grids[index];
+
+        // 1. グリッドをセットアップ
+        grid.SetupGrid(LayoutSpec::CELL_ROWS, LayoutSpec::CELL_COLS);
+        grid.SetRowHeight(LAYOUT_SPEC.nRowHeight);
+        grid.SetMaxVisibleRows(LAYOUT_SPEC.nMaxVisibleRows);
+        for (int c = 0; c < LayoutSpec::CELL_COLS; ++c)
         {
-            int index = row * GRID_ARRAY_COLS + col;
-            UINT nID = AFX_IDW_PANE_FIRST + index;
-
-            // 1. グリッドをセットアップ（6行2列）
-            m_grids[index].SetupGrid(6, 2);
-            m_grids[index].SetRowHeight(22);
-            m_grids[index].SetColumnWidth(0, 120);
-            m_grids[index].SetColumnWidth(1, 220);
-
-            // 2. 各セルのプロパティ（編集可否など）を設定
-            m_grids[index].SetCellEditable(1, 1, TRUE); // (行:2, 列:2)のセル
-            m_grids[index].SetCellEditable(2, 1, TRUE); // (行:3, 列:2)のセル
-            m_grids[index].SetCellEditable(3, 1, TRUE); // (行:4, 列:2)のセル
-            m_grids[index].SetCellEditable(5, 1, TRUE); // (行:6, 列:2)のセル
-
-            // 3. セルの初期テキストを設定 (オプション)
-            for (int r = 0; r < 6; ++r)
-            {
-                for (int c = 0; c < 2; ++c)
-                {
-                    CString str;
-                    str.Format(_T("Cell (%d, %d)"), r + 1, c + 1);
-                    m_grids[index].SetCellText(r, c, str);
-                }
-            }
-
-            // 4. CGridCtrlから1個あたりの正しいサイズを取得
-            gridHeight = m_grids[index].GetRequiredHeight();
-            gridWidth = m_grids[index].GetRequiredWidth();
-
-            // 5. グリッドの位置とサイズを計算
-            CRect gridRect(currentX, currentY, currentX + gridWidth, currentY + gridHeight);
+            grid.SetColumnWidth(c, LAYOUT_SPEC.colWidths[c]);
+        }
 
-            // 6. グリッドウィンドウを生成
-            if (!m_grids[index].Create(gridRect, this, nID))
+        // 2. 各セルの編集可否と初期テキストを表から設定
+        int cell = 0;
+        for (int r = 0; r < LayoutSpec::CELL_ROWS; ++r)
+        {
+            for (int c = 0; c < LayoutSpec::CELL_COLS; ++c, ++cell)
             {
-                TRACE(_T("Failed to create grid control #%d\n"), index);
-                continue; // 生成に失敗したら次へ
+                if (LAYOUT.editable[cell])
+                    grid.SetCellEditable(r, c, TRUE);
+                grid.SetCellText(r, c, CString(LAYOUT.captions[cell].szText));
             }
-            currentX += gridWidth + margin;
-            if (currentX > rightmostX)
-                rightmostX = currentX;
         }
-        currentY += gridHeight + margin;
+
+        // 3. 表の位置でグリッドウィンドウを生成
+        CRect gridRect(place.left, place.top, place.right, place.bottom);
+        if (!grid.Create(gridRect, this, place.nID))
+        {
+            TRACE(_T("Failed to create grid control #%d\n"), index);
+            continue; // 生成に失敗したら次へ
+        }
+        gridRects[index] = {place.left, place.top, place.right, place.bottom};
     }
 
-    // 全てのコントロールを配置した後の合計のサイズを保存
-    m_nTotalWidth = rightmostX;
-    m_nTotalHeight = currentY;
+    // 空間インデックスを構築 (スクロールに依存しないコンテンツ座標で保持)
+    m_gridIndex.Build(gridRects, TOTAL_GRIDS);
 
-    // スクロール位置を初期化
-    m_nHScrollPos = 0;
-    m_nVScrollPos = 0;
+    // 全てのコントロールを配置した後の合計のサイズを設定し、スクロール位置を先頭にする
+    m_scroll.SetContentSize(LAYOUT.nTotalWidth, LAYOUT.nTotalHeight);
 
     // スクロールバーの初期設定
-    UpdateScrollInfo();
+    m_scroll.UpdateScrollBars();
 
     return TRUE;
 }
 
-/**
- * @brief ダイアログのスクロールバー情報を現在の状態に合わせて更新します。
- * @details 全コンテンツのサイズとクライアント領域のサイズを比較し、
- * スクロールバーの表示/非表示、範囲、ページサイズを適切に設定します。
- */
-void CMyDialog::UpdateScrollInfo()
-{
-    CRect clientRect;
-    GetClientRect(&clientRect);
-    SCROLLINFO si;
-    si.cbSize = sizeof(SCROLLINFO);
-
-    // --- 垂直スクロールバー ---
-    if (m_nTotalHeight > clientRect.Height())
-    {
-        si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
-        si.nMin = 0;
-        si.nMax = m_nTotalHeight;
-        si.nPage = clientRect.Height();
-        si.nPos = m_nVScrollPos;
-        SetScrollInfo(SB_VERT, &si, TRUE);
-        ShowScrollBar(SB_VERT, TRUE);
-    }
-    else
-    {
-        m_nVScrollPos = 0;
-        ShowScrollBar(SB_VERT, FALSE);
-    }
-
-    // --- 水平スクロールバー ---
-    if (m_nTotalWidth > clientRect.Width())
-    {
-        si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
-        si.nMin = 0;
-        si.nMax = m_nTotalWidth;
-        si.nPage = clientRect.Width();
-        si.nPos = m_nHScrollPos;
-        SetScrollInfo(SB_HORZ, &si, TRUE);
-        ShowScrollBar(SB_HORZ, TRUE);
-    }
-    else
-    {
-        m_nHScrollPos = 0;
-        ShowScrollBar(SB_HORZ, FALSE);
-    }
-}
-
 /**
  * @brief ダイアログのサイズ変更イベント(WM_SIZE)を処理します。
  * @param nType サイズ変更の種類
@@ -219,7 +161,7 @@ void CMyDialog::OnSize(UINT nType, int cx, int cy)
     // ウィンドウの準備ができていればスクロール情報を更新
     if (GetSafeHwnd() != nullptr)
     {
-        UpdateScrollInfo();
+        m_scroll.UpdateScrollBars();
     }
 }
 
@@ -231,38 +173,7 @@ void CMyDialog::OnSize(UINT nType, int cx, int cy)
  */
 void CMyDialog::OnVScroll(UINT nSBCode, UINT nPos, CScrollBar *pScrollBar)
 {
-    CRect clientRect;
-    GetClientRect(&clientRect);
-    int currentPos = m_nVScrollPos;
-    int lineHeight = 40; // 1回の上下キーでスクロールする量
-
-    switch (nSBCode)
-    {
-    case SB_LINEUP:      currentPos -= lineHeight; break;
-    case SB_LINEDOWN:    currentPos += lineHeight; break;
-    case SB_PAGEUP:      currentPos -= clientRect.Height(); break;
-    case SB_PAGEDOWN:    currentPos += clientRect.Height(); break;
-    case SB_THUMBTRACK:  currentPos = nPos; break;
-    case SB_TOP:         currentPos = 0; break;
-    case SB_BOTTOM:      currentPos = GetScrollLimit(SB_VERT); break;
-    }
-
-    // 新しいスクロール位置が有効な範囲内に収まるようにクランプ処理
-    int maxScrollPos = GetScrollLimit(SB_VERT);
-	currentPos = max(0, min(currentPos, maxScrollPos));
-
-    // 位置に変化がなければ何もしない
-    if (currentPos == m_nVScrollPos)
-        return;
-
-    // 画面を移動させる量を計算
-    int scrollAmount = m_nVScrollPos - currentPos;
-    m_nVScrollPos = currentPos;
-
-    // ウィンドウをスクロールし、スクロールバーの位置を更新
-    ScrollWindow(0, scrollAmount);
-    SetScrollPos(SB_VERT, m_nVScrollPos, TRUE);
-
+    m_scroll.OnScroll(SB_VERT, nSBCode, nPos);
     CDialogEx::OnVScroll(nSBCode, nPos, pScrollBar);
 }
 
@@ -274,44 +185,13 @@ void CMyDialog::OnVScroll(UINT nSBCode, UINT nPos, CScrollBar *pScrollBar)
  */
 void CMyDialog::OnHScroll(UINT nSBCode, UINT nPos, CScrollBar *pScrollBar)
 {
-    CRect clientRect;
-    GetClientRect(&clientRect);
-    int currentPos = m_nHScrollPos;
-    int lineHeight = 40; // 1回の左右キーでスクロールする量
-
-    switch (nSBCode)
-    {
-    case SB_LINELEFT:    currentPos -= lineHeight; break;
-    case SB_LINERIGHT:   currentPos += lineHeight; break;
-    case SB_PAGELEFT:    currentPos -= clientRect.Width(); break;
-    case SB_PAGERIGHT:   currentPos += clientRect.Width(); break;
-    case SB_THUMBTRACK:  currentPos = nPos; break;
-    case SB_LEFT:        currentPos = 0; break;
-    case SB_RIGHT:       currentPos = GetScrollLimit(SB_HORZ); break;
-    }
-
-    // 新しいスクロール位置が有効な範囲内に収まるようにクランプ処理
-	int maxScrollPos = GetScrollLimit(SB_HORZ);
-    currentPos = max(0, min(currentPos, maxScrollPos));
-
-
-    // 位置に変化がなければ何もしない
-    if (currentPos == m_nHScrollPos)
-        return;
-
-    // 画面を移動させる量を計算
-    int scrollAmount = m_nHScrollPos - currentPos;
-    m_nHScrollPos = currentPos;
-
-    // ウィンドウをスクロールし、スクロールバーの位置を更新
-    ScrollWindow(scrollAmount, 0);
-    SetScrollPos(SB_HORZ, m_nHScrollPos, TRUE);
-
+    m_scroll.OnScroll(SB_HORZ, nSBCode, nPos);
     CDialogEx::OnHScroll(nSBCode, nPos, pScrollBar);
 }
 
 /**
  * @brief マウスホイールイベント(WM_MOUSEWHEEL)を処理します。
+ * @details 1ノッチ (WHEEL_DELTA) あたり LINE_SCROLL_AMOUNT ピクセルの速さで目標位置へ滑らかに追従します。
  * @param nFlags 修飾キーの状態
  * @param zDelta ホイールの回転量
  * @param pt カーソルの位置
@@ -319,23 +199,7 @@ void CMyDialog::OnHScroll(UINT nSBCode, UINT nPos, CScrollBar *pScrollBar)
  */
 BOOL CMyDialog::OnMouseWheel(UINT nFlags, short zDelta, CPoint pt)
 {
-    // Shiftキーが押されている場合は水平スクロール
-    if (nFlags & MK_SHIFT)
-    {
-        if (zDelta > 0)
-            OnHScroll(SB_LINELEFT, 0, nullptr);
-        else
-            OnHScroll(SB_LINERIGHT, 0, nullptr);
-    }
-    else // それ以外は垂直スクロール
-    {
-        if (zDelta > 0)
-            OnVScroll(SB_LINEUP, 0, nullptr);
-        else
-            OnVScroll(SB_LINEDOWN, 0, nullptr);
-    }
-
-    return TRUE;
+    return m_scroll.OnMouseWheel(nFlags, zDelta);
 }
 
 /**
@@ -365,20 +229,21 @@ BOOL CMyDialog::PreTranslateMessage(MSG *pMsg)
 /**
  * @brief 指定されたグリッドをアクティブ状態にします。
  * @param[in] pGridToActivate アクティブにするグリッドコントロールへのポインタ
- * @details 他のグリッドは非アクティブ化し、指定グリッドにフォーカスを移します。
+ * @details 直前にアクティブだったグリッドだけを非アクティブ化し、指定グリッドにフォーカスを移します。
+ * 全グリッドを走査しないため、グリッド数に関係なく操作対象は2個だけです。
  */
 void CMyDialog::ActivateGrid(CGridCtrl *pGridToActivate)
 {
     if (pGridToActivate && pGridToActivate != m_pActiveGrid)
     {
+        // 直前のアクティブグリッドを非アクティブ化
+        if (m_pActiveGrid)
+            m_pActiveGrid->SetActive(FALSE);
+
         // 新しいグリッドをアクティブとして記録
         m_pActiveGrid = pGridToActivate;
+        m_pActiveGrid->SetActive(TRUE);
 
-        // 全てのグリッドコントロールをループし、アクティブ/非アクティブを設定
-        for (int i = 0; i < TOTAL_GRIDS; ++i)
-        {
-            m_grids[i].SetActive(&m_grids[i] == m_pActiveGrid);
-        }
         // 新しくアクティブになったグリッドにフォーカスを移動
         m_pActiveGrid->SetFocus();
     }
@@ -394,6 +259,8 @@ void CMyDialog::ActivateGrid(CGridCtrl *pGridToActivate)
  */
 LRESULT CMyDialog::OnGridActivated(WPARAM wParam, LPARAM lParam)
 {
+    CInputTraceScope trace("CMyDialog::OnGridActivated");
+
     UINT nCtrlID = (UINT)wParam;
     CGridCtrl *pActivatedGrid = (CGridCtrl *)GetDlgItem(nCtrlID);
     ActivateGrid(pActivatedGrid);
@@ -408,6 +275,8 @@ LRESULT CMyDialog::OnGridActivated(WPARAM wParam, LPARAM lParam)
  */
 LRESULT CMyDialog::OnGridNavBoundaryHit(WPARAM wParam, LPARAM lParam)
 {
+    CInputTraceScope trace("CMyDialog::OnGridNavBoundaryHit");
+
     UINT nKey = (UINT)wParam;    // 押されたカーソルキー (VK_UPなど)
     UINT nCtrlID = (UINT)lParam; // 通知元のグリッドのID
 
@@ -416,49 +285,32 @@ LRESULT CMyDialog::OnGridNavBoundaryHit(WPARAM wParam, LPARAM lParam)
         return 0; // アクティブなグリッドからの通知でなければ無視
     }
 
-    // 現在のグリッドのインデックスを特定
-    int currentIndex = -1;
-    for (int i = 0; i < TOTAL_GRIDS; ++i)
+    // 現在のグリッドのインデックスは配列内の位置から直接求める
+    int currentIndex = static_cast<int>(m_pActiveGrid - m_grids);
+    if (currentIndex < 0 || currentIndex >= TOTAL_GRIDS)
     {
-        if (&m_grids[i] == m_pActiveGrid)
-        {
-            currentIndex = i;
-            break;
-        }
+        return 0;
     }
 
-    if (currentIndex != -1)
+    // 押されたキーを移動方向に変換
+    CGridSpatialIndex::Direction dir;
+    switch (nKey)
     {
-        int currentRow = currentIndex / GRID_ARRAY_COLS;
-        int currentCol = currentIndex % GRID_ARRAY_COLS;
-        int newIndex = -1;
+    case VK_UP:    dir = CGridSpatialIndex::DIR_UP; break;
+    case VK_DOWN:  dir = CGridSpatialIndex::DIR_DOWN; break;
+    case VK_LEFT:  dir = CGridSpatialIndex::DIR_LEFT; break;
+    case VK_RIGHT: dir = CGridSpatialIndex::DIR_RIGHT; break;
+    default:       return 0;
+    }
 
-        // 押されたキーに応じて、移動先のグリッドインデックスを計算
-        switch (nKey)
-        {
-        case VK_UP:
-            if (currentRow > 0)
-                newIndex = currentIndex - GRID_ARRAY_COLS;
-            break;
-        case VK_DOWN:
-            if (currentRow < GRID_ARRAY_ROWS - 1)
-                newIndex = currentIndex + GRID_ARRAY_COLS;
-            break;
-        case VK_LEFT:
-            if (currentCol > 0)
-                newIndex = currentIndex - 1;
-            break;
-        case VK_RIGHT:
-            if (currentCol < GRID_ARRAY_COLS - 1)
-                newIndex = currentIndex + 1;
-            break;
-        }
+    // 空間インデックスから、その方向で最も近いグリッドを検索
+    // (配置が行列状でなくても、実際の位置関係に基づいて移動先が決まります)
+    int newIndex = m_gridIndex.FindNearest(currentIndex, dir);
 
-        // 有効な移動先があれば、グリッドをアクティブ化
-        if (newIndex != -1)
-        {
-            ActivateGrid(&m_grids[newIndex]);
-        }
+    // 有効な移動先があれば、グリッドをアクティブ化
+    if (newIndex != -1)
+    {
+        ActivateGrid(&m_grids[newIndex]);
     }
 
     return 0;
@@ -473,55 +325,66 @@ void CMyDialog::EnsureGridVisible(CGridCtrl *pGrid)
     if (!pGrid || !pGrid->GetSafeHwnd())
         return;
 
-    CRect clientRect;
-    GetClientRect(&clientRect); // ダイアログの現在の表示領域
-
     CRect gridRect;
     pGrid->GetWindowRect(&gridRect); // グリッドのスクリーン座標での位置
     ScreenToClient(&gridRect);       // ダイアログのクライアント座標に変換（スクロール後の見た目上の位置）
+    m_scroll.EnsureVisible(gridRect);
+}
 
-    // --- 垂直スクロール量の計算 ---
-    int newVPos = m_nVScrollPos;
-    if (gridRect.top < 0) // 上にはみ出している場合
-    {
-        newVPos += gridRect.top; // はみ出した分だけスクロール位置を戻す
-    }
-    else if (gridRect.bottom > clientRect.bottom) // 下にはみ出している場合
-    {
-        newVPos += (gridRect.bottom - clientRect.bottom); // はみ出した分だけスクロール位置を進める
-    }
-
-    // --- 水平スクロール量の計算 ---
-    int newHPos = m_nHScrollPos;
-    if (gridRect.left < 0) // 左にはみ出している場合
-    {
-        newHPos += gridRect.left;
-    }
-    else if (gridRect.right > clientRect.right) // 右にはみ出している場合
-    {
-        newHPos += (gridRect.right - clientRect.right);
-    }
+/**
+ * @brief マウス左ボタン押下イベント(WM_LBUTTONDOWN)を処理します。
+ * @details グリッドの隙間 (ダイアログの背景) を押下した場合に届きます。ドラッグによるスクロールに備えます。
+ * @param nFlags 修飾キーの状態
+ * @param point マウスカーソルのクライアント座標
+ */
+void CMyDialog::OnLButtonDown(UINT nFlags, CPoint point)
+{
+    m_scroll.OnLButtonDown(point);
+    CDialogEx::OnLButtonDown(nFlags, point);
+}
 
-    // スクロール位置が変化した場合のみ、実際のスクロール処理を実行
-    if (newVPos != m_nVScrollPos || newHPos != m_nHScrollPos)
-    {
-        // 範囲内に収める
-        newHPos = max(0, min(newHPos, GetScrollLimit(SB_HORZ)));
-        newVPos = max(0, min(newVPos, GetScrollLimit(SB_VERT)));
+/**
+ * @brief マウス移動イベント(WM_MOUSEMOVE)を処理します。
+ * @param nFlags 修飾キーの状態
+ * @param point マウスカーソルのクライアント座標
+ */
+void CMyDialog::OnMouseMove(UINT nFlags, CPoint point)
+{
+    m_scroll.OnMouseMove(nFlags, point);
+    CDialogEx::OnMouseMove(nFlags, point);
+}
 
-        // 画面を移動させる量を計算
-        int dx = m_nHScrollPos - newHPos;
-        int dy = m_nVScrollPos - newVPos;
+/**
+ * @brief マウス左ボタン解放イベント(WM_LBUTTONUP)を処理します。
+ * @param nFlags 修飾キーの状態
+ * @param point マウスカーソルのクライアント座標
+ */
+void CMyDialog::OnLButtonUp(UINT nFlags, CPoint point)
+{
+    m_scroll.OnLButtonUp(point);
+    CDialogEx::OnLButtonUp(nFlags, point);
+}
 
-        // 新しい位置を保存
-        m_nHScrollPos = newHPos;
-        m_nVScrollPos = newVPos;
+/**
+ * @brief マウスキャプチャの喪失(WM_CAPTURECHANGED)を処理します。
+ * @details ドラッグを終了し、離した瞬間の速度で慣性スクロールを開始します。
+ * @param pWnd 新しくキャプチャを得たウィンドウ
+ */
+void CMyDialog::OnCaptureChanged(CWnd *pWnd)
+{
+    m_scroll.OnCaptureChanged();
+    CDialogEx::OnCaptureChanged(pWnd);
+}
 
-        // ウィンドウをスクロール
-        ScrollWindow(dx, dy);
+/**
+ * @brief タイマーイベント(WM_TIMER)を処理します。
+ * @details 慣性スクロールのフレームタイマーは m_scroll が処理します。
+ * @param nIDEvent タイマーID
+ */
+void CMyDialog::OnTimer(UINT_PTR nIDEvent)
+{
+    if (m_scroll.OnTimer(nIDEvent))
+        return;
 
-        // スクロールバーの位置を更新
-        SetScrollPos(SB_HORZ, m_nHScrollPos, TRUE);
-        SetScrollPos(SB_VERT, m_nVScrollPos, TRUE);
-    }
-}
\ No newline at end of file
+    CDialogEx::OnTimer(nIDEvent);
+}
@@ -1,6 +1,9 @@
 ﻿#pragma once
 #include "afxdialogex.h"
 #include "GridCtrl.h"
+#include "DialogLayoutSpecs.h"
+#include "GridSpatialIndex.h"
+#include "KineticScrollHost.h"
 
 // CMyDialog ダイアログ
 
@@ -8,9 +11,28 @@ class CMyDialog : public CDialogEx
 {
     DECLARE_DYNAMIC(CMyDialog)
 
-    static const int GRID_ARRAY_ROWS = 10;
-    static const int GRID_ARRAY_COLS = 1;
-    static const int TOTAL_GRIDS = (GRID_ARRAY_ROWS * GRID_ARRAY_COLS);
+    // グリッド配列のレイアウト仕様 (10x1個のグリッド、各6行2列)
+    using LayoutSpec = DialogLayoutSpecs::Dialog1Spec;
+    using LayoutTables = GridLayout::DialogTables<10, 1, 6, 2>;
+
+    static const int GRID_ARRAY_ROWS = LayoutSpec::ARRAY_ROWS;
+    static const int GRID_ARRAY_COLS = LayoutSpec::ARRAY_COLS;
+    static const int TOTAL_GRIDS = LayoutSpec::TOTAL_GRIDS;
+    static const int LINE_SCROLL_AMOUNT = 40;       // スクロールバーの矢印1回、およびホイール1ノッチあたりのスクロール量
+    static const UINT_PTR KINETIC_TIMER_ID = 1;     // 慣性スクロールのフレームタイマーID
+
+    // 間隔10px、行高22px、列幅120/220px。2,3,4,6行目の2列目が編集可能 (テストと共有する DialogLayoutSpecs.h の仕様)
+    static constexpr LayoutSpec LAYOUT_SPEC = DialogLayoutSpecs::DIALOG1_SPEC;
+    // コンパイル時に生成される位置・ID・キャプションの表
+    static constexpr LayoutTables LAYOUT = GridLayout::BuildTables(LAYOUT_SPEC);
+
+    static_assert(DialogLayoutSpecs::FIRST_ID == AFX_IDW_PANE_FIRST, "先頭グリッドのIDが AFX_IDW_PANE_FIRST と異なります");
+    static_assert(GridLayout::HasValidMetrics(LAYOUT_SPEC), "行高・列幅・間隔が不正です");
+    static_assert(GridLayout::IsEditableMaskInRange(LAYOUT_SPEC), "編集可否マスクが列数の範囲外を指しています");
+    static_assert(GridLayout::AreCaptionsInRange(LAYOUT_SPEC), "キャプションが長すぎます");
+    static_assert(GridLayout::IsIdRangeValid(LAYOUT_SPEC, AFX_IDW_PANE_FIRST, AFX_IDW_PANE_LAST), "コントロールIDが範囲外です");
+    static_assert(GridLayout::HasNoOverlap(LAYOUT), "グリッド同士が重なっています");
+    static_assert(GridLayout::IsWithinContent(LAYOUT), "グリッドがコンテンツ領域の範囲外です");
 
 public:
     explicit CMyDialog(CWnd *pParent = nullptr); // 標準コンストラクター
@@ -26,14 +48,8 @@ protected:
     CGridCtrl m_grids[TOTAL_GRIDS];
 
     CGridCtrl *m_pActiveGrid; // 最新のクリックされたグリッドを保持するポインタ
-
-    // スクロール関連のメンバ変数
-    int m_nTotalWidth;  // 全グリッドを配置した場合の合計の幅
-    int m_nTotalHeight; // 全グリッドを配置した場合の合計の高さ
-    int m_nHScrollPos;  // 現在の水平スクロール位置
-    int m_nVScrollPos;  // 現在の垂直スクロール位置
-    // スクロール情報を更新するためのヘルパー関数
-    void UpdateScrollInfo();
+    CGridSpatialIndex m_gridIndex; // グリッド矩形の空間インデックス (グリッド間のキー移動に使用)
+    CKineticScrollHost m_scroll;   // スクロール位置・スクロールバー・慣性スクロール (フレームタイマーを含む)
 
     virtual void DoDataExchange(CDataExchange *pDX) override; // DDX/DDV サポート
     void ActivateGrid(CGridCtrl *pGridToActivate);
@@ -43,6 +59,11 @@ protected:
     afx_msg void OnVScroll(UINT nSBCode, UINT nPos, CScrollBar *pScrollBar);
     afx_msg void OnSize(UINT nType, int cx, int cy);
     afx_msg BOOL OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
+    afx_msg void OnLButtonDown(UINT nFlags, CPoint point);
+    afx_msg void OnLButtonUp(UINT nFlags, CPoint point);
+    afx_msg void OnMouseMove(UINT nFlags, CPoint point);
+    afx_msg void OnCaptureChanged(CWnd *pWnd);
+    afx_msg void OnTimer(UINT_PTR nIDEvent);
     virtual BOOL OnInitDialog() override;
     virtual BOOL PreTranslateMessage(MSG *pMsg) override;
     afx_msg LRESULT OnGridActivated(WPARAM wParam, LPARAM lParam);
@@ -8,6 +8,9 @@
 #pragma once
 #include "afxdialogex.h"
 #include "GridCtrl.h"
+#include "DialogLayoutSpecs.h"
+#include "GridSpatialIndex.h"
+#include "KineticScrollHost.h"
 
 /**
  * @class CMyDialog2
@@ -21,12 +24,34 @@ class CMyDialog2 : public CDialogEx
     DECLARE_DYNAMIC(CMyDialog2)
 
     // --- 定数定義 ---
+    /// @brief グリッド配列のレイアウト仕様の型 (5x2個のグリッド、各6行2列)
+    using LayoutSpec = DialogLayoutSpecs::Dialog2Spec;
+    /// @brief コンパイル時に生成されるレイアウト表の型
+    using LayoutTables = GridLayout::DialogTables<5, 2, 6, 2>;
+
     /// @brief グリッド配列の行数
-    static const int GRID_ARRAY_ROWS = 5;
+    static const int GRID_ARRAY_ROWS = LayoutSpec::ARRAY_ROWS;
     /// @brief グリッド配列の列数
-    static const int GRID_ARRAY_COLS = 2;
+    static const int GRID_ARRAY_COLS = LayoutSpec::ARRAY_COLS;
     /// @brief 合計グリッド数
-    static const int TOTAL_GRIDS = (GRID_ARRAY_ROWS * GRID_ARRAY_COLS);
+    static const int TOTAL_GRIDS = LayoutSpec::TOTAL_GRIDS;
+    /// @brief スクロールバーの矢印1回、およびホイール1ノッチあたりのスクロール量 (ピクセル)
+    static const int LINE_SCROLL_AMOUNT = 40;
+    /// @brief 慣性スクロールのフレームタイマーID
+    static const UINT_PTR KINETIC_TIMER_ID = 1;
+
+    /// @brief グリッド配列のレイアウト仕様 (間隔10px、行高22px、列幅120/220px、全セル読み取り専用、テストと共有)
+    static constexpr LayoutSpec LAYOUT_SPEC = DialogLayoutSpecs::DIALOG2_SPEC;
+    /// @brief LAYOUT_SPEC からコンパイル時に生成される位置・ID・キャプションの表
+    static constexpr LayoutTables LAYOUT = GridLayout::BuildTables(LAYOUT_SPEC);
+
+    static_assert(DialogLayoutSpecs::FIRST_ID == AFX_IDW_PANE_FIRST, "先頭グリッドのIDが AFX_IDW_PANE_FIRST と異なります");
+    static_assert(GridLayout::HasValidMetrics(LAYOUT_SPEC), "行高・列幅・間隔が不正です");
+    static_assert(GridLayout::IsEditableMaskInRange(LAYOUT_SPEC), "編集可否マスクが列数の範囲外を指しています");
+    static_assert(GridLayout::AreCaptionsInRange(LAYOUT_SPEC), "キャプションが長すぎます");
+    static_assert(GridLayout::IsIdRangeValid(LAYOUT_SPEC, AFX_IDW_PANE_FIRST, AFX_IDW_PANE_LAST), "コントロールIDが範囲外です");
+    static_assert(GridLayout::HasNoOverlap(LAYOUT), "グリッド同士が重なっています");
+    static_assert(GridLayout::IsWithinContent(LAYOUT), "グリッドがコンテンツ領域の範囲外です");
 
 public:
     /**
@@ -54,26 +79,15 @@ protected:
     // --- 状態管理 ---
     /// @brief 現在アクティブ（フォーカスを持っている）なグリッドへのポインタ
     CGridCtrl *m_pActiveGrid;
+    /// @brief グリッド矩形の空間インデックス (コンテンツ座標、グリッド間のキーボード移動先の検索に使用)
+    CGridSpatialIndex m_gridIndex;
 
     // --- スクロール関連メンバ ---
-    /// @brief 全グリッドを配置した場合の合計の幅
-    int m_nTotalWidth;
-    /// @brief 全グリッドを配置した場合の合計の高さ
-    int m_nTotalHeight;
-    /// @brief 現在の水平スクロール位置 (ピクセル単位)
-    int m_nHScrollPos;
-    /// @brief 現在の垂直スクロール位置 (ピクセル単位)
-    int m_nVScrollPos;
+    /// @brief スクロール位置・スクロールバー・慣性スクロール (フレームタイマーを含む)
+    CKineticScrollHost m_scroll;
     
     // --- ヘルパー関数 ---
 
-    /**
-     * @brief ダイアログのスクロールバー情報を現在の状態に合わせて更新します。
-     * @details 全コンテンツのサイズとクライアント領域のサイズを比較し、
-     * スクロールバーの表示/非表示、範囲、ページサイズを適切に設定します。
-     */
-    void UpdateScrollInfo();
-
     /**
      * @brief 指定されたグリッドをアクティブ状態にします。
      * @param[in] pGridToActivate アクティブにするグリッドコントロールへのポインタ
@@ -137,6 +151,41 @@ protected:
      */
     afx_msg BOOL OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
 
+    /**
+     * @brief マウス左ボタン押下イベント(WM_LBUTTONDOWN)を処理します。
+     * @details グリッドの隙間 (ダイアログの背景) を押下した場合、ドラッグによるスクロールに備えます。
+     * @param nFlags 修飾キーの状態
+     * @param point マウスカーソルのクライアント座標
+     */
+    afx_msg void OnLButtonDown(UINT nFlags, CPoint point);
+
+    /**
+     * @brief マウス左ボタン解放イベント(WM_LBUTTONUP)を処理します。
+     * @param nFlags 修飾キーの状態
+     * @param point マウスカーソルのクライアント座標
+     */
+    afx_msg void OnLButtonUp(UINT nFlags, CPoint point);
+
+    /**
+     * @brief マウス移動イベント(WM_MOUSEMOVE)を処理します。
+     * @param nFlags 修飾キーの状態
+     * @param point マウスカーソルのクライアント座標
+     */
+    afx_msg void OnMouseMove(UINT nFlags, CPoint point);
+
+    /**
+     * @brief マウスキャプチャの喪失(WM_CAPTURECHANGED)を処理します。
+     * @param pWnd 新しくキャプチャを得たウィンドウ
+     */
+    afx_msg void OnCaptureChanged(CWnd *pWnd);
+
+    /**
+     * @brief タイマーイベント(WM_TIMER)を処理します。
+     * @details 慣性スクロールのフレームタイマーは m_scroll が処理します。
+     * @param nIDEvent タイマーID
+     */
+    afx_msg void OnTimer(UINT_PTR nIDEvent);
+
     /**
      * @brief ダイアログの初期化処理(WM_INITDIALOG)をオーバーライドします。
      * @details グリッドコントロールの動的生成と配置、スクロールバーの初期設定を行います。
@@ -7,6 +7,7 @@
 #include "MFCApplication4.h"
 #include "afxdialogex.h"
 #include "CMyDialog3.h"
+#include "InputTrace.h"
 
 // CMyDialog3クラスが動的生成可能であることをフレームワークに伝えます。
 IMPLEMENT_DYNAMIC(CMyDialog3, CDialogEx)
@@ -16,8 +17,12 @@ IMPLEMENT_DYNAMIC(CMyDialog3, CDialogEx)
  * @param pParent 親ウィンドウへのポインタ
  */
 CMyDialog3::CMyDialog3(CWnd *pParent /*=nullptr*/)
-    : CDialogEx(IDD, pParent), m_nSelectedRow(-1), m_nCurrentPage(1)
+    : CDialogEx(IDD, pParent), m_nSelectedRow(-1),
+      m_functionBar(CMFCApplication4App::COMMAND_ROW_COUNT, CMFCApplication4App::COMMAND_FUNCTION_COUNT,
+                    FUNCTION_BUTTON_COUNT)
 {
+    // 実行中の機能のボタンは、完了するまで無効にします。
+    m_functionBar.SetBusyFunc([](int n, int k) { return theApp.GetCommandRegistry().IsBusy(n, k); });
 }
 
 /**
@@ -45,6 +50,7 @@ BEGIN_MESSAGE_MAP(CMyDialog3, CDialogEx)
     ON_BN_CLICKED(IDC_BTN_NEXTPAGE, &CMyDialog3::OnNextPageClicked)
     // IDC_BTN_FUNC1からIDC_BTN_FUNC8までの範囲のボタンクリックをOnFuncButtonClickedに一括で紐付けます。
     ON_COMMAND_RANGE(IDC_BTN_FUNC1, IDC_BTN_FUNC8, &CMyDialog3::OnFuncButtonClicked)
+    ON_WM_DESTROY()
 END_MESSAGE_MAP()
 
 
@@ -55,14 +61,14 @@ END_MESSAGE_MAP()
  */
 void CMyDialog3::OnGridSelChanged(NMHDR *pNMHDR, LRESULT *pResult)
 {
+    CInputTraceScope trace("CMyDialog3::OnGridSelChanged");
+
     NM_GRIDVIEW *pNMGV = (NM_GRIDVIEW *)pNMHDR;
 
     // 選択された行のインデックス(0始まり)をメンバ変数に保存します。
     m_nSelectedRow = pNMGV->iRow;
-    // 新しい行が選択されたら、必ずページ1にリセットします。
-    m_nCurrentPage = 1;
-    // ボタンの表示状態を現在の選択状態に合わせて更新します。
-    UpdateButtons();
+    // 新しい行が選択されたら、必ず先頭ページにリセットし、ボタンの表示状態を更新します。
+    UpdateButtons(0);
 
     *pResult = 0;
 }
@@ -122,7 +128,7 @@ BOOL CMyDialog3::OnInitDialog()
     int currentX = nMargin;
 
     // 8個の機能ボタンをループで動的に生成
-    for (int i = 0; i < 8; ++i)
+    for (int i = 0; i < FUNCTION_BUTTON_COUNT; ++i)
     {
         CRect btnRect(currentX, currentY, currentX + nFuncBtnWidth, currentY + nFuncBtnHeight);
         UINT nID = IDC_BTN_FUNC_BASE + i;
@@ -139,8 +145,11 @@ BOOL CMyDialog3::OnInitDialog()
 
     // --- 初期状態の設定 ---
     m_nSelectedRow = -1; // 最初は何も選択されていない状態
-    m_nCurrentPage = 1;
-    UpdateButtons(); // ボタンを非表示/無効状態にする
+    m_functionBar.Invalidate(); // 生成直後のボタンには全ての項目を反映する
+    UpdateButtons(0); // ボタンを空欄/無効状態にする
+
+    // 機能の進捗と完了の通知を受けて、実行中のボタンの表示を更新します。
+    theApp.GetCommandRegistry().AddListener(this);
 
     return TRUE;
 }
@@ -148,14 +157,23 @@ BOOL CMyDialog3::OnInitDialog()
 /**
  * @brief キーボードメッセージをウィンドウにディスパッチされる前に横取りします。
  * @details EnterキーとEscapeキーによるダイアログ終了を無効化するために使用します。
+ * Escapeキーは、選択行で実行中の機能の取り消しに使用します。
  * @param pMsg メッセージ情報へのポインタ
  * @return メッセージを処理した場合はTRUE、デフォルト処理に任せる場合はFALSE。
  */
 BOOL CMyDialog3::PreTranslateMessage(MSG *pMsg)
 {
-    // Escapeキーが押された場合、ダイアログが閉じるのを防ぎます。
+    // Escapeキーが押された場合、ダイアログが閉じるのを防ぎ、選択行で実行中の機能を取り消します。
     if (pMsg->message == WM_KEYDOWN && pMsg->wParam == VK_ESCAPE)
     {
+        if (m_nSelectedRow != -1)
+        {
+            CCommandRegistry &registry = theApp.GetCommandRegistry();
+            for (int k = 1; k <= registry.GetFunctionCount(); ++k)
+            {
+                registry.Cancel(m_nSelectedRow + 1, k);
+            }
+        }
         return TRUE; // メッセージを処理済みとし、伝搬させない
     }
 
@@ -175,119 +193,139 @@ BOOL CMyDialog3::PreTranslateMessage(MSG *pMsg)
  */
 void CMyDialog3::OnNextPageClicked()
 {
-    // ページ番号をトグル（1なら2に、2なら1に）します。
-    m_nCurrentPage = (m_nCurrentPage == 1) ? 2 : 1;
-    // ボタンの表示を更新します。
-    UpdateButtons();
+    // 次のページへ進めます（最後のページの次は先頭ページ）。
+    UpdateButtons(m_functionBar.GetNextPage());
     // フォーカスをグリッドに戻す
     m_gridCtrl.SetFocus();
 }
 
 /**
  * @brief 8つの機能ボタンのクリックイベント(BN_CLICKED)を一括で処理します。
+ * @details 機能 F(n-k) を登録表でバックグラウンド実行し、実行中のボタンを無効にします。
+ * 完了は OnCommandFinished() で通知され、ボタンは再び有効になります。
  * @param nID クリックされたボタンのコントロールID
  */
 void CMyDialog3::OnFuncButtonClicked(UINT nID)
 {
+    CInputTraceScope trace("CMyDialog3::OnFuncButtonClicked");
+
     // 押されたボタンのインデックス(0-7)を取得
     int nButtonIndex = nID - IDC_BTN_FUNC1;
 
-    // ボタンにGWLP_USERDATAとして保存しておいた「k」の値を取得します。
-    int k = (int)::GetWindowLongPtr(m_btnFunc[nButtonIndex].GetSafeHwnd(), GWLP_USERDATA);
+    // 表示中のページでボタンに割り当てられている「k」の値を取得します (空欄なら0)。
+    int k = m_functionBar.GetButtonFunction(nButtonIndex);
 
     // 現在選択されている行から「n」の値(1始まり)を取得します。
     int n = m_nSelectedRow + 1;
 
-    // 親ウィンドウに「n」と「k」を別々にPostMessageで通知します。
-    GetParent()->PostMessage(WM_EXECUTE_FUNCTION, (WPARAM)n, (LPARAM)k);
+    // 機能 F(n-k) をワーカーで実行し、実行中のボタンを無効にします。
+    if (theApp.GetCommandRegistry().Execute(n, k))
+    {
+        UpdateButtons(m_functionBar.GetPage());
+    }
     // フォーカスをグリッドに戻す
     m_gridCtrl.SetFocus();
 }
 
 /**
- * @brief 現在の選択行とページ状態に基づき、全ボタンの表示/状態を更新します。
+ * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
+ * @details 機能のリスナーの登録を解除します。実行中の機能はダイアログを閉じても続行し、
+ * 完了はメインダイアログが表示します。
  */
-void CMyDialog3::UpdateButtons()
+void CMyDialog3::OnDestroy()
 {
-    // 行が選択されていない場合
-    if (m_nSelectedRow == -1)
-    {
-        // 全ての機能ボタンを「空」「無効」「表示」状態にする
-        for (int i = 0; i < 8; ++i)
-        {
-            m_btnFunc[i].SetWindowText(_T(""));
-            m_btnFunc[i].EnableWindow(FALSE);
-            m_btnFunc[i].ShowWindow(SW_SHOW);
-        }
-
-        // 次ページボタンも同様に「空」「無効」「表示」状態にする
-        m_btnNextPage.SetWindowText(_T(""));
-        m_btnNextPage.EnableWindow(FALSE);
-        m_btnNextPage.ShowWindow(SW_SHOW);
-
-        return;
-    }
+    theApp.GetCommandRegistry().RemoveListener(this);
+    CDialogEx::OnDestroy();
+}
 
-    // --- 次ページボタンの状態制御 ---
-    // 選択されている行の2列目のテキストを取得します。
-    CString selectedCellText = m_gridCtrl.GetCellText(m_nSelectedRow, 1);
-    // テキストが空欄の場合のみ、次ページボタンを有効にします。
-    if (selectedCellText.IsEmpty())
+/**
+ * @brief 機能 F(n-k) の進捗通知を受け、表示中のボタンであれば進捗を表示します。
+ * @details 進捗はモデルに記録し、表示中のボタンのラベルだけが変わります。
+ * 別の行やページを表示中でも記録しておくため、戻ってきたときに最新の進捗が表示されます。
+ * @param nRow 行番号 n
+ * @param nFunction 機能番号 k
+ * @param nPercent 進捗
+ */
+void CMyDialog3::OnCommandProgress(int nRow, int nFunction, int nPercent)
+{
+    m_functionBar.SetProgress(nRow, nFunction, nPercent);
+    if (nRow == m_nSelectedRow + 1)
     {
-        m_btnNextPage.SetWindowText(_T(">>"));
-        m_btnNextPage.EnableWindow(TRUE);
+        m_functionBar.Apply(*this);
     }
-    else
+}
+
+/**
+ * @brief 機能 F(n-k) の完了通知を受け、ボタンの状態を更新します。
+ * @param nRow 行番号 n
+ * @param nFunction 機能番号 k
+ * @param nStatus 終了状態 (CCommandRegistry::Status)
+ */
+void CMyDialog3::OnCommandFinished(int nRow, int nFunction, int nStatus)
+{
+    m_functionBar.SetProgress(nRow, nFunction, -1);
+    if (nRow == m_nSelectedRow + 1)
     {
-        m_btnNextPage.SetWindowText(_T(""));
-        m_btnNextPage.EnableWindow(FALSE);
+        m_functionBar.Apply(*this);
     }
-    m_btnNextPage.ShowWindow(SW_SHOW);
+}
 
-    // --- 機能ボタンの表示制御 ---
-    if (m_nCurrentPage == 1) // ページ1の場合
+/**
+ * @brief 現在の選択行とページ状態に基づき、状態が変わったボタンだけを更新します。
+ * @details 望ましい状態はモデルが作り置きのラベル表から求め、ボタンに反映済みの状態と比較して
+ * 変化した項目だけを SetLabel()/SetEnabled()/SetVisible() で反映します。
+ * 行選択が変わっても、同じ内容のラベルや有効/無効の再設定 (ウィンドウメッセージと再描画) は行いません。
+ * @param nPage 表示するページ (0始まり)
+ */
+void CMyDialog3::UpdateButtons(int nPage)
+{
+    // 選択されている行の2列目のテキストが空欄の場合のみ、次ページボタンを有効にします。
+    bool bNextPageEnabled = false;
+    if (m_nSelectedRow != -1)
     {
-        for (int i = 0; i < 8; ++i)
-        {
-            int n = m_nSelectedRow + 1; // 1始まりの行番号
-            int k = i + 1;              // 1から8までの機能インデックス
+        bNextPageEnabled = m_gridCtrl.GetCellText(m_nSelectedRow, 1).IsEmpty();
+    }
 
-            // ラベルを "F(n-k)" の形式で設定します。
-            CString label;
-            label.Format(_T("F(%d-%d)"), n, k);
-            m_btnFunc[i].SetWindowText(label);
+    m_functionBar.Select(m_nSelectedRow + 1, nPage, bNextPageEnabled);
+    m_functionBar.Apply(*this);
+}
 
-            // ボタンウィンドウのユーザーデータ領域に、機能インデックス「k」の値を保存しておきます。
-            // これにより、クリック時にどの機能かを簡単に特定できます。
-            ::SetWindowLongPtr(m_btnFunc[i].GetSafeHwnd(), GWLP_USERDATA, (LONG_PTR)k);
+/**
+ * @brief ファンクションバーのボタン番号に対応するボタンを返します。
+ * @param nButton ボタン番号 (FUNCTION_BUTTON_COUNT は次ページボタン)
+ * @return ボタン
+ */
+CButton &CMyDialog3::GetBarButton(int nButton)
+{
+    return nButton < FUNCTION_BUTTON_COUNT ? m_btnFunc[nButton] : m_btnNextPage;
+}
 
-            m_btnFunc[i].EnableWindow(TRUE);
-            m_btnFunc[i].ShowWindow(SW_SHOW);
-        }
-    }
-    else // ページ2の場合
-    {
-        // 先頭5ボタン (機能インデックス 9-13)
-        for (int i = 0; i < 5; ++i)
-        {
-            int n = m_nSelectedRow + 1;
-            int k = i + 9; // 機能インデックスは9から始まる
+/**
+ * @brief ボタンのラベルを設定します。
+ * @param nButton ボタン番号
+ * @param pszLabel ラベル
+ */
+void CMyDialog3::SetLabel(int nButton, const wchar_t *pszLabel)
+{
+    GetBarButton(nButton).SetWindowText(pszLabel);
+}
 
-            CString label;
-            label.Format(_T("F(%d-%d)"), n, k);
-            m_btnFunc[i].SetWindowText(label);
-            
-            ::SetWindowLongPtr(m_btnFunc[i].GetSafeHwnd(), GWLP_USERDATA, (LONG_PTR)k);
+/**
+ * @brief ボタンの有効/無効を設定します。
+ * @param nButton ボタン番号
+ * @param bEnabled 有効にする場合はtrue
+ */
+void CMyDialog3::SetEnabled(int nButton, bool bEnabled)
+{
+    GetBarButton(nButton).EnableWindow(bEnabled ? TRUE : FALSE);
+}
 
-            m_btnFunc[i].EnableWindow(TRUE);
-            m_btnFunc[i].ShowWindow(SW_SHOW);
-        }
-        // 残り3ボタンは無効化
-        for (int i = 5; i < 8; ++i)
-        {
-            m_btnFunc[i].SetWindowText(_T(""));
-            m_btnFunc[i].EnableWindow(FALSE);
-            m_btnFunc[i].ShowWindow(SW_SHOW);
-        }
-    }
+/**
+ * @brief ボタンの表示/非表示を設定します。
+ * @param nButton ボタン番号
+ * @param bVisible 表示する場合はtrue
+ */
+void CMyDialog3::SetVisible(int nButton, bool bVisible)
+{
+    GetBarButton(nButton).ShowWindow(bVisible ? SW_SHOW : SW_HIDE);
 }
\ No newline at end of file
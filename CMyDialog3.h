@@ -5,18 +5,18 @@
 #pragma once
 #include "afxdialogex.h"
 #include "GridCtrl.h"
-
-/// 親ウィンドウへ機能実行を通知するカスタムメッセージID
-#define WM_EXECUTE_FUNCTION (WM_APP + 5)
+#include "CommandRegistry.h"
+#include "FunctionBarModel.h"
 
 /**
  * @class CMyDialog3
  * @brief グリッドの行選択に応じて動的に機能ボタンが変化するダイアログ
  * @details CGridCtrlの行選択とデータ内容に基づき、8つの機能ボタンと
- * ページ切り替えボタンの状態を動的に更新します。ボタンが押されると、
- * 対応する機能を親ウィンドウに通知します。
+ * ページ切り替えボタンの状態を動的に更新します。ボタンの状態はファンクションバーのモデルで計算し、
+ * 変化した項目だけをボタンに反映します。ボタンが押されると、
+ * 対応する機能を機能の登録表でバックグラウンド実行し、実行中のボタンは無効にして進捗を表示します。
  */
-class CMyDialog3 : public CDialogEx
+class CMyDialog3 : public CDialogEx, public CCommandListener, private CFunctionBarSink
 {
     DECLARE_DYNAMIC(CMyDialog3)
 
@@ -35,6 +35,9 @@ public:
     /// @brief ダイアログデータのリソースID
     enum { IDD = IDD_MyDialog3 };
 
+    /// @brief 1ページあたりの機能ボタン数
+    static const int FUNCTION_BUTTON_COUNT = 8;
+
 protected:
     /**
      * @brief DDX/DDV（ダイアログデータエクスチェンジ/バリデーション）のサポート
@@ -53,21 +56,36 @@ protected:
     /// @brief 表形式カスタムコントロール
     CGridCtrl m_gridCtrl;
     /// @brief 8つの機能ボタン
-    CButton   m_btnFunc[8];
+    CButton   m_btnFunc[FUNCTION_BUTTON_COUNT];
     /// @brief 次ページボタン
     CButton   m_btnNextPage;
 
     // --- 状態管理 ---
     /// @brief 現在選択されている行インデックス (0始まり, -1で非選択)
     int m_nSelectedRow;
-    /// @brief 現在のページ番号 (1 or 2)
-    int m_nCurrentPage;
+    /// @brief 機能ボタン列の状態 (ページ・ラベル表・ボタンに反映済みの状態)
+    CFunctionBarModel m_functionBar;
 
     // --- ヘルパー関数 ---
     /**
-     * @brief 現在の選択行とページ状態に基づき、全ボタンの表示/状態を更新します。
+     * @brief 現在の選択行とページ状態に基づき、状態が変わったボタンだけを更新します。
+     * @param nPage 表示するページ (0始まり)
+     */
+    void UpdateButtons(int nPage);
+
+    /**
+     * @brief ファンクションバーのボタン番号に対応するボタンを返します。
+     * @param nButton ボタン番号 (FUNCTION_BUTTON_COUNT は次ページボタン)
      */
-    void UpdateButtons();
+    CButton &GetBarButton(int nButton);
+
+    // --- CFunctionBarSink ---
+    /// @brief ボタンのラベルを設定します (SetWindowText)。
+    virtual void SetLabel(int nButton, const wchar_t *pszLabel) override;
+    /// @brief ボタンの有効/無効を設定します (EnableWindow)。
+    virtual void SetEnabled(int nButton, bool bEnabled) override;
+    /// @brief ボタンの表示/非表示を設定します (ShowWindow)。
+    virtual void SetVisible(int nButton, bool bVisible) override;
 
     // --- メッセージハンドラ ---
     
@@ -88,6 +106,28 @@ protected:
      * @param nID クリックされたボタンのコントロールID
      */
     afx_msg void OnFuncButtonClicked(UINT nID);
+
+    /**
+     * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
+     * @details 機能のリスナーの登録を解除します。実行中の機能はダイアログを閉じても続行します。
+     */
+    afx_msg void OnDestroy();
+
+    /**
+     * @brief 機能 F(n-k) の進捗通知を受け、表示中のボタンであれば進捗を表示します。
+     * @param nRow 行番号 n
+     * @param nFunction 機能番号 k
+     * @param nPercent 進捗
+     */
+    virtual void OnCommandProgress(int nRow, int nFunction, int nPercent) override;
+
+    /**
+     * @brief 機能 F(n-k) の完了通知を受け、ボタンの状態を更新します。
+     * @param nRow 行番号 n
+     * @param nFunction 機能番号 k
+     * @param nStatus 終了状態 (CCommandRegistry::Status)
+     */
+    virtual void OnCommandFinished(int nRow, int nFunction, int nStatus) override;
     
     /**
      * @brief Enterキーによるダイアログ終了を無効化します。
@@ -95,7 +135,7 @@ protected:
     virtual void OnOK() override;
     
     /**
-     * @brief Escapeキーによるダイアログ終了を無効化します。
+     * @brief Escapeキーによるダイアログ終了を無効化し、選択行の実行中の機能を取り消します。
      * @param pMsg メッセージ情報へのポインタ
      * @return メッセージを処理した場合はTRUE
      */
@@ -3,6 +3,7 @@
  * @brief ソフトウェアキーボードを起動するカスタムエディットコントロールのクラス実装
  */
 #include "pch.h"
+#include "MFCApplication4.h"
 #include "CMyEdit.h"
 #include "SoftwareKeyboardDlg.h" // ソフトウェアキーボードダイアログのヘッダをインクルード
 
@@ -32,8 +33,9 @@ END_MESSAGE_MAP()
 
 /**
  * @brief フォーカスを受け取った際のイベントハンドラ (WM_SETFOCUS)
- * @details このコントロールがフォーカスを得たタイミングで、ソフトウェアキーボードを
- * モーダルダイアログとして表示します。
+ * @details このコントロールがフォーカスを得たタイミングで、共有のソフトウェアキーボードを
+ * モーダルダイアログと同様に表示します。キー入力の後にフォーカスが戻ってきた場合
+ * (キーボードを表示中の場合) は、キーボードを重ねて表示しません。
  * @param[in] pOldWnd フォーカスを失ったウィンドウへのポインタ
  */
 void CMyEdit::OnSetFocus(CWnd *pOldWnd)
@@ -41,13 +43,20 @@ void CMyEdit::OnSetFocus(CWnd *pOldWnd)
     // まず、基底クラスのOnSetFocusを呼び出します。
     CEdit::OnSetFocus(pOldWnd);
 
+    CSoftwareKeyboardDlg &keyboard = theApp.GetSoftwareKeyboard();
+    if (keyboard.IsActive())
+    {
+        return;
+    }
+
     // 1. 編集前の現在のテキストをバックアップとして保存します。
     GetWindowText(m_strOriginalText);
 
-    // 2. ソフトウェアキーボードをモーダルダイアログとして表示します。
-    //    コンストラクタに自身(this)を渡し、どのエディットコントロールへの入力かを伝えます。
-    CSoftwareKeyboardDlg dlg(this);
-    INT_PTR nResponse = dlg.DoModal();
+    // 2. 共有のソフトウェアキーボードを表示し、閉じられるまで待ちます。
+    //    自身(this)を渡し、どのエディットコントロールへの入力かを伝えます。
+    //    入力履歴の名前が設定されていれば、その入力履歴から入力候補を表示します。
+    CInputHistory *pHistory = m_strHistoryKey.IsEmpty() ? nullptr : &theApp.GetInputHistory().GetField((LPCTSTR)m_strHistoryKey);
+    INT_PTR nResponse = keyboard.ShowFor(this, m_eKeyboardLayout, pHistory);
 
     // 3. キーボードが「キャンセル」で閉じられた場合 (Escキーや閉じるボタン)、
     //    テキストをバックアップしておいた元の内容に戻します。
@@ -6,11 +6,13 @@
  */
 #pragma once
 
+#include "KeyboardLayout.h"
+
 /**
  * @class CMyEdit
  * @brief ソフトウェアキーボード起動機能付きエディットコントロール
  * @details このエディットコントロールは、ユーザーがフォーカスを合わせると（クリックするなど）、
- * 自動的に CSoftwareKeyboardDlg をモーダルダイアログとして表示します。
+ * 自動的に共有の CSoftwareKeyboardDlg をモーダルダイアログと同様に表示します。
  * これにより、物理キーボードがない環境でもテキスト入力が可能になります。
  * Escキーなどで入力をキャンセルした場合には、編集前のテキストに復元する機能を持ちます。
  */
@@ -28,7 +30,26 @@ public:
      */
     virtual ~CMyEdit() override;
 
+    /**
+     * @brief フォーカス時に表示するソフトウェアキーボードのレイアウトを設定します。
+     * @param[in] eLayout レイアウト (既定はUS配列)
+     */
+    void SetKeyboardLayout(EKeyboardLayout eLayout) { m_eKeyboardLayout = eLayout; }
+
+    /**
+     * @brief ソフトウェアキーボードの入力候補に使う入力履歴の名前を設定します。
+     * @details 同じ名前の入力欄は同じ入力履歴を共有します。空文字列の場合は入力候補を表示しません。
+     * @param[in] pszKey 入力履歴の名前
+     */
+    void SetHistoryKey(LPCTSTR pszKey) { m_strHistoryKey = pszKey; }
+
 protected:
+    /// @brief フォーカス時に表示するソフトウェアキーボードのレイアウト
+    EKeyboardLayout m_eKeyboardLayout = KEYBOARD_LAYOUT_US;
+
+    /// @brief ソフトウェアキーボードの入力候補に使う入力履歴の名前 (空なら入力候補なし)
+    CString m_strHistoryKey;
+
     /// @brief ソフトウェアキーボード表示前のテキストを保持するメンバ変数（キャンセル時の復元用）
     CString m_strOriginalText;
 
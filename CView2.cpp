@@ -5,6 +5,18 @@
 #include "pch.h"
 #include "MFCApplication4.h"
 #include "CView2.h"
+#include "InputTrace.h"
+#include "PaintMetrics.h"
+#include "ViewCompositor.h"
+
+namespace
+{
+    /// @brief CView2 に配置する子コントロールの宣言
+    const CHILD_CONTROL_DESC s_childControls[] = {
+        { CHILD_CONTROL_CENTER_EDIT, 1004, { 60, 60, 110, 110 }, _T("1234"), 4 },
+        { CHILD_CONTROL_CENTER_EDIT, 1006, { 10, 10, 50, 50 }, _T("5678"), 4 },
+    };
+}
 
 // CView2
 
@@ -17,42 +29,100 @@ IMPLEMENT_DYNCREATE(CView2, CView)
 // BEGIN_MESSAGE_MAPブロック
 // Windowsメッセージと、それを処理するクラスのメンバ関数（ハンドラ）を関連付けます。
 BEGIN_MESSAGE_MAP(CView2, CView)
+    ON_WM_CREATE()
+    ON_WM_DESTROY()
+    ON_MESSAGE(WM_APP_COMPOSE_CHILDREN, &CView2::OnComposeChildren)
+    ON_WM_PAINT()
+    ON_WM_ERASEBKGND()
 END_MESSAGE_MAP()
 
+/**
+ * @brief デフォルトコンストラクタ
+ * @details 子コントロールは初回描画の後に生成します (描画処理の中では生成しません)。
+ */
+CView2::CView2() noexcept
+    : m_composer(s_childControls, _countof(s_childControls), CViewComposer::COMPOSE_AFTER_FIRST_PAINT,
+                 CPaintMetrics::SITE_VIEW2_FIRST_PAINT)
+{
+}
+
+/**
+ * @brief ウィンドウが作成される際に呼び出されます (WM_CREATE)。
+ * @details 初回描画までの時間の計測を開始します。
+ * @param[in] lpCreateStruct ウィンドウの作成パラメータ
+ * @return 作成を続行する場合は0、中止する場合は-1
+ */
+int CView2::OnCreate(LPCREATESTRUCT lpCreateStruct)
+{
+    if (CView::OnCreate(lpCreateStruct) == -1)
+        return -1;
+
+    m_composer.OnCreate(this);
+    return 0;
+}
+
+/**
+ * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
+ * @details 子コントロールを破棄・解放します。
+ */
+void CView2::OnDestroy()
+{
+    m_composer.Destroy();
+    CView::OnDestroy();
+}
+
+/**
+ * @brief カスタムメッセージ WM_APP_COMPOSE_CHILDREN のハンドラ
+ * @details 初回描画の後に投稿され、子コントロールを生成します。
+ * @param wParam 未使用
+ * @param lParam 未使用
+ * @return 常に0
+ */
+LRESULT CView2::OnComposeChildren(WPARAM wParam, LPARAM lParam)
+{
+    m_composer.Compose(this);
+    return 0;
+}
+
+/**
+ * @brief ウィンドウの描画要求を処理します (WM_PAINT)。
+ * @details 合成が設定されていれば、描画の必要な領域のうち見える部分だけをバックバッファで合成して転送します。
+ * 合成できない場合は CView::OnPaint と同じく OnDraw で直接描画します。
+ */
+void CView2::OnPaint()
+{
+    CPaintDC dc(this);
+    if (m_pCompositor != nullptr && m_pCompositor->PaintView(this, &dc, dc.m_ps.rcPaint))
+        return;
+    OnPrepareDC(&dc);
+    OnDraw(&dc);
+}
+
+/**
+ * @brief 背景の消去要求を処理します (WM_ERASEBKGND)。
+ * @details 合成が設定されていれば背景は合成で塗りつぶすため、ここでは消去しません。
+ * @param[in] pDC 描画に使用するデバイスコンテキストへのポインタ。
+ * @return 背景を消去した (または不要な) 場合は0以外
+ */
+BOOL CView2::OnEraseBkgnd(CDC *pDC)
+{
+    if (m_pCompositor != nullptr)
+        return TRUE;
+    return CView::OnEraseBkgnd(pDC);
+}
 
 /**
  * @brief ビューの描画処理を行います (WM_PAINT)。
- * @details この実装では、初回描画時に子コントロールであるCCenterEditを動的に生成・配置します。
- * OnDrawは再描画のたびに呼び出されるため、ポインタがnullptrであるかを確認することで、
- * コントロールが一度だけ生成されるようにしています。
+ * @details 背景は合成 (または既定の背景の消去) で塗りつぶします。初回描画の後に子コントロールの生成を要求します
+ * (描画処理の中ではウィンドウを生成しません)。
  * @param[in] pDC 描画に使用するデバイスコンテキストへのポインタ。
  */
 void CView2::OnDraw(CDC *pDC)
 {
-    // m_editCustom1がまだ生成されていなければ、ここで生成する
-    if (m_editCustom1 == nullptr)
-    {
-        m_editCustom1 = new CCenterEdit();
-        CRect rect1(60, 60, 110, 110); // ビュー内の位置とサイズを指定
-        m_editCustom1->Create(WS_CHILD | WS_VISIBLE, rect1, this, 1004);
-        m_editCustom1->ShowWindow(TRUE);
-        m_editCustom1->SetWindowTextW(_T("1234")); // 初期値を設定
-        m_editCustom1->SetFont(GetFont());         // 親と同じフォントを設定
-        m_editCustom1->SetLimitText(4);            // 入力文字数を4文字に制限
-        m_editCustom1->SetWindowPos(nullptr, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE);
-    }
-    // m_editCustom2がまだ生成されていなければ、ここで生成する
-    if (m_editCustom2 == nullptr)
-    {
-        m_editCustom2 = new CCenterEdit();
-        CRect rect1(10, 10, 50, 50); // ビュー内の位置とサイズを指定
-        m_editCustom2->Create(WS_CHILD | WS_VISIBLE, rect1, this, 1006);
-        m_editCustom2->ShowWindow(TRUE);
-        m_editCustom2->SetWindowTextW(_T("5678")); // 初期値を設定
-        m_editCustom2->SetFont(GetFont());         // 親と同じフォントを設定
-        m_editCustom2->SetLimitText(4);            // 入力文字数を4文字に制限
-        m_editCustom2->SetWindowPos(nullptr, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE);
-    }
+    CInputTraceScope trace("CView2::OnDraw", true);
+    CPaintMetricsScope metrics(CPaintMetrics::SITE_VIEW2_DRAW);
+
+    m_composer.OnDrawFinished(this);
 }
 
 
@@ -68,11 +138,9 @@ BOOL CView2::PreCreateWindow(CREATESTRUCT &cs)
     if (!CView::PreCreateWindow(cs))
         return FALSE;
 
-    // WS_CLIPSIBLINGS スタイルをビット演算で削除します。
-    // このスタイルがあると、兄弟ウィンドウ(CView1)と重なる領域は描画されません。
-    // このスタイルを削除することで、CView1の上にCView2が重なって表示される場合に、
-    // CView1の描画がCView2によってクリッピング（切り抜かれ）されるのを防ぎます。
-    cs.style &= ~WS_CLIPSIBLINGS;
+    // WS_CLIPSIBLINGS を付け、兄弟ウィンドウ(CView1)と重なる部分には描画しません。
+    // 重なる部分の扱いは合成 (CViewCompositor) とウィンドウリージョンで決めます。
+    cs.style |= WS_CLIPSIBLINGS;
 
     return TRUE;
 }
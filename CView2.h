@@ -6,13 +6,17 @@
  */
 #pragma once
 
-#include "CenterEdit.h"
+#include "ViewComposer.h"
+
+class CViewCompositor;
 
 /**
  * @class CView2
  * @brief CView1の上に重ねて表示されるカスタムビュー
- * @details CViewを継承し、内部にCCenterEditコントロールを動的に配置します。
- * ウィンドウ作成時にスタイルを調整し、兄弟ウィンドウとの描画の重なり方を制御します。
+ * @details CViewを継承し、内部にCCenterEditコントロールを配置します。
+ * 子コントロールは宣言の表から CViewComposer が生成・所有します。条件Aの成立で表示されるビューのため、
+ * 初回描画を先に済ませ、子コントロールは初回描画の後に生成します。
+ * 描画はメインダイアログの CViewCompositor を経由し、CView1 に隠れない部分だけを行います。
  */
 class CView2 : public CView
 {
@@ -23,10 +27,8 @@ protected:
      */
     DECLARE_DYNCREATE(CView2)
     
-    /// @brief ビュー内に配置されるカスタムエディットコントロールへのポインタ1
-    CCenterEdit *m_editCustom1 = nullptr;
-    /// @brief ビュー内に配置されるカスタムエディットコントロールへのポインタ2
-    CCenterEdit *m_editCustom2 = nullptr;
+    /// @brief ビュー内に配置する子コントロールの生成と所有 (初回描画の後に生成)
+    CViewComposer m_composer;
 
     // 属性
 public:
@@ -36,7 +38,7 @@ public:
 public:
     /**
      * @brief ビューの描画処理を行います (WM_PAINT)。
-     * @details この実装では、初回描画時に子コントロールであるCCenterEditを動的に生成・配置します。
+     * @details 初回描画の後に子コントロールの生成を要求します (描画処理の中ではウィンドウを生成しません)。
      * @param[in] pDC 描画に使用するデバイスコンテキストへのポインタ。
      */
     virtual void OnDraw(CDC *pDC) override;
@@ -54,13 +56,20 @@ public:
     /**
      * @brief デフォルトコンストラクタ
      */
-    CView2() noexcept = default;
+    CView2() noexcept;
 
     /**
      * @brief デストラクタ
-     * @details 動的に確保したコントロールは、親ウィンドウが破棄される際に自動的にクリーンアップされます。
+     * @details 子コントロールは OnDestroy で破棄し、m_composer が解放します。
      */
     virtual ~CView2() noexcept override = default;
+
+    /**
+     * @brief 重なったビューの合成を設定します。
+     * @details 設定すると、描画はバックバッファでの合成を経由し (背景も消去しません)、見える部分だけを描画します。
+     * @param[in] pCompositor 合成 (nullptrなら直接描画します)
+     */
+    void SetCompositor(CViewCompositor *pCompositor) { m_pCompositor = pCompositor; }
 #ifdef _DEBUG
     /**
      * @brief オブジェクトの有効性を診断します (デバッグビルドのみ)。
@@ -75,6 +84,46 @@ public:
 #endif
 
 protected:
+    /// @brief 重なったビューの合成 (メインダイアログが所有、nullptrなら直接描画)
+    CViewCompositor *m_pCompositor = nullptr;
+
+    /**
+     * @brief ウィンドウが作成される際に呼び出されます (WM_CREATE)。
+     * @details 初回描画までの時間の計測を開始します。
+     * @param[in] lpCreateStruct ウィンドウの作成パラメータ
+     * @return 作成を続行する場合は0、中止する場合は-1
+     */
+    afx_msg int OnCreate(LPCREATESTRUCT lpCreateStruct);
+
+    /**
+     * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
+     * @details 子コントロールを破棄・解放します。
+     */
+    afx_msg void OnDestroy();
+
+    /**
+     * @brief カスタムメッセージ WM_APP_COMPOSE_CHILDREN のハンドラ
+     * @details 初回描画の後に投稿され、子コントロールを生成します。
+     * @param wParam 未使用
+     * @param lParam 未使用
+     * @return 常に0
+     */
+    afx_msg LRESULT OnComposeChildren(WPARAM wParam, LPARAM lParam);
+
+    /**
+     * @brief ウィンドウの描画要求を処理します (WM_PAINT)。
+     * @details 合成が設定されていれば、合成を経由して見える部分だけを描画します。そうでなければ OnDraw で直接描画します。
+     */
+    afx_msg void OnPaint();
+
+    /**
+     * @brief 背景の消去要求を処理します (WM_ERASEBKGND)。
+     * @details 合成が設定されていれば、背景は合成で塗りつぶすため消去しません (ちらつき防止)。
+     * @param[in] pDC 描画に使用するデバイスコンテキストへのポインタ。
+     * @return 背景を消去した (または不要な) 場合は0以外
+     */
+    afx_msg BOOL OnEraseBkgnd(CDC *pDC);
+
     /// @brief メッセージマップを宣言します。
     DECLARE_MESSAGE_MAP()
 };
\ No newline at end of file
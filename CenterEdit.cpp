@@ -3,13 +3,32 @@
  * @brief 多機能カスタムエディットコントロールのクラス実装
  */
 #include "pch.h"
+#include "MFCApplication4.h"
 #include "CenterEdit.h"
 #include "SoftwareKeyboardDlg.h"
+#include "PaintMetrics.h"
+#include "GdiResourceCache.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+namespace
+{
+    /**
+     * @brief ウィンドウのDPIを返します。
+     * @details GetDpiForWindow がない古いWindowsでは0 (不明) を返します。関数の解決は最初の呼び出しで一度だけ行います。
+     * @param[in] hWnd ウィンドウハンドル
+     */
+    UINT GetWindowDpi(HWND hWnd)
+    {
+        using GetDpiForWindowFunc = UINT(WINAPI *)(HWND);
+        static const GetDpiForWindowFunc s_pfnGetDpiForWindow = reinterpret_cast<GetDpiForWindowFunc>(
+            ::GetProcAddress(::GetModuleHandle(_T("user32.dll")), "GetDpiForWindow"));
+        return s_pfnGetDpiForWindow != nullptr ? s_pfnGetDpiForWindow(hWnd) : 0;
+    }
+}
+
 // CCenterEdit
 
 // CCenterEditクラスが動的生成可能であることをフレームワークに伝えます。
@@ -18,22 +37,27 @@ IMPLEMENT_DYNAMIC(CCenterEdit, CEdit)
 /**
  * @brief CCenterEditクラスのコンストラクタ
  * @details フォーカス時と非フォーカス時の背景ブラシ、文字色を初期化します。
+ * ブラシはインスタンスごとに生成せず、GDIオブジェクトのキャッシュから保持して全インスタンスで共有します。
  */
 CCenterEdit::CCenterEdit()
 {
     // ブラシと色の初期化
-    m_brushFocus.CreateSolidBrush(RGB(255, 255, 0));   // 黄色
-    m_brushNoFocus.CreateSolidBrush(RGB(0, 255, 255)); // シアン色
+    m_colorBkFocus = RGB(255, 255, 0);                 // 黄色
+    m_colorBkNoFocus = RGB(0, 255, 255);               // シアン色
+    m_hBrushFocus = reinterpret_cast<HBRUSH>(CGdiResourceCache::Acquire(GDI_RESOURCE_KEY::SolidBrush(m_colorBkFocus)));
+    m_hBrushNoFocus = reinterpret_cast<HBRUSH>(CGdiResourceCache::Acquire(GDI_RESOURCE_KEY::SolidBrush(m_colorBkNoFocus)));
     m_colorTextFocus = RGB(255, 0, 0);                 // 赤色
     m_colorTextNoFocus = RGB(0, 0, 0);                 // 黒色
 }
 
 /**
  * @brief CCenterEditクラスのデストラクタ
- * @details CBrushオブジェクトはメンバ変数であるため、自動的に破棄されます。
+ * @details 保持していたブラシをキャッシュに返します (ブラシ自体はキャッシュが再利用します)。
  */
 CCenterEdit::~CCenterEdit()
 {
+    CGdiResourceCache::Release(reinterpret_cast<std::uintptr_t>(m_hBrushFocus));
+    CGdiResourceCache::Release(reinterpret_cast<std::uintptr_t>(m_hBrushNoFocus));
 }
 
 // BEGIN_MESSAGE_MAPブロック
@@ -42,9 +66,11 @@ BEGIN_MESSAGE_MAP(CCenterEdit, CEdit)
     ON_WM_CTLCOLOR_REFLECT()
     ON_WM_SETFOCUS()
     ON_WM_KILLFOCUS()
+    ON_WM_CHAR()
     ON_WM_SIZE()
     ON_CONTROL_REFLECT(EN_CHANGE, &CCenterEdit::OnEnChange)
     ON_MESSAGE(WM_APP_POST_INIT, &CCenterEdit::OnPostInit)
+    ON_MESSAGE(WM_SETFONT, &CCenterEdit::OnSetFontMessage)
 END_MESSAGE_MAP()
 
 // CCenterEdit メッセージ ハンドラー
@@ -58,8 +84,25 @@ void CCenterEdit::PreSubclassWindow()
     CEdit::PreSubclassWindow();
     // テキストを右揃えにし、複数行を扱えるようにスタイルを変更します。
     ModifyStyle(0, ES_RIGHT | ES_MULTILINE, 0);
-    // 入力文字数を4文字に制限します。
-    SetLimitText(4);
+    // 入力文字数を4文字 (数値入力欄ではその最大文字数) に制限します。
+    SetLimitText(m_bNumericField ? m_numericField.GetParams().nMaxLength : 4);
+}
+
+/**
+ * @brief この入力欄を数値入力欄として宣言します。
+ * @details ウィンドウの生成後に呼び出した場合は、最大文字数もここで設定し直します。
+ * 範囲が最大文字数で書けない値を含む場合は、書ける範囲に狭めてデバッグ出力に報告します。
+ * @param[in] params 数値入力欄の種類
+ */
+void CCenterEdit::SetNumericField(const CNumericField::Params &params)
+{
+    if (!m_numericField.SetParams(params))
+        TRACE(_T("数値入力欄の範囲 (%g～%g) を最大文字数 %d で書ける範囲 (%g～%g) に狭めました\n"), params.dMin, params.dMax,
+              params.nMaxLength, m_numericField.GetMin(), m_numericField.GetMax());
+    m_bNumericField = true;
+    m_eKeyboardLayout = KEYBOARD_LAYOUT_KEYPAD;
+    if (GetSafeHwnd() != nullptr)
+        SetLimitText(params.nMaxLength);
 }
 
 /**
@@ -82,18 +125,28 @@ BOOL CCenterEdit::PreTranslateMessage(MSG* pMsg)
 
 /**
  * @brief フォーカスを受け取った際のイベントハンドラ (WM_SETFOCUS)
- * @details ソフトウェアキーボードをモーダルで起動します。
+ * @details 共有のソフトウェアキーボードをモーダルと同様に表示します。
+ * キー入力の後にフォーカスが戻ってきた場合 (キーボードを表示中の場合) は、キーボードを重ねて表示しません。
  * @param[in] pOldWnd フォーカスを失ったウィンドウへのポインタ
  */
 void CCenterEdit::OnSetFocus(CWnd* pOldWnd)
 {
     CEdit::OnSetFocus(pOldWnd);
+
+    CSoftwareKeyboardDlg& keyboard = theApp.GetSoftwareKeyboard();
+    if (keyboard.IsActive())
+    {
+        Invalidate();
+        return;
+    }
+
     // 編集前のテキストをバックアップ
     GetWindowText(m_strOriginalText);
 
-    // ソフトウェアキーボードダイアログをモーダルで表示
-    CSoftwareKeyboardDlg dlg(this);
-    INT_PTR nResponse = dlg.DoModal();
+    // 共有のソフトウェアキーボードを表示し、閉じられるまで待つ
+    // (入力履歴の名前があれば入力候補を表示し、数値入力欄であれば入力規則を適用する)
+    CInputHistory* pHistory = m_strHistoryKey.IsEmpty() ? nullptr : &theApp.GetInputHistory().GetField((LPCTSTR)m_strHistoryKey);
+    INT_PTR nResponse = keyboard.ShowFor(this, m_eKeyboardLayout, pHistory, m_bNumericField ? &m_numericField : nullptr);
 
     // キャンセルされた場合はテキストを元に戻す
     if (nResponse == IDCANCEL)
@@ -121,6 +174,33 @@ void CCenterEdit::OnKillFocus(CWnd* pNewWnd)
     Invalidate();
 }
 
+/**
+ * @brief 文字が入力された際のイベントハンドラ (WM_CHAR)
+ * @details 数値入力欄では、現在の文字列と選択範囲に文字を入力した結果が入力規則を満たす場合だけ、
+ * 通常の処理に渡します。制御文字 (BackSpace など) はそのまま通常の処理に渡します。
+ * @param nChar 文字コード
+ * @param nRepCnt リピート回数
+ * @param nFlags キーのフラグ
+ */
+void CCenterEdit::OnChar(UINT nChar, UINT nRepCnt, UINT nFlags)
+{
+    if (m_bNumericField && nChar >= 0x20)
+    {
+        CString strText;
+        GetWindowText(strText);
+        std::wstring text(static_cast<LPCTSTR>(strText));
+        int nSelStart = 0;
+        int nSelEnd = 0;
+        GetSel(nSelStart, nSelEnd);
+        if (!m_numericField.InsertChar(static_cast<wchar_t>(nChar), text, nSelStart, nSelEnd))
+        {
+            MessageBeep(MB_OK);
+            return;
+        }
+    }
+    CEdit::OnChar(nChar, nRepCnt, nFlags);
+}
+
 /**
  * @brief テキストが変更された際のイベントハンドラ (EN_CHANGE)
  * @details テキストが変更されるたびに、垂直中央揃えを再計算します。
@@ -135,9 +215,14 @@ void CCenterEdit::OnEnChange()
  * @brief テキストの垂直位置を更新するヘルパー関数
  * @details コントロールの現在の高さとフォントサイズから、テキストが垂直方向に
  * 中央揃えになるように内部の描画矩形を調整します。
+ * フォントの高さはプロセス共通のキャッシュ (フォントハンドルとDPIごと) から取得し、DCは最初の1回しか取得しません。
+ * クライアント領域・フォント・DPIが前回と同じ場合 (キー入力ごとの EN_CHANGE) や、求めた矩形が設定済みのものと
+ * 同じ場合は SetRect を呼び出さず、エディットコントロールの再レイアウトを起こしません。
  */
 void CCenterEdit::UpdateTextPosition()
 {
+    CPaintMetricsScope metrics(CPaintMetrics::SITE_CENTEREDIT_TEXTPOS);
+
     CRect rectClient;
     GetClientRect(&rectClient);
 
@@ -146,29 +231,15 @@ void CCenterEdit::UpdateTextPosition()
         return;
     }
 
-    // デバイスコンテキストを取得してフォントの高さを測定
-    CDC* pDC = GetDC();
-    if (pDC)
+    CFont* pFont = GetFont();
+    const std::uintptr_t hFont = reinterpret_cast<std::uintptr_t>(pFont != nullptr ? pFont->GetSafeHandle() : nullptr);
+    CCenteredTextLayout::FORMAT_RECT format;
+    if (m_textLayout.Update(rectClient.Width(), rectClient.Height(), hFont, GetWindowDpi(GetSafeHwnd()), format))
     {
-        CFont* pFont = GetFont();
-        CFont* pOldFont = pDC->SelectObject(pFont);
-        TEXTMETRIC tm;
-        pDC->GetTextMetrics(&tm);
-        pDC->SelectObject(pOldFont);
-        ReleaseDC(pDC);
-
-        // 上マージンを計算して、テキストが垂直方向の中央に来るようにする
-        int topMargin = (rectClient.Height() - tm.tmHeight) / 2;
-        if (topMargin < 0)
-        {
-            topMargin = 0;
-        }
-
-        // 新しい描画矩形を設定
-        CRect rectFormat = rectClient;
-        rectFormat.top = topMargin;
-        
+        // 上マージンを空けた新しい描画矩形を設定
+        CRect rectFormat(format.left, format.top, format.right, format.bottom);
         SetRect(&rectFormat);
+        metrics.AddItems(1);
     }
 }
 
@@ -183,6 +254,8 @@ void CCenterEdit::UpdateTextPosition()
 void CCenterEdit::OnSize(UINT nType, int cx, int cy)
 {
     CEdit::OnSize(nType, cx, cy);
+    // エディットコントロールはサイズ変更時に書式矩形を戻すため、設定し直す
+    m_textLayout.Invalidate();
     // 初めてウィンドウサイズが確定したタイミングを捉える
     if (m_bIsFirstTimeInit && cx > 0 && cy > 0)
     {
@@ -205,11 +278,27 @@ void CCenterEdit::OnSize(UINT nType, int cx, int cy)
  */
 LRESULT CCenterEdit::OnPostInit(WPARAM wParam, LPARAM lParam)
 {
+    m_textLayout.Invalidate();
     UpdateTextPosition();
     Invalidate();
     return 0;
 }
 
+/**
+ * @brief フォントが設定された際のハンドラ (WM_SETFONT)
+ * @details 既定の処理でエディットコントロールが書式矩形を戻すため、その後に設定し直します。
+ * @param wParam フォントハンドル
+ * @param lParam 再描画するか
+ * @return 既定の処理の戻り値
+ */
+LRESULT CCenterEdit::OnSetFontMessage(WPARAM wParam, LPARAM lParam)
+{
+    LRESULT lResult = Default();
+    m_textLayout.Invalidate();
+    UpdateTextPosition();
+    return lResult;
+}
+
 /**
  * @brief コントロールの描画色を設定するためのリフレクトメッセージハンドラ (WM_CTLCOLOR_REFLECT)
  * @details フォーカスの有無に応じて、背景ブラシと文字色を返します。
@@ -227,20 +316,16 @@ HBRUSH CCenterEdit::CtlColor(CDC* pDC, UINT nCtlColor)
     if (bHasFocus)
     {
         // フォーカス用の背景色と文字色を設定
-        LOGBRUSH LogBrush;
-        m_brushFocus.GetLogBrush(&LogBrush);
-        pDC->SetBkColor(LogBrush.lbColor);
+        pDC->SetBkColor(m_colorBkFocus);
         pDC->SetTextColor(m_colorTextFocus);
-        return (HBRUSH)m_brushFocus.GetSafeHandle();
+        return m_hBrushFocus;
     }
     // フォーカスがない場合
     else
     {
         // 非フォーカス用の背景色と文字色を設定
-        LOGBRUSH LogBrush;
-        m_brushNoFocus.GetLogBrush(&LogBrush);
-        pDC->SetBkColor(LogBrush.lbColor);
+        pDC->SetBkColor(m_colorBkNoFocus);
         pDC->SetTextColor(m_colorTextNoFocus);
-        return (HBRUSH)m_brushNoFocus.GetSafeHandle();
+        return m_hBrushNoFocus;
     }
 }
\ No newline at end of file
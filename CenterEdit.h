@@ -7,6 +7,10 @@
  */
 #pragma once
 
+#include "KeyboardLayout.h"
+#include "NumericField.h"
+#include "FontMetricsCache.h"
+
 /// @brief 初回表示のタイミングでテキスト位置を最終調整するためのカスタムメッセージ
 #define WM_APP_POST_INIT (WM_APP + 1)
 
@@ -16,8 +20,9 @@
  * @details CEditを継承し、以下の機能を提供します。
  * - テキストを垂直方向および水平方向（右揃え）に中央揃えで表示します。
  * - フォーカスを持っているときと失ったときで、背景色と文字色が変わります。
- * - フォーカスを受け取ると、ソフトウェアキーボードをモーダルで表示します。
+ * - フォーカスを受け取ると、共有のソフトウェアキーボードをモーダルと同様に表示します。
  * - コントロールのサイズが変更されても、テキストの中央揃えを維持します。
+ * - 数値入力欄として宣言すると、数値入力欄用キーパッドを表示し、桁数と数値の書式を入力中に強制します。
  */
 class CCenterEdit : public CEdit
 {
@@ -34,6 +39,27 @@ public:
      */
     virtual ~CCenterEdit() override;
 
+    /**
+     * @brief フォーカス時に表示するソフトウェアキーボードのレイアウトを設定します。
+     * @param[in] eLayout レイアウト (既定はUS配列)
+     */
+    void SetKeyboardLayout(EKeyboardLayout eLayout) { m_eKeyboardLayout = eLayout; }
+
+    /**
+     * @brief ソフトウェアキーボードの入力候補に使う入力履歴の名前を設定します。
+     * @details 同じ名前の入力欄は同じ入力履歴を共有します。空文字列の場合は入力候補を表示しません。
+     * @param[in] pszKey 入力履歴の名前
+     */
+    void SetHistoryKey(LPCTSTR pszKey) { m_strHistoryKey = pszKey; }
+
+    /**
+     * @brief この入力欄を数値入力欄として宣言します。
+     * @details ソフトウェアキーボードは数値入力欄用キーパッドになり、ソフトウェアキーボード・物理キーボードとも
+     * 最大文字数と数値の書式を満たす入力だけを受け付けます。Enterキーで確定する際に値を範囲に収めます。
+     * @param[in] params 数値入力欄の種類 (桁数・小数部・符号・刻み幅・範囲)
+     */
+    void SetNumericField(const CNumericField::Params &params);
+
     // オーバーライド
 protected:
     /**
@@ -52,10 +78,14 @@ protected:
 
     // メンバ変数
 protected:
-    /// @brief フォーカス時の背景ブラシ
-    CBrush m_brushFocus;
-    /// @brief 非フォーカス時の背景ブラシ
-    CBrush m_brushNoFocus;
+    /// @brief フォーカス時の背景色
+    COLORREF m_colorBkFocus;
+    /// @brief 非フォーカス時の背景色
+    COLORREF m_colorBkNoFocus;
+    /// @brief フォーカス時の背景ブラシ (CGdiResourceCache で保持し、同じ色の全インスタンスで共有)
+    HBRUSH m_hBrushFocus;
+    /// @brief 非フォーカス時の背景ブラシ (CGdiResourceCache で保持し、同じ色の全インスタンスで共有)
+    HBRUSH m_hBrushNoFocus;
     /// @brief フォーカス時の文字色
     COLORREF m_colorTextFocus;
     /// @brief 非フォーカス時の文字色
@@ -64,6 +94,16 @@ protected:
     bool m_bIsFirstTimeInit = true;
     /// @brief ソフトウェアキーボード表示前のテキスト（キャンセル時の復元用）
     CString m_strOriginalText;
+    /// @brief フォーカス時に表示するソフトウェアキーボードのレイアウト
+    EKeyboardLayout m_eKeyboardLayout = KEYBOARD_LAYOUT_US;
+    /// @brief ソフトウェアキーボードの入力候補に使う入力履歴の名前 (空なら入力候補なし)
+    CString m_strHistoryKey;
+    /// @brief 数値入力欄の入力規則 (m_bNumericField がtrueの場合のみ有効)
+    CNumericField m_numericField;
+    /// @brief 数値入力欄として宣言されているか
+    bool m_bNumericField = false;
+    /// @brief 垂直中央揃えの書式矩形 (クライアント領域とフォントが変わった場合だけ計算し直します)
+    CCenteredTextLayout m_textLayout;
 
     // 実装
 protected:
@@ -71,6 +111,7 @@ protected:
      * @brief テキストの垂直位置を更新するヘルパー関数
      * @details コントロールの現在の高さとフォントサイズから、テキストが垂直方向に
      * 中央揃えになるように内部の描画矩形を調整します。
+     * クライアント領域とフォントが前回と同じであれば、DCの取得も書式矩形の設定も行いません。
      */
     void UpdateTextPosition();
 
@@ -98,6 +139,15 @@ protected:
      * @param[in] pNewWnd 新しくフォーカスを受け取るウィンドウへのポインタ
      */
     afx_msg void OnKillFocus(CWnd* pNewWnd);
+
+    /**
+     * @brief 文字が入力された際のイベントハンドラ (WM_CHAR)
+     * @details 数値入力欄では、入力規則を満たさない文字を捨てます。
+     * @param nChar 文字コード
+     * @param nRepCnt リピート回数
+     * @param nFlags キーのフラグ
+     */
+    afx_msg void OnChar(UINT nChar, UINT nRepCnt, UINT nFlags);
     
     /**
      * @brief コントロールのサイズが変更された際のイベントハンドラ (WM_SIZE)
@@ -121,6 +171,15 @@ protected:
      */
     afx_msg LRESULT OnPostInit(WPARAM wParam, LPARAM lParam);
 
+    /**
+     * @brief フォントが設定された際のハンドラ (WM_SETFONT)
+     * @details エディットコントロールは書式矩形を戻すため、次の更新で設定し直します。
+     * @param wParam フォントハンドル
+     * @param lParam 再描画するか
+     * @return 既定の処理の戻り値
+     */
+    afx_msg LRESULT OnSetFontMessage(WPARAM wParam, LPARAM lParam);
+
     /// @brief メッセージマップを宣言します。
     DECLARE_MESSAGE_MAP()
 };
\ No newline at end of file
@@ -0,0 +1,244 @@
+﻿/**
+ * @file CommandRegistry.cpp
+ * @brief 機能 F(n-k) の登録表とバックグラウンド実行の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "CommandRegistry.h"
+
+#include <algorithm>
+
+/**
+ * @brief 進捗を報告します。
+ * @details 最新の値だけを保持し、UIスレッドへの投稿は前回の投稿が処理されるまで行いません。
+ */
+void CCommandContext::ReportProgress(int nPercent)
+{
+    m_nProgress.store((std::max)(0, (std::min)(100, nPercent)), std::memory_order_relaxed);
+    if (!m_bProgressPosted.exchange(true, std::memory_order_acq_rel))
+        m_registry.PostProgress(*this);
+}
+
+/**
+ * @brief CCommandRegistryクラスのコンストラクタ
+ */
+CCommandRegistry::CCommandRegistry(CTaskScheduler &scheduler, int nRows, int nFunctions)
+    : m_scheduler(scheduler), m_nRows((std::max)(0, nRows)), m_nFunctions((std::max)(0, nFunctions)),
+      m_table(static_cast<std::size_t>(m_nRows) * m_nFunctions),
+      m_running(static_cast<std::size_t>(m_nRows) * m_nFunctions), m_nBusy(0)
+{
+}
+
+/**
+ * @brief 表の添字を返します。
+ */
+int CCommandRegistry::IndexOf(int nRow, int nFunction) const
+{
+    if (nRow < 1 || nRow > m_nRows || nFunction < 1 || nFunction > m_nFunctions)
+        return -1;
+    return (nRow - 1) * m_nFunctions + (nFunction - 1);
+}
+
+/**
+ * @brief 機能 F(n-k) の本体を登録します。
+ */
+bool CCommandRegistry::Register(int nRow, int nFunction, Body body)
+{
+    const int nIndex = IndexOf(nRow, nFunction);
+    if (nIndex < 0)
+        return false;
+    m_table[nIndex] = body ? std::make_shared<const Body>(std::move(body)) : nullptr;
+    return true;
+}
+
+/**
+ * @brief 全ての行の機能 k に同じ本体を登録します。
+ * @details 全ての行で1つの本体を共有します。
+ */
+bool CCommandRegistry::RegisterFunction(int nFunction, Body body)
+{
+    if (nFunction < 1 || nFunction > m_nFunctions)
+        return false;
+    const std::shared_ptr<const Body> pBody = body ? std::make_shared<const Body>(std::move(body)) : nullptr;
+    for (int nRow = 1; nRow <= m_nRows; ++nRow)
+        m_table[IndexOf(nRow, nFunction)] = pBody;
+    return true;
+}
+
+/**
+ * @brief 機能 F(n-k) が登録されているかを返します。
+ */
+bool CCommandRegistry::IsDefined(int nRow, int nFunction) const
+{
+    const int nIndex = IndexOf(nRow, nFunction);
+    return nIndex >= 0 && m_table[nIndex] != nullptr;
+}
+
+/**
+ * @brief 機能 F(n-k) が実行中かを返します。
+ */
+bool CCommandRegistry::IsBusy(int nRow, int nFunction) const
+{
+    const int nIndex = IndexOf(nRow, nFunction);
+    return nIndex >= 0 && m_running[nIndex] != nullptr;
+}
+
+/**
+ * @brief 機能 F(n-k) をワーカーで実行します。
+ * @details 本体の戻り値・例外・取り消しの状態から終了状態を決め、UIスレッドで Finish() を呼び出します。
+ * 取り消しはトークンで伝えるため、本体が始まる前に取り消された場合は本体を呼び出しません
+ * (その場合もUIスレッドでの終了処理は必ず行います)。
+ * UIスレッドへ投稿できなかった終了は m_unposted に預け、FinishUnposted() で処理します。
+ * 預けられたままの終了があれば、開始前にここで処理します。
+ */
+bool CCommandRegistry::Execute(int nRow, int nFunction)
+{
+    FinishUnposted();
+    const int nIndex = IndexOf(nRow, nFunction);
+    if (nIndex < 0 || !m_table[nIndex] || m_running[nIndex])
+        return false;
+
+    auto pRun = std::make_shared<Run>();
+    pRun->pContext.reset(new CCommandContext(*this, nRow, nFunction, pRun->cancel.GetToken()));
+    const std::shared_ptr<const Body> pBody = m_table[nIndex];
+
+    const bool bSubmitted = m_scheduler.Submit([this, nIndex, pRun, pBody]() {
+        Status status = STATUS_CANCELLED;
+        if (!pRun->cancel.IsCancelled())
+        {
+            try
+            {
+                status = (*pBody)(*pRun->pContext) ? STATUS_COMPLETED : STATUS_FAILED;
+            }
+            catch (...)
+            {
+                status = STATUS_FAILED;
+            }
+            if (pRun->cancel.IsCancelled())
+                status = STATUS_CANCELLED;
+        }
+        if (!m_scheduler.PostToUi([this, nIndex, pRun, status]() { Finish(nIndex, pRun, status); }))
+        {
+            std::lock_guard<std::mutex> lock(m_unpostedMutex);
+            m_unposted.push_back(Unposted{nIndex, pRun, status});
+        }
+    });
+    if (!bSubmitted)
+        return false;
+
+    m_running[nIndex] = pRun;
+    ++m_nBusy;
+    return true;
+}
+
+/**
+ * @brief 実行中の機能 F(n-k) に取り消しを要求します。
+ */
+bool CCommandRegistry::Cancel(int nRow, int nFunction)
+{
+    const int nIndex = IndexOf(nRow, nFunction);
+    if (nIndex < 0 || !m_running[nIndex])
+        return false;
+    m_running[nIndex]->cancel.Cancel();
+    return true;
+}
+
+/**
+ * @brief 実行中の全ての機能に取り消しを要求します。
+ */
+void CCommandRegistry::CancelAll()
+{
+    for (const auto &pRun : m_running)
+    {
+        if (pRun)
+            pRun->cancel.Cancel();
+    }
+}
+
+/**
+ * @brief UIスレッドへ投稿できなかった終了処理を実行します。
+ * @details 預けられた終了を取り出してからロックを外して Finish() を呼び出すため、通知の中から Execute() を呼び出せます。
+ */
+int CCommandRegistry::FinishUnposted()
+{
+    std::vector<Unposted> unposted;
+    {
+        std::lock_guard<std::mutex> lock(m_unpostedMutex);
+        if (m_unposted.empty())
+            return 0;
+        unposted.swap(m_unposted);
+    }
+    for (const Unposted &item : unposted)
+        Finish(item.nIndex, item.pRun, item.status);
+    return static_cast<int>(unposted.size());
+}
+
+/**
+ * @brief リスナーを登録します。
+ */
+void CCommandRegistry::AddListener(CCommandListener *pListener)
+{
+    if (pListener != nullptr && std::find(m_listeners.begin(), m_listeners.end(), pListener) == m_listeners.end())
+        m_listeners.push_back(pListener);
+}
+
+/**
+ * @brief リスナーの登録を解除します。
+ */
+void CCommandRegistry::RemoveListener(CCommandListener *pListener)
+{
+    m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), pListener), m_listeners.end());
+}
+
+/**
+ * @brief リスナーが登録されているかを返します。
+ */
+bool CCommandRegistry::IsListening(CCommandListener *pListener) const
+{
+    return std::find(m_listeners.begin(), m_listeners.end(), pListener) != m_listeners.end();
+}
+
+/**
+ * @brief 進捗をUIスレッドへ届けます。
+ * @details UIスレッドでは、その実行が終了済みでないこと (実行中の表の内容が同じ文脈であること) を確認してから、
+ * 投稿済みの印を下ろして最新の値を通知します。終了後に届いた進捗は捨てます。
+ */
+void CCommandRegistry::PostProgress(CCommandContext &context)
+{
+    const int nIndex = IndexOf(context.m_nRow, context.m_nFunction);
+    CCommandContext *pContext = &context;
+    const bool bPosted = m_scheduler.PostToUi([this, nIndex, pContext]() {
+        const std::shared_ptr<Run> pRun = m_running[nIndex];
+        if (!pRun || pRun->pContext.get() != pContext)
+            return;
+        pContext->m_bProgressPosted.store(false, std::memory_order_release);
+        const int nPercent = pContext->m_nProgress.load(std::memory_order_relaxed);
+        const std::vector<CCommandListener *> listeners = m_listeners;
+        for (CCommandListener *pListener : listeners)
+        {
+            if (IsListening(pListener))
+                pListener->OnCommandProgress(pContext->m_nRow, pContext->m_nFunction, nPercent);
+        }
+    });
+    if (!bPosted)
+        context.m_bProgressPosted.store(false, std::memory_order_release);
+}
+
+/**
+ * @brief 実行の終了をUIスレッドで処理します。
+ * @details 実行中の表から外してからリスナーに通知するため、通知の中から同じ機能を再実行できます。
+ * 通知中 (メッセージボックスのモーダルループなど) に登録を解除されたリスナーには通知しません。
+ */
+void CCommandRegistry::Finish(int nIndex, const std::shared_ptr<Run> &pRun, Status status)
+{
+    if (m_running[nIndex] != pRun)
+        return;
+    m_running[nIndex].reset();
+    --m_nBusy;
+
+    const std::vector<CCommandListener *> listeners = m_listeners;
+    for (CCommandListener *pListener : listeners)
+    {
+        if (IsListening(pListener))
+            pListener->OnCommandFinished(pRun->pContext->m_nRow, pRun->pContext->m_nFunction, status);
+    }
+}
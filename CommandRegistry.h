@@ -0,0 +1,212 @@
+﻿/**
+ * @file CommandRegistry.h
+ * @brief 機能 F(n-k) の登録表と、バックグラウンドでの実行を管理するクラス宣言
+ * @details 行番号 n × 機能番号 k の密な表を起動時に構築し、ボタン押下からの呼び出しは添字計算だけで本体を引き当てます。
+ * 本体 (原点復帰、ファイル転送、再計算など) はタスクスケジューラのワーカーで実行するため、操作パネルは固まりません。
+ * 進捗と完了は UI スレッドへ届けて登録されたリスナーに通知します。進捗は未通知のものがあれば値だけを更新するため、
+ * 本体が細かく進捗を報告しても UI スレッドへの投稿は増えません。
+ * 実行中の機能は同じ n-k で重ねて起動できず、取り消しトークンで中断を要求できます。
+ * UI スレッドへ投稿できなかった完了は登録表に預け、FinishUnposted() で UI スレッドから処理します。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class CCommandRegistry;
+
+/**
+ * @class CCommandContext
+ * @brief 実行中の機能の本体に渡される実行文脈
+ * @details 本体は IsCancelled() を適宜確認して中断し、ReportProgress() で進捗を報告します。
+ */
+class CCommandContext
+{
+public:
+    /// @brief 行番号 n (1始まり) を返します。
+    int GetRow() const { return m_nRow; }
+    /// @brief 機能番号 k (1始まり) を返します。
+    int GetFunction() const { return m_nFunction; }
+    /// @brief 取り消しが要求されているかを返します。
+    bool IsCancelled() const { return m_token.IsCancelled(); }
+    /// @brief 取り消しトークンを返します (本体から更にタスクを登録する場合に渡します)。
+    const CCancellationToken &GetToken() const { return m_token; }
+
+    /**
+     * @brief 進捗を報告します。
+     * @param[in] nPercent 進捗 (0～100)
+     */
+    void ReportProgress(int nPercent);
+
+private:
+    friend class CCommandRegistry;
+    CCommandContext(CCommandRegistry &registry, int nRow, int nFunction, CCancellationToken token)
+        : m_registry(registry), m_nRow(nRow), m_nFunction(nFunction), m_token(std::move(token)),
+          m_nProgress(0), m_bProgressPosted(false)
+    {
+    }
+
+    CCommandRegistry &m_registry;         ///< 登録表
+    int m_nRow;                           ///< 行番号 n
+    int m_nFunction;                      ///< 機能番号 k
+    CCancellationToken m_token;           ///< 取り消しトークン
+    std::atomic<int> m_nProgress;         ///< 最新の進捗
+    std::atomic<bool> m_bProgressPosted;  ///< 未通知の進捗をUIスレッドへ投稿済みか
+};
+
+/**
+ * @class CCommandListener
+ * @brief 機能の進捗と完了の通知を受けるリスナー
+ * @details 通知は全て UI スレッドで行われます。
+ */
+class CCommandListener
+{
+public:
+    virtual ~CCommandListener() = default;
+
+    /**
+     * @brief 進捗が更新されたときに呼び出されます。
+     * @param[in] nRow 行番号 n
+     * @param[in] nFunction 機能番号 k
+     * @param[in] nPercent 最新の進捗 (0～100)
+     */
+    virtual void OnCommandProgress(int nRow, int nFunction, int nPercent) = 0;
+
+    /**
+     * @brief 機能の実行が終わったときに呼び出されます。この時点で IsBusy() は false を返します。
+     * @param[in] nRow 行番号 n
+     * @param[in] nFunction 機能番号 k
+     * @param[in] nStatus 終了状態 (CCommandRegistry::Status)
+     */
+    virtual void OnCommandFinished(int nRow, int nFunction, int nStatus) = 0;
+};
+
+/**
+ * @class CCommandRegistry
+ * @brief 行 × 機能の密な登録表とバックグラウンド実行
+ * @details 登録 (Register/RegisterFunction) は起動時に、Execute()・Cancel()・IsBusy()・FinishUnposted()・リスナーの登録は
+ * UI スレッドから呼び出してください。本体はワーカーで、リスナーへの通知は UI スレッドで行われます。
+ */
+class CCommandRegistry
+{
+public:
+    /// @brief 機能の本体 (成功ならtrue、失敗ならfalseを返すか例外を送出します)
+    typedef std::function<bool(CCommandContext &)> Body;
+
+    /// @brief 機能の終了状態
+    enum Status
+    {
+        STATUS_COMPLETED,  ///< 正常に終了した
+        STATUS_FAILED,     ///< 本体が失敗を返したか例外を送出した
+        STATUS_CANCELLED   ///< 取り消された (本体が取り消しを確認して戻った場合を含む)
+    };
+
+    /**
+     * @brief コンストラクタ
+     * @param[in] scheduler 本体を実行し、UIスレッドへの通知を中継するタスクスケジューラ
+     * @param[in] nRows 行数 (n の最大値)
+     * @param[in] nFunctions 機能数 (k の最大値)
+     */
+    CCommandRegistry(CTaskScheduler &scheduler, int nRows, int nFunctions);
+
+    CCommandRegistry(const CCommandRegistry &) = delete;
+    CCommandRegistry &operator=(const CCommandRegistry &) = delete;
+
+    /// @brief 行数を返します。
+    int GetRowCount() const { return m_nRows; }
+    /// @brief 機能数を返します。
+    int GetFunctionCount() const { return m_nFunctions; }
+
+    /**
+     * @brief 機能 F(n-k) の本体を登録します (登録済みなら置き換えます)。
+     * @return 範囲内であればtrue
+     */
+    bool Register(int nRow, int nFunction, Body body);
+
+    /**
+     * @brief 全ての行の機能 k に同じ本体を登録します。
+     * @details 本体は CCommandContext::GetRow() で行を区別できます。特定の行だけ異なる本体は、この後に Register() で上書きします。
+     * @return 範囲内であればtrue
+     */
+    bool RegisterFunction(int nFunction, Body body);
+
+    /// @brief 機能 F(n-k) が登録されているかを返します。
+    bool IsDefined(int nRow, int nFunction) const;
+
+    /// @brief 機能 F(n-k) が実行中かを返します。
+    bool IsBusy(int nRow, int nFunction) const;
+
+    /// @brief 実行中の機能の数を返します。
+    int GetBusyCount() const { return m_nBusy; }
+
+    /**
+     * @brief 機能 F(n-k) をワーカーで実行します。
+     * @return 実行を開始した場合はtrue (未登録・実行中・スケジューラ停止中はfalse)
+     */
+    bool Execute(int nRow, int nFunction);
+
+    /**
+     * @brief 実行中の機能 F(n-k) に取り消しを要求します。
+     * @return 実行中であればtrue
+     */
+    bool Cancel(int nRow, int nFunction);
+
+    /// @brief 実行中の全ての機能に取り消しを要求します。
+    void CancelAll();
+
+    /**
+     * @brief UIスレッドへ投稿できなかった終了処理を実行します。
+     * @details UI実行関数が解除されているか投稿を拒否した場合、ワーカーは終了を登録表に預けます。
+     * Execute() は開始前にこれを呼び出すため、預けられた機能も再び実行できます。
+     * @return 処理した終了の数
+     */
+    int FinishUnposted();
+
+    /// @brief リスナーを登録します。
+    void AddListener(CCommandListener *pListener);
+    /// @brief リスナーの登録を解除します。
+    void RemoveListener(CCommandListener *pListener);
+
+private:
+    friend class CCommandContext;
+
+    /// @brief 実行中の機能
+    struct Run
+    {
+        CCancellationSource cancel;               ///< 取り消し元
+        std::unique_ptr<CCommandContext> pContext; ///< 本体に渡す実行文脈
+    };
+
+    /// @brief UIスレッドへ投稿できなかった終了
+    struct Unposted
+    {
+        int nIndex;                 ///< 表の添字
+        std::shared_ptr<Run> pRun;  ///< 終了した実行
+        Status status;              ///< 終了状態
+    };
+
+    /// @brief 表の添字を返します (範囲外は-1)。
+    int IndexOf(int nRow, int nFunction) const;
+    /// @brief リスナーが登録されているかを返します。
+    bool IsListening(CCommandListener *pListener) const;
+    /// @brief 進捗をUIスレッドへ届けます (ワーカーから呼び出されます)。
+    void PostProgress(CCommandContext &context);
+    /// @brief 実行の終了をUIスレッドで処理します。
+    void Finish(int nIndex, const std::shared_ptr<Run> &pRun, Status status);
+
+    CTaskScheduler &m_scheduler;                         ///< タスクスケジューラ
+    const int m_nRows;                                   ///< 行数
+    const int m_nFunctions;                              ///< 機能数
+    std::vector<std::shared_ptr<const Body>> m_table;    ///< 本体の表 ((n-1) × 機能数 + (k-1))
+    std::vector<std::shared_ptr<Run>> m_running;         ///< 実行中の機能 (表と同じ添字、UIスレッドのみ)
+    int m_nBusy;                                         ///< 実行中の機能の数 (UIスレッドのみ)
+    std::vector<CCommandListener *> m_listeners;         ///< リスナー (UIスレッドのみ)
+    std::mutex m_unpostedMutex;                          ///< m_unposted の保護
+    std::vector<Unposted> m_unposted;                    ///< UIスレッドへ投稿できなかった終了
+};
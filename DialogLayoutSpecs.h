@@ -0,0 +1,26 @@
+﻿/**
+ * @file DialogLayoutSpecs.h
+ * @brief グリッド配列ダイアログ (CMyDialog / CMyDialog2) のレイアウト仕様
+ * @details ダイアログのヘッダーとテストが同じ仕様を参照するよう、仕様だけをこのヘッダーに置きます。
+ * 先頭グリッドのコントロールIDは AFX_IDW_PANE_FIRST と同じ値の定数で持ち、一致はダイアログ側の static_assert で確認します。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "GridLayout.h"
+
+namespace DialogLayoutSpecs
+{
+    /// @brief 先頭グリッドのコントロールID (AFX_IDW_PANE_FIRST と同じ値)
+    constexpr unsigned int FIRST_ID = 0xE900;
+
+    /// @brief CMyDialog のレイアウト仕様の型 (10行1列のグリッド配列、各グリッド6行2列)
+    using Dialog1Spec = GridLayout::DialogSpec<10, 1, 6, 2>;
+    /// @brief CMyDialog のレイアウト仕様 (間隔10px、行高22px、列幅120/220px。2,3,4,6行目の2列目が編集可能)
+    constexpr Dialog1Spec DIALOG1_SPEC = {10, 22, 10, FIRST_ID, {120, 220}, {0x0, 0x2, 0x2, 0x2, 0x0, 0x2}, L"Cell"};
+
+    /// @brief CMyDialog2 のレイアウト仕様の型 (5行2列のグリッド配列、各グリッド6行2列)
+    using Dialog2Spec = GridLayout::DialogSpec<5, 2, 6, 2>;
+    /// @brief CMyDialog2 のレイアウト仕様 (間隔10px、行高22px、列幅120/220px、全セル読み取り専用)
+    constexpr Dialog2Spec DIALOG2_SPEC = {10, 22, 10, FIRST_ID, {120, 220}, {0x0, 0x0, 0x0, 0x0, 0x0, 0x0}, L"Cell"};
+}
@@ -0,0 +1,217 @@
+﻿/**
+ * @file FontMetricsCache.cpp
+ * @brief フォントの寸法のキャッシュと、垂直中央の書式矩形の計算の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリ (Windowsでは Windows.h) のみに依存します。
+ */
+#include "FontMetricsCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+/**
+ * @brief 画面のDCにフォントを選択して寸法を測ります (Windowsの既定のバックエンド)。
+ * @details フォントハンドルは論理的な大きさではなくピクセル単位の大きさで作られているため、
+ * 画面のDCで測った値をそのまま使えます。
+ */
+bool MeasureWithScreenDC(std::uintptr_t hFont, unsigned /*nDpi*/, FONT_METRICS &metrics)
+{
+    HDC hdc = ::GetDC(nullptr);
+    if (hdc == nullptr)
+        return false;
+    HGDIOBJ hSelect = hFont != 0 ? reinterpret_cast<HGDIOBJ>(hFont) : ::GetStockObject(SYSTEM_FONT);
+    HGDIOBJ hOldFont = ::SelectObject(hdc, hSelect);
+    TEXTMETRICW tm = {};
+    const BOOL bMeasured = ::GetTextMetricsW(hdc, &tm);
+    ::SelectObject(hdc, hOldFont);
+    ::ReleaseDC(nullptr, hdc);
+    if (!bMeasured)
+        return false;
+
+    metrics.nHeight = tm.tmHeight;
+    metrics.nAscent = tm.tmAscent;
+    metrics.nDescent = tm.tmDescent;
+    metrics.nExternalLeading = tm.tmExternalLeading;
+    metrics.nAveCharWidth = tm.tmAveCharWidth;
+    return true;
+}
+const CFontMetricsCache::MeasureFunc s_pfnDefaultMeasure = &MeasureWithScreenDC;
+#else
+const CFontMetricsCache::MeasureFunc s_pfnDefaultMeasure = nullptr;
+#endif
+
+/// @brief キャッシュの登録
+struct ENTRY
+{
+    std::uintptr_t hFont; ///< フォントハンドル
+    unsigned nDpi;        ///< DPI
+    FONT_METRICS metrics; ///< 寸法
+};
+
+std::mutex s_mutex;                                                ///< 登録とバックエンドの保護
+std::vector<ENTRY> s_entries;                                      ///< 登録
+CFontMetricsCache::MeasureFunc s_pfnMeasure = s_pfnDefaultMeasure; ///< バックエンド
+std::atomic<std::uint64_t> s_nLookups{0};                          ///< 寸法の参照回数
+std::atomic<std::uint64_t> s_nMeasures{0};                         ///< バックエンドで測った回数
+std::atomic<std::uint64_t> s_nLayoutChecks{0};                     ///< 書式矩形の確認回数
+std::atomic<std::uint64_t> s_nLayoutApplies{0};                    ///< 書式矩形の設定が必要だった回数
+}
+
+/**
+ * @brief フォントの寸法を取得します。
+ * @details 測定はロックを保持したまま行うため、同じフォントを同時に測ることはありません。
+ */
+bool CFontMetricsCache::Get(std::uintptr_t hFont, unsigned nDpi, FONT_METRICS &metrics)
+{
+    s_nLookups.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (const ENTRY &entry : s_entries)
+    {
+        if (entry.hFont == hFont && entry.nDpi == nDpi)
+        {
+            metrics = entry.metrics;
+            return true;
+        }
+    }
+
+    if (s_pfnMeasure == nullptr)
+        return false;
+    s_nMeasures.fetch_add(1, std::memory_order_relaxed);
+    FONT_METRICS measured = {};
+    if (!s_pfnMeasure(hFont, nDpi, measured))
+        return false;
+    s_entries.push_back(ENTRY{hFont, nDpi, measured});
+    metrics = measured;
+    return true;
+}
+
+/**
+ * @brief フォントハンドルの登録を全てのDPIについて削除します。
+ */
+void CFontMetricsCache::Invalidate(std::uintptr_t hFont)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_entries.erase(std::remove_if(s_entries.begin(), s_entries.end(), [hFont](const ENTRY &entry) { return entry.hFont == hFont; }),
+                    s_entries.end());
+}
+
+/**
+ * @brief 全ての登録を削除します。
+ */
+void CFontMetricsCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_entries.clear();
+}
+
+/**
+ * @brief 寸法を測るバックエンドを設定し、全ての登録を削除します。
+ */
+void CFontMetricsCache::SetBackend(MeasureFunc pfnMeasure)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_pfnMeasure = pfnMeasure;
+    s_entries.clear();
+}
+
+/**
+ * @brief 累計回数を返します。
+ */
+CFontMetricsCache::Stats CFontMetricsCache::GetStats()
+{
+    Stats stats;
+    stats.nLookups = s_nLookups.load(std::memory_order_relaxed);
+    stats.nMeasures = s_nMeasures.load(std::memory_order_relaxed);
+    stats.nLayoutChecks = s_nLayoutChecks.load(std::memory_order_relaxed);
+    stats.nLayoutApplies = s_nLayoutApplies.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief 累計回数を0に戻します。
+ */
+void CFontMetricsCache::ResetStats()
+{
+    s_nLookups.store(0, std::memory_order_relaxed);
+    s_nMeasures.store(0, std::memory_order_relaxed);
+    s_nLayoutChecks.store(0, std::memory_order_relaxed);
+    s_nLayoutApplies.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 累計回数を1行のテキストで返します。
+ */
+std::string CFontMetricsCache::FormatStats()
+{
+    const Stats stats = GetStats();
+    return "FontMetricsCache: lookups=" + std::to_string(stats.nLookups) + " measures=" + std::to_string(stats.nMeasures) +
+           " layout-checks=" + std::to_string(stats.nLayoutChecks) + " layout-applies=" + std::to_string(stats.nLayoutApplies) +
+           "\n";
+}
+
+/**
+ * @brief 書式矩形の確認の結果を累計回数に加えます。
+ */
+void CFontMetricsCache::RecordLayoutCheck(bool bApplied)
+{
+    s_nLayoutChecks.fetch_add(1, std::memory_order_relaxed);
+    if (bApplied)
+        s_nLayoutApplies.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief CCenteredTextLayoutクラスのコンストラクタ
+ */
+CCenteredTextLayout::CCenteredTextLayout()
+    : m_nClientWidth(0), m_nClientHeight(0), m_hFont(0), m_nDpi(0), m_bValid(false), m_bApplied(false), m_rect{0, 0, 0, 0}
+{
+}
+
+/**
+ * @brief 現在のクライアント領域とフォントに対する書式矩形を求めます。
+ * @details 入力が前回と同じであれば、寸法を参照せずに前回の結果を使います。
+ * 入力が変わっても求めた矩形が設定済みのものと同じであれば、設定は不要とします。
+ */
+bool CCenteredTextLayout::Update(int nClientWidth, int nClientHeight, std::uintptr_t hFont, unsigned nDpi, FORMAT_RECT &rect)
+{
+    const bool bSameInput = m_bValid && nClientWidth == m_nClientWidth && nClientHeight == m_nClientHeight &&
+                            hFont == m_hFont && nDpi == m_nDpi;
+    if (!bSameInput)
+    {
+        FONT_METRICS metrics = {};
+        if (!CFontMetricsCache::Get(hFont, nDpi, metrics))
+        {
+            CFontMetricsCache::RecordLayoutCheck(false);
+            return false;
+        }
+        const FORMAT_RECT newRect = {0, (std::max)(0, (nClientHeight - metrics.nHeight) / 2), nClientWidth, nClientHeight};
+        if (!m_bValid || newRect.left != m_rect.left || newRect.top != m_rect.top || newRect.right != m_rect.right ||
+            newRect.bottom != m_rect.bottom)
+        {
+            m_rect = newRect;
+            m_bApplied = false;
+        }
+        m_nClientWidth = nClientWidth;
+        m_nClientHeight = nClientHeight;
+        m_hFont = hFont;
+        m_nDpi = nDpi;
+        m_bValid = true;
+    }
+
+    const bool bApply = !m_bApplied;
+    CFontMetricsCache::RecordLayoutCheck(bApply);
+    if (bApply)
+    {
+        rect = m_rect;
+        m_bApplied = true;
+    }
+    return bApply;
+}
@@ -0,0 +1,137 @@
+﻿/**
+ * @file FontMetricsCache.h
+ * @brief フォントの寸法のプロセス共通キャッシュと、テキストを垂直中央に置く書式矩形の計算のクラス宣言
+ * @details フォントの寸法 (高さ・アセントなど) は、フォントハンドルとDPIの組ごとに一度だけ測り、以降はキャッシュから返します。
+ * 測定はバックエンド関数で行い、Windowsでは画面のDCにフォントを選択して GetTextMetrics で測ります。
+ * Windows以外の環境 (単体テストなど) では SetBackend() で偽のバックエンドを設定できます。
+ * CCenteredTextLayout は、クライアント領域の大きさとフォントが変わった場合だけ書式矩形を計算し直し、
+ * 結果が前回と同じであれば書式矩形の設定 (エディットコントロールの再レイアウト) を省略させます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @struct FONT_METRICS
+ * @brief フォントの寸法 (ピクセル)
+ */
+struct FONT_METRICS
+{
+    int nHeight;          ///< 文字の高さ (アセント + ディセント)
+    int nAscent;          ///< ベースラインより上の高さ
+    int nDescent;         ///< ベースラインより下の高さ
+    int nExternalLeading; ///< 行間
+    int nAveCharWidth;    ///< 平均文字幅
+};
+
+/**
+ * @class CFontMetricsCache
+ * @brief フォントの寸法のプロセス全体のキャッシュ (静的メンバのみ)
+ * @details 参照はロックで保護するため、任意のスレッドから呼び出せます。フォントは数種類しか使わないため、
+ * 登録は線形探索します。フォントハンドルを破棄して再利用する場合は、破棄する前に Invalidate() を呼び出してください。
+ */
+class CFontMetricsCache
+{
+public:
+    /**
+     * @brief フォントの寸法を測るバックエンド関数
+     * @param[in] hFont フォントハンドル (0はシステムフォント)
+     * @param[in] nDpi DPI (0は不明)
+     * @param[out] metrics 測った寸法
+     * @return 測れた場合はtrue
+     */
+    using MeasureFunc = bool (*)(std::uintptr_t hFont, unsigned nDpi, FONT_METRICS &metrics);
+
+    /**
+     * @struct Stats
+     * @brief キャッシュと書式矩形の計算の累計回数
+     */
+    struct Stats
+    {
+        std::uint64_t nLookups;       ///< 寸法の参照回数
+        std::uint64_t nMeasures;      ///< バックエンドで測った回数 (WindowsではDCの取得回数)
+        std::uint64_t nLayoutChecks;  ///< 書式矩形の確認回数 (CCenteredTextLayout::Update の呼び出し回数)
+        std::uint64_t nLayoutApplies; ///< 書式矩形の設定が必要だった回数
+    };
+
+    /**
+     * @brief フォントの寸法を取得します (キャッシュになければバックエンドで測って登録します)。
+     * @param[in] hFont フォントハンドル (0はシステムフォント)
+     * @param[in] nDpi DPI (0は不明)
+     * @param[out] metrics 寸法
+     * @return 取得できた場合はtrue (バックエンドがない場合や測れなかった場合はfalse)
+     */
+    static bool Get(std::uintptr_t hFont, unsigned nDpi, FONT_METRICS &metrics);
+
+    /// @brief フォントハンドルの登録を全てのDPIについて削除します。
+    static void Invalidate(std::uintptr_t hFont);
+    /// @brief 全ての登録を削除します。
+    static void Clear();
+
+    /**
+     * @brief 寸法を測るバックエンドを設定し、全ての登録を削除します。
+     * @details 既定のバックエンドは、Windowsでは画面のDCで測る関数、それ以外の環境ではnullptrです。
+     * @param[in] pfnMeasure バックエンド関数 (nullptrなら測りません)
+     */
+    static void SetBackend(MeasureFunc pfnMeasure);
+
+    /// @brief 累計回数を返します。
+    static Stats GetStats();
+    /// @brief 累計回数を0に戻します。
+    static void ResetStats();
+    /// @brief 累計回数を1行のテキストで返します (診断情報の書き出し用)。
+    static std::string FormatStats();
+
+    /// @brief 書式矩形の確認の結果を累計回数に加えます (CCenteredTextLayout から呼び出します)。
+    static void RecordLayoutCheck(bool bApplied);
+};
+
+/**
+ * @class CCenteredTextLayout
+ * @brief テキストを垂直中央に置くエディットコントロールの書式矩形を、変化があった場合だけ求めるクラス
+ * @details 書式矩形は「クライアント領域の上端を (高さ - 文字の高さ) / 2 だけ下げた矩形」です。
+ * クライアント領域の大きさ・フォント・DPIが前回と同じであれば、寸法の参照も計算も行いません。
+ * コントロールが自分で書式矩形を戻した場合 (サイズ変更時など) は、Invalidate() で次の設定を強制します。
+ */
+class CCenteredTextLayout
+{
+public:
+    /**
+     * @struct FORMAT_RECT
+     * @brief 書式矩形 (クライアント座標)
+     */
+    struct FORMAT_RECT
+    {
+        int left;   ///< 左端
+        int top;    ///< 上端
+        int right;  ///< 右端
+        int bottom; ///< 下端
+    };
+
+    CCenteredTextLayout();
+
+    /**
+     * @brief 現在のクライアント領域とフォントに対する書式矩形を求めます。
+     * @param[in] nClientWidth クライアント領域の幅
+     * @param[in] nClientHeight クライアント領域の高さ
+     * @param[in] hFont フォントハンドル (0はシステムフォント)
+     * @param[in] nDpi DPI (0は不明)
+     * @param[out] rect 設定する書式矩形 (戻り値がtrueの場合のみ有効)
+     * @return 書式矩形の設定が必要な場合はtrue (前回設定したものと同じであればfalse)
+     */
+    bool Update(int nClientWidth, int nClientHeight, std::uintptr_t hFont, unsigned nDpi, FORMAT_RECT &rect);
+
+    /// @brief 設定済みの書式矩形が失われたことを記録し、次の Update() で設定を強制します。
+    void Invalidate() { m_bApplied = false; }
+
+private:
+    int m_nClientWidth;     ///< 前回のクライアント領域の幅
+    int m_nClientHeight;    ///< 前回のクライアント領域の高さ
+    std::uintptr_t m_hFont; ///< 前回のフォントハンドル
+    unsigned m_nDpi;        ///< 前回のDPI
+    bool m_bValid;          ///< 前回の入力と m_rect が有効か
+    bool m_bApplied;        ///< m_rect をコントロールに設定済みか
+    FORMAT_RECT m_rect;     ///< 前回求めた書式矩形
+};
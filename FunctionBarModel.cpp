@@ -0,0 +1,139 @@
+﻿/**
+ * @file FunctionBarModel.cpp
+ * @brief 機能ボタン列の表示状態モデルと差分適用の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "FunctionBarModel.h"
+
+#include <algorithm>
+#include <cwchar>
+
+namespace
+{
+/// @brief 空欄のラベル
+const wchar_t s_szEmpty[] = L"";
+/// @brief 次ページボタンのラベル
+const wchar_t s_szNextPage[] = L">>";
+}
+
+/**
+ * @brief CFunctionBarModelクラスのコンストラクタ
+ * @details 全ての (行, 機能) の "F(n-k)" ラベルをここで作り置きします。
+ */
+CFunctionBarModel::CFunctionBarModel(int nRows, int nFunctions, int nButtons)
+    : m_nRows((std::max)(0, nRows)), m_nFunctions((std::max)(0, nFunctions)), m_nButtons((std::max)(1, nButtons)),
+      m_nPages((std::max)(1, (m_nFunctions + m_nButtons - 1) / m_nButtons)),
+      m_progress(static_cast<std::size_t>(m_nRows) * m_nFunctions, -1), m_progressText(m_nButtons), m_nRow(0),
+      m_nPage(0), m_bNextPageEnabled(false), m_bKnown(false), m_current(m_nButtons + 1)
+{
+    m_labels.reserve(static_cast<std::size_t>(m_nRows) * m_nFunctions);
+    wchar_t szLabel[32];
+    for (int nRow = 1; nRow <= m_nRows; ++nRow)
+    {
+        for (int nFunction = 1; nFunction <= m_nFunctions; ++nFunction)
+        {
+            std::swprintf(szLabel, sizeof(szLabel) / sizeof(szLabel[0]), L"F(%d-%d)", nRow, nFunction);
+            m_labels.emplace_back(szLabel);
+        }
+    }
+}
+
+/**
+ * @brief 表示する行とページを設定します。
+ */
+void CFunctionBarModel::Select(int nRow, int nPage, bool bNextPageEnabled)
+{
+    m_nRow = (nRow >= 1 && nRow <= m_nRows) ? nRow : 0;
+    m_nPage = (nPage >= 0 && nPage < m_nPages) ? nPage : 0;
+    m_bNextPageEnabled = bNextPageEnabled && m_nPages > 1;
+}
+
+/**
+ * @brief 表示中のボタンに割り当てられている機能番号を返します。
+ */
+int CFunctionBarModel::GetButtonFunction(int nButton) const
+{
+    if (m_nRow == 0 || nButton < 0 || nButton >= m_nButtons)
+        return 0;
+    const int nFunction = m_nPage * m_nButtons + nButton + 1;
+    return nFunction <= m_nFunctions ? nFunction : 0;
+}
+
+/**
+ * @brief 実行中の機能の進捗を設定します。
+ */
+void CFunctionBarModel::SetProgress(int nRow, int nFunction, int nPercent)
+{
+    if (nRow < 1 || nRow > m_nRows || nFunction < 1 || nFunction > m_nFunctions)
+        return;
+    m_progress[IndexOf(nRow, nFunction)] = nPercent < 0 ? -1 : (std::min)(100, nPercent);
+}
+
+/**
+ * @brief ボタンの望ましいラベル・有効/無効を求めます。
+ * @details 実行中の機能は無効とし、進捗が設定されていれば "n%" を、なければ "F(n-k)" を表示します。
+ */
+const wchar_t *CFunctionBarModel::DesiredLabel(int nButton, bool &bEnabled)
+{
+    if (nButton == m_nButtons)
+    {
+        bEnabled = m_nRow != 0 && m_bNextPageEnabled;
+        return bEnabled ? s_szNextPage : s_szEmpty;
+    }
+
+    const int nFunction = GetButtonFunction(nButton);
+    if (nFunction == 0)
+    {
+        bEnabled = false;
+        return s_szEmpty;
+    }
+
+    const bool bBusy = m_busy && m_busy(m_nRow, nFunction);
+    bEnabled = !bBusy;
+    const int nIndex = IndexOf(m_nRow, nFunction);
+    if (bBusy && m_progress[nIndex] >= 0)
+    {
+        wchar_t szText[8];
+        std::swprintf(szText, sizeof(szText) / sizeof(szText[0]), L"%d%%", m_progress[nIndex]);
+        m_progressText[nButton] = szText;
+        return m_progressText[nButton].c_str();
+    }
+    return m_labels[nIndex].c_str();
+}
+
+/**
+ * @brief 望ましい状態を計算し、現在の状態との差分だけを出力先に指示します。
+ * @details ボタンは常に表示します。ラベルは文字列として比較するため、同じ内容であれば指示しません。
+ */
+int CFunctionBarModel::Apply(CFunctionBarSink &sink)
+{
+    int nOps = 0;
+    for (int nButton = 0; nButton <= m_nButtons; ++nButton)
+    {
+        bool bEnabled = false;
+        const wchar_t *pszLabel = DesiredLabel(nButton, bEnabled);
+        const bool bVisible = true;
+        ButtonState &current = m_current[nButton];
+
+        if (!m_bKnown || current.label != pszLabel)
+        {
+            current.label = pszLabel;
+            sink.SetLabel(nButton, pszLabel);
+            ++nOps;
+        }
+        if (!m_bKnown || current.bEnabled != bEnabled)
+        {
+            current.bEnabled = bEnabled;
+            sink.SetEnabled(nButton, bEnabled);
+            ++nOps;
+        }
+        if (!m_bKnown || current.bVisible != bVisible)
+        {
+            current.bVisible = bVisible;
+            sink.SetVisible(nButton, bVisible);
+            ++nOps;
+        }
+    }
+    m_bKnown = true;
+    return nOps;
+}
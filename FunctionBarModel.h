@@ -0,0 +1,125 @@
+﻿/**
+ * @file FunctionBarModel.h
+ * @brief 機能ボタン列 (ファンクションバー) の表示状態モデルと差分適用のクラス宣言
+ * @details 機能数とボタン数からページ数を求め、(行, 機能) ごとの "F(n-k)" ラベルを起動時に作り置きします。
+ * 選択行・ページ・実行状態から各ボタンの望ましい状態 (ラベル・有効/無効・表示/非表示) を求め、
+ * 現在の状態と比較して、変化した項目だけを出力先 (CFunctionBarSink) に指示します。
+ * 上下キーを押し続けて行選択が連続で変わっても、ウィンドウへの呼び出しは実際に変わるボタンの分だけになります。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @class CFunctionBarSink
+ * @brief ファンクションバーの差分を受け取る出力先
+ * @details ボタン番号は 0～ボタン数-1 が機能ボタン、ボタン数が次ページボタンです。
+ */
+class CFunctionBarSink
+{
+public:
+    virtual ~CFunctionBarSink() = default;
+    /// @brief ボタンのラベルを設定します。
+    virtual void SetLabel(int nButton, const wchar_t *pszLabel) = 0;
+    /// @brief ボタンの有効/無効を設定します。
+    virtual void SetEnabled(int nButton, bool bEnabled) = 0;
+    /// @brief ボタンの表示/非表示を設定します。
+    virtual void SetVisible(int nButton, bool bVisible) = 0;
+};
+
+/**
+ * @class CFunctionBarModel
+ * @brief 機能ボタン列の状態計算と差分適用
+ * @details 行番号 n と機能番号 k は1始まりです。ページ番号は0始まりで、
+ * ページ p のボタン i には機能 k = p × ボタン数 + i + 1 が割り当てられます (機能数を超えるボタンは空欄)。
+ */
+class CFunctionBarModel
+{
+public:
+    /// @brief 機能 F(n-k) が実行中かを返す関数
+    typedef std::function<bool(int nRow, int nFunction)> BusyFunc;
+
+    /**
+     * @brief コンストラクタ
+     * @param[in] nRows 行数
+     * @param[in] nFunctions 機能数
+     * @param[in] nButtons 1ページあたりの機能ボタン数
+     */
+    CFunctionBarModel(int nRows, int nFunctions, int nButtons);
+
+    /// @brief 1ページあたりの機能ボタン数を返します。
+    int GetButtonCount() const { return m_nButtons; }
+    /// @brief ページ数を返します。
+    int GetPageCount() const { return m_nPages; }
+    /// @brief 次ページボタンのボタン番号を返します。
+    int GetNextPageButton() const { return m_nButtons; }
+
+    /// @brief 実行中かを返す関数を設定します (未設定なら全て実行中でないものとします)。
+    void SetBusyFunc(BusyFunc busy) { m_busy = std::move(busy); }
+
+    /**
+     * @brief 表示する行とページを設定します。
+     * @param[in] nRow 選択行 (1始まり、0なら非選択)
+     * @param[in] nPage ページ番号 (範囲外は0)
+     * @param[in] bNextPageEnabled 次ページボタンを有効にするか (ページが1つしかない場合は常に無効)
+     */
+    void Select(int nRow, int nPage, bool bNextPageEnabled);
+
+    /// @brief 選択行を返します (0なら非選択)。
+    int GetRow() const { return m_nRow; }
+    /// @brief 表示中のページ番号を返します。
+    int GetPage() const { return m_nPage; }
+    /// @brief 次のページ番号を返します (最後のページの次は0)。
+    int GetNextPage() const { return (m_nPage + 1) % m_nPages; }
+
+    /// @brief 表示中のボタンに割り当てられている機能番号を返します (空欄なら0)。
+    int GetButtonFunction(int nButton) const;
+
+    /**
+     * @brief 実行中の機能の進捗を設定します。
+     * @param[in] nPercent 進捗 (負の値で解除し、ラベルを "F(n-k)" に戻します)
+     */
+    void SetProgress(int nRow, int nFunction, int nPercent);
+
+    /**
+     * @brief 望ましい状態を計算し、現在の状態との差分だけを出力先に指示します。
+     * @details 初回と Invalidate() の後は全ての項目を指示します。
+     * @return 指示した項目の数
+     */
+    int Apply(CFunctionBarSink &sink);
+
+    /// @brief 現在の状態を不明とし、次の Apply() で全ての項目を指示させます。
+    void Invalidate() { m_bKnown = false; }
+
+private:
+    /// @brief 1つのボタンの状態
+    struct ButtonState
+    {
+        std::wstring label;  ///< ラベル
+        bool bEnabled;       ///< 有効か
+        bool bVisible;       ///< 表示するか
+    };
+
+    /// @brief ラベル表の添字を返します。
+    int IndexOf(int nRow, int nFunction) const { return (nRow - 1) * m_nFunctions + (nFunction - 1); }
+    /// @brief ボタンの望ましいラベル・有効/無効を求めます。
+    const wchar_t *DesiredLabel(int nButton, bool &bEnabled);
+
+    const int m_nRows;                       ///< 行数
+    const int m_nFunctions;                  ///< 機能数
+    const int m_nButtons;                    ///< 1ページあたりの機能ボタン数
+    const int m_nPages;                      ///< ページ数
+    std::vector<std::wstring> m_labels;      ///< 作り置きの "F(n-k)" ラベル (行 × 機能)
+    std::vector<int> m_progress;             ///< 実行中の機能の進捗 (行 × 機能、負なら未設定)
+    std::vector<std::wstring> m_progressText; ///< 進捗ラベルの作業領域 (ボタンごと)
+    BusyFunc m_busy;                         ///< 実行中かを返す関数
+
+    int m_nRow;                              ///< 選択行 (0なら非選択)
+    int m_nPage;                             ///< 表示中のページ
+    bool m_bNextPageEnabled;                 ///< 次ページボタンを有効にするか
+    bool m_bKnown;                           ///< 現在の状態が分かっているか
+    std::vector<ButtonState> m_current;      ///< 出力先の現在の状態 (機能ボタン + 次ページボタン)
+};
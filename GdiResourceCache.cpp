@@ -0,0 +1,361 @@
+﻿/**
+ * @file GdiResourceCache.cpp
+ * @brief GDIオブジェクトのプロセス共通キャッシュの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリ (Windowsでは Windows.h) のみに依存します。
+ */
+#include "GdiResourceCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+#ifdef _WIN32
+/**
+ * @brief GDIの関数でオブジェクトを生成します (Windowsの既定のバックエンド)。
+ */
+std::uintptr_t CreateWithGdi(const GDI_RESOURCE_KEY &key)
+{
+    HGDIOBJ hObject = nullptr;
+    switch (key.eKind)
+    {
+    case GDI_RESOURCE_PEN:
+        hObject = ::CreatePen(key.nStyle, key.nWidth, key.color);
+        break;
+    case GDI_RESOURCE_BRUSH:
+        hObject = ::CreateSolidBrush(key.color);
+        break;
+    case GDI_RESOURCE_FONT:
+    {
+        LOGFONTW lf = {};
+        lf.lfHeight = key.font.nHeight;
+        lf.lfWidth = key.font.nWidth;
+        lf.lfEscapement = key.font.nEscapement;
+        lf.lfOrientation = key.font.nOrientation;
+        lf.lfWeight = key.font.nWeight;
+        lf.lfItalic = key.font.nItalic;
+        lf.lfUnderline = key.font.nUnderline;
+        lf.lfStrikeOut = key.font.nStrikeOut;
+        lf.lfCharSet = key.font.nCharSet;
+        lf.lfOutPrecision = key.font.nOutPrecision;
+        lf.lfClipPrecision = key.font.nClipPrecision;
+        lf.lfQuality = key.font.nQuality;
+        lf.lfPitchAndFamily = key.font.nPitchAndFamily;
+        std::memcpy(lf.lfFaceName, key.font.szFaceName, sizeof(lf.lfFaceName));
+        hObject = ::CreateFontIndirectW(&lf);
+        break;
+    }
+    }
+    return reinterpret_cast<std::uintptr_t>(hObject);
+}
+
+/**
+ * @brief GDIのオブジェクトを破棄します (Windowsの既定のバックエンド)。
+ */
+void DestroyWithGdi(std::uintptr_t hObject)
+{
+    ::DeleteObject(reinterpret_cast<HGDIOBJ>(hObject));
+}
+const CGdiResourceCache::CreateFunc s_pfnDefaultCreate = &CreateWithGdi;
+const CGdiResourceCache::DestroyFunc s_pfnDefaultDestroy = &DestroyWithGdi;
+#else
+const CGdiResourceCache::CreateFunc s_pfnDefaultCreate = nullptr;
+const CGdiResourceCache::DestroyFunc s_pfnDefaultDestroy = nullptr;
+#endif
+
+/// @brief キャッシュの登録
+struct ENTRY
+{
+    GDI_RESOURCE_KEY key;       ///< 記述子
+    std::uintptr_t hObject;     ///< ハンドル
+    std::uint32_t nRefs;        ///< Acquire() で保持されている数
+    std::uint64_t nLastFrame;   ///< 最後に使われたフレームの番号
+};
+
+std::mutex s_mutex;                                                  ///< 登録・フレーム・バックエンドの保護
+std::vector<ENTRY> s_entries;                                        ///< 登録
+CGdiResourceCache::CreateFunc s_pfnCreate = s_pfnDefaultCreate;      ///< 生成のバックエンド
+CGdiResourceCache::DestroyFunc s_pfnDestroy = s_pfnDefaultDestroy;   ///< 破棄のバックエンド
+std::size_t s_nCapacity = CGdiResourceCache::DEFAULT_CAPACITY;       ///< 登録数の上限
+std::uint64_t s_nFrame = 0;                                          ///< 現在のフレームの番号
+int s_nFrameDepth = 0;                                               ///< フレームの入れ子の深さ
+CGdiResourceCache::Stats s_stats = {};                               ///< 累計回数 (nLive は s_entries.size() から求めます)
+
+/**
+ * @brief 記述子の登録を探し、なければ生成して登録します (ロックを保持して呼び出します)。
+ * @return 登録 (生成できなかった場合はnullptr)
+ */
+ENTRY *FindOrCreate(const GDI_RESOURCE_KEY &key)
+{
+    ++s_stats.nLookups;
+    for (ENTRY &entry : s_entries)
+    {
+        if (entry.key == key)
+        {
+            ++s_stats.nHits;
+            entry.nLastFrame = s_nFrame;
+            return &entry;
+        }
+    }
+
+    if (s_pfnCreate == nullptr)
+        return nullptr;
+    const std::uintptr_t hObject = s_pfnCreate(key);
+    if (hObject == 0)
+        return nullptr;
+    ++s_stats.nCreates;
+    s_entries.push_back(ENTRY{key, hObject, 0, s_nFrame});
+    s_stats.nPeakLive = (std::max)(s_stats.nPeakLive, s_entries.size());
+    return &s_entries.back();
+}
+
+/**
+ * @brief 登録を破棄します (ロックを保持して呼び出します)。
+ */
+void DestroyEntry(const ENTRY &entry)
+{
+    if (s_pfnDestroy != nullptr)
+        s_pfnDestroy(entry.hObject);
+    ++s_stats.nDestroys;
+}
+}
+
+/**
+ * @brief ペンの記述子を作ります。
+ */
+GDI_RESOURCE_KEY GDI_RESOURCE_KEY::Pen(int nStyle, int nWidth, std::uint32_t color)
+{
+    GDI_RESOURCE_KEY key = {};
+    key.eKind = GDI_RESOURCE_PEN;
+    key.nStyle = nStyle;
+    key.nWidth = nWidth;
+    key.color = color;
+    return key;
+}
+
+/**
+ * @brief 単色のブラシの記述子を作ります。
+ */
+GDI_RESOURCE_KEY GDI_RESOURCE_KEY::SolidBrush(std::uint32_t color)
+{
+    GDI_RESOURCE_KEY key = {};
+    key.eKind = GDI_RESOURCE_BRUSH;
+    key.color = color;
+    return key;
+}
+
+/**
+ * @brief フォントの記述子を作ります。
+ * @details 書体名の終端以降にごみが残っていても同じフォントとして扱えるように、終端以降を0にします。
+ */
+GDI_RESOURCE_KEY GDI_RESOURCE_KEY::Font(const GDI_FONT_DESC &font)
+{
+    GDI_RESOURCE_KEY key = {};
+    key.eKind = GDI_RESOURCE_FONT;
+    key.font = font;
+    const std::size_t nCount = sizeof(key.font.szFaceName) / sizeof(key.font.szFaceName[0]);
+    std::size_t nLength = 0;
+    while (nLength < nCount - 1 && font.szFaceName[nLength] != L'\0')
+        ++nLength;
+    std::fill(key.font.szFaceName + nLength, key.font.szFaceName + nCount, L'\0');
+    return key;
+}
+
+#ifdef _WIN32
+/**
+ * @brief LOGFONTW からフォントの記述子を作ります。
+ */
+GDI_RESOURCE_KEY GDI_RESOURCE_KEY::Font(const LOGFONTW &logFont)
+{
+    GDI_FONT_DESC font = {};
+    font.nHeight = logFont.lfHeight;
+    font.nWidth = logFont.lfWidth;
+    font.nEscapement = logFont.lfEscapement;
+    font.nOrientation = logFont.lfOrientation;
+    font.nWeight = logFont.lfWeight;
+    font.nItalic = logFont.lfItalic;
+    font.nUnderline = logFont.lfUnderline;
+    font.nStrikeOut = logFont.lfStrikeOut;
+    font.nCharSet = logFont.lfCharSet;
+    font.nOutPrecision = logFont.lfOutPrecision;
+    font.nClipPrecision = logFont.lfClipPrecision;
+    font.nQuality = logFont.lfQuality;
+    font.nPitchAndFamily = logFont.lfPitchAndFamily;
+    std::memcpy(font.szFaceName, logFont.lfFaceName, sizeof(font.szFaceName));
+    return Font(font);
+}
+#endif
+
+/**
+ * @brief 記述子が等しいかを返します (種類ごとに使う項目だけを比べます)。
+ */
+bool GDI_RESOURCE_KEY::operator==(const GDI_RESOURCE_KEY &other) const
+{
+    if (eKind != other.eKind)
+        return false;
+    switch (eKind)
+    {
+    case GDI_RESOURCE_PEN:
+        return nStyle == other.nStyle && nWidth == other.nWidth && color == other.color;
+    case GDI_RESOURCE_BRUSH:
+        return color == other.color;
+    case GDI_RESOURCE_FONT:
+        return font.nHeight == other.font.nHeight && font.nWidth == other.font.nWidth &&
+               font.nEscapement == other.font.nEscapement && font.nOrientation == other.font.nOrientation &&
+               font.nWeight == other.font.nWeight && font.nItalic == other.font.nItalic &&
+               font.nUnderline == other.font.nUnderline && font.nStrikeOut == other.font.nStrikeOut &&
+               font.nCharSet == other.font.nCharSet && font.nOutPrecision == other.font.nOutPrecision &&
+               font.nClipPrecision == other.font.nClipPrecision && font.nQuality == other.font.nQuality &&
+               font.nPitchAndFamily == other.font.nPitchAndFamily &&
+               std::memcmp(font.szFaceName, other.font.szFaceName, sizeof(font.szFaceName)) == 0;
+    }
+    return false;
+}
+
+/**
+ * @brief 記述子のハンドルを取得します。
+ */
+std::uintptr_t CGdiResourceCache::Get(const GDI_RESOURCE_KEY &key)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const ENTRY *pEntry = FindOrCreate(key);
+    return pEntry != nullptr ? pEntry->hObject : 0;
+}
+
+/**
+ * @brief 記述子のハンドルを保持して取得します。
+ */
+std::uintptr_t CGdiResourceCache::Acquire(const GDI_RESOURCE_KEY &key)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    ENTRY *pEntry = FindOrCreate(key);
+    if (pEntry == nullptr)
+        return 0;
+    ++pEntry->nRefs;
+    return pEntry->hObject;
+}
+
+/**
+ * @brief Acquire() で保持したハンドルを手放します。
+ */
+void CGdiResourceCache::Release(std::uintptr_t hObject)
+{
+    if (hObject == 0)
+        return;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (ENTRY &entry : s_entries)
+    {
+        if (entry.hObject == hObject)
+        {
+            if (entry.nRefs > 0)
+            {
+                --entry.nRefs;
+                // 手放した時点を最後の使用とし、すぐには破棄の対象にしません。
+                entry.nLastFrame = s_nFrame;
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * @brief 描画のフレームを開始します。
+ */
+void CGdiResourceCache::BeginFrame()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    ++s_nFrameDepth;
+}
+
+/**
+ * @brief 描画のフレームを終えます。
+ * @details 破棄するのは、保持されておらず、終えたフレームで使われていない登録だけです。
+ * 最後に使われたフレームの古い順に、登録数が上限以下になるまで破棄します。
+ */
+void CGdiResourceCache::EndFrame()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_nFrameDepth == 0 || --s_nFrameDepth > 0)
+        return;
+
+    if (s_entries.size() > s_nCapacity)
+    {
+        std::vector<std::size_t> candidates;
+        for (std::size_t i = 0; i < s_entries.size(); ++i)
+        {
+            if (s_entries[i].nRefs == 0 && s_entries[i].nLastFrame < s_nFrame)
+                candidates.push_back(i);
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](std::size_t a, std::size_t b) { return s_entries[a].nLastFrame < s_entries[b].nLastFrame; });
+        const std::size_t nEvict = (std::min)(candidates.size(), s_entries.size() - s_nCapacity);
+        candidates.resize(nEvict);
+        std::sort(candidates.begin(), candidates.end());
+        for (std::size_t n = nEvict; n > 0; --n)
+        {
+            const std::size_t i = candidates[n - 1];
+            DestroyEntry(s_entries[i]);
+            ++s_stats.nEvictions;
+            s_entries.erase(s_entries.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+    }
+    ++s_nFrame;
+    ++s_stats.nFrames;
+}
+
+/**
+ * @brief 登録数の上限を設定します。
+ */
+void CGdiResourceCache::SetCapacity(std::size_t nCapacity)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_nCapacity = nCapacity;
+}
+
+/**
+ * @brief 生成と破棄のバックエンドを設定し、全ての登録を破棄します。
+ */
+void CGdiResourceCache::SetBackend(CreateFunc pfnCreate, DestroyFunc pfnDestroy)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (const ENTRY &entry : s_entries)
+        DestroyEntry(entry);
+    s_entries.clear();
+    s_pfnCreate = pfnCreate;
+    s_pfnDestroy = pfnDestroy;
+}
+
+/**
+ * @brief 累計回数と現在の登録数を返します。
+ */
+CGdiResourceCache::Stats CGdiResourceCache::GetStats()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    Stats stats = s_stats;
+    stats.nLive = s_entries.size();
+    return stats;
+}
+
+/**
+ * @brief 累計回数を0に戻します。
+ */
+void CGdiResourceCache::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_stats = Stats{};
+    s_stats.nPeakLive = s_entries.size();
+}
+
+/**
+ * @brief 累計回数を1行のテキストで返します。
+ */
+std::string CGdiResourceCache::FormatStats()
+{
+    const Stats stats = GetStats();
+    return "GdiResourceCache: lookups=" + std::to_string(stats.nLookups) + " hits=" + std::to_string(stats.nHits) +
+           " creates=" + std::to_string(stats.nCreates) + " destroys=" + std::to_string(stats.nDestroys) +
+           " evictions=" + std::to_string(stats.nEvictions) + " frames=" + std::to_string(stats.nFrames) +
+           " live=" + std::to_string(stats.nLive) + " peak-live=" + std::to_string(stats.nPeakLive) + "\n";
+}
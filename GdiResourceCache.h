@@ -0,0 +1,185 @@
+﻿/**
+ * @file GdiResourceCache.h
+ * @brief ブラシ・ペン・フォントのGDIオブジェクトのプロセス共通キャッシュのクラス宣言
+ * @details GDIオブジェクトを記述子 (種類・線種・太さ・色・フォントの属性) ごとに一度だけ生成し、
+ * 同じ記述子の要求には同じハンドルを返します。描画のたびの生成と破棄がなくなり、
+ * 同じ色のブラシを使う複数のコントロールが1つのハンドルを共有するため、GDIハンドル数も増え続けません。
+ * ハンドルの有効期間は2種類です。Get() で取得したハンドルは、描画のフレーム (CGdiFrameScope の範囲) の間は
+ * 破棄されません (フレーム単位の固定)。Acquire() で取得したハンドルは、Release() するまで破棄されません。
+ * 登録数が上限を超えた場合は、一番外側のフレームの終わりに、固定も保持もされていない登録を古い順に破棄します。
+ * 生成と破棄はバックエンド関数で行い、Windowsでは CreatePen / CreateSolidBrush / CreateFontIndirect と DeleteObject を使います。
+ * Windows以外の環境 (単体テストなど) では SetBackend() で偽のバックエンドを設定できます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+/// @brief GDIオブジェクトの種類
+enum EGdiResourceKind
+{
+    GDI_RESOURCE_PEN,   ///< ペン
+    GDI_RESOURCE_BRUSH, ///< 単色のブラシ
+    GDI_RESOURCE_FONT   ///< フォント
+};
+
+/**
+ * @struct GDI_FONT_DESC
+ * @brief フォントの記述子 (LOGFONTW と同じ項目)
+ */
+struct GDI_FONT_DESC
+{
+    std::int32_t nHeight;          ///< 高さ
+    std::int32_t nWidth;           ///< 平均文字幅
+    std::int32_t nEscapement;      ///< 文字列の角度 (0.1度単位)
+    std::int32_t nOrientation;     ///< 文字の角度 (0.1度単位)
+    std::int32_t nWeight;          ///< 太さ
+    std::uint8_t nItalic;          ///< 斜体
+    std::uint8_t nUnderline;       ///< 下線
+    std::uint8_t nStrikeOut;       ///< 取り消し線
+    std::uint8_t nCharSet;         ///< 文字セット
+    std::uint8_t nOutPrecision;    ///< 出力精度
+    std::uint8_t nClipPrecision;   ///< クリッピング精度
+    std::uint8_t nQuality;         ///< 出力品質
+    std::uint8_t nPitchAndFamily;  ///< ピッチとファミリ
+    wchar_t szFaceName[32];        ///< 書体名 (終端以降は0)
+};
+
+/**
+ * @struct GDI_RESOURCE_KEY
+ * @brief キャッシュの記述子
+ * @details 種類ごとに使う項目だけを設定し、使わない項目は0にします。必ず Pen() / SolidBrush() / Font() で作ってください。
+ */
+struct GDI_RESOURCE_KEY
+{
+    EGdiResourceKind eKind; ///< 種類
+    int nStyle;             ///< 線種 (ペンのみ、PS_SOLID など)
+    int nWidth;             ///< 太さ (ペンのみ)
+    std::uint32_t color;    ///< 色 (COLORREF、ペンとブラシ)
+    GDI_FONT_DESC font;     ///< フォントの属性 (フォントのみ)
+
+    /// @brief ペンの記述子を作ります。
+    static GDI_RESOURCE_KEY Pen(int nStyle, int nWidth, std::uint32_t color);
+    /// @brief 単色のブラシの記述子を作ります。
+    static GDI_RESOURCE_KEY SolidBrush(std::uint32_t color);
+    /// @brief フォントの記述子を作ります (書体名の終端以降は0にそろえます)。
+    static GDI_RESOURCE_KEY Font(const GDI_FONT_DESC &font);
+#ifdef _WIN32
+    /// @brief LOGFONTW からフォントの記述子を作ります。
+    static GDI_RESOURCE_KEY Font(const LOGFONTW &logFont);
+#endif
+
+    bool operator==(const GDI_RESOURCE_KEY &other) const;
+};
+
+/**
+ * @class CGdiResourceCache
+ * @brief GDIオブジェクトのプロセス全体のキャッシュ (静的メンバのみ)
+ * @details 参照はロックで保護するため、任意のスレッドから呼び出せます。同時に使う記述子は数十個程度のため、
+ * 登録は線形探索します。登録数の上限は目安で、固定または保持されている登録は上限を超えても破棄しません。
+ */
+class CGdiResourceCache
+{
+public:
+    /**
+     * @brief GDIオブジェクトを生成するバックエンド関数
+     * @param[in] key 記述子
+     * @return ハンドル (生成できなかった場合は0)
+     */
+    using CreateFunc = std::uintptr_t (*)(const GDI_RESOURCE_KEY &key);
+    /**
+     * @brief GDIオブジェクトを破棄するバックエンド関数
+     * @param[in] hObject ハンドル
+     */
+    using DestroyFunc = void (*)(std::uintptr_t hObject);
+
+    /**
+     * @struct Stats
+     * @brief キャッシュの累計回数と現在の登録数
+     */
+    struct Stats
+    {
+        std::uint64_t nLookups;   ///< 参照回数 (Get と Acquire の呼び出し回数)
+        std::uint64_t nHits;      ///< 登録済みのハンドルを返した回数
+        std::uint64_t nCreates;   ///< バックエンドで生成した回数
+        std::uint64_t nDestroys;  ///< バックエンドで破棄した回数
+        std::uint64_t nEvictions; ///< 上限を超えたために破棄した回数 (nDestroys に含まれます)
+        std::uint64_t nFrames;    ///< 終えたフレームの数
+        std::size_t nLive;        ///< 現在の登録数 (生存しているハンドル数)
+        std::size_t nPeakLive;    ///< 登録数の最大値
+    };
+
+    /// @brief 登録数の上限の既定値
+    static constexpr std::size_t DEFAULT_CAPACITY = 64;
+
+    /**
+     * @brief 記述子のハンドルを取得します (なければ生成して登録します)。
+     * @details ハンドルは現在のフレームの終わりまで有効です。フレームの外で呼び出した場合は、次のフレームの終わりまで有効です。
+     * 返したハンドルを呼び出し側で破棄しないでください。
+     * @param[in] key 記述子
+     * @return ハンドル (生成できなかった場合は0)
+     */
+    static std::uintptr_t Get(const GDI_RESOURCE_KEY &key);
+
+    /**
+     * @brief 記述子のハンドルを保持して取得します (なければ生成して登録します)。
+     * @details ハンドルは、同じ回数だけ Release() を呼び出すまで破棄されません。
+     * コントロールのメンバとして長く使うハンドルに使います。
+     * @param[in] key 記述子
+     * @return ハンドル (生成できなかった場合は0)
+     */
+    static std::uintptr_t Acquire(const GDI_RESOURCE_KEY &key);
+
+    /**
+     * @brief Acquire() で保持したハンドルを手放します。
+     * @details 登録は破棄せずに残し、他の要求で再利用します。0や登録のないハンドルは無視します。
+     * @param[in] hObject ハンドル
+     */
+    static void Release(std::uintptr_t hObject);
+
+    /// @brief 描画のフレームを開始します (入れ子にできます)。
+    static void BeginFrame();
+    /// @brief 描画のフレームを終えます。一番外側のフレームの終わりに、上限を超えた分の登録を破棄します。
+    static void EndFrame();
+
+    /// @brief 登録数の上限を設定します (次のフレームの終わりから適用します)。
+    static void SetCapacity(std::size_t nCapacity);
+
+    /**
+     * @brief 生成と破棄のバックエンドを設定し、全ての登録を破棄します。
+     * @details 既定のバックエンドは、WindowsではGDIの関数、それ以外の環境ではnullptr (生成しない) です。
+     * 登録は設定前のバックエンドで破棄するため、ハンドルを使っている間は呼び出さないでください。
+     * @param[in] pfnCreate 生成する関数 (nullptrなら生成しません)
+     * @param[in] pfnDestroy 破棄する関数 (nullptrなら破棄しません)
+     */
+    static void SetBackend(CreateFunc pfnCreate, DestroyFunc pfnDestroy);
+
+    /// @brief 累計回数と現在の登録数を返します。
+    static Stats GetStats();
+    /// @brief 累計回数を0に戻します (登録数の最大値は現在の登録数に戻します)。
+    static void ResetStats();
+    /// @brief 累計回数を1行のテキストで返します (診断情報の書き出し用)。
+    static std::string FormatStats();
+};
+
+/**
+ * @class CGdiFrameScope
+ * @brief 描画のフレームの範囲を表すクラス
+ * @details 構築時に CGdiResourceCache::BeginFrame()、破棄時に CGdiResourceCache::EndFrame() を呼び出します。
+ * 描画処理 (OnPaint / OnDraw) の先頭で構築し、その中で Get() したハンドルが描画の途中で破棄されないようにします。
+ */
+class CGdiFrameScope
+{
+public:
+    CGdiFrameScope() { CGdiResourceCache::BeginFrame(); }
+    ~CGdiFrameScope() { CGdiResourceCache::EndFrame(); }
+
+    CGdiFrameScope(const CGdiFrameScope &) = delete;
+    CGdiFrameScope &operator=(const CGdiFrameScope &) = delete;
+};
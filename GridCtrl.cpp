@@ -4,35 +4,22 @@
  */
 #include "pch.h"
 #include "GridCtrl.h"
-
- // --- 定数定義 ---
-
- // 色の定義
-const COLORREF CLR_WHITE = RGB(255, 255, 255);       ///< 白色
-const COLORREF CLR_GRAY = RGB(240, 240, 240);       ///< 編集不可セルのデフォルト背景色 (灰色)
-const COLORREF CLR_BLUE_BG = RGB(0, 0, 230);        ///< 選択状態のセルの背景色 (青色)
-const COLORREF CLR_YELLOW = RGB(255, 255, 224);   ///< 編集状態のセル or 空欄の編集可能セルの背景色 (薄黄色)
-const COLORREF CLR_BORDER = RGB(192, 192, 192);   ///< グリッドの枠線色 (銀色)
-const COLORREF CLR_ORANGE = RGB(255, 192, 128);   ///< 正の数の場合の背景色
-const COLORREF CLR_BLUE_TEXT = RGB(0, 0, 255);    ///< 正の数の場合の文字色
-const COLORREF CLR_BLUE2_BG = RGB(120, 210, 230); ///< 負の数の場合の背景色
-const COLORREF CLR_RED_TEXT = RGB(255, 0, 0);     ///< 負の数の場合の文字色
-const COLORREF CLR_BLACK = RGB(0, 0, 0);          ///< デフォルトの文字色
+#include "InputTrace.h"
+#include "PaintMetrics.h"
+#include "RenderTarget.h"
 
 /**
  * @brief CGridCtrlクラスのコンストラクタ
  * @details 各メンバ変数を初期値に設定します。
  */
 CGridCtrl::CGridCtrl(int nMaxVisibleRows)
-    : m_nRows(0), m_nCols(0),
-    m_nRowHeight(22),
-    m_defaultBgColor(CLR_GRAY),
-    m_selectedCell(-1, -1),
+    : m_model(nMaxVisibleRows),
     m_bIsActive(FALSE),
     m_pEdit(nullptr),
-    m_nTopRow(0)
+    m_bDragPending(FALSE),
+    m_ptDragStart(0, 0),
+    m_bFrameTimer(FALSE)
 {
-    m_nMaxVisibleRows = nMaxVisibleRows;
 }
 
 /**
@@ -48,36 +35,18 @@ CGridCtrl::~CGridCtrl()
 /**
  * @brief グリッドの基本構成（行数・列数）を設定します。
  * @details この関数は、他のプロパティ設定の前に呼び出す必要があります。
+ * 全てのセルは編集不可・デフォルトの背景色・空文字列に、列幅は既定値に戻ります。
  * @param[in] nRows 設定する行数。
  * @param[in] nCols 設定する列数。
  * @return セットアップが成功した場合はTRUE。
  */
 BOOL CGridCtrl::SetupGrid(int nRows, int nCols)
 {
-    if (nRows <= 0 || nCols <= 0)
+    if (!m_model.Setup(nRows, nCols))
     {
         ASSERT(FALSE);
         return FALSE;
     }
-    m_nRows = nRows;
-    m_nCols = nCols;
-
-    // セルと列幅の情報を保持するベクターをリサイズ
-    m_cells.resize(m_nRows * m_nCols);
-    m_colWidths.resize(m_nCols);
-
-    // デフォルト値で初期化
-    for (int i = 0; i < m_nCols; ++i)
-    {
-        m_colWidths[i] = 80; // デフォルトの列幅
-    }
-    for (size_t i = 0; i < m_cells.size(); ++i)
-    {
-        m_cells[i].m_bgColor = m_defaultBgColor;
-        m_cells[i].m_bEditable = FALSE;
-    }
-
-    m_nTopRow = 0;
     return TRUE;
 }
 
@@ -87,8 +56,7 @@ BOOL CGridCtrl::SetupGrid(int nRows, int nCols)
  */
 void CGridCtrl::SetRowHeight(int nHeight)
 {
-    if (nHeight > 0)
-        m_nRowHeight = nHeight;
+    m_model.SetRowHeight(nHeight);
 }
 
 /**
@@ -98,10 +66,7 @@ void CGridCtrl::SetRowHeight(int nHeight)
  */
 void CGridCtrl::SetColumnWidth(int nCol, int nWidth)
 {
-    if (nCol >= 0 && nCol < m_nCols && nWidth > 0)
-    {
-        m_colWidths[nCol] = nWidth;
-    }
+    m_model.SetColumnWidth(nCol, nWidth);
 }
 
 /**
@@ -110,7 +75,7 @@ void CGridCtrl::SetColumnWidth(int nCol, int nWidth)
  */
 void CGridCtrl::SetDefaultBgColor(COLORREF color)
 {
-    m_defaultBgColor = color;
+    m_model.SetDefaultBgColor(color);
 }
 
 /**
@@ -121,9 +86,7 @@ void CGridCtrl::SetDefaultBgColor(COLORREF color)
  */
 void CGridCtrl::SetCellText(int nRow, int nCol, const CString& strText)
 {
-    int index = GetCellIndex(nRow, nCol);
-    if (index != -1)
-        m_cells[index].m_strText = strText;
+    m_model.SetCellText(nRow, nCol, strText, strText.GetLength());
 }
 
 /**
@@ -134,8 +97,8 @@ void CGridCtrl::SetCellText(int nRow, int nCol, const CString& strText)
  */
 CString CGridCtrl::GetCellText(int nRow, int nCol) const
 {
-    int index = GetCellIndex(nRow, nCol);
-    return (index != -1) ? m_cells[index].m_strText : CString();
+    const std::wstring& strText = m_model.GetCellText(nRow, nCol);
+    return CString(strText.c_str(), static_cast<int>(strText.size()));
 }
 
 /**
@@ -147,13 +110,7 @@ CString CGridCtrl::GetCellText(int nRow, int nCol) const
  */
 void CGridCtrl::SetCellEditable(int nRow, int nCol, BOOL bEditable)
 {
-    int index = GetCellIndex(nRow, nCol);
-    if (index != -1)
-    {
-        m_cells[index].m_bEditable = bEditable;
-        // 編集可能なセルは背景色を白にする（デフォルトの挙動）
-        m_cells[index].m_bgColor = bEditable ? CLR_WHITE : m_defaultBgColor;
-    }
+    m_model.SetCellEditable(nRow, nCol, bEditable != FALSE);
 }
 
 /**
@@ -164,8 +121,7 @@ void CGridCtrl::SetCellEditable(int nRow, int nCol, BOOL bEditable)
  */
 BOOL CGridCtrl::IsCellEditable(int nRow, int nCol) const
 {
-    int index = GetCellIndex(nRow, nCol);
-    return (index != -1) ? m_cells[index].m_bEditable : FALSE;
+    return m_model.IsCellEditable(nRow, nCol) ? TRUE : FALSE;
 }
 
 /**
@@ -176,9 +132,61 @@ BOOL CGridCtrl::IsCellEditable(int nRow, int nCol) const
  */
 void CGridCtrl::SetCellBgColor(int nRow, int nCol, COLORREF color)
 {
-    int index = GetCellIndex(nRow, nCol);
-    if (index != -1)
-        m_cells[index].m_bgColor = color;
+    m_model.SetCellBgColor(nRow, nCol, color);
+}
+
+/**
+ * @brief セルの書式を登録し、番号を返します。
+ * @param[in] style 書式
+ * @return 書式の番号。登録できない場合は-1。
+ */
+int CGridCtrl::AddCellStyle(const GRID_CELL_STYLE& style)
+{
+    return m_model.AddStyle(style);
+}
+
+/**
+ * @brief 指定したセルの書式を設定します。
+ * @param[in] nRow 行インデックス (0始まり)
+ * @param[in] nCol 列インデックス (0始まり)
+ * @param[in] nStyle 書式の番号
+ */
+void CGridCtrl::SetCellStyle(int nRow, int nCol, int nStyle)
+{
+    m_model.SetCellStyle(nRow, nCol, nStyle);
+}
+
+/**
+ * @brief 指定した行の全てのセルの書式を設定します。
+ * @param[in] nRow 行インデックス (0始まり)
+ * @param[in] nStyle 書式の番号
+ */
+void CGridCtrl::SetRowStyle(int nRow, int nStyle)
+{
+    m_model.ApplyStyleToRow(nRow, nStyle);
+}
+
+/**
+ * @brief 指定した列の全てのセルの書式を設定します。
+ * @param[in] nCol 列インデックス (0始まり)
+ * @param[in] nStyle 書式の番号
+ */
+void CGridCtrl::SetColumnStyle(int nCol, int nStyle)
+{
+    m_model.ApplyStyleToColumn(nCol, nStyle);
+}
+
+/**
+ * @brief 矩形の範囲のセルの書式を設定します。
+ * @param[in] nFirstRow 最初の行
+ * @param[in] nFirstCol 最初の列
+ * @param[in] nLastRow 最後の行
+ * @param[in] nLastCol 最後の列
+ * @param[in] nStyle 書式の番号
+ */
+void CGridCtrl::SetRangeStyle(int nFirstRow, int nFirstCol, int nLastRow, int nLastCol, int nStyle)
+{
+    m_model.ApplyStyleToRange(nFirstRow, nFirstCol, nLastRow, nLastCol, nStyle);
 }
 
 
@@ -187,6 +195,10 @@ void CGridCtrl::SetCellBgColor(int nRow, int nCol, COLORREF color)
 BEGIN_MESSAGE_MAP(CGridCtrl, CWnd)
     ON_WM_PAINT()
     ON_WM_LBUTTONDOWN()
+    ON_WM_LBUTTONUP()
+    ON_WM_MOUSEMOVE()
+    ON_WM_CAPTURECHANGED()
+    ON_WM_TIMER()
     ON_WM_GETDLGCODE()
     ON_WM_KEYDOWN()
     ON_WM_SETFOCUS()
@@ -238,12 +250,8 @@ BOOL CGridCtrl::Create(const RECT& rect, CWnd* pParentWnd, UINT nID)
     }
 
     // 列幅と行高の合計から、コントロールの正しいサイズを計算
-    int totalWidth = 0;
-    for (int i = 0; i < m_nCols; ++i)
-    {
-        totalWidth += m_colWidths[i];
-    }
-    int totalHeight = m_nRows * m_nRowHeight;
+    int totalWidth = m_model.GetRequiredWidth();
+    int totalHeight = m_model.GetRows() * m_model.GetRowHeight();
 
     // 渡されたrectの左上座標は維持し、サイズを計算値で上書き
     CRect newRect = rect;
@@ -256,10 +264,12 @@ BOOL CGridCtrl::Create(const RECT& rect, CWnd* pParentWnd, UINT nID)
 /**
  * @brief 描画イベント(WM_PAINT)を処理します。
  * @details ダブルバッファリングを用いて、グリッドの内容全体を描画します。
- * セルの状態（編集可否、内容、選択状態など）に応じて動的に色を変えて描画します。
+ * セルの描画は CGridPainter に任せ、メモリDCを描画先とする CGdiRenderTarget に描画します。
  */
 void CGridCtrl::OnPaint()
 {
+    CInputTraceScope trace("CGridCtrl::OnPaint", true);
+    CPaintMetricsScope metrics(CPaintMetrics::SITE_GRID_PAINT);
     CPaintDC dc(this);
     CRect clientRect;
     GetClientRect(&clientRect);
@@ -270,97 +280,29 @@ void CGridCtrl::OnPaint()
     CBitmap bmp;
     bmp.CreateCompatibleBitmap(&dc, clientRect.Width(), clientRect.Height());
     CBitmap* pOldBmp = memDC.SelectObject(&bmp);
+    metrics.AddAllocations(2); // メモリDC、ビットマップ
 
-    memDC.FillSolidRect(clientRect, CLR_WHITE);
-
-    CPen pen(PS_SOLID, 1, CLR_BORDER);
-    CPen* pOldPen = memDC.SelectObject(&pen);
+    {
+        // 描画先はこのブロックの間だけ構築し、破棄時にメモリDCの状態を元に戻す
+        CGdiRenderTarget memTarget(memDC.GetSafeHdc(), clientRect.Width(), clientRect.Height());
+        CGdiRenderTarget screenTarget(dc.GetSafeHdc(), clientRect.Width(), clientRect.Height());
 
-    // 表示する行の範囲を計算 (スクロール位置を考慮)
-    int nStartRow = m_nTopRow;
-    int nEndRow = min(m_nRows, m_nTopRow + m_nMaxVisibleRows);
+        GRID_PAINT_STATE state = m_model.GetPaintState(clientRect.Width(), clientRect.Height());
+        state.bEditing = m_pEdit != nullptr;
+        state.bActive = m_bIsActive != FALSE;
+        metrics.AddItems(static_cast<std::uint32_t>(CGridPainter::Paint(memTarget, state, m_model)));
 
-    // 表示範囲のセルを描画
-    for (int row = nStartRow; row < nEndRow; ++row)
-    {
-        for (int col = 0; col < m_nCols; ++col)
+        // フォーカス枠を描画
+        const GRID_CELL_POS& selection = m_model.GetSelection();
+        if (GetFocus() == this && selection.IsValid())
         {
-            CRect cellRect = GetCellRect(row, col);
-            int index = GetCellIndex(row, col);
-            if (index == -1) continue;
-
-            CellInfo& cell = m_cells[index];
-            COLORREF bgColor = cell.m_bgColor;
-            COLORREF textColor = CLR_BLACK;
-
-            // 編集可能セルの場合、内容に応じて色を上書き
-            if (cell.m_bEditable)
-            {
-                CString strText = cell.m_strText;
-                strText.Trim();
-                if (strText.IsEmpty())
-                {
-                    bgColor = CLR_YELLOW; // 空欄
-                }
-                else
-                {
-                    LPTSTR pEnd;
-                    double dValue = _tcstod(strText, &pEnd);
-                    if (*pEnd == _T('\0')) // 数値の場合
-                    {
-                        if (dValue < 0) { bgColor = CLR_BLUE2_BG; textColor = CLR_RED_TEXT; } // 負の数
-                        else if (dValue > 0) { bgColor = CLR_ORANGE; textColor = CLR_BLUE_TEXT; } // 正の数
-                    }
-                }
-            }
-
-            // 選択/編集状態の色を最優先で適用
-            if (m_selectedCell.x == col && m_selectedCell.y == row)
-            {
-                bgColor = (m_pEdit != nullptr) ? CLR_YELLOW : CLR_BLUE_BG;
-                if (m_pEdit == nullptr) textColor = CLR_BLACK;
-            }
-
-            // セルの背景と枠線を描画
-            memDC.FillSolidRect(cellRect, bgColor);
-            memDC.MoveTo(cellRect.left, cellRect.top);
-            memDC.LineTo(cellRect.right - 1, cellRect.top);
-            memDC.LineTo(cellRect.right - 1, cellRect.bottom - 1);
-            memDC.LineTo(cellRect.left, cellRect.bottom - 1);
-            memDC.LineTo(cellRect.left, cellRect.top);
-
-            // セルのテキストを描画
-            memDC.SetBkMode(TRANSPARENT);
-            memDC.SetTextColor(textColor);
-            cellRect.DeflateRect(4, 2);
-            memDC.DrawText(cell.m_strText, cellRect, DT_LEFT | DT_VCENTER | DT_SINGLELINE | DT_NOPREFIX);
+            CRect focusRect = GetCellRect(selection.nRow, selection.nCol);
+            dc.DrawFocusRect(focusRect);
         }
-    }
-    memDC.SelectObject(pOldPen);
 
-    // フォーカス枠を描画
-    if (GetFocus() == this && m_selectedCell.x != -1)
-    {
-        CRect focusRect = GetCellRect(m_selectedCell.y, m_selectedCell.x);
-        dc.DrawFocusRect(focusRect);
+        // メモリDCから画面DCへ一括転送
+        screenTarget.Blit(0, 0, clientRect.Width(), clientRect.Height(), memTarget, 0, 0);
     }
-
-    // このグリッドがアクティブな場合、外枠を青で囲む
-    if (m_bIsActive)
-    {
-        CPen borderPen(PS_SOLID, 3, RGB(0, 0, 255));
-        CBrush* pOldBrush = (CBrush*)memDC.SelectStockObject(NULL_BRUSH);
-        CPen* pOldPenBorder = memDC.SelectObject(&borderPen);
-        CRect rcClient;
-        GetClientRect(&rcClient);
-        rcClient.DeflateRect(1, 1);
-        memDC.Rectangle(rcClient);
-        memDC.SelectObject(pOldBrush);
-        memDC.SelectObject(pOldPenBorder);
-    }
-
-    // メモリDCから画面DCへ一括転送
-    dc.BitBlt(0, 0, clientRect.Width(), clientRect.Height(), &memDC, 0, 0, SRCCOPY);
     memDC.SelectObject(pOldBmp);
 }
 
@@ -376,38 +318,38 @@ void CGridCtrl::OnLButtonDown(UINT nFlags, CPoint point)
     GetParent()->PostMessage(WM_GRID_ACTIVATED, GetDlgCtrlID());
     SetFocus();
 
-    CPoint cell = HitTest(point);
-    if (cell.x == -1) // グリッド外
+    // スクロール可能な場合は、ドラッグによるスクロールに備えてマウスをキャプチャ
+    // (進行中の慣性スクロールはタッチした時点で止める)
+    if (GetMaxScrollOffset() > 0)
+    {
+        StopKineticScroll();
+        m_bDragPending = TRUE;
+        m_ptDragStart = point;
+        SetCapture();
+    }
+
+    GRID_CELL_POS cell = m_model.HitTest(point.x, point.y);
+    if (!cell.IsValid()) // グリッド外
     {
         DestroyInPlaceEdit(TRUE);
-        m_selectedCell = CPoint(-1, -1);
+        m_model.SetSelection(GRID_NO_CELL);
         Invalidate();
         return;
     }
 
-    if (!IsCellEditable(cell.y, cell.x))
+    if (!m_model.IsCellEditable(cell.nRow, cell.nCol))
     {
         return; // 編集不可セルは選択しない
     }
 
-    if (cell == m_selectedCell) // 選択中のセルを再クリック
+    if (cell == m_model.GetSelection()) // 選択中のセルを再クリック
     {
         if (m_pEdit == nullptr) CreateInPlaceEdit(); // 編集開始
     }
     else // 別の編集可能セルをクリック
     {
         DestroyInPlaceEdit(TRUE); // 前の編集を確定
-        m_selectedCell = cell;
-
-        // 親ウィンドウに行選択の変更を通知 (WM_NOTIFY)
-        NM_GRIDVIEW nm;
-        nm.hdr.hwndFrom = GetSafeHwnd();
-        nm.hdr.idFrom = GetDlgCtrlID();
-        nm.hdr.code = GCN_SELCHANGED;
-        nm.iRow = m_selectedCell.y;
-        nm.iCol = m_selectedCell.x;
-        GetParent()->SendMessage(WM_NOTIFY, GetDlgCtrlID(), (LPARAM)&nm);
-
+        SelectCell(cell);
         Invalidate();
     }
 }
@@ -445,42 +387,22 @@ void CGridCtrl::OnKeyDown(UINT nChar, UINT nRepCnt, UINT nFlags)
     case VK_LEFT:
     case VK_RIGHT:
     {
-        if (m_selectedCell.x == -1) // 何も選択されていない場合
+        if (!m_model.GetSelection().IsValid()) // 何も選択されていない場合
         {
             // 親ウィンドウにナビゲーションを依頼
             GetParent()->PostMessage(WM_GRID_NAV_BOUNDARY_HIT, (WPARAM)nChar, (LPARAM)GetDlgCtrlID());
             return;
         }
 
-        BOOL bMoved = FALSE;
+        // 押された方向に編集可能なセルを探す
         int dx = (nChar == VK_LEFT) ? -1 : (nChar == VK_RIGHT) ? 1 : 0;
         int dy = (nChar == VK_UP) ? -1 : (nChar == VK_DOWN) ? 1 : 0;
-        CPoint searchCell = m_selectedCell;
-
-        // 押された方向に編集可能なセルを探す
-        while (TRUE)
-        {
-            searchCell.x += dx;
-            searchCell.y += dy;
-            if (searchCell.x < 0 || searchCell.x >= m_nCols || searchCell.y < 0 || searchCell.y >= m_nRows) break;
-            if (IsCellEditable(searchCell.y, searchCell.x))
-            {
-                m_selectedCell = searchCell;
-                bMoved = TRUE;
-                break;
-            }
-        }
+        GRID_CELL_POS newSel = m_model.FindEditable(m_model.GetSelection(), dx, dy);
 
-        if (bMoved) // 移動できた場合
+        if (newSel.IsValid()) // 移動できた場合
         {
-            NM_GRIDVIEW nm;
-            nm.hdr.hwndFrom = GetSafeHwnd();
-            nm.hdr.idFrom = GetDlgCtrlID();
-            nm.hdr.code = GCN_SELCHANGED;
-            nm.iRow = m_selectedCell.y;
-            nm.iCol = m_selectedCell.x;
-            GetParent()->SendMessage(WM_NOTIFY, GetDlgCtrlID(), (LPARAM)&nm);
-            EnsureCellVisible(m_selectedCell.y, m_selectedCell.x);
+            SelectCell(newSel);
+            EnsureCellVisible(newSel.nRow, newSel.nCol);
             Invalidate();
         }
         else // 端に到達した場合
@@ -492,89 +414,25 @@ void CGridCtrl::OnKeyDown(UINT nChar, UINT nRepCnt, UINT nFlags)
     case VK_PRIOR: // Page Up
     case VK_NEXT:  // Page Down
     {
-        if (m_selectedCell.x == -1) break;
-        int nStep = (nChar == VK_PRIOR) ? -m_nMaxVisibleRows : m_nMaxVisibleRows;
-        int nDirection = (nChar == VK_PRIOR) ? -1 : 1;
-
-        // 1. まず目標となる行を計算
-        int targetRow = m_selectedCell.y + nStep;
-        if (targetRow < 0)
-            targetRow = 0;
-        if (targetRow >= m_nRows)
-            targetRow = m_nRows - 1;
-
-        CPoint newSel(-1, -1);
-
-        // 2. 同じ列内で、目標地点から近い編集可能セルを探す
-        int searchRow = targetRow;
-        while (searchRow >= 0 && searchRow < m_nRows)
-        {
-            if (IsCellEditable(searchRow, m_selectedCell.x))
-            {
-                newSel.x = m_selectedCell.x;
-                newSel.y = searchRow;
-                break;
-            }
-            searchRow += nDirection; // PageUpなら上へ, PageDownなら下へ探索
-        }
+        if (!m_model.GetSelection().IsValid()) break;
 
-        // 3. もし同じ列に見つからなければ、一番端の編集可能セルに移動する
-        if (newSel.x == -1)
-        {
-            if (nChar == VK_PRIOR) // PageUpの場合は、一番最初の編集可能セルへ
-            {
-                for (int r = 0; r < m_nRows; ++r)
-                {
-                    for (int c = 0; c < m_nCols; ++c)
-                    {
-                        if (IsCellEditable(r, c))
-                        {
-                            newSel = CPoint(c, r);
-                            goto found; // 二重ループを抜ける
-                        }
-                    }
-                }
-            }
-            else // PageDownの場合は、一番最後の編集可能セルへ
-            {
-                for (int r = m_nRows - 1; r >= 0; --r)
-                {
-                    for (int c = m_nCols - 1; c >= 0; --c)
-                    {
-                        if (IsCellEditable(r, c))
-                        {
-                            newSel = CPoint(c, r);
-                            goto found; // 二重ループを抜ける
-                        }
-                    }
-                }
-            }
-        found:;
-        }
+        // 表示行数だけ離れた行の近くの編集可能セル (同じ列になければ一番端の編集可能セル) を探す
+        GRID_CELL_POS newSel = m_model.FindPageTarget(m_model.GetSelection(), nChar == VK_NEXT);
 
-        // 4. 移動先が見つかったら、選択を更新してスクロール
-        if (newSel.x != -1 && newSel != m_selectedCell)
+        // 移動先が見つかったら、選択を更新してスクロール
+        if (newSel.IsValid() && newSel != m_model.GetSelection())
         {
-            m_selectedCell = newSel;
-
-            // 親ウィンドウに選択変更を通知
-            NM_GRIDVIEW nm;
-            nm.hdr.hwndFrom = GetSafeHwnd();
-            nm.hdr.idFrom = GetDlgCtrlID();
-            nm.hdr.code = GCN_SELCHANGED;
-            nm.iRow = m_selectedCell.y;
-            nm.iCol = m_selectedCell.x;
-            GetParent()->SendMessage(WM_NOTIFY, GetDlgCtrlID(), (LPARAM)&nm);
+            SelectCell(newSel);
 
             // 新しく選択されたセルが表示されるようにスクロール
-            EnsureCellVisible(m_selectedCell.y, m_selectedCell.x);
+            EnsureCellVisible(newSel.nRow, newSel.nCol);
             Invalidate();
         }
         break;
     }
     case VK_F2:
     case VK_RETURN:
-        if (m_selectedCell.x != -1) CreateInPlaceEdit();
+        if (m_model.GetSelection().IsValid()) CreateInPlaceEdit();
         break;
     default:
         CWnd::OnKeyDown(nChar, nRepCnt, nFlags);
@@ -589,26 +447,13 @@ void CGridCtrl::OnKeyDown(UINT nChar, UINT nRepCnt, UINT nFlags)
  */
 void CGridCtrl::EnsureCellVisible(int nRow, int nCol)
 {
-    if (m_nRows <= m_nMaxVisibleRows) return;
+    if (m_model.GetRows() <= m_model.GetMaxVisibleRows()) return;
 
-    int newTopRow = m_nTopRow;
-    if (nRow < m_nTopRow)
-    {
-        newTopRow = nRow;
-    }
-    else if (nRow >= m_nTopRow + m_nMaxVisibleRows)
-    {
-        newTopRow = nRow - m_nMaxVisibleRows + 1;
-    }
+    // キー操作による移動を優先し、進行中の慣性スクロールは止める
+    StopKineticScroll();
 
-    if (newTopRow != m_nTopRow)
-    {
-        int maxScrollPos = m_nRows - m_nMaxVisibleRows;
-        newTopRow = max(0, min(newTopRow, maxScrollPos));
-        m_nTopRow = newTopRow;
-        SetScrollPos(SB_VERT, m_nTopRow, TRUE);
-        Invalidate();
-    }
+    // ピクセル単位で判定し、行の途中で止まっている場合も行全体が見えるようにする
+    SetScrollOffset(m_model.GetScrollOffsetToShow(nRow));
 }
 
 
@@ -620,7 +465,7 @@ void CGridCtrl::EnsureCellVisible(int nRow, int nCol)
 void CGridCtrl::OnSetFocus(CWnd* pOldWnd)
 {
     CWnd::OnSetFocus(pOldWnd);
-    if (m_selectedCell.x == -1)
+    if (!m_model.GetSelection().IsValid())
     {
         MoveSelection(1, 0);
     }
@@ -656,16 +501,8 @@ void CGridCtrl::OnKillFocus(CWnd* pNewWnd)
  */
 CRect CGridCtrl::GetCellRect(int nRow, int nCol) const
 {
-    if (nRow < m_nTopRow || nRow >= m_nTopRow + m_nMaxVisibleRows)
-    {
-        return CRect(0, 0, 0, 0); // 画面外
-    }
-    int left = 0;
-    for (int i = 0; i < nCol; ++i) left += m_colWidths[i];
-    int right = left + m_colWidths[nCol];
-    int top = (nRow - m_nTopRow) * m_nRowHeight;
-    int bottom = top + m_nRowHeight;
-    return CRect(left, top, right, bottom);
+    const REGION_RECT rect = m_model.GetCellRect(nRow, nCol);
+    return CRect(rect.left, rect.top, rect.right, rect.bottom);
 }
 
 /**
@@ -675,31 +512,18 @@ CRect CGridCtrl::GetCellRect(int nRow, int nCol) const
  */
 CPoint CGridCtrl::HitTest(const CPoint& point) const
 {
-    int row = (point.y / m_nRowHeight) + m_nTopRow;
-    if (row < 0 || row >= m_nRows) return CPoint(-1, -1);
-
-    int currentX = 0;
-    for (int col = 0; col < m_nCols; ++col)
-    {
-        currentX += m_colWidths[col];
-        if (point.x < currentX)
-        {
-            return CPoint(col, row);
-        }
-    }
-    return CPoint(-1, -1);
+    const GRID_CELL_POS cell = m_model.HitTest(point.x, point.y);
+    return CPoint(cell.nCol, cell.nRow);
 }
 
 /**
  * @brief グリッドの全コンテンツを表示するために必要な高さを返します。
- * @details m_nMaxVisibleRowsまでの高さを返します。
+ * @details 一度に表示する最大行数までの高さを返します。
  * @return 必要な高さ(ピクセル)
  */
 int CGridCtrl::GetRequiredHeight() const
 {
-    if (m_nRows == 0) return 0;
-    int nVisibleRows = min(m_nRows, m_nMaxVisibleRows);
-    return nVisibleRows * m_nRowHeight;
+    return m_model.GetRequiredHeight();
 }
 
 /**
@@ -708,29 +532,24 @@ int CGridCtrl::GetRequiredHeight() const
  */
 int CGridCtrl::GetRequiredWidth() const
 {
-    if (m_nCols == 0) return 0;
-    int width = 0;
-    for (size_t i = 0; i < m_colWidths.size(); ++i)
-    {
-        width += m_colWidths[i];
-    }
-    return width;
+    return m_model.GetRequiredWidth();
 }
 
-
 /**
- * @brief 論理的な行・列インデックスから、1次元配列m_cellsのインデックスを計算します。
- * @param[in] nRow 行インデックス (0始まり)
- * @param[in] nCol 列インデックス (0始まり)
- * @return 配列のインデックス。範囲外の場合は-1。
+ * @brief 選択中のセルを設定し、親ウィンドウに行選択の変更を通知します (WM_NOTIFY, GCN_SELCHANGED)。
+ * @param[in] cell 新しく選択するセル
  */
-int CGridCtrl::GetCellIndex(int nRow, int nCol) const
+void CGridCtrl::SelectCell(const GRID_CELL_POS& cell)
 {
-    if (nRow >= 0 && nRow < m_nRows && nCol >= 0 && nCol < m_nCols)
-    {
-        return nRow * m_nCols + nCol;
-    }
-    return -1;
+    m_model.SetSelection(cell);
+
+    NM_GRIDVIEW nm;
+    nm.hdr.hwndFrom = GetSafeHwnd();
+    nm.hdr.idFrom = GetDlgCtrlID();
+    nm.hdr.code = GCN_SELCHANGED;
+    nm.iRow = cell.nRow;
+    nm.iCol = cell.nCol;
+    GetParent()->SendMessage(WM_NOTIFY, GetDlgCtrlID(), (LPARAM)&nm);
 }
 
 /**
@@ -738,13 +557,14 @@ int CGridCtrl::GetCellIndex(int nRow, int nCol) const
  */
 void CGridCtrl::CreateInPlaceEdit()
 {
-    if (m_pEdit || m_selectedCell.x == -1 || !IsCellEditable(m_selectedCell.y, m_selectedCell.x))
+    const GRID_CELL_POS& selection = m_model.GetSelection();
+    if (m_pEdit || !selection.IsValid() || !m_model.IsCellEditable(selection.nRow, selection.nCol))
         return;
 
-    CRect rect = GetCellRect(m_selectedCell.y, m_selectedCell.x);
+    CRect rect = GetCellRect(selection.nRow, selection.nCol);
     rect.DeflateRect(1, 1);
 
-    m_pEdit = new CInPlaceEdit(this, m_selectedCell, GetCellText(m_selectedCell.y, m_selectedCell.x));
+    m_pEdit = new CInPlaceEdit(this, GetSelectedCell(), GetCellText(selection.nRow, selection.nCol));
 
     if (!m_pEdit->Create(WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL, rect, this, 1))
     {
@@ -772,12 +592,13 @@ void CGridCtrl::DestroyInPlaceEdit(BOOL bUpdate)
     {
         CString text;
         m_pEdit->GetWindowText(text);
-        int index = GetCellIndex(m_selectedCell.y, m_selectedCell.x);
-        if (index != -1 && m_cells[index].m_strText != text)
+        const GRID_CELL_POS& selection = m_model.GetSelection();
+        if (m_model.GetCellIndex(selection.nRow, selection.nCol) != -1 &&
+            m_model.GetCellText(selection.nRow, selection.nCol) != static_cast<LPCTSTR>(text))
         {
-            m_cells[index].m_strText = text;
+            m_model.SetCellText(selection.nRow, selection.nCol, text, text.GetLength());
             // 親ウィンドウに変更を通知
-            GetParent()->PostMessage(WM_GRID_CELL_CHANGED, GetDlgCtrlID(), MAKELPARAM(m_selectedCell.y, m_selectedCell.x));
+            GetParent()->PostMessage(WM_GRID_CELL_CHANGED, GetDlgCtrlID(), MAKELPARAM(selection.nRow, selection.nCol));
         }
     }
 
@@ -791,6 +612,8 @@ void CGridCtrl::DestroyInPlaceEdit(BOOL bUpdate)
 
 /**
  * @brief カーソルキー入力に応じて、編集可能なセル間を選択移動します。
+ * @details 左右の移動は現在の行の中で、上下の移動は現在の列の中で、指定された方向に編集可能セルを探します。
+ * 見つからない場合は何もしません。
  * @param[in] dx 水平方向の移動量 (-1:左, 1:右, 0:移動なし)
  * @param[in] dy 垂直方向の移動量 (-1:上, 1:下, 0:移動なし)
  */
@@ -798,65 +621,16 @@ void CGridCtrl::MoveSelection(int dx, int dy)
 {
     if (m_pEdit)
         return; // 編集中は移動しない
-    if (m_selectedCell.x == -1)
+    if (!m_model.GetSelection().IsValid())
         return; // 未選択状態なら何もしない
 
-    CPoint currentCell = m_selectedCell;
-
-    if (dx != 0) // 左右移動の場合
-    {
-        int newCol = currentCell.x + dx;
-        // 現在の行の中で、指定された方向に編集可能セルを探す
-        while (newCol >= 0 && newCol < m_nCols)
-        {
-            int index = GetCellIndex(currentCell.y, newCol);
-            if (m_cells[index].m_bEditable)
-            {
-                m_selectedCell = CPoint(newCol, currentCell.y);
-                // 親ウィンドウに行選択の変更を通知する
-                NM_GRIDVIEW nm;
-                nm.hdr.hwndFrom = GetSafeHwnd();
-                nm.hdr.idFrom = GetDlgCtrlID();
-                nm.hdr.code = GCN_SELCHANGED;
-                nm.iRow = m_selectedCell.y;
-                nm.iCol = m_selectedCell.x;
-                GetParent()->SendMessage(WM_NOTIFY, GetDlgCtrlID(), (LPARAM)&nm);
-
-                Invalidate();
-                return; // 見つかったので選択を更新して終了
-            }
-            newCol += dx; // 見つからなければ、さらに同じ方向へ探索
-        }
-    }
-    else if (dy != 0) // 上下移動の場合
+    GRID_CELL_POS newSel = (dx != 0) ? m_model.FindEditable(m_model.GetSelection(), dx, 0)
+                                     : m_model.FindEditable(m_model.GetSelection(), 0, dy);
+    if (newSel.IsValid())
     {
-        int newRow = currentCell.y + dy;
-        // 現在の列の中で、指定された方向に編集可能セルを探す
-        while (newRow >= 0 && newRow < m_nRows)
-        {
-            int index = GetCellIndex(newRow, currentCell.x);
-
-            if (m_cells[index].m_bEditable)
-            {
-                m_selectedCell = CPoint(currentCell.x, newRow);
-                // 親ウィンドウに行選択の変更を通知する
-                NM_GRIDVIEW nm;
-                nm.hdr.hwndFrom = GetSafeHwnd();
-                nm.hdr.idFrom = GetDlgCtrlID();
-                nm.hdr.code = GCN_SELCHANGED;
-                nm.iRow = m_selectedCell.y;
-                nm.iCol = m_selectedCell.x;
-                GetParent()->SendMessage(WM_NOTIFY, GetDlgCtrlID(), (LPARAM)&nm);
-
-                Invalidate();
-                return; // 見つかったので選択を更新して終了
-            }
-            newRow += dy; // 見つからなければ、さらに同じ方向へ探索
-        }
+        SelectCell(newSel);
+        Invalidate();
     }
-
-    // ここに到達した場合、指定された方向に編集可能なセルは見つからなかった。
-    // 何もせずに関数を終了する。
 }
 
 /**
@@ -873,32 +647,18 @@ void CGridCtrl::SetActive(BOOL bActive)
     if (bActive)
     {
         // アクティブになった際、何も選択されていなければ最初の編集可能セルを選択
-        if (m_selectedCell.x == -1)
+        if (!m_model.GetSelection().IsValid())
         {
-            bool found = false;
-            for (int r = 0; r < m_nRows && !found; ++r) {
-                for (int c = 0; c < m_nCols; ++c) {
-                    if (IsCellEditable(r, c)) {
-                        m_selectedCell = CPoint(c, r);
-                        NM_GRIDVIEW nm;
-                        nm.hdr.hwndFrom = GetSafeHwnd();
-                        nm.hdr.idFrom = GetDlgCtrlID();
-                        nm.hdr.code = GCN_SELCHANGED;
-                        nm.iRow = m_selectedCell.y;
-                        nm.iCol = m_selectedCell.x;
-                        GetParent()->SendMessage(WM_NOTIFY, GetDlgCtrlID(), (LPARAM)&nm);
-                        found = true;
-                        break;
-                    }
-                }
-            }
+            GRID_CELL_POS first = m_model.FindFirstEditable();
+            if (first.IsValid())
+                SelectCell(first);
         }
     }
     else
     {
         // 非アクティブにされた場合、選択と編集を解除
         DestroyInPlaceEdit(FALSE);
-        m_selectedCell = CPoint(-1, -1);
+        m_model.SetSelection(GRID_NO_CELL);
     }
     Invalidate();
 }
@@ -911,21 +671,21 @@ void CGridCtrl::UpdateScrollbar()
 {
     if (GetSafeHwnd() == nullptr) return;
 
-    if (m_nRows > m_nMaxVisibleRows)
+    if (m_model.GetRows() > m_model.GetMaxVisibleRows())
     {
         SCROLLINFO si;
         si.cbSize = sizeof(SCROLLINFO);
         si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
         si.nMin = 0;
-        si.nMax = m_nRows - 1;
-        si.nPage = m_nMaxVisibleRows;
-        si.nPos = m_nTopRow;
+        si.nMax = m_model.GetRows() - 1;
+        si.nPage = m_model.GetMaxVisibleRows();
+        si.nPos = m_model.GetTopRow();
         SetScrollInfo(SB_VERT, &si, TRUE);
         ShowScrollBar(SB_VERT, TRUE);
     }
     else
     {
-        m_nTopRow = 0;
+        m_model.SetScrollOffset(0);
         ShowScrollBar(SB_VERT, FALSE);
     }
 }
@@ -939,32 +699,34 @@ void CGridCtrl::UpdateScrollbar()
  */
 void CGridCtrl::OnVScroll(UINT nSBCode, UINT nPos, CScrollBar* pScrollBar)
 {
-    int newTopRow = m_nTopRow;
+    // スクロールバーの操作は行単位で行い、進行中の慣性スクロールは止める
+    StopKineticScroll();
+    int nOffset = GetScrollOffset();
+    const int nTopRow = m_model.GetTopRow();
+    const int nRowHeight = m_model.GetRowHeight();
 
     switch (nSBCode)
     {
-    case SB_LINEUP: newTopRow--; break;
-    case SB_LINEDOWN: newTopRow++; break;
-    case SB_PAGEUP: newTopRow -= m_nMaxVisibleRows; break;
-    case SB_PAGEDOWN: newTopRow += m_nMaxVisibleRows; break;
-    case SB_THUMBTRACK: newTopRow = nPos; break;
+    case SB_LINEUP: nOffset = (m_model.GetRowOffset() > 0 ? nTopRow : nTopRow - 1) * nRowHeight; break;
+    case SB_LINEDOWN: nOffset = (nTopRow + 1) * nRowHeight; break;
+    case SB_PAGEUP: nOffset -= m_model.GetMaxVisibleRows() * nRowHeight; break;
+    case SB_PAGEDOWN: nOffset += m_model.GetMaxVisibleRows() * nRowHeight; break;
+    case SB_THUMBTRACK: nOffset = (int)nPos * nRowHeight; break;
     }
 
-    int maxScrollPos = m_nRows - m_nMaxVisibleRows;
-    newTopRow = max(0, min(newTopRow, maxScrollPos));
-
-    if (newTopRow == m_nTopRow) return;
+    nOffset = m_model.ClampScrollOffset(nOffset);
+    if (nOffset == GetScrollOffset()) return;
 
-    m_nTopRow = newTopRow;
-    SetScrollPos(SB_VERT, m_nTopRow, TRUE);
-    Invalidate();
+    SetScrollOffset(nOffset);
 
     CWnd::OnVScroll(nSBCode, nPos, pScrollBar);
 }
 
 /**
  * @brief マウスホイールイベント(WM_MOUSEWHEEL)を処理します。
- * @details マウスホイールの回転に応じて垂直スクロールを行います。
+ * @details 回転量を端数も含めて蓄積し、1ノッチ (WHEEL_DELTA) あたり1行の速さで目標位置へ滑らかに追従します。
+ * 高分解能ホイールやタッチパッドの小さな回転量も捨てずに反映されます。
+ * グリッド自身がスクロールできない場合は、親ウィンドウのスクロールに任せます。
  * @param[in] nFlags 修飾キーの状態
  * @param[in] zDelta ホイールの回転量
  * @param[in] pt カーソルの位置
@@ -972,10 +734,144 @@ void CGridCtrl::OnVScroll(UINT nSBCode, UINT nPos, CScrollBar* pScrollBar)
  */
 BOOL CGridCtrl::OnMouseWheel(UINT nFlags, short zDelta, CPoint pt)
 {
-    if (m_nRows > m_nMaxVisibleRows)
+    if (GetMaxScrollOffset() > 0)
     {
-        if (zDelta > 0) OnVScroll(SB_LINEUP, 0, nullptr);
-        else OnVScroll(SB_LINEDOWN, 0, nullptr);
+        m_scroller.SetRange(GetMaxScrollOffset());
+        if (!m_scroller.IsAnimating())
+        {
+            m_scroller.SetPosition(GetScrollOffset());
+        }
+        m_scroller.AddWheelDelta(CKineticScroller::NowMs(), zDelta, m_model.GetRowHeight());
+        StartFrameTimer();
+        return TRUE;
     }
     return CWnd::OnMouseWheel(nFlags, zDelta, pt);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 縦スクロール位置をピクセル単位で設定し、再描画を要求します。
+ * @param[in] nOffset 内容の先頭からのピクセル数 (範囲内にクランプされます)
+ */
+void CGridCtrl::SetScrollOffset(int nOffset)
+{
+    nOffset = m_model.ClampScrollOffset(nOffset);
+    if (nOffset == GetScrollOffset()) return;
+
+    // 編集中のエディットはセルとの位置がずれるため、確定して閉じる
+    DestroyInPlaceEdit(TRUE);
+
+    m_model.SetScrollOffset(nOffset);
+    SetScrollPos(SB_VERT, m_model.GetTopRow(), TRUE);
+    Invalidate();
+}
+
+/**
+ * @brief フレームタイマーを開始します (動作中なら何もしません)。
+ */
+void CGridCtrl::StartFrameTimer()
+{
+    if (!m_bFrameTimer && GetSafeHwnd() != nullptr)
+    {
+        SetTimer(ID_GRID_KINETIC_TIMER, CKineticScroller::FRAME_INTERVAL_MS, NULL);
+        m_bFrameTimer = TRUE;
+    }
+}
+
+/**
+ * @brief 進行中の慣性スクロールを停止し、フレームタイマーを止めます。
+ */
+void CGridCtrl::StopKineticScroll()
+{
+    m_scroller.Stop();
+    if (m_bFrameTimer)
+    {
+        KillTimer(ID_GRID_KINETIC_TIMER);
+        m_bFrameTimer = FALSE;
+    }
+}
+
+/**
+ * @brief マウス移動イベント(WM_MOUSEMOVE)を処理します。
+ * @details 押下位置からシステムのドラッグ閾値以上動いたらドラッグスクロールを開始します。
+ * 以降は位置の計算だけを行い、描画はフレームタイマーでまとめて行うため、
+ * 入力イベントが高頻度でも描画は1フレームに1回です。
+ * @param[in] nFlags 修飾キーの状態
+ * @param[in] point マウスカーソルのクライアント座標
+ */
+void CGridCtrl::OnMouseMove(UINT nFlags, CPoint point)
+{
+    if (m_bDragPending && (nFlags & MK_LBUTTON))
+    {
+        if (abs(point.y - m_ptDragStart.y) >= ::GetSystemMetrics(SM_CYDRAG))
+        {
+            m_bDragPending = FALSE;
+            DestroyInPlaceEdit(TRUE);
+            m_scroller.SetRange(GetMaxScrollOffset());
+            m_scroller.SetPosition(GetScrollOffset());
+            m_scroller.BeginDrag(CKineticScroller::NowMs(), point.y);
+            StartFrameTimer();
+        }
+    }
+    else if (m_scroller.IsDragging())
+    {
+        m_scroller.DragTo(CKineticScroller::NowMs(), point.y);
+    }
+    CWnd::OnMouseMove(nFlags, point);
+}
+
+/**
+ * @brief マウス左ボタン解放イベント(WM_LBUTTONUP)を処理します。
+ * @param[in] nFlags 修飾キーの状態
+ * @param[in] point マウスカーソルのクライアント座標
+ */
+void CGridCtrl::OnLButtonUp(UINT nFlags, CPoint point)
+{
+    if (m_scroller.IsDragging())
+    {
+        m_scroller.DragTo(CKineticScroller::NowMs(), point.y);
+    }
+    // キャプチャの解放により OnCaptureChanged でドラッグが終了する
+    if (GetCapture() == this)
+    {
+        ReleaseCapture();
+    }
+    CWnd::OnLButtonUp(nFlags, point);
+}
+
+/**
+ * @brief マウスキャプチャの喪失(WM_CAPTURECHANGED)を処理します。
+ * @details ボタンの解放以外の理由でキャプチャを失った場合も、ドラッグを終了して慣性に引き継ぎます。
+ * @param[in] pWnd 新しくキャプチャを得たウィンドウ
+ */
+void CGridCtrl::OnCaptureChanged(CWnd* pWnd)
+{
+    m_bDragPending = FALSE;
+    if (m_scroller.IsDragging())
+    {
+        m_scroller.EndDrag(CKineticScroller::NowMs());
+        StartFrameTimer();
+    }
+    CWnd::OnCaptureChanged(pWnd);
+}
+
+/**
+ * @brief タイマーイベント(WM_TIMER)を処理します。
+ * @details フレームタイマーの周期で慣性スクロールを進め、画素単位の位置が変わった場合だけ再描画します。
+ * 動作が終了したらタイマーを止めます。
+ * @param[in] nIDEvent タイマーID
+ */
+void CGridCtrl::OnTimer(UINT_PTR nIDEvent)
+{
+    if (nIDEvent == ID_GRID_KINETIC_TIMER)
+    {
+        BOOL bAnimating = m_scroller.Advance(CKineticScroller::NowMs());
+        SetScrollOffset((int)(m_scroller.GetPosition() + 0.5));
+        if (!bAnimating)
+        {
+            KillTimer(ID_GRID_KINETIC_TIMER);
+            m_bFrameTimer = FALSE;
+        }
+        return;
+    }
+    CWnd::OnTimer(nIDEvent);
+}
@@ -8,7 +8,8 @@
 #pragma once
 
 #include "InPlaceEdit.h"
-#include <vector>
+#include "KineticScroller.h"
+#include "GridModel.h"
 
 // --- 親ウィンドウへの通知メッセージ ---
 
@@ -19,6 +20,9 @@
 /// @brief 親ウィンドウへキーボードナビゲーションがグリッドの端に到達したことを通知します。wParam:押されたキーコード, lParam:コントロールID
 #define WM_GRID_NAV_BOUNDARY_HIT (WM_USER + 102)
 
+/// @brief 慣性スクロールのフレームタイマーID
+#define ID_GRID_KINETIC_TIMER 1
+
 // --- CGridCtrlから親への通知コード (WM_NOTIFYで使用) ---
 
 /// @brief 行選択が変更されたことを示す通知コード
@@ -42,6 +46,8 @@ struct NM_GRIDVIEW
  * @brief 高度にカスタマイズ可能な表形式のカスタムコントロール
  * @details CWndを基底クラスとし、スクロール、インプレイス編集、動的なスタイル変更など、豊富な機能を持ちます。
  * ちらつき防止のためにダブルバッファリングで描画されます。
+ * セル・寸法・スクロール位置・選択の状態と判断は CGridModel が持ち、このクラスはメッセージの処理と親への通知を行います。
+ * セルの描画は CGridPainter が行います。
  */
 class CGridCtrl : public CWnd
 {
@@ -140,6 +146,48 @@ public:
      * @param[in] color 設定する色 (COLORREF)
      */
     void SetCellBgColor(int nRow, int nCol, COLORREF color);
+
+    // --- 書式 ---
+
+    /**
+     * @brief セルの書式を登録し、番号を返します。
+     * @details 同じ内容の書式は1つにまとめて保持し、セルは番号だけを持ちます。
+     * @param[in] style 書式 (GRID_CELL_STYLE::Default() で作った既定の書式を変更して使います)
+     * @return 書式の番号。登録できない場合は-1。
+     */
+    int AddCellStyle(const GRID_CELL_STYLE& style);
+
+    /**
+     * @brief 指定したセルの書式を設定します。
+     * @param[in] nRow 行インデックス (0始まり)
+     * @param[in] nCol 列インデックス (0始まり)
+     * @param[in] nStyle AddCellStyle() で登録した書式の番号
+     */
+    void SetCellStyle(int nRow, int nCol, int nStyle);
+
+    /**
+     * @brief 指定した行の全てのセルの書式を設定します。
+     * @param[in] nRow 行インデックス (0始まり)
+     * @param[in] nStyle AddCellStyle() で登録した書式の番号
+     */
+    void SetRowStyle(int nRow, int nStyle);
+
+    /**
+     * @brief 指定した列の全てのセルの書式を設定します。
+     * @param[in] nCol 列インデックス (0始まり)
+     * @param[in] nStyle AddCellStyle() で登録した書式の番号
+     */
+    void SetColumnStyle(int nCol, int nStyle);
+
+    /**
+     * @brief 矩形の範囲のセルの書式を設定します。
+     * @param[in] nFirstRow 最初の行 (この行を含みます)
+     * @param[in] nFirstCol 最初の列 (この列を含みます)
+     * @param[in] nLastRow 最後の行 (この行を含みます)
+     * @param[in] nLastCol 最後の列 (この列を含みます)
+     * @param[in] nStyle AddCellStyle() で登録した書式の番号
+     */
+    void SetRangeStyle(int nFirstRow, int nFirstCol, int nLastRow, int nLastCol, int nStyle);
     
     // --- サイズ取得 ---
     
@@ -166,12 +214,12 @@ public:
      * @brief 一度に表示する最大行数を設定します。
      * @param[in] nMaxRows 最大行数
      */
-    void SetMaxVisibleRows(int nMaxRows) { m_nMaxVisibleRows = nMaxRows; }
+    void SetMaxVisibleRows(int nMaxRows) { m_model.SetMaxVisibleRows(nMaxRows); }
     /**
      * @brief 一度に表示する最大行数を取得します。
      * @return 最大行数
      */
-    int GetMaxVisibleRows() const { return m_nMaxVisibleRows; }
+    int GetMaxVisibleRows() const { return m_model.GetMaxVisibleRows(); }
 
     // --- 状態の操作/取得 ---
     
@@ -187,61 +235,36 @@ public:
      * @brief 現在選択されているセルの位置を取得します。
      * @return CPointオブジェクト。xが列、yが行を表します。非選択時は(-1, -1)。
      */
-    CPoint GetSelectedCell() const { return m_selectedCell; }
+    CPoint GetSelectedCell() const { return CPoint(m_model.GetSelection().nCol, m_model.GetSelection().nRow); }
 
 protected:
-    /**
-     * @struct CellInfo
-     * @brief 個々のセルの情報を保持する内部構造体。
-     */
-    struct CellInfo
-    {
-        CString  m_strText;      ///< セルに表示するテキスト
-        COLORREF m_bgColor;      ///< 通常時の背景色
-        BOOL     m_bEditable;    ///< 編集可能フラグ
-
-        CellInfo() : m_strText(_T("")), m_bgColor(RGB(255, 255, 255)), m_bEditable(FALSE) {}
-    };
-
-    /// @brief 内部スクロールバーで一度に表示する最大行数（デフォルト10、setterで変更可）
-    int m_nMaxVisibleRows;
-    
-    // --- 状態変数 ---
-    /// @brief 表示領域の一番上に表示されている行のインデックス (0始まり)
-    int m_nTopRow;
-    /// @brief グリッドの総行数
-    int m_nRows;
-    /// @brief グリッドの総列数
-    int m_nCols;
-    /// @brief 1行の高さ
-    int m_nRowHeight;
-    /// @brief デフォルトの背景色
-    COLORREF m_defaultBgColor;
-
-    // --- データコンテナ ---
-    /// @brief 各列の幅を保持する動的配列
-    std::vector<int> m_colWidths;
-    /// @brief 全セルの情報を保持する動的配列 (1次元配列で2次元を表現)
-    std::vector<CellInfo> m_cells;
+    /// @brief セル・寸法・スクロール位置・選択中のセルと、その操作 (ウィンドウに依存しない部分)
+    CGridModel m_model;
 
     // --- UI状態 ---
-    /// @brief 現在選択されているセルの位置 (-1,-1で非選択)
-    CPoint m_selectedCell;
     /// @brief このグリッドがアクティブかどうかのフラグ
     BOOL m_bIsActive;
     /// @brief インプレイス編集用のエディットコントロールのポインタ
     CInPlaceEdit* m_pEdit;
 
+    // --- 慣性スクロール ---
+    /// @brief 縦方向の慣性スクロールの計算エンジン (位置は内容の先頭からのピクセル数)
+    CKineticScroller m_scroller;
+    /// @brief 左ボタン押下後、ドラッグとみなす移動量に達するのを待っている状態か
+    BOOL m_bDragPending;
+    /// @brief ドラッグ判定の基準となる押下位置
+    CPoint m_ptDragStart;
+    /// @brief フレームタイマーが動作中か
+    BOOL m_bFrameTimer;
+
     // --- ヘルパー関数 ---
 
     /**
-     * @brief 論理的な行・列インデックスから、1次元配列m_cellsのインデックスを計算します。
-     * @param[in] nRow 行インデックス (0始まり)
-     * @param[in] nCol 列インデックス (0始まり)
-     * @return 配列のインデックス。範囲外の場合は-1。
+     * @brief 選択中のセルを設定し、親ウィンドウに行選択の変更を通知します (WM_NOTIFY, GCN_SELCHANGED)。
+     * @param[in] cell 新しく選択するセル
      */
-    int GetCellIndex(int nRow, int nCol) const;
-    
+    void SelectCell(const GRID_CELL_POS& cell);
+
     /**
      * @brief インプレイス編集用のエディットコントロールを生成し、表示します。
      */
@@ -282,6 +305,35 @@ protected:
      */
     void EnsureCellVisible(int nRow, int nCol);
 
+    /**
+     * @brief 現在の縦スクロール位置を、内容の先頭からのピクセル数で返します。
+     */
+    int GetScrollOffset() const { return m_model.GetScrollOffset(); }
+
+    /**
+     * @brief 縦スクロール位置の最大値 (ピクセル) を返します。スクロール不要なら0。
+     */
+    int GetMaxScrollOffset() const { return m_model.GetMaxScrollOffset(); }
+
+    /**
+     * @brief 縦スクロール位置をピクセル単位で設定し、再描画を要求します。
+     * @details 行未満の端数も保持するため、慣性スクロール中は行の途中で止まった状態を描画できます。
+     * 位置が変わる場合、インプレイス編集は確定して閉じます。
+     * @param[in] nOffset 内容の先頭からのピクセル数 (範囲内にクランプされます)
+     */
+    void SetScrollOffset(int nOffset);
+
+    /**
+     * @brief フレームタイマーを開始します (動作中なら何もしません)。
+     * @details 入力イベントでは位置の計算だけを行い、描画はこのタイマーの周期でまとめて行います。
+     */
+    void StartFrameTimer();
+
+    /**
+     * @brief 進行中の慣性スクロールを停止し、フレームタイマーを止めます。
+     */
+    void StopKineticScroll();
+
     /**
      * @brief 内部スクロールバーの状態を更新します。
      * @details グリッドの総行数と表示可能行数に基づいて、スクロールバーの範囲や表示/非表示を設定します。
@@ -299,7 +351,7 @@ protected:
     
     /**
      * @brief 描画イベント(WM_PAINT)を処理します。
-     * @details ダブルバッファリングを用いて、グリッドの内容全体を描画します。
+     * @details ダブルバッファリングを用いて、グリッドの内容全体を CGridPainter で描画します。
      */
     afx_msg void OnPaint();
     
@@ -310,6 +362,35 @@ protected:
      */
     afx_msg void OnLButtonDown(UINT nFlags, CPoint point);
 
+    /**
+     * @brief マウス左ボタン解放イベント(WM_LBUTTONUP)を処理します。
+     * @details ドラッグ中であれば終了し、離した瞬間の速度で慣性スクロールを開始します。
+     * @param[in] nFlags 修飾キーの状態
+     * @param[in] point マウスカーソルのクライアント座標
+     */
+    afx_msg void OnLButtonUp(UINT nFlags, CPoint point);
+
+    /**
+     * @brief マウス移動イベント(WM_MOUSEMOVE)を処理します。
+     * @details 押下位置から一定量動いたらドラッグによるスクロールを開始し、以降は位置の計算だけを行います。
+     * @param[in] nFlags 修飾キーの状態
+     * @param[in] point マウスカーソルのクライアント座標
+     */
+    afx_msg void OnMouseMove(UINT nFlags, CPoint point);
+
+    /**
+     * @brief マウスキャプチャの喪失(WM_CAPTURECHANGED)を処理します。
+     * @param[in] pWnd 新しくキャプチャを得たウィンドウ
+     */
+    afx_msg void OnCaptureChanged(CWnd* pWnd);
+
+    /**
+     * @brief タイマーイベント(WM_TIMER)を処理します。
+     * @details フレームタイマーの周期で慣性スクロールを進め、位置が変わった場合だけ再描画します。
+     * @param[in] nIDEvent タイマーID
+     */
+    afx_msg void OnTimer(UINT_PTR nIDEvent);
+
     /**
      * @brief ダイアログナビゲーションのためのキー種別を返します (WM_GETDLGCODE)。
      * @details カーソルキーや文字キーをダイアログに奪われず、自前で処理するために必要です。
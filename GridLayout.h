@@ -0,0 +1,286 @@
+﻿/**
+ * @file GridLayout.h
+ * @brief グリッド配列ダイアログのレイアウト表をコンパイル時に生成するための定義
+ * @details ダイアログはグリッドの配置行列、セルの編集可否マスク、キャプションを constexpr データとして宣言し、
+ * BuildTables() がそこから位置・コントロールID・キャプションのフラットな表を生成します。
+ * これにより OnInitDialog() では書式化やレイアウト計算を行わず、表を参照するだけで済みます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace GridLayout
+{
+    /// @brief 1キャプションあたりの最大文字数 (終端文字を含む)
+    constexpr int MAX_CAPTION_LENGTH = 24;
+
+    /**
+     * @struct GridPlacement
+     * @brief 1個のグリッドコントロールの配置情報 (ダイアログのコンテンツ座標)
+     */
+    struct GridPlacement
+    {
+        int left;          ///< 左端のX座標
+        int top;           ///< 上端のY座標
+        int right;         ///< 右端のX座標
+        int bottom;        ///< 下端のY座標
+        unsigned int nID;  ///< コントロールID
+    };
+
+    /**
+     * @struct CellCaption
+     * @brief コンパイル時に書式化済みのセルキャプション
+     */
+    struct CellCaption
+    {
+        wchar_t szText[MAX_CAPTION_LENGTH]; ///< 終端文字付きのキャプション文字列
+    };
+
+    /**
+     * @struct DialogSpec
+     * @brief ダイアログが宣言するグリッド配列のレイアウト仕様
+     * @tparam ArrayRows グリッド配列の行数
+     * @tparam ArrayCols グリッド配列の列数
+     * @tparam CellRows 各グリッドの行数
+     * @tparam CellCols 各グリッドの列数
+     */
+    template <int ArrayRows, int ArrayCols, int CellRows, int CellCols>
+    struct DialogSpec
+    {
+        static_assert(ArrayRows > 0 && ArrayCols > 0, "グリッド配列の行数・列数は1以上である必要があります");
+        static_assert(CellRows > 0 && CellCols > 0, "グリッドの行数・列数は1以上である必要があります");
+        static_assert(CellCols <= 32, "編集可否マスクは1行あたり32列までです");
+
+        static constexpr int ARRAY_ROWS = ArrayRows;               ///< グリッド配列の行数
+        static constexpr int ARRAY_COLS = ArrayCols;               ///< グリッド配列の列数
+        static constexpr int TOTAL_GRIDS = ArrayRows * ArrayCols;  ///< 合計グリッド数
+        static constexpr int CELL_ROWS = CellRows;                 ///< 各グリッドの行数
+        static constexpr int CELL_COLS = CellCols;                 ///< 各グリッドの列数
+        static constexpr int TOTAL_CELLS = CellRows * CellCols;    ///< 各グリッドの合計セル数
+
+        int nMargin;                          ///< グリッド同士およびダイアログ端との間隔
+        int nRowHeight;                       ///< 1行の高さ
+        int nMaxVisibleRows;                  ///< グリッド内で一度に表示する最大行数
+        unsigned int nFirstID;                ///< 先頭グリッドのコントロールID (以降連番)
+        int colWidths[CellCols];              ///< 各列の幅
+        std::uint32_t editableMask[CellRows]; ///< 行ごとの編集可能列のビットマスク (bit c が列c)
+        const wchar_t *pszCaptionPrefix;      ///< キャプションの接頭辞 ("Cell" なら "Cell (行, 列)")
+    };
+
+    /**
+     * @struct DialogTables
+     * @brief DialogSpec から生成されるフラットなレイアウト表
+     */
+    template <int ArrayRows, int ArrayCols, int CellRows, int CellCols>
+    struct DialogTables
+    {
+        GridPlacement grids[ArrayRows * ArrayCols];     ///< グリッドごとの配置とID (行優先)
+        bool editable[CellRows * CellCols];             ///< セルごとの編集可否 (行優先)
+        CellCaption captions[CellRows * CellCols];      ///< セルごとの初期キャプション (行優先)
+        int nGridWidth;                                 ///< グリッド1個あたりの幅
+        int nGridHeight;                                ///< グリッド1個あたりの高さ
+        int nTotalWidth;                                ///< 全グリッドを配置した場合の合計の幅
+        int nTotalHeight;                               ///< 全グリッドを配置した場合の合計の高さ
+    };
+
+    // --- constexpr ヘルパー ---
+
+    /**
+     * @brief 終端文字までの文字数を返します。
+     */
+    constexpr int StrLength(const wchar_t *psz)
+    {
+        int n = 0;
+        while (psz != nullptr && psz[n] != L'\0')
+            ++n;
+        return n;
+    }
+
+    /**
+     * @brief 非負整数の10進表記の桁数を返します。
+     */
+    constexpr int DigitCount(int nValue)
+    {
+        int n = 1;
+        while (nValue >= 10)
+        {
+            nValue /= 10;
+            ++n;
+        }
+        return n;
+    }
+
+    /**
+     * @brief 非負整数を10進表記でバッファに追記します。
+     * @return 追記後の書き込み位置
+     */
+    constexpr int AppendNumber(wchar_t *pBuf, int nPos, int nValue)
+    {
+        const int nDigits = DigitCount(nValue);
+        for (int i = nDigits - 1; i >= 0; --i)
+        {
+            pBuf[nPos + i] = static_cast<wchar_t>(L'0' + nValue % 10);
+            nValue /= 10;
+        }
+        return nPos + nDigits;
+    }
+
+    /**
+     * @brief 文字列をバッファに追記します。
+     * @return 追記後の書き込み位置
+     */
+    constexpr int AppendString(wchar_t *pBuf, int nPos, const wchar_t *psz)
+    {
+        for (int i = 0; psz != nullptr && psz[i] != L'\0'; ++i)
+            pBuf[nPos++] = psz[i];
+        return nPos;
+    }
+
+    // --- 検証関数 (static_assert 用) ---
+
+    /**
+     * @brief 行高・列幅・間隔・表示行数が正の値かを検証します。
+     */
+    template <int AR, int AC, int CR, int CC>
+    constexpr bool HasValidMetrics(const DialogSpec<AR, AC, CR, CC> &spec)
+    {
+        if (spec.nMargin < 0 || spec.nRowHeight <= 0 || spec.nMaxVisibleRows <= 0)
+            return false;
+        for (int c = 0; c < CC; ++c)
+        {
+            if (spec.colWidths[c] <= 0)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 編集可否マスクが列数の範囲外のビットを含まないかを検証します。
+     */
+    template <int AR, int AC, int CR, int CC>
+    constexpr bool IsEditableMaskInRange(const DialogSpec<AR, AC, CR, CC> &spec)
+    {
+        const std::uint32_t validBits = (CC >= 32) ? 0xFFFFFFFFu : ((1u << CC) - 1u);
+        for (int r = 0; r < CR; ++r)
+        {
+            if ((spec.editableMask[r] & ~validBits) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 生成されるキャプションが MAX_CAPTION_LENGTH に収まるかを検証します。
+     */
+    template <int AR, int AC, int CR, int CC>
+    constexpr bool AreCaptionsInRange(const DialogSpec<AR, AC, CR, CC> &spec)
+    {
+        // "<prefix> (<row>, <col>)" + 終端文字
+        return StrLength(spec.pszCaptionPrefix) + DigitCount(CR) + DigitCount(CC) + 6 <= MAX_CAPTION_LENGTH;
+    }
+
+    /**
+     * @brief コントロールIDの連番が [nMinID, nMaxID] の範囲に収まるかを検証します。
+     */
+    template <int AR, int AC, int CR, int CC>
+    constexpr bool IsIdRangeValid(const DialogSpec<AR, AC, CR, CC> &spec, unsigned int nMinID, unsigned int nMaxID)
+    {
+        return spec.nFirstID >= nMinID && spec.nFirstID + (AR * AC) - 1 <= nMaxID;
+    }
+
+    /**
+     * @brief 生成済みの表でグリッド同士が重なっていないかを検証します。
+     */
+    template <int AR, int AC, int CR, int CC>
+    constexpr bool HasNoOverlap(const DialogTables<AR, AC, CR, CC> &tables)
+    {
+        for (int i = 0; i < AR * AC; ++i)
+        {
+            const GridPlacement &a = tables.grids[i];
+            for (int j = i + 1; j < AR * AC; ++j)
+            {
+                const GridPlacement &b = tables.grids[j];
+                if (a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 生成済みの表で全グリッドが非負のコンテンツ座標内に収まっているかを検証します。
+     */
+    template <int AR, int AC, int CR, int CC>
+    constexpr bool IsWithinContent(const DialogTables<AR, AC, CR, CC> &tables)
+    {
+        for (int i = 0; i < AR * AC; ++i)
+        {
+            const GridPlacement &g = tables.grids[i];
+            if (g.left < 0 || g.top < 0 || g.right > tables.nTotalWidth || g.bottom > tables.nTotalHeight)
+                return false;
+        }
+        return true;
+    }
+
+    // --- 表の生成 ---
+
+    /**
+     * @brief レイアウト仕様からフラットなレイアウト表を生成します。
+     * @details 配置規則は従来の OnInitDialog() と同一です。
+     * グリッドは左上から間隔 nMargin で行優先に並べ、合計サイズは末尾の間隔を含みます。
+     * @param[in] spec ダイアログが宣言したレイアウト仕様
+     * @return 位置・ID・編集可否・キャプションを格納した表
+     */
+    template <int AR, int AC, int CR, int CC>
+    constexpr DialogTables<AR, AC, CR, CC> BuildTables(const DialogSpec<AR, AC, CR, CC> &spec)
+    {
+        DialogTables<AR, AC, CR, CC> tables{};
+
+        // グリッド1個あたりのサイズ (CGridCtrl::GetRequiredWidth/GetRequiredHeight と同じ計算)
+        int nGridWidth = 0;
+        for (int c = 0; c < CC; ++c)
+            nGridWidth += spec.colWidths[c];
+        const int nVisibleRows = (CR < spec.nMaxVisibleRows) ? CR : spec.nMaxVisibleRows;
+        const int nGridHeight = nVisibleRows * spec.nRowHeight;
+        tables.nGridWidth = nGridWidth;
+        tables.nGridHeight = nGridHeight;
+
+        // グリッド配列の配置とIDを行優先で展開
+        for (int row = 0; row < AR; ++row)
+        {
+            for (int col = 0; col < AC; ++col)
+            {
+                const int index = row * AC + col;
+                GridPlacement &g = tables.grids[index];
+                g.left = spec.nMargin + col * (nGridWidth + spec.nMargin);
+                g.top = spec.nMargin + row * (nGridHeight + spec.nMargin);
+                g.right = g.left + nGridWidth;
+                g.bottom = g.top + nGridHeight;
+                g.nID = spec.nFirstID + static_cast<unsigned int>(index);
+            }
+        }
+        tables.nTotalWidth = spec.nMargin + AC * (nGridWidth + spec.nMargin);
+        tables.nTotalHeight = spec.nMargin + AR * (nGridHeight + spec.nMargin);
+
+        // セルの編集可否とキャプション "<prefix> (行, 列)" を展開 (行・列は1始まり)
+        for (int r = 0; r < CR; ++r)
+        {
+            for (int c = 0; c < CC; ++c)
+            {
+                const int cell = r * CC + c;
+                tables.editable[cell] = ((spec.editableMask[r] >> c) & 1u) != 0;
+
+                wchar_t *pText = tables.captions[cell].szText;
+                int nPos = AppendString(pText, 0, spec.pszCaptionPrefix);
+                nPos = AppendString(pText, nPos, L" (");
+                nPos = AppendNumber(pText, nPos, r + 1);
+                nPos = AppendString(pText, nPos, L", ");
+                nPos = AppendNumber(pText, nPos, c + 1);
+                nPos = AppendString(pText, nPos, L")");
+                pText[nPos] = L'\0';
+            }
+        }
+        return tables;
+    }
+}
@@ -0,0 +1,445 @@
+﻿/**
+ * @file GridModel.cpp
+ * @brief グリッドコントロールのウィンドウに依存しない状態と操作の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "GridModel.h"
+
+#include <algorithm>
+
+namespace
+{
+// 色の定義
+const RenderColor CLR_EDITABLE_BG = RenderRgb(255, 255, 255); ///< 編集可能なセルの背景色 (白色)
+const RenderColor CLR_DEFAULT_BG = RenderRgb(240, 240, 240);  ///< 編集不可のセルの背景色の既定値 (灰色)
+
+/// @brief 範囲外のセルの文字列として返す空文字列
+const std::wstring s_strEmpty;
+}
+
+/**
+ * @brief コンストラクタ
+ */
+CGridModel::CGridModel(int nMaxVisibleRows)
+    : m_nRows(0),
+      m_nCols(0),
+      m_nRowHeight(DEFAULT_ROW_HEIGHT),
+      m_nMaxVisibleRows(nMaxVisibleRows),
+      m_defaultBgColor(CLR_DEFAULT_BG),
+      m_nTopRow(0),
+      m_nRowOffset(0),
+      m_selection(GRID_NO_CELL)
+{
+}
+
+/**
+ * @brief 行数・列数を設定し、全てのセル・列幅・スクロール位置・選択を初期状態に戻します。
+ * @details セルの配列は作り直さずに assign で初期化するため、同じ大きさで設定し直す場合は確保が発生しません。
+ * 全てのセルは、現在の背景色の既定値を使った既定の書式にします。書式の表は作り直しません。
+ */
+bool CGridModel::Setup(int nRows, int nCols)
+{
+    if (nRows <= 0 || nCols <= 0)
+        return false;
+
+    m_nRows = nRows;
+    m_nCols = nCols;
+    const std::size_t nCells = static_cast<std::size_t>(nRows) * static_cast<std::size_t>(nCols);
+
+    m_colWidths.assign(nCols, DEFAULT_COLUMN_WIDTH);
+    m_colRights.resize(nCols);
+    for (int i = 0; i < nCols; ++i)
+        m_colRights[i] = DEFAULT_COLUMN_WIDTH * (i + 1);
+
+    m_textSlots.assign(nCells, 0);
+    m_texts.assign(1, std::wstring());
+    const int nDefaultStyle = m_styleTable.Intern(GRID_CELL_STYLE::Default(m_defaultBgColor));
+    m_styles.assign(nCells, static_cast<GridStyleIndex>(nDefaultStyle != -1 ? nDefaultStyle : 0));
+    m_editable.assign(nCells, 0);
+    m_rowEditableCounts.assign(nRows, 0);
+    m_colEditableCounts.assign(nCols, 0);
+
+    m_nTopRow = 0;
+    m_nRowOffset = 0;
+    m_selection = GRID_NO_CELL;
+    return true;
+}
+
+/**
+ * @brief 全ての行の高さを設定します (0以下は無視します)。
+ */
+void CGridModel::SetRowHeight(int nHeight)
+{
+    if (nHeight > 0)
+        m_nRowHeight = nHeight;
+}
+
+/**
+ * @brief 列の幅を設定します (範囲外の列や0以下の幅は無視します)。
+ * @details 以降の列の右端をずらします。
+ */
+void CGridModel::SetColumnWidth(int nCol, int nWidth)
+{
+    if (nCol < 0 || nCol >= m_nCols || nWidth <= 0)
+        return;
+
+    const int nDelta = nWidth - m_colWidths[nCol];
+    m_colWidths[nCol] = nWidth;
+    for (int i = nCol; i < m_nCols; ++i)
+        m_colRights[i] += nDelta;
+}
+
+/**
+ * @brief セルの文字列を設定します (範囲外は無視します)。
+ * @details 初めて文字列を設定するセルにだけ文字列の番号を割り当て、以後は同じ文字列を書き換えます。
+ */
+void CGridModel::SetCellText(int nRow, int nCol, const wchar_t *pszText, int nLength)
+{
+    const int index = GetCellIndex(nRow, nCol);
+    if (index == -1)
+        return;
+
+    std::uint32_t &slot = m_textSlots[index];
+    const std::size_t nCount = nLength < 0 ? std::char_traits<wchar_t>::length(pszText) : static_cast<std::size_t>(nLength);
+    if (slot == 0)
+    {
+        if (nCount == 0)
+            return;
+        slot = static_cast<std::uint32_t>(m_texts.size());
+        m_texts.emplace_back();
+    }
+    m_texts[slot].assign(pszText, nCount);
+}
+
+/**
+ * @brief セルの文字列を返します (範囲外は空文字列)。
+ */
+const std::wstring &CGridModel::GetCellText(int nRow, int nCol) const
+{
+    const int index = GetCellIndex(nRow, nCol);
+    return index != -1 ? m_texts[m_textSlots[index]] : s_strEmpty;
+}
+
+/**
+ * @brief セルの編集可否を設定し、書式の背景色と数値の色分けを変えます。
+ */
+void CGridModel::SetCellEditable(int nRow, int nCol, bool bEditable)
+{
+    const int index = GetCellIndex(nRow, nCol);
+    if (index == -1)
+        return;
+
+    if ((m_editable[index] != 0) != bEditable)
+    {
+        m_editable[index] = bEditable ? 1 : 0;
+        m_rowEditableCounts[nRow] += bEditable ? 1 : -1;
+        m_colEditableCounts[nCol] += bEditable ? 1 : -1;
+    }
+    GRID_CELL_STYLE style = m_styleTable.Get(m_styles[index]);
+    style.bgColor = bEditable ? CLR_EDITABLE_BG : m_defaultBgColor;
+    style.nNumberRule = bEditable ? GRID_NUMBER_RULE_SIGN : GRID_NUMBER_RULE_NONE;
+    ReplaceCellStyle(index, style);
+}
+
+/**
+ * @brief セルが編集可能かを返します (範囲外はfalse)。
+ */
+bool CGridModel::IsCellEditable(int nRow, int nCol) const
+{
+    const int index = GetCellIndex(nRow, nCol);
+    return index != -1 && m_editable[index] != 0;
+}
+
+/**
+ * @brief セルの書式の背景色だけを変えます (範囲外は無視します)。
+ */
+void CGridModel::SetCellBgColor(int nRow, int nCol, RenderColor color)
+{
+    const int index = GetCellIndex(nRow, nCol);
+    if (index == -1)
+        return;
+
+    GRID_CELL_STYLE style = m_styleTable.Get(m_styles[index]);
+    style.bgColor = color;
+    ReplaceCellStyle(index, style);
+}
+
+/**
+ * @brief セルの書式の番号を返します (範囲外は-1)。
+ */
+int CGridModel::GetCellStyle(int nRow, int nCol) const
+{
+    const int index = GetCellIndex(nRow, nCol);
+    return index != -1 ? m_styles[index] : -1;
+}
+
+/**
+ * @brief 矩形の範囲のセルの書式を設定します。
+ * @details 行ごとに連続した範囲を埋めるため、セルごとに位置を検証しません。
+ */
+void CGridModel::ApplyStyleToRange(int nFirstRow, int nFirstCol, int nLastRow, int nLastCol, int nStyle)
+{
+    if (!m_styleTable.IsValid(nStyle))
+        return;
+
+    nFirstRow = (std::max)(nFirstRow, 0);
+    nFirstCol = (std::max)(nFirstCol, 0);
+    nLastRow = (std::min)(nLastRow, m_nRows - 1);
+    nLastCol = (std::min)(nLastCol, m_nCols - 1);
+    if (nFirstRow > nLastRow || nFirstCol > nLastCol)
+        return;
+
+    const GridStyleIndex nIndex = static_cast<GridStyleIndex>(nStyle);
+    for (int r = nFirstRow; r <= nLastRow; ++r)
+    {
+        GridStyleIndex *pRow = m_styles.data() + static_cast<std::size_t>(r) * m_nCols;
+        std::fill(pRow + nFirstCol, pRow + nLastCol + 1, nIndex);
+    }
+}
+
+/**
+ * @brief セルの書式を、元の書式の一部を変えたものに置き換えます。
+ * @details 同じ変更を続けて行う場合は、書式の表が直前の番号を返すため、ハッシュ表を引きません。
+ */
+void CGridModel::ReplaceCellStyle(int index, const GRID_CELL_STYLE &style)
+{
+    const int nStyle = m_styleTable.Intern(style);
+    if (nStyle != -1)
+        m_styles[index] = static_cast<GridStyleIndex>(nStyle);
+}
+
+/**
+ * @brief 描画するセルの内容を返します (CGridCellSource の実装)。
+ * @details 文字列は保持しているものをそのまま渡し、複製しません。
+ */
+GRID_CELL_VIEW CGridModel::GetCellView(int nRow, int nCol) const
+{
+    const int index = nRow * m_nCols + nCol;
+    const std::wstring &strText = m_texts[m_textSlots[index]];
+    GRID_CELL_VIEW view;
+    view.pszText = strText.c_str();
+    view.nLength = static_cast<int>(strText.size());
+    view.pStyle = &m_styleTable.Get(m_styles[index]);
+    return view;
+}
+
+/**
+ * @brief 一度に表示する最大行数までの高さを返します。
+ */
+int CGridModel::GetRequiredHeight() const
+{
+    if (m_nRows == 0)
+        return 0;
+    return (std::min)(m_nRows, m_nMaxVisibleRows) * m_nRowHeight;
+}
+
+/**
+ * @brief セルの矩形を現在のスクロール位置で返します。
+ * @details 行の途中までスクロールしている場合は、下端に一部だけ見える行も表示範囲に含めます。
+ */
+REGION_RECT CGridModel::GetCellRect(int nRow, int nCol) const
+{
+    const int nVisibleRows = m_nMaxVisibleRows + (m_nRowOffset > 0 ? 1 : 0);
+    if (nRow < m_nTopRow || nRow >= m_nTopRow + nVisibleRows || nCol < 0 || nCol >= m_nCols)
+        return REGION_RECT{ 0, 0, 0, 0 }; // 画面外
+
+    const int top = (nRow - m_nTopRow) * m_nRowHeight - m_nRowOffset;
+    return REGION_RECT{ m_colRights[nCol] - m_colWidths[nCol], top, m_colRights[nCol], top + m_nRowHeight };
+}
+
+/**
+ * @brief 座標にあるセルを返します。
+ * @details 列は列の右端の累積値を二分探索して求めます。
+ */
+GRID_CELL_POS CGridModel::HitTest(int x, int y) const
+{
+    const int row = ((y + m_nRowOffset) / m_nRowHeight) + m_nTopRow;
+    if (row < 0 || row >= m_nRows)
+        return GRID_NO_CELL;
+
+    const auto it = std::upper_bound(m_colRights.begin(), m_colRights.end(), x);
+    if (it == m_colRights.end())
+        return GRID_NO_CELL;
+    return GRID_CELL_POS{ row, static_cast<int>(it - m_colRights.begin()) };
+}
+
+/**
+ * @brief スクロール位置の最大値 (ピクセル) を返します (スクロール不要なら0)。
+ */
+int CGridModel::GetMaxScrollOffset() const
+{
+    if (m_nRows <= m_nMaxVisibleRows)
+        return 0;
+    return (m_nRows - m_nMaxVisibleRows) * m_nRowHeight;
+}
+
+/**
+ * @brief スクロール位置を 0～GetMaxScrollOffset() に収めた値を返します。
+ */
+int CGridModel::ClampScrollOffset(int nOffset) const
+{
+    return (std::max)(0, (std::min)(nOffset, GetMaxScrollOffset()));
+}
+
+/**
+ * @brief スクロール位置を設定します (範囲内に収めます)。
+ */
+bool CGridModel::SetScrollOffset(int nOffset)
+{
+    nOffset = ClampScrollOffset(nOffset);
+    if (nOffset == GetScrollOffset())
+        return false;
+
+    m_nTopRow = nOffset / m_nRowHeight;
+    m_nRowOffset = nOffset % m_nRowHeight;
+    return true;
+}
+
+/**
+ * @brief 行全体が表示されるスクロール位置を返します。
+ * @details ピクセル単位で判定し、行の途中で止まっている場合も行全体が見えるようにします。
+ */
+int CGridModel::GetScrollOffsetToShow(int nRow) const
+{
+    int nOffset = GetScrollOffset();
+    const int nRowTop = nRow * m_nRowHeight;
+    const int nViewHeight = m_nMaxVisibleRows * m_nRowHeight;
+    if (nRowTop < nOffset)
+        nOffset = nRowTop;
+    else if (nRowTop + m_nRowHeight > nOffset + nViewHeight)
+        nOffset = nRowTop + m_nRowHeight - nViewHeight;
+    return nOffset;
+}
+
+/**
+ * @brief 指定した方向に1つずつ進み、最初に見つかった編集可能なセルを返します。
+ * @details 左右の移動で行に、上下の移動で列に編集可能なセルがない場合は探索しません。
+ * 上下の移動では、編集可能なセルのない行は読み飛ばします。
+ */
+GRID_CELL_POS CGridModel::FindEditable(const GRID_CELL_POS &from, int dx, int dy) const
+{
+    if (dx == 0 && dy == 0)
+        return GRID_NO_CELL;
+    if (dy == 0 && (from.nRow < 0 || from.nRow >= m_nRows || m_rowEditableCounts[from.nRow] == 0))
+        return GRID_NO_CELL;
+    if (dx == 0 && (from.nCol < 0 || from.nCol >= m_nCols || m_colEditableCounts[from.nCol] == 0))
+        return GRID_NO_CELL;
+
+    int nRow = from.nRow + dy;
+    int nCol = from.nCol + dx;
+    while (nCol >= 0 && nCol < m_nCols && nRow >= 0 && nRow < m_nRows)
+    {
+        if (m_rowEditableCounts[nRow] != 0 && m_editable[nRow * m_nCols + nCol] != 0)
+            return GRID_CELL_POS{ nRow, nCol };
+        if (dx == 0 && m_rowEditableCounts[nRow] == 0)
+        {
+            // 上下の移動では、編集可能なセルのない行をまとめて読み飛ばす
+            do
+                nRow += dy;
+            while (nRow >= 0 && nRow < m_nRows && m_rowEditableCounts[nRow] == 0);
+            continue;
+        }
+        nCol += dx;
+        nRow += dy;
+    }
+    return GRID_NO_CELL;
+}
+
+/**
+ * @brief Page Up / Page Down の移動先を返します。
+ */
+GRID_CELL_POS CGridModel::FindPageTarget(const GRID_CELL_POS &from, bool bDown) const
+{
+    if (!from.IsValid())
+        return GRID_NO_CELL;
+
+    // 1. まず目標となる行を計算
+    const int nDirection = bDown ? 1 : -1;
+    const int nTargetRow = (std::max)(0, (std::min)(from.nRow + nDirection * m_nMaxVisibleRows, m_nRows - 1));
+
+    // 2. 同じ列内で、目標地点から移動方向へ編集可能セルを探す
+    if (IsCellEditable(nTargetRow, from.nCol))
+        return GRID_CELL_POS{ nTargetRow, from.nCol };
+    const GRID_CELL_POS found = FindEditable(GRID_CELL_POS{ nTargetRow, from.nCol }, 0, nDirection);
+    if (found.IsValid())
+        return found;
+
+    // 3. 同じ列に見つからなければ、一番端の編集可能セルに移動する
+    return bDown ? FindLastEditable() : FindFirstEditable();
+}
+
+/**
+ * @brief 行優先の順で最初の編集可能なセルを返します (ない場合は GRID_NO_CELL)。
+ */
+GRID_CELL_POS CGridModel::FindFirstEditable() const
+{
+    for (int r = 0; r < m_nRows; ++r)
+    {
+        if (m_rowEditableCounts[r] == 0)
+            continue;
+        const std::uint8_t *pRow = m_editable.data() + static_cast<std::size_t>(r) * m_nCols;
+        for (int c = 0; c < m_nCols; ++c)
+        {
+            if (pRow[c] != 0)
+                return GRID_CELL_POS{ r, c };
+        }
+    }
+    return GRID_NO_CELL;
+}
+
+/**
+ * @brief 行優先の順で最後の編集可能なセルを返します (ない場合は GRID_NO_CELL)。
+ */
+GRID_CELL_POS CGridModel::FindLastEditable() const
+{
+    for (int r = m_nRows - 1; r >= 0; --r)
+    {
+        if (m_rowEditableCounts[r] == 0)
+            continue;
+        const std::uint8_t *pRow = m_editable.data() + static_cast<std::size_t>(r) * m_nCols;
+        for (int c = m_nCols - 1; c >= 0; --c)
+        {
+            if (pRow[c] != 0)
+                return GRID_CELL_POS{ r, c };
+        }
+    }
+    return GRID_NO_CELL;
+}
+
+/**
+ * @brief 描画に必要な状態を返します。
+ */
+GRID_PAINT_STATE CGridModel::GetPaintState(int nWidth, int nHeight) const
+{
+    GRID_PAINT_STATE state;
+    state.nWidth = nWidth;
+    state.nHeight = nHeight;
+    state.nRows = m_nRows;
+    state.nCols = m_nCols;
+    state.pColWidths = m_colWidths.data();
+    state.nRowHeight = m_nRowHeight;
+    state.nTopRow = m_nTopRow;
+    state.nRowOffset = m_nRowOffset;
+    state.nMaxVisibleRows = m_nMaxVisibleRows;
+    state.nSelectedRow = m_selection.nRow;
+    state.nSelectedCol = m_selection.nCol;
+    state.bEditing = false;
+    state.bActive = false;
+    return state;
+}
+
+/**
+ * @brief セル・列の情報と書式の表が確保しているメモリの量 (バイト) を返します。
+ * @details 文字列は短い文字列の最適化を考慮せず、確保済みの容量で数えます。
+ */
+std::size_t CGridModel::GetMemoryUsage() const
+{
+    std::size_t nBytes = m_colWidths.capacity() * sizeof(int) + m_colRights.capacity() * sizeof(int) +
+                         m_textSlots.capacity() * sizeof(std::uint32_t) + m_texts.capacity() * sizeof(std::wstring) +
+                         m_styles.capacity() * sizeof(GridStyleIndex) + m_editable.capacity() * sizeof(std::uint8_t) +
+                         m_rowEditableCounts.capacity() * sizeof(int) + m_colEditableCounts.capacity() * sizeof(int) +
+                         m_styleTable.GetMemoryUsage();
+    for (const std::wstring &str : m_texts)
+        nBytes += str.capacity() * sizeof(wchar_t);
+    return nBytes;
+}
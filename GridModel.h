@@ -0,0 +1,252 @@
+﻿/**
+ * @file GridModel.h
+ * @brief グリッドコントロールのウィンドウに依存しない状態と操作のクラス宣言
+ * @details CGridCtrl が保持するセルの内容・列幅・スクロール位置・選択中のセルと、それに対する操作
+ * (セルの設定、座標とセルの変換、キー操作による移動先の検索、指定した行を表示するスクロール位置の計算) を
+ * ウィンドウから切り離したものです。CGridCtrl はメッセージの処理と親への通知だけを行い、判断はこのクラスに任せます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "GridPainter.h"
+#include "GridStyle.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @struct GRID_CELL_POS
+ * @brief セルの位置 (非選択や見つからない場合は行・列とも-1)
+ */
+struct GRID_CELL_POS
+{
+    int nRow; ///< 行インデックス (0始まり)
+    int nCol; ///< 列インデックス (0始まり)
+
+    /// @brief 有効なセルを指しているかを返します。
+    bool IsValid() const { return nCol != -1; }
+    bool operator==(const GRID_CELL_POS &other) const { return nRow == other.nRow && nCol == other.nCol; }
+    bool operator!=(const GRID_CELL_POS &other) const { return !(*this == other); }
+};
+
+/// @brief どのセルも指さない位置
+constexpr GRID_CELL_POS GRID_NO_CELL = { -1, -1 };
+
+/**
+ * @class CGridModel
+ * @brief グリッドのセル・寸法・スクロール位置・選択状態を保持するクラス
+ * @details セルの属性は項目ごとの配列 (文字列の番号・書式の番号・編集可否) で保持し、文字列は設定されたセルの分だけ持ちます。
+ * 書式 (背景色・文字色・配置・太字・枠線・数値の色分け) は CGridStyleTable で重複を除いて保持し、セルは2バイトの番号だけを持ちます。
+ * 列の右端の累積値と、行・列ごとの編集可能なセルの数も保持し、座標からのセルの検索や、
+ * 編集可能なセルのない行・列の読み飛ばしに使います。
+ */
+class CGridModel : public CGridCellSource
+{
+public:
+    /// @brief 列幅の既定値
+    static constexpr int DEFAULT_COLUMN_WIDTH = 80;
+    /// @brief 行の高さの既定値
+    static constexpr int DEFAULT_ROW_HEIGHT = 22;
+
+    /**
+     * @brief コンストラクタ
+     * @param[in] nMaxVisibleRows 一度に表示する最大行数
+     */
+    explicit CGridModel(int nMaxVisibleRows = 10);
+
+    // --- 構成 ---
+
+    /**
+     * @brief 行数・列数を設定し、全てのセル・列幅・スクロール位置・選択を初期状態に戻します。
+     * @param[in] nRows 行数
+     * @param[in] nCols 列数
+     * @return 行数・列数が1以上で設定できた場合はtrue
+     */
+    bool Setup(int nRows, int nCols);
+    /// @brief 全ての行の高さを設定します (0以下は無視します)。
+    void SetRowHeight(int nHeight);
+    /// @brief 列の幅を設定します (範囲外の列や0以下の幅は無視します)。
+    void SetColumnWidth(int nCol, int nWidth);
+    /// @brief 編集不可のセルの背景色の既定値を設定します (以後に初期化・編集不可にするセルに使います)。
+    void SetDefaultBgColor(RenderColor color) { m_defaultBgColor = color; }
+    /// @brief 一度に表示する最大行数を設定します。
+    void SetMaxVisibleRows(int nMaxRows) { m_nMaxVisibleRows = nMaxRows; }
+
+    int GetRows() const { return m_nRows; }                                   ///< 総行数
+    int GetCols() const { return m_nCols; }                                   ///< 総列数
+    int GetRowHeight() const { return m_nRowHeight; }                         ///< 1行の高さ
+    int GetMaxVisibleRows() const { return m_nMaxVisibleRows; }               ///< 一度に表示する最大行数
+    RenderColor GetDefaultBgColor() const { return m_defaultBgColor; }        ///< 編集不可のセルの背景色の既定値
+
+    // --- セル ---
+
+    /**
+     * @brief 行・列から、セルの配列のインデックスを計算します。
+     * @return 配列のインデックス。範囲外の場合は-1。
+     */
+    int GetCellIndex(int nRow, int nCol) const
+    {
+        return (nRow >= 0 && nRow < m_nRows && nCol >= 0 && nCol < m_nCols) ? nRow * m_nCols + nCol : -1;
+    }
+
+    /**
+     * @brief セルの文字列を設定します (範囲外は無視します)。
+     * @param[in] nRow 行インデックス (0始まり)
+     * @param[in] nCol 列インデックス (0始まり)
+     * @param[in] pszText 文字列
+     * @param[in] nLength 文字数 (負の値なら終端文字まで)
+     */
+    void SetCellText(int nRow, int nCol, const wchar_t *pszText, int nLength = -1);
+    /// @brief セルの文字列を返します (範囲外は空文字列)。
+    const std::wstring &GetCellText(int nRow, int nCol) const;
+    /**
+     * @brief セルの編集可否を設定します (範囲外は無視します)。
+     * @details セルの書式も、編集可能なら白の背景で数値の色分けをするものに、
+     * 編集不可なら既定値の背景で色分けをしないものに変えます (その他の項目は変えません)。
+     */
+    void SetCellEditable(int nRow, int nCol, bool bEditable);
+    /// @brief セルが編集可能かを返します (範囲外はfalse)。
+    bool IsCellEditable(int nRow, int nCol) const;
+    /// @brief セルの書式の背景色だけを変えます (範囲外は無視します)。
+    void SetCellBgColor(int nRow, int nCol, RenderColor color);
+
+    // --- 書式 ---
+
+    /**
+     * @brief 書式を登録し、番号を返します (同じ内容の書式が登録済みなら、その番号を返します)。
+     * @details 登録した書式と番号は、行数・列数を設定し直しても変わりません。
+     * @return 番号。登録できる数の上限に達している場合は-1。
+     */
+    int AddStyle(const GRID_CELL_STYLE &style) { return m_styleTable.Intern(style); }
+    /// @brief 番号の書式を返します (番号は検証しません)。
+    const GRID_CELL_STYLE &GetStyle(int nStyle) const { return m_styleTable.Get(nStyle); }
+    /// @brief 登録されている書式の数を返します。
+    int GetStyleCount() const { return m_styleTable.GetCount(); }
+    /// @brief セルの書式の番号を返します (範囲外は-1)。
+    int GetCellStyle(int nRow, int nCol) const;
+    /// @brief セルの書式を設定します (範囲外のセルや未登録の番号は無視します)。
+    void SetCellStyle(int nRow, int nCol, int nStyle) { ApplyStyleToRange(nRow, nCol, nRow, nCol, nStyle); }
+    /// @brief 行の全てのセルの書式を設定します。
+    void ApplyStyleToRow(int nRow, int nStyle) { ApplyStyleToRange(nRow, 0, nRow, m_nCols - 1, nStyle); }
+    /// @brief 列の全てのセルの書式を設定します。
+    void ApplyStyleToColumn(int nCol, int nStyle) { ApplyStyleToRange(0, nCol, m_nRows - 1, nCol, nStyle); }
+    /**
+     * @brief 矩形の範囲のセルの書式を設定します。
+     * @details 範囲はグリッドの内側に切り詰めます。未登録の番号は無視します。
+     * @param[in] nFirstRow 最初の行 (この行を含みます)
+     * @param[in] nFirstCol 最初の列 (この列を含みます)
+     * @param[in] nLastRow 最後の行 (この行を含みます)
+     * @param[in] nLastCol 最後の列 (この列を含みます)
+     * @param[in] nStyle 書式の番号
+     */
+    void ApplyStyleToRange(int nFirstRow, int nFirstCol, int nLastRow, int nLastCol, int nStyle);
+
+    virtual GRID_CELL_VIEW GetCellView(int nRow, int nCol) const override;
+
+    // --- 寸法と座標 ---
+
+    /// @brief 全ての列を表示するのに必要な幅を返します。
+    int GetRequiredWidth() const { return m_colRights.empty() ? 0 : m_colRights.back(); }
+    /// @brief 一度に表示する最大行数までの高さを返します。
+    int GetRequiredHeight() const;
+
+    /**
+     * @brief セルの矩形を現在のスクロール位置で返します。
+     * @return 矩形 (表示範囲外の行や範囲外の列は全て0)
+     */
+    REGION_RECT GetCellRect(int nRow, int nCol) const;
+
+    /**
+     * @brief 座標にあるセルを返します。
+     * @param[in] x クライアント座標のX座標
+     * @param[in] y クライアント座標のY座標
+     * @return セルの位置 (セルがない場合は GRID_NO_CELL)
+     */
+    GRID_CELL_POS HitTest(int x, int y) const;
+
+    // --- スクロール ---
+
+    int GetTopRow() const { return m_nTopRow; }                                  ///< 表示領域の一番上の行
+    int GetRowOffset() const { return m_nRowOffset; }                            ///< 一番上の行が上端からはみ出しているピクセル数
+    int GetScrollOffset() const { return m_nTopRow * m_nRowHeight + m_nRowOffset; } ///< 内容の先頭からのピクセル数
+    /// @brief スクロール位置の最大値 (ピクセル) を返します (スクロール不要なら0)。
+    int GetMaxScrollOffset() const;
+    /// @brief スクロール位置を 0～GetMaxScrollOffset() に収めた値を返します。
+    int ClampScrollOffset(int nOffset) const;
+    /**
+     * @brief スクロール位置を設定します (範囲内に収めます)。
+     * @return スクロール位置が変わった場合はtrue
+     */
+    bool SetScrollOffset(int nOffset);
+    /**
+     * @brief 行全体が表示されるスクロール位置を返します。
+     * @details 既に表示されていれば現在の位置を、上にはみ出していれば行が上端に、
+     * 下にはみ出していれば行が下端に来る位置を返します。
+     */
+    int GetScrollOffsetToShow(int nRow) const;
+
+    // --- 選択とキー操作による移動 ---
+
+    const GRID_CELL_POS &GetSelection() const { return m_selection; } ///< 選択中のセル
+    void SetSelection(const GRID_CELL_POS &cell) { m_selection = cell; } ///< 選択中のセルを設定します (検証しません)。
+
+    /**
+     * @brief 指定した方向に1つずつ進み、最初に見つかった編集可能なセルを返します。
+     * @param[in] from 開始位置 (このセル自身は対象外)
+     * @param[in] dx 水平方向の移動量 (-1, 0, 1)
+     * @param[in] dy 垂直方向の移動量 (-1, 0, 1)
+     * @return 見つかったセル (グリッドの端まで見つからない場合は GRID_NO_CELL)
+     */
+    GRID_CELL_POS FindEditable(const GRID_CELL_POS &from, int dx, int dy) const;
+
+    /**
+     * @brief Page Up / Page Down の移動先を返します。
+     * @details 表示行数だけ離れた行 (範囲内に収めます) から移動方向へ、同じ列の編集可能なセルを探します。
+     * 同じ列にない場合は、Page Up なら最初の、Page Down なら最後の編集可能なセルを返します。
+     * @param[in] from 選択中のセル
+     * @param[in] bDown Page Down ならtrue
+     * @return 移動先 (編集可能なセルがない場合は GRID_NO_CELL)
+     */
+    GRID_CELL_POS FindPageTarget(const GRID_CELL_POS &from, bool bDown) const;
+
+    /// @brief 行優先の順で最初の編集可能なセルを返します (ない場合は GRID_NO_CELL)。
+    GRID_CELL_POS FindFirstEditable() const;
+    /// @brief 行優先の順で最後の編集可能なセルを返します (ない場合は GRID_NO_CELL)。
+    GRID_CELL_POS FindLastEditable() const;
+
+    // --- 描画と計測 ---
+
+    /**
+     * @brief 描画に必要な状態を返します。
+     * @details 編集中かとアクティブかは呼び出し側で設定します (既定値はfalse)。
+     */
+    GRID_PAINT_STATE GetPaintState(int nWidth, int nHeight) const;
+
+    /// @brief セル・列の情報と書式の表が確保しているメモリの量 (バイト) を返します。
+    std::size_t GetMemoryUsage() const;
+
+private:
+    /// @brief セルの書式を、元の書式の一部を変えたものに置き換えます (書式を登録できない場合は変えません)。
+    void ReplaceCellStyle(int index, const GRID_CELL_STYLE &style);
+
+    int m_nRows;                               ///< 総行数
+    int m_nCols;                               ///< 総列数
+    int m_nRowHeight;                          ///< 1行の高さ
+    int m_nMaxVisibleRows;                     ///< 一度に表示する最大行数
+    RenderColor m_defaultBgColor;              ///< 編集不可のセルの背景色の既定値
+    int m_nTopRow;                             ///< 表示領域の一番上の行
+    int m_nRowOffset;                          ///< 一番上の行が上端からはみ出しているピクセル数
+    GRID_CELL_POS m_selection;                 ///< 選択中のセル
+
+    std::vector<int> m_colWidths;              ///< 各列の幅
+    std::vector<int> m_colRights;              ///< 各列の右端 (列の幅の累積)
+    std::vector<std::uint32_t> m_textSlots;    ///< セルごとの文字列の番号 (0は空文字列)
+    std::vector<std::wstring> m_texts;         ///< 文字列 (番号0は空文字列)
+    std::vector<GridStyleIndex> m_styles;      ///< セルごとの書式の番号
+    CGridStyleTable m_styleTable;              ///< 書式の表
+    std::vector<std::uint8_t> m_editable;      ///< セルごとの編集可否
+    std::vector<int> m_rowEditableCounts;      ///< 行ごとの編集可能なセルの数
+    std::vector<int> m_colEditableCounts;      ///< 列ごとの編集可能なセルの数
+};
@@ -0,0 +1,315 @@
+﻿/**
+ * @file GridPainter.cpp
+ * @brief グリッドコントロールの描画処理の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "GridPainter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cwchar>
+#include <cwctype>
+#include <vector>
+
+namespace
+{
+// 色の定義
+const RenderColor CLR_BACKGROUND = RenderRgb(255, 255, 255); ///< セルのない部分の背景色 (白色)
+const RenderColor CLR_BLUE_BG = RenderRgb(0, 0, 230);        ///< 選択状態のセルの背景色 (青色)
+const RenderColor CLR_YELLOW = RenderRgb(255, 255, 224);     ///< 編集状態のセル or 空欄の編集可能セルの背景色 (薄黄色)
+const RenderColor CLR_ORANGE = RenderRgb(255, 192, 128);     ///< 正の数の場合の背景色
+const RenderColor CLR_BLUE_TEXT = RenderRgb(0, 0, 255);      ///< 正の数の場合の文字色
+const RenderColor CLR_BLUE2_BG = RenderRgb(120, 210, 230);   ///< 負の数の場合の背景色
+const RenderColor CLR_RED_TEXT = RenderRgb(255, 0, 0);       ///< 負の数の場合の文字色
+const RenderColor CLR_BLACK = RenderRgb(0, 0, 0);            ///< デフォルトの文字色
+const RenderColor CLR_ACTIVE_BORDER = RenderRgb(0, 0, 255);  ///< アクティブなグリッドの外枠の色
+
+/// @brief アクティブなグリッドの外枠の太さ
+constexpr int ACTIVE_BORDER_WIDTH = 3;
+/// @brief セルの文字列の左右の余白
+constexpr int TEXT_MARGIN_X = 4;
+/// @brief セルの文字列の上下の余白
+constexpr int TEXT_MARGIN_Y = 2;
+
+/**
+ * @struct GRID_PAINT_ITEM
+ * @brief 表示範囲の1つのセルの描画内容 (色は選択状態と数値の色分けを反映済み)
+ */
+struct GRID_PAINT_ITEM
+{
+    REGION_RECT rect;              ///< セルの矩形
+    const wchar_t *pszText;        ///< 文字列
+    int nLength;                   ///< 文字数
+    const GRID_CELL_STYLE *pStyle; ///< 書式
+    RenderColor bgColor;           ///< 背景色
+    RenderColor textColor;         ///< 文字色
+};
+
+/**
+ * @struct GRID_FILL_RUN
+ * @brief 同じ行で同じ背景色が続くセルの範囲
+ */
+struct GRID_FILL_RUN
+{
+    REGION_RECT rect;    ///< 範囲の矩形
+    RenderColor bgColor; ///< 背景色
+};
+
+/// @brief 表示範囲のセルの描画内容 (描画のたびに確保し直さないよう、スレッドごとに使い回します)
+thread_local std::vector<GRID_PAINT_ITEM> t_items;
+/**
+ * @struct GRID_TEXT_GROUP
+ * @brief 文字色が同じ文字列のまとまり (描画する順序の中の範囲)
+ */
+struct GRID_TEXT_GROUP
+{
+    std::size_t nBegin; ///< 先頭
+    std::size_t nBold;  ///< 太字の先頭 (通常のフォントの終わり)
+    std::size_t nEnd;   ///< 終わり
+    int nRank;          ///< 並べる順位
+};
+
+/// @brief 背景を塗りつぶす範囲
+thread_local std::vector<GRID_FILL_RUN> t_runs;
+/// @brief 文字色ごとのまとまり
+thread_local std::vector<GRID_TEXT_GROUP> t_groups;
+/// @brief 並べ替えた描画の順序の作業領域
+thread_local std::vector<int> t_sorted;
+/// @brief 枠線・文字列を描画するセルの順序 (t_items のインデックス)
+thread_local std::vector<int> t_order;
+
+/// @brief 枠線のペン (太さと色) を並べ替えの鍵にします。
+std::uint64_t BorderKey(const GRID_PAINT_ITEM &item)
+{
+    return (static_cast<std::uint64_t>(item.pStyle->nBorderWidth) << 32) | item.pStyle->borderColor;
+}
+
+/// @brief 文字列の文字色とフォントを並べ替えの鍵にします (文字色が同じものを先にまとめます)。
+std::uint64_t TextKey(const GRID_PAINT_ITEM &item)
+{
+    return (static_cast<std::uint64_t>(item.textColor) << 1) | (item.pStyle->bBold != 0 ? 1 : 0);
+}
+
+/**
+ * @brief 描画状態の鍵ごとにまとまるよう、描画する順序を並べ替えます。
+ * @details 鍵が同じセルは元の順序 (行優先) を保ちます。既にまとまっている場合 (書式が1種類など) は並べ替えません。
+ */
+template <class KeyFunc>
+void SortByState(std::vector<int> &order, const std::vector<GRID_PAINT_ITEM> &items, KeyFunc keyOf)
+{
+    const auto less = [&items, &keyOf](int a, int b) {
+        const std::uint64_t nKeyA = keyOf(items[a]);
+        const std::uint64_t nKeyB = keyOf(items[b]);
+        return nKeyA != nKeyB ? nKeyA < nKeyB : a < b;
+    };
+    if (!std::is_sorted(order.begin(), order.end(), less))
+        std::sort(order.begin(), order.end(), less);
+}
+
+/**
+ * @brief 文字列を描画する順序を、文字色ごと、その中ではフォントごとにまとめます。
+ * @details 文字色のまとまりを、通常のフォントだけのもの、両方のフォントを含む最初のもの、太字だけのもの、
+ * 両方のフォントを含む残りのものの順に並べ、両方を含むまとまりは直前と同じフォントから描画します。
+ * フォントの切り替えは、両方を含むまとまりの数 (ない場合は太字があれば1回) で済みます。
+ */
+void SortTexts(std::vector<int> &order, const std::vector<GRID_PAINT_ITEM> &items)
+{
+    SortByState(order, items, TextKey);
+
+    std::vector<GRID_TEXT_GROUP> &groups = t_groups;
+    groups.clear();
+    bool bFirstMixed = true;
+    for (std::size_t i = 0; i < order.size();)
+    {
+        std::size_t j = i;
+        while (j < order.size() && items[order[j]].textColor == items[order[i]].textColor)
+            ++j;
+        // [i, j) は通常のフォント、太字の順に並んでいる
+        std::size_t k = i;
+        while (k < j && items[order[k]].pStyle->bBold == 0)
+            ++k;
+        int nRank = 0;
+        if (k == i)
+            nRank = 2; // 太字だけ
+        else if (k < j)
+        {
+            nRank = bFirstMixed ? 1 : 3;
+            bFirstMixed = false;
+        }
+        groups.push_back(GRID_TEXT_GROUP{ i, k, j, nRank });
+        i = j;
+    }
+    if (groups.size() <= 1)
+        return;
+
+    std::sort(groups.begin(), groups.end(), [](const GRID_TEXT_GROUP &a, const GRID_TEXT_GROUP &b) {
+        return a.nRank != b.nRank ? a.nRank < b.nRank : a.nBegin < b.nBegin;
+    });
+    std::vector<int> &sorted = t_sorted;
+    sorted.clear();
+    bool bBold = false;
+    for (const GRID_TEXT_GROUP &group : groups)
+    {
+        const auto itBegin = order.begin() + group.nBegin;
+        const auto itBold = order.begin() + group.nBold;
+        const auto itEnd = order.begin() + group.nEnd;
+        if (bBold && group.nBold > group.nBegin)
+        {
+            sorted.insert(sorted.end(), itBold, itEnd);
+            sorted.insert(sorted.end(), itBegin, itBold);
+            bBold = false;
+        }
+        else
+        {
+            sorted.insert(sorted.end(), itBegin, itEnd);
+            bBold = group.nBold < group.nEnd;
+        }
+    }
+    order.swap(sorted);
+}
+}
+
+/**
+ * @brief グリッド全体を描画します。
+ * @details 行の途中までスクロールしている場合は、下端に一部だけ見える行も描画します。
+ * セルの左端は列の幅を足しながら求め、セルごとに先頭の列から足し直しません。
+ * 最初に表示範囲のセルの色を求め、背景は同じ行で同じ色が続く範囲を1回で塗りつぶします。
+ * 背景は色ごと、枠線はペンごと、文字列は文字色とフォントごとにまとめて描画します。
+ */
+int CGridPainter::Paint(CRenderTarget &target, const GRID_PAINT_STATE &state, const CGridCellSource &source)
+{
+    target.FillRect(REGION_RECT{ 0, 0, state.nWidth, state.nHeight }, CLR_BACKGROUND);
+
+    // 表示する行の範囲を計算 (スクロール位置を考慮)
+    const int nStartRow = state.nTopRow;
+    const int nEndRow = (std::min)(state.nRows, state.nTopRow + state.nMaxVisibleRows + (state.nRowOffset > 0 ? 1 : 0));
+
+    // 1. 表示範囲のセルの描画内容を求める
+    std::vector<GRID_PAINT_ITEM> &items = t_items;
+    items.clear();
+    for (int row = nStartRow; row < nEndRow; ++row)
+    {
+        const int top = (row - state.nTopRow) * state.nRowHeight - state.nRowOffset;
+        const int bottom = top + state.nRowHeight;
+        int left = 0;
+        for (int col = 0; col < state.nCols; ++col)
+        {
+            const int right = left + state.pColWidths[col];
+            const GRID_CELL_VIEW cell = source.GetCellView(row, col);
+            GRID_PAINT_ITEM item;
+            item.rect = REGION_RECT{ left, top, right, bottom };
+            item.pszText = cell.pszText;
+            item.nLength = cell.nLength;
+            item.pStyle = cell.pStyle;
+            GetCellColors(cell, state.nSelectedCol == col && state.nSelectedRow == row, state.bEditing, item.bgColor, item.textColor);
+            items.push_back(item);
+            left = right;
+        }
+    }
+
+    // 2. 背景: 同じ行で同じ背景色が続くセルは1回で塗りつぶし、範囲は重ならないため背景色ごとにまとめて塗る
+    //    (全体の背景と同じ色の範囲は塗り済みのため塗らない)
+    std::vector<GRID_FILL_RUN> &runs = t_runs;
+    runs.clear();
+    for (std::size_t i = 0; i < items.size();)
+    {
+        std::size_t j = i + 1;
+        while (j < items.size() && items[j].rect.top == items[i].rect.top && items[j].bgColor == items[i].bgColor)
+            ++j;
+        if (items[i].bgColor != CLR_BACKGROUND)
+        {
+            runs.push_back(GRID_FILL_RUN{ REGION_RECT{ items[i].rect.left, items[i].rect.top, items[j - 1].rect.right, items[i].rect.bottom },
+                                          items[i].bgColor });
+        }
+        i = j;
+    }
+    const auto lessRun = [](const GRID_FILL_RUN &a, const GRID_FILL_RUN &b) {
+        if (a.bgColor != b.bgColor)
+            return a.bgColor < b.bgColor;
+        return a.rect.top != b.rect.top ? a.rect.top < b.rect.top : a.rect.left < b.rect.left;
+    };
+    if (!std::is_sorted(runs.begin(), runs.end(), lessRun))
+        std::sort(runs.begin(), runs.end(), lessRun);
+    for (const GRID_FILL_RUN &run : runs)
+        target.FillRect(run.rect, run.bgColor);
+
+    // 3. 枠線: 同じペンのセルをまとめて描画
+    std::vector<int> &order = t_order;
+    order.clear();
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+        if (items[i].pStyle->nBorderWidth > 0)
+            order.push_back(static_cast<int>(i));
+    }
+    SortByState(order, items, BorderKey);
+    for (int i : order)
+        target.DrawFrame(items[i].rect, items[i].pStyle->borderColor, items[i].pStyle->nBorderWidth);
+
+    // 4. 文字列: 同じフォントと文字色のセルをまとめて描画
+    order.clear();
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+        if (items[i].nLength > 0)
+            order.push_back(static_cast<int>(i));
+    }
+    SortTexts(order, items);
+    for (int i : order)
+    {
+        const GRID_PAINT_ITEM &item = items[i];
+        const REGION_RECT textRect = { item.rect.left + TEXT_MARGIN_X, item.rect.top + TEXT_MARGIN_Y,
+                                       item.rect.right - TEXT_MARGIN_X, item.rect.bottom - TEXT_MARGIN_Y };
+        unsigned nFormat = (item.pStyle->nAlign & (RENDER_TEXT_CENTER | RENDER_TEXT_RIGHT)) | RENDER_TEXT_VCENTER;
+        if (item.pStyle->bBold != 0)
+            nFormat |= RENDER_TEXT_BOLD;
+        target.DrawString(item.pszText, item.nLength, textRect, item.textColor, nFormat);
+    }
+
+    // このグリッドがアクティブな場合、外枠を青で囲む
+    if (state.bActive)
+    {
+        target.DrawFrame(REGION_RECT{ 1, 1, state.nWidth - 1, state.nHeight - 1 }, CLR_ACTIVE_BORDER, ACTIVE_BORDER_WIDTH);
+    }
+    return static_cast<int>(items.size());
+}
+
+/**
+ * @brief セルの書式・内容と選択状態から、背景色と文字色を求めます。
+ * @details 数値の判定は前後の空白を除いた文字列全体が数値として読めるかで行い、文字列の複製は作りません。
+ */
+void CGridPainter::GetCellColors(const GRID_CELL_VIEW &cell, bool bSelected, bool bEditing, RenderColor &bgColor, RenderColor &textColor)
+{
+    bgColor = cell.pStyle->bgColor;
+    textColor = cell.pStyle->textColor;
+
+    // 数値の色分けをするセルの場合、内容に応じて色を上書き
+    if (cell.pStyle->nNumberRule == GRID_NUMBER_RULE_SIGN)
+    {
+        const wchar_t *pBegin = cell.pszText;
+        const wchar_t *pEnd = cell.pszText + cell.nLength;
+        while (pBegin < pEnd && std::iswspace(*pBegin))
+            ++pBegin;
+        while (pEnd > pBegin && std::iswspace(pEnd[-1]))
+            --pEnd;
+        if (pBegin == pEnd)
+        {
+            bgColor = CLR_YELLOW; // 空欄
+        }
+        else
+        {
+            wchar_t *pParsed = nullptr;
+            const double dValue = std::wcstod(pBegin, &pParsed);
+            if (pParsed == pEnd) // 数値の場合
+            {
+                if (dValue < 0) { bgColor = CLR_BLUE2_BG; textColor = CLR_RED_TEXT; } // 負の数
+                else if (dValue > 0) { bgColor = CLR_ORANGE; textColor = CLR_BLUE_TEXT; } // 正の数
+            }
+        }
+    }
+
+    // 選択/編集状態の色を最優先で適用
+    if (bSelected)
+    {
+        bgColor = bEditing ? CLR_YELLOW : CLR_BLUE_BG;
+        if (!bEditing) textColor = CLR_BLACK;
+    }
+}
@@ -0,0 +1,95 @@
+﻿/**
+ * @file GridPainter.h
+ * @brief グリッドコントロールの描画処理のクラス宣言
+ * @details CGridCtrl の描画 (セルの背景・枠線・文字列、アクティブ時の外枠) を、ウィンドウに依存しない
+ * CRenderTarget への描画として実装します。描画に必要な状態は GRID_PAINT_STATE で、
+ * セルの内容は CGridCellSource から受け取るため、ウィンドウがなくても同じ描画処理を実行できます。
+ * 描画は背景・枠線・文字列の順に表示範囲全体をまとめて行います。同じ行で同じ色が続くセルの背景は1回で塗りつぶし、
+ * 背景は色ごと、枠線はペンごと、文字列は文字色とフォントごとにまとめて描画して、描画状態の切り替えを減らします。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "GridStyle.h"
+
+/**
+ * @struct GRID_CELL_VIEW
+ * @brief 描画する1つのセルの内容
+ */
+struct GRID_CELL_VIEW
+{
+    const wchar_t *pszText;        ///< 文字列 (終端文字付き)
+    int nLength;                   ///< 文字数
+    const GRID_CELL_STYLE *pStyle; ///< 書式 (描画が終わるまで有効)
+};
+
+/**
+ * @class CGridCellSource
+ * @brief 描画するセルの内容を渡すインターフェース
+ */
+class CGridCellSource
+{
+public:
+    virtual ~CGridCellSource() = default;
+
+    /**
+     * @brief セルの内容を返します。
+     * @details 返した文字列と書式は、描画が終わるまで有効である必要があります。
+     * @param[in] nRow 行インデックス (0始まり)
+     * @param[in] nCol 列インデックス (0始まり)
+     */
+    virtual GRID_CELL_VIEW GetCellView(int nRow, int nCol) const = 0;
+};
+
+/**
+ * @struct GRID_PAINT_STATE
+ * @brief グリッドの描画に必要な状態
+ */
+struct GRID_PAINT_STATE
+{
+    int nWidth;            ///< クライアント領域の幅
+    int nHeight;           ///< クライアント領域の高さ
+    int nRows;             ///< 総行数
+    int nCols;             ///< 総列数
+    const int *pColWidths; ///< 各列の幅 (nCols 個)
+    int nRowHeight;        ///< 1行の高さ
+    int nTopRow;           ///< 表示領域の一番上の行
+    int nRowOffset;        ///< 一番上の行が上端からはみ出しているピクセル数
+    int nMaxVisibleRows;   ///< 一度に表示する最大行数
+    int nSelectedRow;      ///< 選択中のセルの行 (-1なら非選択)
+    int nSelectedCol;      ///< 選択中のセルの列 (-1なら非選択)
+    bool bEditing;         ///< 選択中のセルを編集中か
+    bool bActive;          ///< グリッドがアクティブか
+};
+
+/**
+ * @class CGridPainter
+ * @brief グリッドを描画先に描画するクラス
+ */
+class CGridPainter
+{
+public:
+    /**
+     * @brief グリッド全体を描画します。
+     * @details 背景を白で塗り、表示範囲の行のセルを描画し、アクティブであれば外枠を描画します。
+     * セルは背景・枠線・文字列の3回に分けて描画します (セルの枠線と文字列は他のセルに重ならないため、結果は同じです)。
+     * @param[in,out] target 描画先
+     * @param[in] state 描画に必要な状態
+     * @param[in] source セルの内容
+     * @return 描画したセルの数
+     */
+    static int Paint(CRenderTarget &target, const GRID_PAINT_STATE &state, const CGridCellSource &source);
+
+    /**
+     * @brief セルの書式・内容と選択状態から、背景色と文字色を求めます。
+     * @details 書式の色を使い、数値の色分けが GRID_NUMBER_RULE_SIGN のセルは、空欄なら薄黄色、
+     * 負の数なら水色の背景と赤字、正の数ならオレンジの背景と青字にします。
+     * 選択中のセルは、編集中なら薄黄色、それ以外は青の背景を最優先で使います。
+     * @param[in] cell セルの内容
+     * @param[in] bSelected 選択中のセルか
+     * @param[in] bEditing 編集中か
+     * @param[out] bgColor 背景色
+     * @param[out] textColor 文字色
+     */
+    static void GetCellColors(const GRID_CELL_VIEW &cell, bool bSelected, bool bEditing, RenderColor &bgColor, RenderColor &textColor);
+};
@@ -0,0 +1,271 @@
+﻿/**
+ * @file GridSpatialIndex.cpp
+ * @brief グリッド矩形群に対する空間インデックス (均一バケット格子) の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "GridSpatialIndex.h"
+
+#include <algorithm>
+
+namespace
+{
+    /// @brief 矩形が検索対象となる有効な大きさを持つかを判定します。
+    bool IsValidRect(const CGridSpatialIndex::Rect &rc)
+    {
+        return rc.right > rc.left && rc.bottom > rc.top;
+    }
+
+    /// @brief 整数の割り算を負の無限大方向に丸めます。
+    int FloorDiv(int a, int b)
+    {
+        int q = a / b;
+        if ((a % b != 0) && ((a < 0) != (b < 0)))
+            --q;
+        return q;
+    }
+
+    /// @brief バケット数の上限 (矩形数に対する倍率)。極端に小さい矩形が混ざった場合のメモリ増大を防ぎます。
+    const long long MAX_BUCKETS_PER_RECT = 4;
+}
+
+/**
+ * @brief CGridSpatialIndexクラスのコンストラクタ
+ */
+CGridSpatialIndex::CGridSpatialIndex()
+    : m_nVisitStamp(0), m_nOriginX(0), m_nOriginY(0), m_nBucketWidth(1), m_nBucketHeight(1), m_nColumns(0), m_nRows(0)
+{
+}
+
+/**
+ * @brief 登録されている矩形をすべて破棄します。
+ */
+void CGridSpatialIndex::Clear()
+{
+    m_rects.clear();
+    m_bucketStart.clear();
+    m_items.clear();
+    m_visitMark.clear();
+    m_nVisitStamp = 0;
+    m_nOriginX = m_nOriginY = 0;
+    m_nBucketWidth = m_nBucketHeight = 1;
+    m_nColumns = m_nRows = 0;
+}
+
+/**
+ * @brief 矩形の集合からインデックスを構築します。
+ * @details 全矩形の外接矩形をバケットに分割し、各矩形を重なる全てのバケットに登録します。
+ * バケットの内容は2パス (個数の集計 → 詰め込み) で1本の配列に連結して保持します。
+ */
+void CGridSpatialIndex::Build(const Rect *pRects, int nCount, int nBucketWidth, int nBucketHeight)
+{
+    Clear();
+    if (pRects == nullptr || nCount <= 0)
+        return;
+
+    m_rects.assign(pRects, pRects + nCount);
+    m_visitMark.assign(nCount, 0);
+
+    // 有効な矩形の外接矩形と平均サイズを求める
+    long long sumWidth = 0, sumHeight = 0;
+    int nValid = 0;
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
+    for (const Rect &rc : m_rects)
+    {
+        if (!IsValidRect(rc))
+            continue;
+        if (nValid == 0)
+        {
+            minX = rc.left; minY = rc.top; maxX = rc.right; maxY = rc.bottom;
+        }
+        else
+        {
+            minX = (std::min)(minX, rc.left);
+            minY = (std::min)(minY, rc.top);
+            maxX = (std::max)(maxX, rc.right);
+            maxY = (std::max)(maxY, rc.bottom);
+        }
+        sumWidth += rc.right - rc.left;
+        sumHeight += rc.bottom - rc.top;
+        ++nValid;
+    }
+    if (nValid == 0)
+        return;
+
+    // バケットサイズの決定 (指定がなければ矩形の平均サイズ)
+    m_nBucketWidth = (nBucketWidth > 0) ? nBucketWidth : static_cast<int>((std::max)(1LL, sumWidth / nValid));
+    m_nBucketHeight = (nBucketHeight > 0) ? nBucketHeight : static_cast<int>((std::max)(1LL, sumHeight / nValid));
+    m_nOriginX = minX;
+    m_nOriginY = minY;
+
+    const long long maxBuckets = MAX_BUCKETS_PER_RECT * nValid + 16;
+    for (;;)
+    {
+        m_nColumns = (maxX - minX + m_nBucketWidth - 1) / m_nBucketWidth;
+        m_nRows = (maxY - minY + m_nBucketHeight - 1) / m_nBucketHeight;
+        if (static_cast<long long>(m_nColumns) * m_nRows <= maxBuckets)
+            break;
+        // バケットが多すぎる場合は大きくして作り直す
+        m_nBucketWidth *= 2;
+        m_nBucketHeight *= 2;
+    }
+
+    // 1パス目: バケットごとの個数を集計
+    const int nBuckets = m_nColumns * m_nRows;
+    m_bucketStart.assign(nBuckets + 1, 0);
+    for (const Rect &rc : m_rects)
+    {
+        if (!IsValidRect(rc))
+            continue;
+        const int c0 = ColumnOf(rc.left), c1 = ColumnOf(rc.right - 1);
+        const int r0 = RowOf(rc.top), r1 = RowOf(rc.bottom - 1);
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                ++m_bucketStart[r * m_nColumns + c + 1];
+    }
+    for (int b = 0; b < nBuckets; ++b)
+        m_bucketStart[b + 1] += m_bucketStart[b];
+
+    // 2パス目: インデックス順に詰め込む (各バケット内はインデックスの昇順になる)
+    m_items.resize(m_bucketStart[nBuckets]);
+    std::vector<int> fill(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (int i = 0; i < nCount; ++i)
+    {
+        const Rect &rc = m_rects[i];
+        if (!IsValidRect(rc))
+            continue;
+        const int c0 = ColumnOf(rc.left), c1 = ColumnOf(rc.right - 1);
+        const int r0 = RowOf(rc.top), r1 = RowOf(rc.bottom - 1);
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                m_items[fill[r * m_nColumns + c]++] = i;
+    }
+}
+
+/**
+ * @brief X座標からバケットの列番号を求めます (範囲外はクランプ)。
+ */
+int CGridSpatialIndex::ColumnOf(int x) const
+{
+    const int c = FloorDiv(x - m_nOriginX, m_nBucketWidth);
+    return (std::max)(0, (std::min)(c, m_nColumns - 1));
+}
+
+/**
+ * @brief Y座標からバケットの行番号を求めます (範囲外はクランプ)。
+ */
+int CGridSpatialIndex::RowOf(int y) const
+{
+    const int r = FloorDiv(y - m_nOriginY, m_nBucketHeight);
+    return (std::max)(0, (std::min)(r, m_nRows - 1));
+}
+
+/**
+ * @brief 指定した点を含む矩形を検索します。
+ * @details 点が属するバケット1個だけを走査します。
+ */
+int CGridSpatialIndex::HitTest(int x, int y) const
+{
+    if (m_nColumns == 0 || m_nRows == 0)
+        return -1;
+    if (x < m_nOriginX || y < m_nOriginY ||
+        x >= m_nOriginX + m_nColumns * m_nBucketWidth || y >= m_nOriginY + m_nRows * m_nBucketHeight)
+        return -1;
+
+    const int b = RowOf(y) * m_nColumns + ColumnOf(x);
+    for (int k = m_bucketStart[b]; k < m_bucketStart[b + 1]; ++k)
+    {
+        const Rect &rc = m_rects[m_items[k]];
+        if (x >= rc.left && x < rc.right && y >= rc.top && y < rc.bottom)
+            return m_items[k];
+    }
+    return -1;
+}
+
+/**
+ * @brief 基準の矩形から指定方向で最も近い矩形を検索します。
+ * @details 進行方向に沿ってバケットを1列 (上下なら1行) ずつ走査します。
+ * まだ訪問していない候補の主軸距離は、その列の境界から下限を見積もれるため、
+ * `WEIGHT_MAJOR * 下限^2` が現在の最良値以上になった時点で走査を打ち切ります。
+ * 評価値は中心座標の2倍値で計算し、整数演算のみで比較します (同点ならインデックスの小さい方)。
+ */
+int CGridSpatialIndex::FindNearest(int nFromIndex, Direction dir) const
+{
+    if (nFromIndex < 0 || nFromIndex >= GetCount() || m_nColumns == 0 || m_nRows == 0)
+        return -1;
+    const Rect &from = m_rects[nFromIndex];
+    if (!IsValidRect(from))
+        return -1;
+
+    // 訪問マークを更新 (一周した場合はマークをリセット)
+    if (++m_nVisitStamp == 0)
+    {
+        std::fill(m_visitMark.begin(), m_visitMark.end(), 0u);
+        m_nVisitStamp = 1;
+    }
+    m_visitMark[nFromIndex] = m_nVisitStamp;
+
+    const bool bVertical = (dir == DIR_UP || dir == DIR_DOWN);
+    const bool bForward = (dir == DIR_DOWN || dir == DIR_RIGHT);
+
+    // 走査するライン (上下ならバケット行、左右ならバケット列) の範囲と向き
+    const int nLines = bVertical ? m_nRows : m_nColumns;
+    const int nCross = bVertical ? m_nColumns : m_nRows;
+    const int nLineSize = bVertical ? m_nBucketHeight : m_nBucketWidth;
+    const int nLineOrigin = bVertical ? m_nOriginY : m_nOriginX;
+    const int nEdge = bVertical ? (bForward ? from.bottom : from.top) : (bForward ? from.right : from.left);
+    const int nFirstLine = bVertical ? RowOf(bForward ? nEdge : nEdge - 1) : ColumnOf(bForward ? nEdge : nEdge - 1);
+    const int nStep = bForward ? 1 : -1;
+    const long long fromCenter2 = bVertical ? (static_cast<long long>(from.left) + from.right)
+                                            : (static_cast<long long>(from.top) + from.bottom);
+
+    int nBest = -1;
+    long long bestScore = 0;
+
+    for (int line = nFirstLine; line >= 0 && line < nLines; line += nStep)
+    {
+        // このラインで初めて現れる候補の主軸距離の下限
+        const int lineNear = bForward ? (nLineOrigin + line * nLineSize) : (nLineOrigin + (line + 1) * nLineSize);
+        const long long minGap = (std::max)(0LL, bForward ? static_cast<long long>(lineNear) - nEdge
+                                                          : static_cast<long long>(nEdge) - lineNear);
+        if (nBest != -1 && 4 * WEIGHT_MAJOR * minGap * minGap >= bestScore)
+            break;
+
+        for (int cross = 0; cross < nCross; ++cross)
+        {
+            const int b = bVertical ? (line * m_nColumns + cross) : (cross * m_nColumns + line);
+            for (int k = m_bucketStart[b]; k < m_bucketStart[b + 1]; ++k)
+            {
+                const int i = m_items[k];
+                if (m_visitMark[i] == m_nVisitStamp)
+                    continue;
+                m_visitMark[i] = m_nVisitStamp;
+
+                const Rect &rc = m_rects[i];
+                long long gap;
+                long long center2;
+                if (bVertical)
+                {
+                    gap = bForward ? static_cast<long long>(rc.top) - from.bottom : static_cast<long long>(from.top) - rc.bottom;
+                    center2 = static_cast<long long>(rc.left) + rc.right;
+                }
+                else
+                {
+                    gap = bForward ? static_cast<long long>(rc.left) - from.right : static_cast<long long>(from.left) - rc.right;
+                    center2 = static_cast<long long>(rc.top) + rc.bottom;
+                }
+                if (gap < 0)
+                    continue; // 進行方向に完全に離れていない矩形は候補外
+
+                // 2倍座標での評価値: 4 * (WEIGHT_MAJOR * gap^2 + minor^2)
+                const long long minor2 = center2 - fromCenter2;
+                const long long score = 4 * WEIGHT_MAJOR * gap * gap + minor2 * minor2;
+                if (nBest == -1 || score < bestScore || (score == bestScore && i < nBest))
+                {
+                    nBest = i;
+                    bestScore = score;
+                }
+            }
+        }
+    }
+    return nBest;
+}
@@ -0,0 +1,105 @@
+﻿/**
+ * @file GridSpatialIndex.h
+ * @brief グリッド矩形群に対する空間インデックス (均一バケット格子) のクラス宣言
+ * @details ダイアログ上に配置された複数グリッドの矩形を一定サイズのバケットに振り分け、
+ * 点のヒットテストと「指定方向で最も近いグリッド」の検索を、全件走査なしで行います。
+ * グリッドの大きさが不揃いな場合や、配置に隙間がある場合でも幾何的に正しい移動先を返します。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <vector>
+
+/**
+ * @class CGridSpatialIndex
+ * @brief 矩形の集合に対する均一バケット格子による空間インデックス
+ * @details Build() で登録した矩形は、登録順のインデックス (0始まり) で識別されます。
+ * 座標系は呼び出し側で統一してください (ダイアログのコンテンツ座標など、スクロールに依存しない座標を推奨)。
+ * 検索関数は内部の訪問済みマークを更新するため、同一インスタンスを複数スレッドから同時に検索しないでください。
+ */
+class CGridSpatialIndex
+{
+public:
+    /**
+     * @struct Rect
+     * @brief 登録する矩形 (right, bottom は含まない半開区間)
+     */
+    struct Rect
+    {
+        int left;   ///< 左端のX座標
+        int top;    ///< 上端のY座標
+        int right;  ///< 右端のX座標 (含まない)
+        int bottom; ///< 下端のY座標 (含まない)
+    };
+
+    /// @brief 移動方向
+    enum Direction
+    {
+        DIR_UP,    ///< 上方向
+        DIR_DOWN,  ///< 下方向
+        DIR_LEFT,  ///< 左方向
+        DIR_RIGHT  ///< 右方向
+    };
+
+    CGridSpatialIndex();
+
+    /**
+     * @brief 矩形の集合からインデックスを構築します。
+     * @param[in] pRects 矩形の配列 (幅・高さが0以下の矩形は検索対象外)
+     * @param[in] nCount 矩形の個数
+     * @param[in] nBucketWidth バケットの幅 (0以下なら矩形の平均幅から自動決定)
+     * @param[in] nBucketHeight バケットの高さ (0以下なら矩形の平均高さから自動決定)
+     */
+    void Build(const Rect *pRects, int nCount, int nBucketWidth = 0, int nBucketHeight = 0);
+
+    /// @brief 登録されている矩形をすべて破棄します。
+    void Clear();
+
+    /// @brief 登録されている矩形の個数を返します。
+    int GetCount() const { return static_cast<int>(m_rects.size()); }
+
+    /// @brief 登録済みの矩形を返します。
+    const Rect &GetRect(int nIndex) const { return m_rects[nIndex]; }
+
+    /**
+     * @brief 指定した点を含む矩形を検索します。
+     * @param[in] x 点のX座標
+     * @param[in] y 点のY座標
+     * @return 点を含む矩形のインデックス (重なっている場合は最小のインデックス)。見つからない場合は-1
+     */
+    int HitTest(int x, int y) const;
+
+    /**
+     * @brief 基準の矩形から指定方向で最も近い矩形を検索します。
+     * @details 指定方向に完全に離れている矩形 (下方向なら上端が基準の下端以上のもの) だけを候補とし、
+     * 進行方向の距離 (主軸) と、直交方向の中心のずれ (副軸) から
+     * `WEIGHT_MAJOR * 主軸^2 + 副軸^2` を評価値として最小のものを返します。
+     * 主軸の距離が近いバケット列から順に走査し、それ以上良い候補が現れない時点で打ち切ります。
+     * @param[in] nFromIndex 基準の矩形のインデックス
+     * @param[in] dir 移動方向
+     * @return 移動先の矩形のインデックス。候補がない場合は-1
+     */
+    int FindNearest(int nFromIndex, Direction dir) const;
+
+    /// @brief 主軸の距離に掛ける重み (直進方向の候補を斜めの候補より優先させるための係数)
+    static constexpr long long WEIGHT_MAJOR = 13;
+
+private:
+    /// @brief X座標からバケットの列番号を求めます (範囲外はクランプ)。
+    int ColumnOf(int x) const;
+    /// @brief Y座標からバケットの行番号を求めます (範囲外はクランプ)。
+    int RowOf(int y) const;
+
+    std::vector<Rect> m_rects;         ///< 登録済みの矩形 (インデックス順)
+    std::vector<int> m_bucketStart;    ///< バケットごとの m_items 内の開始位置 (バケット数+1個)
+    std::vector<int> m_items;          ///< 全バケットの矩形インデックスを連結した配列
+    mutable std::vector<unsigned int> m_visitMark; ///< 検索中に重複を除くための訪問済みマーク
+    mutable unsigned int m_nVisitStamp;            ///< 現在の検索の訪問マーク値
+
+    int m_nOriginX;      ///< バケット格子の原点X
+    int m_nOriginY;      ///< バケット格子の原点Y
+    int m_nBucketWidth;  ///< バケットの幅
+    int m_nBucketHeight; ///< バケットの高さ
+    int m_nColumns;      ///< バケットの列数
+    int m_nRows;         ///< バケットの行数
+};
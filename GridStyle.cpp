@@ -0,0 +1,107 @@
+﻿/**
+ * @file GridStyle.cpp
+ * @brief グリッドのセルの書式とスタイル表の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "GridStyle.h"
+
+namespace
+{
+// 色の定義
+const RenderColor CLR_TEXT = RenderRgb(0, 0, 0);        ///< 既定の文字色 (黒色)
+const RenderColor CLR_BORDER = RenderRgb(192, 192, 192); ///< 既定の枠線の色 (銀色)
+}
+
+/**
+ * @brief 既定の書式を作ります。
+ */
+GRID_CELL_STYLE GRID_CELL_STYLE::Default(RenderColor bgColor)
+{
+    GRID_CELL_STYLE style;
+    style.bgColor = bgColor;
+    style.textColor = CLR_TEXT;
+    style.borderColor = CLR_BORDER;
+    style.nBorderWidth = 1;
+    style.nAlign = RENDER_TEXT_LEFT;
+    style.bBold = 0;
+    style.nNumberRule = GRID_NUMBER_RULE_NONE;
+    return style;
+}
+
+/**
+ * @brief 全ての項目が等しいかを返します。
+ */
+bool GRID_CELL_STYLE::operator==(const GRID_CELL_STYLE &other) const
+{
+    return bgColor == other.bgColor && textColor == other.textColor && borderColor == other.borderColor &&
+           nBorderWidth == other.nBorderWidth && nAlign == other.nAlign && bBold == other.bBold && nNumberRule == other.nNumberRule;
+}
+
+/**
+ * @brief 書式の項目から FNV-1a でハッシュ値を求めます。
+ */
+std::size_t CGridStyleTable::Hasher::operator()(const GRID_CELL_STYLE &style) const
+{
+    std::uint64_t nHash = 14695981039346656037ull;
+    auto mix = [&nHash](std::uint32_t nValue) {
+        nHash ^= nValue;
+        nHash *= 1099511628211ull;
+    };
+    mix(style.bgColor);
+    mix(style.textColor);
+    mix(style.borderColor);
+    mix(static_cast<std::uint32_t>(style.nBorderWidth) | (static_cast<std::uint32_t>(style.nAlign) << 8) |
+        (static_cast<std::uint32_t>(style.bBold) << 16) | (static_cast<std::uint32_t>(style.nNumberRule) << 24));
+    return static_cast<std::size_t>(nHash);
+}
+
+/**
+ * @brief コンストラクタ
+ */
+CGridStyleTable::CGridStyleTable()
+    : m_nLastIndex(-1)
+{
+}
+
+/**
+ * @brief 書式を登録し、番号を返します。
+ */
+int CGridStyleTable::Intern(const GRID_CELL_STYLE &style)
+{
+    if (m_nLastIndex != -1 && m_styles[m_nLastIndex] == style)
+        return m_nLastIndex;
+
+    const auto it = m_indexes.find(style);
+    if (it != m_indexes.end())
+    {
+        m_nLastIndex = it->second;
+        return m_nLastIndex;
+    }
+    if (GetCount() >= MAX_STYLES)
+        return -1;
+
+    m_nLastIndex = GetCount();
+    m_styles.push_back(style);
+    m_indexes.emplace(style, static_cast<GridStyleIndex>(m_nLastIndex));
+    return m_nLastIndex;
+}
+
+/**
+ * @brief 全ての書式を削除します。
+ */
+void CGridStyleTable::Clear()
+{
+    m_styles.clear();
+    m_indexes.clear();
+    m_nLastIndex = -1;
+}
+
+/**
+ * @brief 表が確保しているメモリの量を返します。
+ * @details ハッシュ表は、バケットの配列と、登録ごとのノード (書式・番号・次のノードへのポインタ) の大きさで概算します。
+ */
+std::size_t CGridStyleTable::GetMemoryUsage() const
+{
+    const std::size_t nNodeSize = sizeof(GRID_CELL_STYLE) + sizeof(GridStyleIndex) + 2 * sizeof(void *);
+    return m_styles.capacity() * sizeof(GRID_CELL_STYLE) + m_indexes.bucket_count() * sizeof(void *) + m_indexes.size() * nNodeSize;
+}
@@ -0,0 +1,98 @@
+﻿/**
+ * @file GridStyle.h
+ * @brief グリッドのセルの書式 (スタイル) と、重複を除いて保持するスタイル表のクラス宣言
+ * @details セルごとに背景色・文字色・配置・太字・枠線・数値の色分けを持たせると、セルの数だけ同じ書式が複製されます。
+ * CGridStyleTable は同じ内容の書式を1つにまとめて番号を付け、セルは2バイトの番号だけを持ちます (フライウェイト)。
+ * 書式の種類は実際には数十個程度のため、セル数が増えても書式の分のメモリはほとんど増えません。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "RenderTarget.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// @brief セルが持つスタイルの番号
+using GridStyleIndex = std::uint16_t;
+
+/// @brief 数値の色分けの規則
+enum EGridNumberRule : std::uint8_t
+{
+    GRID_NUMBER_RULE_NONE = 0, ///< 内容によらず書式の色で描画します
+    GRID_NUMBER_RULE_SIGN = 1  ///< 空欄は薄黄色、負の数は水色の背景と赤字、正の数はオレンジの背景と青字にします
+};
+
+/**
+ * @struct GRID_CELL_STYLE
+ * @brief セルの書式
+ * @details 全ての項目を比較するため、未使用の領域はありません (16バイト)。
+ */
+struct GRID_CELL_STYLE
+{
+    RenderColor bgColor;       ///< 背景色
+    RenderColor textColor;     ///< 文字色
+    RenderColor borderColor;   ///< 枠線の色
+    std::uint8_t nBorderWidth; ///< 枠線の太さ (0なら枠線を描画しません)
+    std::uint8_t nAlign;       ///< 文字列の横の配置 (RENDER_TEXT_LEFT / RENDER_TEXT_CENTER / RENDER_TEXT_RIGHT)
+    std::uint8_t bBold;        ///< 太字なら1
+    std::uint8_t nNumberRule;  ///< 数値の色分けの規則 (EGridNumberRule)
+
+    /**
+     * @brief 既定の書式 (黒字・左揃え・銀色の1ピクセルの枠線・色分けなし) を作ります。
+     * @param[in] bgColor 背景色
+     */
+    static GRID_CELL_STYLE Default(RenderColor bgColor);
+
+    bool operator==(const GRID_CELL_STYLE &other) const;
+    bool operator!=(const GRID_CELL_STYLE &other) const { return !(*this == other); }
+};
+
+/**
+ * @class CGridStyleTable
+ * @brief 書式を重複なく保持し、番号で参照させる表
+ * @details 登録した書式は表を作り直すまで削除せず、番号も変わりません。
+ * 同じ書式を続けて登録する場合 (範囲への一括設定など) は、ハッシュ表を引かずに直前の番号を返します。
+ */
+class CGridStyleTable
+{
+public:
+    /// @brief 登録できる書式の数の上限 (GridStyleIndex で表せる数)
+    static constexpr int MAX_STYLES = 65536;
+
+    CGridStyleTable();
+
+    /**
+     * @brief 書式を登録し、番号を返します。
+     * @details 同じ内容の書式が登録済みなら、その番号を返します。
+     * @param[in] style 書式
+     * @return 番号。上限に達していて登録できない場合は-1。
+     */
+    int Intern(const GRID_CELL_STYLE &style);
+
+    /// @brief 番号の書式を返します (番号は検証しません)。
+    const GRID_CELL_STYLE &Get(int nIndex) const { return m_styles[nIndex]; }
+    /// @brief 番号が登録済みの書式を指しているかを返します。
+    bool IsValid(int nIndex) const { return nIndex >= 0 && nIndex < GetCount(); }
+    /// @brief 登録されている書式の数を返します。
+    int GetCount() const { return static_cast<int>(m_styles.size()); }
+
+    /// @brief 全ての書式を削除します。
+    void Clear();
+
+    /// @brief 表が確保しているメモリの量 (バイト、ハッシュ表は概算) を返します。
+    std::size_t GetMemoryUsage() const;
+
+private:
+    /// @brief 書式のハッシュ値を求める関数オブジェクト
+    struct Hasher
+    {
+        std::size_t operator()(const GRID_CELL_STYLE &style) const;
+    };
+
+    std::vector<GRID_CELL_STYLE> m_styles;                                   ///< 番号順の書式
+    std::unordered_map<GRID_CELL_STYLE, GridStyleIndex, Hasher> m_indexes;   ///< 書式から番号への対応
+    int m_nLastIndex;                                                        ///< 直前に登録または検索した番号 (なければ-1)
+};
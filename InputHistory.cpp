@@ -0,0 +1,446 @@
+﻿/**
+ * @file InputHistory.cpp
+ * @brief 入力欄ごとの入力履歴と前方一致の入力候補の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "InputHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+
+namespace
+{
+/// @brief 保存形式の識別子
+const unsigned char s_magic[4] = {'I', 'H', 'S', '1'};
+/// @brief 点数の下限 (未使用の節点の最高点)
+const float s_fNoScore = -1.0e30f;
+
+/// @brief 可変長の整数を書き出します (下位から7ビットずつ、続きがあれば最上位ビットを立てます)。
+void WriteVarint(std::vector<unsigned char> &data, std::uint32_t nValue)
+{
+    while (nValue >= 0x80u)
+    {
+        data.push_back(static_cast<unsigned char>(nValue | 0x80u));
+        nValue >>= 7;
+    }
+    data.push_back(static_cast<unsigned char>(nValue));
+}
+
+/// @brief 可変長の整数を読み込みます。
+bool ReadVarint(const unsigned char *data, std::size_t nSize, std::size_t &nPos, std::uint32_t &nValue)
+{
+    nValue = 0;
+    for (int nShift = 0; nShift < 35; nShift += 7)
+    {
+        if (nPos >= nSize)
+            return false;
+        const unsigned char b = data[nPos++];
+        nValue |= static_cast<std::uint32_t>(b & 0x7Fu) << nShift;
+        if ((b & 0x80u) == 0)
+            return true;
+    }
+    return false;
+}
+
+/// @brief 32ビット浮動小数点をリトルエンディアンで書き出します。
+void WriteFloat(std::vector<unsigned char> &data, float fValue)
+{
+    std::uint32_t nBits = 0;
+    std::memcpy(&nBits, &fValue, sizeof(nBits));
+    for (int i = 0; i < 4; ++i)
+        data.push_back(static_cast<unsigned char>(nBits >> (8 * i)));
+}
+
+/// @brief 32ビット浮動小数点をリトルエンディアンで読み込みます。
+bool ReadFloat(const unsigned char *data, std::size_t nSize, std::size_t &nPos, float &fValue)
+{
+    if (nSize - nPos < 4 || nPos > nSize)
+        return false;
+    std::uint32_t nBits = 0;
+    for (int i = 0; i < 4; ++i)
+        nBits |= static_cast<std::uint32_t>(data[nPos + i]) << (8 * i);
+    nPos += 4;
+    std::memcpy(&fValue, &nBits, sizeof(fValue));
+    return true;
+}
+
+/// @brief 文字列を長さと UTF-16 の符号単位で書き出します。
+void WriteChars(std::vector<unsigned char> &data, const wchar_t *psz, std::size_t nLength)
+{
+    WriteVarint(data, static_cast<std::uint32_t>(nLength));
+    for (std::size_t i = 0; i < nLength; ++i)
+        WriteVarint(data, static_cast<std::uint32_t>(psz[i]) & 0xFFFFu);
+}
+
+/// @brief log2(2^a + 2^b) を桁あふれなく求めます。
+float LogAdd2(float a, float b)
+{
+    const float fMax = (std::max)(a, b);
+    const float fMin = (std::min)(a, b);
+    if (fMin <= s_fNoScore)
+        return fMax;
+    return fMax + std::log2(1.0f + std::exp2(fMin - fMax));
+}
+}
+
+/**
+ * @brief CInputHistoryクラスのコンストラクタ
+ */
+CInputHistory::CInputHistory() : m_nClock(0)
+{
+    Clear();
+}
+
+/**
+ * @brief 全ての履歴を消去します。
+ */
+void CInputHistory::Clear()
+{
+    m_nodes.clear();
+    m_entries.clear();
+    m_nClock = 0;
+    m_nodes.push_back(NODE{NO_NODE, NO_NODE, NO_NODE, -1, s_fNoScore, L'\0'});
+}
+
+/**
+ * @brief 子の節点を探します。
+ */
+std::uint32_t CInputHistory::FindChild(std::uint32_t nNode, wchar_t ch) const
+{
+    for (std::uint32_t nChild = m_nodes[nNode].nFirstChild; nChild != NO_NODE; nChild = m_nodes[nChild].nNextSibling)
+    {
+        if (m_nodes[nChild].ch == ch)
+            return nChild;
+    }
+    return NO_NODE;
+}
+
+/**
+ * @brief 子の節点を探し、なければ最後の子として追加します。
+ * @details 追加した節点はまだ登録を持たない (最高点が最も低い) ため、兄弟の末尾に置きます。
+ */
+std::uint32_t CInputHistory::FindOrAddChild(std::uint32_t nNode, wchar_t ch)
+{
+    std::uint32_t nLast = NO_NODE;
+    for (std::uint32_t nChild = m_nodes[nNode].nFirstChild; nChild != NO_NODE; nChild = m_nodes[nChild].nNextSibling)
+    {
+        if (m_nodes[nChild].ch == ch)
+            return nChild;
+        nLast = nChild;
+    }
+
+    const std::uint32_t nChild = static_cast<std::uint32_t>(m_nodes.size());
+    m_nodes.push_back(NODE{nNode, NO_NODE, NO_NODE, -1, s_fNoScore, ch});
+    if (nLast == NO_NODE)
+        m_nodes[nNode].nFirstChild = nChild;
+    else
+        m_nodes[nLast].nNextSibling = nChild;
+    return nChild;
+}
+
+/**
+ * @brief 節点の登録を取得し、なければ追加します。
+ */
+int CInputHistory::EntryOf(std::uint32_t nNode)
+{
+    if (m_nodes[nNode].nEntry < 0)
+    {
+        m_nodes[nNode].nEntry = static_cast<std::int32_t>(m_entries.size());
+        m_entries.push_back(ENTRY{nNode, 0, s_fNoScore});
+    }
+    return m_nodes[nNode].nEntry;
+}
+
+/**
+ * @brief 登録の点数を設定し、根までの節点の最高点と兄弟の順序を更新します。
+ * @details 点数は増えるだけなので、最高点は途中で更新が不要になった時点で打ち切れます。
+ * 最高点が上がった節点は兄弟の並びから外し、最高点の高い順の位置へ前に移します。
+ */
+void CInputHistory::SetScore(int nEntry, float fScore)
+{
+    m_entries[nEntry].fScore = fScore;
+    for (std::uint32_t nNode = m_entries[nEntry].nNode; nNode != NO_NODE; nNode = m_nodes[nNode].nParent)
+    {
+        NODE &node = m_nodes[nNode];
+        if (node.fBest >= fScore)
+            break;
+        node.fBest = fScore;
+        if (node.nParent == NO_NODE)
+            break;
+
+        // 兄弟の並びから外し、自分より最高点の高い兄弟の直後に入れ直します。
+        std::uint32_t &nFirst = m_nodes[node.nParent].nFirstChild;
+        std::uint32_t nPrev = NO_NODE;
+        std::uint32_t nInsertAfter = NO_NODE;
+        for (std::uint32_t nSibling = nFirst; nSibling != nNode; nSibling = m_nodes[nSibling].nNextSibling)
+        {
+            if (m_nodes[nSibling].fBest >= fScore)
+                nInsertAfter = nSibling;
+            nPrev = nSibling;
+        }
+        if (nPrev == nInsertAfter)
+            continue;
+        m_nodes[nPrev].nNextSibling = node.nNextSibling;
+        if (nInsertAfter == NO_NODE)
+        {
+            node.nNextSibling = nFirst;
+            nFirst = nNode;
+        }
+        else
+        {
+            node.nNextSibling = m_nodes[nInsertAfter].nNextSibling;
+            m_nodes[nInsertAfter].nNextSibling = nNode;
+        }
+    }
+}
+
+/**
+ * @brief 確定した入力を記録します。
+ */
+void CInputHistory::Record(const wchar_t *pszText)
+{
+    if (pszText == nullptr || pszText[0] == L'\0')
+        return;
+
+    std::uint32_t nNode = 0;
+    for (const wchar_t *p = pszText; *p != L'\0'; ++p)
+        nNode = FindOrAddChild(nNode, *p);
+
+    const int nEntry = EntryOf(nNode);
+    ENTRY &entry = m_entries[nEntry];
+    ++entry.nUseCount;
+    ++m_nClock;
+    SetScore(nEntry, LogAdd2(entry.fScore, static_cast<float>(m_nClock / HALF_LIFE_USES)));
+}
+
+/**
+ * @brief 接頭辞に一致する入力候補を点数の高い順に求めます。
+ * @details 接頭辞の節点から、部分木の最高点と登録の点数を優先度とする最良優先探索を行います。
+ * 取り出した候補が登録であれば、残りの候補はそれ以下の点数しか持たないため、その順に確定します。
+ * 兄弟は最高点の高い順に並んでいるため、部分木を取り出したときに加えるのは
+ * その登録・最初の子・次の兄弟の3つまでで、探索の対象は求める件数と深さに比例する数に収まります。
+ */
+void CInputHistory::Suggest(const wchar_t *pszPrefix, int nMaxCount, std::vector<int> &results)
+{
+    results.clear();
+    if (nMaxCount <= 0)
+        return;
+
+    std::uint32_t nNode = 0;
+    for (const wchar_t *p = pszPrefix; p != nullptr && *p != L'\0'; ++p)
+    {
+        nNode = FindChild(nNode, *p);
+        if (nNode == NO_NODE)
+            return;
+    }
+
+    m_heap.clear();
+    // 接頭辞そのものの登録は候補にしないため、子の部分木から探します。
+    const std::uint32_t nFirst = m_nodes[nNode].nFirstChild;
+    if (nFirst != NO_NODE)
+        m_heap.push_back(CANDIDATE{m_nodes[nFirst].fBest, nFirst, false});
+
+    while (!m_heap.empty() && static_cast<int>(results.size()) < nMaxCount)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end());
+        const CANDIDATE candidate = m_heap.back();
+        m_heap.pop_back();
+
+        const NODE &node = m_nodes[candidate.nNode];
+        if (candidate.bEntry)
+        {
+            results.push_back(node.nEntry);
+            continue;
+        }
+        if (node.nEntry >= 0)
+        {
+            m_heap.push_back(CANDIDATE{m_entries[node.nEntry].fScore, candidate.nNode, true});
+            std::push_heap(m_heap.begin(), m_heap.end());
+        }
+        for (std::uint32_t nNext : {node.nFirstChild, node.nNextSibling})
+        {
+            if (nNext == NO_NODE)
+                continue;
+            m_heap.push_back(CANDIDATE{m_nodes[nNext].fBest, nNext, false});
+            std::push_heap(m_heap.begin(), m_heap.end());
+        }
+    }
+}
+
+/**
+ * @brief 登録番号の文字列を求めます。
+ * @details 最後の文字の節点から根まで親をたどり、逆順に並べます。
+ */
+void CInputHistory::GetText(int nEntry, std::wstring &text) const
+{
+    text.clear();
+    for (std::uint32_t nNode = m_entries[nEntry].nNode; nNode != 0; nNode = m_nodes[nNode].nParent)
+        text.push_back(m_nodes[nNode].ch);
+    std::reverse(text.begin(), text.end());
+}
+
+/**
+ * @brief 登録と節点の表が使用しているおおよそのバイト数を返します。
+ */
+std::size_t CInputHistory::GetMemoryUsage() const
+{
+    return m_nodes.capacity() * sizeof(NODE) + m_entries.capacity() * sizeof(ENTRY) +
+           m_heap.capacity() * sizeof(CANDIDATE);
+}
+
+/**
+ * @brief 履歴をバイト列の末尾に追加します。
+ * @details 形式は「時刻, 登録数, 登録 × 登録数」で、登録は「直前と共通する前方の文字数, 残りの文字列, 使用回数, 点数」です。
+ * 深さ優先の順に並べるため、直前の登録と共通する前方の部分は書き出しません。
+ */
+void CInputHistory::Serialize(std::vector<unsigned char> &data) const
+{
+    WriteVarint(data, m_nClock);
+    WriteVarint(data, static_cast<std::uint32_t>(m_entries.size()));
+
+    std::wstring path;     // 現在の節点までの文字列
+    std::wstring previous; // 直前に書き出した登録の文字列
+    std::vector<std::uint32_t> stack;
+    for (std::uint32_t nChild = m_nodes[0].nFirstChild; nChild != NO_NODE; nChild = m_nodes[nChild].nNextSibling)
+        stack.push_back(nChild);
+    std::vector<std::size_t> depths(stack.size(), 0);
+
+    while (!stack.empty())
+    {
+        const std::uint32_t nNode = stack.back();
+        const std::size_t nDepth = depths.back();
+        stack.pop_back();
+        depths.pop_back();
+
+        const NODE &node = m_nodes[nNode];
+        path.resize(nDepth);
+        path.push_back(node.ch);
+        if (node.nEntry >= 0)
+        {
+            std::size_t nShared = 0;
+            const std::size_t nLimit = (std::min)(previous.size(), path.size());
+            while (nShared < nLimit && previous[nShared] == path[nShared])
+                ++nShared;
+            WriteVarint(data, static_cast<std::uint32_t>(nShared));
+            WriteChars(data, path.data() + nShared, path.size() - nShared);
+            const ENTRY &entry = m_entries[node.nEntry];
+            WriteVarint(data, entry.nUseCount);
+            WriteFloat(data, entry.fScore);
+            previous = path;
+        }
+        for (std::uint32_t nChild = node.nFirstChild; nChild != NO_NODE; nChild = m_nodes[nChild].nNextSibling)
+        {
+            stack.push_back(nChild);
+            depths.push_back(nDepth + 1);
+        }
+    }
+}
+
+/**
+ * @brief バイト列から履歴を読み込みます。
+ * @details 直前の登録の節点の経路を保持しておき、共通する前方の部分は経路から再開して残りの文字だけをたどります。
+ */
+bool CInputHistory::Deserialize(const unsigned char *data, std::size_t nSize, std::size_t &nPos)
+{
+    Clear();
+
+    std::uint32_t nClock = 0;
+    std::uint32_t nCount = 0;
+    if (!ReadVarint(data, nSize, nPos, nClock) || !ReadVarint(data, nSize, nPos, nCount))
+        return false;
+    // 1件あたり最低6バイト (共通文字数・文字数・使用回数・点数) あるため、それを超える件数は不正です。
+    if (nCount > (nSize - nPos) / 6)
+        return false;
+    m_entries.reserve(nCount);
+
+    std::vector<std::uint32_t> path(1, 0); // path[i] は前方 i 文字の節点
+    for (std::uint32_t i = 0; i < nCount; ++i)
+    {
+        std::uint32_t nShared = 0;
+        std::uint32_t nLength = 0;
+        if (!ReadVarint(data, nSize, nPos, nShared) || !ReadVarint(data, nSize, nPos, nLength) ||
+            nShared >= path.size() || nLength > nSize - nPos || nShared + nLength == 0)
+        {
+            Clear();
+            return false;
+        }
+        path.resize(nShared + 1);
+        for (std::uint32_t j = 0; j < nLength; ++j)
+        {
+            std::uint32_t nChar = 0;
+            if (!ReadVarint(data, nSize, nPos, nChar) || nChar == 0 || nChar > 0xFFFFu)
+            {
+                Clear();
+                return false;
+            }
+            path.push_back(FindOrAddChild(path.back(), static_cast<wchar_t>(nChar)));
+        }
+
+        std::uint32_t nUseCount = 0;
+        float fScore = 0.0f;
+        if (!ReadVarint(data, nSize, nPos, nUseCount) || !ReadFloat(data, nSize, nPos, fScore) || !std::isfinite(fScore))
+        {
+            Clear();
+            return false;
+        }
+        const int nEntry = EntryOf(path.back());
+        m_entries[nEntry].nUseCount = nUseCount;
+        SetScore(nEntry, (std::max)(m_entries[nEntry].fScore, fScore));
+    }
+    m_nClock = nClock;
+    return true;
+}
+
+/**
+ * @brief 全ての入力欄の履歴をバイト列にします。
+ */
+void CInputHistoryStore::Serialize(std::vector<unsigned char> &data) const
+{
+    data.assign(s_magic, s_magic + sizeof(s_magic));
+    WriteVarint(data, static_cast<std::uint32_t>(m_fields.size()));
+    for (const auto &field : m_fields)
+    {
+        WriteChars(data, field.first.data(), field.first.size());
+        field.second.Serialize(data);
+    }
+}
+
+/**
+ * @brief バイト列から全ての入力欄の履歴を読み込みます。
+ */
+bool CInputHistoryStore::Deserialize(const unsigned char *data, std::size_t nSize)
+{
+    for (auto &field : m_fields)
+        field.second.Clear();
+
+    std::size_t nPos = 0;
+    std::uint32_t nFields = 0;
+    if (data == nullptr || nSize < sizeof(s_magic) || std::memcmp(data, s_magic, sizeof(s_magic)) != 0)
+        return false;
+    nPos = sizeof(s_magic);
+    if (!ReadVarint(data, nSize, nPos, nFields))
+        return false;
+
+    std::wstring name;
+    for (std::uint32_t i = 0; i < nFields; ++i)
+    {
+        std::uint32_t nLength = 0;
+        bool bValid = ReadVarint(data, nSize, nPos, nLength) && nLength <= nSize - nPos;
+        name.clear();
+        for (std::uint32_t j = 0; bValid && j < nLength; ++j)
+        {
+            std::uint32_t nChar = 0;
+            bValid = ReadVarint(data, nSize, nPos, nChar) && nChar <= 0xFFFFu;
+            name.push_back(static_cast<wchar_t>(nChar));
+        }
+        if (!bValid || !GetField(name).Deserialize(data, nSize, nPos))
+        {
+            for (auto &field : m_fields)
+                field.second.Clear();
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,164 @@
+﻿/**
+ * @file InputHistory.h
+ * @brief 入力欄ごとの入力履歴と前方一致の入力候補のクラス宣言
+ * @details 確定した入力文字列をトライ木に蓄積し、入力中の文字列を接頭辞とする候補を
+ * 使用頻度と新しさを合わせた点数の高い順に返します。
+ * 点数は「使うたびに 2^(時刻/半減期) を加算する」形で、新しい使用ほど重みが大きくなります
+ * (値は対数で保持します)。点数は使うたびに増えるだけなので、各節点には部分木の最高点だけを保持し、
+ * 兄弟の節点は最高点の高い順に並べておきます。候補は最高点の高い部分木から順に探す最良優先探索で求め、
+ * 兄弟は1つ取り出すごとに次の1つだけを探索の対象に加えます。探索は上位 k 件が確定した時点で終わるため、
+ * 登録数や子の数が多くても候補を求める時間はほとんど変わりません。
+ * 入力欄ごとの履歴は CInputHistoryStore にまとめ、前方の共通部分を省いたバイト列として保存・読み込みします。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @class CInputHistory
+ * @brief 1つの入力欄の入力履歴 (トライ木)
+ */
+class CInputHistory
+{
+public:
+    /// @brief 点数の半減期 (確定の回数)。この回数だけ後の使用は、2倍の重みになります。
+    static constexpr double HALF_LIFE_USES = 200.0;
+
+    CInputHistory();
+
+    /**
+     * @brief 確定した入力を記録します。
+     * @details 初めての文字列であれば登録し、使用回数と点数を更新します。空文字列は記録しません。
+     * @param[in] pszText 確定した文字列
+     */
+    void Record(const wchar_t *pszText);
+
+    /**
+     * @brief 接頭辞に一致する入力候補を点数の高い順に求めます。
+     * @details 接頭辞そのものと同じ文字列は候補に含めません。接頭辞が空の場合は全体の上位を返します。
+     * 作業領域は再利用するため、繰り返し呼び出してもメモリの確保はほとんど発生しません。
+     * @param[in] pszPrefix 入力中の文字列
+     * @param[in] nMaxCount 求める最大の件数
+     * @param[out] results 候補の登録番号 (呼び出し前の内容は消去します)
+     */
+    void Suggest(const wchar_t *pszPrefix, int nMaxCount, std::vector<int> &results);
+
+    /**
+     * @brief 登録番号の文字列を求めます。
+     * @param[in] nEntry 登録番号
+     * @param[out] text 文字列
+     */
+    void GetText(int nEntry, std::wstring &text) const;
+
+    /// @brief 登録番号の使用回数を返します。
+    std::uint32_t GetUseCount(int nEntry) const { return m_entries[nEntry].nUseCount; }
+    /// @brief 登録数を返します。
+    int GetEntryCount() const { return static_cast<int>(m_entries.size()); }
+    /// @brief トライ木の節点数を返します。
+    int GetNodeCount() const { return static_cast<int>(m_nodes.size()); }
+    /// @brief 登録と節点の表が使用しているおおよそのバイト数を返します。
+    std::size_t GetMemoryUsage() const;
+
+    /// @brief 全ての履歴を消去します。
+    void Clear();
+
+    /**
+     * @brief 履歴をバイト列の末尾に追加します。
+     * @details 登録は深さ優先の順に並べ、直前の文字列と共通する前方の文字数と残りの文字だけを書き出します。
+     */
+    void Serialize(std::vector<unsigned char> &data) const;
+
+    /**
+     * @brief バイト列から履歴を読み込みます (既存の履歴は消去します)。
+     * @param[in] data バイト列
+     * @param[in] nSize バイト数
+     * @param[in,out] nPos 読み込む位置 (読み込んだ分だけ進めます)
+     * @return 形式が正しい場合はtrue (不正な場合は履歴を空にします)
+     */
+    bool Deserialize(const unsigned char *data, std::size_t nSize, std::size_t &nPos);
+
+private:
+    /// @brief 節点がないことを表す番号
+    static constexpr std::uint32_t NO_NODE = 0xFFFFFFFFu;
+
+    /// @brief トライ木の節点 (子は最初の子と次の兄弟の連結リストで、最高点の高い順に保持します)
+    struct NODE
+    {
+        std::uint32_t nParent;      ///< 親の節点
+        std::uint32_t nFirstChild;  ///< 最初の子の節点
+        std::uint32_t nNextSibling; ///< 次の兄弟の節点
+        std::int32_t nEntry;        ///< この節点で終わる登録の番号 (なければ-1)
+        float fBest;                ///< 部分木の登録の最高点 (対数)
+        wchar_t ch;                 ///< 親からこの節点への文字
+    };
+
+    /// @brief 登録された文字列
+    struct ENTRY
+    {
+        std::uint32_t nNode;     ///< 文字列の最後の文字の節点
+        std::uint32_t nUseCount; ///< 使用回数
+        float fScore;            ///< 点数 (log2 で保持)
+    };
+
+    /// @brief 探索の候補 (部分木または登録)
+    struct CANDIDATE
+    {
+        float fScore;        ///< 点数
+        std::uint32_t nNode; ///< 節点
+        bool bEntry;         ///< その節点の登録そのものか (falseなら部分木)
+
+        bool operator<(const CANDIDATE &other) const { return fScore < other.fScore; }
+    };
+
+    /// @brief 子の節点を探します (なければ NO_NODE)。
+    std::uint32_t FindChild(std::uint32_t nNode, wchar_t ch) const;
+    /// @brief 子の節点を探し、なければ最後の子として追加します。
+    std::uint32_t FindOrAddChild(std::uint32_t nNode, wchar_t ch);
+    /// @brief 節点の登録を取得し、なければ追加します。
+    int EntryOf(std::uint32_t nNode);
+    /// @brief 登録の点数を設定し、根までの節点の最高点と兄弟の順序を更新します。
+    void SetScore(int nEntry, float fScore);
+
+    std::vector<NODE> m_nodes;     ///< 節点 (0番が根)
+    std::vector<ENTRY> m_entries;  ///< 登録
+    std::uint32_t m_nClock;        ///< 確定の回数 (点数の時刻)
+    std::vector<CANDIDATE> m_heap; ///< 探索の作業領域
+};
+
+/**
+ * @class CInputHistoryStore
+ * @brief 入力欄の名前ごとの入力履歴
+ * @details 保存形式は、識別子・入力欄の数に続けて、入力欄ごとに名前と CInputHistory::Serialize() の内容を並べたものです。
+ * 整数は可変長 (7ビットずつ) で、点数は32ビット浮動小数点のリトルエンディアンで書き出します。
+ */
+class CInputHistoryStore
+{
+public:
+    /**
+     * @brief 入力欄の履歴を取得します (なければ空の履歴を作ります)。
+     * @details 返した参照は、このオブジェクトが破棄されるまで有効です (Deserialize() でも無効になりません)。
+     * @param[in] name 入力欄の名前
+     */
+    CInputHistory &GetField(const std::wstring &name) { return m_fields[name]; }
+
+    /// @brief 入力欄の数を返します。
+    std::size_t GetFieldCount() const { return m_fields.size(); }
+
+    /// @brief 全ての入力欄の履歴をバイト列にします。
+    void Serialize(std::vector<unsigned char> &data) const;
+
+    /**
+     * @brief バイト列から全ての入力欄の履歴を読み込みます (既存の履歴は消去します)。
+     * @details 入力欄の履歴のオブジェクトは破棄せずに中身だけを入れ替えます。
+     * @return 形式が正しい場合はtrue (不正な場合は全ての履歴を空にします)
+     */
+    bool Deserialize(const unsigned char *data, std::size_t nSize);
+
+private:
+    std::map<std::wstring, CInputHistory> m_fields; ///< 入力欄の名前 → 履歴
+};
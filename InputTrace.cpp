@@ -0,0 +1,367 @@
+﻿/**
+ * @file InputTrace.cpp
+ * @brief 入力遅延トレース機構の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "InputTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> CInputTrace::s_bEnabled(false);
+std::atomic<std::uint64_t> CInputTrace::s_nCurrent(0);
+std::atomic<std::uint64_t> CInputTrace::s_nNextId(1);
+
+namespace
+{
+    static_assert((CInputTrace::RING_CAPACITY & (CInputTrace::RING_CAPACITY - 1)) == 0,
+                  "リングバッファの容量は2のべき乗である必要があります");
+    static_assert(CInputTrace::INPUT_KIND_COUNT <= 4, "入力の種類はスパンIDの下位2ビットに収まる必要があります");
+
+    /// @brief イベントの種類 (Chrome トレースイベントの ph)
+    enum Phase : char
+    {
+        PHASE_ASYNC_BEGIN = 'b', ///< スパンの開始
+        PHASE_ASYNC_END = 'e',   ///< スパンの終了
+        PHASE_COMPLETE = 'X'     ///< 所要時間付きの区間
+    };
+
+    /// @brief 書き出し用に読み出したイベント
+    struct EventData
+    {
+        std::uint64_t nTimestampNs;
+        std::uint64_t nDurationNs;
+        std::uint64_t nSpan;
+        const char *pszName;
+        const char *pszDetail;
+        char chPhase;
+        int nThread;
+    };
+
+    /**
+     * @brief リングバッファの1要素
+     * @details nSeq は書き込み中に0、書き込み完了後に通し番号+1となり、
+     * 読み出し側は読み出しの前後で nSeq が変化していないことで上書き中の要素を読み飛ばします (シーケンスロック)。
+     */
+    struct EventSlot
+    {
+        std::atomic<std::uint64_t> nSeq{0};
+        std::atomic<std::uint64_t> nTimestampNs{0};
+        std::atomic<std::uint64_t> nDurationNs{0};
+        std::atomic<std::uint64_t> nSpan{0};
+        std::atomic<const char *> pszName{nullptr};
+        std::atomic<const char *> pszDetail{nullptr};
+        std::atomic<char> chPhase{0};
+    };
+
+    /// @brief 1スレッド分のリングバッファ (書き込みはそのスレッドのみ)
+    struct ThreadRing
+    {
+        int nThread = 0;                          ///< トレース上のスレッド番号 (登録順、1始まり)
+        std::atomic<const char *> pszName{nullptr}; ///< スレッドの表示名
+        std::atomic<std::uint64_t> nHead{0};      ///< これまでに書き込んだイベント数
+        EventSlot slots[CInputTrace::RING_CAPACITY];
+
+        void Push(char chPhase, const char *pszName, const char *pszDetail,
+                  std::uint64_t nTimestampNs, std::uint64_t nDurationNs, std::uint64_t nSpan)
+        {
+            const std::uint64_t n = nHead.load(std::memory_order_relaxed);
+            EventSlot &slot = slots[n & (CInputTrace::RING_CAPACITY - 1)];
+            slot.nSeq.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.nTimestampNs.store(nTimestampNs, std::memory_order_relaxed);
+            slot.nDurationNs.store(nDurationNs, std::memory_order_relaxed);
+            slot.nSpan.store(nSpan, std::memory_order_relaxed);
+            slot.pszName.store(pszName, std::memory_order_relaxed);
+            slot.pszDetail.store(pszDetail, std::memory_order_relaxed);
+            slot.chPhase.store(chPhase, std::memory_order_relaxed);
+            slot.nSeq.store(n + 1, std::memory_order_release);
+            nHead.store(n + 1, std::memory_order_release);
+        }
+
+        /// @brief 残っているイベントを読み出します (上書き中のものは除きます)。
+        void Collect(std::vector<EventData> &events) const
+        {
+            const std::uint64_t nEnd = nHead.load(std::memory_order_acquire);
+            const std::uint64_t nBegin = (nEnd > CInputTrace::RING_CAPACITY) ? nEnd - CInputTrace::RING_CAPACITY : 0;
+            for (std::uint64_t n = nBegin; n < nEnd; ++n)
+            {
+                const EventSlot &slot = slots[n & (CInputTrace::RING_CAPACITY - 1)];
+                if (slot.nSeq.load(std::memory_order_acquire) != n + 1)
+                    continue;
+                EventData e;
+                e.nTimestampNs = slot.nTimestampNs.load(std::memory_order_relaxed);
+                e.nDurationNs = slot.nDurationNs.load(std::memory_order_relaxed);
+                e.nSpan = slot.nSpan.load(std::memory_order_relaxed);
+                e.pszName = slot.pszName.load(std::memory_order_relaxed);
+                e.pszDetail = slot.pszDetail.load(std::memory_order_relaxed);
+                e.chPhase = slot.chPhase.load(std::memory_order_relaxed);
+                e.nThread = nThread;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.nSeq.load(std::memory_order_relaxed) != n + 1)
+                    continue;
+                events.push_back(e);
+            }
+        }
+    };
+
+    /// @brief 全スレッドのリングバッファの一覧 (スレッド終了後もイベントを保持するため解放しません)
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+    };
+
+    Registry &GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    /// @brief 呼び出し元スレッドのリングバッファを返します (初回のみ登録のためにロックを取ります)。
+    ThreadRing &GetThreadRing()
+    {
+        thread_local ThreadRing *pRing = nullptr;
+        if (pRing == nullptr)
+        {
+            Registry &registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.rings.push_back(std::unique_ptr<ThreadRing>(new ThreadRing()));
+            pRing = registry.rings.back().get();
+            pRing->nThread = static_cast<int>(registry.rings.size());
+        }
+        return *pRing;
+    }
+
+    const char *const INPUT_NAMES[CInputTrace::INPUT_KIND_COUNT] = {
+        "input.click",
+        "input.key",
+        "input.touch",
+    };
+
+    /// @brief スパンの値から入力の種類の表示名を返します。
+    const char *SpanName(std::uint64_t nSpan)
+    {
+        return CInputTrace::GetInputName(static_cast<CInputTrace::InputKind>(nSpan & 3));
+    }
+
+    /// @brief 文字列を JSON の文字列リテラルとして追記します。
+    void AppendJsonString(std::string &out, const char *psz)
+    {
+        out += '"';
+        for (const char *p = (psz != nullptr) ? psz : ""; *p != '\0'; ++p)
+        {
+            const unsigned char ch = static_cast<unsigned char>(*p);
+            if (ch == '"' || ch == '\\')
+            {
+                out += '\\';
+                out += static_cast<char>(ch);
+            }
+            else if (ch < 0x20)
+            {
+                char szEscape[8];
+                std::snprintf(szEscape, sizeof(szEscape), "\\u%04x", ch);
+                out += szEscape;
+            }
+            else
+            {
+                out += static_cast<char>(ch);
+            }
+        }
+        out += '"';
+    }
+
+    /// @brief ナノ秒をマイクロ秒 (小数点以下3桁) として追記します。
+    void AppendMicros(std::string &out, std::uint64_t nNs)
+    {
+        char szValue[32];
+        std::snprintf(szValue, sizeof(szValue), "%llu.%03u",
+                      static_cast<unsigned long long>(nNs / 1000), static_cast<unsigned int>(nNs % 1000));
+        out += szValue;
+    }
+}
+
+/**
+ * @brief 単調増加する現在時刻 (ナノ秒) を返します。
+ */
+std::uint64_t CInputTrace::NowNs()
+{
+    using namespace std::chrono;
+    return static_cast<std::uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief 入力の種類の表示名を返します。
+ */
+const char *CInputTrace::GetInputName(InputKind kind)
+{
+    if (kind < 0 || kind >= INPUT_KIND_COUNT)
+        return "input";
+    return INPUT_NAMES[kind];
+}
+
+/**
+ * @brief トレースの有効/無効を切り替えます。
+ */
+void CInputTrace::SetEnabled(bool bEnabled)
+{
+    s_bEnabled.store(bEnabled, std::memory_order_relaxed);
+    if (!bEnabled)
+        s_nCurrent.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 入力を受け付けた時点で新しいスパンを開始します。
+ */
+std::uint64_t CInputTrace::BeginInput(InputKind kind)
+{
+    if (!IsEnabled() || kind < 0 || kind >= INPUT_KIND_COUNT)
+        return 0;
+
+    const std::uint64_t nSpan = (s_nNextId.fetch_add(1, std::memory_order_relaxed) << 2) | static_cast<std::uint64_t>(kind);
+    const std::uint64_t nNow = NowNs();
+    ThreadRing &ring = GetThreadRing();
+
+    // 描画まで到達しなかった前のスパンは、次の入力の時点で閉じる
+    const std::uint64_t nPrevious = s_nCurrent.exchange(nSpan, std::memory_order_relaxed);
+    if (nPrevious != 0)
+        ring.Push(PHASE_ASYNC_END, SpanName(nPrevious), "superseded", nNow, 0, nPrevious);
+    ring.Push(PHASE_ASYNC_BEGIN, SpanName(nSpan), nullptr, nNow, 0, nSpan);
+    return nSpan;
+}
+
+/**
+ * @brief 実行中のスパンIDを返します。
+ */
+std::uint64_t CInputTrace::GetCurrentSpan()
+{
+    return s_nCurrent.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief 実行中のスパンを描画の完了として閉じます。
+ */
+void CInputTrace::EndSpanAtPaint(const char *pszPaintName)
+{
+    if (!IsEnabled())
+        return;
+    const std::uint64_t nSpan = s_nCurrent.exchange(0, std::memory_order_relaxed);
+    if (nSpan == 0)
+        return;
+    GetThreadRing().Push(PHASE_ASYNC_END, SpanName(nSpan), pszPaintName, NowNs(), 0, nSpan);
+}
+
+/**
+ * @brief 開始時刻と所要時間を持つ処理の区間を記録します。
+ */
+void CInputTrace::RecordComplete(const char *pszName, std::uint64_t nStartNs, std::uint64_t nDurationNs, std::uint64_t nSpanId)
+{
+    if (!IsEnabled())
+        return;
+    GetThreadRing().Push(PHASE_COMPLETE, pszName, nullptr, nStartNs, nDurationNs, nSpanId);
+}
+
+/**
+ * @brief 呼び出し元スレッドの表示名を設定します。
+ */
+void CInputTrace::SetThreadName(const char *pszName)
+{
+    GetThreadRing().pszName.store(pszName, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 記録済みのイベントをすべて破棄します。
+ * @details 書き込み側と競合しないよう、各リングの読み出し開始位置を進めるのではなく、
+ * 全要素の通し番号を無効値にして読み出し対象から外します。
+ */
+void CInputTrace::Clear()
+{
+    s_nCurrent.store(0, std::memory_order_relaxed);
+    Registry &registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<ThreadRing> &pRing : registry.rings)
+    {
+        for (EventSlot &slot : pRing->slots)
+            slot.nSeq.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 全スレッドのイベントを Chrome トレースイベント形式で返します。
+ * @details スパンは非同期イベント (ph "b"/"e"、カテゴリ "input"、id はスパンID) として、
+ * スパン内の処理は所要時間付きイベント (ph "X"、args.span にスパンID) として出力します。
+ * 描画でスパンが閉じられた場合は、終了イベントの args.end にその描画処理の名前が入ります。
+ */
+std::string CInputTrace::ToChromeJson()
+{
+    std::vector<EventData> events;
+    std::vector<std::pair<int, const char *>> threadNames;
+    {
+        Registry &registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const std::unique_ptr<ThreadRing> &pRing : registry.rings)
+        {
+            pRing->Collect(events);
+            threadNames.emplace_back(pRing->nThread, pRing->pszName.load(std::memory_order_relaxed));
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const EventData &a, const EventData &b) { return a.nTimestampNs < b.nTimestampNs; });
+    const std::uint64_t nOrigin = events.empty() ? 0 : events.front().nTimestampNs;
+
+    std::string out;
+    out.reserve(64 + events.size() * 128);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool bFirst = true;
+    for (const std::pair<int, const char *> &thread : threadNames)
+    {
+        if (thread.second == nullptr)
+            continue;
+        out += bFirst ? "\n" : ",\n";
+        bFirst = false;
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+        out += std::to_string(thread.first);
+        out += ",\"args\":{\"name\":";
+        AppendJsonString(out, thread.second);
+        out += "}}";
+    }
+    for (const EventData &e : events)
+    {
+        out += bFirst ? "\n" : ",\n";
+        bFirst = false;
+        out += "{\"name\":";
+        AppendJsonString(out, e.pszName);
+        out += (e.chPhase == PHASE_COMPLETE) ? ",\"cat\":\"dispatch\",\"ph\":\"" : ",\"cat\":\"input\",\"ph\":\"";
+        out += e.chPhase;
+        out += "\",\"pid\":1,\"tid\":";
+        out += std::to_string(e.nThread);
+        out += ",\"ts\":";
+        AppendMicros(out, e.nTimestampNs - nOrigin);
+        if (e.chPhase == PHASE_COMPLETE)
+        {
+            out += ",\"dur\":";
+            AppendMicros(out, e.nDurationNs);
+            out += ",\"args\":{\"span\":";
+            out += std::to_string(e.nSpan >> 2);
+            out += "}}";
+        }
+        else
+        {
+            out += ",\"id\":";
+            out += std::to_string(e.nSpan >> 2);
+            if (e.pszDetail != nullptr)
+            {
+                out += ",\"args\":{\"end\":";
+                AppendJsonString(out, e.pszDetail);
+                out += "}";
+            }
+            out += "}";
+        }
+    }
+    out += "\n]}\n";
+    return out;
+}
@@ -0,0 +1,137 @@
+﻿/**
+ * @file InputTrace.h
+ * @brief 入力から描画完了までの遅延を追跡するトレース機構のクラス宣言
+ * @details アプリケーションのメッセージフィルタで入力 (クリック・キー・タッチ) ごとにスパンIDを発行し、
+ * その後のディスパッチ処理 (グリッドの選択変更、WM_GRID_* 通知、機能実行、ソフトウェアキーボードのキー処理) を
+ * 同じスパンに属するイベントとして記録し、最初の描画でスパンを閉じます。
+ * イベントはスレッドごとのリングバッファにロックなしで記録し、Chrome のトレースイベント形式 (JSON) で書き出します。
+ * 書き出したファイルは chrome://tracing や Perfetto で表示できます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class CInputTrace
+ * @brief 入力遅延トレースのプロセス全体のレジストリ (静的メンバのみ)
+ * @details 実行中のスパンは1個だけで、新しい入力が来ると前のスパンは描画を待たずに閉じられます。
+ * UIスレッドのメッセージ処理は逐次的なため、スパンIDをメッセージに埋め込まなくても、
+ * 入力の後に続く処理と描画を同じスパンに関連付けられます。
+ */
+class CInputTrace
+{
+public:
+    /// @brief 入力の種類
+    enum InputKind
+    {
+        INPUT_CLICK, ///< マウスボタンの押下
+        INPUT_KEY,   ///< キーの押下
+        INPUT_TOUCH, ///< タッチ (ペンを含む)
+        INPUT_KIND_COUNT
+    };
+
+    /// @brief スレッドごとのリングバッファに保持するイベント数 (2のべき乗。古いものから上書きされます)
+    static constexpr int RING_CAPACITY = 4096;
+
+    /// @brief トレースが有効かを返します。
+    static bool IsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+    /// @brief トレースの有効/無効を切り替えます。無効にすると実行中のスパンは破棄されます。
+    static void SetEnabled(bool bEnabled);
+
+    /**
+     * @brief 入力を受け付けた時点で新しいスパンを開始します。
+     * @details 前のスパンが描画で閉じられていなければ、この時点で閉じます。
+     * @param[in] kind 入力の種類
+     * @return 発行したスパンID (無効時は0)
+     */
+    static std::uint64_t BeginInput(InputKind kind);
+
+    /// @brief 実行中のスパンID (なければ0) を返します。
+    static std::uint64_t GetCurrentSpan();
+
+    /**
+     * @brief 実行中のスパンを描画の完了として閉じます。スパンがなければ何もしません。
+     * @param[in] pszPaintName スパンを閉じた描画処理の名前 (静的な文字列)
+     */
+    static void EndSpanAtPaint(const char *pszPaintName);
+
+    /**
+     * @brief 開始時刻と所要時間を持つ処理の区間を記録します。
+     * @param[in] pszName 処理の名前 (静的な文字列)
+     * @param[in] nStartNs 開始時刻 (NowNs() の値)
+     * @param[in] nDurationNs 所要時間
+     * @param[in] nSpanId 関連付けるスパンID
+     */
+    static void RecordComplete(const char *pszName, std::uint64_t nStartNs, std::uint64_t nDurationNs, std::uint64_t nSpanId);
+
+    /// @brief 呼び出し元スレッドの表示名を設定します (静的な文字列)。
+    static void SetThreadName(const char *pszName);
+
+    /**
+     * @brief 全スレッドのリングバッファに残っているイベントを Chrome トレースイベント形式で返します。
+     * @details 時刻は最も古いイベントを0とするマイクロ秒です。書き込み中だったイベントは読み飛ばします。
+     */
+    static std::string ToChromeJson();
+
+    /// @brief 記録済みのイベントをすべて破棄します。
+    static void Clear();
+
+    /// @brief 単調増加する現在時刻 (ナノ秒) を返します。
+    static std::uint64_t NowNs();
+
+    /// @brief 入力の種類の表示名を返します。
+    static const char *GetInputName(InputKind kind);
+
+private:
+    static std::atomic<bool> s_bEnabled;          ///< トレースの有効フラグ
+    static std::atomic<std::uint64_t> s_nCurrent; ///< 実行中のスパン (下位2ビットが入力の種類、0はスパンなし)
+    static std::atomic<std::uint64_t> s_nNextId;  ///< 次に発行するスパンの通し番号
+};
+
+/**
+ * @class CInputTraceScope
+ * @brief スコープの開始から終了までを、実行中のスパンに属する処理の区間として記録するRAIIヘルパー
+ * @details 構築時にスパンが実行中でなければ何も記録しません。
+ * 描画処理で bEndsSpan を true にすると、描画の完了時にスパンを閉じます。
+ */
+class CInputTraceScope
+{
+public:
+    /**
+     * @brief 区間の計測を開始します。
+     * @param[in] pszName 処理の名前 (静的な文字列)
+     * @param[in] bEndsSpan 終了時にスパンを閉じる (描画処理) 場合はtrue
+     */
+    explicit CInputTraceScope(const char *pszName, bool bEndsSpan = false)
+        : m_pszName(pszName), m_bEndsSpan(bEndsSpan), m_nSpanId(0), m_nStartNs(0)
+    {
+        if (CInputTrace::IsEnabled())
+        {
+            m_nSpanId = CInputTrace::GetCurrentSpan();
+            if (m_nSpanId != 0)
+                m_nStartNs = CInputTrace::NowNs();
+        }
+    }
+
+    /// @brief 区間を記録し、必要であればスパンを閉じます。
+    ~CInputTraceScope()
+    {
+        if (m_nSpanId == 0)
+            return;
+        CInputTrace::RecordComplete(m_pszName, m_nStartNs, CInputTrace::NowNs() - m_nStartNs, m_nSpanId);
+        if (m_bEndsSpan)
+            CInputTrace::EndSpanAtPaint(m_pszName);
+    }
+
+    CInputTraceScope(const CInputTraceScope &) = delete;
+    CInputTraceScope &operator=(const CInputTraceScope &) = delete;
+
+private:
+    const char *m_pszName;   ///< 処理の名前
+    bool m_bEndsSpan;        ///< 終了時にスパンを閉じるか
+    std::uint64_t m_nSpanId; ///< 構築時に実行中だったスパン (0なら記録しない)
+    std::uint64_t m_nStartNs; ///< 開始時刻
+};
@@ -0,0 +1,52 @@
+﻿/**
+ * @file KeyRepeat.cpp
+ * @brief 長押しによるキーリピートの時刻計算の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "KeyRepeat.h"
+
+#include <algorithm>
+
+/**
+ * @brief CKeyRepeatクラスのコンストラクタ
+ */
+CKeyRepeat::CKeyRepeat() : m_bActive(false), m_dNextDueMs(0.0), m_dIntervalMs(0.0), m_nRepeatCount(0)
+{
+}
+
+/**
+ * @brief キーが押されたことを記録し、リピートを開始します。
+ */
+void CKeyRepeat::Press(double dTimeMs)
+{
+    m_bActive = true;
+    m_nRepeatCount = 0;
+    m_dIntervalMs = (std::max)((std::max)(1.0, m_params.dMinIntervalMs), m_params.dIntervalMs);
+    m_dNextDueMs = dTimeMs + m_params.dDelayMs;
+}
+
+/**
+ * @brief 時刻を進め、期限を迎えたリピートの回数を返します。
+ */
+int CKeyRepeat::Advance(double dTimeMs)
+{
+    if (!m_bActive)
+        return 0;
+
+    const double dMinInterval = (std::max)(1.0, m_params.dMinIntervalMs);
+    int nCount = 0;
+    while (m_dNextDueMs <= dTimeMs)
+    {
+        if (nCount >= m_params.nMaxCatchUp)
+        {
+            // 大きく遅れた分はまとめて入力せず、現在時刻から数え直します。
+            m_dNextDueMs = dTimeMs + m_dIntervalMs;
+            break;
+        }
+        ++nCount;
+        ++m_nRepeatCount;
+        m_dNextDueMs += m_dIntervalMs;
+        m_dIntervalMs = (std::max)(dMinInterval, m_dIntervalMs * m_params.dAcceleration);
+    }
+    return nCount;
+}
@@ -0,0 +1,81 @@
+﻿/**
+ * @file KeyRepeat.h
+ * @brief ソフトウェアキーボードの長押しによるキーリピートの時刻計算のクラス宣言
+ * @details キーを押し続けると、最初の遅延の後に一定の間隔でキー入力を繰り返し、
+ * 繰り返すごとに間隔を短くして (加速して) 最短間隔まで速めます。
+ * 時刻は呼び出し側が与えるため、同じ入力列に対して常に同じ結果を返します (決定的)。
+ * ウィンドウ側はフレームタイマーの周期で Advance() を呼び出し、その間に期限を迎えた回数だけ入力を繰り返します。
+ * タイマーが遅れても期限どおりの回数を返すため、リピートの速さはタイマーの揺らぎに左右されません。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+/**
+ * @class CKeyRepeat
+ * @brief 1つのキーの長押しリピートの期限を計算するクラス
+ */
+class CKeyRepeat
+{
+public:
+    /**
+     * @struct Params
+     * @brief リピートの調整パラメータ (時間はミリ秒)
+     */
+    struct Params
+    {
+        double dDelayMs;       ///< 押してから最初のリピートまでの遅延
+        double dIntervalMs;    ///< 最初のリピートの間隔
+        double dMinIntervalMs; ///< 加速後の最短間隔
+        double dAcceleration;  ///< 1回繰り返すごとに間隔に掛ける係数 (0より大きく1以下)
+        int nMaxCatchUp;       ///< 1回の Advance() で返す最大の回数 (これを超えた遅れは切り捨てます)
+
+        Params() : dDelayMs(400.0), dIntervalMs(100.0), dMinIntervalMs(25.0), dAcceleration(0.85), nMaxCatchUp(8)
+        {
+        }
+    };
+
+    /// @brief フレームタイマーの推奨周期 (ミリ秒、約60fps)
+    static constexpr int FRAME_INTERVAL_MS = 16;
+
+    CKeyRepeat();
+
+    /// @brief パラメータを設定します。
+    void SetParams(const Params &params) { m_params = params; }
+    /// @brief 現在のパラメータを取得します。
+    const Params &GetParams() const { return m_params; }
+
+    /**
+     * @brief キーが押されたことを記録し、リピートを開始します。
+     * @details 押した時点の入力は呼び出し側で行ってください。リピートは dDelayMs 後から始まります。
+     * @param[in] dTimeMs 押した時刻
+     */
+    void Press(double dTimeMs);
+
+    /// @brief キーが離されたことを記録し、リピートを止めます。
+    void Release() { m_bActive = false; }
+
+    /// @brief リピート中 (押されたまま) かを返します。
+    bool IsActive() const { return m_bActive; }
+
+    /// @brief 押してから繰り返した回数を返します。
+    int GetRepeatCount() const { return m_nRepeatCount; }
+
+    /// @brief 次のリピートの期限 (時刻) を返します。
+    double GetNextDueMs() const { return m_dNextDueMs; }
+
+    /**
+     * @brief 時刻を進め、期限を迎えたリピートの回数を返します。
+     * @details 期限を迎えるごとに、それ以降の間隔を dAcceleration 倍に (dMinIntervalMs まで) 縮めます。
+     * 遅れが nMaxCatchUp 回分を超えた場合は、残りを切り捨てて次の期限を dTimeMs から数え直します。
+     * @param[in] dTimeMs 現在時刻
+     * @return 繰り返す回数 (リピート中でなければ0)
+     */
+    int Advance(double dTimeMs);
+
+private:
+    Params m_params;      ///< パラメータ
+    bool m_bActive;       ///< リピート中か
+    double m_dNextDueMs;  ///< 次のリピートの期限
+    double m_dIntervalMs; ///< 次のリピートの次までの間隔
+    int m_nRepeatCount;   ///< 押してから繰り返した回数
+};
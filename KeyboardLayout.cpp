@@ -0,0 +1,535 @@
+﻿/**
+ * @file KeyboardLayout.cpp
+ * @brief ソフトウェアキーボードのレイアウトの定義とコンパイル時の計算
+ * @details 各レイアウトは行順のキー定義と行ごとのキーの数で記述し、キーID・矩形・当たり判定の升目・
+ * 仮想キーコードの逆引き表はコンパイル時に求めます。行の長さやスパンの不整合はコンパイルエラーになります。
+ * プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "KeyboardLayout.h"
+
+#include <array>
+#include <cstddef>
+
+namespace
+{
+/**
+ * @struct KEY_DEF
+ * @brief レイアウトの記述に使う1つのキーの定義
+ * @details キーIDと行は並び順から決まるため、記述には含めません。
+ */
+struct KEY_DEF
+{
+    const wchar_t *pszLabel;      ///< 通常時のラベル
+    const wchar_t *pszShiftLabel; ///< Shift時のラベル (なければ空文字列)
+    unsigned char bVirtKey;       ///< 仮想キーコード (なければ0)
+    EKeyType eKeyType;            ///< キーの種類
+    int nSpan;                    ///< 横幅 (標準キー何個分か)
+};
+
+/// @brief キーの定義から修飾キーのビットを求めます (仮想キーコードを持たない修飾キーは Fn とします)。
+constexpr unsigned ModifierOf(const KEY_DEF &def)
+{
+    if (def.eKeyType != KT_MODIFIER)
+        return 0;
+    switch (def.bVirtKey)
+    {
+    case VK_CAPITAL:  return KEY_MOD_CAPS;
+    case VK_LSHIFT:
+    case VK_RSHIFT:   return KEY_MOD_SHIFT;
+    case VK_LCONTROL:
+    case VK_RCONTROL: return KEY_MOD_CTRL;
+    case VK_LMENU:
+    case VK_RMENU:    return KEY_MOD_ALT;
+    case 0:           return KEY_MOD_FN;
+    default:          return 0;
+    }
+}
+
+/// @brief 全てのキーのスパンが1以上かを返します。
+template <std::size_t N>
+constexpr bool SpansArePositive(const KEY_DEF (&defs)[N])
+{
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        if (defs[i].nSpan < 1)
+            return false;
+    }
+    return true;
+}
+
+/// @brief 行ごとのキーの数の合計を返します。
+template <std::size_t R>
+constexpr int SumOfRows(const int (&rows)[R])
+{
+    int nSum = 0;
+    for (std::size_t r = 0; r < R; ++r)
+        nSum += rows[r];
+    return nSum;
+}
+
+/// @brief 行ごとのスパンの合計の最大値 (最も長い行の標準キーの数) を返します。
+template <std::size_t N, std::size_t R>
+constexpr int WidestRow(const KEY_DEF (&defs)[N], const int (&rows)[R])
+{
+    int nWidest = 0;
+    std::size_t k = 0;
+    for (std::size_t r = 0; r < R; ++r)
+    {
+        int nSpan = 0;
+        for (int j = 0; j < rows[r] && k < N; ++j, ++k)
+            nSpan += defs[k].nSpan;
+        nWidest = nSpan > nWidest ? nSpan : nWidest;
+    }
+    return nWidest;
+}
+
+/// @brief 0以外の仮想キーコードが重複していないかを返します。
+template <std::size_t N>
+constexpr bool VirtKeysAreUnique(const KEY_DEF (&defs)[N])
+{
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        for (std::size_t j = i + 1; j < N; ++j)
+        {
+            if (defs[i].bVirtKey != 0 && defs[i].bVirtKey == defs[j].bVirtKey)
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @struct KEYBOARD_LAYOUT_DATA
+ * @brief コンパイル済みのレイアウトの表
+ */
+template <std::size_t N>
+struct KEYBOARD_LAYOUT_DATA
+{
+    std::array<KEY_INFO, N> infos;                                             ///< キー情報
+    std::array<KEYBOARD_KEY, N> keys;                                          ///< 表示用の情報
+    std::array<KEYBOARD_RECT, N> rects;                                        ///< キーの矩形
+    std::array<signed char, KEYBOARD_MAX_ROWS * KEYBOARD_MAX_COLUMNS> hitGrid; ///< 当たり判定の升目
+    std::array<signed char, 256> virtKeys;                                     ///< 仮想キーコードの逆引き表
+    int nRows;                                                                 ///< 行数
+    int nColumns;                                                              ///< 最も長い行の標準キーの数
+    int nWidth;                                                                ///< 描画面全体の幅
+    int nHeight;                                                               ///< 描画面全体の高さ
+};
+
+/**
+ * @brief レイアウトの記述から表を作ります。
+ * @details 行ごとにスパンを累積して各キーの矩形を求めます。描画面の幅は最も長い行に合わせ、
+ * 高さはタイトルバーと行数から求めます。当たり判定の升目は (キー幅 + 隙間) × (キー高さ + 隙間) ごとに、
+ * その升目を覆うキーの番号を保持します。
+ */
+template <std::size_t N, std::size_t R>
+constexpr KEYBOARD_LAYOUT_DATA<N> CompileLayout(const KEY_DEF (&defs)[N], const int (&rows)[R])
+{
+    KEYBOARD_LAYOUT_DATA<N> data{};
+    for (auto &cell : data.hitGrid)
+        cell = -1;
+    for (auto &entry : data.virtKeys)
+        entry = -1;
+
+    std::size_t k = 0;
+    for (std::size_t r = 0; r < R; ++r)
+    {
+        const int nRow = static_cast<int>(r);
+        int nColumn = 0;
+        for (int j = 0; j < rows[r]; ++j, ++k)
+        {
+            const KEY_DEF &def = defs[k];
+            const int nIndex = static_cast<int>(k);
+
+            data.infos[k] = KEY_INFO{IDC_KEY_BASE + static_cast<unsigned int>(k), def.pszLabel, def.pszShiftLabel,
+                                     def.bVirtKey, def.eKeyType, def.nSpan};
+            data.keys[k] = KEYBOARD_KEY{def.pszLabel, def.pszShiftLabel, nRow, def.nSpan,
+                                        def.eKeyType == KT_NORMAL && def.bVirtKey >= 'A' && def.bVirtKey <= 'Z',
+                                        ModifierOf(def)};
+
+            KEYBOARD_RECT &rect = data.rects[k];
+            rect.left = nColumn * (KEYBOARD_KEY_WIDTH + KEYBOARD_KEY_GAP);
+            rect.top = KEYBOARD_TITLE_BAR_HEIGHT + KEYBOARD_KEY_GAP + nRow * (KEYBOARD_KEY_HEIGHT + KEYBOARD_KEY_GAP);
+            rect.right = rect.left + def.nSpan * KEYBOARD_KEY_WIDTH + (def.nSpan - 1) * KEYBOARD_KEY_GAP;
+            rect.bottom = rect.top + KEYBOARD_KEY_HEIGHT;
+
+            for (int c = nColumn; c < nColumn + def.nSpan; ++c)
+                data.hitGrid[nRow * KEYBOARD_MAX_COLUMNS + c] = static_cast<signed char>(nIndex);
+            if (def.bVirtKey != 0)
+                data.virtKeys[def.bVirtKey] = static_cast<signed char>(nIndex);
+            nColumn += def.nSpan;
+        }
+        data.nColumns = nColumn > data.nColumns ? nColumn : data.nColumns;
+    }
+
+    data.nRows = static_cast<int>(R);
+    data.nWidth = data.nColumns > 0 ? KEYBOARD_KEY_WIDTH * data.nColumns + KEYBOARD_KEY_GAP * (data.nColumns - 1) : 0;
+    data.nHeight = KEYBOARD_TITLE_BAR_HEIGHT + (KEYBOARD_KEY_HEIGHT + KEYBOARD_KEY_GAP) * data.nRows;
+    return data;
+}
+
+/// @brief キーの矩形が描画面に収まり、互いに重ならないかを返します。
+template <std::size_t N>
+constexpr bool RectsDoNotOverlap(const KEYBOARD_LAYOUT_DATA<N> &data)
+{
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        const KEYBOARD_RECT &a = data.rects[i];
+        if (a.left < 0 || a.top < KEYBOARD_TITLE_BAR_HEIGHT || a.right > data.nWidth || a.bottom > data.nHeight ||
+            a.left >= a.right || a.top >= a.bottom)
+            return false;
+        for (std::size_t j = i + 1; j < N; ++j)
+        {
+            const KEYBOARD_RECT &b = data.rects[j];
+            if (a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom)
+                return false;
+        }
+    }
+    return true;
+}
+
+/// @brief キーID・当たり判定の升目・仮想キーコードの逆引きが、どのキーについてもそのキーを指すかを返します。
+template <std::size_t N>
+constexpr bool LookupsFindEveryKey(const KEYBOARD_LAYOUT_DATA<N> &data)
+{
+    for (std::size_t k = 0; k < N; ++k)
+    {
+        const int nIndex = static_cast<int>(k);
+        if (data.infos[k].uId != IDC_KEY_BASE + static_cast<unsigned int>(k))
+            return false;
+        if (data.infos[k].bVirtKey != 0 && data.virtKeys[data.infos[k].bVirtKey] != nIndex)
+            return false;
+        const KEYBOARD_RECT &rect = data.rects[k];
+        const int nRow = (rect.top - KEYBOARD_TITLE_BAR_HEIGHT - KEYBOARD_KEY_GAP) / (KEYBOARD_KEY_HEIGHT + KEYBOARD_KEY_GAP);
+        for (int x = rect.left; x < rect.right; x += KEYBOARD_KEY_WIDTH + KEYBOARD_KEY_GAP)
+        {
+            if (data.hitGrid[nRow * KEYBOARD_MAX_COLUMNS + x / (KEYBOARD_KEY_WIDTH + KEYBOARD_KEY_GAP)] != nIndex)
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @class CCompiledKeyboardLayout
+ * @brief レイアウトの記述を検査し、コンパイル時に表を作るクラス
+ * @tparam Defs 行順のキー定義の配列
+ * @tparam Rows 行ごとのキーの数の配列
+ */
+template <const auto &Defs, const auto &Rows>
+class CCompiledKeyboardLayout
+{
+    static constexpr std::size_t KEY_COUNT = sizeof(Defs) / sizeof(Defs[0]);
+    static constexpr std::size_t ROW_COUNT = sizeof(Rows) / sizeof(Rows[0]);
+
+    static_assert(KEY_COUNT <= static_cast<std::size_t>(KEYBOARD_MAX_KEYS), "キーの数が KEYBOARD_MAX_KEYS を超えています");
+    static_assert(ROW_COUNT <= static_cast<std::size_t>(KEYBOARD_MAX_ROWS), "行数が KEYBOARD_MAX_ROWS を超えています");
+    static_assert(SumOfRows(Rows) == static_cast<int>(KEY_COUNT), "行ごとのキーの数の合計がキー定義の数と一致しません");
+    static_assert(SpansArePositive(Defs), "スパンが1未満のキーがあります");
+    static_assert(WidestRow(Defs, Rows) <= KEYBOARD_MAX_COLUMNS, "行のスパンの合計が KEYBOARD_MAX_COLUMNS を超えています");
+    static_assert(VirtKeysAreUnique(Defs), "仮想キーコードが重複しています");
+
+public:
+    /// @brief コンパイル済みの表
+    static constexpr KEYBOARD_LAYOUT_DATA<KEY_COUNT> DATA = CompileLayout(Defs, Rows);
+
+    static_assert(RectsDoNotOverlap(DATA), "キーの矩形が重なっているか、描画面からはみ出しています");
+    static_assert(LookupsFindEveryKey(DATA), "キーID・当たり判定・仮想キーコードの表がキーを正しく指していません");
+
+    /// @brief 表を指すレイアウトを作ります。
+    static constexpr KEYBOARD_LAYOUT View(const wchar_t *pszName)
+    {
+        return KEYBOARD_LAYOUT{pszName,
+                               static_cast<int>(KEY_COUNT),
+                               DATA.nRows,
+                               DATA.nColumns,
+                               DATA.nWidth,
+                               DATA.nHeight,
+                               DATA.infos.data(),
+                               DATA.keys.data(),
+                               DATA.rects.data(),
+                               DATA.hitGrid.data(),
+                               DATA.virtKeys.data()};
+    }
+};
+
+// --- US配列 ---
+constexpr KEY_DEF s_usKeys[] = {
+    // Row 1
+    {L"Esc", L"", VK_ESCAPE, KT_ACTION, 1},
+    {L"`", L"~", VK_OEM_3, KT_NORMAL, 1},
+    {L"1", L"!", '1', KT_NORMAL, 1},
+    {L"2", L"@", '2', KT_NORMAL, 1},
+    {L"3", L"#", '3', KT_NORMAL, 1},
+    {L"4", L"$", '4', KT_NORMAL, 1},
+    {L"5", L"%", '5', KT_NORMAL, 1},
+    {L"6", L"^", '6', KT_NORMAL, 1},
+    {L"7", L"&", '7', KT_NORMAL, 1},
+    {L"8", L"*", '8', KT_NORMAL, 1},
+    {L"9", L"(", '9', KT_NORMAL, 1},
+    {L"0", L")", '0', KT_NORMAL, 1},
+    {L"-", L"_", VK_OEM_MINUS, KT_NORMAL, 1},
+    {L"=", L"+", VK_OEM_PLUS, KT_NORMAL, 1},
+    {L"Del", L"", VK_DELETE, KT_ACTION, 1},
+    // Row 2
+    {L"Tab", L"", VK_TAB, KT_ACTION, 1},
+    {L"q", L"Q", 'Q', KT_NORMAL, 1},
+    {L"w", L"W", 'W', KT_NORMAL, 1},
+    {L"e", L"E", 'E', KT_NORMAL, 1},
+    {L"r", L"R", 'R', KT_NORMAL, 1},
+    {L"t", L"T", 'T', KT_NORMAL, 1},
+    {L"y", L"Y", 'Y', KT_NORMAL, 1},
+    {L"u", L"U", 'U', KT_NORMAL, 1},
+    {L"i", L"I", 'I', KT_NORMAL, 1},
+    {L"o", L"O", 'O', KT_NORMAL, 1},
+    {L"p", L"P", 'P', KT_NORMAL, 1},
+    {L"[", L"{", VK_OEM_4, KT_NORMAL, 1},
+    {L"]", L"}", VK_OEM_6, KT_NORMAL, 1},
+    {L"\\", L"|", VK_OEM_5, KT_NORMAL, 1},
+    {L"BS", L"", VK_BACK, KT_ACTION, 1},
+    // Row 3
+    {L"Caps", L"", VK_CAPITAL, KT_MODIFIER, 2},
+    {L"a", L"A", 'A', KT_NORMAL, 1},
+    {L"s", L"S", 'S', KT_NORMAL, 1},
+    {L"d", L"D", 'D', KT_NORMAL, 1},
+    {L"f", L"F", 'F', KT_NORMAL, 1},
+    {L"g", L"G", 'G', KT_NORMAL, 1},
+    {L"h", L"H", 'H', KT_NORMAL, 1},
+    {L"j", L"J", 'J', KT_NORMAL, 1},
+    {L"k", L"K", 'K', KT_NORMAL, 1},
+    {L"l", L"L", 'L', KT_NORMAL, 1},
+    {L";", L":", VK_OEM_1, KT_NORMAL, 1},
+    {L"'", L"\"", VK_OEM_7, KT_NORMAL, 1},
+    {L"Enter", L"", VK_RETURN, KT_ACTION, 2},
+    // Row 4
+    {L"Shift", L"", VK_LSHIFT, KT_MODIFIER, 2},
+    {L"z", L"Z", 'Z', KT_NORMAL, 1},
+    {L"x", L"X", 'X', KT_NORMAL, 1},
+    {L"c", L"C", 'C', KT_NORMAL, 1},
+    {L"v", L"V", 'V', KT_NORMAL, 1},
+    {L"b", L"B", 'B', KT_NORMAL, 1},
+    {L"n", L"N", 'N', KT_NORMAL, 1},
+    {L"m", L"M", 'M', KT_NORMAL, 1},
+    {L",", L"<", VK_OEM_COMMA, KT_NORMAL, 1},
+    {L".", L">", VK_OEM_PERIOD, KT_NORMAL, 1},
+    {L"/", L"?", VK_OEM_2, KT_NORMAL, 1},
+    {L"Shift", L"", VK_RSHIFT, KT_MODIFIER, 2},
+    // Row 5
+    {L"Ctrl", L"", VK_LCONTROL, KT_MODIFIER, 2},
+    {L"Fn", L"", 0, KT_MODIFIER, 1}, // No VK for Fn
+    {L"Alt", L"", VK_LMENU, KT_MODIFIER, 1},
+    {L" ", L"", VK_SPACE, KT_ACTION, 5},
+    {L"Alt", L"", VK_RMENU, KT_MODIFIER, 1},
+    {L"Ctrl", L"", VK_RCONTROL, KT_MODIFIER, 2},
+};
+constexpr int s_usRows[] = {15, 15, 13, 12, 6};
+
+// --- JIS配列 (¥キーは日本語フォントで¥と表示される円記号 (\) を入力します) ---
+constexpr KEY_DEF s_jisKeys[] = {
+    // Row 1
+    {L"Esc", L"", VK_ESCAPE, KT_ACTION, 1},
+    {L"1", L"!", '1', KT_NORMAL, 1},
+    {L"2", L"\"", '2', KT_NORMAL, 1},
+    {L"3", L"#", '3', KT_NORMAL, 1},
+    {L"4", L"$", '4', KT_NORMAL, 1},
+    {L"5", L"%", '5', KT_NORMAL, 1},
+    {L"6", L"&", '6', KT_NORMAL, 1},
+    {L"7", L"'", '7', KT_NORMAL, 1},
+    {L"8", L"(", '8', KT_NORMAL, 1},
+    {L"9", L")", '9', KT_NORMAL, 1},
+    {L"0", L"", '0', KT_NORMAL, 1},
+    {L"-", L"=", VK_OEM_MINUS, KT_NORMAL, 1},
+    {L"^", L"~", VK_OEM_7, KT_NORMAL, 1},
+    {L"\\", L"|", VK_OEM_5, KT_NORMAL, 1},
+    {L"Del", L"", VK_DELETE, KT_ACTION, 1},
+    // Row 2
+    {L"Tab", L"", VK_TAB, KT_ACTION, 1},
+    {L"q", L"Q", 'Q', KT_NORMAL, 1},
+    {L"w", L"W", 'W', KT_NORMAL, 1},
+    {L"e", L"E", 'E', KT_NORMAL, 1},
+    {L"r", L"R", 'R', KT_NORMAL, 1},
+    {L"t", L"T", 'T', KT_NORMAL, 1},
+    {L"y", L"Y", 'Y', KT_NORMAL, 1},
+    {L"u", L"U", 'U', KT_NORMAL, 1},
+    {L"i", L"I", 'I', KT_NORMAL, 1},
+    {L"o", L"O", 'O', KT_NORMAL, 1},
+    {L"p", L"P", 'P', KT_NORMAL, 1},
+    {L"@", L"`", VK_OEM_3, KT_NORMAL, 1},
+    {L"[", L"{", VK_OEM_4, KT_NORMAL, 1},
+    {L"BS", L"", VK_BACK, KT_ACTION, 2},
+    // Row 3
+    {L"Caps", L"", VK_CAPITAL, KT_MODIFIER, 2},
+    {L"a", L"A", 'A', KT_NORMAL, 1},
+    {L"s", L"S", 'S', KT_NORMAL, 1},
+    {L"d", L"D", 'D', KT_NORMAL, 1},
+    {L"f", L"F", 'F', KT_NORMAL, 1},
+    {L"g", L"G", 'G', KT_NORMAL, 1},
+    {L"h", L"H", 'H', KT_NORMAL, 1},
+    {L"j", L"J", 'J', KT_NORMAL, 1},
+    {L"k", L"K", 'K', KT_NORMAL, 1},
+    {L"l", L"L", 'L', KT_NORMAL, 1},
+    {L";", L"+", VK_OEM_PLUS, KT_NORMAL, 1},
+    {L":", L"*", VK_OEM_1, KT_NORMAL, 1},
+    {L"]", L"}", VK_OEM_6, KT_NORMAL, 1},
+    {L"Enter", L"", VK_RETURN, KT_ACTION, 1},
+    // Row 4
+    {L"Shift", L"", VK_LSHIFT, KT_MODIFIER, 2},
+    {L"z", L"Z", 'Z', KT_NORMAL, 1},
+    {L"x", L"X", 'X', KT_NORMAL, 1},
+    {L"c", L"C", 'C', KT_NORMAL, 1},
+    {L"v", L"V", 'V', KT_NORMAL, 1},
+    {L"b", L"B", 'B', KT_NORMAL, 1},
+    {L"n", L"N", 'N', KT_NORMAL, 1},
+    {L"m", L"M", 'M', KT_NORMAL, 1},
+    {L",", L"<", VK_OEM_COMMA, KT_NORMAL, 1},
+    {L".", L">", VK_OEM_PERIOD, KT_NORMAL, 1},
+    {L"/", L"?", VK_OEM_2, KT_NORMAL, 1},
+    {L"\\", L"_", VK_OEM_102, KT_NORMAL, 1},
+    {L"Shift", L"", VK_RSHIFT, KT_MODIFIER, 2},
+    // Row 5
+    {L"Ctrl", L"", VK_LCONTROL, KT_MODIFIER, 2},
+    {L"Fn", L"", 0, KT_MODIFIER, 1},
+    {L"Alt", L"", VK_LMENU, KT_MODIFIER, 1},
+    {L" ", L"", VK_SPACE, KT_ACTION, 5},
+    {L"Alt", L"", VK_RMENU, KT_MODIFIER, 1},
+    {L"Ctrl", L"", VK_RCONTROL, KT_MODIFIER, 2},
+};
+constexpr int s_jisRows[] = {15, 14, 14, 13, 6};
+
+// --- テンキー ---
+constexpr KEY_DEF s_numericKeys[] = {
+    // Row 1
+    {L"7", L"", '7', KT_NORMAL, 1},
+    {L"8", L"", '8', KT_NORMAL, 1},
+    {L"9", L"", '9', KT_NORMAL, 1},
+    {L"BS", L"", VK_BACK, KT_ACTION, 1},
+    // Row 2
+    {L"4", L"", '4', KT_NORMAL, 1},
+    {L"5", L"", '5', KT_NORMAL, 1},
+    {L"6", L"", '6', KT_NORMAL, 1},
+    {L"Del", L"", VK_DELETE, KT_ACTION, 1},
+    // Row 3
+    {L"1", L"", '1', KT_NORMAL, 1},
+    {L"2", L"", '2', KT_NORMAL, 1},
+    {L"3", L"", '3', KT_NORMAL, 1},
+    {L"Esc", L"", VK_ESCAPE, KT_ACTION, 1},
+    // Row 4
+    {L"-", L"", VK_OEM_MINUS, KT_NORMAL, 1},
+    {L"0", L"", '0', KT_NORMAL, 1},
+    {L".", L"", VK_OEM_PERIOD, KT_NORMAL, 1},
+    {L"Enter", L"", VK_RETURN, KT_ACTION, 1},
+};
+constexpr int s_numericRows[] = {4, 4, 4, 4};
+
+// --- 16進数入力 (A～Fは英字キーとして扱わず、常に大文字を入力します) ---
+constexpr KEY_DEF s_hexKeys[] = {
+    // Row 1
+    {L"C", L"", 0, KT_NORMAL, 1},
+    {L"D", L"", 0, KT_NORMAL, 1},
+    {L"E", L"", 0, KT_NORMAL, 1},
+    {L"F", L"", 0, KT_NORMAL, 1},
+    {L"BS", L"", VK_BACK, KT_ACTION, 1},
+    // Row 2
+    {L"8", L"", '8', KT_NORMAL, 1},
+    {L"9", L"", '9', KT_NORMAL, 1},
+    {L"A", L"", 0, KT_NORMAL, 1},
+    {L"B", L"", 0, KT_NORMAL, 1},
+    {L"Del", L"", VK_DELETE, KT_ACTION, 1},
+    // Row 3
+    {L"4", L"", '4', KT_NORMAL, 1},
+    {L"5", L"", '5', KT_NORMAL, 1},
+    {L"6", L"", '6', KT_NORMAL, 1},
+    {L"7", L"", '7', KT_NORMAL, 1},
+    {L"Esc", L"", VK_ESCAPE, KT_ACTION, 1},
+    // Row 4
+    {L"0", L"", '0', KT_NORMAL, 1},
+    {L"1", L"", '1', KT_NORMAL, 1},
+    {L"2", L"", '2', KT_NORMAL, 1},
+    {L"3", L"", '3', KT_NORMAL, 1},
+    {L"Enter", L"", VK_RETURN, KT_ACTION, 1},
+};
+constexpr int s_hexRows[] = {5, 5, 5, 5};
+
+// --- 数値入力欄用キーパッド (+/- は符号反転、▲▼ は刻み幅の増減で、押し続けるとリピートします) ---
+constexpr KEY_DEF s_keypadKeys[] = {
+    // Row 1
+    {L"7", L"", '7', KT_NORMAL, 1},
+    {L"8", L"", '8', KT_NORMAL, 1},
+    {L"9", L"", '9', KT_NORMAL, 1},
+    {L"BS", L"", VK_BACK, KT_ACTION, 1},
+    {L"▲", L"", VK_UP, KT_ACTION, 1},
+    // Row 2
+    {L"4", L"", '4', KT_NORMAL, 1},
+    {L"5", L"", '5', KT_NORMAL, 1},
+    {L"6", L"", '6', KT_NORMAL, 1},
+    {L"+/-", L"", VK_OEM_MINUS, KT_ACTION, 1},
+    {L"▼", L"", VK_DOWN, KT_ACTION, 1},
+    // Row 3
+    {L"1", L"", '1', KT_NORMAL, 1},
+    {L"2", L"", '2', KT_NORMAL, 1},
+    {L"3", L"", '3', KT_NORMAL, 1},
+    {L".", L"", VK_OEM_PERIOD, KT_NORMAL, 1},
+    {L"Esc", L"", VK_ESCAPE, KT_ACTION, 1},
+    // Row 4
+    {L"0", L"", '0', KT_NORMAL, 2},
+    {L"Enter", L"", VK_RETURN, KT_ACTION, 3},
+};
+constexpr int s_keypadRows[] = {5, 5, 5, 2};
+
+using CUsLayout = CCompiledKeyboardLayout<s_usKeys, s_usRows>;
+using CJisLayout = CCompiledKeyboardLayout<s_jisKeys, s_jisRows>;
+using CNumericLayout = CCompiledKeyboardLayout<s_numericKeys, s_numericRows>;
+using CHexLayout = CCompiledKeyboardLayout<s_hexKeys, s_hexRows>;
+using CKeypadLayout = CCompiledKeyboardLayout<s_keypadKeys, s_keypadRows>;
+
+/// @brief レイアウトの一覧 (EKeyboardLayout の順)
+constexpr KEYBOARD_LAYOUT s_layouts[KEYBOARD_LAYOUT_COUNT] = {
+    CUsLayout::View(L"US"),
+    CJisLayout::View(L"JIS"),
+    CNumericLayout::View(L"Numeric"),
+    CHexLayout::View(L"Hex"),
+    CKeypadLayout::View(L"Keypad"),
+};
+
+// US配列は従来の 5行×15列 の配置と同じ大きさであること
+static_assert(CUsLayout::DATA.nColumns == 15 && CUsLayout::DATA.nRows == 5, "US配列の大きさが変わっています");
+static_assert(CUsLayout::DATA.infos[60].uId == IDC_KEY_BASE + 60, "US配列のキーIDが変わっています");
+
+/// @brief 全てのレイアウトの幅の最大値を返します。
+constexpr int MaxLayoutWidth()
+{
+    int nWidth = 0;
+    for (const KEYBOARD_LAYOUT &layout : s_layouts)
+        nWidth = layout.nWidth > nWidth ? layout.nWidth : nWidth;
+    return nWidth;
+}
+
+/// @brief 全てのレイアウトの高さの最大値を返します。
+constexpr int MaxLayoutHeight()
+{
+    int nHeight = 0;
+    for (const KEYBOARD_LAYOUT &layout : s_layouts)
+        nHeight = layout.nHeight > nHeight ? layout.nHeight : nHeight;
+    return nHeight;
+}
+}
+
+/**
+ * @brief レイアウトを返します。
+ */
+const KEYBOARD_LAYOUT &GetKeyboardLayout(EKeyboardLayout eLayout)
+{
+    const int nLayout = static_cast<int>(eLayout);
+    return s_layouts[(nLayout >= 0 && nLayout < KEYBOARD_LAYOUT_COUNT) ? nLayout : KEYBOARD_LAYOUT_US];
+}
+
+/**
+ * @brief 全てのレイアウトを収められる描画面の大きさを返します。
+ */
+void GetKeyboardLayoutExtent(int &nWidth, int &nHeight)
+{
+    constexpr int nMaxWidth = MaxLayoutWidth();
+    constexpr int nMaxHeight = MaxLayoutHeight();
+    nWidth = nMaxWidth;
+    nHeight = nMaxHeight;
+}
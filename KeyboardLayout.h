@@ -0,0 +1,131 @@
+﻿/**
+ * @file KeyboardLayout.h
+ * @brief ソフトウェアキーボードのレイアウト (キー配置) の宣言
+ * @details US配列・JIS配列・テンキー・16進数入力・数値入力欄用キーパッドの各レイアウトを、コンパイル時に計算済みの表として提供します。
+ * 各レイアウトは行順に並んだキー情報・キーの矩形・当たり判定の升目・仮想キーコードからの逆引き表を持ち、
+ * 実行時には計算もメモリの確保も行わずに GetKeyboardLayout() で切り替えられます。
+ * キーIDは IDC_KEY_BASE + キー番号 のため、キーIDからキー情報への変換は配列の添字だけで求まります。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "KeyDefine.h"
+
+/**
+ * @enum EKeyboardLayout
+ * @brief ソフトウェアキーボードのレイアウトの種類
+ */
+enum EKeyboardLayout
+{
+    KEYBOARD_LAYOUT_US,      ///< US配列
+    KEYBOARD_LAYOUT_JIS,     ///< JIS配列
+    KEYBOARD_LAYOUT_NUMERIC, ///< テンキー (数字・符号・小数点)
+    KEYBOARD_LAYOUT_HEX,     ///< 16進数入力 (0～9, A～F)
+    KEYBOARD_LAYOUT_KEYPAD,  ///< 数値入力欄用キーパッド (数字・符号反転・小数点・増減、CNumericField と組み合わせて使います)
+    KEYBOARD_LAYOUT_COUNT    ///< レイアウトの数
+};
+
+/**
+ * @enum EKeyModifier
+ * @brief 修飾キーの状態のビット
+ */
+enum EKeyModifier
+{
+    KEY_MOD_SHIFT = 0x01, ///< Shift
+    KEY_MOD_CAPS = 0x02,  ///< CapsLock
+    KEY_MOD_CTRL = 0x04,  ///< Ctrl
+    KEY_MOD_ALT = 0x08,   ///< Alt
+    KEY_MOD_FN = 0x10     ///< Fn
+};
+
+// --- キーの寸法 (全レイアウト共通) ---
+constexpr int KEYBOARD_KEY_WIDTH = 34;        ///< 標準キーの幅
+constexpr int KEYBOARD_KEY_HEIGHT = 34;       ///< キーの高さ
+constexpr int KEYBOARD_KEY_GAP = 1;           ///< キーとキーの間の隙間
+constexpr int KEYBOARD_TITLE_BAR_HEIGHT = 34; ///< キーの領域より上にあるタイトルバーの高さ
+
+// --- レイアウトの上限 (表の大きさ) ---
+constexpr int KEYBOARD_MAX_KEYS = 64;    ///< 1つのレイアウトのキーの最大数
+constexpr int KEYBOARD_MAX_ROWS = 8;     ///< 行の最大数
+constexpr int KEYBOARD_MAX_COLUMNS = 16; ///< 1行あたりの標準キーの最大数 (当たり判定の升目の列数)
+
+/**
+ * @struct KEYBOARD_RECT
+ * @brief キーボード上の矩形 (クライアント座標、right/bottom は含まない)
+ */
+struct KEYBOARD_RECT
+{
+    int left;   ///< 左端
+    int top;    ///< 上端
+    int right;  ///< 右端
+    int bottom; ///< 下端
+};
+
+/**
+ * @struct KEYBOARD_KEY
+ * @brief 描画面に配置する1つのキーの表示用の情報
+ */
+struct KEYBOARD_KEY
+{
+    const wchar_t *pszLabel;      ///< 通常時のラベル
+    const wchar_t *pszShiftLabel; ///< Shift時のラベル (なければ空文字列)
+    int nRow;                     ///< 行 (0始まり)
+    int nSpan;                    ///< 横幅 (標準キー何個分か)
+    bool bAlphabet;               ///< 英字キーか (Shift と CapsLock の排他的論理和で大文字になる)
+    unsigned nModifier;           ///< 修飾キーであれば対応する EKeyModifier のビット (それ以外は0)
+};
+
+/**
+ * @struct KEYBOARD_LAYOUT
+ * @brief コンパイル済みのレイアウト
+ * @details 配列は全てキー番号 (行順、0始まり) で引きます。指す先は静的な定数のため、解放は不要です。
+ */
+struct KEYBOARD_LAYOUT
+{
+    const wchar_t *pszName;       ///< レイアウトの名前
+    int nKeyCount;                ///< キーの数
+    int nRows;                    ///< 行数
+    int nColumns;                 ///< 最も長い行の標準キーの数
+    int nWidth;                   ///< 描画面全体の幅
+    int nHeight;                  ///< 描画面全体の高さ (タイトルバーを含む)
+    const KEY_INFO *pInfos;       ///< キー番号 → キー情報 (uId は IDC_KEY_BASE + キー番号)
+    const KEYBOARD_KEY *pKeys;    ///< キー番号 → 表示用の情報
+    const KEYBOARD_RECT *pRects;  ///< キー番号 → キーの矩形
+    const signed char *pHitGrid;  ///< 升目 (行 × KEYBOARD_MAX_COLUMNS + 列) → キー番号 (-1は空き)
+    const signed char *pVirtKeys; ///< 仮想キーコード (0～255) → キー番号 (-1は該当なし)
+};
+
+/**
+ * @brief レイアウトを返します。
+ * @param[in] eLayout レイアウトの種類 (範囲外の場合はUS配列)
+ * @return コンパイル済みのレイアウト
+ */
+const KEYBOARD_LAYOUT &GetKeyboardLayout(EKeyboardLayout eLayout);
+
+/**
+ * @brief 全てのレイアウトを収められる描画面の大きさを返します。
+ * @details レイアウトを切り替えても裏画面を作り直さずに済むよう、裏画面の大きさに使います。
+ * @param[out] nWidth 最大の幅
+ * @param[out] nHeight 最大の高さ
+ */
+void GetKeyboardLayoutExtent(int &nWidth, int &nHeight);
+
+/**
+ * @brief キーIDからキー番号を求めます。
+ * @return キー番号 (該当するキーがなければ-1)
+ */
+inline int FindKeyById(const KEYBOARD_LAYOUT &layout, unsigned int uId)
+{
+    const unsigned int uIndex = uId - IDC_KEY_BASE;
+    return uIndex < static_cast<unsigned int>(layout.nKeyCount) ? static_cast<int>(uIndex) : -1;
+}
+
+/**
+ * @brief 仮想キーコードからキー番号を求めます。
+ * @details 仮想キーコードがレイアウト内で重複しないことはコンパイル時に検査しています (左右のShiftなどは別のコード)。
+ * @return キー番号 (該当するキーがなければ-1)
+ */
+inline int FindKeyByVirtKey(const KEYBOARD_LAYOUT &layout, unsigned char bVirtKey)
+{
+    return bVirtKey != 0 ? layout.pVirtKeys[bVirtKey] : -1;
+}
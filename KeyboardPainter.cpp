@@ -0,0 +1,101 @@
+﻿/**
+ * @file KeyboardPainter.cpp
+ * @brief ソフトウェアキーボードの描画面の描画処理の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "KeyboardPainter.h"
+
+#include <algorithm>
+
+namespace
+{
+// 色の定義
+const RenderColor CLR_TITLE_BAR = RenderRgb(0, 102, 204);        ///< カスタムタイトルバーの背景色
+const RenderColor CLR_CLOSE_X = RenderRgb(255, 255, 255);        ///< 閉じるボタンの「×」マークの色
+const RenderColor CLR_KEY_BLUE = RenderRgb(0, 102, 204);         ///< 修飾キーがONの時の背景色
+const RenderColor CLR_KEY_GRAY = RenderRgb(240, 240, 240);       ///< 通常時のキーの背景色
+const RenderColor CLR_KEY_BORDER = RenderRgb(173, 173, 173);     ///< キーの枠線の色
+const RenderColor CLR_TEXT_BLACK = RenderRgb(0, 0, 0);           ///< 通常時の文字色
+const RenderColor CLR_TEXT_WHITE = RenderRgb(255, 255, 255);     ///< 修飾キーがONの時の文字色
+const RenderColor CLR_TEXT_GRAY = RenderRgb(128, 128, 128);      ///< Shift時ラベルの文字色
+const RenderColor CLR_SUGGESTION_SEP = RenderRgb(102, 163, 224); ///< 入力候補欄の区切り線の色
+
+/// @brief 閉じるボタンの「×」マークの内側の余白
+constexpr int CLOSE_MARK_MARGIN = 8;
+/// @brief 閉じるボタンの「×」マークの線の太さ
+constexpr int CLOSE_MARK_WIDTH = 2;
+}
+
+/**
+ * @brief 背景 (キーの隙間)・タイトルバー・閉じるボタンを描画します。
+ */
+void CKeyboardPainter::RenderFrame(CRenderTarget &target, const REGION_RECT &rcClient, const REGION_RECT &rcTitleBar,
+                                   const REGION_RECT &rcCloseBtn, RenderColor colorFace)
+{
+    target.FillRect(rcClient, colorFace);
+    target.FillRect(rcTitleBar, CLR_TITLE_BAR);
+
+    // 閉じるボタンの領域に「×」を描画します。
+    target.DrawLine(rcCloseBtn.left + CLOSE_MARK_MARGIN, rcCloseBtn.top + CLOSE_MARK_MARGIN, rcCloseBtn.right - CLOSE_MARK_MARGIN,
+                    rcCloseBtn.bottom - CLOSE_MARK_MARGIN, CLR_CLOSE_X, CLOSE_MARK_WIDTH);
+    target.DrawLine(rcCloseBtn.left + CLOSE_MARK_MARGIN, rcCloseBtn.bottom - CLOSE_MARK_MARGIN, rcCloseBtn.right - CLOSE_MARK_MARGIN,
+                    rcCloseBtn.top + CLOSE_MARK_MARGIN, CLR_CLOSE_X, CLOSE_MARK_WIDTH);
+}
+
+/**
+ * @brief 入力候補欄を描画します。
+ * @details 欄を等分した区画に候補を左から並べ、2つ目以降の区画の左端に区切り線を描画します。
+ */
+void CKeyboardPainter::RenderSuggestions(CRenderTarget &target, const REGION_RECT &rcSuggestions, int nCells,
+                                         const std::wstring *pSuggestions, std::size_t nCount)
+{
+    target.FillRect(rcSuggestions, CLR_TITLE_BAR);
+    if (nCount == 0)
+        return;
+
+    const int nCellWidth = (rcSuggestions.right - rcSuggestions.left) / (std::max)(1, nCells);
+    for (std::size_t i = 0; i < nCount; ++i)
+    {
+        REGION_RECT rcCell = { rcSuggestions.left + nCellWidth * static_cast<int>(i), rcSuggestions.top,
+                               rcSuggestions.left + nCellWidth * static_cast<int>(i + 1), rcSuggestions.bottom };
+        if (i > 0)
+            target.FillRect(REGION_RECT{ rcCell.left, rcCell.top + 6, rcCell.left + 1, rcCell.bottom - 6 }, CLR_SUGGESTION_SEP);
+        rcCell.left += 6;
+        rcCell.right -= 6;
+        target.DrawString(pSuggestions[i].c_str(), static_cast<int>(pSuggestions[i].size()), rcCell, CLR_TEXT_WHITE,
+                          RENDER_TEXT_LEFT | RENDER_TEXT_VCENTER | RENDER_TEXT_END_ELLIPSIS);
+    }
+}
+
+/**
+ * @brief 1つのキーを現在の表示内容で描画します。
+ * @details ON状態なら青、通常ならグレーの背景に枠線を描き、主ラベル (副ラベルがある場合は左上、それ以外は中央) と
+ * 副ラベル (右下) を描画します。
+ */
+void CKeyboardPainter::RenderKey(CRenderTarget &target, const CKeyboardSurface &surface, int nIndex)
+{
+    const KEYBOARD_RECT &rc = surface.GetKeyRect(nIndex);
+    const KEY_FACE &face = surface.GetFace(nIndex);
+    const REGION_RECT rect = { rc.left, rc.top, rc.right, rc.bottom };
+
+    // --- 1. 背景の描画 ---
+    target.FillRect(rect, face.bOn ? CLR_KEY_BLUE : CLR_KEY_GRAY);
+
+    // --- 2. 枠線の描画 ---
+    target.DrawFrame(rect, CLR_KEY_BORDER, 1);
+
+    // --- 3. ラベルの描画 ---
+    // ON状態なら白、通常なら黒の文字色
+    unsigned nFormat = RENDER_TEXT_CENTER | RENDER_TEXT_VCENTER;
+    REGION_RECT textRect = rect;
+    if (face.bCorner)
+    {
+        nFormat = RENDER_TEXT_LEFT | RENDER_TEXT_TOP;
+        textRect = REGION_RECT{ rect.left + 4, rect.top + 4, rect.right - 4, rect.bottom - 4 };
+    }
+    target.DrawString(face.pszMain, -1, textRect, face.bOn ? CLR_TEXT_WHITE : CLR_TEXT_BLACK, nFormat);
+
+    // Shift時ラベルを描画（右下）
+    if (face.pszSub != nullptr)
+        target.DrawString(face.pszSub, -1, textRect, CLR_TEXT_GRAY, RENDER_TEXT_RIGHT | RENDER_TEXT_BOTTOM);
+}
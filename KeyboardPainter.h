@@ -0,0 +1,54 @@
+﻿/**
+ * @file KeyboardPainter.h
+ * @brief ソフトウェアキーボードの描画面の描画処理のクラス宣言
+ * @details CSoftwareKeyboardDlg の裏画面への描画 (背景・タイトルバー・閉じるボタン・入力候補欄・キー) を、
+ * ウィンドウに依存しない CRenderTarget への描画として実装します。キーの矩形と表示内容は CKeyboardSurface から
+ * 受け取るため、ウィンドウがなくても同じ描画処理を実行できます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "KeyboardSurface.h"
+#include "RenderTarget.h"
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @class CKeyboardPainter
+ * @brief キーボードの描画面を描画先に描画するクラス
+ */
+class CKeyboardPainter
+{
+public:
+    /**
+     * @brief 背景 (キーの隙間)・タイトルバー・閉じるボタンを描画します。
+     * @param[in,out] target 描画先
+     * @param[in] rcClient 描画面全体
+     * @param[in] rcTitleBar タイトルバー
+     * @param[in] rcCloseBtn 閉じるボタン
+     * @param[in] colorFace 背景色 (ボタンの表面の色)
+     */
+    static void RenderFrame(CRenderTarget &target, const REGION_RECT &rcClient, const REGION_RECT &rcTitleBar,
+                            const REGION_RECT &rcCloseBtn, RenderColor colorFace);
+
+    /**
+     * @brief 入力候補欄を描画します。
+     * @details 候補がない欄はタイトルバーの背景のままにします。
+     * @param[in,out] target 描画先
+     * @param[in] rcSuggestions 入力候補欄
+     * @param[in] nCells 入力候補欄の区画の数
+     * @param[in] pSuggestions 入力候補の文字列の並び
+     * @param[in] nCount 入力候補の数
+     */
+    static void RenderSuggestions(CRenderTarget &target, const REGION_RECT &rcSuggestions, int nCells, const std::wstring *pSuggestions,
+                                  std::size_t nCount);
+
+    /**
+     * @brief 1つのキーを現在の表示内容で描画します。
+     * @param[in,out] target 描画先
+     * @param[in] surface キーボードの描画面
+     * @param[in] nIndex キー番号
+     */
+    static void RenderKey(CRenderTarget &target, const CKeyboardSurface &surface, int nIndex);
+};
@@ -0,0 +1,114 @@
+﻿/**
+ * @file KeyboardSurface.cpp
+ * @brief キーボードの描画面のレイアウト・当たり判定・表示状態の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "KeyboardSurface.h"
+
+namespace
+{
+/// @brief 文字列が空でないかを返します。
+bool HasText(const wchar_t *psz)
+{
+    return psz != nullptr && psz[0] != L'\0';
+}
+}
+
+/**
+ * @brief CKeyboardSurfaceクラスのコンストラクタ
+ */
+CKeyboardSurface::CKeyboardSurface()
+    : m_pLayout(&GetKeyboardLayout(KEYBOARD_LAYOUT_US)), m_faces(), m_painted()
+{
+}
+
+/**
+ * @brief レイアウトを設定します。
+ */
+void CKeyboardSurface::SetLayout(const KEYBOARD_LAYOUT &layout)
+{
+    m_pLayout = &layout;
+    InvalidateAll();
+}
+
+/**
+ * @brief 座標にあるキーを返します。
+ * @details レイアウトの升目の表を直接引き、最後に隙間に当たっていないかをキーの矩形で確認します。
+ */
+int CKeyboardSurface::HitTest(int x, int y) const
+{
+    const int nCellWidth = KEYBOARD_KEY_WIDTH + KEYBOARD_KEY_GAP;
+    const int nCellHeight = KEYBOARD_KEY_HEIGHT + KEYBOARD_KEY_GAP;
+    const int yKeys = y - KEYBOARD_TITLE_BAR_HEIGHT - KEYBOARD_KEY_GAP;
+    if (x < 0 || yKeys < 0)
+        return -1;
+
+    const int nColumn = x / nCellWidth;
+    const int nRow = yKeys / nCellHeight;
+    if (nColumn >= m_pLayout->nColumns || nRow >= m_pLayout->nRows)
+        return -1;
+
+    const int nIndex = m_pLayout->pHitGrid[nRow * KEYBOARD_MAX_COLUMNS + nColumn];
+    if (nIndex < 0)
+        return -1;
+    const KEYBOARD_RECT &rect = m_pLayout->pRects[nIndex];
+    return (x >= rect.left && x < rect.right && y >= rect.top && y < rect.bottom) ? nIndex : -1;
+}
+
+/**
+ * @brief 修飾キーの状態に対するキーの表示内容を求めます。
+ * @details 英字キーは Shift と CapsLock の片方だけがONのときに大文字を表示します。
+ * 記号・数字キーは Shift がONのときに Shift 時の文字を主ラベルとし、それ以外は主ラベルを左上、
+ * Shift 時の文字を右下に表示します。修飾キーは自身の状態がONのときにON状態で表示します。
+ */
+KEY_FACE CKeyboardSurface::ComputeFace(const KEYBOARD_KEY &key, unsigned nModifiers)
+{
+    const bool bShiftOn = (nModifiers & MOD_SHIFT) != 0;
+    const bool bCapsLockOn = (nModifiers & MOD_CAPS) != 0;
+
+    KEY_FACE face = {key.pszLabel, nullptr, key.nModifier != 0 && (nModifiers & key.nModifier) != 0, false};
+    if (key.bAlphabet)
+    {
+        if (bShiftOn != bCapsLockOn)
+            face.pszMain = key.pszShiftLabel;
+    }
+    else if (HasText(key.pszShiftLabel))
+    {
+        if (bShiftOn)
+        {
+            face.pszMain = key.pszShiftLabel;
+        }
+        else
+        {
+            face.pszSub = key.pszShiftLabel;
+            face.bCorner = true;
+        }
+    }
+    return face;
+}
+
+/**
+ * @brief 修飾キーの状態を設定し、表示内容が変わったキーを返します。
+ */
+void CKeyboardSurface::SetModifiers(unsigned nModifiers, std::vector<int> &dirty)
+{
+    dirty.clear();
+    for (int i = 0; i < GetKeyCount(); ++i)
+    {
+        const KEY_FACE face = ComputeFace(m_pLayout->pKeys[i], nModifiers);
+        if (!m_painted[i] || face != m_faces[i])
+        {
+            m_faces[i] = face;
+            m_painted[i] = true;
+            dirty.push_back(i);
+        }
+    }
+}
+
+/**
+ * @brief 全てのキーを未描画の状態にします。
+ */
+void CKeyboardSurface::InvalidateAll()
+{
+    m_painted.fill(false);
+}
@@ -0,0 +1,115 @@
+﻿/**
+ * @file KeyboardSurface.h
+ * @brief ソフトウェアキーボードを1枚の描画面として扱うためのレイアウト・当たり判定・表示状態のクラス宣言
+ * @details キーごとのウィンドウを持たずにキーボード全体を1つのウィンドウに描画するための計算部分です。
+ * キーの矩形と当たり判定の升目はコンパイル済みのレイアウト (KeyboardLayout.h) のものを使い、
+ * 座標からキーへの当たり判定はキー1個分の升目ごとの表を直接引いて求めます。
+ * 各キーの表示内容 (ラベル・ON状態) は修飾キーの状態から求めて保持しておき、
+ * 修飾キーが変わったときは表示内容が実際に変わったキーだけを再描画の対象として返します。
+ * 表示内容は最大キー数分の固定長の配列に保持するため、レイアウトを切り替えてもメモリを確保しません。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "KeyboardLayout.h"
+
+#include <array>
+#include <vector>
+
+/**
+ * @struct KEY_FACE
+ * @brief 1つのキーの表示内容
+ * @details ラベルはキー情報の文字列を指すため、ポインタの比較だけで変化を判定できます。
+ */
+struct KEY_FACE
+{
+    const wchar_t *pszMain; ///< 主ラベル
+    const wchar_t *pszSub;  ///< 右下に小さく表示する副ラベル (なければnullptr)
+    bool bOn;               ///< 修飾キーがON状態か
+    bool bCorner;           ///< 主ラベルを左上に寄せて表示するか (副ラベルがある場合)
+
+    bool operator==(const KEY_FACE &other) const
+    {
+        return pszMain == other.pszMain && pszSub == other.pszSub && bOn == other.bOn && bCorner == other.bCorner;
+    }
+    bool operator!=(const KEY_FACE &other) const { return !(*this == other); }
+};
+
+/**
+ * @class CKeyboardSurface
+ * @brief キーボードの描画面のレイアウト・当たり判定・表示状態
+ */
+class CKeyboardSurface
+{
+public:
+    /// @brief 修飾キーの状態のビット
+    enum Modifier
+    {
+        MOD_SHIFT = KEY_MOD_SHIFT, ///< Shift
+        MOD_CAPS = KEY_MOD_CAPS,   ///< CapsLock
+        MOD_CTRL = KEY_MOD_CTRL,   ///< Ctrl
+        MOD_ALT = KEY_MOD_ALT,     ///< Alt
+        MOD_FN = KEY_MOD_FN        ///< Fn
+    };
+
+    /**
+     * @brief コンストラクタ
+     * @details US配列のレイアウトを設定した状態で初期化します。
+     */
+    CKeyboardSurface();
+
+    /**
+     * @brief レイアウトを設定します。
+     * @details 表示内容は全て未描画の状態になります。メモリの確保は行いません。
+     * @param[in] layout コンパイル済みのレイアウト
+     */
+    void SetLayout(const KEYBOARD_LAYOUT &layout);
+
+    /// @brief 現在のレイアウトを返します。
+    const KEYBOARD_LAYOUT &GetLayout() const { return *m_pLayout; }
+    /// @brief キーの数を返します。
+    int GetKeyCount() const { return m_pLayout->nKeyCount; }
+    /// @brief キーの情報を返します。
+    const KEY_INFO &GetKeyInfo(int nIndex) const { return m_pLayout->pInfos[nIndex]; }
+    /// @brief キーの表示用の情報を返します。
+    const KEYBOARD_KEY &GetKey(int nIndex) const { return m_pLayout->pKeys[nIndex]; }
+    /// @brief キーの矩形を返します。
+    const KEYBOARD_RECT &GetKeyRect(int nIndex) const { return m_pLayout->pRects[nIndex]; }
+    /// @brief キーの現在の表示内容を返します。
+    const KEY_FACE &GetFace(int nIndex) const { return m_faces[nIndex]; }
+    /// @brief 描画面全体の幅を返します。
+    int GetWidth() const { return m_pLayout->nWidth; }
+    /// @brief 描画面全体の高さを返します。
+    int GetHeight() const { return m_pLayout->nHeight; }
+
+    /**
+     * @brief 座標にあるキーを返します。
+     * @return キーの番号 (キーの隙間やキーの領域の外では-1)
+     */
+    int HitTest(int x, int y) const;
+
+    /**
+     * @brief 修飾キーの状態に対するキーの表示内容を求めます。
+     * @param[in] key キーの情報
+     * @param[in] nModifiers 修飾キーの状態 (Modifier の組み合わせ)
+     */
+    static KEY_FACE ComputeFace(const KEYBOARD_KEY &key, unsigned nModifiers);
+
+    /**
+     * @brief 修飾キーの状態を設定し、表示内容が変わったキーを返します。
+     * @param[in] nModifiers 修飾キーの状態
+     * @param[out] dirty 再描画が必要なキーの番号 (呼び出し前の内容は消去します)
+     */
+    void SetModifiers(unsigned nModifiers, std::vector<int> &dirty);
+
+    /**
+     * @brief 全てのキーを未描画の状態にします (描画面を作り直した場合など)。
+     * @details 次の SetModifiers() で全てのキーが再描画の対象になります。
+     */
+    void InvalidateAll();
+
+private:
+    const KEYBOARD_LAYOUT *m_pLayout;                ///< 現在のレイアウト
+    std::array<KEY_FACE, KEYBOARD_MAX_KEYS> m_faces; ///< キーの現在の表示内容
+    std::array<bool, KEYBOARD_MAX_KEYS> m_painted;   ///< 現在の表示内容を描画済みか
+};
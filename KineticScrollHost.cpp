@@ -0,0 +1,368 @@
+﻿/**
+ * @file KineticScrollHost.cpp
+ * @brief スクロール可能なダイアログのスクロール位置・スクロールバー・慣性スクロールの実装
+ */
+#include "pch.h"
+#include "KineticScrollHost.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+/**
+ * @brief コンストラクタ
+ */
+CKineticScrollHost::CKineticScrollHost(UINT_PTR nTimerId, int nLineAmount)
+    : m_pHost(nullptr), m_nTimerId(nTimerId), m_nLineAmount(nLineAmount), m_nTotalWidth(0), m_nTotalHeight(0),
+      m_nHScrollPos(0), m_nVScrollPos(0), m_bDragPending(FALSE), m_ptDragStart(0, 0), m_bFrameTimer(FALSE)
+{
+}
+
+/**
+ * @brief 内容全体の大きさを設定し、スクロール位置を先頭に戻します。
+ */
+void CKineticScrollHost::SetContentSize(int nWidth, int nHeight)
+{
+    m_nTotalWidth = nWidth;
+    m_nTotalHeight = nHeight;
+    m_nHScrollPos = 0;
+    m_nVScrollPos = 0;
+}
+
+/**
+ * @brief スクロールバーの情報をホストウィンドウの大きさに合わせて更新します。
+ * @details 内容がクライアント領域に収まる方向は、スクロールバーを隠して位置を先頭に戻します。
+ */
+void CKineticScrollHost::UpdateScrollBars()
+{
+    CRect clientRect;
+    m_pHost->GetClientRect(&clientRect);
+    SCROLLINFO si;
+    si.cbSize = sizeof(SCROLLINFO);
+
+    // --- 垂直スクロールバー ---
+    if (m_nTotalHeight > clientRect.Height())
+    {
+        si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+        si.nMin = 0;
+        si.nMax = m_nTotalHeight;
+        si.nPage = clientRect.Height();
+        si.nPos = m_nVScrollPos;
+        m_pHost->SetScrollInfo(SB_VERT, &si, TRUE);
+        m_pHost->ShowScrollBar(SB_VERT, TRUE);
+    }
+    else
+    {
+        m_nVScrollPos = 0;
+        m_pHost->ShowScrollBar(SB_VERT, FALSE);
+    }
+
+    // --- 水平スクロールバー ---
+    if (m_nTotalWidth > clientRect.Width())
+    {
+        si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+        si.nMin = 0;
+        si.nMax = m_nTotalWidth;
+        si.nPage = clientRect.Width();
+        si.nPos = m_nHScrollPos;
+        m_pHost->SetScrollInfo(SB_HORZ, &si, TRUE);
+        m_pHost->ShowScrollBar(SB_HORZ, TRUE);
+    }
+    else
+    {
+        m_nHScrollPos = 0;
+        m_pHost->ShowScrollBar(SB_HORZ, FALSE);
+    }
+}
+
+/**
+ * @brief スクロールバーの操作を処理します。
+ * @details SB_LINEUP/SB_LINELEFT のように、水平と垂直で同じ値のコードを1つの分岐で扱います。
+ */
+void CKineticScrollHost::OnScroll(int nBar, UINT nSBCode, UINT nPos)
+{
+    const BOOL bHorz = (nBar == SB_HORZ);
+    CRect clientRect;
+    m_pHost->GetClientRect(&clientRect);
+    const int nPage = bHorz ? clientRect.Width() : clientRect.Height();
+    int &nScrollPos = bHorz ? m_nHScrollPos : m_nVScrollPos;
+    int currentPos = nScrollPos;
+
+    // スクロールバーの操作を優先し、進行中の慣性スクロールは止める
+    (bHorz ? m_hScroller : m_vScroller).Stop();
+
+    switch (nSBCode)
+    {
+    case SB_LINEUP:      currentPos -= m_nLineAmount; break;
+    case SB_LINEDOWN:    currentPos += m_nLineAmount; break;
+    case SB_PAGEUP:      currentPos -= nPage; break;
+    case SB_PAGEDOWN:    currentPos += nPage; break;
+    case SB_THUMBTRACK:  currentPos = nPos; break;
+    case SB_TOP:         currentPos = 0; break;
+    case SB_BOTTOM:      currentPos = m_pHost->GetScrollLimit(nBar); break;
+    }
+
+    // 新しいスクロール位置が有効な範囲内に収まるようにクランプ処理
+    int maxScrollPos = m_pHost->GetScrollLimit(nBar);
+    currentPos = max(0, min(currentPos, maxScrollPos));
+
+    // 位置に変化がなければ何もしない
+    if (currentPos == nScrollPos)
+        return;
+
+    // 画面を移動させる量を計算
+    int scrollAmount = nScrollPos - currentPos;
+    nScrollPos = currentPos;
+
+    // ウィンドウをスクロールし、スクロールバーの位置を更新
+    if (bHorz)
+        m_pHost->ScrollWindow(scrollAmount, 0);
+    else
+        m_pHost->ScrollWindow(0, scrollAmount);
+    m_pHost->SetScrollPos(nBar, nScrollPos, TRUE);
+}
+
+/**
+ * @brief 指定した矩形が完全に表示されるようにスクロールします。
+ */
+void CKineticScrollHost::EnsureVisible(const CRect &rect)
+{
+    // 矩形の表示を優先し、進行中の慣性スクロールは止める
+    Stop();
+
+    CRect clientRect;
+    m_pHost->GetClientRect(&clientRect); // ホストの現在の表示領域
+
+    // --- 垂直スクロール量の計算 ---
+    int newVPos = m_nVScrollPos;
+    if (rect.top < 0) // 上にはみ出している場合
+    {
+        newVPos += rect.top; // はみ出した分だけスクロール位置を戻す
+    }
+    else if (rect.bottom > clientRect.bottom) // 下にはみ出している場合
+    {
+        newVPos += (rect.bottom - clientRect.bottom); // はみ出した分だけスクロール位置を進める
+    }
+
+    // --- 水平スクロール量の計算 ---
+    int newHPos = m_nHScrollPos;
+    if (rect.left < 0) // 左にはみ出している場合
+    {
+        newHPos += rect.left;
+    }
+    else if (rect.right > clientRect.right) // 右にはみ出している場合
+    {
+        newHPos += (rect.right - clientRect.right);
+    }
+
+    // スクロール位置が変化した場合のみ、実際のスクロール処理を実行
+    if (newVPos != m_nVScrollPos || newHPos != m_nHScrollPos)
+    {
+        // 範囲内に収める
+        newHPos = max(0, min(newHPos, m_pHost->GetScrollLimit(SB_HORZ)));
+        newVPos = max(0, min(newVPos, m_pHost->GetScrollLimit(SB_VERT)));
+
+        // 画面を移動させる量を計算
+        int dx = m_nHScrollPos - newHPos;
+        int dy = m_nVScrollPos - newVPos;
+
+        // 新しい位置を保存
+        m_nHScrollPos = newHPos;
+        m_nVScrollPos = newVPos;
+
+        // ウィンドウをスクロールし、スクロールバーの位置を更新
+        m_pHost->ScrollWindow(dx, dy);
+        m_pHost->SetScrollPos(SB_HORZ, m_nHScrollPos, TRUE);
+        m_pHost->SetScrollPos(SB_VERT, m_nVScrollPos, TRUE);
+    }
+}
+
+/**
+ * @brief 慣性スクロールの範囲を、内容全体とクライアント領域の大きさに合わせて更新します。
+ */
+void CKineticScrollHost::UpdateScrollerRanges()
+{
+    CRect clientRect;
+    m_pHost->GetClientRect(&clientRect);
+    m_hScroller.SetRange(max(0, m_nTotalWidth - clientRect.Width()));
+    m_vScroller.SetRange(max(0, m_nTotalHeight - clientRect.Height()));
+}
+
+/**
+ * @brief 指定したスクロール位置までホストウィンドウの内容を移動します。
+ */
+void CKineticScrollHost::ScrollTo(int nHPos, int nVPos)
+{
+    CRect clientRect;
+    m_pHost->GetClientRect(&clientRect);
+    nHPos = max(0, min(nHPos, m_nTotalWidth - clientRect.Width()));
+    nVPos = max(0, min(nVPos, m_nTotalHeight - clientRect.Height()));
+
+    // 画面を移動させる量を計算
+    int dx = m_nHScrollPos - nHPos;
+    int dy = m_nVScrollPos - nVPos;
+    if (dx == 0 && dy == 0)
+        return;
+
+    m_nHScrollPos = nHPos;
+    m_nVScrollPos = nVPos;
+
+    // ウィンドウをスクロールし、スクロールバーの位置を更新
+    m_pHost->ScrollWindow(dx, dy);
+    if (dx != 0)
+        m_pHost->SetScrollPos(SB_HORZ, m_nHScrollPos, TRUE);
+    if (dy != 0)
+        m_pHost->SetScrollPos(SB_VERT, m_nVScrollPos, TRUE);
+}
+
+/**
+ * @brief フレームタイマーを開始します (動作中なら何もしません)。
+ */
+void CKineticScrollHost::StartFrameTimer()
+{
+    if (!m_bFrameTimer)
+    {
+        m_pHost->SetTimer(m_nTimerId, CKineticScroller::FRAME_INTERVAL_MS, NULL);
+        m_bFrameTimer = TRUE;
+    }
+}
+
+/**
+ * @brief 進行中の慣性スクロールを停止し、フレームタイマーを止めます。
+ */
+void CKineticScrollHost::Stop()
+{
+    m_hScroller.Stop();
+    m_vScroller.Stop();
+    if (m_bFrameTimer)
+    {
+        m_pHost->KillTimer(m_nTimerId);
+        m_bFrameTimer = FALSE;
+    }
+}
+
+/**
+ * @brief ホイールの回転を処理します。
+ * @details 1ノッチ (WHEEL_DELTA) あたり m_nLineAmount ピクセルの速さで目標位置へ追従します。
+ * 実際の移動はフレームタイマーでまとめて行います。
+ */
+BOOL CKineticScrollHost::OnMouseWheel(UINT nFlags, short zDelta)
+{
+    // Shiftキーが押されている場合は水平スクロール、それ以外は垂直スクロール
+    BOOL bHorz = (nFlags & MK_SHIFT) != 0;
+    CKineticScroller &scroller = bHorz ? m_hScroller : m_vScroller;
+
+    UpdateScrollerRanges();
+    if (!scroller.IsAnimating())
+    {
+        scroller.SetPosition(bHorz ? m_nHScrollPos : m_nVScrollPos);
+    }
+    scroller.AddWheelDelta(CKineticScroller::NowMs(), zDelta, m_nLineAmount);
+    StartFrameTimer();
+
+    return TRUE;
+}
+
+/**
+ * @brief ホストの背景の押下を処理します。
+ */
+void CKineticScrollHost::OnLButtonDown(CPoint point)
+{
+    Stop();
+    m_bDragPending = TRUE;
+    m_ptDragStart = point;
+    m_pHost->SetCapture();
+}
+
+/**
+ * @brief マウスの移動を処理します。
+ * @details ドラッグの開始後は位置の計算だけを行い、描画はフレームタイマーでまとめて行います。
+ */
+void CKineticScrollHost::OnMouseMove(UINT nFlags, CPoint point)
+{
+    double dNow = CKineticScroller::NowMs();
+    if (m_bDragPending && (nFlags & MK_LBUTTON))
+    {
+        if (abs(point.x - m_ptDragStart.x) >= ::GetSystemMetrics(SM_CXDRAG) ||
+            abs(point.y - m_ptDragStart.y) >= ::GetSystemMetrics(SM_CYDRAG))
+        {
+            m_bDragPending = FALSE;
+            UpdateScrollerRanges();
+            m_hScroller.SetPosition(m_nHScrollPos);
+            m_vScroller.SetPosition(m_nVScrollPos);
+            m_hScroller.BeginDrag(dNow, point.x);
+            m_vScroller.BeginDrag(dNow, point.y);
+            StartFrameTimer();
+        }
+    }
+    else if (m_vScroller.IsDragging())
+    {
+        m_hScroller.DragTo(dNow, point.x);
+        m_vScroller.DragTo(dNow, point.y);
+    }
+}
+
+/**
+ * @brief マウス左ボタンの解放を処理します。
+ */
+void CKineticScrollHost::OnLButtonUp(CPoint point)
+{
+    if (m_vScroller.IsDragging())
+    {
+        double dNow = CKineticScroller::NowMs();
+        m_hScroller.DragTo(dNow, point.x);
+        m_vScroller.DragTo(dNow, point.y);
+    }
+    // キャプチャの解放により OnCaptureChanged でドラッグが終了する
+    if (CWnd::GetCapture() == m_pHost)
+    {
+        ::ReleaseCapture();
+    }
+}
+
+/**
+ * @brief マウスキャプチャの喪失を処理します。
+ */
+void CKineticScrollHost::OnCaptureChanged()
+{
+    m_bDragPending = FALSE;
+    if (m_vScroller.IsDragging())
+    {
+        double dNow = CKineticScroller::NowMs();
+        m_hScroller.EndDrag(dNow);
+        m_vScroller.EndDrag(dNow);
+        StartFrameTimer();
+    }
+}
+
+/**
+ * @brief タイマーイベントを処理します。
+ */
+BOOL CKineticScrollHost::OnTimer(UINT_PTR nIDEvent)
+{
+    if (nIDEvent != m_nTimerId)
+        return FALSE;
+
+    double dNow = CKineticScroller::NowMs();
+    BOOL bAnimating = FALSE;
+    int nHPos = m_nHScrollPos;
+    int nVPos = m_nVScrollPos;
+    if (m_hScroller.IsAnimating())
+    {
+        bAnimating |= m_hScroller.Advance(dNow);
+        nHPos = (int)(m_hScroller.GetPosition() + 0.5);
+    }
+    if (m_vScroller.IsAnimating())
+    {
+        bAnimating |= m_vScroller.Advance(dNow);
+        nVPos = (int)(m_vScroller.GetPosition() + 0.5);
+    }
+    ScrollTo(nHPos, nVPos);
+
+    if (!bAnimating)
+    {
+        m_pHost->KillTimer(m_nTimerId);
+        m_bFrameTimer = FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,146 @@
+﻿/**
+ * @file KineticScrollHost.h
+ * @brief スクロール可能なダイアログのスクロール位置・スクロールバー・慣性スクロールをまとめて扱うクラスの宣言
+ * @details ダイアログの内容全体を ScrollWindow で移動する方式のスクロールについて、
+ * スクロールバーの操作、ホイールの滑らかな追従、背景のドラッグと指を離した後の慣性 (CKineticScroller) を扱います。
+ * 入力イベントでは位置の計算だけを行い、描画はフレームタイマーの周期でまとめて行います。
+ * ホストのダイアログは、該当するメッセージハンドラからこのクラスの同名の関数を呼び出すだけで済みます。
+ */
+#pragma once
+
+#include "KineticScroller.h"
+
+/**
+ * @class CKineticScrollHost
+ * @brief ホストウィンドウの内容のスクロールと慣性スクロールを管理するクラス
+ * @details スクロール位置はホストウィンドウのスクロールバーと同じピクセル単位で保持します。
+ * フレームタイマーはホストウィンドウの SetTimer で作るため、ホストの WM_TIMER から OnTimer() を呼び出してください。
+ */
+class CKineticScrollHost
+{
+public:
+    /**
+     * @brief コンストラクタ
+     * @param[in] nTimerId フレームタイマーのID (ホストの他のタイマーと重ならない値)
+     * @param[in] nLineAmount スクロールバーの矢印1回、およびホイール1ノッチあたりのスクロール量 (ピクセル)
+     */
+    CKineticScrollHost(UINT_PTR nTimerId, int nLineAmount);
+
+    CKineticScrollHost(const CKineticScrollHost &) = delete;
+    CKineticScrollHost &operator=(const CKineticScrollHost &) = delete;
+
+    /**
+     * @brief ホストウィンドウを設定します。
+     * @param[in] pHost 内容をスクロールするウィンドウ
+     */
+    void Attach(CWnd *pHost) { m_pHost = pHost; }
+
+    /**
+     * @brief 内容全体の大きさを設定し、スクロール位置を先頭に戻します。
+     * @param[in] nWidth 内容全体の幅
+     * @param[in] nHeight 内容全体の高さ
+     */
+    void SetContentSize(int nWidth, int nHeight);
+
+    /// @brief 現在の水平スクロール位置を返します。
+    int GetHPos() const { return m_nHScrollPos; }
+    /// @brief 現在の垂直スクロール位置を返します。
+    int GetVPos() const { return m_nVScrollPos; }
+
+    /**
+     * @brief スクロールバーの情報をホストウィンドウの大きさに合わせて更新します (WM_SIZE と初期化時)。
+     * @details 内容全体の大きさとクライアント領域の大きさを比較し、スクロールバーの表示/非表示、範囲、ページサイズを設定します。
+     */
+    void UpdateScrollBars();
+
+    /**
+     * @brief スクロールバーの操作を処理します (WM_HSCROLL/WM_VSCROLL)。
+     * @details その方向の慣性スクロールは止め、スクロールバーの操作を優先します。
+     * @param[in] nBar SB_HORZ または SB_VERT
+     * @param[in] nSBCode スクロールバーのコード
+     * @param[in] nPos スクロールボックスの位置
+     */
+    void OnScroll(int nBar, UINT nSBCode, UINT nPos);
+
+    /**
+     * @brief 指定した矩形が完全に表示されるようにスクロールします。
+     * @details 進行中の慣性スクロールは止めます。
+     * @param[in] rect 表示させる矩形 (ホストのクライアント座標、スクロール後の見た目上の位置)
+     */
+    void EnsureVisible(const CRect &rect);
+
+    /**
+     * @brief 指定したスクロール位置までホストウィンドウの内容を移動します。
+     * @param[in] nHPos 新しい水平スクロール位置 (範囲内にクランプされます)
+     * @param[in] nVPos 新しい垂直スクロール位置 (範囲内にクランプされます)
+     */
+    void ScrollTo(int nHPos, int nVPos);
+
+    /// @brief 進行中の慣性スクロールを停止し、フレームタイマーを止めます。
+    void Stop();
+
+    /**
+     * @brief ホイールの回転を処理します (WM_MOUSEWHEEL)。
+     * @details 回転量を端数も含めて蓄積し、目標位置へ滑らかに追従します。Shiftキーが押されている場合は水平方向です。
+     * @param[in] nFlags 修飾キーの状態
+     * @param[in] zDelta ホイールの回転量
+     * @return 常にTRUE
+     */
+    BOOL OnMouseWheel(UINT nFlags, short zDelta);
+
+    /**
+     * @brief ホストの背景の押下を処理します (WM_LBUTTONDOWN)。
+     * @details 慣性スクロールを止め、ドラッグによるスクロールに備えてマウスをキャプチャします。
+     * @param[in] point マウスカーソルのクライアント座標
+     */
+    void OnLButtonDown(CPoint point);
+
+    /**
+     * @brief マウスの移動を処理します (WM_MOUSEMOVE)。
+     * @details 押下位置からシステムのドラッグ閾値以上動いたら、縦横両方向のドラッグスクロールを開始します。
+     * @param[in] nFlags 修飾キーの状態
+     * @param[in] point マウスカーソルのクライアント座標
+     */
+    void OnMouseMove(UINT nFlags, CPoint point);
+
+    /**
+     * @brief マウス左ボタンの解放を処理します (WM_LBUTTONUP)。
+     * @details キャプチャを解放し、ドラッグの終了は OnCaptureChanged() で行います。
+     * @param[in] point マウスカーソルのクライアント座標
+     */
+    void OnLButtonUp(CPoint point);
+
+    /**
+     * @brief マウスキャプチャの喪失を処理します (WM_CAPTURECHANGED)。
+     * @details ドラッグを終了し、離した瞬間の速度で慣性スクロールを開始します。
+     */
+    void OnCaptureChanged();
+
+    /**
+     * @brief タイマーイベントを処理します (WM_TIMER)。
+     * @details フレームタイマーの周期で縦横の慣性スクロールを進め、画素単位の位置が変わった場合だけ内容を移動します。
+     * どちらの方向も停止したらタイマーを止めます。
+     * @param[in] nIDEvent タイマーID
+     * @return フレームタイマーのイベントであればTRUE (ホストの他のタイマーはFALSE)
+     */
+    BOOL OnTimer(UINT_PTR nIDEvent);
+
+private:
+    /// @brief 慣性スクロールの範囲を、内容全体とクライアント領域の大きさに合わせて更新します。
+    void UpdateScrollerRanges();
+    /// @brief フレームタイマーを開始します (動作中なら何もしません)。
+    void StartFrameTimer();
+
+    CWnd *m_pHost;                 ///< 内容をスクロールするウィンドウ
+    const UINT_PTR m_nTimerId;     ///< フレームタイマーのID
+    const int m_nLineAmount;       ///< 矢印1回・ホイール1ノッチあたりのスクロール量
+    int m_nTotalWidth;             ///< 内容全体の幅
+    int m_nTotalHeight;            ///< 内容全体の高さ
+    int m_nHScrollPos;             ///< 現在の水平スクロール位置
+    int m_nVScrollPos;             ///< 現在の垂直スクロール位置
+    CKineticScroller m_hScroller;  ///< 水平方向の慣性スクロールの計算エンジン
+    CKineticScroller m_vScroller;  ///< 垂直方向の慣性スクロールの計算エンジン
+    BOOL m_bDragPending;           ///< 背景を押下し、ドラッグとみなす移動量に達するのを待っている状態か
+    CPoint m_ptDragStart;          ///< ドラッグ判定の基準となる押下位置
+    BOOL m_bFrameTimer;            ///< フレームタイマーが動作中か
+};
@@ -0,0 +1,243 @@
+﻿/**
+ * @file KineticScroller.cpp
+ * @brief タッチ操作向けの慣性スクロール (キネティックスクロール) 計算エンジンの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "KineticScroller.h"
+
+#include <chrono>
+#include <cmath>
+
+/**
+ * @brief CKineticScrollerクラスのコンストラクタ
+ */
+CKineticScroller::CKineticScroller()
+    : m_mode(MODE_IDLE), m_dPos(0.0), m_dMax(0.0), m_dVelocity(0.0),
+      m_dDragStartPos(0.0), m_dDragStartCoord(0.0), m_samples(), m_nSampleHead(0), m_nSampleCount(0),
+      m_dAnimStartTime(0.0), m_dAnimStartPos(0.0), m_dFlingVelocity(0.0), m_dWheelTarget(0.0)
+{
+}
+
+/**
+ * @brief 単調増加する現在時刻 (ミリ秒) を返します。
+ */
+double CKineticScroller::NowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 値を 0 ～ m_dMax にクランプします。
+ */
+double CKineticScroller::Clamp(double dPos) const
+{
+    if (dPos < 0.0)
+        return 0.0;
+    if (dPos > m_dMax)
+        return m_dMax;
+    return dPos;
+}
+
+/**
+ * @brief スクロール可能な範囲を設定します。
+ */
+void CKineticScroller::SetRange(double dMax)
+{
+    m_dMax = (dMax > 0.0) ? dMax : 0.0;
+    m_dPos = Clamp(m_dPos);
+    m_dWheelTarget = Clamp(m_dWheelTarget);
+}
+
+/**
+ * @brief 位置を直接設定し、進行中のアニメーションを停止します。
+ */
+void CKineticScroller::SetPosition(double dPos)
+{
+    m_dPos = Clamp(dPos);
+    Stop();
+}
+
+/**
+ * @brief 進行中の動作をすべて停止します。
+ */
+void CKineticScroller::Stop()
+{
+    m_mode = MODE_IDLE;
+    m_dVelocity = 0.0;
+    m_nSampleCount = 0;
+}
+
+/**
+ * @brief ドラッグ中の速度サンプルを記録します。
+ */
+void CKineticScroller::AddSample(double dTimeMs, double dPos)
+{
+    m_samples[m_nSampleHead].dTimeMs = dTimeMs;
+    m_samples[m_nSampleHead].dPos = dPos;
+    m_nSampleHead = (m_nSampleHead + 1) % MAX_SAMPLES;
+    if (m_nSampleCount < MAX_SAMPLES)
+        ++m_nSampleCount;
+}
+
+/**
+ * @brief 直近のサンプルから速度を推定します。
+ * @details dVelocityWindowMs 以内のサンプルに対して位置 = a + v * 時刻 の直線を最小二乗法で当てはめます。
+ * 入力イベントの時刻の揺らぎに対して、最初と最後の2点だけを使うより安定します。
+ */
+double CKineticScroller::EstimateVelocity(double dTimeMs) const
+{
+    double sumT = 0.0, sumP = 0.0, sumTT = 0.0, sumTP = 0.0;
+    int n = 0;
+    for (int i = 0; i < m_nSampleCount; ++i)
+    {
+        const Sample &s = m_samples[(m_nSampleHead - 1 - i + MAX_SAMPLES) % MAX_SAMPLES];
+        const double t = s.dTimeMs - dTimeMs; // 原点を現在時刻にずらして桁落ちを防ぐ
+        if (-t > m_params.dVelocityWindowMs)
+            break;
+        sumT += t;
+        sumP += s.dPos;
+        sumTT += t * t;
+        sumTP += t * s.dPos;
+        ++n;
+    }
+    if (n < 2)
+        return 0.0;
+    const double denom = n * sumTT - sumT * sumT;
+    if (denom <= 1e-9)
+        return 0.0;
+    return (n * sumTP - sumT * sumP) / denom;
+}
+
+/**
+ * @brief ドラッグを開始します。
+ */
+void CKineticScroller::BeginDrag(double dTimeMs, double dCoord)
+{
+    Stop();
+    m_mode = MODE_DRAG;
+    m_dDragStartPos = m_dPos;
+    m_dDragStartCoord = dCoord;
+    AddSample(dTimeMs, m_dPos);
+}
+
+/**
+ * @brief ドラッグ中のポインタ移動を反映します。
+ */
+void CKineticScroller::DragTo(double dTimeMs, double dCoord)
+{
+    if (m_mode != MODE_DRAG)
+        return;
+    // 速度は範囲外に出た分も含めた指の動きから推定し、位置はクランプする
+    const double dRaw = m_dDragStartPos + (m_dDragStartCoord - dCoord);
+    AddSample(dTimeMs, dRaw);
+    m_dPos = Clamp(dRaw);
+}
+
+/**
+ * @brief ドラッグを終了し、必要であればフリングを開始します。
+ */
+void CKineticScroller::EndDrag(double dTimeMs)
+{
+    if (m_mode != MODE_DRAG)
+        return;
+
+    double v = EstimateVelocity(dTimeMs);
+    m_nSampleCount = 0;
+    if (v > m_params.dMaxFlingVelocity)
+        v = m_params.dMaxFlingVelocity;
+    else if (v < -m_params.dMaxFlingVelocity)
+        v = -m_params.dMaxFlingVelocity;
+
+    // 速度が小さい場合や、既に端に張り付いていてその方向へ進む場合はフリングしない
+    const bool bBlocked = (v < 0.0 && m_dPos <= 0.0) || (v > 0.0 && m_dPos >= m_dMax);
+    if (std::fabs(v) < m_params.dMinFlingVelocity || bBlocked)
+    {
+        m_mode = MODE_IDLE;
+        m_dVelocity = 0.0;
+        return;
+    }
+
+    m_mode = MODE_FLING;
+    m_dAnimStartTime = dTimeMs;
+    m_dAnimStartPos = m_dPos;
+    m_dFlingVelocity = v;
+    m_dVelocity = v;
+}
+
+/**
+ * @brief ホイール入力を加算します。
+ */
+void CKineticScroller::AddWheelDelta(double dTimeMs, int nDelta, double dPixelsPerNotch)
+{
+    if (m_mode == MODE_DRAG)
+        return; // ドラッグ中は指の位置を優先する
+
+    // 入力時刻まで進めてから、追従中でなければ現在位置から新しく追従を始める (フリング中なら現在位置で止める)
+    Advance(dTimeMs);
+    if (m_mode != MODE_WHEEL)
+        m_dWheelTarget = m_dPos;
+
+    // ホイールを奥 (正) に回すと上方向、つまり位置は減少する
+    m_dWheelTarget = Clamp(m_dWheelTarget - static_cast<double>(nDelta) / WHEEL_NOTCH * dPixelsPerNotch);
+    m_mode = MODE_WHEEL;
+    m_dAnimStartTime = dTimeMs;
+    m_dAnimStartPos = m_dPos;
+    m_dVelocity = 0.0;
+
+    if (std::fabs(m_dWheelTarget - m_dPos) < m_params.dSnapDistance)
+    {
+        m_dPos = m_dWheelTarget;
+        m_mode = MODE_IDLE;
+    }
+}
+
+/**
+ * @brief 指定時刻まで状態を進め、位置を更新します。
+ * @details フリングは p(t) = p0 + v0 τ (1 - e^(-t/τ))、ホイール追従は
+ * p(t) = 目標 - (目標 - p0) e^(-t/τw) を解析的に評価します。
+ * どちらも単調に収束するため、目標や範囲の端を越えて行き過ぎることはありません。
+ */
+bool CKineticScroller::Advance(double dTimeMs)
+{
+    const double dt = dTimeMs - m_dAnimStartTime;
+    switch (m_mode)
+    {
+    case MODE_FLING:
+    {
+        if (dt <= 0.0)
+            return true;
+        const double tau = m_params.dDecelTimeMs;
+        const double decay = std::exp(-dt / tau);
+        m_dVelocity = m_dFlingVelocity * decay;
+        const double dRaw = m_dAnimStartPos + m_dFlingVelocity * tau * (1.0 - decay);
+        m_dPos = Clamp(dRaw);
+
+        // 範囲の端に到達するか、十分に減速したら停止
+        if (dRaw != m_dPos || std::fabs(m_dVelocity) < m_params.dStopVelocity)
+        {
+            m_mode = MODE_IDLE;
+            m_dVelocity = 0.0;
+        }
+        break;
+    }
+    case MODE_WHEEL:
+    {
+        if (dt <= 0.0)
+            return true;
+        const double decay = std::exp(-dt / m_params.dWheelTimeMs);
+        m_dPos = Clamp(m_dWheelTarget - (m_dWheelTarget - m_dAnimStartPos) * decay);
+        if (std::fabs(m_dWheelTarget - m_dPos) < m_params.dSnapDistance)
+        {
+            m_dPos = m_dWheelTarget;
+            m_mode = MODE_IDLE;
+        }
+        break;
+    }
+    case MODE_DRAG:
+    case MODE_IDLE:
+    default:
+        break;
+    }
+    return IsAnimating();
+}
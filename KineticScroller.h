@@ -0,0 +1,171 @@
+﻿/**
+ * @file KineticScroller.h
+ * @brief タッチ操作向けの慣性スクロール (キネティックスクロール) 計算エンジンのクラス宣言
+ * @details ドラッグ中の速度追跡、指を離した後の減速 (フリング)、ホイール入力の滑らかな追従を
+ * 1軸分のスクロール位置 (ピクセル、小数を含む) として計算します。
+ * 時刻は呼び出し側が与えるため、同じ入力列に対して常に同じ結果を返します (決定的)。
+ * ウィンドウ側はフレームタイマーの周期でのみ Advance() を呼び出して描画することで、
+ * 入力イベントがどれだけ多くても描画は1フレームに1回にまとめられます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+/**
+ * @class CKineticScroller
+ * @brief 1軸分の慣性スクロールの物理計算を行うクラス
+ * @details 位置は 0 ～ GetRange() の範囲に常にクランプされ、範囲を越えて行き過ぎることはありません。
+ * フリングは v(t) = v0 * exp(-t / τ) の指数減速を解析的に評価するため、
+ * フレーム間隔が揺らいでも同じ時刻には同じ位置になります。
+ */
+class CKineticScroller
+{
+public:
+    /**
+     * @struct Params
+     * @brief 物理モデルの調整パラメータ (時間はミリ秒、速度はピクセル/ミリ秒)
+     */
+    struct Params
+    {
+        double dDecelTimeMs;        ///< フリング減速の時定数 τ
+        double dMinFlingVelocity;   ///< これ未満の離し速度ではフリングを開始しない
+        double dMaxFlingVelocity;   ///< フリング初速の上限
+        double dStopVelocity;       ///< フリングを停止とみなす速度
+        double dVelocityWindowMs;   ///< 離し速度の推定に使う直近のサンプル時間幅
+        double dWheelTimeMs;        ///< ホイール追従の時定数
+        double dSnapDistance;       ///< ホイール追従で目標に到達したとみなす距離
+
+        Params()
+            : dDecelTimeMs(325.0), dMinFlingVelocity(0.05), dMaxFlingVelocity(8.0), dStopVelocity(0.02),
+              dVelocityWindowMs(100.0), dWheelTimeMs(50.0), dSnapDistance(0.5)
+        {
+        }
+    };
+
+    /// @brief 現在の動作モード
+    enum Mode
+    {
+        MODE_IDLE,  ///< 停止中
+        MODE_DRAG,  ///< 指 (マウス) で直接ドラッグ中
+        MODE_FLING, ///< 指を離した後の慣性で減速中
+        MODE_WHEEL  ///< ホイール入力の目標位置へ追従中
+    };
+
+    /// @brief ホイール1ノッチ分の回転量 (Win32 の WHEEL_DELTA と同値)
+    static constexpr int WHEEL_NOTCH = 120;
+    /// @brief フレームタイマーの推奨周期 (ミリ秒、約60fps)
+    static constexpr int FRAME_INTERVAL_MS = 16;
+
+    CKineticScroller();
+
+    /// @brief 物理パラメータを設定します。
+    void SetParams(const Params &params) { m_params = params; }
+    /// @brief 現在の物理パラメータを取得します。
+    const Params &GetParams() const { return m_params; }
+
+    /**
+     * @brief スクロール可能な範囲 (0 ～ dMax) を設定します。現在位置は範囲内にクランプされます。
+     * @param[in] dMax 最大スクロール位置 (0未満は0として扱います)
+     */
+    void SetRange(double dMax);
+    /// @brief 最大スクロール位置を取得します。
+    double GetRange() const { return m_dMax; }
+
+    /**
+     * @brief 位置を直接設定し、進行中のアニメーションを停止します。
+     * @param[in] dPos 新しい位置 (範囲内にクランプされます)
+     */
+    void SetPosition(double dPos);
+    /// @brief 現在位置を取得します (最後の Advance() または入力時点の値)。
+    double GetPosition() const { return m_dPos; }
+
+    /// @brief 現在の速度 (ピクセル/ミリ秒) を取得します。
+    double GetVelocity() const { return m_dVelocity; }
+    /// @brief 現在の動作モードを取得します。
+    Mode GetMode() const { return m_mode; }
+    /// @brief ドラッグ中かを返します。
+    bool IsDragging() const { return m_mode == MODE_DRAG; }
+    /// @brief フレーム更新が必要な状態 (停止中以外) かを返します。
+    bool IsAnimating() const { return m_mode != MODE_IDLE; }
+
+    /**
+     * @brief ドラッグを開始します。進行中のフリングやホイール追従は停止します。
+     * @param[in] dTimeMs 入力時刻
+     * @param[in] dCoord ポインタの座標 (スクロール軸方向)
+     */
+    void BeginDrag(double dTimeMs, double dCoord);
+
+    /**
+     * @brief ドラッグ中のポインタ移動を反映します。
+     * @details ポインタが下 (右) に動くと内容も一緒に動くため、スクロール位置は減少します。
+     * @param[in] dTimeMs 入力時刻
+     * @param[in] dCoord ポインタの座標 (スクロール軸方向)
+     */
+    void DragTo(double dTimeMs, double dCoord);
+
+    /**
+     * @brief ドラッグを終了し、直近の速度が十分であればフリングを開始します。
+     * @param[in] dTimeMs 入力時刻
+     */
+    void EndDrag(double dTimeMs);
+
+    /**
+     * @brief ホイール入力を加算します。
+     * @details 1ノッチ未満の高分解能な回転量も端数のまま蓄積し、目標位置へ滑らかに追従します。
+     * 追従中に追加の入力があれば目標位置に加算されます (範囲内にクランプ)。
+     * @param[in] dTimeMs 入力時刻
+     * @param[in] nDelta ホイールの回転量 (正で上方向、WHEEL_NOTCH で1ノッチ)
+     * @param[in] dPixelsPerNotch 1ノッチあたりのスクロール量
+     */
+    void AddWheelDelta(double dTimeMs, int nDelta, double dPixelsPerNotch);
+
+    /// @brief 進行中の動作をすべて停止し、現在位置に留まります。
+    void Stop();
+
+    /**
+     * @brief 指定時刻まで状態を進め、位置を更新します。
+     * @details フレームタイマーから1フレームに1回呼び出すことを想定しています。
+     * @param[in] dTimeMs 現在時刻
+     * @return 引き続きフレーム更新が必要な場合はtrue
+     */
+    bool Advance(double dTimeMs);
+
+    /// @brief 単調増加する現在時刻 (ミリ秒) を返します。実機での入力時刻の取得に使用します。
+    static double NowMs();
+
+private:
+    /// @brief 値を 0 ～ m_dMax にクランプします。
+    double Clamp(double dPos) const;
+    /// @brief ドラッグ中の速度サンプルを記録します。
+    void AddSample(double dTimeMs, double dPos);
+    /// @brief 直近のサンプルから速度を推定します (最小二乗法)。
+    double EstimateVelocity(double dTimeMs) const;
+
+    /// @brief 速度推定用に保持するサンプル数
+    static constexpr int MAX_SAMPLES = 16;
+
+    /// @brief 速度推定用のサンプル (時刻と位置)
+    struct Sample
+    {
+        double dTimeMs;
+        double dPos;
+    };
+
+    Params m_params;   ///< 物理パラメータ
+    Mode m_mode;       ///< 現在の動作モード
+    double m_dPos;     ///< 現在位置
+    double m_dMax;     ///< 最大スクロール位置
+    double m_dVelocity; ///< 現在の速度 (ピクセル/ミリ秒)
+
+    // --- ドラッグ ---
+    double m_dDragStartPos;   ///< ドラッグ開始時の位置
+    double m_dDragStartCoord; ///< ドラッグ開始時のポインタ座標
+    Sample m_samples[MAX_SAMPLES]; ///< 速度推定用サンプルのリングバッファ
+    int m_nSampleHead;        ///< 次にサンプルを書き込む位置
+    int m_nSampleCount;       ///< 有効なサンプル数
+
+    // --- フリング / ホイール追従の起点 ---
+    double m_dAnimStartTime;  ///< アニメーション開始時刻
+    double m_dAnimStartPos;   ///< アニメーション開始位置
+    double m_dFlingVelocity;  ///< フリングの初速
+    double m_dWheelTarget;    ///< ホイール追従の目標位置
+};
@@ -0,0 +1,235 @@
+﻿/**
+ * @file LayerCompositor.cpp
+ * @brief 重なったレイヤーの合成の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "LayerCompositor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace
+{
+std::atomic<std::uint64_t> s_nFrames{0};      ///< フレーム数
+std::atomic<std::uint64_t> s_nDirtyArea{0};   ///< 無効領域の面積の合計
+std::atomic<std::uint64_t> s_nPaintedArea{0}; ///< 描画した面積の合計
+std::atomic<std::uint64_t> s_nNaiveArea{0};   ///< 隠れた部分も描画した場合の面積の合計
+}
+
+/**
+ * @brief CLayerCompositorクラスのコンストラクタ
+ */
+CLayerCompositor::CLayerCompositor() : m_nNextId(0), m_bGeometryChanged(false), m_lastFrame{}
+{
+}
+
+/**
+ * @brief レイヤーを追加します。
+ * @details 同じ重なり順のレイヤーの上 (より大きい重なり順のレイヤーの下) に挿入します。
+ */
+CLayerCompositor::LayerId CLayerCompositor::AddLayer(const REGION_RECT &rect, int nZOrder)
+{
+    const auto it = std::upper_bound(m_layers.begin(), m_layers.end(), nZOrder,
+                                     [](int nZ, const LAYER &layer) { return nZ < layer.nZOrder; });
+    LAYER layer;
+    layer.nId = m_nNextId++;
+    layer.rect = rect;
+    layer.nZOrder = nZOrder;
+    layer.bVisible = true;
+    m_layers.insert(it, std::move(layer));
+    m_bGeometryChanged = true;
+    InvalidateRect(rect);
+    return m_nNextId - 1;
+}
+
+/**
+ * @brief レイヤーを削除します。
+ */
+void CLayerCompositor::RemoveLayer(LayerId nLayer)
+{
+    const auto it = std::find_if(m_layers.begin(), m_layers.end(), [nLayer](const LAYER &layer) { return layer.nId == nLayer; });
+    if (it == m_layers.end())
+        return;
+    if (it->bVisible)
+        InvalidateRect(it->rect);
+    m_layers.erase(it);
+    m_bGeometryChanged = true;
+}
+
+/**
+ * @brief レイヤーの矩形を設定します。
+ */
+void CLayerCompositor::SetLayerRect(LayerId nLayer, const REGION_RECT &rect)
+{
+    LAYER *pLayer = Find(nLayer);
+    if (pLayer == nullptr)
+        return;
+    if (pLayer->rect.left == rect.left && pLayer->rect.top == rect.top && pLayer->rect.right == rect.right &&
+        pLayer->rect.bottom == rect.bottom)
+        return;
+    if (pLayer->bVisible)
+    {
+        InvalidateRect(pLayer->rect);
+        InvalidateRect(rect);
+    }
+    pLayer->rect = rect;
+    m_bGeometryChanged = true;
+}
+
+/**
+ * @brief レイヤーの表示状態を設定します。
+ */
+void CLayerCompositor::SetLayerVisible(LayerId nLayer, bool bVisible)
+{
+    LAYER *pLayer = Find(nLayer);
+    if (pLayer == nullptr || pLayer->bVisible == bVisible)
+        return;
+    pLayer->bVisible = bVisible;
+    InvalidateRect(pLayer->rect);
+    m_bGeometryChanged = true;
+}
+
+/**
+ * @brief レイヤーの矩形を返します。
+ */
+REGION_RECT CLayerCompositor::GetLayerRect(LayerId nLayer) const
+{
+    const LAYER *pLayer = Find(nLayer);
+    return pLayer != nullptr ? pLayer->rect : REGION_RECT{0, 0, 0, 0};
+}
+
+/**
+ * @brief レイヤーの見える領域を返します。
+ */
+const CRectRegion &CLayerCompositor::GetVisibleRegion(LayerId nLayer)
+{
+    UpdateVisibleRegions();
+    const LAYER *pLayer = Find(nLayer);
+    return pLayer != nullptr ? pLayer->visible : m_empty;
+}
+
+/**
+ * @brief 無効領域を下のレイヤーから順に、見える部分だけ描画させます。
+ * @details 各レイヤーの見える領域は互いに重ならないため、描画した面積の合計は
+ * 無効領域のうちレイヤーが覆う部分の面積と等しくなります (オーバードロー率1.0)。
+ */
+COMPOSITOR_FRAME_STATS CLayerCompositor::Compose(const PaintFunc &paint)
+{
+    UpdateVisibleRegions();
+    COMPOSITOR_FRAME_STATS stats = {};
+    if (!m_dirty.IsEmpty())
+    {
+        CRectRegion covered;
+        for (const LAYER &layer : m_layers)
+        {
+            if (!layer.bVisible)
+                continue;
+            CRectRegion full(layer.rect);
+            full.Intersect(m_dirty);
+            stats.nNaiveArea += full.GetArea();
+            covered.Union(full);
+
+            CRectRegion clip = layer.visible;
+            clip.Intersect(m_dirty);
+            if (clip.IsEmpty())
+                continue;
+            ++stats.nLayersPainted;
+            stats.nPaintedArea += clip.GetArea();
+            if (paint)
+                paint(layer.nId, clip);
+        }
+        stats.nDirtyArea = covered.GetArea();
+        m_dirty.Clear();
+    }
+
+    m_lastFrame = stats;
+    s_nFrames.fetch_add(1, std::memory_order_relaxed);
+    s_nDirtyArea.fetch_add(stats.nDirtyArea, std::memory_order_relaxed);
+    s_nPaintedArea.fetch_add(stats.nPaintedArea, std::memory_order_relaxed);
+    s_nNaiveArea.fetch_add(stats.nNaiveArea, std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief プロセス全体の累計を返します。
+ */
+CLayerCompositor::Totals CLayerCompositor::GetTotals()
+{
+    Totals totals;
+    totals.nFrames = s_nFrames.load(std::memory_order_relaxed);
+    totals.nDirtyArea = s_nDirtyArea.load(std::memory_order_relaxed);
+    totals.nPaintedArea = s_nPaintedArea.load(std::memory_order_relaxed);
+    totals.nNaiveArea = s_nNaiveArea.load(std::memory_order_relaxed);
+    return totals;
+}
+
+/**
+ * @brief プロセス全体の累計を0に戻します。
+ */
+void CLayerCompositor::ResetTotals()
+{
+    s_nFrames.store(0, std::memory_order_relaxed);
+    s_nDirtyArea.store(0, std::memory_order_relaxed);
+    s_nPaintedArea.store(0, std::memory_order_relaxed);
+    s_nNaiveArea.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief プロセス全体の累計を1行のテキストで返します。
+ */
+std::string CLayerCompositor::FormatStats()
+{
+    const Totals totals = GetTotals();
+    const double dDirty = totals.nDirtyArea > 0 ? static_cast<double>(totals.nDirtyArea) : 1.0;
+    char szLine[192];
+    std::snprintf(szLine, sizeof(szLine),
+                  "LayerCompositor: frames=%llu dirty-px=%llu painted-px=%llu overdraw=%.3f naive-overdraw=%.3f\n",
+                  static_cast<unsigned long long>(totals.nFrames), static_cast<unsigned long long>(totals.nDirtyArea),
+                  static_cast<unsigned long long>(totals.nPaintedArea), totals.nPaintedArea / dDirty, totals.nNaiveArea / dDirty);
+    return szLine;
+}
+
+/**
+ * @brief 識別子のレイヤーを探します。
+ */
+CLayerCompositor::LAYER *CLayerCompositor::Find(LayerId nLayer)
+{
+    for (LAYER &layer : m_layers)
+    {
+        if (layer.nId == nLayer)
+            return &layer;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 識別子のレイヤーを探します。
+ */
+const CLayerCompositor::LAYER *CLayerCompositor::Find(LayerId nLayer) const
+{
+    return const_cast<CLayerCompositor *>(this)->Find(nLayer);
+}
+
+/**
+ * @brief 必要であれば全てのレイヤーの見える領域を計算し直します。
+ * @details 上から順にたどり、それまでに見た表示中のレイヤーの矩形を差し引きます。
+ * 矩形の組が以前と同じであれば、差し引いた結果はキャッシュから得られます。
+ */
+void CLayerCompositor::UpdateVisibleRegions()
+{
+    if (!m_bGeometryChanged)
+        return;
+    m_bGeometryChanged = false;
+    m_occluders.clear();
+    for (auto it = m_layers.rbegin(); it != m_layers.rend(); ++it)
+    {
+        if (!it->bVisible)
+        {
+            it->visible.Clear();
+            continue;
+        }
+        it->visible = m_clipCache.GetClip(it->rect, m_occluders.data(), static_cast<int>(m_occluders.size()));
+        m_occluders.push_back(it->rect);
+    }
+}
@@ -0,0 +1,148 @@
+﻿/**
+ * @file LayerCompositor.h
+ * @brief 重なったレイヤー (ビュー) を、隠れていない部分だけ描画して合成するクラスの宣言
+ * @details レイヤーは矩形と重なり順 (Z順) を持ち、各レイヤーの見える領域は
+ * 「自分の矩形から、より上にある表示中のレイヤーの矩形を差し引いた領域」です。
+ * Compose() は、無効になった領域 (ダーティ領域) の中で、下のレイヤーから順に見える部分だけを描画させます。
+ * 同じピクセルを2回描画しないため、1フレームの描画量は無効領域の面積と等しくなります。
+ * フレームごとに、描画した面積と無効領域の面積の比 (オーバードロー率) と、
+ * 隠れた部分も描画した場合の比を記録し、プロセス全体の累計も保持します。
+ * 見える領域はレイヤーの矩形・Z順・表示状態が変わった場合だけ計算し直します。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "RectRegion.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @struct COMPOSITOR_FRAME_STATS
+ * @brief 1フレームの合成の集計 (面積はピクセル数)
+ */
+struct COMPOSITOR_FRAME_STATS
+{
+    std::uint32_t nLayersPainted; ///< 描画したレイヤーの数
+    std::uint64_t nDirtyArea;     ///< 無効領域のうちレイヤーが覆う部分の面積
+    std::uint64_t nPaintedArea;   ///< 描画した面積の合計
+    std::uint64_t nNaiveArea;     ///< 隠れた部分も描画した場合の面積の合計 (比較用)
+
+    /// @brief オーバードロー率 (描画した面積 / 無効領域の面積、重なりを描画しなければ1.0)
+    double GetOverdraw() const { return nDirtyArea > 0 ? static_cast<double>(nPaintedArea) / nDirtyArea : 0.0; }
+    /// @brief 隠れた部分も描画した場合のオーバードロー率
+    double GetNaiveOverdraw() const { return nDirtyArea > 0 ? static_cast<double>(nNaiveArea) / nDirtyArea : 0.0; }
+};
+
+/**
+ * @class CLayerCompositor
+ * @brief 重なったレイヤーの見える領域を求め、無効領域を下のレイヤーから順に描画させるクラス
+ * @details 座標は合成先 (ホストウィンドウのクライアント領域) の座標で扱います。
+ * 呼び出しはUIスレッドからのみ行ってください (累計回数の取得はどのスレッドからでも行えます)。
+ */
+class CLayerCompositor
+{
+public:
+    /// @brief レイヤーの識別子
+    using LayerId = int;
+    /// @brief 無効なレイヤーの識別子
+    static constexpr LayerId INVALID_LAYER = -1;
+
+    /**
+     * @brief レイヤーを描画する関数
+     * @param[in] nLayer レイヤー
+     * @param[in] clip 描画する領域 (見える領域と無効領域の共通部分、合成先の座標)
+     */
+    using PaintFunc = std::function<void(LayerId nLayer, const CRectRegion &clip)>;
+
+    /**
+     * @struct Totals
+     * @brief プロセス全体の合成の累計
+     */
+    struct Totals
+    {
+        std::uint64_t nFrames;      ///< フレーム数
+        std::uint64_t nDirtyArea;   ///< 無効領域の面積の合計
+        std::uint64_t nPaintedArea; ///< 描画した面積の合計
+        std::uint64_t nNaiveArea;   ///< 隠れた部分も描画した場合の面積の合計
+    };
+
+    CLayerCompositor();
+
+    /**
+     * @brief レイヤーを追加します。
+     * @param[in] rect 矩形
+     * @param[in] nZOrder 重なり順 (大きいほど上、同じ値なら後から追加したものが上)
+     * @return レイヤーの識別子
+     */
+    LayerId AddLayer(const REGION_RECT &rect, int nZOrder);
+    /// @brief レイヤーを削除します (覆っていた領域は無効になります)。
+    void RemoveLayer(LayerId nLayer);
+
+    /**
+     * @brief レイヤーの矩形を設定します。
+     * @details 矩形が変わった場合だけ、前後の矩形を無効にして見える領域を計算し直します。
+     */
+    void SetLayerRect(LayerId nLayer, const REGION_RECT &rect);
+    /// @brief レイヤーの表示状態を設定します (非表示のレイヤーは描画せず、下のレイヤーも隠しません)。
+    void SetLayerVisible(LayerId nLayer, bool bVisible);
+
+    /// @brief レイヤーの矩形を返します。
+    REGION_RECT GetLayerRect(LayerId nLayer) const;
+    /// @brief レイヤーの見える領域を返します (非表示または登録のないレイヤーは空)。
+    const CRectRegion &GetVisibleRegion(LayerId nLayer);
+
+    /// @brief 領域を無効にします (次の Compose() で描画します)。
+    void Invalidate(const CRectRegion &region) { m_dirty.Union(region); }
+    /// @brief 矩形を無効にします。
+    void InvalidateRect(const REGION_RECT &rect) { m_dirty.Union(CRectRegion(rect)); }
+    /// @brief 無効領域を返します。
+    const CRectRegion &GetDirtyRegion() const { return m_dirty; }
+    /// @brief 無効領域を空にします (無効領域を呼び出し側で管理する場合に、配置の変更で無効になった領域を捨てます)。
+    void ClearDirty() { m_dirty.Clear(); }
+
+    /**
+     * @brief 無効領域を下のレイヤーから順に、見える部分だけ描画させ、無効領域を空にします。
+     * @param[in] paint レイヤーを描画する関数
+     * @return このフレームの集計
+     */
+    COMPOSITOR_FRAME_STATS Compose(const PaintFunc &paint);
+
+    /// @brief 直前のフレームの集計を返します。
+    const COMPOSITOR_FRAME_STATS &GetLastFrame() const { return m_lastFrame; }
+
+    /// @brief プロセス全体の累計を返します。
+    static Totals GetTotals();
+    /// @brief プロセス全体の累計を0に戻します。
+    static void ResetTotals();
+    /// @brief プロセス全体の累計を1行のテキストで返します (診断情報の書き出し用)。
+    static std::string FormatStats();
+
+private:
+    /// @brief レイヤー
+    struct LAYER
+    {
+        LayerId nId;         ///< 識別子
+        REGION_RECT rect;    ///< 矩形
+        int nZOrder;         ///< 重なり順
+        bool bVisible;       ///< 表示中か
+        CRectRegion visible; ///< 見える領域
+    };
+
+    /// @brief 識別子のレイヤーを探します (なければnullptr)。
+    LAYER *Find(LayerId nLayer);
+    const LAYER *Find(LayerId nLayer) const;
+    /// @brief 必要であれば全てのレイヤーの見える領域を計算し直します。
+    void UpdateVisibleRegions();
+
+    std::vector<LAYER> m_layers;           ///< レイヤー (下から順)
+    LayerId m_nNextId;                     ///< 次に割り当てる識別子
+    bool m_bGeometryChanged;               ///< 見える領域の計算し直しが必要か
+    CRectRegion m_dirty;                   ///< 無効領域
+    CClipRegionCache m_clipCache;          ///< 見える領域のキャッシュ (矩形の組ごと)
+    std::vector<REGION_RECT> m_occluders;  ///< 上にあるレイヤーの矩形の作業領域
+    COMPOSITOR_FRAME_STATS m_lastFrame;    ///< 直前のフレームの集計
+    CRectRegion m_empty;                   ///< 空の領域 (登録のないレイヤーの見える領域)
+};
@@ -6,11 +6,49 @@
 #include "framework.h"
 #include "MFCApplication4.h"
 #include "MFCApplication4Dlg.h"
+#include "InputTrace.h"
+#include "PaintMetrics.h"
+#include "FontMetricsCache.h"
+#include "GdiResourceCache.h"
+#include "LayerCompositor.h"
+
+#include <ShlObj.h>
+#include <vector>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+namespace
+{
+    /// @brief タッチ・ペン操作から合成されたマウスメッセージを示す GetMessageExtraInfo() の値 (上位24ビット)
+    const DWORD MI_WP_SIGNATURE = 0xFF515700;
+    /// @brief GetMessageExtraInfo() の値のうち、合成元の判定に使う部分のマスク
+    const DWORD SIGNATURE_MASK = 0xFFFFFF00;
+
+    /**
+     * @brief 診断用のテキストを一時フォルダのファイルに書き出します (既存のファイルは上書きします)。
+     * @param[in] pszFileName 一時フォルダ内のファイル名
+     * @param[in] text 書き出す内容
+     */
+    void WriteDiagnosticsFile(LPCTSTR pszFileName, const std::string &text)
+    {
+        TCHAR szTempPath[MAX_PATH] = {};
+        if (::GetTempPath(MAX_PATH, szTempPath) == 0)
+            return;
+        CString strPath(szTempPath);
+        strPath += pszFileName;
+
+        CFile file;
+        if (file.Open(strPath, CFile::modeCreate | CFile::modeWrite | CFile::shareDenyWrite))
+        {
+            file.Write(text.data(), static_cast<UINT>(text.size()));
+            file.Close();
+            TRACE(_T("診断情報を書き出しました: %s\n"), (LPCTSTR)strPath);
+        }
+    }
+}
+
 // CMFCApplication4App
 
 // BEGIN_MESSAGE_MAPブロック
@@ -25,6 +63,10 @@ END_MESSAGE_MAP()
  * @brief CMFCApplication4Appクラスのコンストラクタ
  */
 CMFCApplication4App::CMFCApplication4App()
+    : m_triggerEngine([this](std::uint32_t nDelayMs, std::function<void()> func) {
+          return m_taskScheduler.ScheduleAfter(nDelayMs, std::move(func));
+      }),
+      m_commandRegistry(m_taskScheduler, COMMAND_ROW_COUNT, COMMAND_FUNCTION_COUNT)
 {
     // TODO: この位置に構築用コードを追加してください。
     // InitInstance内の重要な初期化処理をここに記述します。
@@ -55,6 +97,17 @@ BOOL CMFCApplication4App::InitInstance()
     // 設定が格納されるレジストリキーを設定します。
     SetRegistryKey(_T("Local AppWizard-Generated Applications"));
 
+    // 描画計測 (Diagnostics\PaintMetrics が0以外の場合のみ有効。無効時の計測箇所のコストはフラグの読み出しのみ)
+    CPaintMetrics::SetEnabled(GetProfileInt(_T("Diagnostics"), _T("PaintMetrics"), 0) != 0);
+    // 入力遅延トレース (Diagnostics\InputTrace が0以外の場合のみ有効)
+    CInputTrace::SetEnabled(GetProfileInt(_T("Diagnostics"), _T("InputTrace"), 0) != 0);
+    CInputTrace::SetThreadName("UI");
+
+    // 共有タスクスケジューラのワーカースレッドとタイマーを起動します (UIスレッドでの実行はメインダイアログが登録します)。
+    m_taskScheduler.Start();
+    RegisterCommands();
+    LoadInputHistory();
+
     // メインダイアログクラスのインスタンスを作成します。
     CMFCApplication4Dlg dlg;
     // アプリケーションのメインウィンドウポインタに、このダイアログを設定します。
@@ -100,23 +153,63 @@ BOOL CMFCApplication4App::InitInstance()
  */
 BOOL CMFCApplication4App::PreTranslateMessage(MSG *pMsg)
 {
-    // --- マウスクリック検出による「操作中」表示 ---
-    // マウスクリック関連のメッセージ（クライアント領域・非クライアント領域）を検出します。
-    if ((pMsg->message >= WM_LBUTTONDOWN && pMsg->message <= WM_MBUTTONDBLCLK) ||
-        (pMsg->message >= WM_NCLBUTTONDOWN && pMsg->message <= WM_NCMBUTTONDBLCLK))
+    // --- 入力遅延トレースのスパン開始 ---
+    // 入力の押下を起点とし、その後の処理と最初の描画までを1つのスパンとして記録します。
+    // WM_TOUCH / WM_POINTERDOWN の定義がない古いSDKの場合に備えて定義します。
+#ifndef WM_TOUCH
+#define WM_TOUCH 0x0240
+#endif
+#ifndef WM_POINTERDOWN
+#define WM_POINTERDOWN 0x0246
+#endif
+    if (CInputTrace::IsEnabled())
     {
-        // ボタンが「押された」瞬間のメッセージのみを対象とします。
-        if (pMsg->message == WM_LBUTTONDOWN || pMsg->message == WM_RBUTTONDOWN || pMsg->message == WM_MBUTTONDOWN ||
-            pMsg->message == WM_NCLBUTTONDOWN || pMsg->message == WM_NCRBUTTONDOWN || pMsg->message == WM_NCMBUTTONDOWN)
+        switch (pMsg->message)
         {
-            // メインウィンドウに通知メッセージを送信して、タイトルの変更を依頼します。
-            if (m_pMainWnd && m_pMainWnd->GetSafeHwnd())
-            {
-                m_pMainWnd->PostMessage(WM_APP_SHOW_OPERATION_STATUS, 0, 0);
-            }
+        case WM_LBUTTONDOWN:
+        case WM_RBUTTONDOWN:
+        case WM_MBUTTONDOWN:
+        case WM_NCLBUTTONDOWN:
+            // タッチから合成されたマウスメッセージはタッチとして扱う
+            CInputTrace::BeginInput(((static_cast<DWORD>(::GetMessageExtraInfo()) & SIGNATURE_MASK) == MI_WP_SIGNATURE)
+                                        ? CInputTrace::INPUT_TOUCH
+                                        : CInputTrace::INPUT_CLICK);
+            break;
+        case WM_KEYDOWN:
+        case WM_SYSKEYDOWN:
+            CInputTrace::BeginInput(CInputTrace::INPUT_KEY);
+            break;
+        case WM_TOUCH:
+        case WM_POINTERDOWN:
+            CInputTrace::BeginInput(CInputTrace::INPUT_TOUCH);
+            break;
+        default:
+            break;
         }
     }
 
+    // --- 入力の記録による「操作中」表示 ---
+    // ボタンやキーが「押された」瞬間のメッセージで最終入力時刻を更新します。
+    // メインダイアログへの通知はアイドル中の最初の入力でのみ行い、以降の判定はメインダイアログの周期処理に任せます。
+    if (pMsg->message == WM_LBUTTONDOWN || pMsg->message == WM_RBUTTONDOWN || pMsg->message == WM_MBUTTONDOWN ||
+        pMsg->message == WM_NCLBUTTONDOWN || pMsg->message == WM_NCRBUTTONDOWN || pMsg->message == WM_NCMBUTTONDOWN ||
+        pMsg->message == WM_KEYDOWN || pMsg->message == WM_SYSKEYDOWN)
+    {
+        if (m_activityTracker.NotifyInput())
+        {
+            m_uiDispatcher.PostEventCoalesced(OPERATION_INPUT_EVENT());
+        }
+    }
+
+    // --- 描画計測値・入力遅延トレースの書き出し (Ctrl+Shift+F12) ---
+    if (pMsg->message == WM_KEYDOWN && pMsg->wParam == VK_F12 &&
+        (::GetKeyState(VK_CONTROL) & 0x8000) && (::GetKeyState(VK_SHIFT) & 0x8000))
+    {
+        ExportPaintMetrics();
+        ExportInputTrace();
+        return TRUE;
+    }
+
     // --- 1. Alt+F4 と Alt+Space の無効化 ---
     // WM_SYSKEYDOWNは、Altキーが押されている状態で他のキーが押された場合に発生します。
     if (pMsg->message == WM_SYSKEYDOWN)
@@ -169,6 +262,138 @@ BOOL CMFCApplication4App::PreTranslateMessage(MSG *pMsg)
  */
 int CMFCApplication4App::ExitInstance()
 {
-    // TODO: ここで追加のクリーンアップ処理を行うことができます。
+    // 計測が有効な場合は、終了時点までの集計結果とトレースを書き出します。
+    ExportPaintMetrics();
+    ExportInputTrace();
+
+    // 実行中の機能に取り消しを要求し、未実行のタスクとタイマーを破棄してワーカースレッドを停止します。
+    m_commandRegistry.CancelAll();
+    m_taskScheduler.Shutdown();
+    // UIスレッドの実行先の解除後に終わった機能の終了処理を行い、実行中の表を空にします。
+    m_commandRegistry.FinishUnposted();
+
+    SaveInputHistory();
+
+    // 共有のソフトウェアキーボードを破棄します (通常はメインダイアログと一緒にウィンドウが破棄済みです)。
+    if (m_pSoftwareKeyboard && m_pSoftwareKeyboard->GetSafeHwnd() != nullptr)
+        m_pSoftwareKeyboard->DestroyWindow();
+    m_pSoftwareKeyboard.reset();
     return CWinApp::ExitInstance();
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 全てのエディットコントロールで共有するソフトウェアキーボードを取得します。
+ * @details グローバルオブジェクトの構築時ではなく、最初の呼び出しでオブジェクトを生成します。
+ * @return ソフトウェアキーボードへの参照
+ */
+CSoftwareKeyboardDlg &CMFCApplication4App::GetSoftwareKeyboard()
+{
+    if (!m_pSoftwareKeyboard)
+        m_pSoftwareKeyboard.reset(new CSoftwareKeyboardDlg());
+    return *m_pSoftwareKeyboard;
+}
+
+/**
+ * @brief 入力履歴のファイルのパスを求めます。
+ * @details 出力先は %LOCALAPPDATA%\MFCApplication4\InputHistory.dat です (フォルダがなければ作成します)。
+ * @return ファイルのパス (求められない場合は空文字列)
+ */
+CString CMFCApplication4App::GetInputHistoryPath() const
+{
+    TCHAR szAppData[MAX_PATH] = {};
+    if (FAILED(::SHGetFolderPath(nullptr, CSIDL_LOCAL_APPDATA, nullptr, SHGFP_TYPE_CURRENT, szAppData)))
+        return CString();
+    CString strFolder(szAppData);
+    strFolder += _T("\\MFCApplication4");
+    if (!::CreateDirectory(strFolder, nullptr) && ::GetLastError() != ERROR_ALREADY_EXISTS)
+        return CString();
+    return strFolder + _T("\\InputHistory.dat");
+}
+
+/**
+ * @brief 入力履歴をファイルから読み込みます。
+ * @details ファイル全体を1回の Read で読み込み、メモリ上で展開します。
+ * ファイルがない場合や形式が不正な場合は、空の履歴から始めます。
+ */
+void CMFCApplication4App::LoadInputHistory()
+{
+    const CString strPath = GetInputHistoryPath();
+    CFile file;
+    if (strPath.IsEmpty() || !file.Open(strPath, CFile::modeRead | CFile::shareDenyWrite))
+        return;
+
+    const ULONGLONG nLength = file.GetLength();
+    if (nLength == 0 || nLength > 64ULL * 1024 * 1024)
+        return;
+    std::vector<unsigned char> data(static_cast<size_t>(nLength));
+    if (file.Read(data.data(), static_cast<UINT>(data.size())) != data.size() ||
+        !m_inputHistory.Deserialize(data.data(), data.size()))
+    {
+        TRACE(_T("入力履歴を読み込めませんでした: %s\n"), (LPCTSTR)strPath);
+    }
+}
+
+/**
+ * @brief 入力履歴をファイルに保存します。
+ * @details メモリ上で全体をバイト列にしてから、1回の Write で書き出します (既存のファイルは上書きします)。
+ */
+void CMFCApplication4App::SaveInputHistory() const
+{
+    const CString strPath = GetInputHistoryPath();
+    if (strPath.IsEmpty())
+        return;
+
+    std::vector<unsigned char> data;
+    m_inputHistory.Serialize(data);
+
+    CFile file;
+    if (file.Open(strPath, CFile::modeCreate | CFile::modeWrite | CFile::shareDenyWrite))
+    {
+        file.Write(data.data(), static_cast<UINT>(data.size()));
+        file.Close();
+    }
+}
+
+/**
+ * @brief 描画計測値の集計結果を一時フォルダのテキストファイルに書き出します。
+ * @details 出力先は %TEMP%\MFCApplication4_PaintMetrics.txt です (既存のファイルは上書きします)。
+ * 末尾にはフォントの寸法のキャッシュの累計回数 (DCの取得回数など) を加えます。
+ * 続けて、GDIオブジェクトのキャッシュの累計回数 (生成数・再利用数・生存ハンドル数) と、
+ * ビューの合成の累計 (描画した面積とオーバードロー率) を加えます。計測が無効な場合は何もしません。
+ */
+void CMFCApplication4App::ExportPaintMetrics()
+{
+    if (!CPaintMetrics::IsEnabled())
+        return;
+    WriteDiagnosticsFile(_T("MFCApplication4_PaintMetrics.txt"), CPaintMetrics::FormatReport() + CFontMetricsCache::FormatStats() +
+                                                                      CGdiResourceCache::FormatStats() + CLayerCompositor::FormatStats());
+}
+
+/**
+ * @brief 入力遅延トレースを一時フォルダに Chrome トレースイベント形式 (JSON) で書き出します。
+ * @details 出力先は %TEMP%\MFCApplication4_InputTrace.json です (既存のファイルは上書きします)。
+ * chrome://tracing や Perfetto で開くと、入力ごとのスパンと、その中の処理・描画を確認できます。
+ */
+void CMFCApplication4App::ExportInputTrace()
+{
+    if (!CInputTrace::IsEnabled())
+        return;
+    WriteDiagnosticsFile(_T("MFCApplication4_InputTrace.json"), CInputTrace::ToChromeJson());
+}
+/**
+ * @brief 機能 F(n-k) の本体を登録表に登録します。
+ * @details 機能番号 k ごとに全ての行で共有する本体を登録し、行によって異なる機能は Register() で上書きします。
+ * 実機の機能 (原点復帰、ファイル転送、再計算など) はここで登録します。
+ * 本体はワーカーで実行されるため、UIオブジェクトには触れず、進捗の報告と取り消しの確認だけを行ってください。
+ * 現在の本体は、従来のメッセージ表示と同じく何も処理せずに完了します (完了の表示はメインダイアログが行います)。
+ */
+void CMFCApplication4App::RegisterCommands()
+{
+    for (int k = 1; k <= COMMAND_FUNCTION_COUNT; ++k)
+    {
+        m_commandRegistry.RegisterFunction(k, [](CCommandContext &context) {
+            context.ReportProgress(100);
+            return true;
+        });
+    }
+}
@@ -11,9 +11,24 @@
 #endif
 
 #include "resource.h" // メイン シンボル
+#include "ActivityTracker.h"
+#include "TaskScheduler.h"
+#include "TriggerEngine.h"
+#include "UiDispatcher.h"
+#include "CommandRegistry.h"
+#include "SoftwareKeyboardDlg.h"
+#include "InputHistory.h"
 
-/// @brief メインダイアログに「操作中」と表示させるためのカスタムメッセージID
-#define WM_APP_SHOW_OPERATION_STATUS (WM_APP + 3)
+#include <memory>
+
+/**
+ * @struct OPERATION_INPUT_EVENT
+ * @brief アイドル中の最初の入力で、メインダイアログに操作状態の判定を依頼するイベント
+ * @details 結合キー付きで投稿するため、未処理のものが複数溜まることはありません。
+ */
+struct OPERATION_INPUT_EVENT
+{
+};
 
 /**
  * @class CMFCApplication4App
@@ -54,8 +69,116 @@ public:
      */
     virtual BOOL PreTranslateMessage(MSG *pMsg) override;
 
+    /**
+     * @brief アプリケーション全体の操作状態追跡サービスを取得します。
+     * @details 最終入力からの経過時間の問い合わせ (画面の減光や自動ログアウトなど) にも使用できます。
+     * @return 操作状態追跡サービスへの参照
+     */
+    CActivityTracker &GetActivityTracker() { return m_activityTracker; }
+
+    /**
+     * @brief アプリケーション全体で共有するタスクスケジューラを取得します。
+     * @details InitInstance から ExitInstance までの間、ワーカースレッドとタイマーが利用できます。
+     * @return タスクスケジューラへの参照
+     */
+    CTaskScheduler &GetTaskScheduler() { return m_taskScheduler; }
+
+    /**
+     * @brief アプリケーション全体で共有するトリガーエンジンを取得します。
+     * @details デバウンスの待機にはタスクスケジューラのタイマーを使います。
+     * @return トリガーエンジンへの参照
+     */
+    CTriggerEngine &GetTriggerEngine() { return m_triggerEngine; }
+
+    /**
+     * @brief 任意のスレッドからUIスレッドへ処理やイベントを届けるディスパッチャを取得します。
+     * @details 起床要求と実行はメインダイアログが担当します。
+     * @return ディスパッチャへの参照
+     */
+    CUiDispatcher &GetUiDispatcher() { return m_uiDispatcher; }
+
+    /**
+     * @brief 機能 F(n-k) の登録表を取得します。
+     * @details 起動時に全ての機能が登録され、本体はタスクスケジューラのワーカーで実行されます。
+     * @return 機能の登録表への参照
+     */
+    CCommandRegistry &GetCommandRegistry() { return m_commandRegistry; }
+
+    /**
+     * @brief 全てのエディットコントロールで共有するソフトウェアキーボードを取得します。
+     * @details 最初の呼び出しでオブジェクトを生成します。ウィンドウはメインダイアログの初期化時に
+     * 非表示のまま生成され、以降は表示・非表示の切り替えだけで使い回されます。
+     * @return ソフトウェアキーボードへの参照
+     */
+    CSoftwareKeyboardDlg &GetSoftwareKeyboard();
+
+    /**
+     * @brief 入力欄ごとの入力履歴を取得します。
+     * @details InitInstance でファイルから読み込み、ExitInstance でファイルに保存します。
+     * @return 入力履歴への参照
+     */
+    CInputHistoryStore &GetInputHistory() { return m_inputHistory; }
+
+    /// @brief 機能 F(n-k) の行数 (n の最大値、機能選択グリッドの行数)
+    static const int COMMAND_ROW_COUNT = 16;
+    /// @brief 機能 F(n-k) の機能数 (k の最大値、ページ1の8機能とページ2の5機能)
+    static const int COMMAND_FUNCTION_COUNT = 13;
+
     // 実装
+private:
+    /**
+     * @brief 描画計測値の集計結果を一時フォルダのテキストファイルに書き出します。
+     * @details 計測が無効な場合は何もしません。
+     */
+    void ExportPaintMetrics();
+
+    /**
+     * @brief 入力遅延トレースを一時フォルダに Chrome トレースイベント形式 (JSON) で書き出します。
+     * @details トレースが無効な場合は何もしません。
+     */
+    void ExportInputTrace();
+
+    /**
+     * @brief 機能 F(n-k) の本体を登録表に登録します。
+     * @details InitInstance でダイアログの表示前に一度だけ呼び出します。
+     */
+    void RegisterCommands();
+
+    /**
+     * @brief 入力履歴のファイルのパスを求めます。
+     * @details 出力先は %LOCALAPPDATA%\MFCApplication4\InputHistory.dat です (フォルダがなければ作成します)。
+     * @return ファイルのパス (求められない場合は空文字列)
+     */
+    CString GetInputHistoryPath() const;
+
+    /// @brief 入力履歴をファイルから1回の読み込みで読み込みます。
+    void LoadInputHistory();
+
+    /// @brief 入力履歴をファイルに1回の書き込みで保存します。
+    void SaveInputHistory() const;
+
+    /// @brief 入力フィルタが最終入力時刻を記録する操作状態追跡サービス
+    CActivityTracker m_activityTracker;
+
+    /// @brief アプリケーション全体で共有するタスクスケジューラ (CPUコア数のワーカー)
+    CTaskScheduler m_taskScheduler;
 
+    /// @brief 装置の状態などの監視値と、それに対する条件を管理するトリガーエンジン (m_taskScheduler より後に宣言すること)
+    CTriggerEngine m_triggerEngine;
+
+    /// @brief UIスレッドへ処理やイベントを届けるディスパッチャ
+    CUiDispatcher m_uiDispatcher;
+
+    /// @brief 機能 F(n-k) の登録表 (m_taskScheduler より後に宣言すること)
+    CCommandRegistry m_commandRegistry;
+
+    /// @brief 共有のソフトウェアキーボード (最初の GetSoftwareKeyboard() で生成)
+    std::unique_ptr<CSoftwareKeyboardDlg> m_pSoftwareKeyboard;
+
+    /// @brief 入力欄ごとの入力履歴 (ソフトウェアキーボードの入力候補)
+    CInputHistoryStore m_inputHistory;
+
+public:
     /// @brief メッセージマップを宣言します。
     DECLARE_MESSAGE_MAP()
 };
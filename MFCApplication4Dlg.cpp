@@ -6,6 +6,7 @@
 #include "framework.h"
 #include "MFCApplication4.h"
 #include "MFCApplication4Dlg.h"
+#include "InputTrace.h"
 #include "afxdialogex.h"
 #include "CenterEdit.h"
 #include "CMyDialog.h"
@@ -35,45 +36,45 @@ void CMFCApplication4Dlg::DoDataExchange(CDataExchange *pDX)
     CDialogEx::DoDataExchange(pDX);
 }
 
+/// @brief ディスパッチャの起床要求に使う登録済みメッセージ
+static const UINT s_nDispatcherWakeMessage = ::RegisterWindowMessage(_T("MFCApplication4.UiDispatcher.Wake"));
+
 // BEGIN_MESSAGE_MAPブロック
 // Windowsメッセージと、それを処理するクラスのメンバ関数（ハンドラ）を関連付けます。
 BEGIN_MESSAGE_MAP(CMFCApplication4Dlg, CDialogEx)
     ON_WM_PAINT()
     ON_WM_QUERYDRAGICON()
-    ON_MESSAGE(WM_SHOW_VIEW2, &CMFCApplication4Dlg::OnShowView2)
     ON_WM_SIZE()
     ON_BN_CLICKED(IDC_BUTTON1, &CMFCApplication4Dlg::OnBnClickedButton1)
     ON_WM_SYSCOMMAND()
     ON_BN_CLICKED(IDC_BUTTON2, &CMFCApplication4Dlg::OnBnClickedButton2)
     ON_WM_TIMER()
-    ON_MESSAGE(WM_APP_SHOW_OPERATION_STATUS, &CMFCApplication4Dlg::OnShowOperationStatus)
+    ON_REGISTERED_MESSAGE(s_nDispatcherWakeMessage, &CMFCApplication4Dlg::OnDispatcherWake)
+    ON_MESSAGE(WM_APP_COMMAND_FAILED, &CMFCApplication4Dlg::OnCommandFailed)
     ON_BN_CLICKED(IDC_BUTTON3, &CMFCApplication4Dlg::OnBnClickedButton3)
-    ON_MESSAGE(WM_EXECUTE_FUNCTION, &CMFCApplication4Dlg::OnExecuteFunction)
     ON_BN_CLICKED(IDOK, &CMFCApplication4Dlg::OnBnClickedOk)
+    ON_WM_DESTROY()
 END_MESSAGE_MAP()
 
 
 /**
- * @brief カスタムメッセージ WM_SHOW_VIEW2 のハンドラ
- * @details CView1のワーカースレッドからの通知を受け、CView2を作成・表示します。
- * @param wParam 未使用
- * @param lParam 未使用
- * @return 処理結果
+ * @brief CView2を作成・表示します。
+ * @details CView1の条件A成立の通知 (SHOW_VIEW2_EVENT) を受けて呼び出されます。
  */
-LRESULT CMFCApplication4Dlg::OnShowView2(WPARAM wParam, LPARAM lParam)
+void CMFCApplication4Dlg::ShowView2()
 {
     // すでにView2が表示されていれば何もしない
     if (m_pView2 && ::IsWindow(m_pView2->GetSafeHwnd()))
     {
         m_pView2->ShowWindow(SW_SHOW);
         m_pView2->SetFocus();
-        return 0;
+        return;
     }
 
     // View1 (プライマリビュー) のウィンドウ矩形を取得
     CRect rectView1;
     if (!m_pView1)
-        return -1; // View1が見つからない場合はエラー
+        return; // View1が見つからない場合は何もしない
 
     m_pView1->GetWindowRect(&rectView1); // View1のスクリーン座標を取得
     ScreenToClient(&rectView1);          // ダイアログのクライアント座標に変換
@@ -91,6 +92,10 @@ LRESULT CMFCApplication4Dlg::OnShowView2(WPARAM wParam, LPARAM lParam)
         m_pView2 = new CView2();
         CCreateContext context;
         m_pView2->Create(NULL, _T("View2"), WS_CHILD | WS_VISIBLE | WS_BORDER, rectView2, this, AFX_IDW_PANE_FIRST + 2, &context);
+        m_view2RegionState.Invalidate(); // 作成直後のウィンドウにはリージョンがない
+        // CView1 の下の層として合成に登録する (重なる部分は CView1 を表示する)
+        m_viewCompositor.AddView(m_pView2, [this](CDC *pDC) { m_pView2->OnDraw(pDC); }, ::GetSysColor(COLOR_WINDOW), 0);
+        m_pView2->SetCompositor(&m_viewCompositor);
     }
 
     // View2を正しい位置に表示し、最前面に持ってくる
@@ -98,8 +103,6 @@ LRESULT CMFCApplication4Dlg::OnShowView2(WPARAM wParam, LPARAM lParam)
     m_pView2->Invalidate();
     // CView2の表示領域を適切にクリッピングする
     UpdateLayoutAndClipping();
-
-    return 0;
 }
 
 /**
@@ -124,40 +127,26 @@ void CMFCApplication4Dlg::OnSize(UINT nType, int cx, int cy)
 
 /**
  * @brief CView1とCView2のレイアウトとクリッピング領域を更新します。
- * @details CView2のウィンドウリージョン（描画担当領域）から、CView1と重なる部分を
- * 「差し引く」ことで、CView2がCView1を覆い隠さないようにします。
+ * @details 合成 (CViewCompositor) の重なり順では CView1 が上の層のため、CView2の見える領域は
+ * CView2の全体からCView1と重なる部分を「差し引いた」領域です。これをCView2のウィンドウリージョンにすることで、
+ * CView2がCView1を覆い隠さないようにします。見える領域は配置が変わった場合だけ計算し直し、
+ * SetWindowRgn はウィンドウ全体を描き直させるため、設定済みの領域と異なる場合だけ呼び出します
+ * (サイズ変更で矩形が変わらなければ何もしません)。
  */
 void CMFCApplication4Dlg::UpdateLayoutAndClipping()
 {
     if (!m_pView1 || !::IsWindow(m_pView1->GetSafeHwnd())) return;
     if (!m_pView2 || !::IsWindow(m_pView2->GetSafeHwnd())) return;
 
-    // 1. 各ビューのウィンドウ矩形をスクリーン座標で取得
-    CRect rectView1Screen, rectView2Screen;
-    m_pView1->GetWindowRect(&rectView1Screen);
-    m_pView2->GetWindowRect(&rectView2Screen);
-
-    // 2. CView2のクライアント領域全体のリージョンを作成 (CView2のローカル座標系)
-    CRect rectView2Client;
-    m_pView2->GetClientRect(&rectView2Client);
-    CRgn rgnView2;
-    rgnView2.CreateRectRgnIndirect(&rectView2Client);
+    // 1. 合成に各ビューのウィンドウ矩形を読み直させる (配置が変わらなければ見える領域は計算し直さない)
+    m_viewCompositor.UpdateGeometry();
 
-    // 3. CView1の領域(スクリーン座標)をCView2のクライアント座標系に変換
-    CRect rectView1inView2 = rectView1Screen;
-    m_pView2->ScreenToClient(&rectView1inView2);
+    // 2. CView2の見える領域 (CView1と重なる部分が「穴」の開いた領域) をCView2のウィンドウ座標で取得
+    const CRectRegion region = m_viewCompositor.GetWindowRegion(m_pView2);
 
-    // 4. 変換したCView1の領域で、差し引くためのクリッピングリージョンを作成
-    CRgn rgnClip;
-    rgnClip.CreateRectRgnIndirect(&rectView1inView2);
-
-    // 5. CView2の全体リージョンからCView1のリージョンを「差し引く」(RGN_DIFF)
-    //    これにより、重なっている部分が「穴」の開いたリージョンが生成される
-    rgnView2.CombineRgn(&rgnView2, &rgnClip, RGN_DIFF);
-
-    // 6. 計算した新しいリージョンをCView2に設定する
-    //    Detach()でリージョンの所有権をウィンドウに渡し、ウィンドウ破棄時に自動解放させる
-    m_pView2->SetWindowRgn((HRGN)rgnView2.Detach(), TRUE);
+    // 3. 設定済みの領域と異なる場合だけ、新しいリージョンをCView2に設定する (同じなら再描画を省く)
+    //    リージョンの所有権はウィンドウに渡り、ウィンドウ破棄時に自動解放される
+    m_view2RegionState.Apply(region, [this](const CRectRegion &newRegion) { m_pView2->SetWindowRgn(newRegion.CreateHrgn(), TRUE); });
 }
 
 /**
@@ -173,18 +162,42 @@ BOOL CMFCApplication4Dlg::OnInitDialog()
     SetIcon(m_hIcon, TRUE);
     SetIcon(m_hIcon, FALSE);
 
+    // ディスパッチャの起床要求の送り先としてこのダイアログを登録し、イベントのハンドラを設定します。
+    // タスクスケジューラのUIスレッドでの実行もディスパッチャ経由にします。
+    // CView1 の生成より前に登録し、以降に投稿される項目がUIスレッドで実行されるようにします。
+    CUiDispatcher &dispatcher = theApp.GetUiDispatcher();
+    dispatcher.SetHandler<SHOW_VIEW2_EVENT>([this](SHOW_VIEW2_EVENT &) { ShowView2(); });
+    dispatcher.SetHandler<OPERATION_INPUT_EVENT>([this](OPERATION_INPUT_EVENT &) { ProcessActivityTick(); });
+    const HWND hWnd = GetSafeHwnd();
+    dispatcher.SetWakeFunc([hWnd]() { return ::PostMessage(hWnd, s_nDispatcherWakeMessage, 0, 0) != FALSE; });
+    theApp.GetTaskScheduler().SetUiExecutor([&dispatcher](CTaskScheduler::Task task) {
+        dispatcher.Post(std::move(task));
+        return true;
+    });
+    theApp.GetCommandRegistry().AddListener(this);
+
     // CCenterEdit コントロールを動的に生成・配置
     m_editCustom1 = new CCenterEdit();
     CRect rect1(50, 50, 200, 200);
     m_editCustom1->Create(WS_CHILD | WS_VISIBLE | ES_CENTER | ES_WANTRETURN, rect1, this, 1000);
     m_editCustom1->SetWindowTextW(_T("1234"));
     m_editCustom1->SetFont(GetFont());
+    m_editCustom1->SetNumericField(CNumericField::Params()); // 4桁の0以上の整数
+    m_editCustom1->SetHistoryKey(_T("Custom1"));
 
     m_editCustom2 = new CCenterEdit();
     CRect rect2(250, 50, 400, 200);
     m_editCustom2->Create(WS_CHILD | WS_VISIBLE | ES_CENTER | ES_WANTRETURN, rect2, this, 1001);
-    m_editCustom2->SetWindowTextW(_T("5678"));
+    m_editCustom2->SetWindowTextW(_T("56.7"));
     m_editCustom2->SetFont(GetFont());
+    CNumericField::Params decimalField; // -9.9～99.9 の小数1桁、0.1刻み
+    decimalField.nDecimals = 1;
+    decimalField.bSigned = true;
+    decimalField.dStep = 0.1;
+    decimalField.dMin = -9.9;
+    decimalField.dMax = 99.9;
+    m_editCustom2->SetNumericField(decimalField);
+    m_editCustom2->SetHistoryKey(_T("Custom2"));
 
     // CView1 を動的に生成・配置
     CRect rectView1(450, 50, 600, 200);
@@ -192,6 +205,11 @@ BOOL CMFCApplication4Dlg::OnInitDialog()
     CCreateContext context;
     m_pView1->Create(NULL, _T("View1"), WS_CHILD | WS_VISIBLE | WS_BORDER, rectView1, this, AFX_IDW_PANE_FIRST + 1, &context);
     m_pView1->SetWindowPos(&wndTop, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_SHOWWINDOW);
+
+    // 重なったビューの合成に CView1 を上の層として登録する (描画は最初の WM_PAINT から合成を経由する)
+    m_viewCompositor.Attach(this);
+    m_viewCompositor.AddView(m_pView1, [this](CDC *pDC) { m_pView1->OnDraw(pDC); }, ::GetSysColor(COLOR_WINDOW), 1);
+    m_pView1->SetCompositor(&m_viewCompositor);
     
     // CMyEdit (ソフトウェアキーボード付き)を動的に生成・配置
     m_editCustom3 = new CMyEdit();
@@ -199,6 +217,16 @@ BOOL CMFCApplication4Dlg::OnInitDialog()
     m_editCustom3->Create(WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOVSCROLL | ES_MULTILINE, rect3, this, 1010);
     m_editCustom3->SetWindowTextW(_T("Click here to show Keyboard"));
     m_editCustom3->SetFont(GetFont());
+    m_editCustom3->SetHistoryKey(_T("Custom3"));
+
+    // 機能の結果を表示する状態表示欄を、下端のボタンの右に生成
+    CRect rectStatus(220, 362, 396, 374);
+    MapDialogRect(&rectStatus);
+    m_stcCommandStatus.Create(_T(""), WS_CHILD | WS_VISIBLE | SS_LEFTNOWORDWRAP, rectStatus, this);
+    m_stcCommandStatus.SetFont(GetFont());
+
+    // 共有のソフトウェアキーボードを非表示のまま生成しておき、最初のタップでもすぐに表示できるようにします。
+    theApp.GetSoftwareKeyboard().Prepare(this);
 
     // ダイアログの初期タイトルを保存
     GetWindowText(m_strOriginalTitle);
@@ -244,37 +272,62 @@ BOOL CMFCApplication4Dlg::PreTranslateMessage(MSG *pMsg)
 }
 
 /**
- * @brief カスタムメッセージ WM_APP_SHOW_OPERATION_STATUS のハンドラ
- * @details CWinAppのPreTranslateMessageからの通知を受け、タイトルを「操作中」に変更しタイマーを開始します。
+ * @brief ディスパッチャの起床要求 (登録済みメッセージ) のハンドラ
+ * @details 溜まった項目を時間予算内で実行します。
+ * 残りがある場合、入力や描画が待っていればそれらを先に処理させるためタイマーで再開し、
+ * 待っていなければ起床要求を再度ポストして次のメッセージループで続きを実行します。
+ * (ポストされたメッセージは入力より先に取り出されるため、再ポストを続けると入力が滞ります)
  * @param wParam 未使用
  * @param lParam 未使用
  * @return 処理結果
  */
-LRESULT CMFCApplication4Dlg::OnShowOperationStatus(WPARAM wParam, LPARAM lParam)
+LRESULT CMFCApplication4Dlg::OnDispatcherWake(WPARAM wParam, LPARAM lParam)
 {
-    // 現在のタイトルを取得
-    CString strCurrentTitle;
-    GetWindowText(strCurrentTitle);
-
-    // タイトルがまだ「操作中」でなければ、現在のタイトルを保存
-    if (strCurrentTitle != _T("操作中"))
+    if (theApp.GetUiDispatcher().Drain())
     {
-        m_strOriginalTitle = strCurrentTitle;
+        if (HIWORD(::GetQueueStatus(QS_INPUT | QS_PAINT)) != 0)
+        {
+            SetTimer(ID_DISPATCH_TIMER, USER_TIMER_MINIMUM, NULL);
+        }
+        else
+        {
+            PostMessage(s_nDispatcherWakeMessage, 0, 0);
+        }
     }
-
-    // タイトルを「操作中」に変更
-    SetWindowText(_T("操作中"));
-
-    // 3秒後に1回だけ発生するタイマーを開始（またはリセット）する
-    SetTimer(ID_TITLE_TIMER, 3000, NULL);
-
     return 0;
 }
 
+/**
+ * @brief 操作状態追跡サービスの状態機械を進め、遷移があった場合のみタイトルと判定タイマーを更新します。
+ * @details アイドル中の最初の入力 (OPERATION_INPUT_EVENT) と、操作中の周期判定タイマーから呼び出されます。
+ * アイドル → 操作中でタイトルを「操作中」に変更して周期判定タイマーを開始し、
+ * 操作中 → アイドルでタイトルを元に戻してタイマーを停止します。遷移がなければ何もしません。
+ */
+void CMFCApplication4Dlg::ProcessActivityTick()
+{
+    switch (theApp.GetActivityTracker().Tick())
+    {
+    case CActivityTracker::TRANSITION_TO_OPERATING:
+        // 現在のタイトルを保存してから「操作中」に変更
+        GetWindowText(m_strOriginalTitle);
+        SetWindowText(_T("操作中"));
+        SetTimer(ID_TITLE_TIMER, static_cast<UINT>(CActivityTracker::TICK_INTERVAL_MS), NULL);
+        break;
+    case CActivityTracker::TRANSITION_TO_IDLE:
+        KillTimer(ID_TITLE_TIMER);
+        // タイトルを保存しておいた元の文字列に戻す
+        SetWindowText(m_strOriginalTitle);
+        break;
+    default:
+        break;
+    }
+}
+
 
 /**
  * @brief タイマーイベント(WM_TIMER)を処理します。
- * @details ID_TITLE_TIMERからのイベントを受け、ウィンドウタイトルを元に戻します。
+ * @details ID_TITLE_TIMERからのイベントを受けて操作状態を判定し、
+ * ID_DISPATCH_TIMERからのイベントを受けてディスパッチャの残りの項目を実行します。
  * @param nIDEvent タイマーのID
  */
 void CMFCApplication4Dlg::OnTimer(UINT_PTR nIDEvent)
@@ -282,11 +335,12 @@ void CMFCApplication4Dlg::OnTimer(UINT_PTR nIDEvent)
     // 目的のタイマーIDか確認
     if (nIDEvent == ID_TITLE_TIMER)
     {
-        // タイマーを停止（一回限りのタイマーのため）
-        KillTimer(ID_TITLE_TIMER);
-
-        // タイトルを保存しておいた元の文字列に戻す
-        SetWindowText(m_strOriginalTitle);
+        ProcessActivityTick();
+    }
+    else if (nIDEvent == ID_DISPATCH_TIMER)
+    {
+        KillTimer(ID_DISPATCH_TIMER);
+        OnDispatcherWake(0, 0);
     }
 
     CDialogEx::OnTimer(nIDEvent);
@@ -330,27 +384,101 @@ HCURSOR CMFCApplication4Dlg::OnQueryDragIcon()
 }
 
 /**
- * @brief カスタムメッセージ WM_EXECUTE_FUNCTION のハンドラ
- * @details CMyDialog3からの機能実行通知を受け、メッセージボックスで内容を表示します。
- * @param wParam パラメータ 'n'
- * @param lParam パラメータ 'k'
- * @return 処理結果
+ * @brief 機能 F(n-k) の進捗通知を受けます。
+ * @details 進捗の表示は機能ボタンを持つ CMyDialog3 が行うため、ここでは何もしません。
+ * @param nRow 行番号 n
+ * @param nFunction 機能番号 k
+ * @param nPercent 進捗
+ */
+void CMFCApplication4Dlg::OnCommandProgress(int nRow, int nFunction, int nPercent)
+{
+}
+
+/**
+ * @brief 機能 F(n-k) の完了通知を受け、状態表示欄に結果を表示します。
+ * @details 通知はディスパッチャの処理 (CUiDispatcher::Drain) の中で行われるため、ここではモーダルループに入りません。
+ * 失敗は溜めておき、WM_APP_COMMAND_FAILED を1回だけ投稿して OnCommandFailed() でまとめて表示します。
+ * @param nRow 行番号 n
+ * @param nFunction 機能番号 k
+ * @param nStatus 終了状態 (CCommandRegistry::Status)
  */
-LRESULT CMFCApplication4Dlg::OnExecuteFunction(WPARAM wParam, LPARAM lParam)
+void CMFCApplication4Dlg::OnCommandFinished(int nRow, int nFunction, int nStatus)
 {
-    // wParamから「n」の値、lParamから「k」の値を取得
-    int n = (int)wParam;
-    int k = (int)lParam;
+    CInputTraceScope trace("CMFCApplication4Dlg::OnCommandFinished");
 
-    // メッセージボックスに表示する文字列を "F(n-k)" の形式でフォーマット
+    // 状態表示欄に表示する文字列を "F(n-k)" の形式でフォーマット
     CString msg;
-    msg.Format(_T("機能 F(%d-%d) が実行されました。"), n, k);
-    AfxMessageBox(msg);
+    switch (nStatus)
+    {
+    case CCommandRegistry::STATUS_COMPLETED:
+        msg.Format(_T("機能 F(%d-%d) が実行されました。"), nRow, nFunction);
+        break;
+    case CCommandRegistry::STATUS_CANCELLED:
+        msg.Format(_T("機能 F(%d-%d) は取り消されました。"), nRow, nFunction);
+        break;
+    default:
+        msg.Format(_T("機能 F(%d-%d) の実行に失敗しました。"), nRow, nFunction);
+        break;
+    }
+    m_stcCommandStatus.SetWindowText(msg);
+
+    if (nStatus == CCommandRegistry::STATUS_FAILED)
+    {
+        if (!m_strPendingFailures.IsEmpty())
+            m_strPendingFailures += _T("\n");
+        m_strPendingFailures += msg;
+        if (!m_bFailurePosted && PostMessage(WM_APP_COMMAND_FAILED, 0, 0))
+            m_bFailurePosted = true;
+    }
+}
+
+/**
+ * @brief カスタムメッセージ WM_APP_COMMAND_FAILED のハンドラ
+ * @details メッセージボックスの表示中に届いた失敗は、閉じた後に次のメッセージボックスでまとめて表示するため、
+ * メッセージボックスが重なって開くことはありません。
+ * @param wParam 未使用
+ * @param lParam 未使用
+ * @return 処理結果
+ */
+LRESULT CMFCApplication4Dlg::OnCommandFailed(WPARAM wParam, LPARAM lParam)
+{
+    m_bFailurePosted = false;
+    if (m_bShowingFailure)
+        return 0;
 
+    m_bShowingFailure = true;
+    while (!m_strPendingFailures.IsEmpty())
+    {
+        const CString msg = m_strPendingFailures;
+        m_strPendingFailures.Empty();
+        AfxMessageBox(msg, MB_ICONWARNING);
+    }
+    m_bShowingFailure = false;
     return 0;
 }
 
 
+/**
+ * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
+ * @details 機能のリスナー、タスクスケジューラのUIスレッド実行先、ディスパッチャの起床要求先・ハンドラを解除し、
+ * 未処理の項目を実行せずに破棄します。以降に投稿された項目はアプリケーション終了時に破棄されます。
+ */
+void CMFCApplication4Dlg::OnDestroy()
+{
+    theApp.GetCommandRegistry().RemoveListener(this);
+    theApp.GetTaskScheduler().SetUiExecutor(CTaskScheduler::UiExecutor());
+
+    CUiDispatcher &dispatcher = theApp.GetUiDispatcher();
+    dispatcher.SetWakeFunc(CUiDispatcher::WakeFunc());
+    dispatcher.SetHandler<SHOW_VIEW2_EVENT>(nullptr);
+    dispatcher.SetHandler<OPERATION_INPUT_EVENT>(nullptr);
+    dispatcher.Clear();
+    KillTimer(ID_DISPATCH_TIMER);
+
+    CDialogEx::OnDestroy();
+}
+
+
 /**
  * @brief ボタン1(IDC_BUTTON1)のクリックイベントハンドラ
  * @details CMyDialogをモーダルで表示します。
@@ -10,12 +10,17 @@
 #include "View1.h"
 #include "CView2.h"
 #include "CMyEdit.h"
+#include "CommandRegistry.h"
+#include "RectRegion.h"
+#include "ViewCompositor.h"
 
 // --- 定義 ---
-/// @brief ウィンドウタイトル変更用タイマーのID
+/// @brief 操作中に操作状態を周期的に判定するタイマーのID
 #define ID_TITLE_TIMER 1
-/// @brief ワーカースレッドからView2の表示をトリガーするためのカスタムメッセージ
-#define WM_SHOW_VIEW2 (WM_APP + 2)
+/// @brief 時間予算を超えて残ったディスパッチャの項目を、入力と描画の処理後に再開するタイマーのID
+#define ID_DISPATCH_TIMER 2
+/// @brief 機能の失敗を、ディスパッチャの処理の外でメッセージボックスに表示するためのカスタムメッセージ
+#define WM_APP_COMMAND_FAILED (WM_APP + 3)
 
 /**
  * @class CMFCApplication4Dlg
@@ -23,8 +28,9 @@
  * @details CDialogExを継承し、アプリケーションの主要なUIとロジックを管理します。
  * カスタムコントロールの動的生成、ビューの管理、システムコマンドのフック、
  * カスタムメッセージの処理など、多岐にわたる機能を持ちます。
+ * 機能 F(n-k) の完了通知を受けるリスナーとして、実行結果を状態表示欄に表示し、失敗はメッセージボックスでも知らせます。
  */
-class CMFCApplication4Dlg : public CDialogEx
+class CMFCApplication4Dlg : public CDialogEx, public CCommandListener
 {
     // コンストラクション
 public:
@@ -64,15 +70,33 @@ protected:
     CString m_strOriginalTitle;
     /// @brief ダイアログのアイコン
     HICON m_hIcon;
+    /// @brief CView1 と CView2 の合成 (重なり順、見える領域、共有のバックバッファ)
+    CViewCompositor m_viewCompositor;
+    /// @brief CView2 に設定済みのウィンドウリージョン (同じ領域の再設定を省くため)
+    CWindowRegionState m_view2RegionState;
+    /// @brief 最後に終わった機能の結果を表示する状態表示欄
+    CStatic m_stcCommandStatus;
+    /// @brief メッセージボックスでの表示を待っている失敗 (改行区切り)
+    CString m_strPendingFailures;
+    /// @brief WM_APP_COMMAND_FAILED を投稿済みで、まだ処理していないか
+    bool m_bFailurePosted = false;
+    /// @brief 失敗のメッセージボックスを表示中か
+    bool m_bShowingFailure = false;
 
 
     // --- ヘルパー関数 ---
     /**
      * @brief CView1とCView2のレイアウトとクリッピング領域を更新します。
-     * @details CView2がCView1と重なる部分を描画しないように、CView2のウィンドウリージョンを更新します。
+     * @details 合成にビューの配置を読み直させ、CView2の見える領域 (CView1と重なる部分を除いた領域) を
+     * CView2のウィンドウリージョンにします。領域が設定済みのものと同じ場合は、SetWindowRgn を呼び出しません。
      */
     void UpdateLayoutAndClipping();
 
+    /**
+     * @brief 操作状態追跡サービスの状態機械を進め、遷移があった場合のみタイトルと判定タイマーを更新します。
+     */
+    void ProcessActivityTick();
+
     // --- メッセージハンドラ ---
     
     /**
@@ -102,13 +126,10 @@ protected:
     afx_msg HCURSOR OnQueryDragIcon();
     
     /**
-     * @brief カスタムメッセージ WM_SHOW_VIEW2 のハンドラ
-     * @details CView1のワーカースレッドからの通知を受け、CView2を作成・表示します。
-     * @param wParam 未使用
-     * @param lParam 未使用
-     * @return 処理結果
+     * @brief CView2を作成・表示します。
+     * @details CView1の条件A成立の通知 (SHOW_VIEW2_EVENT) を受けて呼び出されます。
      */
-    afx_msg LRESULT OnShowView2(WPARAM wParam, LPARAM lParam);
+    void ShowView2();
     
     /**
      * @brief システムコマンドメッセージ(WM_SYSCOMMAND)を処理します。
@@ -120,28 +141,53 @@ protected:
     
     /**
      * @brief タイマーイベント(WM_TIMER)を処理します。
-     * @details ID_TITLE_TIMERからのイベントを受け、ウィンドウタイトルを元に戻します。
+     * @details ID_TITLE_TIMERからのイベントを受けて操作状態を判定し、
+     * ID_DISPATCH_TIMERからのイベントを受けてディスパッチャの残りの項目を実行します。
      * @param nIDEvent タイマーのID
      */
     afx_msg void OnTimer(UINT_PTR nIDEvent);
     
     /**
-     * @brief カスタムメッセージ WM_APP_SHOW_OPERATION_STATUS のハンドラ
-     * @details CWinAppのPreTranslateMessageからの通知を受け、タイトルを「操作中」に変更しタイマーを開始します。
+     * @brief ディスパッチャの起床要求 (登録済みメッセージ) のハンドラ
+     * @details 溜まった項目を時間予算内で実行します。残りがあれば、入力や描画が待っていなければ
+     * 再度起床要求をポストし、待っていればそれらの処理後にタイマーで再開します。
      * @param wParam 未使用
      * @param lParam 未使用
      * @return 処理結果
      */
-    afx_msg LRESULT OnShowOperationStatus(WPARAM wParam, LPARAM lParam);
+    afx_msg LRESULT OnDispatcherWake(WPARAM wParam, LPARAM lParam);
     
     /**
-     * @brief カスタムメッセージ WM_EXECUTE_FUNCTION のハンドラ
-     * @details CMyDialog3からの機能実行通知を受け、メッセージボックスで内容を表示します。
-     * @param wParam パラメータ 'n'
-     * @param lParam パラメータ 'k'
+     * @brief 機能 F(n-k) の進捗通知を受けます (このダイアログでは表示しません)。
+     * @param nRow 行番号 n
+     * @param nFunction 機能番号 k
+     * @param nPercent 進捗
+     */
+    virtual void OnCommandProgress(int nRow, int nFunction, int nPercent) override;
+
+    /**
+     * @brief 機能 F(n-k) の完了通知を受け、状態表示欄に結果を表示します。
+     * @details 失敗した場合は WM_APP_COMMAND_FAILED を投稿し、メッセージボックスは OnCommandFailed() で表示します。
+     * @param nRow 行番号 n
+     * @param nFunction 機能番号 k
+     * @param nStatus 終了状態 (CCommandRegistry::Status)
+     */
+    virtual void OnCommandFinished(int nRow, int nFunction, int nStatus) override;
+
+    /**
+     * @brief カスタムメッセージ WM_APP_COMMAND_FAILED のハンドラ
+     * @details 溜まった失敗を1つのメッセージボックスにまとめて表示します。
+     * @param wParam 未使用
+     * @param lParam 未使用
      * @return 処理結果
      */
-    afx_msg LRESULT OnExecuteFunction(WPARAM wParam, LPARAM lParam);
+    afx_msg LRESULT OnCommandFailed(WPARAM wParam, LPARAM lParam);
+
+    /**
+     * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
+     * @details ディスパッチャとタスクスケジューラのUIスレッド実行先、機能のリスナーを解除し、未処理の項目を破棄します。
+     */
+    afx_msg void OnDestroy();
     
     /// @brief メッセージマップを宣言します。
     DECLARE_MESSAGE_MAP()
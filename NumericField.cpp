@@ -0,0 +1,295 @@
+﻿/**
+ * @file NumericField.cpp
+ * @brief 数値入力欄の入力規則と増減の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "NumericField.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace
+{
+/// @brief 選択範囲を文字列の範囲内に収め、開始位置が終了位置以下になるように並べ替えます。
+void NormalizeSelection(const std::wstring &text, int &nSelStart, int &nSelEnd)
+{
+    const int nLength = static_cast<int>(text.size());
+    nSelStart = (std::max)(0, (std::min)(nSelStart, nLength));
+    nSelEnd = (std::max)(0, (std::min)(nSelEnd, nLength));
+    if (nSelStart > nSelEnd)
+        std::swap(nSelStart, nSelEnd);
+}
+
+/**
+ * @brief 指定した文字数と小数部の桁数で書ける絶対値の最大を、10^小数部の桁数 倍した整数で返します。
+ * @details 小数部の全ての桁を書ける値に限ります (例: 4文字・小数1桁なら 99.9 → 999)。1桁も書けない場合は -1 を返します。
+ */
+long long MaxScaledMagnitude(int nLength, int nDecimals)
+{
+    const int nIntegerDigits = (nDecimals > 0) ? nLength - nDecimals - 1 : nLength;
+    if (nIntegerDigits < 1)
+        return -1;
+    long long nLimit = 1;
+    for (int i = 0; i < nIntegerDigits + nDecimals && nLimit <= LLONG_MAX / 10; ++i)
+        nLimit *= 10;
+    return nLimit - 1;
+}
+}
+
+/**
+ * @brief CNumericFieldクラスのコンストラクタ (4桁の0以上の整数)
+ */
+CNumericField::CNumericField()
+{
+    SetParams(m_params);
+}
+
+/**
+ * @brief 入力欄の種類を指定するコンストラクタ
+ * @param params 入力欄の種類
+ */
+CNumericField::CNumericField(const Params &params)
+{
+    SetParams(params);
+}
+
+/**
+ * @brief 入力欄の種類を設定します。
+ * @details 書式どおりに書き直した値が必ず最大文字数に収まるように、増減と確定で使う範囲を
+ * 最大文字数で書ける範囲 (負の数は符号の1文字を除いた文字数) との共通部分にします。
+ */
+bool CNumericField::SetParams(const Params &params)
+{
+    m_params = params;
+    const int nDecimals = (std::max)(0, (std::min)(params.nDecimals, 9));
+    double dScale = 1.0;
+    for (int i = 0; i < nDecimals; ++i)
+        dScale *= 10.0;
+    const long long nPositive = MaxScaledMagnitude(params.nMaxLength, nDecimals);
+    const long long nNegative = params.bSigned ? (std::max)(0LL, MaxScaledMagnitude(params.nMaxLength - 1, nDecimals)) : 0;
+    if (nPositive < 0)
+    {
+        // 1桁も書けない設定では、値は常に0とします
+        m_dMin = m_dMax = 0.0;
+        return false;
+    }
+
+    // 書き直す桁数に丸めて同じ値になる差 (半桁) は狭めたとみなしません
+    const double dLowest = -static_cast<double>(nNegative) / dScale;
+    const double dHighest = static_cast<double>(nPositive) / dScale;
+    const double dHalfStep = 0.5 / dScale;
+    const bool bFits = params.dMin > dLowest - dHalfStep && params.dMax < dHighest + dHalfStep;
+    m_dMax = (std::max)(dLowest, (std::min)(params.dMax, dHighest));
+    m_dMin = (std::max)(dLowest, (std::min)(params.dMin, m_dMax));
+    return bFits;
+}
+
+/**
+ * @brief 文字列が入力途中の数値として正しいかを返します。
+ * @details 「[-] 数字* [. 数字{0,小数部の桁数}]」の形で、最大文字数以下であれば正しいとみなします。
+ */
+bool CNumericField::IsValid(const std::wstring &text) const
+{
+    if (static_cast<int>(text.size()) > m_params.nMaxLength)
+        return false;
+
+    size_t i = 0;
+    if (i < text.size() && text[i] == L'-')
+    {
+        if (!m_params.bSigned)
+            return false;
+        ++i;
+    }
+    while (i < text.size() && text[i] >= L'0' && text[i] <= L'9')
+        ++i;
+    if (i < text.size() && text[i] == L'.')
+    {
+        if (m_params.nDecimals <= 0)
+            return false;
+        ++i;
+        int nDecimals = 0;
+        while (i < text.size() && text[i] >= L'0' && text[i] <= L'9')
+        {
+            ++i;
+            ++nDecimals;
+        }
+        if (nDecimals > m_params.nDecimals)
+            return false;
+    }
+    return i == text.size();
+}
+
+/**
+ * @brief 受け付けた編集の結果を設定します。
+ * @details 結果が入力規則を満たさない場合は、何も変更せずにfalseを返します。
+ */
+bool CNumericField::Accept(std::wstring &text, int &nSelStart, int &nSelEnd, std::wstring &result, int nCaret) const
+{
+    if (!IsValid(result))
+        return false;
+    const bool bChanged = result != text;
+    text.swap(result);
+    nSelStart = nSelEnd = nCaret;
+    return bChanged;
+}
+
+/**
+ * @brief 選択範囲を1文字で置き換えます。
+ */
+bool CNumericField::InsertChar(wchar_t ch, std::wstring &text, int &nSelStart, int &nSelEnd) const
+{
+    if (!((ch >= L'0' && ch <= L'9') || ch == L'.' || ch == L'-'))
+        return false;
+    NormalizeSelection(text, nSelStart, nSelEnd);
+
+    std::wstring result;
+    result.reserve(text.size() + 1);
+    result.append(text, 0, nSelStart);
+    result.push_back(ch);
+    result.append(text, nSelEnd, std::wstring::npos);
+    return Accept(text, nSelStart, nSelEnd, result, nSelStart + 1);
+}
+
+/**
+ * @brief キャレットの前の1文字を削除します。
+ */
+bool CNumericField::Backspace(std::wstring &text, int &nSelStart, int &nSelEnd) const
+{
+    NormalizeSelection(text, nSelStart, nSelEnd);
+    const int nStart = (nSelStart == nSelEnd) ? nSelStart - 1 : nSelStart;
+    if (nStart < 0)
+        return false;
+    std::wstring result(text);
+    result.erase(nStart, nSelEnd - nStart);
+    return Accept(text, nSelStart, nSelEnd, result, nStart);
+}
+
+/**
+ * @brief キャレットの後ろの1文字を削除します。
+ */
+bool CNumericField::Delete(std::wstring &text, int &nSelStart, int &nSelEnd) const
+{
+    NormalizeSelection(text, nSelStart, nSelEnd);
+    const int nEnd = (nSelStart == nSelEnd) ? nSelEnd + 1 : nSelEnd;
+    if (nEnd > static_cast<int>(text.size()))
+        return false;
+    std::wstring result(text);
+    result.erase(nSelStart, nEnd - nSelStart);
+    return Accept(text, nSelStart, nSelEnd, result, nSelStart);
+}
+
+/**
+ * @brief 符号を反転します。
+ */
+bool CNumericField::ToggleSign(std::wstring &text, int &nSelStart, int &nSelEnd) const
+{
+    NormalizeSelection(text, nSelStart, nSelEnd);
+    std::wstring result(text);
+    int nCaret = nSelEnd;
+    if (!result.empty() && result[0] == L'-')
+    {
+        result.erase(0, 1);
+        nCaret = (std::max)(0, nCaret - 1);
+    }
+    else
+    {
+        result.insert(result.begin(), L'-');
+        ++nCaret;
+    }
+    return Accept(text, nSelStart, nSelEnd, result, nCaret);
+}
+
+/**
+ * @brief 文字列を値に変換します。
+ */
+bool CNumericField::Parse(const std::wstring &text, double &dValue) const
+{
+    double dInteger = 0.0;
+    double dFraction = 0.0;
+    double dScale = 1.0;
+    bool bDigits = false;
+    bool bFraction = false;
+    for (wchar_t ch : text)
+    {
+        if (ch == L'.')
+            bFraction = true;
+        else if (ch >= L'0' && ch <= L'9')
+        {
+            bDigits = true;
+            if (bFraction)
+            {
+                dScale *= 10.0;
+                dFraction += (ch - L'0') / dScale;
+            }
+            else
+                dInteger = dInteger * 10.0 + (ch - L'0');
+        }
+    }
+    dValue = dInteger + dFraction;
+    if (!text.empty() && text[0] == L'-')
+        dValue = -dValue;
+    return bDigits;
+}
+
+/**
+ * @brief 値を範囲に収め、小数部の桁数で丸めて書式どおりの文字列にします。
+ * @details 値を 10^小数部の桁数 倍した整数で扱うため、刻み幅の加算を繰り返しても誤差は累積しません。
+ * 小数部の末尾の0は書き出しません。
+ */
+std::wstring CNumericField::Format(double dValue) const
+{
+    const int nDecimals = (std::max)(0, (std::min)(m_params.nDecimals, 9));
+    double dScale = 1.0;
+    for (int i = 0; i < nDecimals; ++i)
+        dScale *= 10.0;
+
+    dValue = (std::max)(m_dMin, (std::min)(dValue, m_dMax));
+    long long nScaled = std::llround(dValue * dScale);
+    const bool bNegative = nScaled < 0;
+    if (bNegative)
+        nScaled = -nScaled;
+
+    std::wstring digits = std::to_wstring(nScaled);
+    if (static_cast<int>(digits.size()) <= nDecimals)
+        digits.insert(0, nDecimals + 1 - digits.size(), L'0');
+    const size_t nIntegerDigits = digits.size() - nDecimals;
+    size_t nFractionDigits = static_cast<size_t>(nDecimals);
+    while (nFractionDigits > 0 && digits[nIntegerDigits + nFractionDigits - 1] == L'0')
+        --nFractionDigits;
+
+    std::wstring result(bNegative ? L"-" : L"");
+    result.append(digits, 0, nIntegerDigits);
+    if (nFractionDigits > 0)
+    {
+        result.push_back(L'.');
+        result.append(digits, nIntegerDigits, nFractionDigits);
+    }
+    return result;
+}
+
+/**
+ * @brief 値に刻み幅の nCount 倍を加えます。
+ * @details 範囲は設定時に最大文字数で書ける値に狭めてあるため、書き直した文字列は必ず入力規則を満たします。
+ */
+bool CNumericField::Step(int nCount, std::wstring &text, int &nSelStart, int &nSelEnd) const
+{
+    double dValue = 0.0;
+    Parse(text, dValue);
+    std::wstring result = Format(dValue + m_params.dStep * nCount);
+    const int nCaret = static_cast<int>(result.size());
+    return Accept(text, nSelStart, nSelEnd, result, nCaret);
+}
+
+/**
+ * @brief 確定する文字列を整えます。
+ */
+bool CNumericField::Finish(std::wstring &text) const
+{
+    double dValue = 0.0;
+    std::wstring result = Parse(text, dValue) ? Format(dValue) : std::wstring();
+    if (result == text)
+        return false;
+    text.swap(result);
+    return true;
+}
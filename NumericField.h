@@ -0,0 +1,117 @@
+﻿/**
+ * @file NumericField.h
+ * @brief 数値入力欄の入力規則 (桁数・符号・小数点) と増減のクラス宣言
+ * @details 数値入力欄への1キーごとの編集を、文字列と選択範囲のモデルに対して行います。
+ * 入力のたびに「最大文字数」と「数値の書式 (符号・整数部・小数点・小数部)」を満たすかを判定し、
+ * 満たさない入力は受け付けないため、入力中の文字列は常に数値の途中の形になっています。
+ * 確定時に Finish() で途中の形 (「-」だけ、末尾の小数点など) を整え、範囲に収めるため、確定後の検証は不要です。
+ * 増減キーは値に刻み幅の整数倍を加え、範囲に収めて書式どおりに書き直します。
+ * 範囲は設定時に最大文字数で書ける値に狭めるため、増減や確定の結果が最大文字数を超えることはありません。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <string>
+
+/**
+ * @class CNumericField
+ * @brief 数値入力欄の入力規則と編集のモデル
+ * @details 編集の関数は全て、受け付けた場合は文字列と選択範囲を更新して true を返し、
+ * 受け付けない場合は何も変更せずに false を返します。編集後の選択範囲はキャレットだけになります。
+ */
+class CNumericField
+{
+public:
+    /**
+     * @struct Params
+     * @brief 数値入力欄の種類 (既定は4桁の0以上の整数)
+     */
+    struct Params
+    {
+        int nMaxLength; ///< 最大文字数 (符号と小数点を含む)
+        int nDecimals;  ///< 小数部の最大桁数 (0なら整数のみ)
+        bool bSigned;   ///< 負の数を入力できるか
+        double dStep;   ///< 増減キーの刻み幅
+        double dMin;    ///< 最小値
+        double dMax;    ///< 最大値
+
+        Params() : nMaxLength(4), nDecimals(0), bSigned(false), dStep(1.0), dMin(0.0), dMax(9999.0)
+        {
+        }
+    };
+
+    CNumericField();
+    explicit CNumericField(const Params &params);
+
+    /**
+     * @brief 入力欄の種類を設定します。
+     * @details 最小値・最大値のうち最大文字数と小数部の桁数で書けない部分は、書ける範囲に狭めて使います。
+     * @param[in] params 入力欄の種類
+     * @return 範囲を狭めずに設定できた場合はtrue (falseは設定の誤りです)
+     */
+    bool SetParams(const Params &params);
+    /// @brief 入力欄の種類を取得します。
+    const Params &GetParams() const { return m_params; }
+    /// @brief 増減と確定で使う最小値を取得します (最大文字数で書ける範囲に狭めた値)。
+    double GetMin() const { return m_dMin; }
+    /// @brief 増減と確定で使う最大値を取得します (最大文字数で書ける範囲に狭めた値)。
+    double GetMax() const { return m_dMax; }
+
+    /**
+     * @brief 文字列が入力途中の数値として正しいかを返します。
+     * @details 空文字列・「-」だけ・末尾の小数点などの途中の形も正しいとみなします。
+     * @param[in] text 文字列
+     */
+    bool IsValid(const std::wstring &text) const;
+
+    /**
+     * @brief 選択範囲を1文字で置き換えます (数字・小数点・符号の「-」)。
+     * @param[in] ch 入力する文字
+     * @param[in,out] text 文字列
+     * @param[in,out] nSelStart 選択範囲の開始位置
+     * @param[in,out] nSelEnd 選択範囲の終了位置
+     * @return 受け付けた場合はtrue
+     */
+    bool InsertChar(wchar_t ch, std::wstring &text, int &nSelStart, int &nSelEnd) const;
+
+    /// @brief キャレットの前の1文字 (選択範囲が空でなければ選択範囲) を削除します。
+    bool Backspace(std::wstring &text, int &nSelStart, int &nSelEnd) const;
+
+    /// @brief キャレットの後ろの1文字 (選択範囲が空でなければ選択範囲) を削除します。
+    bool Delete(std::wstring &text, int &nSelStart, int &nSelEnd) const;
+
+    /**
+     * @brief 符号を反転します。
+     * @details キャレットは数字に対して同じ位置に保ちます。負の数を入力できない場合や、桁数が足りない場合は受け付けません。
+     */
+    bool ToggleSign(std::wstring &text, int &nSelStart, int &nSelEnd) const;
+
+    /**
+     * @brief 値に刻み幅の nCount 倍を加えます。
+     * @details 値は範囲に収め、書式どおりに書き直してキャレットを末尾に置きます。入力途中の文字列は0とみなします。
+     * @param[in] nCount 刻み幅の倍数 (負なら減らします)
+     * @return 値が変わった場合はtrue (範囲の端で変わらない場合はfalse)
+     */
+    bool Step(int nCount, std::wstring &text, int &nSelStart, int &nSelEnd) const;
+
+    /**
+     * @brief 確定する文字列を整えます。
+     * @details 空文字列と「-」「.」だけの文字列は空文字列にし、それ以外は値を範囲に収めて書式どおりに書き直します
+     * (先頭の余分な0と、小数部の末尾の0は取り除きます)。
+     * @param[in,out] text 文字列
+     * @return 文字列を変更した場合はtrue
+     */
+    bool Finish(std::wstring &text) const;
+
+private:
+    /// @brief 文字列を値に変換します (数字を1つも含まなければfalse)。
+    bool Parse(const std::wstring &text, double &dValue) const;
+    /// @brief 値を範囲に収め、小数部の桁数で丸めて書式どおりの文字列にします。
+    std::wstring Format(double dValue) const;
+    /// @brief 受け付けた編集の結果を設定します。
+    bool Accept(std::wstring &text, int &nSelStart, int &nSelEnd, std::wstring &result, int nCaret) const;
+
+    Params m_params; ///< 入力欄の種類
+    double m_dMin;   ///< 増減と確定で使う最小値
+    double m_dMax;   ///< 増減と確定で使う最大値
+};
@@ -0,0 +1,284 @@
+﻿/**
+ * @file PaintMetrics.cpp
+ * @brief 描画計測値レジストリの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "PaintMetrics.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> CPaintMetrics::s_bEnabled(false);
+
+namespace
+{
+    /// @brief 単一スレッドだけが書き込むカウンタ (ロック命令を使わずに加算します)
+    template <typename T>
+    struct Counter
+    {
+        std::atomic<T> value{0};
+
+        void Add(T n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+        void Max(T n)
+        {
+            if (n > value.load(std::memory_order_relaxed))
+                value.store(n, std::memory_order_relaxed);
+        }
+        T Get() const { return value.load(std::memory_order_relaxed); }
+        void Clear() { value.store(0, std::memory_order_relaxed); }
+    };
+
+    /// @brief 1スレッド・1計測箇所分の記録領域
+    struct SiteSlot
+    {
+        Counter<std::uint64_t> count;
+        Counter<std::uint64_t> totalNs;
+        Counter<std::uint64_t> maxNs;
+        Counter<std::uint64_t> items;
+        Counter<std::uint64_t> allocations;
+        Counter<std::uint32_t> histogram[CPaintMetrics::BUCKET_COUNT];
+    };
+
+    /// @brief 1スレッド分の記録領域
+    struct ThreadSlot
+    {
+        SiteSlot sites[CPaintMetrics::SITE_COUNT];
+    };
+
+    /// @brief 全スレッドの記録領域の一覧 (スレッド終了後も値を保持するため解放しません)
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadSlot>> slots;
+    };
+
+    Registry &GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    /// @brief 呼び出し元スレッドの記録領域を返します (初回のみ登録のためにロックを取ります)。
+    ThreadSlot &GetThreadSlot()
+    {
+        thread_local ThreadSlot *pSlot = nullptr;
+        if (pSlot == nullptr)
+        {
+            Registry &registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.slots.push_back(std::unique_ptr<ThreadSlot>(new ThreadSlot()));
+            pSlot = registry.slots.back().get();
+        }
+        return *pSlot;
+    }
+
+    /// @brief 最上位ビットの位置 (0始まり) を返します。nValue は0以外であること。
+    int HighestBit(std::uint64_t nValue)
+    {
+        int n = 0;
+        if (nValue >> 32) { nValue >>= 32; n += 32; }
+        if (nValue >> 16) { nValue >>= 16; n += 16; }
+        if (nValue >> 8) { nValue >>= 8; n += 8; }
+        if (nValue >> 4) { nValue >>= 4; n += 4; }
+        if (nValue >> 2) { nValue >>= 2; n += 2; }
+        if (nValue >> 1) { n += 1; }
+        return n;
+    }
+
+    const char *const SITE_NAMES[CPaintMetrics::SITE_COUNT] = {
+        "CGridCtrl::OnPaint",
+        "CSoftwareKeyboardDlg::UpdateAllKeys",
+        "CSoftwareKeyboardDlg::OnPaint",
+        "CView1::OnDraw",
+        "CView2::OnDraw",
+        "CCenterEdit::UpdateTextPosition",
+        "CSoftwareKeyboardDlg::ShowFor",
+        "CView1 first paint",
+        "CView2 first paint",
+        "CViewComposer::Compose",
+        "CViewCompositor::ComposeFrame",
+    };
+
+    /// @brief 合算済みヒストグラムから指定割合のパーセンタイル (バケットの中央値) を求めます。
+    std::uint64_t Percentile(const std::vector<std::uint64_t> &histogram, std::uint64_t nCount, double dFraction)
+    {
+        if (nCount == 0)
+            return 0;
+        // 順位 ceil(nCount * dFraction) のサンプルが入るバケットを探す
+        std::uint64_t nRank = static_cast<std::uint64_t>(static_cast<double>(nCount) * dFraction + 0.999999);
+        if (nRank < 1)
+            nRank = 1;
+        std::uint64_t nSeen = 0;
+        for (int i = 0; i < CPaintMetrics::BUCKET_COUNT; ++i)
+        {
+            nSeen += histogram[i];
+            if (nSeen >= nRank)
+                return CPaintMetrics::BucketLowerBound(i) + CPaintMetrics::BucketWidth(i) / 2;
+        }
+        return CPaintMetrics::BucketLowerBound(CPaintMetrics::BUCKET_COUNT - 1);
+    }
+}
+
+/**
+ * @brief 単調増加する現在時刻 (ナノ秒) を返します。
+ */
+std::uint64_t CPaintMetrics::NowNs()
+{
+    using namespace std::chrono;
+    return static_cast<std::uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief 値が入るヒストグラムのバケット番号を返します。
+ * @details SUB_BUCKETS 未満の値はそのまま1刻みで、それ以上は 2^e ～ 2^(e+1) の範囲を SUB_BUCKETS 等分して振り分けます。
+ */
+int CPaintMetrics::BucketIndex(std::uint64_t nValue)
+{
+    if (nValue < static_cast<std::uint64_t>(SUB_BUCKETS))
+        return static_cast<int>(nValue);
+    const int e = HighestBit(nValue);
+    if (e >= MAX_VALUE_BITS)
+        return BUCKET_COUNT - 1;
+    const int sub = static_cast<int>((nValue >> (e - SUB_BITS)) & (SUB_BUCKETS - 1));
+    return SUB_BUCKETS + (e - SUB_BITS) * SUB_BUCKETS + sub;
+}
+
+/**
+ * @brief バケットに入る値の下限を返します。
+ */
+std::uint64_t CPaintMetrics::BucketLowerBound(int nIndex)
+{
+    if (nIndex < SUB_BUCKETS)
+        return static_cast<std::uint64_t>(nIndex);
+    const int e = (nIndex - SUB_BUCKETS) / SUB_BUCKETS + SUB_BITS;
+    const std::uint64_t sub = static_cast<std::uint64_t>((nIndex - SUB_BUCKETS) % SUB_BUCKETS);
+    return (std::uint64_t(1) << e) + (sub << (e - SUB_BITS));
+}
+
+/**
+ * @brief バケットに入る値の幅を返します。
+ */
+std::uint64_t CPaintMetrics::BucketWidth(int nIndex)
+{
+    if (nIndex < SUB_BUCKETS)
+        return 1;
+    const int e = (nIndex - SUB_BUCKETS) / SUB_BUCKETS + SUB_BITS;
+    return std::uint64_t(1) << (e - SUB_BITS);
+}
+
+/**
+ * @brief 1回分の計測値を呼び出し元スレッドの領域に記録します。
+ */
+void CPaintMetrics::Record(Site site, std::uint64_t nDurationNs, std::uint32_t nItems, std::uint32_t nAllocations)
+{
+    if (site < 0 || site >= SITE_COUNT)
+        return;
+    SiteSlot &slot = GetThreadSlot().sites[site];
+    slot.count.Add(1);
+    slot.totalNs.Add(nDurationNs);
+    slot.maxNs.Max(nDurationNs);
+    slot.items.Add(nItems);
+    slot.allocations.Add(nAllocations);
+    slot.histogram[BucketIndex(nDurationNs)].Add(1);
+}
+
+/**
+ * @brief 全スレッド分を合算した集計結果を返します。
+ */
+CPaintMetrics::SiteStats CPaintMetrics::GetStats(Site site)
+{
+    SiteStats stats = {};
+    if (site < 0 || site >= SITE_COUNT)
+        return stats;
+
+    std::vector<std::uint64_t> histogram(BUCKET_COUNT, 0);
+    std::uint64_t nHistogramCount = 0;
+    {
+        Registry &registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const std::unique_ptr<ThreadSlot> &pThread : registry.slots)
+        {
+            const SiteSlot &slot = pThread->sites[site];
+            stats.nCount += slot.count.Get();
+            stats.nTotalNs += slot.totalNs.Get();
+            if (slot.maxNs.Get() > stats.nMaxNs)
+                stats.nMaxNs = slot.maxNs.Get();
+            stats.nItems += slot.items.Get();
+            stats.nAllocations += slot.allocations.Get();
+            for (int i = 0; i < BUCKET_COUNT; ++i)
+            {
+                const std::uint32_t n = slot.histogram[i].Get();
+                histogram[i] += n;
+                nHistogramCount += n;
+            }
+        }
+    }
+
+    // 記録と並行して集計した場合に備え、パーセンタイルはヒストグラム自身の件数で求める
+    stats.nP50Ns = Percentile(histogram, nHistogramCount, 0.50);
+    stats.nP90Ns = Percentile(histogram, nHistogramCount, 0.90);
+    stats.nP99Ns = Percentile(histogram, nHistogramCount, 0.99);
+    stats.nP999Ns = Percentile(histogram, nHistogramCount, 0.999);
+    return stats;
+}
+
+/**
+ * @brief 計測箇所の表示名を返します。
+ */
+const char *CPaintMetrics::GetSiteName(Site site)
+{
+    if (site < 0 || site >= SITE_COUNT)
+        return "";
+    return SITE_NAMES[site];
+}
+
+/**
+ * @brief 全計測箇所の集計結果を表形式のテキストで返します (時間はマイクロ秒)。
+ */
+std::string CPaintMetrics::FormatReport()
+{
+    std::string report;
+    char szLine[256];
+    std::snprintf(szLine, sizeof(szLine), "%-32s %10s %10s %10s %10s %10s %10s %10s %12s %12s\n",
+                  "site", "count", "mean_us", "p50_us", "p90_us", "p99_us", "p99.9_us", "max_us", "items/call", "allocs/call");
+    report += szLine;
+
+    for (int i = 0; i < SITE_COUNT; ++i)
+    {
+        const Site site = static_cast<Site>(i);
+        const SiteStats stats = GetStats(site);
+        const double n = (stats.nCount > 0) ? static_cast<double>(stats.nCount) : 1.0;
+        std::snprintf(szLine, sizeof(szLine), "%-32s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %12.1f %12.2f\n",
+                      GetSiteName(site), static_cast<unsigned long long>(stats.nCount),
+                      stats.nTotalNs / n / 1000.0, stats.nP50Ns / 1000.0, stats.nP90Ns / 1000.0,
+                      stats.nP99Ns / 1000.0, stats.nP999Ns / 1000.0, stats.nMaxNs / 1000.0,
+                      stats.nItems / n, stats.nAllocations / n);
+        report += szLine;
+    }
+    return report;
+}
+
+/**
+ * @brief 記録済みの値をすべて0に戻します。
+ */
+void CPaintMetrics::Reset()
+{
+    Registry &registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<ThreadSlot> &pThread : registry.slots)
+    {
+        for (SiteSlot &slot : pThread->sites)
+        {
+            slot.count.Clear();
+            slot.totalNs.Clear();
+            slot.maxNs.Clear();
+            slot.items.Clear();
+            slot.allocations.Clear();
+            for (Counter<std::uint32_t> &bucket : slot.histogram)
+                bucket.Clear();
+        }
+    }
+}
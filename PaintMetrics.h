@@ -0,0 +1,150 @@
+﻿/**
+ * @file PaintMetrics.h
+ * @brief 描画処理の計測値 (所要時間・描画要素数・GDIオブジェクト生成数) を集計するレジストリのクラス宣言
+ * @details 計測箇所 (サイト) ごとに、呼び出し回数・合計/最大時間・描画要素数・GDIオブジェクト生成数と、
+ * 所要時間の対数線形ヒストグラム (HDRヒストグラム方式、相対誤差 1/64 以下) を記録します。
+ * 記録はスレッドごとの領域に対してロックなしで行い、集計時に全スレッド分を合算します。
+ * 無効時は CPaintMetricsScope の構築・破棄がフラグの読み出し1回だけになり、時刻の取得も行いません。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class CPaintMetrics
+ * @brief 描画計測値のプロセス全体のレジストリ (静的メンバのみ)
+ * @details 1つのサイトに対する記録は、各スレッドが自分専用の領域にのみ書き込みます (単一書き込み)。
+ * そのため値の更新はアトミックな読み書きだけで済み、ロック命令や待ち合わせは発生しません。
+ * 集計 (GetStats / FormatReport) は任意のスレッドから呼び出せますが、記録中の値は最大で数サンプル分遅れることがあります。
+ */
+class CPaintMetrics
+{
+public:
+    /// @brief 計測箇所
+    enum Site
+    {
+        SITE_GRID_PAINT,          ///< CGridCtrl::OnPaint
+        SITE_KEYBOARD_RENDER,     ///< CSoftwareKeyboardDlg::UpdateAllKeys (要素数は描き直したキーの数)
+        SITE_KEYBOARD_PAINT,      ///< CSoftwareKeyboardDlg::OnPaint
+        SITE_VIEW1_DRAW,          ///< CView1::OnDraw
+        SITE_VIEW2_DRAW,          ///< CView2::OnDraw
+        SITE_CENTEREDIT_TEXTPOS,  ///< CCenterEdit::UpdateTextPosition
+        SITE_KEYBOARD_SHOW,       ///< CSoftwareKeyboardDlg::ShowFor (表示要求から表示完了まで、生成数はウィンドウの生成数)
+        SITE_VIEW1_FIRST_PAINT,   ///< CView1 の作成から初回描画の完了まで (要素数はその時点で生成済みの子コントロール数)
+        SITE_VIEW2_FIRST_PAINT,   ///< CView2 の作成から初回描画の完了まで (要素数はその時点で生成済みの子コントロール数)
+        SITE_VIEW_COMPOSE,        ///< CViewComposer::Compose (要素数・生成数は生成した子コントロール数)
+        SITE_VIEW_COMPOSITE,      ///< CViewCompositor の1フレームの合成 (要素数は描画したビューの数、生成数はクリッピング領域の数)
+        SITE_COUNT                ///< 計測箇所の数
+    };
+
+    /// @brief ヒストグラムの1オクターブ (2倍の範囲) あたりの分割数を表すビット数 (相対誤差は 1/2^SUB_BITS 以下)
+    static constexpr int SUB_BITS = 6;
+    /// @brief ヒストグラムで区別できる最大値のビット数 (これ以上の値は最後のバケットに入ります。約68秒)
+    static constexpr int MAX_VALUE_BITS = 36;
+    /// @brief 1オクターブあたりのバケット数
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    /// @brief ヒストグラムのバケット数
+    static constexpr int BUCKET_COUNT = SUB_BUCKETS + (MAX_VALUE_BITS - SUB_BITS) * SUB_BUCKETS;
+
+    /**
+     * @struct SiteStats
+     * @brief 1つの計測箇所の集計結果 (時間はナノ秒)
+     */
+    struct SiteStats
+    {
+        std::uint64_t nCount;        ///< 記録回数
+        std::uint64_t nTotalNs;      ///< 合計時間
+        std::uint64_t nMaxNs;        ///< 最大時間
+        std::uint64_t nItems;        ///< 描画要素数 (セル数・キー数) の合計
+        std::uint64_t nAllocations;  ///< GDIオブジェクト生成数の合計
+        std::uint64_t nP50Ns;        ///< 50パーセンタイル
+        std::uint64_t nP90Ns;        ///< 90パーセンタイル
+        std::uint64_t nP99Ns;        ///< 99パーセンタイル
+        std::uint64_t nP999Ns;       ///< 99.9パーセンタイル
+    };
+
+    /// @brief 計測が有効かを返します。計測箇所はこれが false の間、何も記録しません。
+    static bool IsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+    /// @brief 計測の有効/無効を切り替えます。
+    static void SetEnabled(bool bEnabled) { s_bEnabled.store(bEnabled, std::memory_order_relaxed); }
+
+    /**
+     * @brief 1回分の計測値を呼び出し元スレッドの領域に記録します。
+     * @param[in] site 計測箇所
+     * @param[in] nDurationNs 所要時間 (ナノ秒)
+     * @param[in] nItems 描画した要素数
+     * @param[in] nAllocations 生成したGDIオブジェクト数
+     */
+    static void Record(Site site, std::uint64_t nDurationNs, std::uint32_t nItems, std::uint32_t nAllocations);
+
+    /// @brief 全スレッド分を合算した集計結果を返します。
+    static SiteStats GetStats(Site site);
+
+    /// @brief 計測箇所の表示名を返します。
+    static const char *GetSiteName(Site site);
+
+    /// @brief 全計測箇所の集計結果を表形式のテキストで返します。
+    static std::string FormatReport();
+
+    /**
+     * @brief 記録済みの値をすべて0に戻します。
+     * @details 描画スレッドから呼び出すことを想定しています。他のスレッドが記録中の値は失われることがあります。
+     */
+    static void Reset();
+
+    /// @brief 単調増加する現在時刻 (ナノ秒) を返します。
+    static std::uint64_t NowNs();
+
+    /// @brief 値 (ナノ秒) が入るヒストグラムのバケット番号を返します。
+    static int BucketIndex(std::uint64_t nValue);
+    /// @brief バケットに入る値の下限を返します。
+    static std::uint64_t BucketLowerBound(int nIndex);
+    /// @brief バケットに入る値の幅を返します。
+    static std::uint64_t BucketWidth(int nIndex);
+
+private:
+    static std::atomic<bool> s_bEnabled; ///< 計測の有効フラグ
+};
+
+/**
+ * @class CPaintMetricsScope
+ * @brief スコープの開始から終了までの時間を計測箇所に記録するRAIIヘルパー
+ * @details 描画関数の先頭でローカル変数として宣言し、必要に応じて描画要素数とGDIオブジェクト生成数を加算します。
+ * 構築時に計測が無効であれば、破棄時にも何も記録しません。
+ */
+class CPaintMetricsScope
+{
+public:
+    /// @brief 計測を開始します。
+    explicit CPaintMetricsScope(CPaintMetrics::Site site)
+        : m_site(site), m_bActive(CPaintMetrics::IsEnabled()), m_nStartNs(0), m_nItems(0), m_nAllocations(0)
+    {
+        if (m_bActive)
+            m_nStartNs = CPaintMetrics::NowNs();
+    }
+
+    /// @brief 経過時間を記録します。
+    ~CPaintMetricsScope()
+    {
+        if (m_bActive)
+            CPaintMetrics::Record(m_site, CPaintMetrics::NowNs() - m_nStartNs, m_nItems, m_nAllocations);
+    }
+
+    /// @brief 描画した要素数を加算します。
+    void AddItems(std::uint32_t nItems) { m_nItems += nItems; }
+    /// @brief 生成したGDIオブジェクト数を加算します。
+    void AddAllocations(std::uint32_t nAllocations) { m_nAllocations += nAllocations; }
+
+    CPaintMetricsScope(const CPaintMetricsScope &) = delete;
+    CPaintMetricsScope &operator=(const CPaintMetricsScope &) = delete;
+
+private:
+    CPaintMetrics::Site m_site;   ///< 計測箇所
+    bool m_bActive;               ///< 構築時に計測が有効だったか
+    std::uint64_t m_nStartNs;     ///< 計測開始時刻
+    std::uint32_t m_nItems;       ///< 描画した要素数
+    std::uint32_t m_nAllocations; ///< 生成したGDIオブジェクト数
+};
@@ -0,0 +1,396 @@
+﻿/**
+ * @file RectRegion.cpp
+ * @brief 矩形の集合で表した領域の演算と、クリッピング領域のキャッシュの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリ (Windowsでは Windows.h) のみに依存します。
+ */
+#include "RectRegion.h"
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+/**
+ * @brief 1つの矩形の領域を作ります。
+ */
+CRectRegion::CRectRegion(const REGION_RECT &rect)
+{
+    SetRect(rect);
+}
+
+/**
+ * @brief 1つの矩形の領域にします。
+ */
+void CRectRegion::SetRect(const REGION_RECT &rect)
+{
+    Clear();
+    if (rect.right <= rect.left || rect.bottom <= rect.top)
+        return;
+    m_x.push_back(rect.left);
+    m_x.push_back(rect.right);
+    m_bands.push_back(BAND{rect.top, rect.bottom, 0, 1});
+}
+
+/**
+ * @brief 矩形の並びの和の領域にします。
+ */
+void CRectRegion::SetRects(const REGION_RECT *pRects, std::size_t nCount)
+{
+    std::vector<CRectRegion> parts;
+    parts.reserve(nCount);
+    for (std::size_t i = 0; i < nCount; ++i)
+    {
+        parts.emplace_back(pRects[i]);
+        if (parts.back().IsEmpty())
+            parts.pop_back();
+    }
+    // 隣り合う2つの和を取って数を半分にすることを、1つになるまで繰り返します。
+    while (parts.size() > 1)
+    {
+        std::size_t nOut = 0;
+        for (std::size_t i = 0; i < parts.size(); i += 2)
+        {
+            if (i + 1 < parts.size())
+                parts[i].Union(parts[i + 1]);
+            if (nOut != i)
+                parts[nOut] = std::move(parts[i]);
+            ++nOut;
+        }
+        parts.resize(nOut);
+    }
+    if (parts.empty())
+        Clear();
+    else
+        *this = std::move(parts.front());
+}
+
+/**
+ * @brief 空の領域にします。
+ */
+void CRectRegion::Clear()
+{
+    m_bands.clear();
+    m_x.clear();
+}
+
+/**
+ * @brief 領域を囲む最小の矩形を返します。
+ */
+REGION_RECT CRectRegion::GetBounds() const
+{
+    if (m_bands.empty())
+        return REGION_RECT{0, 0, 0, 0};
+    REGION_RECT bounds = {INT_MAX, m_bands.front().nTop, INT_MIN, m_bands.back().nBottom};
+    for (const BAND &band : m_bands)
+    {
+        bounds.left = (std::min)(bounds.left, m_x[band.nFirst]);
+        bounds.right = (std::max)(bounds.right, m_x[band.nFirst + 2 * band.nCount - 1]);
+    }
+    return bounds;
+}
+
+/**
+ * @brief 領域の面積 (ピクセル数) を返します。
+ */
+std::uint64_t CRectRegion::GetArea() const
+{
+    std::uint64_t nArea = 0;
+    for (const BAND &band : m_bands)
+    {
+        std::uint64_t nWidth = 0;
+        for (std::uint32_t i = 0; i < band.nCount; ++i)
+            nWidth += static_cast<std::uint64_t>(static_cast<std::int64_t>(m_x[band.nFirst + 2 * i + 1]) - m_x[band.nFirst + 2 * i]);
+        nArea += nWidth * static_cast<std::uint64_t>(static_cast<std::int64_t>(band.nBottom) - band.nTop);
+    }
+    return nArea;
+}
+
+/**
+ * @brief 領域を上から下、左から右の順の矩形の並びにします。
+ */
+void CRectRegion::GetRects(std::vector<REGION_RECT> &rects) const
+{
+    rects.clear();
+    rects.reserve(GetRectCount());
+    for (const BAND &band : m_bands)
+    {
+        for (std::uint32_t i = 0; i < band.nCount; ++i)
+            rects.push_back(REGION_RECT{m_x[band.nFirst + 2 * i], band.nTop, m_x[band.nFirst + 2 * i + 1], band.nBottom});
+    }
+}
+
+/**
+ * @brief 点が領域に含まれるかを返します。
+ */
+bool CRectRegion::Contains(int x, int y) const
+{
+    const auto it = std::upper_bound(m_bands.begin(), m_bands.end(), y, [](int nY, const BAND &band) { return nY < band.nBottom; });
+    if (it == m_bands.end() || y < it->nTop)
+        return false;
+    const int *pBegin = m_x.data() + it->nFirst;
+    const int *pEnd = pBegin + 2 * it->nCount;
+    // x より大きい最初の端が右端 (奇数番目) であれば、x は区間の中にあります。
+    return ((std::upper_bound(pBegin, pEnd, x) - pBegin) & 1) != 0;
+}
+
+/**
+ * @brief 他の領域との和にします。
+ */
+void CRectRegion::Union(const CRectRegion &other)
+{
+    if (other.IsEmpty())
+        return;
+    if (IsEmpty())
+    {
+        *this = other;
+        return;
+    }
+    Combine(*this, other, OP_UNION);
+}
+
+/**
+ * @brief 他の領域を差し引きます。
+ */
+void CRectRegion::Subtract(const CRectRegion &other)
+{
+    if (IsEmpty() || other.IsEmpty())
+        return;
+    Combine(*this, other, OP_SUBTRACT);
+}
+
+/**
+ * @brief 他の領域との積 (共通部分) にします。
+ */
+void CRectRegion::Intersect(const CRectRegion &other)
+{
+    if (IsEmpty())
+        return;
+    if (other.IsEmpty())
+    {
+        Clear();
+        return;
+    }
+    Combine(*this, other, OP_INTERSECT);
+}
+
+/**
+ * @brief 領域を平行移動します。
+ */
+void CRectRegion::Offset(int dx, int dy)
+{
+    for (int &x : m_x)
+        x += dx;
+    for (BAND &band : m_bands)
+    {
+        band.nTop += dy;
+        band.nBottom += dy;
+    }
+}
+
+/**
+ * @brief 帯を末尾に追加します。
+ * @details 追加する区間は m_x の nFirst 以降に書き込み済みです。区間がなければ書き込んだ分を取り消します。
+ */
+void CRectRegion::AppendBand(int nTop, int nBottom, std::size_t nFirst)
+{
+    const std::uint32_t nCount = static_cast<std::uint32_t>((m_x.size() - nFirst) / 2);
+    if (nCount == 0)
+        return;
+    if (!m_bands.empty())
+    {
+        BAND &prev = m_bands.back();
+        if (prev.nBottom == nTop && prev.nCount == nCount &&
+            std::equal(m_x.begin() + prev.nFirst, m_x.begin() + prev.nFirst + 2 * nCount, m_x.begin() + nFirst))
+        {
+            prev.nBottom = nBottom;
+            m_x.resize(nFirst);
+            return;
+        }
+    }
+    m_bands.push_back(BAND{nTop, nBottom, static_cast<std::uint32_t>(nFirst), nCount});
+}
+
+/**
+ * @brief 2つの領域の演算結果を this に設定します。
+ * @details 両方の帯の上端・下端で区切った範囲ごとに、その範囲にかかる帯の区間の端を左から順に合わせ、
+ * 演算の結果が「内側」になる区間を書き出します。結果が空と分かっている範囲 (差で a の帯がない範囲など) は飛ばします。
+ */
+void CRectRegion::Combine(const CRectRegion &a, const CRectRegion &b, Operation op)
+{
+    CRectRegion result;
+    result.m_bands.reserve(a.m_bands.size() + b.m_bands.size());
+    result.m_x.reserve(a.m_x.size() + b.m_x.size());
+
+    const std::size_t na = a.m_bands.size();
+    const std::size_t nb = b.m_bands.size();
+    std::size_t ia = 0;
+    std::size_t ib = 0;
+    int y = INT_MIN;
+    for (;;)
+    {
+        if (ia >= na && (op != OP_UNION || ib >= nb))
+            break;
+        if (ib >= nb && op == OP_INTERSECT)
+            break;
+        const int yA = ia < na ? a.m_bands[ia].nTop : INT_MAX;
+        const int yB = ib < nb ? b.m_bands[ib].nTop : INT_MAX;
+        y = (std::max)(y, (std::min)(yA, yB));
+        const bool bActiveA = ia < na && yA <= y;
+        const bool bActiveB = ib < nb && yB <= y;
+        const int yNext = (std::min)(bActiveA ? a.m_bands[ia].nBottom : yA, bActiveB ? b.m_bands[ib].nBottom : yB);
+
+        const bool bProduce = op == OP_UNION ? (bActiveA || bActiveB) : op == OP_SUBTRACT ? bActiveA : (bActiveA && bActiveB);
+        if (bProduce)
+        {
+            const int *pA = bActiveA ? a.m_x.data() + a.m_bands[ia].nFirst : nullptr;
+            const int *pEndA = bActiveA ? pA + 2 * a.m_bands[ia].nCount : nullptr;
+            const int *pB = bActiveB ? b.m_x.data() + b.m_bands[ib].nFirst : nullptr;
+            const int *pEndB = bActiveB ? pB + 2 * b.m_bands[ib].nCount : nullptr;
+            const std::size_t nFirst = result.m_x.size();
+            bool bInA = false;
+            bool bInB = false;
+            bool bInResult = false;
+            while (pA != pEndA || pB != pEndB)
+            {
+                const int x = (std::min)(pA != pEndA ? *pA : INT_MAX, pB != pEndB ? *pB : INT_MAX);
+                if (pA != pEndA && *pA == x)
+                {
+                    bInA = !bInA;
+                    ++pA;
+                }
+                if (pB != pEndB && *pB == x)
+                {
+                    bInB = !bInB;
+                    ++pB;
+                }
+                const bool bIn = op == OP_UNION ? (bInA || bInB) : op == OP_SUBTRACT ? (bInA && !bInB) : (bInA && bInB);
+                if (bIn != bInResult)
+                {
+                    result.m_x.push_back(x);
+                    bInResult = bIn;
+                }
+            }
+            result.AppendBand(y, yNext, nFirst);
+        }
+
+        if (bActiveA && a.m_bands[ia].nBottom == yNext)
+            ++ia;
+        if (bActiveB && b.m_bands[ib].nBottom == yNext)
+            ++ib;
+        y = yNext;
+    }
+    m_bands.swap(result.m_bands);
+    m_x.swap(result.m_x);
+}
+
+#ifdef _WIN32
+/**
+ * @brief 同じ領域のGDIのリージョンを作ります。
+ * @details 矩形の並びから RGNDATA を組み立て、ExtCreateRegion で一度に作ります。
+ */
+HRGN CRectRegion::CreateHrgn() const
+{
+    const std::size_t nRects = GetRectCount();
+    std::vector<unsigned char> buffer(sizeof(RGNDATAHEADER) + (std::max)(nRects, std::size_t(1)) * sizeof(RECT));
+    RGNDATA *pData = reinterpret_cast<RGNDATA *>(buffer.data());
+    pData->rdh.dwSize = sizeof(RGNDATAHEADER);
+    pData->rdh.iType = RDH_RECTANGLES;
+    pData->rdh.nCount = static_cast<DWORD>(nRects);
+    pData->rdh.nRgnSize = static_cast<DWORD>(nRects * sizeof(RECT));
+    const REGION_RECT bounds = GetBounds();
+    pData->rdh.rcBound = RECT{bounds.left, bounds.top, bounds.right, bounds.bottom};
+    RECT *pRects = reinterpret_cast<RECT *>(pData->Buffer);
+    for (const BAND &band : m_bands)
+    {
+        for (std::uint32_t i = 0; i < band.nCount; ++i)
+            *pRects++ = RECT{m_x[band.nFirst + 2 * i], band.nTop, m_x[band.nFirst + 2 * i + 1], band.nBottom};
+    }
+    return ::ExtCreateRegion(nullptr, static_cast<DWORD>(buffer.size()), pData);
+}
+#endif
+
+/**
+ * @brief CClipRegionCacheクラスのコンストラクタ
+ */
+CClipRegionCache::CClipRegionCache(std::size_t nCapacity) : m_nCapacity((std::max)(nCapacity, std::size_t(1))), m_stats{}
+{
+}
+
+/**
+ * @brief 基準の矩形から重なる矩形を差し引いた領域を返します。
+ * @details 重なる矩形は和を取ってから一度に差し引きます。
+ */
+const CRectRegion &CClipRegionCache::GetClip(const REGION_RECT &rcBase, const REGION_RECT *pOccluders, int nCount)
+{
+    ++m_stats.nLookups;
+    m_key.clear();
+    m_key.insert(m_key.end(), {rcBase.left, rcBase.top, rcBase.right, rcBase.bottom});
+    for (int i = 0; i < nCount; ++i)
+        m_key.insert(m_key.end(), {pOccluders[i].left, pOccluders[i].top, pOccluders[i].right, pOccluders[i].bottom});
+
+    for (ENTRY &entry : m_entries)
+    {
+        if (entry.key == m_key)
+        {
+            ++m_stats.nHits;
+            entry.nLastUse = m_stats.nLookups;
+            return entry.region;
+        }
+    }
+
+    ++m_stats.nComputes;
+    CRectRegion occluders;
+    occluders.SetRects(pOccluders, static_cast<std::size_t>((std::max)(nCount, 0)));
+    CRectRegion region(rcBase);
+    region.Subtract(occluders);
+
+    ENTRY *pEntry = nullptr;
+    if (m_entries.size() < m_nCapacity)
+    {
+        m_entries.emplace_back();
+        pEntry = &m_entries.back();
+    }
+    else
+    {
+        pEntry = &*std::min_element(m_entries.begin(), m_entries.end(),
+                                    [](const ENTRY &x, const ENTRY &y) { return x.nLastUse < y.nLastUse; });
+    }
+    pEntry->key = m_key;
+    pEntry->region = std::move(region);
+    pEntry->nLastUse = m_stats.nLookups;
+    return pEntry->region;
+}
+
+/**
+ * @brief CWindowRegionStateクラスのコンストラクタ
+ */
+CWindowRegionState::CWindowRegionState() : m_bApplied(false), m_nApplies(0), m_nSkips(0)
+{
+}
+
+/**
+ * @brief 新しい領域を設定する必要があるかを判定し、必要なら設定済みとして記録します。
+ */
+bool CWindowRegionState::Update(const CRectRegion &region)
+{
+    if (m_bApplied && region == m_applied)
+    {
+        ++m_nSkips;
+        return false;
+    }
+    m_applied = region;
+    m_bApplied = true;
+    ++m_nApplies;
+    return true;
+}
+
+/**
+ * @brief 領域が設定済みのものと異なる場合だけ、設定する関数を呼び出します。
+ */
+bool CWindowRegionState::Apply(const CRectRegion &region, const ApplyFunc &apply)
+{
+    if (!Update(region))
+        return false;
+    if (apply)
+        apply(region);
+    return true;
+}
@@ -0,0 +1,224 @@
+﻿/**
+ * @file RectRegion.h
+ * @brief 矩形の集合で表した領域の演算と、クリッピング領域のキャッシュのクラス宣言
+ * @details 領域は、Y方向に重ならない帯 (バンド) の並びと、各帯の中のX方向に重ならない区間の並びで表します
+ * (GDIのリージョンと同じ Y-X 帯表現)。和・差・積は、両方の帯の境界を上から順にたどり、
+ * 帯ごとに区間の端を左から順に合わせて求めます。計算量は両方の矩形数の和に比例します。
+ * 演算の結果は、区間の並びが同じ隣り合う帯を必ず1つにまとめるため、同じ領域は常に同じ表現になり、
+ * operator== で比べられます。
+ * CClipRegionCache は「基準の矩形から重なる矩形を差し引いた領域」を、参加する矩形の組ごとにキャッシュします。
+ * CWindowRegionState は、ウィンドウに設定済みの領域を覚え、領域が変わった場合だけ設定 (SetWindowRgn) させます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+/**
+ * @struct REGION_RECT
+ * @brief 領域の矩形 (右端と下端は含みません)
+ */
+struct REGION_RECT
+{
+    int left;   ///< 左端
+    int top;    ///< 上端
+    int right;  ///< 右端
+    int bottom; ///< 下端
+};
+
+/**
+ * @class CRectRegion
+ * @brief 帯に分けた矩形の集合で表した領域
+ */
+class CRectRegion
+{
+public:
+    /// @brief 空の領域を作ります。
+    CRectRegion() = default;
+    /// @brief 1つの矩形の領域を作ります (幅か高さが0以下なら空)。
+    explicit CRectRegion(const REGION_RECT &rect);
+
+    /// @brief 1つの矩形の領域にします (幅か高さが0以下なら空)。
+    void SetRect(const REGION_RECT &rect);
+    /**
+     * @brief 矩形の並びの和の領域にします。
+     * @details 2つずつ和を取る組を倍々に大きくしていくため、n 個の矩形を1つずつ Union() するより速く求められます。
+     * @param[in] pRects 矩形の並び (重なっていてもかまいません)
+     * @param[in] nCount 矩形の数
+     */
+    void SetRects(const REGION_RECT *pRects, std::size_t nCount);
+    /// @brief 空の領域にします。
+    void Clear();
+
+    /// @brief 領域が空かを返します。
+    bool IsEmpty() const { return m_bands.empty(); }
+    /// @brief 領域を囲む最小の矩形を返します (空の場合は全て0)。
+    REGION_RECT GetBounds() const;
+    /// @brief 領域の面積 (ピクセル数) を返します。
+    std::uint64_t GetArea() const;
+    /// @brief 領域を表す矩形の数を返します。
+    std::size_t GetRectCount() const { return m_x.size() / 2; }
+    /// @brief 領域を上から下、左から右の順の矩形の並びにします。
+    void GetRects(std::vector<REGION_RECT> &rects) const;
+    /// @brief 点が領域に含まれるかを返します。
+    bool Contains(int x, int y) const;
+
+    /// @brief 他の領域との和にします。
+    void Union(const CRectRegion &other);
+    /// @brief 他の領域を差し引きます。
+    void Subtract(const CRectRegion &other);
+    /// @brief 他の領域との積 (共通部分) にします。
+    void Intersect(const CRectRegion &other);
+    /// @brief 領域を平行移動します。
+    void Offset(int dx, int dy);
+
+    bool operator==(const CRectRegion &other) const { return m_bands == other.m_bands && m_x == other.m_x; }
+    bool operator!=(const CRectRegion &other) const { return !(*this == other); }
+
+#ifdef _WIN32
+    /**
+     * @brief 同じ領域のGDIのリージョンを作ります。
+     * @return リージョンのハンドル (呼び出し側が所有します。失敗した場合はnullptr)
+     */
+    HRGN CreateHrgn() const;
+#endif
+
+private:
+    /// @brief 演算の種類
+    enum Operation
+    {
+        OP_UNION,     ///< 和
+        OP_SUBTRACT,  ///< 差
+        OP_INTERSECT  ///< 積
+    };
+
+    /// @brief Y方向の帯 (区間は m_x[nFirst] から 2*nCount 個の左端・右端の並び)
+    struct BAND
+    {
+        int nTop;            ///< 上端
+        int nBottom;         ///< 下端
+        std::uint32_t nFirst; ///< 最初の区間の m_x での位置
+        std::uint32_t nCount; ///< 区間の数
+
+        bool operator==(const BAND &other) const
+        {
+            return nTop == other.nTop && nBottom == other.nBottom && nFirst == other.nFirst && nCount == other.nCount;
+        }
+    };
+
+    /// @brief 2つの領域の演算結果を this に設定します (this が a や b と同じでもかまいません)。
+    void Combine(const CRectRegion &a, const CRectRegion &b, Operation op);
+    /// @brief 帯を末尾に追加します。区間が直前の帯と同じで隣り合っていれば、直前の帯を延ばします。
+    void AppendBand(int nTop, int nBottom, std::size_t nFirst);
+
+    std::vector<BAND> m_bands; ///< 帯 (上から順)
+    std::vector<int> m_x;      ///< 全ての帯の区間の左端・右端 (帯ごとに左から順)
+};
+
+/**
+ * @class CClipRegionCache
+ * @brief 「基準の矩形から重なる矩形を差し引いた領域」のキャッシュ
+ * @details 参加する矩形 (基準と重なる矩形の並び) が前回までと同じ組であれば、計算せずに保存済みの領域を返します。
+ * 登録数が上限を超えた場合は、最も長く使われていない登録を置き換えます。
+ */
+class CClipRegionCache
+{
+public:
+    /// @brief 登録数の上限の既定値
+    static constexpr std::size_t DEFAULT_CAPACITY = 16;
+
+    /**
+     * @struct Stats
+     * @brief キャッシュの累計回数
+     */
+    struct Stats
+    {
+        std::uint64_t nLookups;  ///< 参照回数
+        std::uint64_t nHits;     ///< 保存済みの領域を返した回数
+        std::uint64_t nComputes; ///< 領域を計算した回数
+    };
+
+    explicit CClipRegionCache(std::size_t nCapacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief 基準の矩形から重なる矩形を差し引いた領域を返します。
+     * @details 返した参照は、次にこのキャッシュを呼び出すまで有効です。
+     * @param[in] rcBase 基準の矩形
+     * @param[in] pOccluders 差し引く矩形の並び
+     * @param[in] nCount 差し引く矩形の数
+     */
+    const CRectRegion &GetClip(const REGION_RECT &rcBase, const REGION_RECT *pOccluders, int nCount);
+
+    /// @brief 全ての登録を削除します。
+    void Clear() { m_entries.clear(); }
+    /// @brief 累計回数を返します。
+    const Stats &GetStats() const { return m_stats; }
+
+private:
+    /// @brief キャッシュの登録
+    struct ENTRY
+    {
+        std::vector<int> key;      ///< 参加する矩形の座標 (基準、重なる矩形の順)
+        CRectRegion region;        ///< 計算した領域
+        std::uint64_t nLastUse;    ///< 最後に使った時刻 (参照回数)
+    };
+
+    std::size_t m_nCapacity;      ///< 登録数の上限
+    std::vector<ENTRY> m_entries; ///< 登録
+    std::vector<int> m_key;       ///< 参照のキーの作業領域
+    Stats m_stats;                ///< 累計回数
+};
+
+/**
+ * @class CWindowRegionState
+ * @brief ウィンドウに設定済みの領域を覚え、変わった場合だけ設定させるクラス
+ * @details ウィンドウの領域の設定 (SetWindowRgn) はウィンドウ全体を描き直させるため、同じ領域では設定しません。
+ * 設定そのものは呼び出し側の関数で行うため、Windows以外の環境でも設定の回数を確認できます。
+ */
+class CWindowRegionState
+{
+public:
+    /**
+     * @brief ウィンドウに領域を設定する関数 (Windowsでは SetWindowRgn を呼び出します)
+     * @param[in] region 設定する領域 (ウィンドウ座標)
+     */
+    using ApplyFunc = std::function<void(const CRectRegion &region)>;
+
+    CWindowRegionState();
+
+    /**
+     * @brief 新しい領域を設定する必要があるかを判定し、必要なら設定済みとして記録します。
+     * @param[in] region 新しい領域
+     * @return 設定が必要な場合はtrue (設定済みの領域と同じであればfalse)
+     */
+    bool Update(const CRectRegion &region);
+
+    /**
+     * @brief 領域が設定済みのものと異なる場合だけ、設定する関数を呼び出します。
+     * @param[in] region 新しい領域
+     * @param[in] apply 領域を設定する関数
+     * @return 設定した場合はtrue
+     */
+    bool Apply(const CRectRegion &region, const ApplyFunc &apply);
+
+    /// @brief 設定済みの領域が失われたことを記録し (ウィンドウの再作成など)、次の Update() で設定を強制します。
+    void Invalidate() { m_bApplied = false; }
+
+    /// @brief 設定が必要だった回数を返します。
+    std::uint64_t GetApplyCount() const { return m_nApplies; }
+    /// @brief 同じ領域のため設定を省いた回数を返します。
+    std::uint64_t GetSkipCount() const { return m_nSkips; }
+
+private:
+    CRectRegion m_applied;  ///< 設定済みの領域
+    bool m_bApplied;        ///< m_applied を設定済みか
+    std::uint64_t m_nApplies; ///< 設定が必要だった回数
+    std::uint64_t m_nSkips;   ///< 設定を省いた回数
+};
@@ -0,0 +1,499 @@
+﻿/**
+ * @file RenderTarget.cpp
+ * @brief 描画先の抽象化とソフトウェア描画・GDI描画の実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリ (Windowsでは Windows.h) のみに依存します。
+ */
+#include "RenderTarget.h"
+#include "GdiResourceCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <fstream>
+
+namespace
+{
+/// @brief 矩形の太さ nWidth の線が中心線から左 (上) に広がる量
+int PenLow(int nWidth)
+{
+    return -(nWidth / 2);
+}
+
+/// @brief 省略記号の文字数
+constexpr int ELLIPSIS_LENGTH = 3;
+
+/// @brief ソフトウェア描画の描画状態が未設定であることを表す値
+constexpr std::uint32_t STATE_UNSET = 0xFFFFFFFFu;
+
+/// @brief ソフトウェア描画のペンの状態 (色と太さ) を1つの値にまとめます。
+std::uint32_t PenState(RenderColor color, int nWidth)
+{
+    return (color & 0x00FFFFFFu) | (static_cast<std::uint32_t>(nWidth & 0x7F) << 24);
+}
+}
+
+// --- CSoftwareRenderTarget ---
+
+/**
+ * @brief コンストラクタ
+ */
+CSoftwareRenderTarget::CSoftwareRenderTarget(int nWidth, int nHeight, int nCharWidth, int nCharHeight)
+    : m_nWidth(0), m_nHeight(0), m_nCharWidth((std::max)(1, nCharWidth)), m_nCharHeight((std::max)(1, nCharHeight)),
+      m_fillColor(STATE_UNSET), m_pen(STATE_UNSET), m_textColor(STATE_UNSET), m_font(0)
+{
+    Resize(nWidth, nHeight);
+}
+
+/**
+ * @brief 大きさを変えます。
+ */
+void CSoftwareRenderTarget::Resize(int nWidth, int nHeight)
+{
+    m_nWidth = (std::max)(0, nWidth);
+    m_nHeight = (std::max)(0, nHeight);
+    m_pixels.assign(static_cast<std::size_t>(m_nWidth) * m_nHeight, 0);
+}
+
+/**
+ * @brief 矩形を単色で塗りつぶします。
+ */
+void CSoftwareRenderTarget::FillRect(const REGION_RECT &rect, RenderColor color)
+{
+    ++m_stats.nFills;
+    ChangeState(m_fillColor, color);
+    Fill(rect.left, rect.top, rect.right, rect.bottom, color);
+}
+
+/**
+ * @brief 折れ線を描画します。
+ * @details 水平・垂直の線分は太さの分の矩形を塗りつぶし、斜めの線分はブレゼンハムの方法でたどった各点に
+ * 太さの大きさの正方形を塗ります。各線分の終点は描画しません (次の線分の始点として描画されます)。
+ */
+void CSoftwareRenderTarget::DrawPolyline(const RENDER_POINT *pPoints, int nCount, RenderColor color, int nWidth)
+{
+    const int nPen = (std::max)(1, nWidth);
+    const int nLow = PenLow(nPen);
+    if (nCount >= 2)
+        ChangeState(m_pen, PenState(color, nPen));
+    for (int i = 0; i + 1 < nCount; ++i)
+    {
+        ++m_stats.nLines;
+        const RENDER_POINT p0 = pPoints[i];
+        const RENDER_POINT p1 = pPoints[i + 1];
+        if (p0.y == p1.y)
+        {
+            // 水平: 終点を除く区間 [始点, 終点) を塗る
+            const int xFirst = p1.x >= p0.x ? p0.x : p1.x + 1;
+            const int xLast = p1.x >= p0.x ? p1.x : p0.x + 1;
+            if (xFirst < xLast)
+                Fill(xFirst + nLow, p0.y + nLow, xLast - 1 + nLow + nPen, p0.y + nLow + nPen, color);
+        }
+        else if (p0.x == p1.x)
+        {
+            // 垂直
+            const int yFirst = p1.y >= p0.y ? p0.y : p1.y + 1;
+            const int yLast = p1.y >= p0.y ? p1.y : p0.y + 1;
+            Fill(p0.x + nLow, yFirst + nLow, p0.x + nLow + nPen, yLast - 1 + nLow + nPen, color);
+        }
+        else
+        {
+            // 斜め: ブレゼンハムの方法
+            const int dx = std::abs(p1.x - p0.x);
+            const int dy = -std::abs(p1.y - p0.y);
+            const int sx = p0.x < p1.x ? 1 : -1;
+            const int sy = p0.y < p1.y ? 1 : -1;
+            int nError = dx + dy;
+            int x = p0.x;
+            int y = p0.y;
+            while (x != p1.x || y != p1.y)
+            {
+                Fill(x + nLow, y + nLow, x + nLow + nPen, y + nLow + nPen, color);
+                const int e2 = 2 * nError;
+                if (e2 >= dy)
+                {
+                    nError += dy;
+                    x += sx;
+                }
+                if (e2 <= dx)
+                {
+                    nError += dx;
+                    y += sy;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief 矩形の枠を描画します。
+ */
+void CSoftwareRenderTarget::DrawFrame(const REGION_RECT &rect, RenderColor color, int nWidth)
+{
+    ++m_stats.nLines;
+    const int nPen = (std::max)(1, nWidth);
+    ChangeState(m_pen, PenState(color, nPen));
+    if (rect.right <= rect.left || rect.bottom <= rect.top)
+        return;
+    const int nLow = PenLow(nPen);
+    const int nHigh = nLow + nPen;
+    const int nRight = rect.right - 1;
+    const int nBottom = rect.bottom - 1;
+    Fill(rect.left + nLow, rect.top + nLow, nRight + nHigh, rect.top + nHigh, color);    // 上
+    Fill(rect.left + nLow, nBottom + nLow, nRight + nHigh, nBottom + nHigh, color);      // 下
+    Fill(rect.left + nLow, rect.top + nHigh, rect.left + nHigh, nBottom + nLow, color);  // 左
+    Fill(nRight + nLow, rect.top + nHigh, nRight + nHigh, nBottom + nLow, color);        // 右
+}
+
+/**
+ * @brief 文字列を矩形の中に1行で描画します。
+ * @details 文字ごとに固定の大きさの文字枠を並べます。省略記号を指定して収まらない場合は、
+ * 収まる文字数まで切り詰めて「...」を続けます。文字色と太字の指定は描画状態として数えます。
+ */
+void CSoftwareRenderTarget::DrawString(const wchar_t *pszText, int nLength, const REGION_RECT &rect, RenderColor color, unsigned nFormat)
+{
+    ++m_stats.nTexts;
+    const bool bBold = (nFormat & RENDER_TEXT_BOLD) != 0;
+    ChangeState(m_textColor, color);
+    ChangeState(m_font, bBold ? 1 : 0);
+    if (pszText == nullptr)
+        return;
+    const int nChars = nLength < 0 ? static_cast<int>(std::wcslen(pszText)) : nLength;
+    const int nRectWidth = rect.right - rect.left;
+    int nDrawn = nChars;
+    int nEllipsis = 0;
+    if ((nFormat & RENDER_TEXT_END_ELLIPSIS) != 0 && nChars * m_nCharWidth > nRectWidth)
+    {
+        nDrawn = (std::max)(0, (nRectWidth - ELLIPSIS_LENGTH * m_nCharWidth) / m_nCharWidth);
+        nEllipsis = ELLIPSIS_LENGTH;
+    }
+    const int nTextWidth = (nDrawn + nEllipsis) * m_nCharWidth;
+
+    int x = rect.left;
+    if ((nFormat & RENDER_TEXT_CENTER) != 0)
+        x = rect.left + (nRectWidth - nTextWidth) / 2;
+    else if ((nFormat & RENDER_TEXT_RIGHT) != 0)
+        x = rect.right - nTextWidth;
+    int y = rect.top;
+    if ((nFormat & RENDER_TEXT_VCENTER) != 0)
+        y = rect.top + (rect.bottom - rect.top - m_nCharHeight) / 2;
+    else if ((nFormat & RENDER_TEXT_BOTTOM) != 0)
+        y = rect.bottom - m_nCharHeight;
+
+    for (int i = 0; i < nDrawn; ++i, x += m_nCharWidth)
+        FillGlyph(pszText[i], x, y, rect, color, bBold);
+    for (int i = 0; i < nEllipsis; ++i, x += m_nCharWidth)
+        FillGlyph(L'.', x, y, rect, color, bBold);
+}
+
+/**
+ * @brief 他のソフトウェア描画先の矩形を転送します。
+ * @details 転送元と転送先が同じ描画先で重なっていても、正しく転送します。
+ */
+bool CSoftwareRenderTarget::Blit(int x, int y, int cx, int cy, const CRenderTarget &source, int xSrc, int ySrc)
+{
+    const CSoftwareRenderTarget *pSource = dynamic_cast<const CSoftwareRenderTarget *>(&source);
+    if (pSource == nullptr)
+        return false;
+    ++m_stats.nBlits;
+
+    // 転送元と転送先の両方の範囲に切り詰める
+    if (x < 0) { cx += x; xSrc -= x; x = 0; }
+    if (y < 0) { cy += y; ySrc -= y; y = 0; }
+    if (xSrc < 0) { cx += xSrc; x -= xSrc; xSrc = 0; }
+    if (ySrc < 0) { cy += ySrc; y -= ySrc; ySrc = 0; }
+    cx = (std::min)({ cx, m_nWidth - x, pSource->m_nWidth - xSrc });
+    cy = (std::min)({ cy, m_nHeight - y, pSource->m_nHeight - ySrc });
+    if (cx <= 0 || cy <= 0)
+        return true;
+
+    const bool bBottomUp = pSource == this && ySrc < y;
+    for (int i = 0; i < cy; ++i)
+    {
+        const int nRow = bBottomUp ? cy - 1 - i : i;
+        std::memmove(&m_pixels[static_cast<std::size_t>(y + nRow) * m_nWidth + x],
+                     &pSource->m_pixels[static_cast<std::size_t>(ySrc + nRow) * pSource->m_nWidth + xSrc], cx * sizeof(RenderColor));
+    }
+    return true;
+}
+
+/**
+ * @brief ピクセルの色を返します。
+ */
+RenderColor CSoftwareRenderTarget::GetPixel(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= m_nWidth || y >= m_nHeight)
+        return 0;
+    return m_pixels[static_cast<std::size_t>(y) * m_nWidth + x];
+}
+
+/**
+ * @brief 大きさとピクセルから求めた64ビットのハッシュ値 (FNV-1a) を返します。
+ */
+std::uint64_t CSoftwareRenderTarget::GetChecksum() const
+{
+    std::uint64_t nHash = 14695981039346656037ull;
+    auto mix = [&nHash](std::uint32_t nValue) {
+        for (int i = 0; i < 4; ++i)
+        {
+            nHash ^= (nValue >> (i * 8)) & 0xFF;
+            nHash *= 1099511628211ull;
+        }
+    };
+    mix(static_cast<std::uint32_t>(m_nWidth));
+    mix(static_cast<std::uint32_t>(m_nHeight));
+    for (RenderColor color : m_pixels)
+        mix(color);
+    return nHash;
+}
+
+/**
+ * @brief 24ビットのBMP形式のファイルに書き出します。
+ */
+bool CSoftwareRenderTarget::SaveBmp(const char *pszPath) const
+{
+    std::ofstream file(pszPath, std::ios::binary);
+    if (!file)
+        return false;
+
+    const std::uint32_t nStride = (static_cast<std::uint32_t>(m_nWidth) * 3 + 3) & ~3u;
+    const std::uint32_t nImageSize = nStride * static_cast<std::uint32_t>(m_nHeight);
+    std::uint8_t header[54] = {};
+    auto put16 = [&header](int nOffset, std::uint32_t nValue) {
+        header[nOffset] = static_cast<std::uint8_t>(nValue);
+        header[nOffset + 1] = static_cast<std::uint8_t>(nValue >> 8);
+    };
+    auto put32 = [&put16](int nOffset, std::uint32_t nValue) {
+        put16(nOffset, nValue & 0xFFFF);
+        put16(nOffset + 2, nValue >> 16);
+    };
+    header[0] = 'B';
+    header[1] = 'M';
+    put32(2, 54 + nImageSize);                        // ファイルサイズ
+    put32(10, 54);                                    // 画素データの位置
+    put32(14, 40);                                    // 情報ヘッダーのサイズ
+    put32(18, static_cast<std::uint32_t>(m_nWidth));  // 幅
+    put32(22, static_cast<std::uint32_t>(m_nHeight)); // 高さ (下の行から)
+    put16(26, 1);                                     // プレーン数
+    put16(28, 24);                                    // ビット数
+    put32(34, nImageSize);
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+    std::vector<std::uint8_t> row(nStride, 0);
+    for (int y = m_nHeight - 1; y >= 0; --y)
+    {
+        for (int x = 0; x < m_nWidth; ++x)
+        {
+            const RenderColor color = m_pixels[static_cast<std::size_t>(y) * m_nWidth + x];
+            row[x * 3] = static_cast<std::uint8_t>(color >> 16);    // 青
+            row[x * 3 + 1] = static_cast<std::uint8_t>(color >> 8); // 緑
+            row[x * 3 + 2] = static_cast<std::uint8_t>(color);      // 赤
+        }
+        file.write(reinterpret_cast<const char *>(row.data()), nStride);
+    }
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief 描画先の範囲に切り詰めた矩形を塗りつぶします。
+ */
+void CSoftwareRenderTarget::Fill(int left, int top, int right, int bottom, RenderColor color)
+{
+    left = (std::max)(left, 0);
+    top = (std::max)(top, 0);
+    right = (std::min)(right, m_nWidth);
+    bottom = (std::min)(bottom, m_nHeight);
+    if (left >= right || top >= bottom)
+        return;
+    for (int y = top; y < bottom; ++y)
+    {
+        RenderColor *pRow = &m_pixels[static_cast<std::size_t>(y) * m_nWidth];
+        std::fill(pRow + left, pRow + right, color);
+    }
+}
+
+/**
+ * @brief 文字枠を1つ描画します。
+ * @details 空白は何も描画せず、「.」は文字枠の下端近くの小さな点、それ以外は上下に余白を残した矩形を塗ります。
+ * 太字は右と上に1ピクセルずつ広げます。描画は文字列の矩形の中に切り詰めます。
+ */
+void CSoftwareRenderTarget::FillGlyph(wchar_t ch, int x, int y, const REGION_RECT &clip, RenderColor color, bool bBold)
+{
+    int left = x;
+    int top = y + (bBold ? 1 : 2);
+    int right = x + m_nCharWidth - (bBold ? 0 : 1);
+    int bottom = y + m_nCharHeight - 2;
+    if (ch == L' ' || ch == L'\t')
+        return;
+    if (ch == L'.')
+    {
+        left = x + m_nCharWidth / 2 - 1;
+        right = left + 2;
+        top = bottom - 2;
+    }
+    Fill((std::max)(left, clip.left), (std::max)(top, clip.top), (std::min)(right, clip.right), (std::min)(bottom, clip.bottom), color);
+}
+
+/**
+ * @brief 描画状態を設定し、変わった場合は切り替えの回数を数えます。
+ */
+void CSoftwareRenderTarget::ChangeState(std::uint32_t &current, std::uint32_t value)
+{
+    if (current == value)
+        return;
+    current = value;
+    ++m_stats.nStateChanges;
+}
+
+#ifdef _WIN32
+// --- CGdiRenderTarget ---
+
+/**
+ * @brief コンストラクタ
+ * @details GDIオブジェクトのキャッシュのフレームを開き、デバイスコンテキストの元の状態を記録します。
+ * 文字列は背景を塗らずに描画します。
+ */
+CGdiRenderTarget::CGdiRenderTarget(HDC hDC, int nWidth, int nHeight)
+    : m_hDC(hDC), m_nWidth(nWidth), m_nHeight(nHeight), m_hBoldFont(nullptr), m_bBold(false), m_hPen(nullptr)
+{
+    CGdiResourceCache::BeginFrame();
+    m_hOldPen = ::GetCurrentObject(m_hDC, OBJ_PEN);
+    m_hOldFont = ::GetCurrentObject(m_hDC, OBJ_FONT);
+    m_oldTextColor = ::GetTextColor(m_hDC);
+    m_oldBkColor = ::GetBkColor(m_hDC);
+    m_nOldBkMode = ::SetBkMode(m_hDC, TRANSPARENT);
+    m_textColor = m_oldTextColor;
+    m_bkColor = m_oldBkColor;
+}
+
+/**
+ * @brief デストラクタ
+ * @details デバイスコンテキストを元の状態に戻し、キャッシュのフレームを閉じます。
+ */
+CGdiRenderTarget::~CGdiRenderTarget()
+{
+    if (m_hPen != nullptr)
+        ::SelectObject(m_hDC, m_hOldPen);
+    if (m_bBold)
+        ::SelectObject(m_hDC, m_hOldFont);
+    ::SetTextColor(m_hDC, m_oldTextColor);
+    ::SetBkColor(m_hDC, m_oldBkColor);
+    ::SetBkMode(m_hDC, m_nOldBkMode);
+    CGdiResourceCache::EndFrame();
+}
+
+/**
+ * @brief 矩形を単色で塗りつぶします。
+ * @details CDC::FillSolidRect と同じく、背景色を設定して ExtTextOut で塗りつぶします (ブラシを使いません)。
+ */
+void CGdiRenderTarget::FillRect(const REGION_RECT &rect, RenderColor color)
+{
+    ++m_stats.nFills;
+    if (m_bkColor != color)
+    {
+        ::SetBkColor(m_hDC, color);
+        m_bkColor = color;
+        ++m_stats.nStateChanges;
+    }
+    const RECT rc = { rect.left, rect.top, rect.right, rect.bottom };
+    ::ExtTextOutW(m_hDC, 0, 0, ETO_OPAQUE, &rc, nullptr, 0, nullptr);
+}
+
+/**
+ * @brief 折れ線を描画します。
+ */
+void CGdiRenderTarget::DrawPolyline(const RENDER_POINT *pPoints, int nCount, RenderColor color, int nWidth)
+{
+    if (nCount < 2)
+        return;
+    SelectPen(color, nWidth);
+    ::MoveToEx(m_hDC, pPoints[0].x, pPoints[0].y, nullptr);
+    for (int i = 1; i < nCount; ++i)
+        ::LineTo(m_hDC, pPoints[i].x, pPoints[i].y);
+    m_stats.nLines += static_cast<std::uint64_t>(nCount - 1);
+}
+
+/**
+ * @brief 矩形の枠を描画します。
+ */
+void CGdiRenderTarget::DrawFrame(const REGION_RECT &rect, RenderColor color, int nWidth)
+{
+    ++m_stats.nLines;
+    SelectPen(color, nWidth);
+    HGDIOBJ hOldBrush = ::SelectObject(m_hDC, ::GetStockObject(NULL_BRUSH));
+    ::Rectangle(m_hDC, rect.left, rect.top, rect.right, rect.bottom);
+    ::SelectObject(m_hDC, hOldBrush);
+}
+
+/**
+ * @brief 文字列を矩形の中に1行で描画します。
+ * @details 太字は、元のフォントの太さだけを変えたフォントを CGdiResourceCache から取得して選択します。
+ */
+void CGdiRenderTarget::DrawString(const wchar_t *pszText, int nLength, const REGION_RECT &rect, RenderColor color, unsigned nFormat)
+{
+    ++m_stats.nTexts;
+    if (m_textColor != color)
+    {
+        ::SetTextColor(m_hDC, color);
+        m_textColor = color;
+        ++m_stats.nStateChanges;
+    }
+    const bool bBold = (nFormat & RENDER_TEXT_BOLD) != 0;
+    if (bBold != m_bBold)
+    {
+        if (bBold && m_hBoldFont == nullptr)
+        {
+            LOGFONTW logFont = {};
+            ::GetObjectW(m_hOldFont, sizeof(logFont), &logFont);
+            logFont.lfWeight = FW_BOLD;
+            m_hBoldFont = reinterpret_cast<HGDIOBJ>(CGdiResourceCache::Get(GDI_RESOURCE_KEY::Font(logFont)));
+        }
+        if (!bBold || m_hBoldFont != nullptr)
+        {
+            ::SelectObject(m_hDC, bBold ? m_hBoldFont : m_hOldFont);
+            m_bBold = bBold;
+            ++m_stats.nStateChanges;
+        }
+    }
+    UINT uFormat = DT_SINGLELINE | DT_NOPREFIX;
+    if ((nFormat & RENDER_TEXT_CENTER) != 0)
+        uFormat |= DT_CENTER;
+    else if ((nFormat & RENDER_TEXT_RIGHT) != 0)
+        uFormat |= DT_RIGHT;
+    if ((nFormat & RENDER_TEXT_VCENTER) != 0)
+        uFormat |= DT_VCENTER;
+    else if ((nFormat & RENDER_TEXT_BOTTOM) != 0)
+        uFormat |= DT_BOTTOM;
+    if ((nFormat & RENDER_TEXT_END_ELLIPSIS) != 0)
+        uFormat |= DT_END_ELLIPSIS;
+    RECT rc = { rect.left, rect.top, rect.right, rect.bottom };
+    ::DrawTextW(m_hDC, pszText, nLength, &rc, uFormat);
+}
+
+/**
+ * @brief 他のGDI描画先の矩形を転送します。
+ */
+bool CGdiRenderTarget::Blit(int x, int y, int cx, int cy, const CRenderTarget &source, int xSrc, int ySrc)
+{
+    const CGdiRenderTarget *pSource = dynamic_cast<const CGdiRenderTarget *>(&source);
+    if (pSource == nullptr)
+        return false;
+    ++m_stats.nBlits;
+    ::BitBlt(m_hDC, x, y, cx, cy, pSource->m_hDC, xSrc, ySrc, SRCCOPY);
+    return true;
+}
+
+/**
+ * @brief ペンを選択します。
+ * @details ペンは CGdiResourceCache から取得するため、描画のたびに生成しません。
+ */
+void CGdiRenderTarget::SelectPen(RenderColor color, int nWidth)
+{
+    HGDIOBJ hPen = reinterpret_cast<HGDIOBJ>(CGdiResourceCache::Get(GDI_RESOURCE_KEY::Pen(PS_SOLID, nWidth, color)));
+    if (hPen == m_hPen || hPen == nullptr)
+        return;
+    ::SelectObject(m_hDC, hPen);
+    m_hPen = hPen;
+    ++m_stats.nStateChanges;
+}
+#endif
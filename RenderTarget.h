@@ -0,0 +1,259 @@
+﻿/**
+ * @file RenderTarget.h
+ * @brief カスタムコントロールの描画先 (塗りつぶし・線・文字列・転送) を抽象化したクラスの宣言
+ * @details 描画処理は CRenderTarget の基本操作だけで描画し、実際の描画先は実装クラスで切り替えます。
+ * CGdiRenderTarget はGDIのデバイスコンテキストに描画します (Windowsのみ)。
+ * CSoftwareRenderTarget はメモリ上のビットマップに自前で描画するため、Windowsのデスクトップがなくても
+ * 描画処理を実行して時間を測り、描画結果をピクセル単位で比較できます。
+ * ソフトウェア描画の文字列はフォントを使わず、文字ごとに固定の大きさの文字枠を塗りつぶします
+ * (配置・色・切り詰めは比較できますが、字形は比較できません)。
+ * 各描画先は基本操作の呼び出し回数と描画状態 (ペン・文字色・背景色・フォント) の切り替え回数を数えます。
+ * ソフトウェア描画でもGDIと同じ規則で切り替えを数えるため、描画処理が生むGDIの状態の切り替えをWindows以外でも計測できます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "RectRegion.h"
+
+#include <cstdint>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+/// @brief 描画色 (COLORREF と同じ 0x00BBGGRR の形式)
+using RenderColor = std::uint32_t;
+
+/// @brief 赤・緑・青の成分から描画色を作ります (RGB マクロと同じ値)。
+constexpr RenderColor RenderRgb(int r, int g, int b)
+{
+    return static_cast<RenderColor>((r & 0xFF) | ((g & 0xFF) << 8) | ((b & 0xFF) << 16));
+}
+
+/// @brief 文字列の配置 (横・縦を1つずつ組み合わせます。常に1行で描画し、& は接頭辞として扱いません)
+enum ERenderTextFormat : unsigned
+{
+    RENDER_TEXT_LEFT = 0x00,         ///< 左揃え
+    RENDER_TEXT_CENTER = 0x01,       ///< 左右中央揃え
+    RENDER_TEXT_RIGHT = 0x02,        ///< 右揃え
+    RENDER_TEXT_TOP = 0x00,          ///< 上揃え
+    RENDER_TEXT_VCENTER = 0x04,      ///< 上下中央揃え
+    RENDER_TEXT_BOTTOM = 0x08,       ///< 下揃え
+    RENDER_TEXT_END_ELLIPSIS = 0x10, ///< 収まらない場合は末尾を省略記号にします
+    RENDER_TEXT_BOLD = 0x20          ///< 太字で描画します
+};
+
+/**
+ * @struct RENDER_POINT
+ * @brief 描画先の座標
+ */
+struct RENDER_POINT
+{
+    int x; ///< X座標
+    int y; ///< Y座標
+};
+
+/**
+ * @struct RENDER_TARGET_STATS
+ * @brief 描画先の基本操作の呼び出し回数
+ */
+struct RENDER_TARGET_STATS
+{
+    std::uint64_t nFills;        ///< 塗りつぶしの回数
+    std::uint64_t nLines;        ///< 線分の数 (折れ線は線分ごと、矩形の枠は1回)
+    std::uint64_t nTexts;        ///< 文字列の描画の回数
+    std::uint64_t nBlits;        ///< 転送の回数
+    std::uint64_t nStateChanges; ///< 描画状態 (ペン・文字色・背景色・フォント) を切り替えた回数
+};
+
+/**
+ * @class CRenderTarget
+ * @brief 描画先の基本操作のインターフェース
+ * @details 座標は描画先の左上を原点とするピクセル単位で、矩形の右端と下端は含みません。
+ * 線は GDI の MoveTo / LineTo と同じく、終点のピクセルを描画しません。
+ */
+class CRenderTarget
+{
+public:
+    virtual ~CRenderTarget() = default;
+
+    /// @brief 描画先の幅を返します。
+    virtual int GetWidth() const = 0;
+    /// @brief 描画先の高さを返します。
+    virtual int GetHeight() const = 0;
+
+    /// @brief 矩形を単色で塗りつぶします。
+    virtual void FillRect(const REGION_RECT &rect, RenderColor color) = 0;
+
+    /**
+     * @brief 折れ線を描画します。
+     * @param[in] pPoints 頂点の並び (最後の頂点のピクセルは描画しません)
+     * @param[in] nCount 頂点の数
+     * @param[in] color 線の色
+     * @param[in] nWidth 線の太さ
+     */
+    virtual void DrawPolyline(const RENDER_POINT *pPoints, int nCount, RenderColor color, int nWidth) = 0;
+
+    /**
+     * @brief 矩形の枠を描画します (GDI の Rectangle を中を塗らずに描画した場合と同じ位置)。
+     * @details 枠の中心線は左端・上端と、右端-1・下端-1 を通り、太さの分だけ内外に広がります。
+     */
+    virtual void DrawFrame(const REGION_RECT &rect, RenderColor color, int nWidth) = 0;
+
+    /**
+     * @brief 文字列を矩形の中に1行で描画します (矩形の外にははみ出しません)。
+     * @param[in] pszText 文字列
+     * @param[in] nLength 文字数 (負の値なら終端文字まで)
+     * @param[in] rect 描画する矩形
+     * @param[in] color 文字色
+     * @param[in] nFormat 配置 (ERenderTextFormat の組み合わせ)
+     */
+    virtual void DrawString(const wchar_t *pszText, int nLength, const REGION_RECT &rect, RenderColor color, unsigned nFormat) = 0;
+
+    /**
+     * @brief 他の描画先の矩形をこの描画先に転送します。
+     * @param[in] x 転送先の左端
+     * @param[in] y 転送先の上端
+     * @param[in] cx 幅
+     * @param[in] cy 高さ
+     * @param[in] source 転送元 (同じ種類の描画先)
+     * @param[in] xSrc 転送元の左端
+     * @param[in] ySrc 転送元の上端
+     * @return 転送した場合はtrue (転送元の種類が異なる場合はfalse)
+     */
+    virtual bool Blit(int x, int y, int cx, int cy, const CRenderTarget &source, int xSrc, int ySrc) = 0;
+
+    /// @brief 2点を結ぶ線分を描画します (終点のピクセルは描画しません)。
+    void DrawLine(int x0, int y0, int x1, int y1, RenderColor color, int nWidth = 1)
+    {
+        const RENDER_POINT points[2] = { { x0, y0 }, { x1, y1 } };
+        DrawPolyline(points, 2, color, nWidth);
+    }
+
+    /// @brief 基本操作の呼び出し回数を返します。
+    const RENDER_TARGET_STATS &GetStats() const { return m_stats; }
+    /// @brief 基本操作の呼び出し回数を0に戻します。
+    void ResetStats() { m_stats = RENDER_TARGET_STATS(); }
+
+protected:
+    RENDER_TARGET_STATS m_stats = {}; ///< 基本操作の呼び出し回数
+};
+
+/**
+ * @class CSoftwareRenderTarget
+ * @brief メモリ上の32ビットのビットマップに描画する描画先
+ * @details ピクセルは 0x00BBGGRR の描画色のまま保持します。描画結果は GetChecksum() で期待値と比べるか、
+ * SaveBmp() で画像として書き出して確認できます。
+ * 太字の文字枠は、通常の文字枠より1ピクセル太く塗ります。
+ */
+class CSoftwareRenderTarget : public CRenderTarget
+{
+public:
+    /// @brief 文字枠の幅の既定値 (ダイアログの既定フォントの平均文字幅に相当)
+    static constexpr int DEFAULT_CHAR_WIDTH = 7;
+    /// @brief 文字枠の高さの既定値 (ダイアログの既定フォントの高さに相当)
+    static constexpr int DEFAULT_CHAR_HEIGHT = 13;
+
+    /**
+     * @brief コンストラクタ
+     * @param[in] nWidth 幅
+     * @param[in] nHeight 高さ
+     * @param[in] nCharWidth 文字枠の幅
+     * @param[in] nCharHeight 文字枠の高さ
+     */
+    CSoftwareRenderTarget(int nWidth, int nHeight, int nCharWidth = DEFAULT_CHAR_WIDTH, int nCharHeight = DEFAULT_CHAR_HEIGHT);
+
+    /// @brief 大きさを変えます (内容は黒で初期化します)。
+    void Resize(int nWidth, int nHeight);
+
+    virtual int GetWidth() const override { return m_nWidth; }
+    virtual int GetHeight() const override { return m_nHeight; }
+    virtual void FillRect(const REGION_RECT &rect, RenderColor color) override;
+    virtual void DrawPolyline(const RENDER_POINT *pPoints, int nCount, RenderColor color, int nWidth) override;
+    virtual void DrawFrame(const REGION_RECT &rect, RenderColor color, int nWidth) override;
+    virtual void DrawString(const wchar_t *pszText, int nLength, const REGION_RECT &rect, RenderColor color, unsigned nFormat) override;
+    virtual bool Blit(int x, int y, int cx, int cy, const CRenderTarget &source, int xSrc, int ySrc) override;
+
+    /// @brief ピクセルの色を返します (範囲外は0)。
+    RenderColor GetPixel(int x, int y) const;
+    /// @brief ピクセルの並び (上の行から順、1行は幅と同じ数) を返します。
+    const std::vector<RenderColor> &GetPixels() const { return m_pixels; }
+    /// @brief 大きさとピクセルから求めた64ビットのハッシュ値を返します (描画結果の比較用)。
+    std::uint64_t GetChecksum() const;
+    /// @brief 24ビットのBMP形式のファイルに書き出します。
+    bool SaveBmp(const char *pszPath) const;
+
+private:
+    /// @brief 描画先の範囲に切り詰めた矩形を塗りつぶします (呼び出し回数は数えません)。
+    void Fill(int left, int top, int right, int bottom, RenderColor color);
+    /// @brief 文字枠を1つ描画します。
+    void FillGlyph(wchar_t ch, int x, int y, const REGION_RECT &clip, RenderColor color, bool bBold);
+    /// @brief 描画状態を設定し、変わった場合は切り替えの回数を数えます (GDI描画と同じ数え方)。
+    void ChangeState(std::uint32_t &current, std::uint32_t value);
+
+    int m_nWidth;                      ///< 幅
+    int m_nHeight;                     ///< 高さ
+    int m_nCharWidth;                  ///< 文字枠の幅
+    int m_nCharHeight;                 ///< 文字枠の高さ
+    std::vector<RenderColor> m_pixels; ///< ピクセル
+    std::uint32_t m_fillColor;         ///< 設定中の背景色 (GDIの背景色に相当)
+    std::uint32_t m_pen;               ///< 設定中のペン (色と太さ)
+    std::uint32_t m_textColor;         ///< 設定中の文字色
+    std::uint32_t m_font;              ///< 設定中のフォント (太字なら1)
+};
+
+#ifdef _WIN32
+/**
+ * @class CGdiRenderTarget
+ * @brief GDIのデバイスコンテキストに描画する描画先
+ * @details 描画先は1回の描画 (フレーム) の間だけ構築します。構築中は CGdiResourceCache のフレームを開き、
+ * ペンはキャッシュから取得します。塗りつぶしはブラシを使わず背景色で塗るため、GDIオブジェクトを生成しません。
+ * ペン・文字色・背景色・フォントは変わる場合だけ設定し、破棄時にデバイスコンテキストの元の状態に戻します。
+ * 文字列はデバイスコンテキストに選択されているフォントで描画し、太字はそのフォントを太くしたものをキャッシュから取得します。
+ */
+class CGdiRenderTarget : public CRenderTarget
+{
+public:
+    /**
+     * @brief コンストラクタ
+     * @param[in] hDC 描画先のデバイスコンテキスト
+     * @param[in] nWidth 描画先の幅
+     * @param[in] nHeight 描画先の高さ
+     */
+    CGdiRenderTarget(HDC hDC, int nWidth, int nHeight);
+    virtual ~CGdiRenderTarget() override;
+
+    CGdiRenderTarget(const CGdiRenderTarget &) = delete;
+    CGdiRenderTarget &operator=(const CGdiRenderTarget &) = delete;
+
+    /// @brief デバイスコンテキストを返します。
+    HDC GetDC() const { return m_hDC; }
+
+    virtual int GetWidth() const override { return m_nWidth; }
+    virtual int GetHeight() const override { return m_nHeight; }
+    virtual void FillRect(const REGION_RECT &rect, RenderColor color) override;
+    virtual void DrawPolyline(const RENDER_POINT *pPoints, int nCount, RenderColor color, int nWidth) override;
+    virtual void DrawFrame(const REGION_RECT &rect, RenderColor color, int nWidth) override;
+    virtual void DrawString(const wchar_t *pszText, int nLength, const REGION_RECT &rect, RenderColor color, unsigned nFormat) override;
+    virtual bool Blit(int x, int y, int cx, int cy, const CRenderTarget &source, int xSrc, int ySrc) override;
+
+private:
+    /// @brief ペンを選択します (同じペンが選択済みなら何もしません)。
+    void SelectPen(RenderColor color, int nWidth);
+
+    HDC m_hDC;               ///< デバイスコンテキスト
+    int m_nWidth;            ///< 幅
+    int m_nHeight;           ///< 高さ
+    HGDIOBJ m_hOldPen;       ///< 元々選択されていたペン
+    HGDIOBJ m_hOldFont;      ///< 元々選択されていたフォント
+    HGDIOBJ m_hBoldFont;     ///< 元のフォントの太字 (未取得ならnullptr)
+    bool m_bBold;            ///< 太字のフォントを選択中か
+    COLORREF m_oldTextColor; ///< 元の文字色
+    COLORREF m_oldBkColor;   ///< 元の背景色
+    int m_nOldBkMode;        ///< 元の背景モード
+    HGDIOBJ m_hPen;          ///< 選択中のペン (未選択ならnullptr)
+    COLORREF m_textColor;    ///< 設定中の文字色
+    COLORREF m_bkColor;      ///< 設定中の背景色
+};
+#endif
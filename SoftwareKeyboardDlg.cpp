@@ -5,34 +5,51 @@
 #include "pch.h"
 #include "SoftwareKeyboardDlg.h"
 #include "CenterEdit.h"
+#include "PaintMetrics.h"
+#include "KeyboardPainter.h"
+#include "InputTrace.h"
 #include "Resource.h"
 #include "afxdialogex.h"
 
-// --- 定数定義 ---
+#include <algorithm>
 
-// カラー定義
-const COLORREF CLR_TITLE_BAR = RGB(0, 102, 204); ///< カスタムタイトルバーの背景色
-const COLORREF CLR_CLOSE_X = RGB(255, 255, 255);   ///< 閉じるボタンの「×」マークの色
+// --- 定数定義 ---
 
-// サイズ定義
-const int KEY_WIDTH = 34;         ///< 標準キーの幅
-const int KEY_HEIGHT = 34;        ///< 標準キーの高さ
-const int KEY_GAP = 1;            ///< キーとキーの間の隙間
-const int TITLE_BAR_HEIGHT = 34;  ///< カスタムタイトルバーの高さ
+// サイズ定義 (キーとタイトルバーの寸法は KeyboardLayout.h で定義)
 const int CLOSE_BTN_SIZE = 30;    ///< 閉じるボタンのサイズ
 
+namespace
+{
+	/// @brief CRect を REGION_RECT に変換します。
+	REGION_RECT ToRegionRect(const CRect &rect)
+	{
+		return REGION_RECT{ rect.left, rect.top, rect.right, rect.bottom };
+	}
+}
+
 // IMPLEMENT_DYNAMICマクロ
 // CSoftwareKeyboardDlgクラスが動的生成可能であることをフレームワークに伝えます。
 IMPLEMENT_DYNAMIC(CSoftwareKeyboardDlg, CDialogEx)
 
 /**
  * @brief CSoftwareKeyboardDlgクラスのコンストラクタ
- * @param pTargetEdit キー入力の送信先となるエディットコントロールへのポインタ
- * @param pParent 親ウィンドウへのポインタ
  */
-CSoftwareKeyboardDlg::CSoftwareKeyboardDlg(CEdit *pTargetEdit, CWnd *pParent /*=nullptr*/)
-	: CDialogEx(IDD_SW_KEYBOARD, pParent),
-	  m_pTargetEdit(pTargetEdit),
+CSoftwareKeyboardDlg::CSoftwareKeyboardDlg()
+	: CDialogEx(IDD_SW_KEYBOARD),
+	  m_pTargetEdit(nullptr),
+	  m_hWndHomeOwner(nullptr),
+	  m_pOldSurfaceBitmap(nullptr),
+	  m_pOldSurfaceFont(nullptr),
+	  m_eLayout(KEYBOARD_LAYOUT_US),
+	  m_nPressedKey(-1),
+	  m_chRepeat(0),
+	  m_bRepeatTimer(false),
+	  m_pNumericField(nullptr),
+	  m_nNumericSelStart(0),
+	  m_nNumericSelEnd(0),
+	  m_bNumericPending(false),
+	  m_pHistory(nullptr),
+	  m_nSuggestionCells(0),
 	  m_bShiftOn(false),
 	  m_bCapsLockOn(false),
 	  m_bCtrlOn(false),
@@ -40,21 +57,17 @@ CSoftwareKeyboardDlg::CSoftwareKeyboardDlg(CEdit *pTargetEdit, CWnd *pParent /*=
 	  m_bFnOn(false),
 	  m_bDragging(false)
 {
-	// 物理キーボードのCapsLockの初期状態を取得し、同期させます。
-	m_bCapsLockOn = (GetKeyState(VK_CAPITAL) & 0x0001) != 0;
+	m_suggestionEntries.reserve(SUGGESTION_MAX_COUNT);
+	m_suggestions.reserve(SUGGESTION_MAX_COUNT);
 }
 
 /**
  * @brief CSoftwareKeyboardDlgクラスのデストラクタ
- * @details 動的に生成したCKeyButtonオブジェクトを全て解放します。
+ * @details 裏画面が残っていれば解放します。
  */
 CSoftwareKeyboardDlg::~CSoftwareKeyboardDlg()
 {
-	for (auto &btn : m_KeyButtons)
-	{
-		delete btn;
-	}
-	m_KeyButtons.clear();
+	ReleaseSurface();
 }
 
 void CSoftwareKeyboardDlg::DoDataExchange(CDataExchange *pDX)
@@ -66,113 +79,372 @@ void CSoftwareKeyboardDlg::DoDataExchange(CDataExchange *pDX)
 // Windowsメッセージと、それを処理するクラスのメンバ関数（ハンドラ）を関連付けます。
 BEGIN_MESSAGE_MAP(CSoftwareKeyboardDlg, CDialogEx)
 	ON_WM_PAINT()
+	ON_WM_ERASEBKGND()
 	ON_WM_LBUTTONDOWN()
 	ON_WM_LBUTTONUP()
 	ON_WM_MOUSEMOVE()
-	// ON_COMMAND_RANGEは、指定したIDの範囲のボタンクリックイベントを単一のハンドラに送ります。
-	ON_COMMAND_RANGE(IDC_KEY_BASE, IDC_KEY_BASE + 100, &CSoftwareKeyboardDlg::OnKeyClick)
+	ON_WM_TIMER()
+	ON_WM_DESTROY()
 END_MESSAGE_MAP()
 
 /**
- * @brief ダイアログの初期化処理 (WM_INITDIALOG)
- * @details キー定義に基づき、キーボタンを動的に生成・配置し、ウィンドウサイズを調整します。
- * @return フォーカスをコントロールに設定しない場合はTRUE。
+ * @brief キーボードのウィンドウを非表示のまま生成します。
+ * @param pOwner 所有ウィンドウ
+ * @return 生成済みまたは生成に成功した場合はTRUE
  */
-BOOL CSoftwareKeyboardDlg::OnInitDialog()
+BOOL CSoftwareKeyboardDlg::Prepare(CWnd *pOwner)
 {
-	CDialogEx::OnInitDialog();
+	if (GetSafeHwnd() != nullptr)
+		return TRUE;
+	if (!Create(IDD_SW_KEYBOARD, pOwner))
+		return FALSE;
+	m_hWndHomeOwner = pOwner->GetSafeHwnd();
+	return TRUE;
+}
 
-	// キーレイアウト定義から、最も幅が必要な行のスパン数を計算します。
-	int max_span_units = 0;
-	const int nKeyArrayRows = sizeof(g_KeyLayout) / sizeof(g_KeyLayout[0]);
-	const int nKeyArrayCols = sizeof(g_KeyLayout[0]) / sizeof(g_KeyLayout[0][0]);
+/**
+ * @brief 入力先のエディットコントロールの真下にキーボードを表示し、閉じられるまで待ちます。
+ * @details 所有ウィンドウを入力先のトップレベルウィンドウに付け替えてから表示するため、
+ * モーダルのサブダイアログの上にも表示されます。閉じた後は所有ウィンドウを元に戻し、
+ * サブダイアログが破棄されてもキーボードのウィンドウが一緒に破棄されないようにします。
+ * 表示要求から表示完了までの時間は描画計測値 (SITE_KEYBOARD_SHOW) に記録します。
+ * 入力履歴が指定された場合は、表示時点の入力先の文字列に対する候補を表示し、
+ * Enterキーで閉じられたときに確定した文字列を記録します。
+ * @param pTargetEdit キー入力の送信先となるエディットコントロール
+ * @param eLayout 表示するレイアウト
+ * @param pHistory 入力履歴 (nullptrなら候補を表示しません)
+ * @param pNumericField 数値入力欄の入力規則 (nullptrなら制限しません)
+ * @return IDOK または IDCANCEL
+ */
+INT_PTR CSoftwareKeyboardDlg::ShowFor(CEdit *pTargetEdit, EKeyboardLayout eLayout, CInputHistory *pHistory,
+									  const CNumericField *pNumericField)
+{
+	if (IsActive() || pTargetEdit == nullptr || pTargetEdit->GetSafeHwnd() == nullptr)
+		return IDCANCEL;
 
-	for (int row = 0; row < nKeyArrayRows; ++row)
+	CWnd *pOwner = pTargetEdit->GetTopLevelParent();
+	bool bEnableOwner = false;
 	{
-		int current_span = 0;
-		for (int col = 0; col < nKeyArrayCols; ++col)
+		CPaintMetricsScope metrics(CPaintMetrics::SITE_KEYBOARD_SHOW);
+
+		// 未生成であればここで生成します (起動時に Prepare() 済みであればウィンドウの生成は行いません)。
+		if (GetSafeHwnd() == nullptr)
 		{
-			if (g_KeyLayout[row][col].uId != 0)
-			{
-				current_span += g_KeyLayout[row][col].nColumnSpan;
-			}
+			if (!Prepare(AfxGetMainWnd() != nullptr ? AfxGetMainWnd() : pOwner))
+				return IDCANCEL;
+			metrics.AddAllocations(1);
 		}
-		if (current_span > max_span_units)
+
+		// 入力先を切り替え、修飾キーの状態を初期化します。
+		m_pTargetEdit = pTargetEdit;
+		m_bShiftOn = false;
+		m_bCtrlOn = false;
+		m_bAltOn = false;
+		m_bFnOn = false;
+		m_bDragging = false;
+		m_nPressedKey = -1;
+		m_pNumericField = pNumericField;
+		m_bNumericPending = false;
+		// 物理キーボードのCapsLockの状態を取得し、同期させます。
+		m_bCapsLockOn = (GetKeyState(VK_CAPITAL) & 0x0001) != 0;
+		if (eLayout != m_eLayout)
+			ApplyLayout(eLayout);
+		UpdateAllKeys();
+		m_pHistory = pHistory;
+		UpdateSuggestions();
+
+		// 入力先のトップレベルウィンドウを所有ウィンドウとし、モーダルダイアログと同様に無効にします。
+		::SetWindowLongPtr(GetSafeHwnd(), GWLP_HWNDPARENT, (LONG_PTR)pOwner->GetSafeHwnd());
+		if (pOwner->IsWindowEnabled())
 		{
-			max_span_units = current_span;
+			pOwner->EnableWindow(FALSE);
+			bEnableOwner = true;
 		}
+
+		// ターゲットのエディットコントロールの真下にキーボードを配置して表示します。
+		CRect rcEdit;
+		pTargetEdit->GetWindowRect(&rcEdit);
+		SetWindowPos(&wndTop, rcEdit.left, rcEdit.bottom + 5, 0, 0, SWP_NOSIZE | SWP_SHOWWINDOW);
+		UpdateWindow();
 	}
 
-	// 計算した最大スパン数に基づき、ダイアログのウィンドウサイズを動的に設定します。
-	const int nRows = 5;
-	int dlgWidth = (KEY_WIDTH * max_span_units) + (KEY_GAP * (max_span_units - 1));
-	int dlgHeight = TITLE_BAR_HEIGHT + (KEY_HEIGHT * nRows) + (KEY_GAP * (nRows));
-	SetWindowPos(nullptr, 0, 0, dlgWidth, dlgHeight, SWP_NOMOVE | SWP_NOZORDER);
+	const INT_PTR nResult = RunModalLoop(MLF_NOIDLEMSG);
 
-	// カスタム描画するタイトルバーと閉じるボタンの矩形領域を計算します。
-	m_rcTitleBar.SetRect(0, 0, dlgWidth, TITLE_BAR_HEIGHT);
-	m_rcCloseBtn.SetRect(dlgWidth - CLOSE_BTN_SIZE - 2, (TITLE_BAR_HEIGHT - CLOSE_BTN_SIZE) / 2, dlgWidth - 2, (TITLE_BAR_HEIGHT + CLOSE_BTN_SIZE) / 2);
+	// 反映していない入力は破棄します (Enterキーで閉じた場合は反映済みです)。
+	StopRepeat();
+	m_inputBuffer.Clear();
+	m_bNumericPending = false;
+	m_pNumericField = nullptr;
 
-	// g_KeyLayout配列を元に、全てのキーボタンを動的に生成します。
-	int y = TITLE_BAR_HEIGHT + KEY_GAP;
-	for (int row = 0; row < nKeyArrayRows; ++row)
+	// Enterキーで確定した文字列を入力履歴に記録します。
+	if (nResult == IDOK && m_pHistory != nullptr && pTargetEdit->GetSafeHwnd() != nullptr &&
+		pTargetEdit->GetWindowTextLength() <= HISTORY_MAX_LENGTH)
 	{
-		int x = 0;
-		for (int col = 0; col < nKeyArrayCols; ++col)
+		pTargetEdit->GetWindowText(m_strPrefix);
+		m_pHistory->Record(m_strPrefix);
+	}
+	m_pHistory = nullptr;
+
+	// 所有ウィンドウを有効に戻してから非表示にし、アクティブ化が所有ウィンドウへ戻るようにします。
+	if (bEnableOwner)
+		pOwner->EnableWindow(TRUE);
+	if (GetSafeHwnd() != nullptr)
+	{
+		if (m_bDragging || m_nPressedKey >= 0)
 		{
-			const KEY_INFO &keyInfo = g_KeyLayout[row][col];
-			if (keyInfo.uId == 0)
-				continue; // nColumnSpan > 1 のキーのためのプレースホルダはスキップ
+			m_bDragging = false;
+			m_nPressedKey = -1;
+			ReleaseCapture();
+		}
+		SetWindowPos(nullptr, 0, 0, 0, 0, SWP_HIDEWINDOW | SWP_NOSIZE | SWP_NOMOVE | SWP_NOACTIVATE | SWP_NOZORDER);
+		::SetWindowLongPtr(GetSafeHwnd(), GWLP_HWNDPARENT, (LONG_PTR)m_hWndHomeOwner);
+	}
+	pOwner->SetActiveWindow();
+	m_pTargetEdit = nullptr;
+	UpdateSuggestions();
+	return nResult;
+}
+
+/**
+ * @brief キーボードを閉じ、ShowFor() に結果を返します。
+ * @details ウィンドウは破棄せず、ShowFor() が非表示に戻します。
+ * @param nResult IDOK または IDCANCEL
+ */
+void CSoftwareKeyboardDlg::Close(int nResult)
+{
+	if (ContinueModal())
+		EndModalLoop(nResult);
+}
+
+/**
+ * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
+ * @details 所有ウィンドウと一緒に破棄された場合に備えて、表示中であれば IDCANCEL で閉じます。
+ * 裏画面を解放し、次の ShowFor() でウィンドウと裏画面を生成し直します。
+ */
+void CSoftwareKeyboardDlg::OnDestroy()
+{
+	Close(IDCANCEL);
+	StopRepeat();
+	ReleaseSurface();
+	CDialogEx::OnDestroy();
+}
 
-			// キーの幅をスパン数に応じて計算
-			int keyWidth = (keyInfo.nColumnSpan * KEY_WIDTH) + ((keyInfo.nColumnSpan - 1) * KEY_GAP);
-			CRect keyRect(x, y, x + keyWidth, y + KEY_HEIGHT);
+/**
+ * @brief ダイアログの初期化処理 (WM_INITDIALOG)
+ * @details 現在のレイアウトに合わせてウィンドウサイズを調整し、裏画面を生成します。
+ * 生成は Prepare() で一度だけ行われ、表示のたびには呼び出されません。
+ * @return フォーカスをコントロールに設定しない場合はTRUE。
+ */
+BOOL CSoftwareKeyboardDlg::OnInitDialog()
+{
+	CDialogEx::OnInitDialog();
 
-			// ボタンを生成し、プロパティを設定
-			CKeyButton *pButton = new CKeyButton();
-			pButton->Create(keyInfo.szLabel, WS_CHILD | WS_VISIBLE | BS_OWNERDRAW, keyRect, this, keyInfo.uId);
-			pButton->SetFont(GetFont());
-			pButton->SetKeyInfo(this, &keyInfo);
+	ApplyLayout(m_eLayout);
 
-			m_KeyButtons.push_back(pButton);
+	// 裏画面を生成し、タイトルバーと全てのキーを描画しておきます。
+	CreateSurface();
 
-			x += keyWidth + KEY_GAP;
+	return TRUE;
+}
+
+/**
+ * @brief レイアウトを切り替え、ウィンドウの大きさとタイトルバー・閉じるボタン・入力候補欄の領域を合わせます。
+ * @details キーの矩形と当たり判定の表はコンパイル済みのものを参照するだけで、計算もメモリの確保も行いません。
+ * 裏画面が生成済みであれば、タイトルバーと全てのキーを描き直します。
+ * @param eLayout 新しいレイアウト
+ */
+void CSoftwareKeyboardDlg::ApplyLayout(EKeyboardLayout eLayout)
+{
+	m_eLayout = eLayout;
+	m_surface.SetLayout(GetKeyboardLayout(eLayout));
+	const int dlgWidth = m_surface.GetWidth();
+	const int dlgHeight = m_surface.GetHeight();
+	SetWindowPos(nullptr, 0, 0, dlgWidth, dlgHeight, SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE);
+
+	// カスタム描画するタイトルバーと閉じるボタンの矩形領域を計算します。
+	m_rcTitleBar.SetRect(0, 0, dlgWidth, KEYBOARD_TITLE_BAR_HEIGHT);
+	m_rcCloseBtn.SetRect(dlgWidth - CLOSE_BTN_SIZE - 2, (KEYBOARD_TITLE_BAR_HEIGHT - CLOSE_BTN_SIZE) / 2, dlgWidth - 2, (KEYBOARD_TITLE_BAR_HEIGHT + CLOSE_BTN_SIZE) / 2);
+	m_rcSuggestions.SetRect(0, 0, (std::max)(0, m_rcCloseBtn.left - 2), KEYBOARD_TITLE_BAR_HEIGHT);
+	m_nSuggestionCells = (std::min)(static_cast<int>(SUGGESTION_MAX_COUNT), m_rcSuggestions.Width() / SUGGESTION_MIN_WIDTH);
+	if (m_suggestions.size() > static_cast<size_t>(m_nSuggestionCells))
+		m_suggestions.resize(m_nSuggestionCells);
+
+	if (m_dcSurface.GetSafeHdc() != nullptr)
+		RedrawSurface();
+}
+
+/**
+ * @brief 裏画面を生成し、タイトルバー・閉じるボタン・全てのキーを描画します。
+ * @details 裏画面は全てのレイアウトを収められる大きさで生成し、レイアウトを切り替えても作り直しません。
+ * 裏画面のDCにはダイアログのフォントを選択したままにしておき、キーの描画のたびに選択し直しません。
+ */
+void CSoftwareKeyboardDlg::CreateSurface()
+{
+	ReleaseSurface();
+
+	int nMaxWidth = 0;
+	int nMaxHeight = 0;
+	GetKeyboardLayoutExtent(nMaxWidth, nMaxHeight);
+
+	CClientDC dc(this);
+	m_dcSurface.CreateCompatibleDC(&dc);
+	m_bmpSurface.CreateCompatibleBitmap(&dc, (std::max)(1, nMaxWidth), (std::max)(1, nMaxHeight));
+	m_pOldSurfaceBitmap = m_dcSurface.SelectObject(&m_bmpSurface);
+	m_pOldSurfaceFont = m_dcSurface.SelectObject(GetFont());
+	m_dcSurface.SetBkMode(TRANSPARENT);
+
+	RedrawSurface();
+}
+
+/**
+ * @brief 現在のレイアウトで裏画面全体 (タイトルバー・入力候補・閉じるボタン・全てのキー) を描き直します。
+ * @details 描画は CKeyboardPainter が裏画面を描画先とする CGdiRenderTarget に行います。
+ */
+void CSoftwareKeyboardDlg::RedrawSurface()
+{
+	{
+		// 背景 (キーの隙間)・タイトルバー・閉じるボタンと入力候補欄を描画します。
+		CRect rcClient;
+		GetClientRect(&rcClient);
+		CGdiRenderTarget target(m_dcSurface.GetSafeHdc(), m_surface.GetWidth(), m_surface.GetHeight());
+		CKeyboardPainter::RenderFrame(target, ToRegionRect(rcClient), ToRegionRect(m_rcTitleBar), ToRegionRect(m_rcCloseBtn),
+									  GetSysColor(COLOR_BTNFACE));
+		RenderSuggestions(target);
+	}
+
+	// 全てのキーを描き直します。
+	m_surface.InvalidateAll();
+	UpdateAllKeys();
+	Invalidate(FALSE);
+}
+
+/**
+ * @brief 裏画面を解放します。
+ */
+void CSoftwareKeyboardDlg::ReleaseSurface()
+{
+	if (m_dcSurface.GetSafeHdc() != nullptr)
+	{
+		m_dcSurface.SelectObject(m_pOldSurfaceFont);
+		m_dcSurface.SelectObject(m_pOldSurfaceBitmap);
+		m_dcSurface.DeleteDC();
+	}
+	m_pOldSurfaceFont = nullptr;
+	m_pOldSurfaceBitmap = nullptr;
+	m_bmpSurface.DeleteObject();
+}
+
+/**
+ * @brief 入力先の文字列を接頭辞とする入力候補を求め、変わった場合は入力候補欄を描き直します。
+ * @details 入力履歴がない場合や入力先がない場合は候補を空にします。
+ * 候補が前回と同じ場合は描画も無効化も行いません。
+ */
+void CSoftwareKeyboardDlg::UpdateSuggestions()
+{
+	CInputTraceScope trace("CSoftwareKeyboardDlg::UpdateSuggestions");
+	m_suggestionEntries.clear();
+	if (m_pHistory != nullptr && m_pTargetEdit != nullptr && m_pTargetEdit->GetSafeHwnd() != nullptr && m_nSuggestionCells > 0)
+	{
+		m_pTargetEdit->GetWindowText(m_strPrefix);
+		m_pHistory->Suggest(m_strPrefix, m_nSuggestionCells, m_suggestionEntries);
+	}
+
+	bool bChanged = m_suggestionEntries.size() != m_suggestions.size();
+	m_suggestions.resize(m_suggestionEntries.size());
+	for (size_t i = 0; i < m_suggestionEntries.size(); ++i)
+	{
+		m_pHistory->GetText(m_suggestionEntries[i], m_strSuggestion);
+		if (m_suggestions[i] != m_strSuggestion)
+		{
+			m_suggestions[i].swap(m_strSuggestion);
+			bChanged = true;
 		}
-		y += KEY_HEIGHT + KEY_GAP;
 	}
 
-	// ターゲットのエディットコントロールの真下にキーボードを配置します。
-	CRect rcEdit;
-	m_pTargetEdit->GetWindowRect(&rcEdit);
-	SetWindowPos(nullptr, rcEdit.left, rcEdit.bottom + 5, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+	if (bChanged && m_dcSurface.GetSafeHdc() != nullptr)
+	{
+		CGdiRenderTarget target(m_dcSurface.GetSafeHdc(), m_surface.GetWidth(), m_surface.GetHeight());
+		RenderSuggestions(target);
+		InvalidateRect(&m_rcSuggestions, FALSE);
+	}
+}
 
-	return TRUE;
+/**
+ * @brief 入力候補欄を裏画面に描画します。
+ * @details 候補がない欄はタイトルバーの背景のままにします (ドラッグ移動に使えます)。
+ * @param target 裏画面を描画先とする描画先
+ */
+void CSoftwareKeyboardDlg::RenderSuggestions(CRenderTarget &target)
+{
+	CKeyboardPainter::RenderSuggestions(target, ToRegionRect(m_rcSuggestions), m_nSuggestionCells, m_suggestions.data(), m_suggestions.size());
+}
+
+/**
+ * @brief 座標にある入力候補の番号を返します。
+ * @param point クライアント座標
+ * @return 入力候補の番号 (候補の上でなければ-1)
+ */
+int CSoftwareKeyboardDlg::SuggestionFromPoint(CPoint point) const
+{
+	if (m_suggestions.empty() || !m_rcSuggestions.PtInRect(point))
+		return -1;
+	const int nCellWidth = m_rcSuggestions.Width() / (std::max)(1, m_nSuggestionCells);
+	const int nIndex = (point.x - m_rcSuggestions.left) / (std::max)(1, nCellWidth);
+	return nIndex < static_cast<int>(m_suggestions.size()) ? nIndex : -1;
+}
+
+/**
+ * @brief 入力候補を選択し、入力先の文字列全体をその文字列に置き換えます。
+ * @details 未反映の入力を破棄し、全体を選択してから候補の文字列を1回の編集で反映します。
+ * @param nIndex 入力候補の番号
+ */
+void CSoftwareKeyboardDlg::AcceptSuggestion(int nIndex)
+{
+	if (m_pTargetEdit == nullptr || m_pTargetEdit->GetSafeHwnd() == nullptr)
+		return;
+
+	m_inputBuffer.Clear();
+	m_bNumericPending = false;
+	m_pTargetEdit->SetSel(0, -1, TRUE);
+	for (wchar_t ch : m_suggestions[nIndex])
+		m_inputBuffer.InsertChar(ch);
+	FlushInput();
+	if (::GetFocus() != m_pTargetEdit->GetSafeHwnd())
+		m_pTargetEdit->SetFocus();
 }
 
 /**
  * @brief 描画処理 (WM_PAINT)
- * @details カスタムタイトルバーと閉じるボタンの「×」マークを描画します。
+ * @details 裏画面から更新領域だけを転送します。タイトルバーとキーは裏画面に描画済みです。
  */
 void CSoftwareKeyboardDlg::OnPaint()
 {
+	CInputTraceScope trace("CSoftwareKeyboardDlg::OnPaint", true);
+	CPaintMetricsScope metrics(CPaintMetrics::SITE_KEYBOARD_PAINT);
 	CPaintDC dc(this);
 
-	// 1. タイトルバーを指定色で塗りつぶします。
-	dc.FillSolidRect(m_rcTitleBar, CLR_TITLE_BAR);
+	if (m_dcSurface.GetSafeHdc() == nullptr)
+		return;
+	const CRect &rcPaint = dc.m_ps.rcPaint;
+	CGdiRenderTarget surfaceTarget(m_dcSurface.GetSafeHdc(), m_surface.GetWidth(), m_surface.GetHeight());
+	CGdiRenderTarget screenTarget(dc.GetSafeHdc(), m_surface.GetWidth(), m_surface.GetHeight());
+	screenTarget.Blit(rcPaint.left, rcPaint.top, rcPaint.Width(), rcPaint.Height(), surfaceTarget, rcPaint.left, rcPaint.top);
+}
 
-	// 2. 閉じるボタンの領域に「×」を手動で描画します。
-	CPen pen(PS_SOLID, 2, CLR_CLOSE_X);
-	CPen *pOldPen = dc.SelectObject(&pen);
-	dc.MoveTo(m_rcCloseBtn.left + 8, m_rcCloseBtn.top + 8);
-	dc.LineTo(m_rcCloseBtn.right - 8, m_rcCloseBtn.bottom - 8);
-	dc.MoveTo(m_rcCloseBtn.left + 8, m_rcCloseBtn.bottom - 8);
-	dc.LineTo(m_rcCloseBtn.right - 8, m_rcCloseBtn.top + 8);
-	dc.SelectObject(pOldPen);
+/**
+ * @brief 背景の消去 (WM_ERASEBKGND)
+ * @details 描画面全体を OnPaint() で転送するため、背景は消去しません (ちらつき防止)。
+ * @param pDC デバイスコンテキスト
+ * @return 常にTRUE
+ */
+BOOL CSoftwareKeyboardDlg::OnEraseBkgnd(CDC *pDC)
+{
+	return TRUE;
 }
 
 /**
  * @brief マウスの左ボタンが押されたときの処理 (WM_LBUTTONDOWN)
- * @details 閉じるボタンのクリック判定と、タイトルバーのドラッグ開始処理を行います。
+ * @details 閉じるボタンと入力候補のクリック判定と、タイトルバーのドラッグ開始処理を行います。
  * @param nFlags 修飾キーの状態
  * @param point マウスカーソルのクライアント座標
  */
@@ -181,7 +453,15 @@ void CSoftwareKeyboardDlg::OnLButtonDown(UINT nFlags, CPoint point)
 	// 閉じるボタンの領域がクリックされたか判定
 	if (m_rcCloseBtn.PtInRect(point))
 	{
-		EndDialog(IDCANCEL);
+		Close(IDCANCEL);
+		return;
+	}
+
+	// 入力候補がクリックされた場合は、その文字列を入力します。
+	const int nSuggestion = SuggestionFromPoint(point);
+	if (nSuggestion >= 0)
+	{
+		AcceptSuggestion(nSuggestion);
 		return;
 	}
 
@@ -192,13 +472,38 @@ void CSoftwareKeyboardDlg::OnLButtonDown(UINT nFlags, CPoint point)
 		m_ptMouseOffset = point;
 		SetCapture(); // マウスキャプチャを開始し、ウィンドウ外でもマウスメッセージを受け取る
 	}
+	else
+	{
+		// キーの上で押された場合は、離されるまでキャプチャして押下中のキーとして記録します。
+		m_nPressedKey = m_surface.HitTest(point.x, point.y);
+		if (m_nPressedKey >= 0)
+		{
+			SetCapture();
+
+			// リピートするキーは押した時点で入力し、押し続けている間は繰り返します。
+			const KEY_INFO &keyInfo = m_surface.GetKeyInfo(m_nPressedKey);
+			if (IsRepeatable(keyInfo))
+			{
+				HandleKeyPress(&keyInfo);
+				FlushInput();
+				m_keyRepeat.Press(static_cast<double>(GetTickCount64()));
+				if (!m_bRepeatTimer)
+				{
+					SetTimer(REPEAT_TIMER_ID, CKeyRepeat::FRAME_INTERVAL_MS, NULL);
+					m_bRepeatTimer = true;
+				}
+			}
+		}
+	}
 
 	CDialogEx::OnLButtonDown(nFlags, point);
 }
 
 /**
  * @brief マウスの左ボタンが離されたときの処理 (WM_LBUTTONUP)
- * @details ドラッグ状態を終了します。
+ * @details ドラッグ状態を終了します。リピートするキーは押した時点で入力済みのため、リピートを止めるだけです。
+ * それ以外のキーは、押したキーの上で離された場合にそのキーの入力として処理します
+ * (ボタンのクリックと同じ判定です)。
  */
 void CSoftwareKeyboardDlg::OnLButtonUp(UINT nFlags, CPoint point)
 {
@@ -207,12 +512,26 @@ void CSoftwareKeyboardDlg::OnLButtonUp(UINT nFlags, CPoint point)
 		m_bDragging = false;
 		ReleaseCapture(); // マウスキャプチャを解放
 	}
+	else if (m_nPressedKey >= 0)
+	{
+		const int nKey = m_nPressedKey;
+		m_nPressedKey = -1;
+		ReleaseCapture();
+		StopRepeat();
+		const KEY_INFO &keyInfo = m_surface.GetKeyInfo(nKey);
+		if (!IsRepeatable(keyInfo) && m_surface.HitTest(point.x, point.y) == nKey)
+		{
+			HandleKeyPress(&keyInfo);
+			FlushInput();
+		}
+	}
 	CDialogEx::OnLButtonUp(nFlags, point);
 }
 
 /**
  * @brief マウスが移動したときの処理 (WM_MOUSEMOVE)
  * @details ドラッグ中であれば、ウィンドウをマウスに追従させて移動させます。
+ * リピート中のキーの外にマウスが出た場合は、リピートを止めます。
  */
 void CSoftwareKeyboardDlg::OnMouseMove(UINT nFlags, CPoint point)
 {
@@ -223,34 +542,85 @@ void CSoftwareKeyboardDlg::OnMouseMove(UINT nFlags, CPoint point)
 		// ウィンドウの新しい左上位置を計算し、移動
 		SetWindowPos(nullptr, ptScreen.x - m_ptMouseOffset.x, ptScreen.y - m_ptMouseOffset.y, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
 	}
+	else if (m_keyRepeat.IsActive() && m_surface.HitTest(point.x, point.y) != m_nPressedKey)
+	{
+		StopRepeat();
+	}
 	CDialogEx::OnMouseMove(nFlags, point);
 }
 
 /**
- * @brief いずれかのキーボタンがクリックされたときの処理
- * @details ON_COMMAND_RANGEによって、全てのキーボタンクリックがこのハンドラに集約されます。
- * @param nID クリックされたボタンのコントロールID
+ * @brief タイマーイベント (WM_TIMER) を処理します。
+ * @details フレームタイマーの周期で、期限を迎えた回数だけ押下中のキーの入力を繰り返し、
+ * まとめて1回の編集で入力先に反映します。
+ * @param nIDEvent タイマーID
  */
-void CSoftwareKeyboardDlg::OnKeyClick(UINT nID)
+void CSoftwareKeyboardDlg::OnTimer(UINT_PTR nIDEvent)
 {
-	const KEY_INFO *pKeyInfo = nullptr;
-	// クリックされたボタンのIDを元に、g_KeyLayout配列から対応するキー情報を探します。
-	for (int row = 0; row < 5; ++row)
+	if (nIDEvent == REPEAT_TIMER_ID)
 	{
-		for (int col = 0; col < 15; ++col)
+		// キャプチャを失った場合 (別のウィンドウに切り替えられた場合など) は繰り返しません。
+		if (GetCapture() != this)
 		{
-			if (g_KeyLayout[row][col].uId == nID)
+			StopRepeat();
+			return;
+		}
+		const int nRepeats = m_keyRepeat.Advance(static_cast<double>(GetTickCount64()));
+		if (nRepeats > 0 && m_nPressedKey >= 0 && m_pTargetEdit != nullptr)
+		{
+			const KEY_INFO &keyInfo = m_surface.GetKeyInfo(m_nPressedKey);
+			for (int i = 0; i < nRepeats; ++i)
 			{
-				pKeyInfo = &g_KeyLayout[row][col];
-				goto key_found; // 見つかったらループを抜ける
+				if (keyInfo.eKeyType == KT_NORMAL)
+					SendChar(m_chRepeat);
+				else
+					SendKey(keyInfo.bVirtKey);
 			}
+			FlushInput();
 		}
+		if (!m_keyRepeat.IsActive())
+			StopRepeat();
+		return;
 	}
-key_found:
-	if (pKeyInfo)
+
+	CDialogEx::OnTimer(nIDEvent);
+}
+
+/**
+ * @brief キーのリピートを止め、フレームタイマーを止めます。
+ */
+void CSoftwareKeyboardDlg::StopRepeat()
+{
+	m_keyRepeat.Release();
+	if (m_bRepeatTimer)
 	{
-		// キー情報が見つかった場合、キープレス処理を呼び出す
-		HandleKeyPress(pKeyInfo);
+		KillTimer(REPEAT_TIMER_ID);
+		m_bRepeatTimer = false;
+	}
+}
+
+/**
+ * @brief 押し続けたときにリピートするキーかを返します。
+ * @details 文字キーと、BackSpace/Delete/Space/Tab と増減 (▲▼) がリピートします。修飾キーや Enter/Esc はリピートしません。
+ * @param keyInfo キーの情報
+ */
+bool CSoftwareKeyboardDlg::IsRepeatable(const KEY_INFO &keyInfo)
+{
+	if (keyInfo.eKeyType == KT_NORMAL)
+		return true;
+	if (keyInfo.eKeyType != KT_ACTION)
+		return false;
+	switch (keyInfo.bVirtKey)
+	{
+	case VK_BACK:
+	case VK_DELETE:
+	case VK_SPACE:
+	case VK_TAB:
+	case VK_UP:
+	case VK_DOWN:
+		return true;
+	default:
+		return false;
 	}
 }
 
@@ -260,6 +630,8 @@ key_found:
  */
 void CSoftwareKeyboardDlg::HandleKeyPress(const KEY_INFO *pKeyInfo)
 {
+	CInputTraceScope trace("CSoftwareKeyboardDlg::HandleKeyPress");
+
 	switch (pKeyInfo->eKeyType)
 	{
 	case KT_NORMAL: // 通常の文字・数字・記号キー
@@ -285,6 +657,7 @@ void CSoftwareKeyboardDlg::HandleKeyPress(const KEY_INFO *pKeyInfo)
 
 		if (ch != 0)
 			SendChar(ch);
+		m_chRepeat = ch;
 
 		// Shiftキーは、他の通常キーが押されたらOFFに戻る
 		if (m_bShiftOn)
@@ -296,9 +669,23 @@ void CSoftwareKeyboardDlg::HandleKeyPress(const KEY_INFO *pKeyInfo)
 	}
 	case KT_ACTION: // Enter, Esc, Backspaceなどのアクションキー
 		if (pKeyInfo->bVirtKey == VK_RETURN)
-			EndDialog(IDOK);
+		{
+			// 数値入力欄は、途中の形 (「-」だけや末尾の小数点) を整え、範囲に収めてから確定します。
+			if (m_pNumericField != nullptr)
+			{
+				LoadNumeric();
+				if (m_pNumericField->Finish(m_strNumeric))
+					m_nNumericSelStart = m_nNumericSelEnd = static_cast<int>(m_strNumeric.size());
+			}
+			FlushInput();
+			Close(IDOK);
+		}
 		else if (pKeyInfo->bVirtKey == VK_ESCAPE)
-			EndDialog(IDCANCEL);
+		{
+			m_inputBuffer.Clear();
+			m_bNumericPending = false;
+			Close(IDCANCEL);
+		}
 		else
 			SendKey(pKeyInfo->bVirtKey);
 		break;
@@ -322,45 +709,176 @@ void CSoftwareKeyboardDlg::HandleKeyPress(const KEY_INFO *pKeyInfo)
 		UpdateAllKeys(); // 状態が変わったので、全キーの表示を更新
 		break;
 	}
-	m_pTargetEdit->SetFocus(); // 操作後、フォーカスをターゲットのエディットコントロールに戻す
+	// 操作後、フォーカスがターゲットのエディットコントロールから外れていれば戻す
+	if (::GetFocus() != m_pTargetEdit->GetSafeHwnd())
+		m_pTargetEdit->SetFocus();
 }
 
 /**
- * @brief 文字キー入力をターゲットのエディットコントロールに送信します。
- * @param ch 送信する文字
+ * @brief 文字キー入力を入力バッファに追加します。
+ * @details 入力先への反映は FlushInput() でまとめて行います。
+ * 数値入力欄では、入力規則を満たす場合だけ未反映の文字列に適用します。
+ * @param ch 入力する文字
  */
 void CSoftwareKeyboardDlg::SendChar(TCHAR ch)
 {
-	m_pTargetEdit->SendMessage(WM_CHAR, (WPARAM)ch, 1);
+	if (m_pNumericField != nullptr)
+	{
+		LoadNumeric();
+		m_pNumericField->InsertChar(ch, m_strNumeric, m_nNumericSelStart, m_nNumericSelEnd);
+		return;
+	}
+	m_inputBuffer.InsertChar(ch);
 }
 
 /**
- * @brief 特殊キー（非文字キー）入力をターゲットのエディットコントロールに送信します。
- * @param vk 送信するキーの仮想キーコード
+ * @brief 数値入力欄の現在の文字列と選択範囲を、未反映の文字列として読み込みます (読み込み済みなら何もしません)。
  */
-void CSoftwareKeyboardDlg::SendKey(BYTE vk)
+void CSoftwareKeyboardDlg::LoadNumeric()
 {
-	// Backspace, Tab, Spaceは制御文字としてWM_CHARで送信するのが確実
-	if (vk == VK_BACK || vk == VK_TAB || vk == VK_SPACE)
+	if (m_bNumericPending || m_pTargetEdit == nullptr)
+		return;
+	m_pTargetEdit->GetWindowText(m_strPrefix);
+	m_strNumeric.assign(static_cast<LPCTSTR>(m_strPrefix));
+	m_pTargetEdit->GetSel(m_nNumericSelStart, m_nNumericSelEnd);
+	m_bNumericPending = true;
+}
+
+/**
+ * @brief 数値入力欄の特殊キーを未反映の文字列に適用します。
+ * @details BackSpace/Delete は削除、+/- は符号反転、▲▼ は刻み幅の増減です。Space/Tab は入力できないため捨てます。
+ * @param vk 仮想キーコード
+ * @return 処理した場合はtrue (それ以外のキーは通常どおり送信します)
+ */
+bool CSoftwareKeyboardDlg::SendNumericKey(BYTE vk)
+{
+	switch (vk)
 	{
-		m_pTargetEdit->SendMessage(WM_CHAR, (WPARAM)vk, 1);
+	case VK_BACK:
+		LoadNumeric();
+		m_pNumericField->Backspace(m_strNumeric, m_nNumericSelStart, m_nNumericSelEnd);
+		return true;
+	case VK_DELETE:
+		LoadNumeric();
+		m_pNumericField->Delete(m_strNumeric, m_nNumericSelStart, m_nNumericSelEnd);
+		return true;
+	case VK_OEM_MINUS:
+		LoadNumeric();
+		m_pNumericField->ToggleSign(m_strNumeric, m_nNumericSelStart, m_nNumericSelEnd);
+		return true;
+	case VK_UP:
+	case VK_DOWN:
+		LoadNumeric();
+		m_pNumericField->Step(vk == VK_UP ? 1 : -1, m_strNumeric, m_nNumericSelStart, m_nNumericSelEnd);
+		return true;
+	case VK_SPACE:
+	case VK_TAB:
+		return true;
+	default:
+		return false;
 	}
-	else // DeleteなどはアクションとしてWM_KEYDOWNで送信
+}
+
+/**
+ * @brief 特殊キー（非文字キー）入力を入力バッファに追加します。
+ * @details Backspace と Delete は削除として、Tab と Space は文字として追加します。
+ * それ以外のキーは、それまでの入力を反映してから WM_KEYDOWN で送信します。
+ * @param vk 入力するキーの仮想キーコード
+ */
+void CSoftwareKeyboardDlg::SendKey(BYTE vk)
+{
+	if (m_pNumericField != nullptr && SendNumericKey(vk))
+		return;
+
+	switch (vk)
 	{
+	case VK_BACK:   m_inputBuffer.Backspace(); break;
+	case VK_DELETE: m_inputBuffer.Delete(); break;
+	case VK_TAB:    m_inputBuffer.InsertChar(_T('\t')); break;
+	case VK_SPACE:  m_inputBuffer.InsertChar(_T(' ')); break;
+	default:
+		FlushInput();
 		m_pTargetEdit->SendMessage(WM_KEYDOWN, (WPARAM)vk, 0);
+		break;
+	}
+}
+
+/**
+ * @brief 入力バッファにまとめたキー入力を、入力先の1回の編集として反映します。
+ * @details 入力先の現在の選択範囲から置き換える範囲を求め、EM_SETSEL と EM_REPLACESEL で置き換えます
+ * (元に戻す操作の対象になります)。入力が互いに打ち消し合った場合は何もしません。
+ * 数値入力欄では、未反映の文字列が変わっていれば全体を1回の編集で置き換え、選択範囲を合わせます。
+ * 反映した後は、新しい文字列に対する入力候補を求め直します。
+ */
+void CSoftwareKeyboardDlg::FlushInput()
+{
+	if (m_inputBuffer.IsEmpty() && !m_bNumericPending)
+		return;
+	if (m_pTargetEdit == nullptr || m_pTargetEdit->GetSafeHwnd() == nullptr)
+	{
+		m_inputBuffer.Clear();
+		m_bNumericPending = false;
+		return;
 	}
+
+	CInputTraceScope trace("CSoftwareKeyboardDlg::FlushInput");
+	if (m_bNumericPending)
+	{
+		m_bNumericPending = false;
+		m_pTargetEdit->GetWindowText(m_strPrefix);
+		if (m_strNumeric != static_cast<LPCTSTR>(m_strPrefix))
+		{
+			m_pTargetEdit->SetSel(0, -1, TRUE);
+			m_pTargetEdit->ReplaceSel(m_strNumeric.c_str(), TRUE);
+		}
+		m_pTargetEdit->SetSel(m_nNumericSelStart, m_nNumericSelEnd, TRUE);
+	}
+
+	int nSelStart = 0;
+	int nSelEnd = 0;
+	int nStart = 0;
+	int nEnd = 0;
+	if (!m_inputBuffer.IsEmpty())
+	{
+		m_pTargetEdit->GetSel(nSelStart, nSelEnd);
+		if (m_inputBuffer.Resolve(nSelStart, nSelEnd, m_pTargetEdit->GetWindowTextLength(), nStart, nEnd))
+		{
+			m_pTargetEdit->SetSel(nStart, nEnd, TRUE);
+			m_pTargetEdit->ReplaceSel(m_inputBuffer.GetText().c_str(), TRUE);
+		}
+		m_inputBuffer.Clear();
+	}
+	UpdateSuggestions();
 }
 
 /**
- * @brief 全てのキーボタンに再描画を要求します。
- * @details Shiftキーなどが押されて、全キーの表示を更新する必要がある場合に呼び出されます。
+ * @brief 修飾キーの状態に合わせて、表示内容が変わったキーだけを描き直します。
+ * @details Shiftキーなどが押されたときに呼び出されます。描き直したキーを裏画面に描画し、
+ * その矩形だけを無効化します (英字キーは Shift/CapsLock、記号キーは Shift、修飾キーは自身の状態で変わります)。
  */
 void CSoftwareKeyboardDlg::UpdateAllKeys()
 {
-	for (auto &btn : m_KeyButtons)
+	if (m_dcSurface.GetSafeHdc() == nullptr)
+		return;
+
+	CPaintMetricsScope metrics(CPaintMetrics::SITE_KEYBOARD_RENDER);
+	unsigned nModifiers = 0;
+	if (m_bShiftOn)    nModifiers |= CKeyboardSurface::MOD_SHIFT;
+	if (m_bCapsLockOn) nModifiers |= CKeyboardSurface::MOD_CAPS;
+	if (m_bCtrlOn)     nModifiers |= CKeyboardSurface::MOD_CTRL;
+	if (m_bAltOn)      nModifiers |= CKeyboardSurface::MOD_ALT;
+	if (m_bFnOn)       nModifiers |= CKeyboardSurface::MOD_FN;
+
+	m_surface.SetModifiers(nModifiers, m_dirtyKeys);
+	CGdiRenderTarget target(m_dcSurface.GetSafeHdc(), m_surface.GetWidth(), m_surface.GetHeight());
+	for (int nIndex : m_dirtyKeys)
 	{
-		btn->Invalidate();
+		CKeyboardPainter::RenderKey(target, m_surface, nIndex);
+		const KEYBOARD_RECT &rc = m_surface.GetKeyRect(nIndex);
+		CRect rect(rc.left, rc.top, rc.right, rc.bottom);
+		InvalidateRect(&rect, FALSE);
 	}
+	metrics.AddItems(static_cast<std::uint32_t>(m_dirtyKeys.size()));
 }
 
 /**
@@ -3,11 +3,25 @@
  * @brief ソフトウェアキーボードダイアログのクラス宣言
  * @details このファイルは、マウスで文字入力を行うためのソフトウェアキーボードの
  * メインダイアログクラス CSoftwareKeyboardDlg の宣言を含みます。
+ * キーボードのウィンドウはアプリケーションで1つだけ生成して使い回し、エディットコントロールごとに
+ * 入力先と位置を切り替えて表示・非表示にします。
+ * キーは子ウィンドウを持たず、ダイアログ全体を1枚の描画面としてダブルバッファで描画します。
+ * キーの配置はコンパイル済みのレイアウト (KeyboardLayout.h) から入力先ごとに選びます。
+ * キー入力は1文字ごとに送らずにバッファにまとめ、1回の選択範囲の置き換えとして入力先に反映します。
+ * 入力先に入力履歴 (InputHistory.h) が指定された場合は、タイトルバーに入力候補を表示します。
+ * 数値入力欄 (NumericField.h) が指定された場合は、入力規則を満たすキー入力だけを受け付けます。
  */
 #pragma once
 
 #include "KeyDefine.h"
-#include "KeyButton.h"
+#include "KeyboardLayout.h"
+#include "KeyboardSurface.h"
+#include "RenderTarget.h"
+#include "KeyRepeat.h"
+#include "TextInjectionBuffer.h"
+#include "InputHistory.h"
+#include "NumericField.h"
+#include <string>
 #include <vector>
 #include "Resource.h"
 
@@ -16,8 +30,24 @@ class CEdit; // CEditクラスの前方宣言
 /**
  * @class CSoftwareKeyboardDlg
  * @brief ソフトウェアキーボードのダイアログクラス
- * @details CDialogExを継承し、キーの動的生成、描画、入力イベント処理、
+ * @details CDialogExを継承し、キーの描画、入力イベント処理、
  * ウィンドウのドラッグ移動などを担当します。
+ * キーの矩形・当たり判定・表示内容は CKeyboardSurface で管理し、描画済みの内容は
+ * 裏画面 (メモリDC) に保持します。修飾キーが変わったときは表示内容が変わったキーだけを裏画面に描き直し、
+ * その矩形だけを無効化します。
+ * Prepare() で非表示のまま一度だけ生成しておき、ShowFor() で入力先を切り替えて表示します。
+ * 裏画面は全てのレイアウトを収められる大きさで一度だけ生成するため、レイアウトを切り替えても
+ * 作り直しません。
+ * 文字キーと BackSpace/Delete/Space/Tab は押した時点で入力し、押し続けると CKeyRepeat の期限に従って
+ * 加速しながら繰り返します。繰り返しは1つのフレームタイマーで進め、1フレームの間の入力を
+ * CTextInjectionBuffer にまとめてから EM_SETSEL/EM_REPLACESEL の1回の編集で反映します。
+ * ShowFor() はモーダルダイアログと同様に所有ウィンドウを無効にしてメッセージループを回し、
+ * Enter/Escキーや閉じるボタンで閉じられると非表示に戻して IDOK/IDCANCEL を返します。
+ * 入力履歴が指定された場合は、入力を反映するたびに入力先の文字列を接頭辞とする候補を求め、
+ * タイトルバーの候補欄だけを描き直します。候補をクリックすると、その文字列全体を1回の編集で入力先に反映します。
+ * Enterキーで閉じた場合は、確定した文字列を入力履歴に記録します。
+ * 数値入力欄の規則が指定された場合は、キー入力をバッファの代わりに CNumericField で文字列と選択範囲に適用し、
+ * 規則を満たさない入力は捨てます。▲▼キーは刻み幅で値を増減し、押し続けると文字キーと同様にリピートします。
  */
 class CSoftwareKeyboardDlg : public CDialogEx
 {
@@ -26,22 +56,58 @@ class CSoftwareKeyboardDlg : public CDialogEx
 public:
 	/**
 	 * @brief コンストラクタ
-	 * @param[in] pTargetEdit キー入力の送信先となるエディットコントロールへのポインタ
-	 * @param[in] pParent 親ウィンドウへのポインタ
+	 * @details ウィンドウは Prepare() または最初の ShowFor() で生成します。
 	 */
-	CSoftwareKeyboardDlg(CEdit *pTargetEdit, CWnd *pParent = nullptr);
+	CSoftwareKeyboardDlg();
 	
 	/**
 	 * @brief デストラクタ
 	 */
 	virtual ~CSoftwareKeyboardDlg() override;
 
+	/// @brief キーリピートのフレームタイマーID
+	static const UINT_PTR REPEAT_TIMER_ID = 1;
+
+	/// @brief タイトルバーに表示する入力候補の最大数
+	static const int SUGGESTION_MAX_COUNT = 4;
+	/// @brief 入力候補の1つの欄の最小の幅 (タイトルバーの幅に収まる数だけ表示します)
+	static const int SUGGESTION_MIN_WIDTH = 96;
+	/// @brief 入力履歴に記録する文字列の最大の長さ (これより長い文字列は記録しません)
+	static const int HISTORY_MAX_LENGTH = 256;
+
 	/// @brief ダイアログ テンプレートのリソースID
 	enum
 	{
 		IDD = IDD_SW_KEYBOARD
 	};
 
+	/**
+	 * @brief キーボードのウィンドウを非表示のまま生成します (生成済みなら何もしません)。
+	 * @details 起動時に呼び出しておくと、最初の表示でもキーの生成を待たずに済みます。
+	 * 非表示の間の所有ウィンドウは pOwner になるため、アプリケーションのメインウィンドウを指定してください。
+	 * @param[in] pOwner 所有ウィンドウ
+	 * @return 生成済みまたは生成に成功した場合はTRUE
+	 */
+	BOOL Prepare(CWnd *pOwner);
+
+	/**
+	 * @brief 入力先のエディットコントロールの真下にキーボードを表示し、閉じられるまで待ちます。
+	 * @details 表示中は入力先を含むトップレベルウィンドウを所有ウィンドウとして無効にし、
+	 * モーダルダイアログと同様にメッセージループを回します。修飾キーの状態は表示ごとに初期化します。
+	 * 前回と異なるレイアウトが指定された場合は、ウィンドウの大きさを合わせて全てのキーを描き直します。
+	 * 既に表示中の場合は何もせずに IDCANCEL を返します。
+	 * @param[in] pTargetEdit キー入力の送信先となるエディットコントロール
+	 * @param[in] eLayout 表示するレイアウト
+	 * @param[in,out] pHistory 入力候補を求め、Enterキーで確定した文字列を記録する入力履歴 (nullptrなら候補を表示しません)
+	 * @param[in] pNumericField 数値入力欄の入力規則 (nullptrなら制限しません)。Enterキーで閉じる際に文字列を整えます。
+	 * @return Enterキーで閉じられた場合はIDOK、Escキーや閉じるボタンで閉じられた場合はIDCANCEL
+	 */
+	INT_PTR ShowFor(CEdit *pTargetEdit, EKeyboardLayout eLayout = KEYBOARD_LAYOUT_US, CInputHistory *pHistory = nullptr,
+					const CNumericField *pNumericField = nullptr);
+
+	/// @brief キーボードを表示中 (ShowFor() の実行中) かを返します。
+	bool IsActive() const noexcept { return m_pTargetEdit != nullptr; }
+
 	// --- 状態取得用 公開関数 ---
 	bool IsShiftOn() const  noexcept { return m_bShiftOn; }     ///< ShiftキーがONかを取得します
 	bool IsCapsLockOn() const  noexcept { return m_bCapsLockOn; } ///< CapsLockキーがONかを取得します
@@ -74,8 +140,40 @@ protected:
 	virtual void OnCancel() override;
 
 	// --- メンバ変数 ---
-	CEdit *m_pTargetEdit; ///< キー入力の送信先となるエディットコントロール
-	std::vector<CKeyButton *> m_KeyButtons; ///< 動的に生成したキーボタンのポインタを保持するコンテナ
+	CEdit *m_pTargetEdit; ///< キー入力の送信先となるエディットコントロール (非表示の間はnullptr)
+	HWND m_hWndHomeOwner; ///< 非表示の間の所有ウィンドウ (Prepare() で指定したウィンドウ)
+
+	// --- 描画面 ---
+	CKeyboardSurface m_surface;               ///< キーの矩形・当たり判定・表示内容
+	EKeyboardLayout m_eLayout;                ///< 現在のレイアウト
+	std::vector<int> m_dirtyKeys;             ///< 再描画が必要なキー番号 (作業領域)
+	CDC m_dcSurface;                          ///< 裏画面のメモリDC
+	CBitmap m_bmpSurface;                     ///< 裏画面のビットマップ
+	CBitmap *m_pOldSurfaceBitmap;             ///< 裏画面のDCに元々選択されていたビットマップ
+	CFont *m_pOldSurfaceFont;                 ///< 裏画面のDCに元々選択されていたフォント
+	int m_nPressedKey;                        ///< 押下中のキー番号 (-1は押下なし)
+
+	// --- キー入力の反映とリピート ---
+	CTextInjectionBuffer m_inputBuffer; ///< 入力先に未反映のキー入力
+	CKeyRepeat m_keyRepeat;             ///< 押下中のキーのリピート期限
+	TCHAR m_chRepeat;                   ///< 押下中の文字キーが入力した文字 (リピートでも同じ文字を入力します)
+	bool m_bRepeatTimer;                ///< フレームタイマーが動作中か
+
+	// --- 数値入力欄 ---
+	const CNumericField *m_pNumericField; ///< 入力先の数値入力欄の入力規則 (なければnullptr)
+	std::wstring m_strNumeric;            ///< 入力先に未反映の数値入力欄の文字列
+	int m_nNumericSelStart;               ///< 未反映の選択範囲の開始位置
+	int m_nNumericSelEnd;                 ///< 未反映の選択範囲の終了位置
+	bool m_bNumericPending;               ///< 数値入力欄の文字列が未反映か
+
+	// --- 入力候補 ---
+	CInputHistory *m_pHistory;                ///< 入力先の入力履歴 (なければnullptr)
+	std::vector<int> m_suggestionEntries;     ///< 入力候補の登録番号 (作業領域)
+	std::vector<std::wstring> m_suggestions;  ///< 表示中の入力候補の文字列
+	std::wstring m_strSuggestion;             ///< 入力候補の文字列 (作業領域)
+	CString m_strPrefix;                      ///< 入力先の文字列 (作業領域)
+	CRect m_rcSuggestions;                    ///< 入力候補欄の領域 (タイトルバーの閉じるボタンより左)
+	int m_nSuggestionCells;                   ///< 入力候補欄の数 (タイトルバーの幅で決まります)
 
 	// --- 状態保持キーのフラグ ---
 	bool m_bShiftOn;    ///< Shiftキーのトグル状態 (true: ON)
@@ -96,13 +194,29 @@ protected:
 	void HandleKeyPress(const KEY_INFO *pKeyInfo);
 	void SendChar(TCHAR ch);
 	void SendKey(BYTE vk);
+	bool SendNumericKey(BYTE vk);
+	void LoadNumeric();
+	void FlushInput();
+	void StopRepeat();
+	void UpdateSuggestions();
+	void RenderSuggestions(CRenderTarget &target);
+	int SuggestionFromPoint(CPoint point) const;
+	void AcceptSuggestion(int nIndex);
+	static bool IsRepeatable(const KEY_INFO &keyInfo);
 	void UpdateAllKeys();
+	void Close(int nResult);
+	void ApplyLayout(EKeyboardLayout eLayout);
+	void CreateSurface();
+	void RedrawSurface();
+	void ReleaseSurface();
 
 	// --- メッセージハンドラ ---
 	afx_msg void OnPaint();
+	afx_msg BOOL OnEraseBkgnd(CDC *pDC);
 	afx_msg void OnLButtonDown(UINT nFlags, CPoint point);
 	afx_msg void OnLButtonUp(UINT nFlags, CPoint point);
 	afx_msg void OnMouseMove(UINT nFlags, CPoint point);
-	afx_msg void OnKeyClick(UINT nID);
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
+	afx_msg void OnDestroy();
 	DECLARE_MESSAGE_MAP()
 };
\ No newline at end of file
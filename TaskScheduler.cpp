@@ -0,0 +1,406 @@
+﻿/**
+ * @file TaskScheduler.cpp
+ * @brief ワークスティーリング方式のタスクスケジューラの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    /// @brief 呼び出し元スレッドが属するスケジューラ (ワーカースレッド以外は nullptr)
+    thread_local const CTaskScheduler *tl_pScheduler = nullptr;
+    /// @brief 呼び出し元スレッドのワーカー番号
+    thread_local int tl_nWorker = -1;
+
+    std::uint64_t SteadyNowNs()
+    {
+        using namespace std::chrono;
+        return static_cast<std::uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    /// @brief ミリ秒を刻み数に切り上げます。
+    std::uint64_t MsToTicks(std::uint32_t nMs)
+    {
+        return (static_cast<std::uint64_t>(nMs) + CTaskScheduler::TIMER_TICK_MS - 1) / CTaskScheduler::TIMER_TICK_MS;
+    }
+}
+
+/**
+ * @brief CTaskSchedulerクラスのコンストラクタ (スレッドは Start() で起動します)
+ */
+CTaskScheduler::CTaskScheduler()
+    : m_bRunning(false), m_bStopping(false), m_nNextQueue(0), m_nQueued(0), m_nSleeping(0),
+      m_wheel(WHEEL_SLOTS), m_nCurrentTick(0), m_nNextWakeTick(UINT64_MAX), m_nTimerCount(0), m_nEpochNs(0),
+      m_nExecuted(0), m_nStolen(0), m_nCancelled(0)
+{
+}
+
+/**
+ * @brief CTaskSchedulerクラスのデストラクタ
+ */
+CTaskScheduler::~CTaskScheduler()
+{
+    Shutdown();
+}
+
+/**
+ * @brief 現在時刻を刻み単位で返します。
+ */
+std::uint64_t CTaskScheduler::NowTick() const
+{
+    return (SteadyNowNs() - m_nEpochNs) / (static_cast<std::uint64_t>(TIMER_TICK_MS) * 1000000);
+}
+
+/**
+ * @brief ワーカースレッドとタイマースレッドを起動します。
+ */
+bool CTaskScheduler::Start(int nWorkers)
+{
+    if (IsRunning())
+        return false;
+    if (nWorkers <= 0)
+        nWorkers = static_cast<int>(std::thread::hardware_concurrency());
+    if (nWorkers <= 0)
+        nWorkers = 1;
+
+    m_bStopping.store(false);
+    m_nEpochNs = SteadyNowNs();
+    m_nCurrentTick = 0;
+    m_nNextWakeTick = UINT64_MAX;
+    m_queues.clear();
+    for (int i = 0; i < nWorkers; ++i)
+        m_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+
+    m_bRunning.store(true, std::memory_order_release);
+    for (int i = 0; i < nWorkers; ++i)
+        m_workers.emplace_back(&CTaskScheduler::WorkerLoop, this, i);
+    m_timerThread = std::thread(&CTaskScheduler::TimerLoop, this);
+    return true;
+}
+
+/**
+ * @brief 未実行のタスクとタイマーを破棄し、全スレッドを停止します。
+ * @details 実行中のタスクの完了は待ちます。長時間かかるタスクは取り消しトークンを確認して中断してください。
+ */
+void CTaskScheduler::Shutdown()
+{
+    if (!m_bRunning.exchange(false))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_bStopping.store(true);
+    }
+    m_cvWork.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+    }
+    m_cvTimer.notify_all();
+
+    for (std::thread &worker : m_workers)
+        worker.join();
+    m_workers.clear();
+    if (m_timerThread.joinable())
+        m_timerThread.join();
+
+    for (std::unique_ptr<WorkerQueue> &pQueue : m_queues)
+        pQueue->items.clear();
+    m_nQueued.store(0);
+    for (std::vector<TimerEntry> &slot : m_wheel)
+        slot.clear();
+    m_nTimerCount = 0;
+    SetUiExecutor(UiExecutor());
+}
+
+/**
+ * @brief キューにタスクを積み、待機中のワーカーを起こします。
+ * @details 待機するワーカーは m_nSleeping を増やしてから m_nQueued を確認し、
+ * 登録側は m_nQueued を増やしてから m_nSleeping を確認します (どちらも逐次一貫)。
+ * そのため、どちらか一方は必ず相手の更新を観測し、起床の取りこぼしは起きません。
+ */
+void CTaskScheduler::PushItem(Item item)
+{
+    std::size_t nQueue;
+    if (tl_pScheduler == this && tl_nWorker >= 0)
+        nQueue = static_cast<std::size_t>(tl_nWorker);
+    else
+        nQueue = m_nNextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+    {
+        WorkerQueue &queue = *m_queues[nQueue];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.items.push_back(std::move(item));
+    }
+    m_nQueued.fetch_add(1);
+    if (m_nSleeping.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_cvWork.notify_one();
+    }
+}
+
+/**
+ * @brief タスクをワーカーで実行するよう登録します。
+ */
+bool CTaskScheduler::Submit(Task task, const CCancellationToken &token)
+{
+    if (!IsRunning() || !task)
+        return false;
+    Item item;
+    item.task = std::move(task);
+    item.token = token;
+    PushItem(std::move(item));
+    return true;
+}
+
+/**
+ * @brief 自分のキューの末尾から取り出すか、他のキューの先頭から盗みます。
+ */
+bool CTaskScheduler::TakeTask(int nIndex, Item &item)
+{
+    const int nCount = static_cast<int>(m_queues.size());
+    {
+        WorkerQueue &queue = *m_queues[nIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.items.empty())
+        {
+            item = std::move(queue.items.back());
+            queue.items.pop_back();
+            m_nQueued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (int k = 1; k < nCount; ++k)
+    {
+        WorkerQueue &victim = *m_queues[(nIndex + k) % nCount];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.items.empty())
+            continue;
+        item = std::move(victim.items.front());
+        victim.items.pop_front();
+        m_nQueued.fetch_sub(1);
+        m_nStolen.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief タスクを実行します (取り消し済みなら実行しません)。
+ */
+void CTaskScheduler::RunItem(Item &item)
+{
+    if (item.token.IsCancelled())
+    {
+        m_nCancelled.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    item.task();
+    m_nExecuted.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief ワーカースレッドの本体
+ * @details 盗む際はロックを待たずに (try_lock) 次のキューへ進むため、他のワーカーの取り出しを妨げません。
+ * 盗みに失敗しても未実行のタスクが残っていれば、待機せずに再試行します。
+ */
+void CTaskScheduler::WorkerLoop(int nIndex)
+{
+    tl_pScheduler = this;
+    tl_nWorker = nIndex;
+
+    for (;;)
+    {
+        Item item;
+        if (TakeTask(nIndex, item))
+        {
+            RunItem(item);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        if (m_bStopping.load())
+            break;
+        m_nSleeping.fetch_add(1);
+        if (m_nQueued.load() <= 0)
+            m_cvWork.wait(lock, [this] { return m_bStopping.load() || m_nQueued.load() > 0; });
+        m_nSleeping.fetch_sub(1);
+        if (m_bStopping.load())
+            break;
+    }
+
+    tl_pScheduler = nullptr;
+    tl_nWorker = -1;
+}
+
+/**
+ * @brief タイマーを登録します。
+ */
+bool CTaskScheduler::AddTimer(std::uint32_t nDelayMs, std::uint32_t nPeriodMs, Item item)
+{
+    if (!IsRunning() || !item.task)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    TimerEntry entry;
+    // 現在の刻みの途中から数えるため、1刻み分を足して期限より早く発火しないようにする
+    entry.nDeadlineTick = NowTick() + MsToTicks(nDelayMs) + (nDelayMs > 0 ? 1 : 0);
+    if (entry.nDeadlineTick < m_nCurrentTick)
+        entry.nDeadlineTick = m_nCurrentTick;
+    entry.nPeriodTicks = (nPeriodMs > 0) ? static_cast<std::uint32_t>((std::max)(std::uint64_t(1), MsToTicks(nPeriodMs))) : 0;
+    entry.item = std::move(item);
+    const std::uint64_t nDeadline = entry.nDeadlineTick;
+    m_wheel[nDeadline % WHEEL_SLOTS].push_back(std::move(entry));
+    ++m_nTimerCount;
+
+    // タイマースレッドの起床予定より早い期限であれば起こし直す
+    if (nDeadline < m_nNextWakeTick)
+        m_cvTimer.notify_one();
+    return true;
+}
+
+/**
+ * @brief 指定時間後にタスクを実行するよう登録します。
+ */
+bool CTaskScheduler::ScheduleAfter(std::uint32_t nDelayMs, Task task, const CCancellationToken &token)
+{
+    if (nDelayMs == 0)
+        return Submit(std::move(task), token);
+    Item item;
+    item.task = std::move(task);
+    item.token = token;
+    return AddTimer(nDelayMs, 0, std::move(item));
+}
+
+/**
+ * @brief 指定時間後から一定周期でタスクを実行するよう登録します。
+ */
+bool CTaskScheduler::SchedulePeriodic(std::uint32_t nDelayMs, std::uint32_t nPeriodMs, Task task,
+                                      const CCancellationToken &token)
+{
+    Item item;
+    item.task = std::move(task);
+    item.token = token;
+    return AddTimer(nDelayMs, (std::max)(nPeriodMs, TIMER_TICK_MS), std::move(item));
+}
+
+/**
+ * @brief タイマースレッドの本体
+ * @details 現在の刻みまでのスロットを順に処理し、期限に達したものをワーカーへ渡します。
+ * スロットには期限が1周以上先のものも混在するため、期限の刻みを比較して残すかどうかを決めます。
+ * 次の起床時刻は、現在位置から最初に見つかる空でないスロットの刻みとします。
+ * 登録がなければ、次の登録まで起床しません。
+ */
+void CTaskScheduler::TimerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_timerMutex);
+    std::vector<TimerEntry> expired;
+    while (!m_bStopping.load())
+    {
+        const std::uint64_t nNow = NowTick();
+
+        // 1周以上遅れた場合は、全スロットを1回ずつ処理すれば足りる
+        if (nNow >= m_nCurrentTick + WHEEL_SLOTS)
+            m_nCurrentTick = nNow + 1 - WHEEL_SLOTS;
+        for (; m_nCurrentTick <= nNow; ++m_nCurrentTick)
+        {
+            std::vector<TimerEntry> &slot = m_wheel[m_nCurrentTick % WHEEL_SLOTS];
+            for (std::size_t i = 0; i < slot.size();)
+            {
+                if (slot[i].nDeadlineTick <= nNow)
+                {
+                    expired.push_back(std::move(slot[i]));
+                    slot[i] = std::move(slot.back());
+                    slot.pop_back();
+                    --m_nTimerCount;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+
+        // 期限に達したものをワーカーへ渡し、周期タスクは次の期限で登録し直す
+        for (TimerEntry &entry : expired)
+        {
+            if (entry.item.token.IsCancelled())
+            {
+                m_nCancelled.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (entry.nPeriodTicks == 0)
+            {
+                PushItem(std::move(entry.item));
+                continue;
+            }
+            PushItem(entry.item);
+            entry.nDeadlineTick += entry.nPeriodTicks;
+            if (entry.nDeadlineTick <= nNow)
+                entry.nDeadlineTick = nNow + 1; // 大きく遅れた場合は追いつこうとせず次の刻みから再開する
+            const std::uint64_t nDeadline = entry.nDeadlineTick;
+            m_wheel[nDeadline % WHEEL_SLOTS].push_back(std::move(entry));
+            ++m_nTimerCount;
+        }
+        expired.clear();
+
+        // 次の起床時刻を決める
+        m_nNextWakeTick = UINT64_MAX;
+        if (m_nTimerCount > 0)
+        {
+            for (std::uint64_t t = m_nCurrentTick; t < m_nCurrentTick + WHEEL_SLOTS; ++t)
+            {
+                if (!m_wheel[t % WHEEL_SLOTS].empty())
+                {
+                    m_nNextWakeTick = t;
+                    break;
+                }
+            }
+        }
+        if (m_nNextWakeTick == UINT64_MAX)
+        {
+            m_cvTimer.wait(lock);
+        }
+        else
+        {
+            const std::chrono::nanoseconds wake(m_nEpochNs + m_nNextWakeTick * TIMER_TICK_MS * 1000000ull);
+            m_cvTimer.wait_until(lock, std::chrono::steady_clock::time_point(
+                                           std::chrono::duration_cast<std::chrono::steady_clock::duration>(wake)));
+        }
+    }
+}
+
+/**
+ * @brief UIスレッドでタスクを実行させる関数を設定します。
+ */
+void CTaskScheduler::SetUiExecutor(UiExecutor executor)
+{
+    std::shared_ptr<UiExecutor> pExecutor;
+    if (executor)
+        pExecutor = std::make_shared<UiExecutor>(std::move(executor));
+    std::lock_guard<std::mutex> lock(m_uiMutex);
+    m_pUiExecutor = std::move(pExecutor);
+}
+
+/**
+ * @brief タスクをUIスレッドで実行するよう依頼します。
+ */
+bool CTaskScheduler::PostToUi(Task task, const CCancellationToken &token)
+{
+    std::shared_ptr<UiExecutor> pExecutor;
+    {
+        std::lock_guard<std::mutex> lock(m_uiMutex);
+        pExecutor = m_pUiExecutor;
+    }
+    if (!pExecutor || !task)
+        return false;
+    return (*pExecutor)([task, token]() {
+        if (!token.IsCancelled())
+            task();
+    });
+}
@@ -0,0 +1,244 @@
+﻿/**
+ * @file TaskScheduler.h
+ * @brief アプリケーション全体で共有するワークスティーリング方式のタスクスケジューラのクラス宣言
+ * @details CPUコア数に合わせたワーカースレッド群でタスクを実行します。
+ * 各ワーカーは自分のキューの末尾から取り出し (LIFO)、空になると他のワーカーのキューの先頭から盗みます (FIFO)。
+ * 遅延タスク・周期タスクはタイマーホイールで管理し、期限が来たものだけをワーカーに渡します。
+ * 予定がない間はタイマースレッドもワーカーも待機したままで、周期的に起床することはありません。
+ * キャンセルトークンで実行前のタスクを取り消せるため、呼び出し側はスレッドの終了を待つ必要がありません。
+ * UIスレッドでの後続処理は、登録された UiExecutor (Windowsではメインウィンドウへのポスト) 経由で実行します。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CCancellationSource;
+
+/**
+ * @class CCancellationToken
+ * @brief タスクの取り消し状態を参照するトークン (コピー可能)
+ * @details 既定構築したトークンは取り消されることがありません。
+ */
+class CCancellationToken
+{
+public:
+    CCancellationToken() = default;
+
+    /// @brief 取り消されているかを返します。
+    bool IsCancelled() const { return m_pFlag && m_pFlag->load(std::memory_order_acquire); }
+    /// @brief 取り消される可能性があるか (CCancellationSource から取得したトークンか) を返します。
+    bool CanBeCancelled() const { return static_cast<bool>(m_pFlag); }
+
+private:
+    friend class CCancellationSource;
+    explicit CCancellationToken(std::shared_ptr<const std::atomic<bool>> pFlag) : m_pFlag(std::move(pFlag)) {}
+
+    std::shared_ptr<const std::atomic<bool>> m_pFlag; ///< 取り消しフラグ (共有)
+};
+
+/**
+ * @class CCancellationSource
+ * @brief タスクの取り消しを要求する側のオブジェクト
+ * @details GetToken() で得たトークンをタスクに渡し、Cancel() で一括して取り消します。
+ * 取り消しは実行前のタスクにのみ作用し、実行中のタスクは IsCancelled() を確認して自ら中断します。
+ */
+class CCancellationSource
+{
+public:
+    CCancellationSource() : m_pFlag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    /// @brief この取り消し元に連動するトークンを返します。
+    CCancellationToken GetToken() const { return CCancellationToken(m_pFlag); }
+    /// @brief 取り消しを要求します。
+    void Cancel() { m_pFlag->store(true, std::memory_order_release); }
+    /// @brief 取り消しが要求されているかを返します。
+    bool IsCancelled() const { return m_pFlag->load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_pFlag; ///< 取り消しフラグ
+};
+
+/**
+ * @class CTaskScheduler
+ * @brief ワークスティーリング方式のスレッドプールとタイマーホイール
+ * @details Start() から Shutdown() までの間、全メンバ関数を任意のスレッドから呼び出せます。
+ * Shutdown() は未実行のタスクと未到来のタイマーを破棄し、実行中のタスクの完了を待ってから戻ります。
+ */
+class CTaskScheduler
+{
+public:
+    /// @brief タスクの型
+    typedef std::function<void()> Task;
+    /// @brief UIスレッドでタスクを実行させる関数の型 (受け付けた場合はtrueを返す)
+    typedef std::function<bool(Task)> UiExecutor;
+
+    /// @brief タイマーホイールの1刻みの時間 (ミリ秒)
+    static constexpr std::uint32_t TIMER_TICK_MS = 10;
+    /// @brief タイマーホイールのスロット数 (1周は TIMER_TICK_MS * WHEEL_SLOTS ミリ秒)
+    static constexpr std::uint32_t WHEEL_SLOTS = 512;
+
+    CTaskScheduler();
+    ~CTaskScheduler();
+
+    CTaskScheduler(const CTaskScheduler &) = delete;
+    CTaskScheduler &operator=(const CTaskScheduler &) = delete;
+
+    /**
+     * @brief ワーカースレッドとタイマースレッドを起動します。
+     * @param[in] nWorkers ワーカー数 (0以下ならハードウェアのスレッド数)
+     * @return 起動した場合はtrue (既に起動済みの場合はfalse)
+     */
+    bool Start(int nWorkers = 0);
+
+    /// @brief 未実行のタスクとタイマーを破棄し、全スレッドを停止します。
+    void Shutdown();
+
+    /// @brief 起動中かを返します。
+    bool IsRunning() const { return m_bRunning.load(std::memory_order_acquire); }
+    /// @brief ワーカー数を返します。
+    int GetWorkerCount() const { return static_cast<int>(m_workers.size()); }
+
+    /**
+     * @brief タスクをワーカーで実行するよう登録します。
+     * @details ワーカースレッドから呼び出した場合は自分のキューに、それ以外は各ワーカーのキューに順番に積みます。
+     * @param[in] task 実行するタスク
+     * @param[in] token 取り消しトークン (実行直前に確認します)
+     * @return 登録した場合はtrue (停止中はfalse)
+     */
+    bool Submit(Task task, const CCancellationToken &token = CCancellationToken());
+
+    /**
+     * @brief 指定時間後にタスクを実行するよう登録します。
+     * @param[in] nDelayMs 遅延時間 (ミリ秒、TIMER_TICK_MS 単位に切り上げ)
+     * @param[in] task 実行するタスク
+     * @param[in] token 取り消しトークン (期限到来時と実行直前に確認します)
+     * @return 登録した場合はtrue
+     */
+    bool ScheduleAfter(std::uint32_t nDelayMs, Task task, const CCancellationToken &token = CCancellationToken());
+
+    /**
+     * @brief 指定時間後から一定周期でタスクを実行するよう登録します。
+     * @details トークンが取り消されるか Shutdown() されるまで繰り返します。
+     * 次回の期限は前回の期限を基準に決めるため、実行時間の揺らぎで周期がずれていくことはありません。
+     * @param[in] nDelayMs 初回までの遅延時間 (ミリ秒)
+     * @param[in] nPeriodMs 周期 (ミリ秒、TIMER_TICK_MS 以上に切り上げ)
+     * @param[in] task 実行するタスク
+     * @param[in] token 取り消しトークン
+     * @return 登録した場合はtrue
+     */
+    bool SchedulePeriodic(std::uint32_t nDelayMs, std::uint32_t nPeriodMs, Task task,
+                          const CCancellationToken &token = CCancellationToken());
+
+    /**
+     * @brief UIスレッドでタスクを実行させる関数を設定します (空の関数で解除)。
+     */
+    void SetUiExecutor(UiExecutor executor);
+
+    /**
+     * @brief タスクをUIスレッドで実行するよう依頼します。
+     * @param[in] task UIスレッドで実行するタスク
+     * @param[in] token 取り消しトークン (UIスレッドでの実行直前に確認します)
+     * @return UiExecutor が受け付けた場合はtrue
+     */
+    bool PostToUi(Task task, const CCancellationToken &token = CCancellationToken());
+
+    /**
+     * @brief 処理をワーカーで実行し、その結果をUIスレッドの後続処理に渡します。
+     * @details work() の戻り値を引数として then() をUIスレッドで呼び出します。
+     * トークンが取り消された場合は、その時点以降の段階を実行しません。
+     * @param[in] work ワーカーで実行する処理 (戻り値を持つこと)
+     * @param[in] then UIスレッドで実行する後続処理
+     * @param[in] token 取り消しトークン
+     * @return 登録した場合はtrue
+     */
+    template <typename Work, typename Then>
+    bool SubmitThenPost(Work work, Then then, const CCancellationToken &token = CCancellationToken())
+    {
+        return Submit([this, work, then, token]() mutable {
+            auto result = work();
+            if (token.IsCancelled())
+                return;
+            PostToUi([then, result]() mutable { then(result); }, token);
+        }, token);
+    }
+
+    /// @brief これまでに実行したタスク数を返します。
+    std::uint64_t GetExecutedCount() const { return m_nExecuted.load(std::memory_order_relaxed); }
+    /// @brief 他のワーカーのキューから盗んで実行したタスク数を返します。
+    std::uint64_t GetStolenCount() const { return m_nStolen.load(std::memory_order_relaxed); }
+    /// @brief 実行前に取り消されたタスク数を返します。
+    std::uint64_t GetCancelledCount() const { return m_nCancelled.load(std::memory_order_relaxed); }
+
+private:
+    /// @brief キューに積むタスクと取り消しトークンの組
+    struct Item
+    {
+        Task task;
+        CCancellationToken token;
+    };
+
+    /// @brief 1ワーカー分のキュー
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Item> items;
+    };
+
+    /// @brief タイマーホイールの登録内容
+    struct TimerEntry
+    {
+        std::uint64_t nDeadlineTick; ///< 期限 (刻み)
+        std::uint32_t nPeriodTicks;  ///< 周期 (刻み、0なら1回限り)
+        Item item;                   ///< 実行するタスク
+    };
+
+    /// @brief ワーカースレッドの本体
+    void WorkerLoop(int nIndex);
+    /// @brief タイマースレッドの本体
+    void TimerLoop();
+    /// @brief 自分のキューの末尾から取り出すか、他のキューの先頭から盗みます。
+    bool TakeTask(int nIndex, Item &item);
+    /// @brief タスクを実行します (取り消し済みなら実行しません)。
+    void RunItem(Item &item);
+    /// @brief キューにタスクを積み、待機中のワーカーを起こします。
+    void PushItem(Item item);
+    /// @brief タイマーを登録します。
+    bool AddTimer(std::uint32_t nDelayMs, std::uint32_t nPeriodMs, Item item);
+    /// @brief 現在時刻を刻み単位で返します。
+    std::uint64_t NowTick() const;
+
+    std::atomic<bool> m_bRunning;                          ///< 起動中か
+    std::atomic<bool> m_bStopping;                         ///< 停止要求
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;    ///< ワーカーごとのキュー
+    std::vector<std::thread> m_workers;                    ///< ワーカースレッド
+    std::atomic<std::uint32_t> m_nNextQueue;               ///< 外部からの登録先 (順番に割り振る)
+    std::atomic<std::int64_t> m_nQueued;                   ///< 全キューの未実行タスク数
+    std::atomic<int> m_nSleeping;                          ///< 待機中のワーカー数
+    std::mutex m_sleepMutex;                               ///< ワーカーの待機用
+    std::condition_variable m_cvWork;                      ///< ワーカーの起床通知
+
+    std::thread m_timerThread;                             ///< タイマースレッド
+    std::mutex m_timerMutex;                               ///< タイマーホイールの保護
+    std::condition_variable m_cvTimer;                     ///< タイマースレッドの起床通知
+    std::vector<std::vector<TimerEntry>> m_wheel;          ///< タイマーホイール (期限の刻み % WHEEL_SLOTS のスロット)
+    std::uint64_t m_nCurrentTick;                          ///< 次に処理するスロットの刻み
+    std::uint64_t m_nNextWakeTick;                         ///< タイマースレッドが次に起床する予定の刻み
+    std::size_t m_nTimerCount;                             ///< 登録中のタイマー数
+    std::uint64_t m_nEpochNs;                              ///< 刻みの基準時刻
+
+    std::mutex m_uiMutex;                                  ///< UiExecutor の保護
+    std::shared_ptr<UiExecutor> m_pUiExecutor;             ///< UIスレッドでの実行関数
+
+    std::atomic<std::uint64_t> m_nExecuted;                ///< 実行したタスク数
+    std::atomic<std::uint64_t> m_nStolen;                  ///< 盗んで実行したタスク数
+    std::atomic<std::uint64_t> m_nCancelled;               ///< 実行前に取り消されたタスク数
+};
@@ -0,0 +1,110 @@
+﻿/**
+ * @file TextInjectionBuffer.cpp
+ * @brief キー入力をまとめるバッファの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "TextInjectionBuffer.h"
+
+#include <algorithm>
+
+/**
+ * @brief CTextInjectionBufferクラスのコンストラクタ
+ */
+CTextInjectionBuffer::CTextInjectionBuffer()
+    : m_eFirstKey(KEY_NONE), m_nDeleteBefore(0), m_nDeleteAfter(0), m_nKeyCount(0)
+{
+}
+
+/**
+ * @brief 文字を挿入します。
+ */
+void CTextInjectionBuffer::InsertChar(wchar_t ch)
+{
+    if (m_eFirstKey == KEY_NONE)
+        m_eFirstKey = KEY_INSERT;
+    m_strInsert.push_back(ch);
+    ++m_nKeyCount;
+}
+
+/**
+ * @brief キャレットの前の1文字を削除します。
+ * @details 挿入した文字が残っていればそれを取り消し、なければ選択範囲の前で削除する文字数を増やします。
+ */
+void CTextInjectionBuffer::Backspace()
+{
+    if (m_eFirstKey == KEY_NONE)
+        m_eFirstKey = KEY_BACKSPACE;
+    if (!m_strInsert.empty())
+        m_strInsert.pop_back();
+    else
+        ++m_nDeleteBefore;
+    ++m_nKeyCount;
+}
+
+/**
+ * @brief キャレットの後ろの1文字を削除します。
+ * @details キャレットは挿入した文字列の直後にあるため、常に選択範囲の後ろの文字を削除します。
+ */
+void CTextInjectionBuffer::Delete()
+{
+    if (m_eFirstKey == KEY_NONE)
+        m_eFirstKey = KEY_DELETE;
+    ++m_nDeleteAfter;
+    ++m_nKeyCount;
+}
+
+/**
+ * @brief 反映時点の選択範囲に対して、置き換える範囲を求めます。
+ */
+bool CTextInjectionBuffer::Resolve(int nSelStart, int nSelEnd, int nLength, int &nStart, int &nEnd) const
+{
+    if (m_nKeyCount == 0)
+        return false;
+
+    nLength = (std::max)(0, nLength);
+    nSelStart = (std::min)((std::max)(0, nSelStart), nLength);
+    nSelEnd = (std::min)((std::max)(nSelStart, nSelEnd), nLength);
+
+    int nBefore = m_nDeleteBefore;
+    int nAfter = m_nDeleteAfter;
+    if (nSelStart != nSelEnd)
+    {
+        // 最初の BackSpace/Delete は選択範囲を消すだけで、前後の文字は削除しません。
+        if (m_eFirstKey == KEY_BACKSPACE)
+            --nBefore;
+        else if (m_eFirstKey == KEY_DELETE)
+            --nAfter;
+    }
+
+    nStart = (std::max)(0, nSelStart - nBefore);
+    nEnd = (std::min)(nLength, nSelEnd + nAfter);
+    return nStart != nEnd || !m_strInsert.empty();
+}
+
+/**
+ * @brief 蓄積した入力を文字列と選択範囲に適用します。
+ */
+bool CTextInjectionBuffer::ApplyTo(std::wstring &text, int &nSelStart, int &nSelEnd) const
+{
+    int nStart = 0;
+    int nEnd = 0;
+    if (!Resolve(nSelStart, nSelEnd, static_cast<int>(text.size()), nStart, nEnd))
+        return false;
+
+    text.replace(static_cast<std::size_t>(nStart), static_cast<std::size_t>(nEnd - nStart), m_strInsert);
+    nSelStart = nSelEnd = nStart + static_cast<int>(m_strInsert.size());
+    return true;
+}
+
+/**
+ * @brief 蓄積した入力を消去します。
+ * @details 文字列の領域は解放せずに再利用します。
+ */
+void CTextInjectionBuffer::Clear()
+{
+    m_strInsert.clear();
+    m_eFirstKey = KEY_NONE;
+    m_nDeleteBefore = 0;
+    m_nDeleteAfter = 0;
+    m_nKeyCount = 0;
+}
@@ -0,0 +1,80 @@
+﻿/**
+ * @file TextInjectionBuffer.h
+ * @brief ソフトウェアキーボードからの入力をまとめてエディットコントロールに反映するためのバッファのクラス宣言
+ * @details 文字の挿入・BackSpace・Delete を1文字ごとにエディットコントロールへ送らずに蓄積し、
+ * 「選択範囲を広げた範囲を1つの文字列で置き換える」1回の編集にまとめます。
+ * 置き換える範囲は、反映時点の選択範囲と文字列の長さから Resolve() で求めます。
+ * ApplyTo() は同じ編集を文字列と選択範囲のモデルに適用するもので、エディットコントロールと同じ結果になります。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <string>
+
+/**
+ * @class CTextInjectionBuffer
+ * @brief 未反映のキー入力を1回の置き換え編集にまとめるバッファ
+ * @details 蓄積する状態は「最初の入力の種類」「挿入する文字列」「選択範囲の前後で削除する文字数」だけです。
+ * 挿入した文字の直後の BackSpace は挿入した文字を取り消し、それ以外の BackSpace/Delete は
+ * 選択範囲の前後の文字を削除する数として数えます。反映時点の選択範囲が空でない場合は、
+ * 最初の入力が選択範囲を消す (挿入なら置き換える) ため、最初の BackSpace/Delete は文字数に数えません。
+ */
+class CTextInjectionBuffer
+{
+public:
+    CTextInjectionBuffer();
+
+    /// @brief 文字を挿入します (選択範囲が空でなければ置き換えます)。
+    void InsertChar(wchar_t ch);
+    /// @brief キャレットの前の1文字 (選択範囲が空でなければ選択範囲) を削除します。
+    void Backspace();
+    /// @brief キャレットの後ろの1文字 (選択範囲が空でなければ選択範囲) を削除します。
+    void Delete();
+
+    /// @brief 未反映の入力がないかを返します。
+    bool IsEmpty() const { return m_nKeyCount == 0; }
+    /// @brief 前回の Clear() から蓄積したキー入力の数を返します。
+    int GetKeyCount() const { return m_nKeyCount; }
+    /// @brief 置き換える文字列を返します。
+    const std::wstring &GetText() const { return m_strInsert; }
+
+    /**
+     * @brief 反映時点の選択範囲に対して、置き換える範囲を求めます。
+     * @param[in] nSelStart 選択範囲の開始位置
+     * @param[in] nSelEnd 選択範囲の終了位置 (キャレットだけの場合は nSelStart と同じ)
+     * @param[in] nLength 現在の文字列の長さ
+     * @param[out] nStart 置き換える範囲の開始位置
+     * @param[out] nEnd 置き換える範囲の終了位置
+     * @return 反映する編集がある場合はtrue (入力が互いに打ち消し合った場合もfalse)
+     */
+    bool Resolve(int nSelStart, int nSelEnd, int nLength, int &nStart, int &nEnd) const;
+
+    /**
+     * @brief 蓄積した入力を文字列と選択範囲に適用します (エディットコントロールの代わりのモデル)。
+     * @details 適用後の選択範囲は挿入した文字列の直後のキャレットになります。バッファの内容は消去しません。
+     * @param[in,out] text 文字列
+     * @param[in,out] nSelStart 選択範囲の開始位置
+     * @param[in,out] nSelEnd 選択範囲の終了位置
+     * @return 文字列を変更した場合はtrue
+     */
+    bool ApplyTo(std::wstring &text, int &nSelStart, int &nSelEnd) const;
+
+    /// @brief 蓄積した入力を消去します (反映後またはキャンセル時)。
+    void Clear();
+
+private:
+    /// @brief 入力の種類
+    enum KeyKind
+    {
+        KEY_NONE,      ///< 入力なし
+        KEY_INSERT,    ///< 文字の挿入
+        KEY_BACKSPACE, ///< BackSpace
+        KEY_DELETE     ///< Delete
+    };
+
+    std::wstring m_strInsert; ///< 置き換える文字列
+    KeyKind m_eFirstKey;      ///< 最初の入力の種類 (選択範囲が空でなければ、この入力が選択範囲を消します)
+    int m_nDeleteBefore;      ///< 選択範囲の前で削除する文字数 (最初の BackSpace を含む)
+    int m_nDeleteAfter;       ///< 選択範囲の後ろで削除する文字数 (最初の Delete を含む)
+    int m_nKeyCount;          ///< 蓄積したキー入力の数
+};
@@ -0,0 +1,272 @@
+﻿/**
+ * @file TriggerEngine.cpp
+ * @brief トリガーエンジンの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "TriggerEngine.h"
+
+#include <algorithm>
+
+/**
+ * @brief CTriggerEngineクラスのコンストラクタ
+ */
+CTriggerEngine::CTriggerEngine(DeferFunc defer)
+    : m_defer(std::move(defer)), m_nEpoch(0), m_nEvaluations(0), m_nFires(0)
+{
+}
+
+/**
+ * @brief 監視値を登録します。
+ */
+CTriggerEngine::ValueId CTriggerEngine::RegisterValue(const char *pszName, double dInitial)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::string name(pszName != nullptr ? pszName : "");
+    auto it = m_valueNames.find(name);
+    if (it != m_valueNames.end())
+        return it->second;
+
+    const ValueId nId = static_cast<ValueId>(m_values.size());
+    m_values.push_back(dInitial);
+    m_dependents.emplace_back();
+    m_valueNames.emplace(name, nId);
+    return nId;
+}
+
+/**
+ * @brief 名前から監視値の識別子を返します。
+ */
+CTriggerEngine::ValueId CTriggerEngine::FindValue(const char *pszName) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_valueNames.find(pszName != nullptr ? pszName : "");
+    return (it != m_valueNames.end()) ? it->second : INVALID_ID;
+}
+
+/**
+ * @brief 監視値の現在値を返します。
+ */
+double CTriggerEngine::GetValue(ValueId nId) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (nId < m_values.size()) ? m_values[nId] : 0.0;
+}
+
+/**
+ * @brief 監視値を更新し、依存する条件だけを再評価します。
+ */
+std::size_t CTriggerEngine::SetValue(ValueId nId, double dValue)
+{
+    return SetValues({ std::make_pair(nId, dValue) });
+}
+
+/**
+ * @brief 複数の監視値をまとめて更新し、依存する条件をそれぞれ1回だけ再評価します。
+ * @details 先に全ての値を書き換えてから評価するため、述語は更新後の値の組み合わせだけを見ます。
+ * 同じ一括更新の中で既に評価した条件は、一括更新の番号で判別して飛ばします。
+ */
+std::size_t CTriggerEngine::SetValues(std::initializer_list<std::pair<ValueId, double>> values)
+{
+    FiredList fired;
+    std::size_t nEvaluated = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool bChanged = false;
+        for (const auto &value : values)
+        {
+            if (value.first < m_values.size() && m_values[value.first] != value.second)
+            {
+                m_values[value.first] = value.second;
+                bChanged = true;
+            }
+        }
+        if (!bChanged)
+            return 0;
+
+        // 変化した値は書き換え済みのため、依存する条件を集めるときは変化の有無を問わず全て対象とする
+        const std::uint64_t nEpoch = ++m_nEpoch;
+        for (const auto &value : values)
+        {
+            if (value.first >= m_dependents.size())
+                continue;
+            for (ConditionId nCond : m_dependents[value.first])
+            {
+                Condition &cond = m_conditions[nCond];
+                if (cond.nEpoch == nEpoch)
+                    continue;
+                cond.nEpoch = nEpoch;
+                Evaluate(nCond, fired);
+                ++nEvaluated;
+            }
+        }
+    }
+    Fire(fired);
+    return nEvaluated;
+}
+
+/**
+ * @brief 条件を登録します。
+ */
+CTriggerEngine::ConditionId CTriggerEngine::AddCondition(const std::vector<ValueId> &deps, Predicate predicate,
+                                                         Action action, Mode mode, std::uint32_t nDebounceMs)
+{
+    FiredList fired;
+    ConditionId nId;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (ValueId nDep : deps)
+        {
+            if (nDep >= m_values.size())
+                return INVALID_ID;
+        }
+
+        Condition cond;
+        cond.deps = deps;
+        std::sort(cond.deps.begin(), cond.deps.end());
+        cond.deps.erase(std::unique(cond.deps.begin(), cond.deps.end()), cond.deps.end());
+        cond.predicate = std::move(predicate);
+        cond.pAction = std::make_shared<const Action>(std::move(action));
+        cond.mode = mode;
+        cond.nDebounceMs = nDebounceMs;
+        cond.bActive = true;
+        cond.bRaw = false;
+        cond.bStable = false;
+        cond.nGeneration = 0;
+        cond.nEpoch = 0;
+
+        nId = static_cast<ConditionId>(m_conditions.size());
+        for (ValueId nDep : cond.deps)
+            m_dependents[nDep].push_back(nId);
+        m_conditions.push_back(std::move(cond));
+
+        Evaluate(nId, fired);
+    }
+    Fire(fired);
+    return nId;
+}
+
+/**
+ * @brief 条件の登録を解除します。
+ * @details 依存関係から外し、述語と処理を解放します。世代を進めて待機中のデバウンスを無効にします。
+ */
+void CTriggerEngine::RemoveCondition(ConditionId nId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (nId >= m_conditions.size() || !m_conditions[nId].bActive)
+        return;
+
+    Condition &cond = m_conditions[nId];
+    for (ValueId nDep : cond.deps)
+    {
+        std::vector<ConditionId> &dependents = m_dependents[nDep];
+        dependents.erase(std::remove(dependents.begin(), dependents.end(), nId), dependents.end());
+    }
+    cond.bActive = false;
+    ++cond.nGeneration;
+    cond.deps.clear();
+    cond.predicate = Predicate();
+    cond.pAction.reset();
+}
+
+/**
+ * @brief 条件の確定した成立/不成立を返します。
+ */
+bool CTriggerEngine::GetConditionState(ConditionId nId) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (nId < m_conditions.size()) && m_conditions[nId].bActive && m_conditions[nId].bStable;
+}
+
+/**
+ * @brief 条件を評価します。
+ * @details 評価結果が前回と同じ場合、レベル契機で成立が確定していれば処理を起動し、それ以外は何もしません。
+ * 評価結果が変わった場合は世代を進めます。確定状態と異なる結果はデバウンス時間の経過後に確定し、
+ * その間に結果が元に戻れば世代の不一致によって確定は取り消されます。
+ */
+void CTriggerEngine::Evaluate(ConditionId nId, FiredList &fired)
+{
+    Condition &cond = m_conditions[nId];
+    const bool bRaw = cond.predicate(Values(m_values));
+    m_nEvaluations.fetch_add(1, std::memory_order_relaxed);
+
+    if (bRaw == cond.bRaw)
+    {
+        if (bRaw && cond.bStable && cond.mode == MODE_LEVEL)
+            fired.emplace_back(cond.pAction, true);
+        return;
+    }
+
+    cond.bRaw = bRaw;
+    const std::uint64_t nGeneration = ++cond.nGeneration;
+    if (bRaw == cond.bStable)
+        return;
+
+    if (cond.nDebounceMs == 0 || !m_defer)
+    {
+        Settle(cond, bRaw, fired);
+        return;
+    }
+
+    // 遅延実行関数はロック保持中に呼び出すため、エンジンを呼び出さずに登録だけ行うものであること
+    if (!m_defer(cond.nDebounceMs, [this, nId, nGeneration]() { OnDebounceElapsed(nId, nGeneration); }))
+        Settle(cond, bRaw, fired);
+}
+
+/**
+ * @brief 条件の成立/不成立を確定し、契機に該当すれば起動する処理に加えます。
+ */
+void CTriggerEngine::Settle(Condition &cond, bool bState, FiredList &fired)
+{
+    if (cond.bStable == bState)
+        return;
+    cond.bStable = bState;
+
+    bool bFire = false;
+    switch (cond.mode)
+    {
+    case MODE_RISING_EDGE:
+    case MODE_LEVEL:
+        bFire = bState;
+        break;
+    case MODE_FALLING_EDGE:
+        bFire = !bState;
+        break;
+    case MODE_BOTH_EDGES:
+        bFire = true;
+        break;
+    }
+    if (bFire)
+        fired.emplace_back(cond.pAction, bState);
+}
+
+/**
+ * @brief デバウンス時間が経過したときに呼び出されます。
+ * @details 待機を始めてから評価結果が変わっていなければ (世代が一致すれば)、その結果で確定します。
+ */
+void CTriggerEngine::OnDebounceElapsed(ConditionId nId, std::uint64_t nGeneration)
+{
+    FiredList fired;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (nId >= m_conditions.size())
+            return;
+        Condition &cond = m_conditions[nId];
+        if (!cond.bActive || cond.nGeneration != nGeneration)
+            return;
+        Settle(cond, cond.bRaw, fired);
+    }
+    Fire(fired);
+}
+
+/**
+ * @brief 処理を起動します。
+ */
+void CTriggerEngine::Fire(const FiredList &fired)
+{
+    for (const auto &entry : fired)
+    {
+        m_nFires.fetch_add(1, std::memory_order_relaxed);
+        if (entry.first && *entry.first)
+            (*entry.first)(entry.second);
+    }
+}
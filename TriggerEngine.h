@@ -0,0 +1,181 @@
+﻿/**
+ * @file TriggerEngine.h
+ * @brief 監視値の変化をきっかけに条件を評価して処理を起動するトリガーエンジンのクラス宣言
+ * @details 条件は「監視値に対する述語」として登録し、依存する監視値を明示します。
+ * 値の提供側は値が変わったときだけ SetValue() で通知し、エンジンはその値に依存する条件だけを再評価します。
+ * 評価結果の変化 (エッジ) または成立中の再評価 (レベル) で処理を起動し、チャタリングはデバウンス時間で抑えます。
+ * 値が変わらない限り評価もタイマーも発生しないため、周期的な起床はありません。
+ * デバウンスの待機は差し替え可能な遅延実行関数 (アプリケーションではタスクスケジューラ) に委ねます。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class CTriggerEngine
+ * @brief 依存関係に基づいて条件を差分評価するトリガーエンジン
+ * @details 全メンバ関数は任意のスレッドから呼び出せます。
+ * 述語はエンジンのロックを保持したまま呼び出すため、短時間で終わり、エンジンを呼び出さないものにしてください。
+ * 処理 (Action) はロックを解放してから、値を通知したスレッド (デバウンス時は遅延実行関数のスレッド) で呼び出します。
+ */
+class CTriggerEngine
+{
+public:
+    /// @brief 監視値の識別子
+    typedef std::uint32_t ValueId;
+    /// @brief 条件の識別子
+    typedef std::uint32_t ConditionId;
+
+    /// @brief 無効な識別子
+    static constexpr std::uint32_t INVALID_ID = 0xFFFFFFFFu;
+
+    /// @brief 処理を起動する契機
+    enum Mode
+    {
+        MODE_RISING_EDGE,   ///< 不成立 → 成立に変わったとき
+        MODE_FALLING_EDGE,  ///< 成立 → 不成立に変わったとき
+        MODE_BOTH_EDGES,    ///< 成立/不成立が変わったとき
+        MODE_LEVEL          ///< 成立に変わったとき、および成立中に依存値が変わって再評価されるたび
+    };
+
+    /**
+     * @class Values
+     * @brief 述語に渡す監視値の読み取り専用ビュー
+     */
+    class Values
+    {
+    public:
+        explicit Values(const std::vector<double> &values) : m_values(values) {}
+        /// @brief 監視値を返します (範囲外の識別子は0)。
+        double operator[](ValueId nId) const { return (nId < m_values.size()) ? m_values[nId] : 0.0; }
+
+    private:
+        const std::vector<double> &m_values;
+    };
+
+    /// @brief 条件の述語 (成立ならtrue)
+    typedef std::function<bool(const Values &)> Predicate;
+    /// @brief 条件に応じて起動する処理 (引数は確定した成立/不成立)
+    typedef std::function<void(bool bState)> Action;
+    /// @brief 指定時間後に関数を実行させる遅延実行関数 (受け付けた場合はtrueを返す)
+    typedef std::function<bool(std::uint32_t nDelayMs, std::function<void()> func)> DeferFunc;
+
+    /**
+     * @brief コンストラクタ
+     * @param[in] defer デバウンスに使う遅延実行関数 (空の場合、デバウンス時間は無視して即座に確定します)。
+     * 遅延実行された関数はこのオブジェクトを参照するため、遅延実行側はこのオブジェクトより先に停止させてください。
+     */
+    explicit CTriggerEngine(DeferFunc defer = DeferFunc());
+
+    CTriggerEngine(const CTriggerEngine &) = delete;
+    CTriggerEngine &operator=(const CTriggerEngine &) = delete;
+
+    /**
+     * @brief 監視値を登録します。
+     * @details 同じ名前が登録済みの場合は、その識別子を返します (初期値は変更しません)。
+     * @param[in] pszName 監視値の名前
+     * @param[in] dInitial 初期値
+     * @return 監視値の識別子
+     */
+    ValueId RegisterValue(const char *pszName, double dInitial = 0.0);
+
+    /// @brief 名前から監視値の識別子を返します (未登録なら INVALID_ID)。
+    ValueId FindValue(const char *pszName) const;
+
+    /// @brief 監視値の現在値を返します。
+    double GetValue(ValueId nId) const;
+
+    /**
+     * @brief 監視値を更新し、依存する条件だけを再評価します。
+     * @details 値が変わらない場合は何も評価しません。
+     * @param[in] nId 監視値の識別子
+     * @param[in] dValue 新しい値
+     * @return 再評価した条件の数
+     */
+    std::size_t SetValue(ValueId nId, double dValue);
+
+    /**
+     * @brief 複数の監視値をまとめて更新し、依存する条件をそれぞれ1回だけ再評価します。
+     * @param[in] values 監視値の識別子と新しい値の組
+     * @return 再評価した条件の数
+     */
+    std::size_t SetValues(std::initializer_list<std::pair<ValueId, double>> values);
+
+    /**
+     * @brief 条件を登録します。
+     * @details 登録時に一度評価します。初期状態は不成立として扱うため、登録時点で成立している条件は
+     * (デバウンス後に) 不成立 → 成立の変化として処理を起動します。
+     * @param[in] deps 述語が参照する監視値の識別子
+     * @param[in] predicate 述語
+     * @param[in] action 起動する処理
+     * @param[in] mode 処理を起動する契機
+     * @param[in] nDebounceMs 評価結果がこの時間変わらなかったときに成立/不成立を確定します (ミリ秒、0なら即座)。
+     * @return 条件の識別子 (未登録の監視値に依存する場合は INVALID_ID)
+     */
+    ConditionId AddCondition(const std::vector<ValueId> &deps, Predicate predicate, Action action,
+                             Mode mode = MODE_RISING_EDGE, std::uint32_t nDebounceMs = 0);
+
+    /**
+     * @brief 条件の登録を解除します。
+     * @details 待機中のデバウンスは無効になります。既に起動が決まって別スレッドで実行中の処理は止めません。
+     * 識別子は再利用しません。
+     */
+    void RemoveCondition(ConditionId nId);
+
+    /// @brief 条件の確定した成立/不成立を返します。
+    bool GetConditionState(ConditionId nId) const;
+
+    /// @brief これまでに述語を評価した回数を返します。
+    std::uint64_t GetEvaluationCount() const { return m_nEvaluations.load(std::memory_order_relaxed); }
+    /// @brief これまでに処理を起動した回数を返します。
+    std::uint64_t GetFireCount() const { return m_nFires.load(std::memory_order_relaxed); }
+
+private:
+    /// @brief 登録された条件
+    struct Condition
+    {
+        std::vector<ValueId> deps;              ///< 依存する監視値
+        Predicate predicate;                    ///< 述語
+        std::shared_ptr<const Action> pAction;  ///< 起動する処理 (解除後も実行中の呼び出しを保護するため共有)
+        Mode mode;                              ///< 起動する契機
+        std::uint32_t nDebounceMs;              ///< デバウンス時間
+        bool bActive;                           ///< 登録中か
+        bool bRaw;                              ///< 最後に評価した結果
+        bool bStable;                           ///< 確定した成立/不成立
+        std::uint64_t nGeneration;              ///< 評価結果が変わるたびに進む世代 (待機中のデバウンスの照合用)
+        std::uint64_t nEpoch;                   ///< 最後に評価した一括更新の番号 (重複評価の防止用)
+    };
+
+    /// @brief 起動する処理と確定した状態の組
+    typedef std::vector<std::pair<std::shared_ptr<const Action>, bool>> FiredList;
+
+    /// @brief 条件を評価します (ロック保持中に呼び出します)。
+    void Evaluate(ConditionId nId, FiredList &fired);
+    /// @brief 条件の成立/不成立を確定し、契機に該当すれば起動する処理に加えます (ロック保持中に呼び出します)。
+    void Settle(Condition &cond, bool bState, FiredList &fired);
+    /// @brief デバウンス時間が経過したときに呼び出されます。
+    void OnDebounceElapsed(ConditionId nId, std::uint64_t nGeneration);
+    /// @brief 処理を起動します (ロック解放後に呼び出します)。
+    void Fire(const FiredList &fired);
+
+    DeferFunc m_defer;                                       ///< 遅延実行関数
+    mutable std::mutex m_mutex;                              ///< 以下のメンバの保護
+    std::vector<double> m_values;                            ///< 監視値
+    std::unordered_map<std::string, ValueId> m_valueNames;   ///< 名前 → 監視値の識別子
+    std::vector<std::vector<ConditionId>> m_dependents;      ///< 監視値ごとの依存する条件
+    std::vector<Condition> m_conditions;                     ///< 条件 (識別子が添字)
+    std::uint64_t m_nEpoch;                                  ///< 一括更新の番号
+
+    std::atomic<std::uint64_t> m_nEvaluations;               ///< 述語の評価回数
+    std::atomic<std::uint64_t> m_nFires;                     ///< 処理の起動回数
+};
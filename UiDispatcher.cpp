@@ -0,0 +1,176 @@
+﻿/**
+ * @file UiDispatcher.cpp
+ * @brief 型付きディスパッチャの実装
+ * @details プリコンパイル済みヘッダーを使用せず、標準ライブラリのみに依存します。
+ */
+#include "UiDispatcher.h"
+
+#include <chrono>
+#include <memory>
+
+std::atomic<std::uint32_t> CUiDispatcher::s_nNextTypeId(1);
+
+/**
+ * @brief CUiDispatcherクラスのコンストラクタ
+ */
+CUiDispatcher::CUiDispatcher()
+    : m_pIncoming(nullptr), m_nPosted(0), m_nWakes(0), m_pHead(nullptr), m_pTail(nullptr), m_nExecuted(0),
+      m_nCoalesced(0)
+{
+}
+
+/**
+ * @brief CUiDispatcherクラスのデストラクタ
+ * @details 未実行の項目は実行せずに破棄します。
+ */
+CUiDispatcher::~CUiDispatcher()
+{
+    Clear();
+}
+
+/**
+ * @brief 実行スレッドを起こす関数を設定します。
+ */
+void CUiDispatcher::SetWakeFunc(WakeFunc wake)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake = std::move(wake);
+    }
+    if (m_pIncoming.load(std::memory_order_acquire) != nullptr)
+        Wake();
+}
+
+/**
+ * @brief 項目を投稿キューに積みます。
+ * @details 投稿キューは先頭ポインタの比較交換だけで積むスタックです。取り出し側は全体を一度に交換して
+ * 取り出すため、ABA問題は起きません。積む直前にキューが空だった投稿だけが起床関数を呼び出します。
+ * 取り出された後の最初の投稿は必ず空のキューを見るため、起床要求を取りこぼすことはありません。
+ */
+void CUiDispatcher::Push(Node *pNode, Key key, bool bKeyed)
+{
+    pNode->key = key;
+    pNode->bKeyed = bKeyed;
+    m_nPosted.fetch_add(1, std::memory_order_relaxed);
+
+    Node *pHead = m_pIncoming.load(std::memory_order_relaxed);
+    do
+    {
+        pNode->pNext = pHead;
+    } while (!m_pIncoming.compare_exchange_weak(pHead, pNode, std::memory_order_release, std::memory_order_relaxed));
+
+    if (pHead == nullptr)
+        Wake();
+}
+
+/**
+ * @brief 起床関数を呼び出します。
+ */
+void CUiDispatcher::Wake()
+{
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    if (m_wake && m_wake())
+        m_nWakes.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 投稿キューの項目を投稿順に実行待ちリストへ移し、結合を適用します。
+ * @details スタックを反転して投稿順に並べ替えます。結合キーを持つ項目は、実行待ちの同じキーの項目に
+ * 置き換え済みの印を付け、新しい項目を最新として記録します。
+ */
+void CUiDispatcher::TakeIncoming()
+{
+    Node *pNode = m_pIncoming.exchange(nullptr, std::memory_order_acquire);
+    Node *pReversed = nullptr;
+    while (pNode != nullptr)
+    {
+        Node *pNext = pNode->pNext;
+        pNode->pNext = pReversed;
+        pReversed = pNode;
+        pNode = pNext;
+    }
+
+    while (pReversed != nullptr)
+    {
+        Node *pNext = pReversed->pNext;
+        pReversed->pNext = nullptr;
+        if (pReversed->bKeyed)
+        {
+            Node *&pLatest = m_latest[pReversed->key];
+            if (pLatest != nullptr)
+            {
+                pLatest->bSuperseded = true;
+                ++m_nCoalesced;
+            }
+            pLatest = pReversed;
+        }
+        if (m_pTail != nullptr)
+            m_pTail->pNext = pReversed;
+        else
+            m_pHead = pReversed;
+        m_pTail = pReversed;
+        pReversed = pNext;
+    }
+}
+
+/**
+ * @brief 溜まった項目を投稿順に実行します。
+ * @details 項目は実行待ちリストから外してから実行するため、項目の中でモーダルループが回って
+ * Drain() が再入しても、残りの項目がそのまま続けて処理されるだけです。
+ */
+bool CUiDispatcher::Drain(std::uint32_t nBudgetUs)
+{
+    using namespace std::chrono;
+    TakeIncoming();
+
+    const steady_clock::time_point deadline = steady_clock::now() + microseconds(nBudgetUs);
+    while (m_pHead != nullptr)
+    {
+        std::unique_ptr<Node> pNode(m_pHead);
+        m_pHead = pNode->pNext;
+        if (m_pHead == nullptr)
+            m_pTail = nullptr;
+        if (pNode->bKeyed)
+        {
+            auto it = m_latest.find(pNode->key);
+            if (it != m_latest.end() && it->second == pNode.get())
+                m_latest.erase(it);
+        }
+        if (pNode->bSuperseded)
+            continue;
+
+        ++m_nExecuted;
+        pNode->Invoke(*this);
+        if (steady_clock::now() >= deadline)
+            break;
+    }
+    return m_pHead != nullptr;
+}
+
+/**
+ * @brief 未実行の項目を全て実行せずに破棄します。
+ */
+void CUiDispatcher::Clear()
+{
+    TakeIncoming();
+    while (m_pHead != nullptr)
+    {
+        Node *pNext = m_pHead->pNext;
+        delete m_pHead;
+        m_pHead = pNext;
+    }
+    m_pTail = nullptr;
+    m_latest.clear();
+}
+
+/**
+ * @brief イベントをハンドラに渡します。
+ * @details ハンドラの中で同じ型のハンドラが再設定されても影響を受けないよう、呼び出し中は参照を保持します。
+ */
+void CUiDispatcher::Dispatch(std::uint32_t nType, void *pEvent)
+{
+    if (nType >= m_handlers.size() || !m_handlers[nType])
+        return;
+    const std::shared_ptr<const std::function<void(void *)>> pHandler = m_handlers[nType];
+    (*pHandler)(pEvent);
+}
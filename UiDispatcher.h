@@ -0,0 +1,203 @@
+﻿/**
+ * @file UiDispatcher.h
+ * @brief 任意のスレッドからUIスレッドへ処理やイベントを届ける型付きディスパッチャのクラス宣言
+ * @details 呼び出し側はムーブのみ可能なクロージャや型付きイベントを Post() でロックフリーのキューに積みます。
+ * キューが空から非空に変わったときだけ起床関数 (Windowsでは登録済みメッセージ1種類のポスト) を呼び出すため、
+ * 連続した投稿でもメッセージキューには起床要求が1つしか積まれません。
+ * UIスレッドは起床要求を受けるたびに Drain() で溜まった項目をまとめて実行し、時間予算を超えたら残りを次回に回します。
+ * 結合キーを指定した項目は、実行前に同じキーの項目が新たに積まれると古い方が破棄されます (後勝ち)。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class CUiDispatcher
+ * @brief ロックフリーの投稿キューと結合・時間予算付きの実行ループ
+ * @details Post 系の関数は任意のスレッドから呼び出せます。
+ * Drain()、Clear()、ハンドラの設定は、項目を実行する1つのスレッド (UIスレッド) からのみ呼び出してください。
+ * 実行中の項目からの投稿や、モーダルループ内での Drain() の再入にも対応しています。
+ */
+class CUiDispatcher
+{
+public:
+    /// @brief 結合キー
+    typedef std::uint64_t Key;
+    /// @brief 実行スレッドを起こす関数 (起床要求を受け付けた場合はtrueを返す)
+    typedef std::function<bool()> WakeFunc;
+
+    /// @brief Drain() 1回あたりの既定の時間予算 (マイクロ秒、60Hzの1フレームの約1/4)
+    static constexpr std::uint32_t DEFAULT_DRAIN_BUDGET_US = 4000;
+
+    CUiDispatcher();
+    ~CUiDispatcher();
+
+    CUiDispatcher(const CUiDispatcher &) = delete;
+    CUiDispatcher &operator=(const CUiDispatcher &) = delete;
+
+    /**
+     * @brief 実行スレッドを起こす関数を設定します (空の関数で解除)。
+     * @details 設定時点で未実行の項目があれば、すぐに起床関数を呼び出します。
+     */
+    void SetWakeFunc(WakeFunc wake);
+
+    /**
+     * @brief クロージャを投稿します。
+     * @param[in] func 実行スレッドで呼び出す関数オブジェクト (ムーブのみ可能でもよい)
+     */
+    template <typename Func>
+    void Post(Func &&func)
+    {
+        Push(new FuncNode<typename std::decay<Func>::type>(std::forward<Func>(func)), 0, false);
+    }
+
+    /**
+     * @brief クロージャを結合キー付きで投稿します。
+     * @details 同じチャネルの未実行の項目は破棄され、この項目だけが実行されます。
+     * @param[in] nChannel 結合のチャネル番号 (イベントの結合キーとは重なりません)
+     * @param[in] func 実行スレッドで呼び出す関数オブジェクト
+     */
+    template <typename Func>
+    void PostCoalesced(std::uint32_t nChannel, Func &&func)
+    {
+        Push(new FuncNode<typename std::decay<Func>::type>(std::forward<Func>(func)), nChannel, true);
+    }
+
+    /**
+     * @brief 型付きイベントを投稿します。
+     * @details 実行時に SetHandler() で設定されたイベントの型のハンドラを呼び出します (未設定なら破棄します)。
+     * @param[in] event イベント
+     */
+    template <typename Event>
+    void PostEvent(Event &&event)
+    {
+        typedef typename std::decay<Event>::type EventType;
+        Push(new EventNode<EventType>(std::forward<Event>(event)), 0, false);
+    }
+
+    /**
+     * @brief 型付きイベントを結合キー付きで投稿します。
+     * @details 同じ型・同じ副キーの未実行のイベントは破棄され、このイベントだけが処理されます。
+     * @param[in] event イベント
+     * @param[in] nSubKey 同じ型のイベントを区別する副キー
+     */
+    template <typename Event>
+    void PostEventCoalesced(Event &&event, std::uint32_t nSubKey = 0)
+    {
+        typedef typename std::decay<Event>::type EventType;
+        Push(new EventNode<EventType>(std::forward<Event>(event)),
+             (static_cast<Key>(TypeId<EventType>()) << 32) | nSubKey, true);
+    }
+
+    /**
+     * @brief イベントの型に対するハンドラを設定します (空の関数で解除)。
+     * @param[in] handler イベントを処理する関数
+     */
+    template <typename Event>
+    void SetHandler(std::function<void(Event &)> handler)
+    {
+        const std::uint32_t nType = TypeId<Event>();
+        if (m_handlers.size() <= nType)
+            m_handlers.resize(nType + 1);
+        if (handler)
+            m_handlers[nType] = std::make_shared<const std::function<void(void *)>>(
+                [handler](void *pEvent) { handler(*static_cast<Event *>(pEvent)); });
+        else
+            m_handlers[nType].reset();
+    }
+
+    /**
+     * @brief 溜まった項目を投稿順に実行します。
+     * @details 投稿キューの項目を全て取り込み、時間予算を使い切るまで実行します。
+     * @param[in] nBudgetUs 時間予算 (マイクロ秒、最低1項目は実行します)
+     * @return 未実行の項目が残っている場合はtrue (呼び出し側は次のメッセージループで再度呼び出すこと)
+     */
+    bool Drain(std::uint32_t nBudgetUs = DEFAULT_DRAIN_BUDGET_US);
+
+    /// @brief 未実行の項目を全て実行せずに破棄します。
+    void Clear();
+
+    /// @brief これまでに投稿された項目数を返します。
+    std::uint64_t GetPostedCount() const { return m_nPosted.load(std::memory_order_relaxed); }
+    /// @brief これまでに実行した項目数を返します。
+    std::uint64_t GetExecutedCount() const { return m_nExecuted; }
+    /// @brief これまでに結合によって破棄された項目数を返します。
+    std::uint64_t GetCoalescedCount() const { return m_nCoalesced; }
+    /// @brief これまでに起床関数を呼び出した回数を返します。
+    std::uint64_t GetWakeCount() const { return m_nWakes.load(std::memory_order_relaxed); }
+
+private:
+    /// @brief キューの項目の基底
+    struct Node
+    {
+        Node *pNext = nullptr;    ///< 次の項目
+        Key key = 0;              ///< 結合キー
+        bool bKeyed = false;      ///< 結合キーを持つか
+        bool bSuperseded = false; ///< 同じキーの新しい項目に置き換えられたか
+        virtual ~Node() = default;
+        /// @brief 項目を実行します。
+        virtual void Invoke(CUiDispatcher &dispatcher) = 0;
+    };
+
+    /// @brief クロージャの項目
+    template <typename Func>
+    struct FuncNode : Node
+    {
+        template <typename Arg>
+        explicit FuncNode(Arg &&arg) : func(std::forward<Arg>(arg)) {}
+        void Invoke(CUiDispatcher &) override { func(); }
+        Func func;
+    };
+
+    /// @brief 型付きイベントの項目
+    template <typename Event>
+    struct EventNode : Node
+    {
+        template <typename Arg>
+        explicit EventNode(Arg &&arg) : event(std::forward<Arg>(arg)) {}
+        void Invoke(CUiDispatcher &dispatcher) override { dispatcher.Dispatch(TypeId<Event>(), &event); }
+        Event event;
+    };
+
+    /// @brief イベントの型ごとに1から振られる番号を返します (0はクロージャ用)。
+    template <typename Event>
+    static std::uint32_t TypeId()
+    {
+        static const std::uint32_t s_nId = s_nNextTypeId.fetch_add(1, std::memory_order_relaxed);
+        return s_nId;
+    }
+
+    /// @brief 項目を投稿キューに積み、空から非空に変わった場合は起床関数を呼び出します。
+    void Push(Node *pNode, Key key, bool bKeyed);
+    /// @brief 起床関数を呼び出します。
+    void Wake();
+    /// @brief 投稿キューの項目を投稿順に実行待ちリストへ移し、結合を適用します。
+    void TakeIncoming();
+    /// @brief イベントをハンドラに渡します。
+    void Dispatch(std::uint32_t nType, void *pEvent);
+
+    static std::atomic<std::uint32_t> s_nNextTypeId;        ///< 次に振るイベントの型番号
+
+    std::atomic<Node *> m_pIncoming;                        ///< 投稿キュー (後に積んだ項目が先頭のスタック)
+    std::mutex m_wakeMutex;                                 ///< 起床関数の保護
+    WakeFunc m_wake;                                        ///< 起床関数
+    std::atomic<std::uint64_t> m_nPosted;                   ///< 投稿された項目数
+    std::atomic<std::uint64_t> m_nWakes;                    ///< 起床関数の呼び出し回数
+
+    // --- 以下は実行スレッドのみが読み書きする ---
+    Node *m_pHead;                                          ///< 実行待ちリストの先頭
+    Node *m_pTail;                                          ///< 実行待ちリストの末尾
+    std::unordered_map<Key, Node *> m_latest;               ///< 結合キー → 実行待ちの最新の項目
+    std::vector<std::shared_ptr<const std::function<void(void *)>>> m_handlers; ///< イベントの型番号 → ハンドラ
+    std::uint64_t m_nExecuted;                              ///< 実行した項目数
+    std::uint64_t m_nCoalesced;                             ///< 結合で破棄した項目数
+};
@@ -5,6 +5,19 @@
 #include "pch.h"
 #include "MFCApplication4.h"
 #include "View1.h"
+#include "InputTrace.h"
+#include "PaintMetrics.h"
+#include "GdiResourceCache.h"
+#include "ViewCompositor.h"
+
+namespace
+{
+    /// @brief CView1 に配置する子コントロールの宣言
+    const CHILD_CONTROL_DESC s_childControls[] = {
+        { CHILD_CONTROL_CENTER_EDIT, 1003, { 10, 10, 50, 50 }, _T("1234"), 4 },
+        { CHILD_CONTROL_CENTER_EDIT, 1005, { 60, 10, 110, 50 }, _T("5678"), 4 },
+    };
+}
 
 // View1
 
@@ -17,133 +30,147 @@ IMPLEMENT_DYNCREATE(CView1, CView)
 // BEGIN_MESSAGE_MAPブロック
 // Windowsメッセージと、それを処理するクラスのメンバ関数（ハンドラ）を関連付けます。
 BEGIN_MESSAGE_MAP(CView1, CView)
+    ON_WM_CREATE()
     ON_WM_DESTROY()
+    ON_MESSAGE(WM_APP_COMPOSE_CHILDREN, &CView1::OnComposeChildren)
+    ON_WM_PAINT()
+    ON_WM_ERASEBKGND()
 END_MESSAGE_MAP()
 
 /**
- * @brief ワーカースレッドのエントリポイントとなる静的メンバ関数。
- * @details 5秒待機した後、初回のみ親ウィンドウにCView2の表示を要求するメッセージを送信します。
- * スレッド停止イベントを監視しており、メインスレッドからの要求に応じて安全に終了します。
- * @param[in] pParam スレッドに渡されるパラメータ。この実装ではCView1のインスタンスへのポインタ(this)。
- * @return スレッドの終了コード。正常終了時は0、エラー時は1。
+ * @brief コンストラクタ
+ * @details 子コントロールはウィンドウ作成時に生成します (描画処理の中では生成しません)。
  */
-UINT CView1::WorkerThreadProc(LPVOID pParam)
+CView1::CView1() noexcept
+    : m_composer(s_childControls, _countof(s_childControls), CViewComposer::COMPOSE_ON_CREATE, CPaintMetrics::SITE_VIEW1_FIRST_PAINT)
 {
-    // この関数は複数回呼び出される可能性があるため、static変数で初回実行を管理します。
-    static bool firstTime = true;
-    CView1* pView = static_cast<CView1*>(pParam);
-    if (pView == nullptr) return 1; // パラメータが不正な場合はエラー
+}
 
-    while (true) // スレッドのメインループ
+/**
+ * @brief ウィンドウが作成される際に呼び出されます (WM_CREATE)。
+ * @details 条件A (この実装ではビューが表示され続けていること) をトリガーエンジンに登録し、
+ * 成立が CONDITION_A_DELAY_MS の間続いたらメインダイアログにCView2の表示を要求します。
+ * 専用スレッドやポーリングは使わず、監視値の変化とデバウンスのタイマーだけで判定します。
+ * 装置の状態を条件にする場合も、その提供側が SetValue() で値の変化を通知するだけで同じ仕組みで動作します。
+ * 処理はビューを参照せずイベントを投稿するだけのため、ビューの破棄と並行して実行されても安全です。
+ * @param[in] lpCreateStruct ウィンドウの作成パラメータ
+ * @return 作成を続行する場合は0、中止する場合は-1
+ */
+int CView1::OnCreate(LPCREATESTRUCT lpCreateStruct)
+{
+    if (CView::OnCreate(lpCreateStruct) == -1)
+        return -1;
+
+    // メインダイアログにView2の表示を要求するイベントを投稿します。
+    // ワーカーからUIオブジェクトを直接操作するのは危険なため、
+    // ディスパッチャを使用してUIスレッドに非同期で処理を依頼します。
+    CTriggerEngine &engine = theApp.GetTriggerEngine();
+    const CTriggerEngine::ValueId nShown = engine.RegisterValue("View1.Shown");
+    m_nShownValue = nShown;
+    m_nConditionA = engine.AddCondition(
+        { nShown },
+        [nShown](const CTriggerEngine::Values &values) { return values[nShown] != 0.0; },
+        [](bool) {
+            TRACE("Condition A detected. Notifying main frame.\n");
+            theApp.GetUiDispatcher().PostEventCoalesced(SHOW_VIEW2_EVENT());
+        },
+        CTriggerEngine::MODE_RISING_EDGE, CONDITION_A_DELAY_MS);
+    if (m_nConditionA == CTriggerEngine::INVALID_ID)
     {
-        // --- 「条件A」を監視するループ ---
-        // ここでは例として、5秒待機、または停止イベントがシグナル状態になるのを待ちます。
-        DWORD dwResult = ::WaitForSingleObject(pView->m_eventStopThread.m_hObject, 5000);
-
-        // スレッドが停止要求を受け取ったかチェック
-        if (dwResult == WAIT_OBJECT_0)
-        {
-            // 停止イベントがシグナル状態になった -> スレッドを正常終了
-            TRACE("Worker thread received stop signal. Exiting.\n");
-            return 0;
-        }
-
-        // WAIT_TIMEOUT の場合 -> 条件Aが成立したとみなす
-        if (firstTime)
-        {
-            TRACE("Condition A detected in worker thread. Notifying main frame.\n");
-
-            // 親ウィンドウにView2の表示を要求するメッセージをポストします。
-            // ワーカースレッドからUIオブジェクトを直接操作するのは危険なため、
-            // PostMessageを使用してUIスレッドに非同期で処理を依頼するのが安全な方法です。
-            if (pView->GetParent() && ::IsWindow(pView->GetParent()->GetSafeHwnd()))
-            {
-                ::PostMessage(pView->GetParent()->GetSafeHwnd(), WM_SHOW_VIEW2, 0, 0);
-            }
-
-            TRACE("Worker thread finished its job.\n");
-            firstTime = false; // 処理は初回のみ行い、フラグを倒す
-        }
-        
-        // ポーリング間隔
-        Sleep(1000);
+        TRACE("Failed to register condition A.\n");
     }
+    engine.SetValue(nShown, 1.0);
 
-    return 1; // 通常ここには到達しない
+    m_composer.OnCreate(this);
+    return 0;
 }
 
 
 /**
  * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
- * @details ワーカースレッドが起動している場合、安全に停止処理を行います。
+ * @details 表示状態の監視値を下ろし、条件Aの登録を解除します。
+ * 待機中のデバウンスは登録解除で無効になるため、スレッドやタイマーの終了を待つ必要はありません。
  */
 void CView1::OnDestroy()
 {
-    // スレッドが作成されている場合、安全に停止させる
-    if (m_pWorkerThread)
+    CTriggerEngine &engine = theApp.GetTriggerEngine();
+    if (m_nShownValue != CTriggerEngine::INVALID_ID)
     {
-        TRACE("View1 is being destroyed. Stopping worker thread...\n");
-
-        // 1. ワーカースレッドに停止を通知するためにイベントをシグナル状態にする
-        m_eventStopThread.SetEvent();
-
-        // 2. スレッドが実際に終了するのを待つ (タイムアウトを5秒に設定)
-        //    これにより、スレッドがリソースを解放し、完全に終了するのを保証します。
-        ::WaitForSingleObject(m_pWorkerThread->m_hThread, 5000);
-
-        TRACE("Worker thread stopped successfully.\n");
+        engine.SetValue(m_nShownValue, 0.0);
     }
+    engine.RemoveCondition(m_nConditionA);
+    m_nConditionA = CTriggerEngine::INVALID_ID;
+    m_composer.Destroy();
 
     // 基底クラスのOnDestroyを呼び出す
     CView::OnDestroy();
 }
 
+/**
+ * @brief カスタムメッセージ WM_APP_COMPOSE_CHILDREN のハンドラ
+ * @details 子コントロールの生成を初回描画の後に遅らせた場合に、ここで生成します。
+ * @param wParam 未使用
+ * @param lParam 未使用
+ * @return 常に0
+ */
+LRESULT CView1::OnComposeChildren(WPARAM wParam, LPARAM lParam)
+{
+    m_composer.Compose(this);
+    return 0;
+}
+
+/**
+ * @brief ウィンドウの描画要求を処理します (WM_PAINT)。
+ * @details 合成が設定されていれば、描画の必要な領域のうち見える部分だけをバックバッファで合成して転送します。
+ * 合成できない場合は CView::OnPaint と同じく OnDraw で直接描画します。
+ */
+void CView1::OnPaint()
+{
+    CPaintDC dc(this);
+    if (m_pCompositor != nullptr && m_pCompositor->PaintView(this, &dc, dc.m_ps.rcPaint))
+        return;
+    OnPrepareDC(&dc);
+    OnDraw(&dc);
+}
+
+/**
+ * @brief 背景の消去要求を処理します (WM_ERASEBKGND)。
+ * @details 合成が設定されていれば背景は合成で塗りつぶすため、ここでは消去しません。
+ * @param[in] pDC 描画に使用するデバイスコンテキストへのポインタ。
+ * @return 背景を消去した (または不要な) 場合は0以外
+ */
+BOOL CView1::OnEraseBkgnd(CDC *pDC)
+{
+    if (m_pCompositor != nullptr)
+        return TRUE;
+    return CView::OnEraseBkgnd(pDC);
+}
+
 /**
  * @brief ビューの描画処理を行います (WM_PAINT)。
- * @details ビューの背景を描画し、初回描画時に子コントロールであるCCenterEditを動的に生成・配置します。
+ * @details ビューの背景を描画します。子コントロールは OnCreate で生成済みのため、ここではウィンドウを生成しません。
  * @param[in] pDC 描画に使用するデバイスコンテキストへのポインタ。
  */
 void CView1::OnDraw(CDC* pDC)
 {
+    CInputTraceScope trace("CView1::OnDraw", true);
+    CPaintMetricsScope metrics(CPaintMetrics::SITE_VIEW1_DRAW);
+    CGdiFrameScope gdiFrame;
+
     CRect rectClient;
     GetClientRect(&rectClient);
     
-    // 背景色で塗りつぶし
-    CBrush brush;
-    brush.CreateSolidBrush(RGB(0xDD, 0x88, 0x11));
-    pDC->FillRect(rectClient, &brush);
+    // 背景色で塗りつぶし (ブラシはキャッシュから取得)
+    HBRUSH hBrush = reinterpret_cast<HBRUSH>(CGdiResourceCache::Get(GDI_RESOURCE_KEY::SolidBrush(RGB(0xDD, 0x88, 0x11))));
+    pDC->FillRect(rectClient, CBrush::FromHandle(hBrush));
 
-    // m_editCustom1がまだ生成されていなければ、ここで生成する
-    if (m_editCustom1 == nullptr)
-    {
-        m_editCustom1 = new CCenterEdit();
-        CRect rect1(10, 10, 50, 50); // ビュー内の位置とサイズを指定
-        m_editCustom1->Create(WS_CHILD | WS_VISIBLE, rect1, this, 1003);
-        m_editCustom1->ShowWindow(TRUE);
-        m_editCustom1->SetWindowTextW(_T("1234")); // 初期値を設定
-        m_editCustom1->SetFont(GetFont()); // 親と同じフォントを設定
-        m_editCustom1->SetLimitText(4); // 入力文字数を4文字に制限
-        m_editCustom1->SetWindowPos(nullptr, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE);
-    }
-    
-    // m_editCustom2がまだ生成されていなければ、ここで生成する
-    if (m_editCustom2 == nullptr)
-    {
-        m_editCustom2 = new CCenterEdit();
-        CRect rect1(60, 10, 110, 50); // ビュー内の位置とサイズを指定
-        m_editCustom2->Create(WS_CHILD | WS_VISIBLE, rect1, this, 1005);
-        m_editCustom2->ShowWindow(TRUE);
-        m_editCustom2->SetWindowTextW(_T("5678")); // 初期値を設定
-        m_editCustom2->SetFont(GetFont()); // 親と同じフォントを設定
-        m_editCustom2->SetLimitText(4); // 入力文字数を4文字に制限
-        m_editCustom2->SetWindowPos(nullptr, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE);
-    }
+    m_composer.OnDrawFinished(this);
 }
 
 
 /**
  * @brief ウィンドウが作成される直前にフレームワークから呼び出されます。
- * @details このビューの上に他のビューが重なることを想定し、描画スタイルを調整します。
+ * @details 兄弟ウィンドウとの重なりは合成 (CViewCompositor) で扱うため、標準のスタイルのまま作成します。
  * @param[in,out] cs ウィンドウの作成パラメータを保持するCREATESTRUCT構造体。
  * @return ウィンドウ作成を続行する場合はTRUE、中止する場合はFALSE。
  */
@@ -153,15 +180,11 @@ BOOL CView1::PreCreateWindow(CREATESTRUCT& cs)
     if (!CView::PreCreateWindow(cs))
         return FALSE;
 
-    // WS_CLIPSIBLINGS スタイルを削除します。
-    // これにより、このビュー(CView1)の上に兄弟ウィンドウ(CView2)が重なった際、
-    // CView1の描画領域がCView2によってクリッピング（切り抜かれ）されるのを防ぎます。
-    cs.style &= ~WS_CLIPSIBLINGS;
-
-    // WS_EX_TRANSPARENT 拡張スタイルを追加します。
-    // これにより、このビューの下にある兄弟ウィンドウが先に描画されるようになり、
-    // 透過的な効果が得られます。また、このビューへのマウスメッセージは下のウィンドウに透過します。
-    cs.dwExStyle |= WS_EX_TRANSPARENT;
+    // WS_CLIPSIBLINGS を付け、兄弟ウィンドウ(CView2)と重なる部分には描画しません。
+    // WS_EX_TRANSPARENT は付けません (重なった部分を兄弟ウィンドウと二重に描画し、描画順が不定になるため)。
+    // CView2 と重なる部分の表示は、CView2 のウィンドウリージョンから除くことで CView1 側に残します。
+    cs.style |= WS_CLIPSIBLINGS;
+    cs.dwExStyle &= ~WS_EX_TRANSPARENT;
     return TRUE;
 }
 
@@ -1,23 +1,34 @@
 ﻿/**
  * @file View1.h
  * @brief CViewを派生したプライマリビューのクラス宣言
- * @details このビューはメインダイアログに配置され、ワーカースレッドを起動して
- * 特定の条件を監視し、条件成立時に親ウィンドウへ通知する機能を持っています。
+ * @details このビューはメインダイアログに配置され、アプリケーション共有のトリガーエンジンに
+ * 特定の条件を登録し、条件成立時に親ウィンドウへ通知する機能を持っています。
  */
 #pragma once
 
-#include "CenterEdit.h"
+#include "TriggerEngine.h"
+#include "ViewComposer.h"
 
-/// @brief ワーカースレッドからView2の表示をトリガーするためのカスタムメッセージ
-#define WM_SHOW_VIEW2 (WM_APP + 2)
+class CViewCompositor;
+
+/**
+ * @struct SHOW_VIEW2_EVENT
+ * @brief 条件Aの成立で、メインダイアログにCView2の表示を要求するイベント
+ * @details CUiDispatcher に結合キー付きで投稿します。
+ */
+struct SHOW_VIEW2_EVENT
+{
+};
 
 /**
  * @class CView1
- * @brief ワーカースレッドを持つプライマリカスタムビュー
- * @details CViewを継承し、インスタンス生成時にワーカースレッドを起動します。
- * スレッドは特定の条件（この実装では5秒の待機）を監視し、成立すると
- * 親ウィンドウにWM_SHOW_VIEW2メッセージを送信してCView2の表示を要求します。
- * ウィンドウ破棄時にはワーカースレッドを安全に停止させます。
+ * @brief 条件Aを監視するプライマリカスタムビュー
+ * @details CViewを継承し、ウィンドウ作成時に条件Aをトリガーエンジンに登録します。
+ * 条件A（この実装ではビューが5秒間表示され続けたこと）が成立すると、
+ * SHOW_VIEW2_EVENT を投稿してメインダイアログにCView2の表示を要求します。
+ * 成立の判定は監視値の変化とデバウンスのタイマーだけで行うため、ポーリングはしません。
+ * 子コントロール (CCenterEdit 2つ) は宣言の表から CViewComposer がウィンドウ作成時に生成・所有します。
+ * 描画は、メインダイアログの CViewCompositor を経由して、CView2 と重ならない部分も含めた見える部分だけを行います。
  */
 class CView1 : public CView
 {
@@ -28,21 +39,13 @@ protected: // シリアル化からのみ作成します。
      */
     DECLARE_DYNCREATE(CView1)
     
-    /// @brief ビュー内に配置されるカスタムエディットコントロールへのポインタ1
-    CCenterEdit* m_editCustom1 = nullptr;
-    /// @brief ビュー内に配置されるカスタムエディットコントロールへのポインタ2
-    CCenterEdit* m_editCustom2 = nullptr;
+    /// @brief ビュー内に配置する子コントロールの生成と所有 (ウィンドウ作成時に生成)
+    CViewComposer m_composer;
 
     // 属性
 
-    // 操作
-public:
-    /**
-     * @brief ワーカースレッドのエントリポイントとなる静的メンバ関数
-     * @param[in] pParam スレッドに渡されるパラメータ。この実装ではCView1のインスタンスへのポインタ(this)。
-     * @return スレッドの終了コード。
-     */
-    static UINT WorkerThreadProc(LPVOID pParam);
+    /// @brief 条件Aが成立するまでにビューが表示され続ける時間 (ミリ秒、条件Aのデバウンス時間)
+    static const UINT CONDITION_A_DELAY_MS = 5000;
 
     // オーバーライド
 public:
@@ -64,26 +67,22 @@ public:
 public:
     /**
      * @brief コンストラクタ
-     * @details このコンストラクタ内でワーカースレッドを起動します。
+     * @details 条件Aと子コントロールはウィンドウ作成時 (OnCreate) に登録・生成します。
      */
-    CView1() noexcept {
-        // ワーカースレッドを起動
-        m_pWorkerThread = AfxBeginThread(WorkerThreadProc, this);
-        if (!m_pWorkerThread)
-        {
-            AfxMessageBox(_T("Failed to create worker thread."), MB_ICONERROR);
-        }
-        else
-        {
-            TRACE("Worker thread started.\n");
-        }
-    };
+    CView1() noexcept;
     
     /**
      * @brief デストラクタ
-     * @details OnDestroyでワーカースレッドの停止処理が行われます。
+     * @details OnDestroyで条件Aの登録解除が行われます。
      */
     virtual ~CView1() noexcept override = default;
+
+    /**
+     * @brief 重なったビューの合成を設定します。
+     * @details 設定すると、描画はバックバッファでの合成を経由し (背景も消去しません)、見える部分だけを描画します。
+     * @param[in] pCompositor 合成 (nullptrなら直接描画します)
+     */
+    void SetCompositor(CViewCompositor *pCompositor) { m_pCompositor = pCompositor; }
 #ifdef _DEBUG
     /**
      * @brief オブジェクトの有効性を診断します (デバッグビルドのみ)。
@@ -98,19 +97,52 @@ public:
 #endif
 
 protected:
-    /// @brief ワーカースレッドのインスタンスを指すポインタ
-    CWinThread* m_pWorkerThread;
-    /// @brief ワーカースレッドに停止を通知するためのイベントオブジェクト
-    CEvent      m_eventStopThread;
+    /// @brief ビューの表示状態を表す監視値 (表示中は1)
+    CTriggerEngine::ValueId m_nShownValue = CTriggerEngine::INVALID_ID;
+    /// @brief 登録した条件Aの識別子
+    CTriggerEngine::ConditionId m_nConditionA = CTriggerEngine::INVALID_ID;
+    /// @brief 重なったビューの合成 (メインダイアログが所有、nullptrなら直接描画)
+    CViewCompositor *m_pCompositor = nullptr;
 
     // 生成された、メッセージ割り当て関数
 protected:
+    /**
+     * @brief ウィンドウが作成される際に呼び出されます (WM_CREATE)。
+     * @details 条件Aをトリガーエンジンに登録し、表示状態の監視値を更新します。子コントロールもここで生成します。
+     * @param[in] lpCreateStruct ウィンドウの作成パラメータ
+     * @return 作成を続行する場合は0、中止する場合は-1
+     */
+    afx_msg int OnCreate(LPCREATESTRUCT lpCreateStruct);
+
     /**
      * @brief ウィンドウが破棄される際に呼び出されます (WM_DESTROY)。
-     * @details ワーカースレッドを安全に停止させるために使用します。
+     * @details 表示状態の監視値を更新し、条件Aの登録を解除します。子コントロールを破棄・解放します。
      */
     afx_msg void OnDestroy();
-    
+
+    /**
+     * @brief カスタムメッセージ WM_APP_COMPOSE_CHILDREN のハンドラ
+     * @details 子コントロールの生成を初回描画の後に遅らせた場合に、ここで生成します。
+     * @param wParam 未使用
+     * @param lParam 未使用
+     * @return 常に0
+     */
+    afx_msg LRESULT OnComposeChildren(WPARAM wParam, LPARAM lParam);
+
+    /**
+     * @brief ウィンドウの描画要求を処理します (WM_PAINT)。
+     * @details 合成が設定されていれば、合成を経由して見える部分だけを描画します。そうでなければ OnDraw で直接描画します。
+     */
+    afx_msg void OnPaint();
+
+    /**
+     * @brief 背景の消去要求を処理します (WM_ERASEBKGND)。
+     * @details 合成が設定されていれば、背景は合成で塗りつぶすため消去しません (ちらつき防止)。
+     * @param[in] pDC 描画に使用するデバイスコンテキストへのポインタ。
+     * @return 背景を消去した (または不要な) 場合は0以外
+     */
+    afx_msg BOOL OnEraseBkgnd(CDC *pDC);
+
     /// @brief メッセージマップを宣言します。
     DECLARE_MESSAGE_MAP()
 };
\ No newline at end of file
@@ -0,0 +1,130 @@
+﻿/**
+ * @file ViewComposer.cpp
+ * @brief ビューの子コントロールを宣言から生成・所有するクラスの実装
+ */
+#include "pch.h"
+#include "ViewComposer.h"
+#include "CenterEdit.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+/**
+ * @brief コンストラクタ
+ */
+CViewComposer::CViewComposer(const CHILD_CONTROL_DESC *pControls, int nCount, EComposeTiming eTiming,
+                             CPaintMetrics::Site firstPaintSite)
+    : m_pControls(pControls), m_nCount(nCount), m_eTiming(eTiming), m_firstPaintSite(firstPaintSite), m_nCreatedNs(0),
+      m_bComposed(false), m_bFirstPaintDone(false)
+{
+}
+
+/**
+ * @brief デストラクタ
+ * @details 子コントロールが残っていれば破棄・解放します。
+ */
+CViewComposer::~CViewComposer()
+{
+    Destroy();
+}
+
+/**
+ * @brief ビューのウィンドウ作成時に呼び出します。
+ */
+void CViewComposer::OnCreate(CWnd *pView)
+{
+    m_nCreatedNs = CPaintMetrics::NowNs();
+    if (m_eTiming == COMPOSE_ON_CREATE)
+        Compose(pView);
+}
+
+/**
+ * @brief ビューの描画の終わりに呼び出します。
+ * @details 記録する時間には、作成時に生成した場合は子コントロールの生成時間も含まれます。
+ * 要素数には、初回描画の時点で生成済みの子コントロールの数を記録します。
+ */
+void CViewComposer::OnDrawFinished(CWnd *pView)
+{
+    if (m_bFirstPaintDone)
+        return;
+    m_bFirstPaintDone = true;
+
+    if (CPaintMetrics::IsEnabled())
+    {
+        CPaintMetrics::Record(m_firstPaintSite, CPaintMetrics::NowNs() - m_nCreatedNs, static_cast<std::uint32_t>(m_controls.size()),
+                              0);
+    }
+    if (!m_bComposed)
+        pView->PostMessage(WM_APP_COMPOSE_CHILDREN, 0, 0);
+}
+
+/**
+ * @brief 子コントロールを全て生成します。
+ * @details 生成に要した時間と生成したウィンドウの数は描画計測値 (SITE_VIEW_COMPOSE) に記録します。
+ */
+void CViewComposer::Compose(CWnd *pView)
+{
+    if (m_bComposed || pView->GetSafeHwnd() == nullptr)
+        return;
+    m_bComposed = true;
+
+    CPaintMetricsScope metrics(CPaintMetrics::SITE_VIEW_COMPOSE);
+    m_controls.reserve(m_nCount);
+    for (int i = 0; i < m_nCount; ++i)
+        m_controls.push_back(CreateControl(m_pControls[i], pView));
+    metrics.AddItems(static_cast<std::uint32_t>(m_nCount));
+    metrics.AddAllocations(static_cast<std::uint32_t>(m_nCount));
+}
+
+/**
+ * @brief 子コントロールを全て破棄・解放します。
+ * @details ビューの OnDestroy から呼び出すと、子ウィンドウはビューより先に破棄されます。
+ */
+void CViewComposer::Destroy()
+{
+    for (std::unique_ptr<CWnd> &pControl : m_controls)
+    {
+        if (pControl && pControl->GetSafeHwnd() != nullptr)
+            pControl->DestroyWindow();
+    }
+    m_controls.clear();
+    m_bComposed = false;
+}
+
+/**
+ * @brief コントロールIDの子コントロールを返します。
+ */
+CWnd *CViewComposer::GetControl(UINT nId) const
+{
+    for (size_t i = 0; i < m_controls.size(); ++i)
+    {
+        if (m_pControls[i].nId == nId)
+            return m_controls[i].get();
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 宣言から子コントロールを1つ生成します。
+ * @details フォントは親のビューと同じものを設定します。
+ */
+std::unique_ptr<CWnd> CViewComposer::CreateControl(const CHILD_CONTROL_DESC &desc, CWnd *pView) const
+{
+    switch (desc.eType)
+    {
+    case CHILD_CONTROL_CENTER_EDIT:
+    {
+        std::unique_ptr<CCenterEdit> pEdit(new CCenterEdit());
+        pEdit->Create(WS_CHILD | WS_VISIBLE, desc.rect, pView, desc.nId);
+        if (desc.pszText != nullptr)
+            pEdit->SetWindowText(desc.pszText);
+        pEdit->SetFont(pView->GetFont());
+        if (desc.nLimitText > 0)
+            pEdit->SetLimitText(desc.nLimitText);
+        pEdit->SetWindowPos(&CWnd::wndTop, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE); // 兄弟ウィンドウより前面に置く
+        return std::unique_ptr<CWnd>(pEdit.release());
+    }
+    }
+    return nullptr;
+}
@@ -0,0 +1,112 @@
+﻿/**
+ * @file ViewComposer.h
+ * @brief ビューの子コントロールを宣言から生成・所有するクラスの宣言
+ * @details ビューは配置する子コントロール (種類・位置・ID・初期文字列・文字数の上限) を CHILD_CONTROL_DESC の表で宣言し、
+ * CViewComposer がウィンドウ作成時 (OnCreate) に一度だけ生成します。初回描画を速くしたいビューでは、
+ * 生成を初回描画の後に遅らせることもできます。描画処理 (OnDraw) の中ではウィンドウを生成しません。
+ * 生成した子コントロールは CViewComposer が所有し、ビューの破棄時に破棄・解放します。
+ * ビューの作成から初回描画の完了までの時間は描画計測値に記録します。
+ */
+#pragma once
+
+#include "PaintMetrics.h"
+
+#include <memory>
+#include <vector>
+
+/// @brief 初回描画の後に子コントロールを生成するためのカスタムメッセージ (ビュー宛て)
+#define WM_APP_COMPOSE_CHILDREN (WM_APP + 2)
+
+/// @brief 子コントロールの種類
+enum EChildControlType
+{
+    CHILD_CONTROL_CENTER_EDIT ///< CCenterEdit
+};
+
+/**
+ * @struct CHILD_CONTROL_DESC
+ * @brief ビューに配置する子コントロールの宣言
+ */
+struct CHILD_CONTROL_DESC
+{
+    EChildControlType eType; ///< 種類
+    UINT nId;                ///< コントロールID
+    RECT rect;               ///< ビューのクライアント座標での位置とサイズ
+    LPCTSTR pszText;         ///< 初期文字列 (nullptrなら設定しません)
+    UINT nLimitText;         ///< 入力できる文字数の上限 (0なら設定しません)
+};
+
+/**
+ * @class CViewComposer
+ * @brief ビューの子コントロールの表を生成・所有するクラス
+ * @details ビューは OnCreate / OnDraw / OnDestroy と WM_APP_COMPOSE_CHILDREN のハンドラから、
+ * 対応するメンバ関数を呼び出してください。
+ */
+class CViewComposer
+{
+public:
+    /// @brief 子コントロールを生成する時期
+    enum EComposeTiming
+    {
+        COMPOSE_ON_CREATE,        ///< ビューのウィンドウ作成時 (OnCreate)
+        COMPOSE_AFTER_FIRST_PAINT ///< 初回描画の後 (WM_APP_COMPOSE_CHILDREN を投稿して生成)
+    };
+
+    /**
+     * @brief コンストラクタ
+     * @param[in] pControls 子コントロールの宣言の表 (ビューより長く有効な静的な表)
+     * @param[in] nCount 表の要素数
+     * @param[in] eTiming 生成する時期
+     * @param[in] firstPaintSite 作成から初回描画の完了までの時間を記録する計測箇所
+     */
+    CViewComposer(const CHILD_CONTROL_DESC *pControls, int nCount, EComposeTiming eTiming, CPaintMetrics::Site firstPaintSite);
+    ~CViewComposer();
+
+    CViewComposer(const CViewComposer &) = delete;
+    CViewComposer &operator=(const CViewComposer &) = delete;
+
+    /**
+     * @brief ビューのウィンドウ作成時に呼び出します。
+     * @details 作成時刻を記録し、生成時期が COMPOSE_ON_CREATE であれば子コントロールを生成します。
+     * @param[in] pView ビュー
+     */
+    void OnCreate(CWnd *pView);
+
+    /**
+     * @brief ビューの描画の終わりに呼び出します。
+     * @details 初回だけ、作成からの時間を記録し、生成を遅らせている場合は WM_APP_COMPOSE_CHILDREN を投稿します。
+     * @param[in] pView ビュー
+     */
+    void OnDrawFinished(CWnd *pView);
+
+    /**
+     * @brief 子コントロールを全て生成します (生成済みであれば何もしません)。
+     * @param[in] pView 親となるビュー
+     */
+    void Compose(CWnd *pView);
+
+    /// @brief 子コントロールを全て破棄・解放します。
+    void Destroy();
+
+    /// @brief 子コントロールを生成済みかを返します。
+    bool IsComposed() const { return m_bComposed; }
+
+    /**
+     * @brief コントロールIDの子コントロールを返します。
+     * @return 子コントロール (未生成または宣言にないIDの場合はnullptr)
+     */
+    CWnd *GetControl(UINT nId) const;
+
+private:
+    /// @brief 宣言から子コントロールを1つ生成します。
+    std::unique_ptr<CWnd> CreateControl(const CHILD_CONTROL_DESC &desc, CWnd *pView) const;
+
+    const CHILD_CONTROL_DESC *m_pControls;       ///< 子コントロールの宣言の表
+    int m_nCount;                                ///< 表の要素数
+    EComposeTiming m_eTiming;                    ///< 生成する時期
+    CPaintMetrics::Site m_firstPaintSite;        ///< 初回描画までの時間の計測箇所
+    std::vector<std::unique_ptr<CWnd>> m_controls; ///< 生成した子コントロール (表と同じ順)
+    std::uint64_t m_nCreatedNs;                  ///< ビューの作成時刻
+    bool m_bComposed;                            ///< 子コントロールを生成済みか
+    bool m_bFirstPaintDone;                      ///< 初回描画を終えたか
+};
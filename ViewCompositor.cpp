@@ -0,0 +1,274 @@
+﻿/**
+ * @file ViewCompositor.cpp
+ * @brief 重なったビューをバックバッファに合成して表示するクラスの実装
+ */
+#include "pch.h"
+#include "ViewCompositor.h"
+#include "PaintMetrics.h"
+
+#include <algorithm>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+namespace
+{
+    /// @brief CRect を REGION_RECT に変換します。
+    REGION_RECT ToRegionRect(const CRect &rect)
+    {
+        return REGION_RECT{ rect.left, rect.top, rect.right, rect.bottom };
+    }
+}
+
+/**
+ * @brief コンストラクタ
+ */
+CViewCompositor::CViewCompositor() : m_pHost(nullptr), m_pOldBitmap(nullptr), m_sizeBack(0, 0)
+{
+}
+
+/**
+ * @brief デストラクタ
+ * @details バックバッファをメモリDCから外してから解放します。
+ */
+CViewCompositor::~CViewCompositor()
+{
+    if (m_pOldBitmap != nullptr)
+        m_dcBack.SelectObject(m_pOldBitmap);
+}
+
+/**
+ * @brief ビューをレイヤーとして登録します。
+ * @details 位置は UpdateGeometry() で読み直します。
+ */
+void CViewCompositor::AddView(CWnd *pView, DrawFunc draw, COLORREF colorBk, int nZOrder)
+{
+    if (pView == nullptr || Find(pView) != nullptr)
+        return;
+    VIEW_LAYER view;
+    view.pView = pView;
+    view.draw = std::move(draw);
+    view.colorBk = colorBk;
+    view.nLayer = m_compositor.AddLayer(REGION_RECT{ 0, 0, 0, 0 }, nZOrder);
+    m_views.push_back(std::move(view));
+    UpdateGeometry();
+}
+
+/**
+ * @brief ビューの登録を削除します。
+ */
+void CViewCompositor::RemoveView(CWnd *pView)
+{
+    const auto it = std::find_if(m_views.begin(), m_views.end(), [pView](const VIEW_LAYER &view) { return view.pView == pView; });
+    if (it == m_views.end())
+        return;
+    m_compositor.RemoveLayer(it->nLayer);
+    m_compositor.ClearDirty();
+    m_views.erase(it);
+    m_pending.Clear();
+}
+
+/**
+ * @brief ビューの位置・サイズ・表示状態を読み直し、各ビューの見える領域を更新します。
+ * @details ウィンドウの移動や表示で無効になる領域は Windows が WM_PAINT で通知するため、
+ * ここで無効になった領域は捨てます。配置が変わった場合は、合成済みで未転送の領域も捨てます
+ * (古い配置で合成した内容を転送しないため)。
+ */
+void CViewCompositor::UpdateGeometry()
+{
+    if (m_pHost == nullptr)
+        return;
+    bool bChanged = false;
+    for (const VIEW_LAYER &view : m_views)
+    {
+        const bool bVisible = ::IsWindow(view.pView->GetSafeHwnd()) && view.pView->IsWindowVisible();
+        REGION_RECT rect = { 0, 0, 0, 0 };
+        if (bVisible)
+        {
+            CRect rectWindow;
+            view.pView->GetWindowRect(&rectWindow);
+            m_pHost->ScreenToClient(&rectWindow);
+            rect = ToRegionRect(rectWindow);
+        }
+        const REGION_RECT old = m_compositor.GetLayerRect(view.nLayer);
+        if (old.left != rect.left || old.top != rect.top || old.right != rect.right || old.bottom != rect.bottom)
+        {
+            m_compositor.SetLayerRect(view.nLayer, rect);
+            bChanged = true;
+        }
+    }
+    m_compositor.ClearDirty();
+    if (bChanged)
+        m_pending.Clear();
+}
+
+/**
+ * @brief ビューの見える領域を、ビューのウィンドウ座標で返します。
+ */
+CRectRegion CViewCompositor::GetWindowRegion(CWnd *pView)
+{
+    const VIEW_LAYER *pLayer = Find(pView);
+    if (pLayer == nullptr)
+        return CRectRegion();
+    CRectRegion region = m_compositor.GetVisibleRegion(pLayer->nLayer);
+    const REGION_RECT rect = m_compositor.GetLayerRect(pLayer->nLayer);
+    region.Offset(-rect.left, -rect.top);
+    return region;
+}
+
+/**
+ * @brief ビューの WM_PAINT で、描画の必要な領域をバックバッファで合成して転送します。
+ * @details 描画の必要な領域のうち、ビューの見える部分だけを扱います。その全体が合成済み (他のビューの
+ * WM_PAINT で一緒に合成した) であれば転送だけを行い、そうでなければ新しいフレームを合成してから転送します。
+ */
+BOOL CViewCompositor::PaintView(CWnd *pView, CDC *pDC, const CRect &rcPaint)
+{
+    const VIEW_LAYER *pLayer = Find(pView);
+    if (pLayer == nullptr || m_pHost == nullptr)
+        return FALSE;
+
+    const CPoint ptOrigin = GetClientOrigin(pView);
+    CRect rectNeed = rcPaint;
+    rectNeed.OffsetRect(ptOrigin);
+    CRectRegion need(ToRegionRect(rectNeed));
+    need.Intersect(m_compositor.GetVisibleRegion(pLayer->nLayer));
+    if (need.IsEmpty())
+        return TRUE;
+
+    CRectRegion missing = need;
+    missing.Subtract(m_pending);
+    if (!missing.IsEmpty())
+    {
+        if (!EnsureBackBuffer(pDC))
+            return FALSE;
+        ComposeFrame(need);
+    }
+
+    // バックバッファから、見える部分だけを1回で転送する
+    need.GetRects(m_rects);
+    for (const REGION_RECT &rect : m_rects)
+    {
+        pDC->BitBlt(rect.left - ptOrigin.x, rect.top - ptOrigin.y, rect.right - rect.left, rect.bottom - rect.top, &m_dcBack,
+                    rect.left, rect.top, SRCCOPY);
+    }
+    m_pending.Subtract(need);
+    return TRUE;
+}
+
+/**
+ * @brief ビューの登録を探します。
+ */
+CViewCompositor::VIEW_LAYER *CViewCompositor::Find(CWnd *pView)
+{
+    for (VIEW_LAYER &view : m_views)
+    {
+        if (view.pView == pView)
+            return &view;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief ビューのクライアント領域の原点を、ホストウィンドウのクライアント座標で返します。
+ */
+CPoint CViewCompositor::GetClientOrigin(CWnd *pView) const
+{
+    CPoint pt(0, 0);
+    pView->ClientToScreen(&pt);
+    m_pHost->ScreenToClient(&pt);
+    return pt;
+}
+
+/**
+ * @brief ホストウィンドウのクライアント領域の大きさのバックバッファを用意します。
+ * @details バックバッファは大きくなる場合だけ作り直します (作り直すと合成済みの内容は失われます)。
+ */
+BOOL CViewCompositor::EnsureBackBuffer(CDC *pDC)
+{
+    CRect rectHost;
+    m_pHost->GetClientRect(&rectHost);
+    if (m_dcBack.GetSafeHdc() == nullptr && !m_dcBack.CreateCompatibleDC(pDC))
+        return FALSE;
+    if (m_bmpBack.GetSafeHandle() != nullptr && rectHost.Width() <= m_sizeBack.cx && rectHost.Height() <= m_sizeBack.cy)
+        return TRUE;
+
+    const CSize size((std::max)(rectHost.Width(), m_sizeBack.cx), (std::max)(rectHost.Height(), m_sizeBack.cy));
+    if (m_pOldBitmap != nullptr)
+    {
+        m_dcBack.SelectObject(m_pOldBitmap);
+        m_pOldBitmap = nullptr;
+    }
+    m_bmpBack.DeleteObject();
+    m_pending.Clear();
+    if (!m_bmpBack.CreateCompatibleBitmap(pDC, size.cx, size.cy))
+    {
+        m_sizeBack = CSize(0, 0);
+        return FALSE;
+    }
+    m_pOldBitmap = m_dcBack.SelectObject(&m_bmpBack);
+    m_sizeBack = size;
+    return TRUE;
+}
+
+/**
+ * @brief 領域と、他のビューの描画を待っている領域を1フレームで合成します。
+ * @details 他のビューの更新領域 (GetUpdateRect) も無効領域に加えることで、それらのビューの WM_PAINT では
+ * 合成をせずに転送だけで済ませます。合成した領域のうち転送していない部分は m_pending に残します。
+ */
+void CViewCompositor::ComposeFrame(const CRectRegion &need)
+{
+    CPaintMetricsScope metrics(CPaintMetrics::SITE_VIEW_COMPOSITE);
+
+    m_compositor.Invalidate(need);
+    for (const VIEW_LAYER &view : m_views)
+    {
+        CRect rectUpdate;
+        if (!::IsWindow(view.pView->GetSafeHwnd()) || !view.pView->GetUpdateRect(&rectUpdate, FALSE))
+            continue;
+        rectUpdate.OffsetRect(GetClientOrigin(view.pView));
+        CRectRegion update(ToRegionRect(rectUpdate));
+        update.Intersect(m_compositor.GetVisibleRegion(view.nLayer));
+        m_compositor.Invalidate(update);
+    }
+
+    m_pending.Union(m_compositor.GetDirtyRegion());
+    // 面積とオーバードロー率は CLayerCompositor の累計に集計されます
+    std::uint32_t nClipRegions = 0;
+    const COMPOSITOR_FRAME_STATS stats =
+        m_compositor.Compose([this, &nClipRegions](CLayerCompositor::LayerId nLayer, const CRectRegion &clip) {
+            if (PaintLayer(nLayer, clip))
+                ++nClipRegions;
+        });
+    metrics.AddItems(stats.nLayersPainted);
+    metrics.AddAllocations(nClipRegions);
+}
+
+/**
+ * @brief 1つのビューを、クリッピング領域の中だけバックバッファに描画します。
+ * @details 原点をビューのクライアント領域の左上に合わせるため、ビューの描画処理はクライアント座標のまま描画できます。
+ * @return クリッピング領域を生成して描画した場合は TRUE
+ */
+BOOL CViewCompositor::PaintLayer(CLayerCompositor::LayerId nLayer, const CRectRegion &clip)
+{
+    const auto it = std::find_if(m_views.begin(), m_views.end(), [nLayer](const VIEW_LAYER &view) { return view.nLayer == nLayer; });
+    if (it == m_views.end())
+        return FALSE;
+
+    HRGN hClip = clip.CreateHrgn();
+    if (hClip == nullptr)
+        return FALSE;
+    const int nSaved = m_dcBack.SaveDC();
+    ::SelectClipRgn(m_dcBack.GetSafeHdc(), hClip);
+    ::DeleteObject(hClip);
+    m_dcBack.SetViewportOrg(GetClientOrigin(it->pView));
+
+    CRect rectClient;
+    it->pView->GetClientRect(&rectClient);
+    m_dcBack.FillSolidRect(rectClient, it->colorBk);
+    if (it->draw)
+        it->draw(&m_dcBack);
+
+    m_dcBack.RestoreDC(nSaved);
+    return TRUE;
+}
@@ -0,0 +1,112 @@
+﻿/**
+ * @file ViewCompositor.h
+ * @brief メインダイアログ上で重なったビューを、1つのバックバッファに合成して表示するクラスの宣言
+ * @details ビューをレイヤーとして重なり順付きで登録し、CLayerCompositor で各ビューの見える領域を求めます。
+ * ビューの WM_PAINT では、無効になった領域の中で各ビューの見える部分だけを共有のバックバッファに描画し、
+ * 画面にはバックバッファから1回だけ転送します。重なった部分を2回描画することも、
+ * 背景の消去で一瞬別の色が見える (ちらつく) こともありません。
+ * 同時に描画を待っている他のビューの領域も同じフレームで合成するため、それらのビューの WM_PAINT は転送だけで済みます。
+ * フレームごとのオーバードロー率は CLayerCompositor が記録し、合成の時間は描画計測値 (SITE_VIEW_COMPOSITE) に記録します。
+ */
+#pragma once
+
+#include "LayerCompositor.h"
+
+#include <functional>
+#include <vector>
+
+/**
+ * @class CViewCompositor
+ * @brief ホストウィンドウの子ビューを重なり順に合成するクラス
+ * @details 座標はホストウィンドウのクライアント座標で扱います。ビューは WS_CLIPSIBLINGS 付きで作成し、
+ * WM_PAINT で PaintView() を、WM_ERASEBKGND では背景を消去せずにTRUEを返してください。
+ * 上にあるビューと重なる部分は、下のビューのウィンドウリージョン (GetWindowRegion()) から除きます。
+ */
+class CViewCompositor
+{
+public:
+    /**
+     * @brief ビューの内容を描画する関数
+     * @param[in] pDC 描画先 (ビューのクライアント座標で描画できるように原点とクリッピング領域を設定済み)
+     */
+    using DrawFunc = std::function<void(CDC *pDC)>;
+
+    CViewCompositor();
+    ~CViewCompositor();
+
+    CViewCompositor(const CViewCompositor &) = delete;
+    CViewCompositor &operator=(const CViewCompositor &) = delete;
+
+    /**
+     * @brief ホストウィンドウを設定します。
+     * @param[in] pHost ビューの親ウィンドウ
+     */
+    void Attach(CWnd *pHost) { m_pHost = pHost; }
+
+    /**
+     * @brief ビューをレイヤーとして登録します。
+     * @param[in] pView ビュー (ホストウィンドウの子ウィンドウ)
+     * @param[in] draw ビューの内容を描画する関数
+     * @param[in] colorBk 描画の前に塗りつぶす背景色
+     * @param[in] nZOrder 重なり順 (大きいほど上)
+     */
+    void AddView(CWnd *pView, DrawFunc draw, COLORREF colorBk, int nZOrder);
+
+    /// @brief ビューの登録を削除します。
+    void RemoveView(CWnd *pView);
+
+    /**
+     * @brief ビューの位置・サイズ・表示状態を読み直し、各ビューの見える領域を更新します。
+     * @details 配置が変わらなければ見える領域は計算し直しません。
+     */
+    void UpdateGeometry();
+
+    /**
+     * @brief ビューの見える領域を、ビューのウィンドウ座標で返します (SetWindowRgn 用)。
+     * @param[in] pView ビュー
+     */
+    CRectRegion GetWindowRegion(CWnd *pView);
+
+    /**
+     * @brief ビューの WM_PAINT で、描画の必要な領域をバックバッファで合成して転送します。
+     * @param[in] pView ビュー
+     * @param[in] pDC ビューの描画先 (CPaintDC)
+     * @param[in] rcPaint 描画の必要な領域 (ビューのクライアント座標)
+     * @return 合成した場合はTRUE (登録のないビューやバックバッファを用意できない場合はFALSE、呼び出し側で直接描画してください)
+     */
+    BOOL PaintView(CWnd *pView, CDC *pDC, const CRect &rcPaint);
+
+    /// @brief 直前のフレームの集計を返します。
+    const COMPOSITOR_FRAME_STATS &GetLastFrame() const { return m_compositor.GetLastFrame(); }
+
+private:
+    /// @brief 登録したビュー
+    struct VIEW_LAYER
+    {
+        CWnd *pView;                       ///< ビュー
+        DrawFunc draw;                     ///< 内容を描画する関数
+        COLORREF colorBk;                  ///< 背景色
+        CLayerCompositor::LayerId nLayer;  ///< レイヤー
+    };
+
+    /// @brief ビューの登録を探します (なければnullptr)。
+    VIEW_LAYER *Find(CWnd *pView);
+    /// @brief ビューのクライアント領域の原点を、ホストウィンドウのクライアント座標で返します。
+    CPoint GetClientOrigin(CWnd *pView) const;
+    /// @brief ホストウィンドウのクライアント領域の大きさのバックバッファを用意します。
+    BOOL EnsureBackBuffer(CDC *pDC);
+    /// @brief 領域と、他のビューの描画を待っている領域を1フレームで合成します。
+    void ComposeFrame(const CRectRegion &need);
+    /// @brief 1つのビューを、クリッピング領域の中だけバックバッファに描画します (描画した場合は TRUE)。
+    BOOL PaintLayer(CLayerCompositor::LayerId nLayer, const CRectRegion &clip);
+
+    CWnd *m_pHost;                    ///< ホストウィンドウ
+    std::vector<VIEW_LAYER> m_views;  ///< 登録したビュー
+    CLayerCompositor m_compositor;    ///< 見える領域と合成の順序
+    CDC m_dcBack;                     ///< バックバッファのメモリDC
+    CBitmap m_bmpBack;                ///< バックバッファ
+    CBitmap *m_pOldBitmap;            ///< メモリDCに元々選択されていたビットマップ
+    CSize m_sizeBack;                 ///< バックバッファの大きさ
+    CRectRegion m_pending;            ///< 合成済みで、まだ転送していない領域 (他のビューの WM_PAINT で転送します)
+    std::vector<REGION_RECT> m_rects; ///< 転送する矩形の作業領域
+};
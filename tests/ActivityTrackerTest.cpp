@@ -0,0 +1,160 @@
+﻿/**
+ * @file ActivityTrackerTest.cpp
+ * @brief CActivityTracker のテスト
+ * @details 差し替えた時計関数で時刻を決定的に進め、連続した入力でも状態遷移と起床要求が
+ * 1回ずつしか発生しないこと、保持時間の経過でちょうどアイドルへ戻ること、入力レートの推定値を確認します。
+ */
+#include "ActivityTracker.h"
+#include "TestFramework.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/// @brief テスト用の時計の現在時刻 (ミリ秒)
+std::atomic<std::uint64_t> g_nNowMs(1000);
+
+/// @brief テスト用の時計関数
+std::uint64_t FakeClock()
+{
+    return g_nNowMs.load();
+}
+
+/// @brief テスト用の時計を進めます。
+void Advance(std::uint64_t nMs)
+{
+    g_nNowMs += nMs;
+}
+}
+
+TEST_CASE(BurstOfInputsTransitionsOnce)
+{
+    CActivityTracker tracker(FakeClock);
+    CHECK(tracker.GetState() == CActivityTracker::STATE_IDLE);
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_NONE);
+
+    // アイドル中の最初の入力だけが起床を要求します
+    CHECK(tracker.NotifyInput());
+    int nWakes = 0;
+    for (int i = 0; i < 20; ++i)
+    {
+        Advance(50);
+        if (tracker.NotifyInput())
+            ++nWakes;
+    }
+    CHECK_EQ(nWakes, 0);
+    CHECK_EQ(tracker.GetInputCount(), 21u);
+
+    // 起床した Tick() で操作中へ遷移し、その後は保持時間が経過するまで遷移しません
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_TO_OPERATING);
+    int nTransitions = 0;
+    for (int i = 0; i < 11; ++i)
+    {
+        Advance(CActivityTracker::TICK_INTERVAL_MS);
+        if (tracker.Tick() != CActivityTracker::TRANSITION_NONE)
+            ++nTransitions;
+    }
+    CHECK_EQ(nTransitions, 0);
+    CHECK_EQ(tracker.GetIdleTime(), 2750u);
+    CHECK(!tracker.IsIdleFor(CActivityTracker::DEFAULT_HOLD_MS));
+
+    Advance(CActivityTracker::TICK_INTERVAL_MS);
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_TO_IDLE);
+    CHECK(tracker.GetState() == CActivityTracker::STATE_IDLE);
+    CHECK(tracker.IsIdleFor(CActivityTracker::DEFAULT_HOLD_MS));
+
+    // アイドルへ戻った後は、次の入力で再び起床を要求します
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_NONE);
+    CHECK(tracker.NotifyInput());
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_TO_OPERATING);
+}
+
+TEST_CASE(InputsDuringOperatingExtendHold)
+{
+    CActivityTracker tracker(FakeClock);
+    tracker.SetHoldTime(1000);
+    tracker.NotifyInput();
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_TO_OPERATING);
+
+    // 保持時間より短い間隔で入力が続く間は操作中のままです
+    for (int i = 0; i < 40; ++i)
+    {
+        Advance(CActivityTracker::TICK_INTERVAL_MS);
+        if (i % 3 == 0)
+            CHECK(!tracker.NotifyInput());
+        CHECK(tracker.Tick() == CActivityTracker::TRANSITION_NONE);
+    }
+    const std::uint64_t nLast = tracker.GetLastInputTime();
+    while (tracker.Tick() == CActivityTracker::TRANSITION_NONE)
+        Advance(1);
+    CHECK_EQ(FakeClock() - nLast, 1000u);
+}
+
+TEST_CASE(LateWakeAfterHoldStaysIdle)
+{
+    CActivityTracker tracker(FakeClock);
+    CHECK(tracker.NotifyInput());
+    Advance(5000); // 起床が保持時間より遅れた
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_NONE);
+    CHECK(tracker.GetState() == CActivityTracker::STATE_IDLE);
+
+    // 起床要求は下ろされているため、次の入力で再び起床します
+    CHECK(tracker.NotifyInput());
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_TO_OPERATING);
+}
+
+TEST_CASE(InputRateConvergesToSteadyRate)
+{
+    CActivityTracker tracker(FakeClock);
+    tracker.NotifyInput();
+    tracker.Tick();
+
+    // 250ms ごとの Tick() の間に5回と3回の入力を交互に、5秒間続けます
+    for (int tick = 0; tick < 20; ++tick)
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            Advance(50);
+            if (i % 2 == 0 || tick % 2 == 0)
+                tracker.NotifyInput();
+        }
+        tracker.Tick();
+    }
+    // 平均 (5 + 3) / 0.5秒 = 16回/秒
+    CHECK(tracker.GetInputRate() > 14.0 && tracker.GetInputRate() < 18.0);
+    CHECK(tracker.GetPeakInputRate() >= tracker.GetInputRate());
+
+    // 入力が止まると e^(-t/τ) で減衰します
+    Advance(3000);
+    tracker.Tick();
+    CHECK(tracker.GetInputRate() < 16.0 * 0.06);
+}
+
+TEST_CASE(OnlyOneConcurrentInputRequestsWake)
+{
+    CActivityTracker tracker(FakeClock);
+    std::atomic<int> nWakes(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&tracker, &nWakes]() {
+            for (int i = 0; i < 10000; ++i)
+            {
+                if (tracker.NotifyInput())
+                    ++nWakes;
+            }
+        });
+    }
+    for (std::thread &th : threads)
+        th.join();
+    CHECK_EQ(nWakes.load(), 1);
+    CHECK_EQ(tracker.GetInputCount(), 40000u);
+    CHECK(tracker.Tick() == CActivityTracker::TRANSITION_TO_OPERATING);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
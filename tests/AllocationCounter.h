@@ -0,0 +1,83 @@
+﻿/**
+ * @file AllocationCounter.h
+ * @brief ベンチマーク用のメモリ確保回数の計数
+ * @details グローバルの operator new / delete を置き換え、確保の回数とバイト数を数えます。
+ * 置き換えはプログラム全体に作用するため、1つの実行ファイルにつき1つのソースファイルだけでインクルードしてください。
+ * 計数は原子変数への加算だけで、確保そのものは malloc / free に任せます。
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace AllocationCounter
+{
+/// @brief 確保の回数
+inline std::atomic<std::uint64_t> g_nAllocations(0);
+/// @brief 確保したバイト数の合計
+inline std::atomic<std::uint64_t> g_nBytes(0);
+
+/**
+ * @struct SNAPSHOT
+ * @brief ある時点の計数
+ */
+struct SNAPSHOT
+{
+    std::uint64_t nAllocations; ///< 確保の回数
+    std::uint64_t nBytes;       ///< 確保したバイト数
+};
+
+/// @brief 現在の計数を返します。
+inline SNAPSHOT Now()
+{
+    return SNAPSHOT{g_nAllocations.load(std::memory_order_relaxed), g_nBytes.load(std::memory_order_relaxed)};
+}
+
+/// @brief 指定した時点からの確保の回数を返します。
+inline std::uint64_t AllocationsSince(const SNAPSHOT &start)
+{
+    return g_nAllocations.load(std::memory_order_relaxed) - start.nAllocations;
+}
+
+/// @brief 指定した時点からの確保したバイト数を返します。
+inline std::uint64_t BytesSince(const SNAPSHOT &start)
+{
+    return g_nBytes.load(std::memory_order_relaxed) - start.nBytes;
+}
+}
+
+void *operator new(std::size_t nSize)
+{
+    AllocationCounter::g_nAllocations.fetch_add(1, std::memory_order_relaxed);
+    AllocationCounter::g_nBytes.fetch_add(nSize, std::memory_order_relaxed);
+    if (void *p = std::malloc(nSize != 0 ? nSize : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t nSize)
+{
+    return ::operator new(nSize);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
@@ -0,0 +1,137 @@
+﻿/**
+ * @file CommandRegistryBench.cpp
+ * @brief CCommandRegistry のベンチマーク
+ * @details UIスレッドへの投稿を CUiDispatcher で受け、計測スレッドをUIスレッドとして Drain() します。
+ * 1件ずつ実行したときの Execute() → 本体開始、Execute() → 終了通知 (OnCommandFinished) の遅延の p50 / p99 と、
+ * 16行 × 13機能の表を一斉に実行したときの処理件数、表の参照 (IsDefined) の時間を計測します。
+ *
+ *   CommandRegistryBench          全規模で計測
+ *   CommandRegistryBench --quick  ctest 用 (実行回数を減らします)
+ */
+#include "CommandRegistry.h"
+#include "UiDispatcher.h"
+#include "TestFramework.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile long g_nSink = 0;
+
+/**
+ * @class CCountingListener
+ * @brief 終了通知の数と時刻を記録するリスナー
+ */
+class CCountingListener : public CCommandListener
+{
+public:
+    void OnCommandProgress(int, int, int) override { ++nProgress; }
+    void OnCommandFinished(int, int, int) override
+    {
+        ++nFinished;
+        nLastFinishNs = TestFramework::NowNs();
+    }
+
+    long nProgress = 0;              ///< 進捗通知の数
+    long nFinished = 0;              ///< 終了通知の数
+    std::int64_t nLastFinishNs = 0;  ///< 最後の終了通知の時刻
+};
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nRoundTrips = bQuick ? 2000 : 50000;
+    const int nBatches = bQuick ? 50 : 1000;
+    const int nRows = 16;
+    const int nFunctions = 13;
+
+    CTaskScheduler scheduler;
+    if (!scheduler.Start())
+        return 1;
+    CUiDispatcher dispatcher;
+    scheduler.SetUiExecutor([&dispatcher](CTaskScheduler::Task task) {
+        dispatcher.Post(std::move(task));
+        return true;
+    });
+
+    CCommandRegistry registry(scheduler, nRows, nFunctions);
+    CCountingListener listener;
+    registry.AddListener(&listener);
+    std::atomic<std::int64_t> nBodyStartNs(0);
+    for (int k = 1; k <= nFunctions; ++k)
+    {
+        registry.RegisterFunction(k, [&nBodyStartNs](CCommandContext &c) {
+            nBodyStartNs.store(TestFramework::NowNs(), std::memory_order_relaxed);
+            for (int i = 0; i <= 100; ++i)
+                c.ReportProgress(i);
+            return true;
+        });
+    }
+
+    // UIスレッドとして、指定数の終了通知が届くまで投稿を処理します
+    auto pumpUntil = [&](long nFinished) {
+        while (listener.nFinished < nFinished)
+        {
+            if (!dispatcher.Drain())
+                std::this_thread::yield();
+        }
+    };
+
+    // 1件ずつの往復遅延
+    std::vector<double> startLatencies;
+    std::vector<double> finishLatencies;
+    startLatencies.reserve(nRoundTrips);
+    finishLatencies.reserve(nRoundTrips);
+    for (int i = 0; i < nRoundTrips; ++i)
+    {
+        const std::int64_t t0 = TestFramework::NowNs();
+        registry.Execute(1 + i % nRows, 1 + i % nFunctions);
+        pumpUntil(listener.nFinished + 1);
+        startLatencies.push_back(static_cast<double>(nBodyStartNs.load(std::memory_order_relaxed) - t0));
+        finishLatencies.push_back(static_cast<double>(listener.nLastFinishNs - t0));
+    }
+    const long nProgressSingle = listener.nProgress;
+
+    // 表全体の一斉実行
+    const std::int64_t nBatchStart = TestFramework::NowNs();
+    for (int b = 0; b < nBatches; ++b)
+    {
+        const long nTarget = listener.nFinished + nRows * nFunctions;
+        for (int n = 1; n <= nRows; ++n)
+        {
+            for (int k = 1; k <= nFunctions; ++k)
+                registry.Execute(n, k);
+        }
+        pumpUntil(nTarget);
+    }
+    const double dBatchNs = static_cast<double>(TestFramework::NowNs() - nBatchStart);
+    const double dCommands = static_cast<double>(nBatches) * nRows * nFunctions;
+
+    // 表の参照
+    const double dLookupNs = TestFramework::MeasureNsPerOp(1000000, 3, [&]() {
+        static int s_nCell = 0;
+        s_nCell = (s_nCell + 7) % (nRows * nFunctions);
+        g_nSink = g_nSink + (registry.IsDefined(1 + s_nCell / nFunctions, 1 + s_nCell % nFunctions) ? 1 : 0);
+    });
+
+    std::printf("workers=%d table=%dx%d\n", scheduler.GetWorkerCount(), nRows, nFunctions);
+    std::printf("Execute -> body start: p50=%.1f us  p99=%.1f us\n", TestFramework::Percentile(startLatencies, 50.0) / 1000.0,
+                TestFramework::Percentile(startLatencies, 99.0) / 1000.0);
+    std::printf("Execute -> OnCommandFinished: p50=%.1f us  p99=%.1f us\n",
+                TestFramework::Percentile(finishLatencies, 50.0) / 1000.0,
+                TestFramework::Percentile(finishLatencies, 99.0) / 1000.0);
+    std::printf("progress notifications: %.2f per command (101 reports each)\n",
+                static_cast<double>(nProgressSingle) / nRoundTrips);
+    std::printf("full table batches: %.0f commands/s  (%.2f us/command)\n", dCommands * 1e9 / dBatchNs,
+                dBatchNs / dCommands / 1000.0);
+    std::printf("IsDefined lookup: %.1f ns\n", dLookupNs);
+
+    scheduler.Shutdown();
+    // 進捗は投稿済みの間まとめられるため、報告回数 (101回/件) より十分少なくなります
+    return (nProgressSingle < 10L * nRoundTrips && registry.GetBusyCount() == 0) ? 0 : 1;
+}
@@ -0,0 +1,382 @@
+﻿/**
+ * @file CommandRegistryTest.cpp
+ * @brief CCommandRegistry のテスト
+ * @details UIスレッドへの投稿を手動で実行するキューに差し替え、UIスレッドが処理する前の状態を固定して検証します。
+ * 行 × 機能の密な表を通した呼び出し、終了処理 (Finish) が完了・失敗・取り消しのいずれでもちょうど1回であること、
+ * 本体が細かく報告した進捗が未通知の間は1回の投稿にまとめられること (m_bProgressPosted)、
+ * UIスレッドへ投稿できなかった終了が FinishUnposted() で処理され、機能が実行中のまま残らないことを確認します。
+ */
+#include "CommandRegistry.h"
+#include "TestFramework.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/**
+ * @class CManualUi
+ * @brief UIスレッドへの投稿を溜めておき、テストから実行するUI実行関数
+ */
+class CManualUi
+{
+public:
+    /// @brief スケジューラに UI 実行関数として設定します。
+    void Attach(CTaskScheduler &scheduler)
+    {
+        scheduler.SetUiExecutor([this](CTaskScheduler::Task task) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+            ++m_nPosts;
+            return true;
+        });
+    }
+    /// @brief 溜まっている投稿を全て実行し、実行した数を返します。
+    int Pump()
+    {
+        int nRan = 0;
+        for (;;)
+        {
+            std::vector<CTaskScheduler::Task> tasks;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                tasks.swap(m_tasks);
+            }
+            if (tasks.empty())
+                return nRan;
+            for (CTaskScheduler::Task &task : tasks)
+                task();
+            nRan += static_cast<int>(tasks.size());
+        }
+    }
+    /// @brief 溜まっている投稿を新しいものから順に実行します (UIスレッドでの処理順の入れ替わりを再現します)。
+    int PumpReversed()
+    {
+        std::vector<CTaskScheduler::Task> tasks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            tasks.swap(m_tasks);
+        }
+        for (auto it = tasks.rbegin(); it != tasks.rend(); ++it)
+            (*it)();
+        return static_cast<int>(tasks.size());
+    }
+    /// @brief 投稿が指定数に達するまで待ちます。
+    bool WaitForPosts(int nPosts)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_nPosts >= nPosts)
+                    return true;
+            }
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    /// @brief これまでの投稿数を返します。
+    int GetPostCount()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_nPosts;
+    }
+
+private:
+    std::mutex m_mutex;                       ///< 以下の保護
+    std::vector<CTaskScheduler::Task> m_tasks; ///< 実行待ちの投稿
+    int m_nPosts = 0;                         ///< これまでの投稿数
+};
+
+/**
+ * @class CRecordingListener
+ * @brief 通知を記録するリスナー
+ */
+class CRecordingListener : public CCommandListener
+{
+public:
+    /// @brief 終了通知1件
+    struct FINISH
+    {
+        int nRow;
+        int nFunction;
+        int nStatus;
+    };
+
+    void OnCommandProgress(int, int, int nPercent) override { progress.push_back(nPercent); }
+    void OnCommandFinished(int nRow, int nFunction, int nStatus) override { finished.push_back({nRow, nFunction, nStatus}); }
+
+    std::vector<int> progress;     ///< 通知された進捗
+    std::vector<FINISH> finished;  ///< 通知された終了
+};
+}
+
+TEST_CASE(DenseTableDispatchesEveryCell)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(2));
+    CManualUi ui;
+    ui.Attach(scheduler);
+    const int nRows = 16;
+    const int nFunctions = 13;
+    CCommandRegistry registry(scheduler, nRows, nFunctions);
+    CRecordingListener listener;
+    registry.AddListener(&listener);
+
+    // 機能ごとに共通の本体を登録し、特定のセルだけ上書きします
+    // 本体はワーカーで実行されるため、検査結果は原子変数に記録して UI 側で確認します
+    std::vector<std::atomic<int>> hits(nRows * nFunctions);
+    std::atomic<int> nMismatch(0);
+    for (int k = 1; k <= nFunctions; ++k)
+    {
+        registry.RegisterFunction(k, [&hits, &nMismatch, k, nFunctions](CCommandContext &c) {
+            if (c.GetFunction() != k)
+                ++nMismatch;
+            hits[(c.GetRow() - 1) * nFunctions + (k - 1)].fetch_add(1);
+            return true;
+        });
+    }
+    std::atomic<int> nOverride(0);
+    registry.Register(5, 4, [&nOverride](CCommandContext &) {
+        ++nOverride;
+        return false;
+    });
+    CHECK(!registry.Register(0, 1, [](CCommandContext &) { return true; }));
+    CHECK(!registry.Register(1, nFunctions + 1, [](CCommandContext &) { return true; }));
+    CHECK(!registry.Execute(nRows + 1, 1));
+    CHECK(!registry.IsDefined(1, 0));
+
+    for (int n = 1; n <= nRows; ++n)
+    {
+        for (int k = 1; k <= nFunctions; ++k)
+            CHECK(registry.Execute(n, k));
+    }
+    CHECK_EQ(registry.GetBusyCount(), nRows * nFunctions);
+    CHECK(ui.WaitForPosts(nRows * nFunctions));
+    ui.Pump();
+    CHECK_EQ(registry.GetBusyCount(), 0);
+    CHECK_EQ(static_cast<int>(listener.finished.size()), nRows * nFunctions);
+
+    int nWrong = 0;
+    for (int i = 0; i < nRows * nFunctions; ++i)
+    {
+        const int nExpected = (i == (5 - 1) * nFunctions + (4 - 1)) ? 0 : 1;
+        if (hits[i].load() != nExpected)
+            ++nWrong;
+    }
+    CHECK_EQ(nWrong, 0);
+    CHECK_EQ(nMismatch.load(), 0);
+    CHECK_EQ(nOverride.load(), 1);
+    int nFailed = 0;
+    for (const CRecordingListener::FINISH &f : listener.finished)
+    {
+        if (f.nStatus == CCommandRegistry::STATUS_FAILED)
+        {
+            ++nFailed;
+            CHECK_EQ(f.nRow, 5);
+            CHECK_EQ(f.nFunction, 4);
+        }
+    }
+    CHECK_EQ(nFailed, 1);
+    scheduler.Shutdown();
+}
+
+TEST_CASE(FinishRunsOnceForEveryOutcome)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(1));
+    CManualUi ui;
+    ui.Attach(scheduler);
+    CCommandRegistry registry(scheduler, 4, 4);
+    CRecordingListener listener;
+    registry.AddListener(&listener);
+
+    std::atomic<bool> bRelease(false);
+    std::atomic<bool> bBlocking(false);
+    std::atomic<bool> bStarted(false);
+    registry.Register(1, 1, [](CCommandContext &) { return true; });
+    registry.Register(1, 2, [](CCommandContext &) -> bool { throw 1; });
+    registry.Register(1, 3, [&](CCommandContext &c) {
+        bStarted = true;
+        while (!c.IsCancelled())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return true;
+    });
+    std::atomic<bool> bBodyRan(false);
+    registry.Register(1, 4, [&](CCommandContext &) {
+        bBodyRan = true;
+        return true;
+    });
+    registry.Register(2, 1, [&](CCommandContext &) {
+        bBlocking = true;
+        while (!bRelease.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return true;
+    });
+
+    // 完了と例外
+    CHECK(registry.Execute(1, 1));
+    CHECK(!registry.Execute(1, 1)); // 実行中は重ねて起動できません
+    CHECK(ui.WaitForPosts(1));
+    CHECK(registry.Execute(1, 2));
+    CHECK(ui.WaitForPosts(2));
+    ui.Pump();
+    REQUIRE(listener.finished.size() == 2);
+    CHECK_EQ(listener.finished[0].nStatus, static_cast<int>(CCommandRegistry::STATUS_COMPLETED));
+    CHECK_EQ(listener.finished[1].nStatus, static_cast<int>(CCommandRegistry::STATUS_FAILED));
+
+    // 実行中の取り消し: 本体が取り消しを確認して戻ると、戻り値によらず取り消しになります
+    CHECK(registry.Execute(1, 3));
+    while (!bStarted.load())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(registry.Cancel(1, 3));
+    CHECK(ui.WaitForPosts(3));
+    ui.Pump();
+    REQUIRE(listener.finished.size() == 3);
+    CHECK_EQ(listener.finished[2].nStatus, static_cast<int>(CCommandRegistry::STATUS_CANCELLED));
+
+    // 開始前の取り消し: ワーカーを塞いでおき、待ち行列にある間に取り消すと本体は呼ばれません
+    CHECK(registry.Execute(2, 1));
+    while (!bBlocking.load())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(registry.Execute(1, 4));
+    registry.CancelAll();
+    bRelease = true;
+    CHECK(ui.WaitForPosts(5));
+    ui.Pump();
+    REQUIRE(listener.finished.size() == 5);
+    CHECK(!bBodyRan.load());
+    for (std::size_t i = 3; i < 5; ++i)
+        CHECK_EQ(listener.finished[i].nStatus, static_cast<int>(CCommandRegistry::STATUS_CANCELLED));
+
+    // 終了済みの機能の取り消しは何もしません。追加の終了通知も発生しません
+    CHECK(!registry.Cancel(1, 4));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK_EQ(ui.Pump(), 0);
+    CHECK_EQ(listener.finished.size(), 5u);
+    CHECK_EQ(registry.GetBusyCount(), 0);
+    scheduler.Shutdown();
+}
+
+TEST_CASE(ProgressIsCoalescedUntilDelivered)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(1));
+    CManualUi ui;
+    ui.Attach(scheduler);
+    CCommandRegistry registry(scheduler, 1, 1);
+    CRecordingListener listener;
+    registry.AddListener(&listener);
+
+    std::atomic<int> nPhase(0);
+    registry.Register(1, 1, [&](CCommandContext &c) {
+        // UIスレッドが処理しない間に10万回報告しても、投稿は1回だけです
+        for (int i = 0; i <= 100000; ++i)
+            c.ReportProgress(i / 2000);
+        nPhase = 1;
+        while (nPhase.load() != 2)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // 通知後は再び1回投稿されます (範囲外の値は0～100に丸められます)
+        c.ReportProgress(150);
+        c.ReportProgress(120);
+        return true;
+    });
+    CHECK(registry.Execute(1, 1));
+    while (nPhase.load() != 1)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK_EQ(ui.GetPostCount(), 1);
+    ui.Pump();
+    CHECK(listener.progress == std::vector<int>({50}));
+
+    nPhase = 2;
+    CHECK(ui.WaitForPosts(3)); // 進捗1回 + 終了
+    ui.Pump();
+    CHECK(listener.progress == std::vector<int>({50, 100}));
+    CHECK_EQ(listener.finished.size(), 1u);
+    scheduler.Shutdown();
+}
+
+TEST_CASE(ProgressAfterFinishIsDropped)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(1));
+    CManualUi ui;
+    ui.Attach(scheduler);
+    CCommandRegistry registry(scheduler, 1, 1);
+    CRecordingListener listener;
+    registry.AddListener(&listener);
+    registry.Register(1, 1, [](CCommandContext &c) {
+        c.ReportProgress(10);
+        return true;
+    });
+    CHECK(registry.Execute(1, 1));
+    CHECK(ui.WaitForPosts(2));
+    // 進捗の投稿より先に終了を処理させると、終了後に届いた進捗は捨てられます
+    CHECK_EQ(ui.PumpReversed(), 2);
+    CHECK_EQ(listener.finished.size(), 1u);
+    CHECK(listener.progress.empty());
+
+    // 登録解除したリスナーには通知しません
+    registry.RemoveListener(&listener);
+    CHECK(registry.Execute(1, 1));
+    CHECK(ui.WaitForPosts(4));
+    ui.Pump();
+    CHECK_EQ(listener.finished.size(), 1u);
+    scheduler.Shutdown();
+}
+
+TEST_CASE(UnpostedFinishIsNotLost)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(1));
+    CCommandRegistry registry(scheduler, 1, 2);
+    CRecordingListener listener;
+    registry.AddListener(&listener);
+    std::atomic<int> nRuns(0);
+    registry.RegisterFunction(1, [&](CCommandContext &) {
+        ++nRuns;
+        return true;
+    });
+    registry.RegisterFunction(2, [&](CCommandContext &) {
+        ++nRuns;
+        return true;
+    });
+
+    // UI実行関数を設定していない (画面の破棄後に解除された) 状態では、終了は登録表に預けられます
+    CHECK(registry.Execute(1, 1));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    int nFinished = 0;
+    while (nFinished == 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        nFinished = registry.FinishUnposted();
+    }
+    CHECK_EQ(nFinished, 1);
+    CHECK(!registry.IsBusy(1, 1));
+    CHECK_EQ(registry.GetBusyCount(), 0);
+    REQUIRE(listener.finished.size() == 1);
+    CHECK_EQ(listener.finished[0].nStatus, static_cast<int>(CCommandRegistry::STATUS_COMPLETED));
+
+    // 投稿を拒否するUI実行関数でも同じです。預けられた終了は次の Execute() の開始前にも処理されます
+    scheduler.SetUiExecutor([](CTaskScheduler::Task) { return false; });
+    CHECK(registry.Execute(1, 1));
+    while (nRuns.load() < 2)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    scheduler.Shutdown();
+    CHECK(registry.IsBusy(1, 1));
+    CHECK(!registry.Execute(1, 2)); // スケジューラ停止中のため開始はしませんが、預けられた終了は処理します
+    CHECK(!registry.IsBusy(1, 1));
+    CHECK_EQ(registry.GetBusyCount(), 0);
+    CHECK_EQ(listener.finished.size(), 2u);
+    CHECK_EQ(registry.FinishUnposted(), 0);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
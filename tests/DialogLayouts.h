@@ -0,0 +1,90 @@
+﻿/**
+ * @file DialogLayouts.h
+ * @brief グリッド配列ダイアログのレイアウト表と、実行時にレイアウトを計算する従来の方式
+ * @details 仕様はダイアログと同じ DialogLayoutSpecs.h のものを使い、ここではテスト用にレイアウト表を生成します。
+ * ComputeLegacyLayout() は、レイアウト表を導入する前の OnInitDialog() と同じ計算 (グリッドごとの位置の積み上げと
+ * キャプションの書式化) を実行時に行います。BuildTables() との比較と、所要時間の比較に使用します。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "DialogLayoutSpecs.h"
+
+#include <cwchar>
+#include <string>
+#include <vector>
+
+namespace DialogLayouts
+{
+    using DialogLayoutSpecs::DIALOG1_SPEC;
+    using DialogLayoutSpecs::DIALOG2_SPEC;
+
+    /// @brief CMyDialog のレイアウト表
+    constexpr auto DIALOG1_LAYOUT = GridLayout::BuildTables(DIALOG1_SPEC);
+    /// @brief CMyDialog2 のレイアウト表
+    constexpr auto DIALOG2_LAYOUT = GridLayout::BuildTables(DIALOG2_SPEC);
+
+    /**
+     * @struct LEGACY_LAYOUT
+     * @brief 実行時に計算したレイアウト (従来の OnInitDialog() が CGridCtrl に設定していた内容)
+     */
+    struct LEGACY_LAYOUT
+    {
+        std::vector<GridLayout::GridPlacement> grids; ///< グリッドごとの配置とID
+        std::vector<bool> editable;                   ///< セルごとの編集可否 (行優先)
+        std::vector<std::wstring> captions;           ///< セルごとのキャプション (行優先)
+        int nTotalWidth = 0;                          ///< 合計の幅
+        int nTotalHeight = 0;                         ///< 合計の高さ
+    };
+
+    /**
+     * @brief 従来の OnInitDialog() と同じ手順でレイアウトを計算します。
+     * @details グリッドごとに列幅を合計してサイズを求め、位置を積み上げ、全セルのキャプションを書式化します。
+     */
+    template <int AR, int AC, int CR, int CC>
+    void ComputeLegacyLayout(const GridLayout::DialogSpec<AR, AC, CR, CC> &spec, LEGACY_LAYOUT &layout)
+    {
+        layout.grids.clear();
+        layout.editable.clear();
+        layout.captions.clear();
+
+        int currentY = spec.nMargin;
+        int rightmostX = 0;
+        for (int row = 0; row < AR; ++row)
+        {
+            int currentX = spec.nMargin;
+            int gridHeight = 0;
+            for (int col = 0; col < AC; ++col)
+            {
+                const int index = row * AC + col;
+
+                // グリッドごとにセルの編集可否とキャプションを設定
+                for (int r = 0; r < CR; ++r)
+                {
+                    for (int c = 0; c < CC; ++c)
+                    {
+                        layout.editable.push_back(((spec.editableMask[r] >> c) & 1u) != 0);
+                        wchar_t szText[GridLayout::MAX_CAPTION_LENGTH];
+                        std::swprintf(szText, GridLayout::MAX_CAPTION_LENGTH, L"%ls (%d, %d)", spec.pszCaptionPrefix, r + 1, c + 1);
+                        layout.captions.emplace_back(szText);
+                    }
+                }
+
+                // GetRequiredWidth / GetRequiredHeight と同じ計算
+                int gridWidth = 0;
+                for (int c = 0; c < CC; ++c)
+                    gridWidth += spec.colWidths[c];
+                gridHeight = ((CR < spec.nMaxVisibleRows) ? CR : spec.nMaxVisibleRows) * spec.nRowHeight;
+
+                layout.grids.push_back({currentX, currentY, currentX + gridWidth, currentY + gridHeight,
+                                        spec.nFirstID + static_cast<unsigned int>(index)});
+                currentX += gridWidth + spec.nMargin;
+                if (currentX > rightmostX)
+                    rightmostX = currentX;
+            }
+            currentY += gridHeight + spec.nMargin;
+        }
+        layout.nTotalWidth = rightmostX;
+        layout.nTotalHeight = currentY;
+    }
+}
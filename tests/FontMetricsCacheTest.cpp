@@ -0,0 +1,181 @@
+﻿/**
+ * @file FontMetricsCacheTest.cpp
+ * @brief CFontMetricsCache / CCenteredTextLayout のテスト
+ * @details 呼び出し回数を数える偽のバックエンドを設定し、寸法を (フォントハンドル, DPI) の組ごとに1回だけ測ること、
+ * Invalidate() で測り直すこと、CCenteredTextLayout::Update() が入力の変わらない呼び出しでは寸法を参照せず
+ * 書式矩形の設定も求めないことを確認します。
+ */
+#include "FontMetricsCache.h"
+#include "TestFramework.h"
+
+#include <cstdint>
+#include <map>
+#include <utility>
+
+namespace
+{
+/// @brief (フォントハンドル, DPI) の組ごとの測定回数
+std::map<std::pair<std::uintptr_t, unsigned>, int> g_measures;
+/// @brief 測定の合計回数
+int g_nMeasureCount = 0;
+
+/**
+ * @brief 測定回数を数える偽のバックエンド
+ * @details 高さはフォントハンドルごとに決め (1と3は13、2は20、それ以外は16)、DPIに比例させます。
+ * フォントハンドル 99 は測れないフォントとして扱います。
+ */
+bool CountingMeasure(std::uintptr_t hFont, unsigned nDpi, FONT_METRICS &metrics)
+{
+    ++g_measures[std::make_pair(hFont, nDpi)];
+    ++g_nMeasureCount;
+    if (hFont == 99)
+        return false;
+    const int nBase = (hFont == 1 || hFont == 3) ? 13 : (hFont == 2) ? 20 : 16;
+    const int nHeight = nBase * static_cast<int>(nDpi != 0 ? nDpi : 96) / 96;
+    metrics = FONT_METRICS{nHeight, nHeight * 4 / 5, nHeight - nHeight * 4 / 5, 0, nHeight / 2};
+    return true;
+}
+
+/// @brief 偽のバックエンドを設定し、回数を0に戻します。
+void ResetBackend()
+{
+    CFontMetricsCache::SetBackend(&CountingMeasure);
+    CFontMetricsCache::ResetStats();
+    g_measures.clear();
+    g_nMeasureCount = 0;
+}
+}
+
+TEST_CASE(MeasuresOncePerFontAndDpi)
+{
+    ResetBackend();
+    FONT_METRICS metrics = {};
+    for (int nRound = 0; nRound < 100; ++nRound)
+    {
+        for (std::uintptr_t hFont = 0; hFont < 4; ++hFont)
+        {
+            for (unsigned nDpi : {96u, 120u, 144u})
+            {
+                REQUIRE(CFontMetricsCache::Get(hFont, nDpi, metrics));
+                CHECK_EQ(metrics.nHeight, ((hFont == 1 || hFont == 3) ? 13 : (hFont == 2) ? 20 : 16) * static_cast<int>(nDpi) / 96);
+            }
+        }
+    }
+    CHECK_EQ(g_nMeasureCount, 12);
+    int nMeasuredTwice = 0;
+    for (const auto &item : g_measures)
+    {
+        if (item.second != 1)
+            ++nMeasuredTwice;
+    }
+    CHECK_EQ(nMeasuredTwice, 0);
+    const CFontMetricsCache::Stats stats = CFontMetricsCache::GetStats();
+    CHECK_EQ(stats.nLookups, 1200u);
+    CHECK_EQ(stats.nMeasures, 12u);
+
+    // 測れなかった組は登録せず、次の参照で測り直します
+    CHECK(!CFontMetricsCache::Get(99, 96, metrics));
+    CHECK(!CFontMetricsCache::Get(99, 96, metrics));
+    CHECK_EQ((g_measures[std::make_pair(std::uintptr_t(99), 96u)]), 2);
+
+    // バックエンドがなければ登録済みの組だけを返します
+    CFontMetricsCache::Clear();
+    CFontMetricsCache::SetBackend(nullptr);
+    CHECK(!CFontMetricsCache::Get(1, 96, metrics));
+}
+
+TEST_CASE(InvalidateRemeasuresOnlyThatFont)
+{
+    ResetBackend();
+    FONT_METRICS metrics = {};
+    CFontMetricsCache::Get(1, 96, metrics);
+    CFontMetricsCache::Get(1, 144, metrics);
+    CFontMetricsCache::Get(2, 96, metrics);
+    CHECK_EQ(g_nMeasureCount, 3);
+
+    // フォントハンドル 1 の登録は全てのDPIについて削除し、2 は残します
+    CFontMetricsCache::Invalidate(1);
+    CFontMetricsCache::Get(2, 96, metrics);
+    CHECK_EQ(g_nMeasureCount, 3);
+    CFontMetricsCache::Get(1, 96, metrics);
+    CFontMetricsCache::Get(1, 144, metrics);
+    CHECK_EQ(g_nMeasureCount, 5);
+    CHECK_EQ(metrics.nHeight, 19);
+
+    // Clear() と SetBackend() は全ての登録を削除します
+    CFontMetricsCache::Clear();
+    CFontMetricsCache::Get(2, 96, metrics);
+    CHECK_EQ(g_nMeasureCount, 6);
+    CFontMetricsCache::SetBackend(&CountingMeasure);
+    CFontMetricsCache::Get(2, 96, metrics);
+    CHECK_EQ(g_nMeasureCount, 7);
+}
+
+TEST_CASE(LayoutSkipsMeasureWhenInputIsUnchanged)
+{
+    ResetBackend();
+    CCenteredTextLayout layout;
+    CCenteredTextLayout::FORMAT_RECT rect = {};
+
+    // 最初の呼び出しは測って書式矩形を求め、設定を求めます
+    REQUIRE(layout.Update(150, 150, 1, 96, rect));
+    CHECK_EQ(rect.left, 0);
+    CHECK_EQ(rect.top, (150 - 13) / 2);
+    CHECK_EQ(rect.right, 150);
+    CHECK_EQ(rect.bottom, 150);
+    CHECK_EQ(g_nMeasureCount, 1);
+
+    // 入力が同じであれば、寸法の参照も設定もしません (キー入力ごとの呼び出しに相当)
+    const CFontMetricsCache::Stats before = CFontMetricsCache::GetStats();
+    int nApplied = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (layout.Update(150, 150, 1, 96, rect))
+            ++nApplied;
+    }
+    const CFontMetricsCache::Stats after = CFontMetricsCache::GetStats();
+    CHECK_EQ(nApplied, 0);
+    CHECK_EQ(after.nLookups, before.nLookups);
+    CHECK_EQ(after.nMeasures, before.nMeasures);
+    CHECK_EQ(after.nLayoutChecks - before.nLayoutChecks, 1000u);
+    CHECK_EQ(after.nLayoutApplies, before.nLayoutApplies);
+
+    // コントロールが書式矩形を戻した場合は、測らずに同じ矩形の設定を求めます
+    layout.Invalidate();
+    CHECK(layout.Update(150, 150, 1, 96, rect));
+    CHECK(!layout.Update(150, 150, 1, 96, rect));
+    CHECK_EQ(g_nMeasureCount, 1);
+
+    // 同じフォントの別のコントロールはキャッシュを共有します
+    CCenteredTextLayout other;
+    CHECK(other.Update(80, 40, 1, 96, rect));
+    CHECK_EQ(rect.top, (40 - 13) / 2);
+    CHECK_EQ(g_nMeasureCount, 1);
+
+    // 大きさの変更は測らずに求め直し、フォントとDPIの変更は新しい組だけを1回測ります
+    CHECK(layout.Update(160, 150, 1, 96, rect));
+    CHECK_EQ(rect.right, 160);
+    CHECK_EQ(g_nMeasureCount, 1);
+    CHECK(layout.Update(160, 150, 2, 96, rect));
+    CHECK_EQ(rect.top, (150 - 20) / 2);
+    CHECK(layout.Update(160, 150, 2, 144, rect));
+    CHECK_EQ(rect.top, (150 - 30) / 2);
+    CHECK_EQ(g_nMeasureCount, 3);
+    CHECK(layout.Update(160, 150, 1, 96, rect));
+    CHECK_EQ(g_nMeasureCount, 3);
+
+    // 入力が変わっても求めた矩形が同じであれば、設定は求めません (同じ高さの別のフォント)
+    CHECK(!layout.Update(160, 150, 3, 96, rect));
+    CHECK_EQ(g_nMeasureCount, 4);
+
+    // 寸法を測れない場合は設定を求めず、次の呼び出しで測り直します
+    CHECK(!layout.Update(160, 150, 99, 96, rect));
+    CHECK(!layout.Update(160, 150, 99, 96, rect));
+    CHECK_EQ(g_nMeasureCount, 6);
+    CHECK(CFontMetricsCache::FormatStats().find("measures=6") != std::string::npos);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
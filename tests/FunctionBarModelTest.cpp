@@ -0,0 +1,250 @@
+﻿/**
+ * @file FunctionBarModelTest.cpp
+ * @brief CFunctionBarModel のテスト
+ * @details 出力先 (CFunctionBarSink) への指示を記録し、行選択・ページ切り替え・実行状態の変化ごとに
+ * 実際に変わった項目だけが指示されることを、指示の種類とボタン番号まで含めて確認します。
+ * CMyDialog3 と同じ 16行 × 13機能、1ページ8ボタン (2ページ) の構成を使用します。
+ */
+#include "FunctionBarModel.h"
+#include "TestFramework.h"
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/// @brief CMyDialog3 と同じ構成
+const int ROWS = 16;
+const int FUNCTIONS = 13;
+const int BUTTONS = 8;
+
+/**
+ * @class CRecordingSink
+ * @brief 指示を記録する出力先
+ */
+class CRecordingSink : public CFunctionBarSink
+{
+public:
+    /// @brief 指示1件
+    struct OP
+    {
+        char chKind;        ///< 'L' ラベル / 'E' 有効・無効 / 'V' 表示・非表示
+        int nButton;        ///< ボタン番号
+        std::wstring value; ///< ラベル、または "1" / "0"
+    };
+
+    void SetLabel(int nButton, const wchar_t *pszLabel) override { ops.push_back({'L', nButton, pszLabel}); }
+    void SetEnabled(int nButton, bool bEnabled) override { ops.push_back({'E', nButton, bEnabled ? L"1" : L"0"}); }
+    void SetVisible(int nButton, bool bVisible) override { ops.push_back({'V', nButton, bVisible ? L"1" : L"0"}); }
+
+    /// @brief 指定種類の指示の数を返します。
+    int Count(char chKind) const
+    {
+        int n = 0;
+        for (const OP &op : ops)
+        {
+            if (op.chKind == chKind)
+                ++n;
+        }
+        return n;
+    }
+    /// @brief 指定種類の指示を受けたボタン番号の集合を返します。
+    std::set<int> Buttons(char chKind) const
+    {
+        std::set<int> buttons;
+        for (const OP &op : ops)
+        {
+            if (op.chKind == chKind)
+                buttons.insert(op.nButton);
+        }
+        return buttons;
+    }
+    /// @brief 指定ボタンへの最後のラベル指示を返します。
+    std::wstring LastLabel(int nButton) const
+    {
+        for (auto it = ops.rbegin(); it != ops.rend(); ++it)
+        {
+            if (it->chKind == 'L' && it->nButton == nButton)
+                return it->value;
+        }
+        return L"?";
+    }
+
+    std::vector<OP> ops; ///< 記録した指示
+};
+
+/// @brief [nFirst, nLast] のボタン番号の集合を返します。
+std::set<int> Range(int nFirst, int nLast)
+{
+    std::set<int> buttons;
+    for (int i = nFirst; i <= nLast; ++i)
+        buttons.insert(i);
+    return buttons;
+}
+}
+
+TEST_CASE(ThirteenFunctionsMakeTwoPages)
+{
+    CFunctionBarModel model(ROWS, FUNCTIONS, BUTTONS);
+    CHECK_EQ(model.GetPageCount(), 2);
+    CHECK_EQ(model.GetNextPageButton(), BUTTONS);
+    model.Select(3, 1, true);
+    CHECK_EQ(model.GetButtonFunction(0), 9);
+    CHECK_EQ(model.GetButtonFunction(4), 13);
+    CHECK_EQ(model.GetButtonFunction(5), 0);
+    CHECK_EQ(model.GetNextPage(), 0);
+    model.Select(3, 2, true); // 範囲外のページは0
+    CHECK_EQ(model.GetPage(), 0);
+    CHECK_EQ(model.GetNextPage(), 1);
+    // 1ページしかない構成では次ページボタンは常に無効
+    CFunctionBarModel single(4, 8, 8);
+    single.Select(1, 0, true);
+    CRecordingSink sink;
+    single.Apply(sink);
+    CHECK_EQ(sink.LastLabel(8), std::wstring());
+}
+
+TEST_CASE(FirstApplySendsEverythingThenOnlyDiffs)
+{
+    CFunctionBarModel model(ROWS, FUNCTIONS, BUTTONS);
+    CRecordingSink sink;
+    model.Select(1, 0, true);
+    CHECK_EQ(model.Apply(sink), 3 * (BUTTONS + 1));
+    CHECK_EQ(sink.LastLabel(0), std::wstring(L"F(1-1)"));
+    CHECK_EQ(sink.LastLabel(BUTTONS), std::wstring(L">>"));
+
+    // 何も変わらなければ何も指示しません
+    sink.ops.clear();
+    model.Select(1, 0, true);
+    CHECK_EQ(model.Apply(sink), 0);
+
+    // Invalidate() の後は再び全て指示します
+    model.Invalidate();
+    CHECK_EQ(model.Apply(sink), 3 * (BUTTONS + 1));
+}
+
+TEST_CASE(RowChangeSendsOnlyLabels)
+{
+    CFunctionBarModel model(ROWS, FUNCTIONS, BUTTONS);
+    CRecordingSink sink;
+    model.Select(1, 0, true);
+    model.Apply(sink);
+
+    // 上下キーで全行を2往復しても、1回の移動あたりラベル8件だけです (以前は27件)
+    sink.ops.clear();
+    int nMoves = 0;
+    for (int i = 1; i <= 2 * ROWS; ++i)
+    {
+        model.Select(i % ROWS + 1, 0, true);
+        model.Apply(sink);
+        ++nMoves;
+    }
+    CHECK_EQ(sink.Count('L'), BUTTONS * nMoves);
+    CHECK_EQ(sink.Count('E'), 0);
+    CHECK_EQ(sink.Count('V'), 0);
+    CHECK(sink.Buttons('L') == Range(0, BUTTONS - 1));
+
+    // 2ページ目では機能のあるボタン (機能9～13) のラベルだけが変わります
+    model.Select(4, 1, true);
+    model.Apply(sink);
+    sink.ops.clear();
+    model.Select(5, 1, true);
+    CHECK_EQ(model.Apply(sink), 5);
+    CHECK(sink.Buttons('L') == Range(0, 4));
+    CHECK_EQ(sink.LastLabel(4), std::wstring(L"F(5-13)"));
+}
+
+TEST_CASE(PageFlipSendsLabelsAndEmptyButtonsOnly)
+{
+    CFunctionBarModel model(ROWS, FUNCTIONS, BUTTONS);
+    CRecordingSink sink;
+    model.Select(2, 0, true);
+    model.Apply(sink);
+
+    // 1ページ目 → 2ページ目: ラベル8件 + 空欄になるボタン5～7の無効化3件
+    sink.ops.clear();
+    model.Select(2, model.GetNextPage(), true);
+    CHECK_EQ(model.Apply(sink), BUTTONS + 3);
+    CHECK(sink.Buttons('L') == Range(0, BUTTONS - 1));
+    CHECK(sink.Buttons('E') == Range(5, 7));
+    CHECK_EQ(sink.Count('V'), 0);
+    CHECK_EQ(sink.LastLabel(0), std::wstring(L"F(2-9)"));
+    CHECK_EQ(sink.LastLabel(5), std::wstring());
+
+    // 2ページ目 → 1ページ目: 逆向きの同じ差分
+    sink.ops.clear();
+    model.Select(2, model.GetNextPage(), true);
+    CHECK_EQ(model.Apply(sink), BUTTONS + 3);
+    CHECK(sink.Buttons('E') == Range(5, 7));
+    CHECK_EQ(sink.LastLabel(7), std::wstring(L"F(2-8)"));
+
+    // 次ページボタンだけを無効にする
+    sink.ops.clear();
+    model.Select(2, 0, false);
+    CHECK_EQ(model.Apply(sink), 2);
+    CHECK(sink.Buttons('L') == std::set<int>({BUTTONS}));
+    CHECK(sink.Buttons('E') == std::set<int>({BUTTONS}));
+
+    // 選択解除: 機能のあるボタン0～4と次ページボタンが空欄・無効になります (ボタン5～7は既に空欄・無効)
+    model.Select(2, 1, true);
+    model.Apply(sink);
+    sink.ops.clear();
+    model.Select(0, 1, true);
+    CHECK_EQ(model.Apply(sink), 5 * 2 + 2);
+}
+
+TEST_CASE(BusyAndProgressChangeOnlyThatButton)
+{
+    CFunctionBarModel model(ROWS, FUNCTIONS, BUTTONS);
+    std::set<std::pair<int, int>> busy;
+    model.SetBusyFunc([&busy](int n, int k) { return busy.count({n, k}) > 0; });
+    CRecordingSink sink;
+    model.Select(3, 1, true);
+    model.Apply(sink);
+
+    // F(3-10) (2ページ目のボタン1) が実行中になると、そのボタンの無効化だけ
+    busy.insert({3, 10});
+    sink.ops.clear();
+    CHECK_EQ(model.Apply(sink), 1);
+    CHECK(sink.Buttons('E') == std::set<int>({1}));
+
+    // 進捗はラベルだけ。同じ値なら指示しません
+    model.SetProgress(3, 10, 40);
+    sink.ops.clear();
+    CHECK_EQ(model.Apply(sink), 1);
+    CHECK_EQ(sink.LastLabel(1), std::wstring(L"40%"));
+    model.SetProgress(3, 10, 40);
+    CHECK_EQ(model.Apply(sink), 0);
+    model.SetProgress(3, 10, 250); // 100 に丸められます
+    CHECK_EQ(model.Apply(sink), 1);
+    CHECK_EQ(sink.LastLabel(1), std::wstring(L"100%"));
+
+    // 別の行・ページの実行状態は表示中のボタンに影響しません
+    busy.insert({4, 10});
+    model.SetProgress(4, 10, 10);
+    busy.insert({3, 2});
+    sink.ops.clear();
+    CHECK_EQ(model.Apply(sink), 0);
+
+    // 終了: ラベルを戻して有効化
+    busy.erase({3, 10});
+    model.SetProgress(3, 10, -1);
+    sink.ops.clear();
+    CHECK_EQ(model.Apply(sink), 2);
+    CHECK_EQ(sink.LastLabel(1), std::wstring(L"F(3-10)"));
+    CHECK(sink.Buttons('E') == std::set<int>({1}));
+
+    // 1ページ目に戻ると F(3-2) は無効で表示されます
+    sink.ops.clear();
+    model.Select(3, 0, true);
+    model.Apply(sink);
+    CHECK_EQ(sink.LastLabel(1), std::wstring(L"F(3-2)"));
+    CHECK(sink.Buttons('E') == std::set<int>({1, 5, 6, 7}));
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
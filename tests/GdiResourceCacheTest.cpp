@@ -0,0 +1,254 @@
+﻿/**
+ * @file GdiResourceCacheTest.cpp
+ * @brief CGdiResourceCache / CGdiFrameScope のテスト
+ * @details 生成と破棄を記録する偽のバックエンドを SetBackend() で設定し、参照・生成の回数、
+ * Get() したハンドルがフレーム (CGdiFrameScope の範囲) の間は破棄されないこと、
+ * Acquire() したハンドルは上限を超えても破棄されないこと、一番外側のフレームの終わりに
+ * 最後に使われたフレームの古い順に上限まで破棄することを確認します。
+ */
+#include "GdiResourceCache.h"
+#include "TestFramework.h"
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace
+{
+/// @brief 生存しているハンドル
+std::set<std::uintptr_t> g_live;
+/// @brief 破棄したハンドル (破棄した順)
+std::vector<std::uintptr_t> g_destroyed;
+/// @brief 生存していないハンドルを破棄した回数
+int g_nBadDestroys = 0;
+/// @brief 次に生成するハンドル
+std::uintptr_t g_hNext = 0x1000;
+
+/// @brief 連番のハンドルを返す偽の生成関数 (色 0xDEAD は生成に失敗します)
+std::uintptr_t FakeCreate(const GDI_RESOURCE_KEY &key)
+{
+    if (key.eKind != GDI_RESOURCE_FONT && key.color == 0xDEADu)
+        return 0;
+    const std::uintptr_t hObject = g_hNext++;
+    g_live.insert(hObject);
+    return hObject;
+}
+
+/// @brief 破棄を記録する偽の破棄関数
+void FakeDestroy(std::uintptr_t hObject)
+{
+    if (g_live.erase(hObject) == 0)
+        ++g_nBadDestroys;
+    g_destroyed.push_back(hObject);
+}
+
+/// @brief 偽のバックエンドを設定し、登録と記録と回数を空にします。
+void ResetCache(std::size_t nCapacity)
+{
+    CGdiResourceCache::SetBackend(&FakeCreate, &FakeDestroy);
+    CGdiResourceCache::SetCapacity(nCapacity);
+    CGdiResourceCache::ResetStats();
+    g_live.clear();
+    g_destroyed.clear();
+    g_nBadDestroys = 0;
+}
+
+/// @brief 番号ごとに異なる色のブラシの記述子を返します。
+GDI_RESOURCE_KEY Brush(int n)
+{
+    return GDI_RESOURCE_KEY::SolidBrush(static_cast<std::uint32_t>(0x10000 + n));
+}
+
+/// @brief ハンドルが生存しているかを返します。
+bool IsLive(std::uintptr_t hObject)
+{
+    return g_live.count(hObject) != 0;
+}
+}
+
+TEST_CASE(HitsAndCreates)
+{
+    ResetCache(CGdiResourceCache::DEFAULT_CAPACITY);
+    GDI_FONT_DESC font = {};
+    font.nHeight = -12;
+    font.nWeight = 400;
+    font.szFaceName[0] = L'A';
+    GDI_FONT_DESC dirty = font;
+    dirty.szFaceName[5] = L'x'; // 終端以降のごみは無視します
+    {
+        CGdiFrameScope frame;
+        for (int i = 0; i < 100; ++i)
+        {
+            const std::uintptr_t hBrush = CGdiResourceCache::Get(Brush(i % 5));
+            const std::uintptr_t hPen = CGdiResourceCache::Get(GDI_RESOURCE_KEY::Pen(0, 1, 0x10000u));
+            const std::uintptr_t hFont = CGdiResourceCache::Get(GDI_RESOURCE_KEY::Font(i % 2 == 0 ? font : dirty));
+            CHECK(hBrush != 0 && hPen != 0 && hFont != 0);
+        }
+        // 同じ色でも種類が違えば別の登録です
+        CHECK(CGdiResourceCache::Get(Brush(0)) != CGdiResourceCache::Get(GDI_RESOURCE_KEY::Pen(0, 1, 0x10000u)));
+        CHECK(CGdiResourceCache::Get(Brush(0)) == CGdiResourceCache::Get(Brush(0)));
+        // 生成できなかった場合は0を返し、登録しません
+        CHECK_EQ(CGdiResourceCache::Get(GDI_RESOURCE_KEY::SolidBrush(0xDEADu)), 0u);
+    }
+    const CGdiResourceCache::Stats stats = CGdiResourceCache::GetStats();
+    CHECK_EQ(stats.nLookups, 305u);
+    CHECK_EQ(stats.nCreates, 7u);
+    CHECK_EQ(stats.nHits, 297u);
+    CHECK_EQ(stats.nLive, 7u);
+    CHECK_EQ(stats.nDestroys, 0u);
+    CHECK_EQ(stats.nFrames, 1u);
+    CHECK_EQ(g_live.size(), 7u);
+
+    // SetBackend() は全ての登録を設定前のバックエンドで破棄します
+    CGdiResourceCache::SetBackend(&FakeCreate, &FakeDestroy);
+    CHECK(g_live.empty());
+    CHECK_EQ(g_nBadDestroys, 0);
+}
+
+TEST_CASE(GetHandlesStayAliveWithinFrame)
+{
+    ResetCache(4);
+    std::vector<std::uintptr_t> handles;
+    {
+        CGdiFrameScope outer;
+        {
+            // 入れ子のフレームの終わりでは破棄しません
+            CGdiFrameScope inner;
+            for (int i = 0; i < 20; ++i)
+                handles.push_back(CGdiResourceCache::Get(Brush(i)));
+        }
+        int nDead = 0;
+        for (std::uintptr_t hObject : handles)
+        {
+            if (!IsLive(hObject))
+                ++nDead;
+        }
+        CHECK_EQ(nDead, 0);
+        for (int i = 20; i < 30; ++i)
+            handles.push_back(CGdiResourceCache::Get(Brush(i)));
+    }
+    // 使ったフレームの終わりでは、上限を超えていても破棄しません
+    CHECK_EQ(g_live.size(), 30u);
+    CHECK(g_destroyed.empty());
+
+    // フレームの外で Get() したハンドルは、次のフレームの終わりまで有効です
+    const std::uintptr_t hOutside = CGdiResourceCache::Get(Brush(100));
+    {
+        CGdiFrameScope frame;
+        CHECK(IsLive(hOutside));
+    }
+    CHECK(IsLive(hOutside));
+    CHECK_EQ(g_live.size(), 4u);
+    {
+        CGdiFrameScope frame;
+    }
+    CHECK_EQ(g_live.size(), 4u);
+    CHECK_EQ(CGdiResourceCache::GetStats().nEvictions, 27u);
+    CHECK_EQ(g_nBadDestroys, 0);
+}
+
+TEST_CASE(AcquiredEntriesAreNeverEvicted)
+{
+    ResetCache(2);
+    std::vector<std::uintptr_t> held;
+    for (int i = 0; i < 6; ++i)
+        held.push_back(CGdiResourceCache::Acquire(Brush(i)));
+    // 同じ記述子を2回保持した場合は、2回手放すまで保持されます
+    CHECK_EQ(CGdiResourceCache::Acquire(Brush(0)), held[0]);
+
+    for (int nFrame = 0; nFrame < 50; ++nFrame)
+    {
+        CGdiFrameScope frame;
+        for (int i = 0; i < 5; ++i)
+            CGdiResourceCache::Get(Brush(1000 + nFrame * 5 + i));
+    }
+    int nDead = 0;
+    for (std::uintptr_t hObject : held)
+    {
+        if (!IsLive(hObject))
+            ++nDead;
+    }
+    CHECK_EQ(nDead, 0);
+
+    // 手放した登録は再利用され、使われなくなると破棄の対象になります
+    for (std::uintptr_t hObject : held)
+        CGdiResourceCache::Release(hObject);
+    CHECK_EQ(CGdiResourceCache::Get(Brush(1)), held[1]);
+    CGdiResourceCache::Release(0);
+    CGdiResourceCache::Release(0x7777);
+    for (int nFrame = 0; nFrame < 3; ++nFrame)
+    {
+        CGdiFrameScope frame;
+    }
+    CHECK_EQ(g_live.size(), 2u);
+    CHECK(IsLive(held[0]));
+
+    // 最後の保持を手放すと、手放したフレームの次のフレームの終わりから破棄の対象になります
+    CGdiResourceCache::Release(held[0]);
+    CGdiResourceCache::SetCapacity(0);
+    {
+        CGdiFrameScope frame;
+    }
+    CHECK(IsLive(held[0]));
+    {
+        CGdiFrameScope frame;
+    }
+    CHECK(!IsLive(held[0]));
+    CHECK(g_live.empty());
+    CHECK_EQ(g_nBadDestroys, 0);
+}
+
+TEST_CASE(LruEvictionDownToCapacityAtEndFrame)
+{
+    ResetCache(8);
+    std::vector<std::uintptr_t> handles;
+    int nOverCapacity = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        {
+            // フレーム i でブラシ i を使います (ブラシ 0 は毎フレーム使います)
+            CGdiFrameScope frame;
+            handles.push_back(CGdiResourceCache::Get(Brush(i)));
+            CGdiResourceCache::Get(Brush(0));
+        }
+        if (g_live.size() > 8u)
+            ++nOverCapacity;
+    }
+    CHECK_EQ(nOverCapacity, 0);
+    // 毎フレーム使ったブラシ 0 と、最近使った 7 個が残ります
+    CHECK_EQ(g_live.size(), 8u);
+    CHECK(IsLive(handles[0]));
+    int nWrong = 0;
+    for (int i = 1; i < 16; ++i)
+    {
+        if (IsLive(handles[i]) != (i >= 9))
+            ++nWrong;
+    }
+    CHECK_EQ(nWrong, 0);
+    // 破棄は古い順です
+    std::vector<std::uintptr_t> expected(handles.begin() + 1, handles.begin() + 9);
+    CHECK(g_destroyed == expected);
+
+    // 上限を下げると、次のフレームの終わりに使われていない登録を古い順に破棄します
+    CGdiResourceCache::SetCapacity(3);
+    {
+        CGdiFrameScope frame;
+        CGdiResourceCache::Get(Brush(10));
+    }
+    CHECK_EQ(g_live.size(), 3u);
+    CHECK(IsLive(handles[0]));
+    CHECK(IsLive(handles[10]));
+    CHECK(IsLive(handles[15]));
+    CHECK(!IsLive(handles[14]));
+
+    const CGdiResourceCache::Stats stats = CGdiResourceCache::GetStats();
+    CHECK_EQ(stats.nEvictions, 13u);
+    CHECK_EQ(stats.nDestroys, 13u);
+    CHECK_EQ(stats.nPeakLive, 9u);
+    CHECK_EQ(g_nBadDestroys, 0);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
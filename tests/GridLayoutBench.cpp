@@ -0,0 +1,72 @@
+﻿/**
+ * @file GridLayoutBench.cpp
+ * @brief グリッド配列ダイアログのレイアウト計算のベンチマーク
+ * @details CMyDialog (10グリッド) と CMyDialog2 (10グリッド) のレイアウトについて、
+ * 従来の実行時の計算 (変更前) と、コンパイル時に生成した表の参照 (変更後) の所要時間を比較します。
+ * 表の参照は OnInitDialog() が行う処理 (位置・ID・キャプション・編集可否の読み出し) と同じです。
+ * ウィンドウの生成はWindowsでしか計測できないため含みません。
+ *
+ *   GridLayoutBench          全規模で計測
+ *   GridLayoutBench --quick  ctest 用 (反復回数を減らします)
+ */
+#include "DialogLayouts.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+
+using namespace DialogLayouts;
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::uint64_t g_nSink = 0;
+
+/**
+ * @brief 表を OnInitDialog() と同じ順序で読み出します (変更後)。
+ */
+template <int AR, int AC, int CR, int CC>
+std::uint64_t ReadTables(const GridLayout::DialogTables<AR, AC, CR, CC> &tables)
+{
+    std::uint64_t nSum = 0;
+    for (int index = 0; index < AR * AC; ++index)
+    {
+        const GridLayout::GridPlacement &place = tables.grids[index];
+        for (int cell = 0; cell < CR * CC; ++cell)
+            nSum += (tables.editable[cell] ? 1u : 0u) + static_cast<std::uint64_t>(tables.captions[cell].szText[0]);
+        nSum += static_cast<std::uint64_t>(place.left + place.top + place.right + place.bottom) + place.nID;
+    }
+    return nSum + static_cast<std::uint64_t>(tables.nTotalWidth + tables.nTotalHeight);
+}
+
+/**
+ * @brief 1つのダイアログについて変更前と変更後を計測し、結果を表示します。
+ */
+template <int AR, int AC, int CR, int CC>
+void RunDialog(const char *pszName, const GridLayout::DialogSpec<AR, AC, CR, CC> &spec,
+               const GridLayout::DialogTables<AR, AC, CR, CC> &tables, int nIterations, int nRepeats)
+{
+    LEGACY_LAYOUT legacy;
+    const double dBefore = TestFramework::MeasureNsPerOp(nIterations, nRepeats, [&]() {
+        ComputeLegacyLayout(spec, legacy);
+        g_nSink = g_nSink + legacy.grids.back().bottom;
+    });
+    // 表の内容がコンパイル時に畳み込まれないよう、毎回ポインタ経由で読み出します
+    const GridLayout::DialogTables<AR, AC, CR, CC> *volatile pTables = &tables;
+    const double dAfter = TestFramework::MeasureNsPerOp(nIterations, nRepeats, [&]() {
+        g_nSink = g_nSink + ReadTables(*pTables);
+    });
+    std::printf("%-11s grids=%-3d cells/grid=%-3d before(runtime)=%9.1f ns  after(table)=%7.1f ns  x%.1f\n",
+                pszName, AR * AC, CR * CC, dBefore, dAfter, dAfter > 0.0 ? dBefore / dAfter : 0.0);
+}
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nIterations = bQuick ? 200 : 20000;
+    const int nRepeats = bQuick ? 3 : 7;
+
+    RunDialog("CMyDialog", DIALOG1_SPEC, DIALOG1_LAYOUT, nIterations, nRepeats);
+    RunDialog("CMyDialog2", DIALOG2_SPEC, DIALOG2_LAYOUT, nIterations, nRepeats);
+    return 0;
+}
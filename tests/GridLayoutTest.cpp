@@ -0,0 +1,90 @@
+﻿/**
+ * @file GridLayoutTest.cpp
+ * @brief GridLayout::BuildTables() のテスト
+ * @details ダイアログが宣言するレイアウト仕様について、コンパイル時の検証と、
+ * 生成した表が従来の実行時の計算 (ComputeLegacyLayout) と一致することを確認します。
+ */
+#include "DialogLayouts.h"
+#include "TestFramework.h"
+
+using namespace DialogLayouts;
+
+static_assert(GridLayout::HasValidMetrics(DIALOG1_SPEC), "CMyDialog: 行高・列幅・間隔が不正です");
+static_assert(GridLayout::IsEditableMaskInRange(DIALOG1_SPEC), "CMyDialog: 編集可否マスクが範囲外です");
+static_assert(GridLayout::AreCaptionsInRange(DIALOG1_SPEC), "CMyDialog: キャプションが長すぎます");
+static_assert(GridLayout::IsIdRangeValid(DIALOG1_SPEC, 0xE900, 0xE9FF), "CMyDialog: コントロールIDが範囲外です");
+static_assert(GridLayout::HasNoOverlap(DIALOG1_LAYOUT), "CMyDialog: グリッド同士が重なっています");
+static_assert(GridLayout::IsWithinContent(DIALOG1_LAYOUT), "CMyDialog: グリッドがコンテンツ領域の範囲外です");
+
+static_assert(GridLayout::HasValidMetrics(DIALOG2_SPEC), "CMyDialog2: 行高・列幅・間隔が不正です");
+static_assert(GridLayout::IsEditableMaskInRange(DIALOG2_SPEC), "CMyDialog2: 編集可否マスクが範囲外です");
+static_assert(GridLayout::AreCaptionsInRange(DIALOG2_SPEC), "CMyDialog2: キャプションが長すぎます");
+static_assert(GridLayout::IsIdRangeValid(DIALOG2_SPEC, 0xE900, 0xE9FF), "CMyDialog2: コントロールIDが範囲外です");
+static_assert(GridLayout::HasNoOverlap(DIALOG2_LAYOUT), "CMyDialog2: グリッド同士が重なっています");
+static_assert(GridLayout::IsWithinContent(DIALOG2_LAYOUT), "CMyDialog2: グリッドがコンテンツ領域の範囲外です");
+
+// 先頭と末尾のグリッドの位置はコンパイル時に確定しています
+static_assert(DIALOG1_LAYOUT.grids[9].top == 10 + 9 * (132 + 10), "CMyDialog: 末尾のグリッドの位置が不正です");
+static_assert(DIALOG2_LAYOUT.grids[9].left == 10 + 340 + 10, "CMyDialog2: 末尾のグリッドの位置が不正です");
+
+namespace
+{
+/**
+ * @brief 生成した表と従来の計算結果が一致するかを検証します。
+ */
+template <int AR, int AC, int CR, int CC>
+void CheckMatchesLegacy(const GridLayout::DialogSpec<AR, AC, CR, CC> &spec, const GridLayout::DialogTables<AR, AC, CR, CC> &tables)
+{
+    LEGACY_LAYOUT legacy;
+    ComputeLegacyLayout(spec, legacy);
+
+    REQUIRE(legacy.grids.size() == static_cast<size_t>(AR * AC));
+    for (int i = 0; i < AR * AC; ++i)
+    {
+        CHECK_EQ(tables.grids[i].left, legacy.grids[i].left);
+        CHECK_EQ(tables.grids[i].top, legacy.grids[i].top);
+        CHECK_EQ(tables.grids[i].right, legacy.grids[i].right);
+        CHECK_EQ(tables.grids[i].bottom, legacy.grids[i].bottom);
+        CHECK_EQ(tables.grids[i].nID, legacy.grids[i].nID);
+    }
+    CHECK_EQ(tables.nTotalWidth, legacy.nTotalWidth);
+    CHECK_EQ(tables.nTotalHeight, legacy.nTotalHeight);
+
+    // 従来はグリッドごとに同じ内容を設定していたため、全グリッド分を表の1グリッド分と比較します
+    REQUIRE(legacy.captions.size() == static_cast<size_t>(AR * AC * CR * CC));
+    for (size_t i = 0; i < legacy.captions.size(); ++i)
+    {
+        const size_t cell = i % (CR * CC);
+        CHECK(legacy.captions[i] == tables.captions[cell].szText);
+        CHECK_EQ(static_cast<bool>(legacy.editable[i]), tables.editable[cell]);
+    }
+}
+}
+
+TEST_CASE(Dialog1TablesMatchLegacyLayout)
+{
+    CheckMatchesLegacy(DIALOG1_SPEC, DIALOG1_LAYOUT);
+}
+
+TEST_CASE(Dialog2TablesMatchLegacyLayout)
+{
+    CheckMatchesLegacy(DIALOG2_SPEC, DIALOG2_LAYOUT);
+}
+
+TEST_CASE(CaptionsAndEditableMask)
+{
+    CHECK(std::wstring(DIALOG1_LAYOUT.captions[0].szText) == L"Cell (1, 1)");
+    CHECK(std::wstring(DIALOG1_LAYOUT.captions[11].szText) == L"Cell (6, 2)");
+    CHECK(!DIALOG1_LAYOUT.editable[0]);
+    CHECK(!DIALOG1_LAYOUT.editable[1]);
+    CHECK(DIALOG1_LAYOUT.editable[3]);   // (2, 2)
+    CHECK(!DIALOG1_LAYOUT.editable[9]);  // (5, 2)
+    CHECK(DIALOG1_LAYOUT.editable[11]);  // (6, 2)
+    for (bool bEditable : DIALOG2_LAYOUT.editable)
+        CHECK(!bEditable);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
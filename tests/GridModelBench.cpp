@@ -0,0 +1,221 @@
+﻿/**
+ * @file GridModelBench.cpp
+ * @brief CGridModel の操作ごとの時間とメモリ確保回数のベンチマーク、および基準値との比較
+ * @details 6×2 から 1000000×50 までのグリッドを、編集可能なセルが密な場合 (列0以外の全て) と
+ * 疎な場合 (約97セルに1つ) について作り、各操作の1回あたりの時間 (ns/op) と確保回数を計測します。
+ * --compare で基準値のファイルと比べ、確保回数が基準値と1回でも異なる操作を退行として報告し、終了コードを1にします。
+ * 時間は計測する環境と同時に動く処理で大きく変わるため、--threshold を指定した場合 (専用の計測環境向け) だけ比べます。
+ * 基準値は GCC (libstdc++) で記録しています。文字列の短文字列最適化の大きさが異なる環境では --save で記録し直してください。
+ *
+ *   GridModelBench                                       全規模で計測
+ *   GridModelBench --quick                               ctest 用 (1000000 行を除きます)
+ *   GridModelBench --save golden/grid_model_baseline.txt 基準値を記録 (全規模で実行してください)
+ *   GridModelBench --compare <file>                      基準値と確保回数を比較 (ctest はこれを --quick で実行します)
+ *   GridModelBench --compare <file> --threshold <pct>    時間も比較 (閾値は基準値からの増加率、基準値と同じ環境で実行してください)
+ */
+#include "AllocationCounter.h"
+#include "GridModel.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::int64_t g_nSink = 0;
+
+/// @brief 時間の比較で、閾値に加える絶対的な余裕 (ナノ秒、数ナノ秒の操作の揺れを吸収します)
+const double SLACK_NS = 10.0;
+/// @brief 時間の計測の繰り返し回数 (最良の回を使います)
+const int REPEATS = 3;
+
+/// @brief 1つの操作の計測結果
+struct METRIC
+{
+    double dNsPerOp;            ///< 1回あたりの時間
+    std::uint64_t nAllocations; ///< 全ての繰り返しでの確保回数
+    std::uint64_t nOperations;  ///< 全ての繰り返しでの操作の回数
+};
+
+/// @brief 操作の名前 (<行>x<列>/<dense|sparse>/<操作>) ごとの計測結果
+std::map<std::string, METRIC> g_metrics;
+
+/**
+ * @brief 操作を nIterations 回ずつ REPEATS 回実行し、時間と確保回数を記録します。
+ * @details 確保回数は繰り返し回数に依存しないよう、--quick でも同じ回数を実行します。
+ */
+template <class Fn>
+void Measure(const std::string &name, int nIterations, Fn &&fn)
+{
+    int i = 0;
+    const AllocationCounter::SNAPSHOT start = AllocationCounter::Now();
+    const double dNs = TestFramework::MeasureNsPerOp(nIterations, REPEATS, [&]() { fn(i++); });
+    const METRIC metric = {dNs, AllocationCounter::AllocationsSince(start), static_cast<std::uint64_t>(nIterations) * REPEATS};
+    g_metrics[name] = metric;
+    std::printf("%-40s %14.1f ns/op %10.4f allocs/op\n", name.c_str(), metric.dNsPerOp,
+                static_cast<double>(metric.nAllocations) / static_cast<double>(metric.nOperations));
+}
+
+/**
+ * @brief 1つの大きさのグリッドを作り、各操作を計測します。
+ * @param[in] bDense 列0以外の全てのセルを編集可能にするか (false なら約97セルに1つ、最終行を除きます)
+ */
+void RunSize(int nRows, int nCols, bool bDense)
+{
+    char szTag[64];
+    std::snprintf(szTag, sizeof(szTag), "%dx%d/%s/", nRows, nCols, bDense ? "dense" : "sparse");
+    const std::string tag = szTag;
+    const bool bHuge = static_cast<std::int64_t>(nRows) * nCols > 1000000;
+    const bool bSlowScan = nRows >= 100000 && !bDense;
+
+    CGridModel model(10);
+    Measure(tag + "Setup", bHuge ? 1 : 20, [&](int) { model.Setup(nRows, nCols); });
+    int nEditable = 0;
+    for (int nRow = 0; nRow < nRows; ++nRow)
+    {
+        for (int nCol = 0; nCol < nCols; ++nCol)
+        {
+            const std::int64_t nIndex = static_cast<std::int64_t>(nRow) * nCols + nCol;
+            if (bDense ? nCol != 0 : (nIndex % 97 == 50 && nRow < nRows - 1))
+            {
+                model.SetCellEditable(nRow, nCol, true);
+                ++nEditable;
+            }
+        }
+    }
+    std::printf("%-40s %zu bytes (%.2f B/cell), %d editable\n", (tag + "memory").c_str(), model.GetMemoryUsage(),
+                static_cast<double>(model.GetMemoryUsage()) / (static_cast<double>(nRows) * nCols), nEditable);
+
+    const int nOps = 100000;
+    std::mt19937 rng(1);
+    std::vector<int> rows(4096);
+    std::vector<int> cols(4096);
+    for (int i = 0; i < 4096; ++i)
+    {
+        rows[i] = static_cast<int>(rng() % static_cast<unsigned>(nRows));
+        cols[i] = static_cast<int>(rng() % static_cast<unsigned>(nCols));
+    }
+    const int nWidth = model.GetRequiredWidth();
+    const int nHeight = model.GetRequiredHeight();
+    Measure(tag + "SetCellText", nOps, [&](int i) { model.SetCellText(rows[i & 4095], cols[i & 4095], L"123.5"); });
+    Measure(tag + "GetCellIndex", nOps, [&](int i) { g_nSink = g_nSink + model.GetCellIndex(rows[i & 4095], cols[i & 4095]); });
+    Measure(tag + "HitTest", nOps, [&](int i) {
+        g_nSink = g_nSink + model.HitTest(static_cast<int>((i * 7919LL) % nWidth), static_cast<int>((i * 104729LL) % nHeight)).nCol;
+    });
+    Measure(tag + "GetCellRect", nOps, [&](int i) { g_nSink = g_nSink + model.GetCellRect(model.GetTopRow() + i % 10, cols[i & 4095]).left; });
+    Measure(tag + "ArrowRight", nOps, [&](int i) {
+        g_nSink = g_nSink + model.FindEditable(GRID_CELL_POS{rows[i & 4095], cols[i & 4095]}, 1, 0).nCol;
+    });
+    Measure(tag + "ArrowDown", bSlowScan ? 2000 : nOps, [&](int i) {
+        g_nSink = g_nSink + model.FindEditable(GRID_CELL_POS{rows[i & 4095], cols[i & 4095]}, 0, 1).nRow;
+    });
+    Measure(tag + "PageDown", bSlowScan ? 2000 : nOps, [&](int i) {
+        g_nSink = g_nSink + model.FindPageTarget(GRID_CELL_POS{rows[i & 4095], cols[i & 4095]}, true).nRow;
+    });
+    Measure(tag + "EnsureVisible", nOps, [&](int i) { model.SetScrollOffset(model.GetScrollOffsetToShow(rows[i & 4095])); });
+    const int nScans = bDense ? nOps : (nRows >= 100000 ? 20 : 2000);
+    Measure(tag + "FirstEditable", nScans, [&](int) { g_nSink = g_nSink + model.FindFirstEditable().nRow; });
+    Measure(tag + "LastEditable", nScans, [&](int) { g_nSink = g_nSink + model.FindLastEditable().nRow; });
+}
+
+/// @brief 計測結果を基準値のファイルに書き出します。
+bool SaveBaseline(const char *pszPath)
+{
+    std::ofstream out(pszPath);
+    out << "# name ns/op allocations operations\n";
+    for (const auto &item : g_metrics)
+        out << item.first << ' ' << item.second.dNsPerOp << ' ' << item.second.nAllocations << ' ' << item.second.nOperations << '\n';
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief 計測結果を基準値のファイルと比べます。
+ * @details 基準値にない操作と、計測しなかった操作 (--quick で除いた規模) は比べません。
+ * @param[in] dThresholdPercent 時間の閾値 (基準値からの増加率)。負の値なら時間は比べません。
+ * @return 退行の数 (ファイルを読めない場合は-1)
+ */
+int CompareBaseline(const char *pszPath, double dThresholdPercent)
+{
+    std::ifstream in(pszPath);
+    if (!in)
+        return -1;
+    int nRegressions = 0;
+    int nCompared = 0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string name;
+        METRIC baseline = {};
+        if (!(fields >> name >> baseline.dNsPerOp >> baseline.nAllocations >> baseline.nOperations))
+            continue;
+        const auto it = g_metrics.find(name);
+        if (it == g_metrics.end())
+            continue;
+        ++nCompared;
+        const METRIC &current = it->second;
+        const double dLimit = baseline.dNsPerOp * (1.0 + dThresholdPercent / 100.0) + SLACK_NS;
+        if (dThresholdPercent >= 0.0 && current.dNsPerOp > dLimit)
+        {
+            std::printf("REGRESSION %s: %.1f ns/op > %.1f (baseline %.1f)\n", name.c_str(), current.dNsPerOp, dLimit, baseline.dNsPerOp);
+            ++nRegressions;
+        }
+        // 確保回数は減った場合も一致させ、改善を基準値に記録させます
+        if (current.nOperations != baseline.nOperations || current.nAllocations != baseline.nAllocations)
+        {
+            std::printf("REGRESSION %s: %llu allocations in %llu ops, baseline %llu in %llu (re-save if intended)\n", name.c_str(),
+                        static_cast<unsigned long long>(current.nAllocations), static_cast<unsigned long long>(current.nOperations),
+                        static_cast<unsigned long long>(baseline.nAllocations), static_cast<unsigned long long>(baseline.nOperations));
+            ++nRegressions;
+        }
+    }
+    if (dThresholdPercent >= 0.0)
+        std::printf("compared %d operations with %s: %d regressions (allocations, time threshold +%.0f%%)\n", nCompared, pszPath,
+                    nRegressions, dThresholdPercent);
+    else
+        std::printf("compared %d operations with %s: %d regressions (allocations only)\n", nCompared, pszPath, nRegressions);
+    return nCompared > 0 ? nRegressions : -1;
+}
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const char *pszSave = TestFramework::FlagValue(argc, argv, "--save");
+    const char *pszCompare = TestFramework::FlagValue(argc, argv, "--compare");
+    const char *pszThreshold = TestFramework::FlagValue(argc, argv, "--threshold");
+    const double dThreshold = pszThreshold != nullptr ? std::atof(pszThreshold) : -1.0;
+
+    static const int SIZES[][2] = {{6, 2}, {100, 10}, {10000, 20}, {100000, 50}, {1000000, 50}};
+    for (const auto &size : SIZES)
+    {
+        if (bQuick && size[0] >= 1000000)
+            continue;
+        RunSize(size[0], size[1], true);
+        RunSize(size[0], size[1], false);
+    }
+
+    if (pszSave != nullptr)
+    {
+        if (!SaveBaseline(pszSave))
+            return 1;
+        std::printf("saved %zu operations to %s\n", g_metrics.size(), pszSave);
+    }
+    if (pszCompare != nullptr)
+    {
+        const int nRegressions = CompareBaseline(pszCompare, dThreshold);
+        if (nRegressions < 0)
+            std::printf("cannot compare with %s\n", pszCompare);
+        return nRegressions == 0 ? 0 : 1;
+    }
+    return 0;
+}
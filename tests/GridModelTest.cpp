@@ -0,0 +1,241 @@
+﻿/**
+ * @file GridModelTest.cpp
+ * @brief CGridModel のテスト
+ * @details 乱数の大きさ・列幅・編集可否・スクロール位置のグリッドについて、キー操作による移動・Page Up/Down の移動先・
+ * セルの矩形・座標からのセルの検索・最初の編集可能なセルを、従来の CGridCtrl の素朴なループで求めた結果と比べます。
+ */
+#include "GridModel.h"
+#include "TestFramework.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+/**
+ * @struct REFERENCE_GRID
+ * @brief 従来の CGridCtrl の処理をそのまま移したグリッド (比較用)
+ */
+struct REFERENCE_GRID
+{
+    int nRows;                   ///< 行数
+    int nCols;                   ///< 列数
+    int nRowHeight;              ///< 1行の高さ
+    int nMaxVisibleRows;         ///< 一度に表示する最大行数
+    int nTopRow;                 ///< 表示領域の一番上の行
+    int nRowOffset;              ///< 一番上の行が上端からはみ出しているピクセル数
+    std::vector<int> widths;     ///< 列の幅
+    std::vector<char> editable;  ///< セルの編集可否
+
+    bool IsEditable(int nRow, int nCol) const
+    {
+        return nRow >= 0 && nRow < nRows && nCol >= 0 && nCol < nCols && editable[nRow * nCols + nCol] != 0;
+    }
+
+    GRID_CELL_POS FindEditable(const GRID_CELL_POS &from, int dx, int dy) const
+    {
+        int x = from.nCol;
+        int y = from.nRow;
+        while (true)
+        {
+            x += dx;
+            y += dy;
+            if (x < 0 || x >= nCols || y < 0 || y >= nRows)
+                break;
+            if (IsEditable(y, x))
+                return GRID_CELL_POS{y, x};
+        }
+        return GRID_NO_CELL;
+    }
+
+    GRID_CELL_POS FindPageTarget(const GRID_CELL_POS &from, bool bDown) const
+    {
+        const int nDir = bDown ? 1 : -1;
+        int nTarget = from.nRow + nDir * nMaxVisibleRows;
+        if (nTarget < 0)
+            nTarget = 0;
+        if (nTarget >= nRows)
+            nTarget = nRows - 1;
+        for (int nRow = nTarget; nRow >= 0 && nRow < nRows; nRow += nDir)
+        {
+            if (IsEditable(nRow, from.nCol))
+                return GRID_CELL_POS{nRow, from.nCol};
+        }
+        return bDown ? FindLastEditable() : FindFirstEditable();
+    }
+
+    GRID_CELL_POS FindFirstEditable() const
+    {
+        for (int i = 0; i < nRows * nCols; ++i)
+        {
+            if (editable[i] != 0)
+                return GRID_CELL_POS{i / nCols, i % nCols};
+        }
+        return GRID_NO_CELL;
+    }
+
+    GRID_CELL_POS FindLastEditable() const
+    {
+        for (int i = nRows * nCols - 1; i >= 0; --i)
+        {
+            if (editable[i] != 0)
+                return GRID_CELL_POS{i / nCols, i % nCols};
+        }
+        return GRID_NO_CELL;
+    }
+
+    GRID_CELL_POS HitTest(int x, int y) const
+    {
+        const int nRow = (y + nRowOffset) / nRowHeight + nTopRow;
+        if (nRow < 0 || nRow >= nRows)
+            return GRID_NO_CELL;
+        int nRight = 0;
+        for (int nCol = 0; nCol < nCols; ++nCol)
+        {
+            nRight += widths[nCol];
+            if (x < nRight)
+                return GRID_CELL_POS{nRow, nCol};
+        }
+        return GRID_NO_CELL;
+    }
+
+    REGION_RECT GetCellRect(int nRow, int nCol) const
+    {
+        const int nVisible = nMaxVisibleRows + (nRowOffset > 0 ? 1 : 0);
+        if (nRow < nTopRow || nRow >= nTopRow + nVisible)
+            return REGION_RECT{0, 0, 0, 0};
+        int nLeft = 0;
+        for (int i = 0; i < nCol; ++i)
+            nLeft += widths[i];
+        const int nTop = (nRow - nTopRow) * nRowHeight - nRowOffset;
+        return REGION_RECT{nLeft, nTop, nLeft + widths[nCol], nTop + nRowHeight};
+    }
+};
+
+bool SameRect(const REGION_RECT &a, const REGION_RECT &b)
+{
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+}
+
+TEST_CASE(MatchesLegacyGridLoops)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    int nWrongMove = 0;
+    int nWrongPage = 0;
+    int nWrongRect = 0;
+    int nWrongHit = 0;
+    int nWrongFirst = 0;
+    int nNotShown = 0;
+    for (int nTrial = 0; nTrial < 300; ++nTrial)
+    {
+        const int nRows = 1 + static_cast<int>(rng() % 60);
+        const int nCols = 1 + static_cast<int>(rng() % 12);
+        const int nVisible = 1 + static_cast<int>(rng() % 12);
+        const double dDensity = static_cast<double>(rng() % 5) * 0.25;
+        CGridModel model(nVisible);
+        REQUIRE(model.Setup(nRows, nCols));
+        REFERENCE_GRID ref = {nRows, nCols, CGridModel::DEFAULT_ROW_HEIGHT, nVisible, 0, 0,
+                              std::vector<int>(nCols, CGridModel::DEFAULT_COLUMN_WIDTH), std::vector<char>(nRows * nCols, 0)};
+        for (int nCol = 0; nCol < nCols; ++nCol)
+        {
+            if (rng() % 2 == 0)
+                continue;
+            const int nWidth = 10 + static_cast<int>(rng() % 100);
+            model.SetColumnWidth(nCol, nWidth);
+            ref.widths[nCol] = nWidth;
+        }
+        for (int i = 0; i < nRows * nCols; ++i)
+        {
+            if (unit(rng) < dDensity)
+            {
+                model.SetCellEditable(i / nCols, i % nCols, true);
+                ref.editable[i] = 1;
+            }
+        }
+        // 編集可否を戻す場合も確認します
+        for (int k = 0; k < 5; ++k)
+        {
+            const int i = static_cast<int>(rng() % (nRows * nCols));
+            const bool bEditable = rng() % 2 == 0;
+            model.SetCellEditable(i / nCols, i % nCols, bEditable);
+            ref.editable[i] = bEditable ? 1 : 0;
+        }
+        const int nOffset = static_cast<int>(rng() % (model.GetMaxScrollOffset() + 1));
+        model.SetScrollOffset(nOffset);
+        CHECK_EQ(model.GetScrollOffset(), nRows <= nVisible ? 0 : nOffset);
+        ref.nTopRow = model.GetTopRow();
+        ref.nRowOffset = model.GetRowOffset();
+
+        for (int nRow = 0; nRow < nRows; ++nRow)
+        {
+            for (int nCol = 0; nCol < nCols; ++nCol)
+            {
+                const GRID_CELL_POS from = {nRow, nCol};
+                static const int DIRECTIONS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+                for (const auto &dir : DIRECTIONS)
+                {
+                    if (model.FindEditable(from, dir[0], dir[1]) != ref.FindEditable(from, dir[0], dir[1]))
+                        ++nWrongMove;
+                }
+                if (model.FindPageTarget(from, true) != ref.FindPageTarget(from, true) ||
+                    model.FindPageTarget(from, false) != ref.FindPageTarget(from, false))
+                    ++nWrongPage;
+                if (!SameRect(model.GetCellRect(nRow, nCol), ref.GetCellRect(nRow, nCol)))
+                    ++nWrongRect;
+            }
+        }
+        for (int k = 0; k < 200; ++k)
+        {
+            const int x = static_cast<int>(rng() % 1400) - 10;
+            const int y = static_cast<int>(rng() % 400) - 30;
+            if (model.HitTest(x, y) != ref.HitTest(x, y))
+                ++nWrongHit;
+        }
+        if (model.FindFirstEditable() != ref.FindFirstEditable() || model.FindLastEditable() != ref.FindLastEditable())
+            ++nWrongFirst;
+
+        // GetScrollOffsetToShow() の位置では、行全体が表示されます
+        for (int nRow = 0; nRow < nRows; ++nRow)
+        {
+            model.SetScrollOffset(model.GetScrollOffsetToShow(nRow));
+            const REGION_RECT rect = model.GetCellRect(nRow, 0);
+            if (rect.top < 0 || rect.bottom > nVisible * CGridModel::DEFAULT_ROW_HEIGHT || rect.bottom <= rect.top)
+                ++nNotShown;
+        }
+    }
+    CHECK_EQ(nWrongMove, 0);
+    CHECK_EQ(nWrongPage, 0);
+    CHECK_EQ(nWrongRect, 0);
+    CHECK_EQ(nWrongHit, 0);
+    CHECK_EQ(nWrongFirst, 0);
+    CHECK_EQ(nNotShown, 0);
+}
+
+TEST_CASE(CellTextAndRangeChecks)
+{
+    CGridModel model;
+    REQUIRE(model.Setup(6, 2));
+    model.SetCellText(0, 0, L"abc");
+    CHECK(model.GetCellText(0, 0) == L"abc");
+    model.SetCellText(0, 0, L"12345", 2);
+    CHECK(model.GetCellText(0, 0) == L"12");
+    model.SetCellText(0, 0, L"");
+    CHECK(model.GetCellText(0, 0).empty());
+    model.SetCellText(6, 0, L"x");
+    CHECK(model.GetCellText(-1, 0).empty());
+    CHECK(model.GetCellText(6, 0).empty());
+    CHECK(!model.IsCellEditable(6, 0));
+    CHECK_EQ(model.GetCellIndex(5, 1), 11);
+    CHECK_EQ(model.GetCellIndex(5, 2), -1);
+    CHECK(model.FindFirstEditable() == GRID_NO_CELL);
+    model.SetCellEditable(5, 1, true);
+    CHECK(model.FindFirstEditable() == (GRID_CELL_POS{5, 1}));
+    CHECK(model.FindPageTarget(GRID_CELL_POS{0, 0}, true) == (GRID_CELL_POS{5, 1}));
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,188 @@
+﻿/**
+ * @file GridSpatialIndexTest.cpp
+ * @brief CGridSpatialIndex のテスト
+ * @details 1万個のランダムな矩形に対するヒットテストと方向検索の結果を、全件走査の結果と比較します。
+ */
+#include "GridSpatialIndex.h"
+#include "TestFramework.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+using Rect = CGridSpatialIndex::Rect;
+
+/**
+ * @brief 全件走査でヒットテストを行います (最小のインデックスを返します)。
+ */
+int BruteHitTest(const std::vector<Rect> &rects, int x, int y)
+{
+    for (int i = 0; i < static_cast<int>(rects.size()); ++i)
+    {
+        const Rect &r = rects[i];
+        if (x >= r.left && x < r.right && y >= r.top && y < r.bottom)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief 全件走査で指定方向の最も近い矩形を検索します。
+ * @details 評価値は CGridSpatialIndex::FindNearest() と同じ定義 (中心は2倍の座標で比較) です。
+ */
+int BruteFindNearest(const std::vector<Rect> &rects, int nFrom, CGridSpatialIndex::Direction dir)
+{
+    const Rect &a = rects[nFrom];
+    const bool bVertical = (dir == CGridSpatialIndex::DIR_UP || dir == CGridSpatialIndex::DIR_DOWN);
+    int nBest = -1;
+    long long bestScore = 0;
+    for (int i = 0; i < static_cast<int>(rects.size()); ++i)
+    {
+        const Rect &r = rects[i];
+        if (i == nFrom || r.right <= r.left || r.bottom <= r.top)
+            continue;
+        long long gap, minor2;
+        if (bVertical)
+        {
+            gap = (dir == CGridSpatialIndex::DIR_DOWN) ? r.top - a.bottom : a.top - r.bottom;
+            minor2 = static_cast<long long>(r.left + r.right) - (a.left + a.right);
+        }
+        else
+        {
+            gap = (dir == CGridSpatialIndex::DIR_RIGHT) ? r.left - a.right : a.left - r.right;
+            minor2 = static_cast<long long>(r.top + r.bottom) - (a.top + a.bottom);
+        }
+        if (gap < 0)
+            continue;
+        const long long score = 4 * CGridSpatialIndex::WEIGHT_MAJOR * gap * gap + minor2 * minor2;
+        if (nBest == -1 || score < bestScore)
+        {
+            nBest = i;
+            bestScore = score;
+        }
+    }
+    return nBest;
+}
+
+/**
+ * @brief 重なりを含むランダムな矩形を生成します (末尾に幅0の矩形を1個含みます)。
+ */
+std::vector<Rect> MakeRandomRects(int nCount, unsigned int nSeed)
+{
+    std::mt19937 rng(nSeed);
+    std::vector<Rect> rects;
+    rects.reserve(nCount + 1);
+    for (int i = 0; i < nCount; ++i)
+    {
+        const int x = static_cast<int>(rng() % 20000) - 500;
+        const int y = static_cast<int>(rng() % 20000) - 300;
+        const int w = 20 + static_cast<int>(rng() % 300);
+        const int h = 10 + static_cast<int>(rng() % 200);
+        rects.push_back({x, y, x + w, y + h});
+    }
+    rects.push_back({5, 5, 5, 9});
+    return rects;
+}
+}
+
+TEST_CASE(HitTestMatchesBruteForceOn10kRects)
+{
+    const std::vector<Rect> rects = MakeRandomRects(10000, 1);
+    CGridSpatialIndex index;
+    index.Build(rects.data(), static_cast<int>(rects.size()));
+    CHECK_EQ(index.GetCount(), static_cast<int>(rects.size()));
+
+    std::mt19937 rng(2);
+    int nMismatches = 0;
+    for (int k = 0; k < 20000; ++k)
+    {
+        const int x = static_cast<int>(rng() % 21000) - 600;
+        const int y = static_cast<int>(rng() % 21000) - 600;
+        if (index.HitTest(x, y) != BruteHitTest(rects, x, y))
+            ++nMismatches;
+    }
+    // 矩形の角と辺の上 (半開区間の境界) も確認します
+    for (int i = 0; i < 2000; ++i)
+    {
+        const Rect &r = rects[i];
+        const int xs[] = {r.left, r.right - 1, r.right};
+        const int ys[] = {r.top, r.bottom - 1, r.bottom};
+        for (int x : xs)
+        {
+            for (int y : ys)
+            {
+                if (index.HitTest(x, y) != BruteHitTest(rects, x, y))
+                    ++nMismatches;
+            }
+        }
+    }
+    CHECK_EQ(nMismatches, 0);
+}
+
+TEST_CASE(FindNearestMatchesBruteForceOn10kRects)
+{
+    const std::vector<Rect> rects = MakeRandomRects(10000, 3);
+    CGridSpatialIndex index;
+    index.Build(rects.data(), static_cast<int>(rects.size()));
+
+    int nMismatches = 0;
+    for (int i = 0; i < static_cast<int>(rects.size()); i += 3)
+    {
+        for (int d = CGridSpatialIndex::DIR_UP; d <= CGridSpatialIndex::DIR_RIGHT; ++d)
+        {
+            const auto dir = static_cast<CGridSpatialIndex::Direction>(d);
+            if (index.FindNearest(i, dir) != BruteFindNearest(rects, i, dir))
+                ++nMismatches;
+        }
+    }
+    CHECK_EQ(nMismatches, 0);
+}
+
+TEST_CASE(ExplicitBucketSizeGivesSameResults)
+{
+    const std::vector<Rect> rects = MakeRandomRects(3000, 4);
+    CGridSpatialIndex index;
+    index.Build(rects.data(), static_cast<int>(rects.size()), 64, 4096);
+
+    std::mt19937 rng(5);
+    int nMismatches = 0;
+    for (int k = 0; k < 5000; ++k)
+    {
+        const int x = static_cast<int>(rng() % 21000) - 600;
+        const int y = static_cast<int>(rng() % 21000) - 600;
+        if (index.HitTest(x, y) != BruteHitTest(rects, x, y))
+            ++nMismatches;
+    }
+    for (int i = 0; i < static_cast<int>(rects.size()); i += 7)
+    {
+        if (index.FindNearest(i, CGridSpatialIndex::DIR_LEFT) != BruteFindNearest(rects, i, CGridSpatialIndex::DIR_LEFT))
+            ++nMismatches;
+    }
+    CHECK_EQ(nMismatches, 0);
+}
+
+TEST_CASE(DialogGridNavigation)
+{
+    // CMyDialog2 の配置 (5行2列、340x132、間隔10)
+    std::vector<Rect> rects;
+    for (int r = 0; r < 5; ++r)
+    {
+        for (int c = 0; c < 2; ++c)
+            rects.push_back({10 + c * 350, 10 + r * 142, 10 + c * 350 + 340, 10 + r * 142 + 132});
+    }
+    CGridSpatialIndex index;
+    index.Build(rects.data(), static_cast<int>(rects.size()));
+    CHECK_EQ(index.FindNearest(0, CGridSpatialIndex::DIR_DOWN), 2);
+    CHECK_EQ(index.FindNearest(0, CGridSpatialIndex::DIR_RIGHT), 1);
+    CHECK_EQ(index.FindNearest(3, CGridSpatialIndex::DIR_UP), 1);
+    CHECK_EQ(index.FindNearest(3, CGridSpatialIndex::DIR_LEFT), 2);
+    CHECK_EQ(index.FindNearest(8, CGridSpatialIndex::DIR_DOWN), -1);
+    CHECK_EQ(index.HitTest(5, 5), -1);
+    CHECK_EQ(index.HitTest(360, 152), 3);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
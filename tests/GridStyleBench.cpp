@@ -0,0 +1,216 @@
+﻿/**
+ * @file GridStyleBench.cpp
+ * @brief 書式の表の操作と、まとめ描画・セルごとの描画の描画状態の切り替えのベンチマーク
+ * @details 1000000×50 のグリッドの1セルあたりのメモリ量を書式の数ごとに、範囲への書式の設定・書式の登録の時間を計測します。
+ * 3種類のグリッド (編集可能な数値の入力欄・見出しと縞模様と右揃えの数値列の表・隣り合うセルの書式が全て異なる市松模様) を
+ * 21行×12列表示し、CSoftwareRenderTarget の呼び出し回数 (RENDER_TARGET_STATS) で、
+ * CGridPainter::Paint() のまとめ描画とセルごとの描画 (PerCellGridPainter) の1フレームあたりの
+ * 塗りつぶし・線分・文字列・描画状態の切り替えの回数と時間を比べます。
+ * 両者の描画結果が異なる場合と、まとめ描画の切り替えの回数がセルごとの描画以上の場合は終了コードを1にします。
+ * 時間は GDI への描画ではなくソフトウェア描画のものです。呼び出し回数は CGdiRenderTarget でも同じ数え方です。
+ *
+ *   GridStyleBench          計測
+ *   GridStyleBench --quick  ctest 用 (グリッドを 100000 行にし、回数を減らします)
+ */
+#include "GridModel.h"
+#include "PerCellGridPainter.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::uint64_t g_nSink = 0;
+
+/// @brief CMyDialog と同じ、編集可能なセルに数値・空欄・文字列が入った入力欄
+void FillInputForm(CGridModel &model, int nRows, int nCols)
+{
+    model.Setup(nRows, nCols);
+    static const wchar_t *const TEXTS[] = {L"", L"12.5", L"-3", L"abc", L"7"};
+    for (int nRow = 0; nRow < nRows; ++nRow)
+    {
+        for (int nCol = 0; nCol < nCols; ++nCol)
+        {
+            if ((nRow + nCol) % 4 == 0)
+                continue;
+            model.SetCellEditable(nRow, nCol, true);
+            model.SetCellText(nRow, nCol, TEXTS[(nRow * 7 + nCol) % 5]);
+        }
+    }
+}
+
+/// @brief 太字で中央揃えの見出しの行、1行おきの縞模様、右揃えで数値を色分けする列の表
+void FillReport(CGridModel &model, int nRows, int nCols)
+{
+    model.Setup(nRows, nCols);
+    GRID_CELL_STYLE header = GRID_CELL_STYLE::Default(RenderRgb(220, 220, 220));
+    header.bBold = 1;
+    header.nAlign = RENDER_TEXT_CENTER;
+    GRID_CELL_STYLE odd = GRID_CELL_STYLE::Default(RenderRgb(255, 255, 255));
+    GRID_CELL_STYLE even = GRID_CELL_STYLE::Default(RenderRgb(235, 245, 255));
+    GRID_CELL_STYLE oddNumber = odd;
+    GRID_CELL_STYLE evenNumber = even;
+    oddNumber.nAlign = evenNumber.nAlign = RENDER_TEXT_RIGHT;
+    oddNumber.nNumberRule = evenNumber.nNumberRule = GRID_NUMBER_RULE_SIGN;
+    const int nHeader = model.AddStyle(header);
+    const int nOdd = model.AddStyle(odd);
+    const int nEven = model.AddStyle(even);
+    const int nOddNumber = model.AddStyle(oddNumber);
+    const int nEvenNumber = model.AddStyle(evenNumber);
+    for (int nRow = 1; nRow < nRows; ++nRow)
+        model.ApplyStyleToRow(nRow, nRow % 2 != 0 ? nOdd : nEven);
+    for (int nCol = 2; nCol < nCols; nCol += 2)
+    {
+        for (int nRow = 1; nRow < nRows; ++nRow)
+            model.SetCellStyle(nRow, nCol, nRow % 2 != 0 ? nOddNumber : nEvenNumber);
+    }
+    model.ApplyStyleToRow(0, nHeader);
+    for (int nRow = 0; nRow < nRows; ++nRow)
+    {
+        for (int nCol = 0; nCol < nCols; ++nCol)
+            model.SetCellText(nRow, nCol, nRow == 0 ? L"Head" : (nCol % 2 != 0 ? L"name" : ((nRow + nCol) % 3 != 0 ? L"42" : L"-1")));
+    }
+}
+
+/// @brief 隣り合うセルの背景色・文字色・枠線の色・太さが全て異なる市松模様 (まとめ描画に最も不利な場合)
+void FillChecker(CGridModel &model, int nRows, int nCols)
+{
+    model.Setup(nRows, nCols);
+    GRID_CELL_STYLE light = GRID_CELL_STYLE::Default(RenderRgb(255, 255, 255));
+    GRID_CELL_STYLE dark = GRID_CELL_STYLE::Default(RenderRgb(255, 240, 200));
+    dark.textColor = RenderRgb(160, 0, 0);
+    dark.borderColor = RenderRgb(128, 128, 128);
+    dark.bBold = 1;
+    const int nLight = model.AddStyle(light);
+    const int nDark = model.AddStyle(dark);
+    for (int nRow = 0; nRow < nRows; ++nRow)
+    {
+        for (int nCol = 0; nCol < nCols; ++nCol)
+        {
+            model.SetCellStyle(nRow, nCol, (nRow + nCol) % 2 != 0 ? nDark : nLight);
+            model.SetCellText(nRow, nCol, L"x1");
+        }
+    }
+}
+
+/// @brief 1フレームあたりの呼び出し回数と時間を1行で表示します。
+void PrintFrame(const char *pszLabel, const RENDER_TARGET_STATS &stats, double dFrames, double dMicros)
+{
+    std::printf("  %-9s fills %5.0f  lines %5.0f  texts %5.0f  state changes %5.0f  %8.1f us/frame\n", pszLabel, stats.nFills / dFrames,
+                stats.nLines / dFrames, stats.nTexts / dFrames, stats.nStateChanges / dFrames, dMicros);
+}
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nRepeats = bQuick ? 2 : 5;
+    const int nBigRows = bQuick ? 100000 : 1000000;
+    bool bPassed = true;
+
+    // 1セルあたりのメモリ量 (セルごとの書式の番号と、書式の表)
+    for (int nStyles : {1, 16, 1000})
+    {
+        CGridModel model;
+        model.Setup(nBigRows, 50);
+        for (int k = 0; k < nStyles; ++k)
+        {
+            const int nStyle = model.AddStyle(GRID_CELL_STYLE::Default(RenderRgb(k & 255, k >> 8, 7)));
+            model.ApplyStyleToRow(k * 997 % nBigRows, nStyle);
+        }
+        std::printf("memory %dx50, %4d styles: %.3f B/cell (%d styles in table)\n", nBigRows, nStyles,
+                    static_cast<double>(model.GetMemoryUsage()) / (static_cast<double>(nBigRows) * 50), model.GetStyleCount());
+    }
+
+    // 書式の操作
+    {
+        CGridModel model;
+        model.Setup(100000, 50);
+        const int nStyleA = model.AddStyle(GRID_CELL_STYLE::Default(1));
+        const int nStyleB = model.AddStyle(GRID_CELL_STYLE::Default(2));
+        int i = 0;
+        const int nScale = bQuick ? 10 : 1;
+        const double dRow = TestFramework::MeasureNsPerOp(200000 / nScale, nRepeats, [&]() {
+            ++i;
+            model.ApplyStyleToRow(i % 100000, (i & 1) != 0 ? nStyleA : nStyleB);
+        });
+        const double dColumn = TestFramework::MeasureNsPerOp(200 / nScale, nRepeats, [&]() {
+            ++i;
+            model.ApplyStyleToColumn(i % 50, (i & 1) != 0 ? nStyleA : nStyleB);
+        });
+        const double dRange = TestFramework::MeasureNsPerOp(200 / nScale, nRepeats, [&]() {
+            ++i;
+            model.ApplyStyleToRange(i * 13 % 99000, i % 30, i * 13 % 99000 + 999, i % 30 + 19, (i & 1) != 0 ? nStyleA : nStyleB);
+        });
+        const double dCell = TestFramework::MeasureNsPerOp(5000000 / nScale, nRepeats, [&]() {
+            ++i;
+            model.SetCellStyle(i % 100000, i % 50, (i & 1) != 0 ? nStyleA : nStyleB);
+        });
+        const double dBgColor = TestFramework::MeasureNsPerOp(5000000 / nScale, nRepeats, [&]() {
+            ++i;
+            model.SetCellBgColor(i / 50 % 100000, i % 50, (i & 1) != 0 ? RenderRgb(1, 1, 1) : RenderRgb(2, 2, 2));
+        });
+        CGridStyleTable table;
+        for (int k = 0; k < 1000; ++k)
+            table.Intern(GRID_CELL_STYLE::Default(static_cast<RenderColor>(k)));
+        const double dIntern = TestFramework::MeasureNsPerOp(5000000 / nScale, nRepeats, [&]() {
+            ++i;
+            g_nSink = g_nSink + static_cast<std::uint64_t>(table.Intern(GRID_CELL_STYLE::Default(static_cast<RenderColor>(i * 7 % 1000))));
+        });
+        std::printf("%-44s %8.2f ns/cell\n", "ApplyStyleToRow (50 cells)", dRow / 50);
+        std::printf("%-44s %8.2f ns/cell\n", "ApplyStyleToColumn (100000 cells)", dColumn / 100000);
+        std::printf("%-44s %8.2f ns/cell\n", "ApplyStyleToRange (1000x20)", dRange / 20000);
+        std::printf("%-44s %8.2f ns/op\n", "SetCellStyle", dCell);
+        std::printf("%-44s %8.2f ns/op\n", "SetCellBgColor (alternating, table lookup)", dBgColor);
+        std::printf("%-44s %8.2f ns/op\n", "Intern (1000 styles, hit)", dIntern);
+    }
+
+    // 1フレームの描画: まとめ描画とセルごとの描画
+    struct SCENARIO
+    {
+        const char *pszName;                       ///< 名前
+        void (*fill)(CGridModel &, int, int);      ///< グリッドを作る関数
+    };
+    const SCENARIO scenarios[] = {{"input form (editable numbers)", FillInputForm},
+                                  {"report (header/bands/numeric columns)", FillReport},
+                                  {"checkerboard (worst case)", FillChecker}};
+    const int nFrames = bQuick ? 20 : 300;
+    for (const SCENARIO &scenario : scenarios)
+    {
+        CGridModel model(20);
+        scenario.fill(model, 1000, 12);
+        model.SetScrollOffset(22 * 37 + 5);
+        model.SetSelection(GRID_CELL_POS{40, 3});
+        GRID_PAINT_STATE state = model.GetPaintState(model.GetRequiredWidth(), model.GetRequiredHeight());
+        state.bActive = true;
+
+        CSoftwareRenderTarget perCell(state.nWidth, state.nHeight);
+        CSoftwareRenderTarget batched(state.nWidth, state.nHeight);
+        PerCellGridPainter::Paint(perCell, state, model);
+        CGridPainter::Paint(batched, state, model);
+        const bool bSame = perCell.GetChecksum() == batched.GetChecksum();
+        perCell.ResetStats();
+        batched.ResetStats();
+        const double dPerCell =
+            TestFramework::MeasureNsPerOp(nFrames, nRepeats, [&]() { PerCellGridPainter::Paint(perCell, state, model); }) / 1000.0;
+        const double dBatched = TestFramework::MeasureNsPerOp(nFrames, nRepeats, [&]() { CGridPainter::Paint(batched, state, model); }) / 1000.0;
+        g_nSink = g_nSink + perCell.GetChecksum() + batched.GetChecksum();
+
+        const double dTotal = static_cast<double>(nFrames) * nRepeats;
+        std::printf("%s, 21 visible rows x 12 cols:\n", scenario.pszName);
+        PrintFrame("per-cell", perCell.GetStats(), dTotal, dPerCell);
+        PrintFrame("batched", batched.GetStats(), dTotal, dBatched);
+        if (!bSame)
+        {
+            std::printf("  FAIL: batched paint differs from per-cell paint\n");
+            bPassed = false;
+        }
+        if (batched.GetStats().nStateChanges >= perCell.GetStats().nStateChanges)
+        {
+            std::printf("  FAIL: batched paint does not reduce state changes\n");
+            bPassed = false;
+        }
+    }
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+﻿/**
+ * @file GridStyleTest.cpp
+ * @brief CGridStyleTable と CGridModel の書式の操作、CGridPainter のまとめ描画のテスト
+ * @details 書式の表が同じ内容の書式を1つにまとめ、上限を超えた登録を拒否すること、
+ * 行・列・矩形の範囲への書式の設定がセルごとの設定と同じ結果になることを確認します。
+ * また、乱数の書式・文字列・スクロール位置・選択のグリッドについて、CGridPainter::Paint() のまとめ描画が
+ * セルごとの描画 (PerCellGridPainter) とピクセル単位で同じ結果になり、描画状態の切り替えが増えないことを確認します。
+ */
+#include "GridModel.h"
+#include "PerCellGridPainter.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static_assert(sizeof(GRID_CELL_STYLE) == 16, "GRID_CELL_STYLE は未使用の領域のない16バイトです");
+
+TEST_CASE(StyleTableDeduplicatesUpToLimit)
+{
+    CGridStyleTable table;
+    GRID_CELL_STYLE style = GRID_CELL_STYLE::Default(1);
+    CHECK_EQ(table.Intern(style), 0);
+    CHECK_EQ(table.Intern(style), 0);
+    style.bBold = 1;
+    CHECK_EQ(table.Intern(style), 1);
+    style.bBold = 0;
+    CHECK_EQ(table.Intern(style), 0);
+
+    // 上限まで登録でき、上限を超えた新しい書式は-1、登録済みの書式は番号を返します
+    int nWrongIndex = 0;
+    for (int i = 0; i < CGridStyleTable::MAX_STYLES - 2; ++i)
+    {
+        GRID_CELL_STYLE other = GRID_CELL_STYLE::Default(RenderRgb(i & 255, (i >> 8) & 255, (i >> 16) & 255));
+        other.bBold = 1;
+        other.nAlign = RENDER_TEXT_CENTER;
+        if (table.Intern(other) != i + 2)
+            ++nWrongIndex;
+    }
+    CHECK_EQ(nWrongIndex, 0);
+    CHECK_EQ(table.GetCount(), CGridStyleTable::MAX_STYLES);
+    GRID_CELL_STYLE overflow = GRID_CELL_STYLE::Default(5);
+    overflow.nAlign = RENDER_TEXT_RIGHT;
+    CHECK_EQ(table.Intern(overflow), -1);
+    CHECK_EQ(table.Intern(GRID_CELL_STYLE::Default(1)), 0);
+    table.Clear();
+    CHECK_EQ(table.GetCount(), 0);
+    CHECK_EQ(table.Intern(overflow), 0);
+}
+
+TEST_CASE(ModelStyleOperations)
+{
+    CGridModel model;
+    REQUIRE(model.Setup(5, 4));
+    CHECK_EQ(model.GetCellStyle(0, 0), model.GetCellStyle(4, 3));
+    CHECK_EQ(model.GetCellStyle(5, 0), -1);
+    CHECK(model.GetStyle(model.GetCellStyle(0, 0)).bgColor == RenderRgb(240, 240, 240));
+
+    // 編集可能なセルは白の背景で数値の色分けをし、背景色だけを変えても色分けは残ります
+    model.SetCellEditable(1, 1, true);
+    const GRID_CELL_STYLE &editable = model.GetStyle(model.GetCellStyle(1, 1));
+    CHECK(editable.bgColor == RenderRgb(255, 255, 255));
+    CHECK_EQ(editable.nNumberRule, GRID_NUMBER_RULE_SIGN);
+    model.SetCellBgColor(1, 1, RenderRgb(1, 2, 3));
+    CHECK_EQ(model.GetStyle(model.GetCellStyle(1, 1)).nNumberRule, GRID_NUMBER_RULE_SIGN);
+    CHECK(model.GetStyle(model.GetCellStyle(1, 1)).bgColor == RenderRgb(1, 2, 3));
+    model.SetCellEditable(1, 1, false);
+    CHECK_EQ(model.GetCellStyle(1, 1), model.GetCellStyle(0, 0));
+
+    // 既定の背景色の変更は、以後の初期化で使います
+    const int nStyles = model.GetStyleCount();
+    model.SetDefaultBgColor(RenderRgb(9, 9, 9));
+    REQUIRE(model.Setup(5, 4));
+    CHECK_EQ(model.GetStyleCount(), nStyles + 1);
+    CHECK(model.GetStyle(model.GetCellStyle(2, 2)).bgColor == RenderRgb(9, 9, 9));
+
+    // 未登録の番号は無視します
+    model.SetCellStyle(0, 0, 12345);
+    CHECK_EQ(model.GetCellStyle(0, 0), model.GetCellStyle(0, 1));
+}
+
+TEST_CASE(RangeAppliesMatchPerCell)
+{
+    std::mt19937 rng(7);
+    int nMismatches = 0;
+    for (int nTrial = 0; nTrial < 300; ++nTrial)
+    {
+        const int nRows = 1 + static_cast<int>(rng() % 30);
+        const int nCols = 1 + static_cast<int>(rng() % 12);
+        CGridModel model;
+        REQUIRE(model.Setup(nRows, nCols));
+        std::vector<int> expected(nRows * nCols, model.GetCellStyle(0, 0));
+        int styles[8];
+        for (int &nStyle : styles)
+        {
+            GRID_CELL_STYLE style = GRID_CELL_STYLE::Default(rng() % 4);
+            style.nAlign = static_cast<std::uint8_t>(rng() % 3);
+            nStyle = model.AddStyle(style);
+        }
+        for (int nOp = 0; nOp < 40; ++nOp)
+        {
+            // 範囲外にはみ出す行・列も含めます
+            const int nStyle = styles[rng() % 8];
+            const int nKind = static_cast<int>(rng() % 4);
+            const int nRow0 = static_cast<int>(rng() % (nRows + 4)) - 2;
+            const int nCol0 = static_cast<int>(rng() % (nCols + 4)) - 2;
+            const int nRow1 = static_cast<int>(rng() % (nRows + 4)) - 2;
+            const int nCol1 = static_cast<int>(rng() % (nCols + 4)) - 2;
+            auto apply = [&](int nFirstRow, int nFirstCol, int nLastRow, int nLastCol) {
+                for (int nRow = std::max(nFirstRow, 0); nRow <= std::min(nLastRow, nRows - 1); ++nRow)
+                {
+                    for (int nCol = std::max(nFirstCol, 0); nCol <= std::min(nLastCol, nCols - 1); ++nCol)
+                        expected[nRow * nCols + nCol] = nStyle;
+                }
+            };
+            if (nKind == 0)
+            {
+                model.SetCellStyle(nRow0, nCol0, nStyle);
+                apply(nRow0, nCol0, nRow0, nCol0);
+            }
+            else if (nKind == 1)
+            {
+                model.ApplyStyleToRow(nRow0, nStyle);
+                apply(nRow0, 0, nRow0, nCols - 1);
+            }
+            else if (nKind == 2)
+            {
+                model.ApplyStyleToColumn(nCol0, nStyle);
+                apply(0, nCol0, nRows - 1, nCol0);
+            }
+            else
+            {
+                model.ApplyStyleToRange(nRow0, nCol0, nRow1, nCol1, nStyle);
+                apply(nRow0, nCol0, nRow1, nCol1);
+            }
+        }
+        for (int i = 0; i < nRows * nCols; ++i)
+        {
+            if (model.GetCellStyle(i / nCols, i % nCols) != expected[i])
+            {
+                ++nMismatches;
+                break;
+            }
+        }
+    }
+    CHECK_EQ(nMismatches, 0);
+}
+
+TEST_CASE(BatchedPaintMatchesPerCellPaint)
+{
+    std::mt19937 rng(7);
+    static const wchar_t *const TEXTS[] = {L"", L"1", L"-2.5", L"abc", L" 7 ", L"longer text here"};
+    int nCompared = 0;
+    int nDifferentPixels = 0;
+    int nMoreStateChanges = 0;
+    for (int nTrial = 0; nTrial < 3000; ++nTrial)
+    {
+        const int nRows = 1 + static_cast<int>(rng() % 25);
+        const int nCols = 1 + static_cast<int>(rng() % 8);
+        CGridModel model(1 + static_cast<int>(rng() % 12));
+        REQUIRE(model.Setup(nRows, nCols));
+        for (int nCol = 0; nCol < nCols; ++nCol)
+            model.SetColumnWidth(nCol, 30 + static_cast<int>(rng() % 70));
+        int styles[6];
+        for (int &nStyle : styles)
+        {
+            GRID_CELL_STYLE style = GRID_CELL_STYLE::Default(RenderRgb(rng() % 3 * 100, 200, rng() % 2 * 255));
+            style.textColor = RenderRgb(rng() % 2 * 200, 0, 0);
+            style.borderColor = RenderRgb(0, rng() % 2 * 150, 0);
+            style.nBorderWidth = static_cast<std::uint8_t>(rng() % 2);
+            style.nAlign = static_cast<std::uint8_t>(rng() % 3);
+            style.bBold = static_cast<std::uint8_t>(rng() % 2);
+            style.nNumberRule = static_cast<std::uint8_t>(rng() % 2);
+            nStyle = model.AddStyle(style);
+        }
+        for (int nRow = 0; nRow < nRows; ++nRow)
+        {
+            for (int nCol = 0; nCol < nCols; ++nCol)
+            {
+                if (rng() % 3 != 0)
+                    model.SetCellStyle(nRow, nCol, styles[rng() % 6]);
+                if (rng() % 4 == 0)
+                    model.SetCellEditable(nRow, nCol, true);
+                model.SetCellText(nRow, nCol, TEXTS[rng() % 6]);
+            }
+        }
+        model.SetScrollOffset(static_cast<int>(rng() % (model.GetMaxScrollOffset() + 1)));
+        if (rng() % 2 != 0)
+            model.SetSelection(GRID_CELL_POS{static_cast<int>(rng() % nRows), static_cast<int>(rng() % nCols)});
+        GRID_PAINT_STATE state = model.GetPaintState(model.GetRequiredWidth(), model.GetRequiredHeight());
+        state.bEditing = rng() % 2 != 0;
+        state.bActive = rng() % 2 != 0;
+
+        CSoftwareRenderTarget perCell(state.nWidth, state.nHeight);
+        CSoftwareRenderTarget batched(state.nWidth, state.nHeight);
+        PerCellGridPainter::Paint(perCell, state, model);
+        CGridPainter::Paint(batched, state, model);
+        ++nCompared;
+        if (perCell.GetChecksum() != batched.GetChecksum())
+            ++nDifferentPixels;
+        if (batched.GetStats().nStateChanges > perCell.GetStats().nStateChanges)
+            ++nMoreStateChanges;
+    }
+    CHECK_EQ(nCompared, 3000);
+    CHECK_EQ(nDifferentPixels, 0);
+    CHECK_EQ(nMoreStateChanges, 0);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,101 @@
+﻿/**
+ * @file InputHistoryBench.cpp
+ * @brief CInputHistory のベンチマーク
+ * @details 100万語を登録し、さらに偏りのある分布 (少数の語を繰り返し使う) で100万回確定した履歴に対して、
+ * 接頭辞の長さごとの上位5件の候補を求める時間 (p50 / p99 / 最大) と、1回あたりのメモリ確保回数を計測します。
+ * 記録・保存・読み込みの時間と、保存したバイト数・使用メモリも表示します。
+ *
+ *   InputHistoryBench          100万語で計測
+ *   InputHistoryBench --quick  ctest 用 (5万語で計測します)
+ */
+#include "InputHistory.h"
+#include "AllocationCounter.h"
+#include "TestFramework.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::size_t g_nSink = 0;
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nWords = bQuick ? 50000 : 1000000;
+    const int nQueries = bQuick ? 2000 : 20000;
+
+    std::mt19937 rng(1);
+    const char szAlphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    std::vector<std::wstring> words;
+    words.reserve(nWords);
+    for (int i = 0; i < nWords; ++i)
+    {
+        std::wstring word;
+        const int nLength = 4 + static_cast<int>(rng() % 12);
+        for (int j = 0; j < nLength; ++j)
+            word.push_back(static_cast<wchar_t>(szAlphabet[rng() % 36]));
+        words.push_back(word);
+    }
+
+    CInputHistory history;
+    std::int64_t nStart = TestFramework::NowNs();
+    for (const std::wstring &word : words)
+        history.Record(word.c_str());
+    for (int i = 0; i < nWords; ++i)
+    {
+        const double dRank = std::pow(static_cast<double>(rng() % 1000000 + 1) / 1e6, 4.0);
+        history.Record(words[static_cast<std::size_t>(dRank * (nWords - 1))].c_str());
+    }
+    const double dRecordMs = static_cast<double>(TestFramework::NowNs() - nStart) / 1e6;
+    std::printf("entries=%d nodes=%d memory=%.1f MB  record %d: %.0f ms (%.2f us/record)\n", history.GetEntryCount(),
+                history.GetNodeCount(), static_cast<double>(history.GetMemoryUsage()) / 1048576.0, 2 * nWords, dRecordMs,
+                dRecordMs * 1000.0 / (2 * nWords));
+
+    std::vector<int> results;
+    history.Suggest(L"", 5, results); // 作業領域を確保しておきます
+    bool bAllocationFree = true;
+    for (int nPrefix = 0; nPrefix <= 4; ++nPrefix)
+    {
+        std::vector<std::wstring> prefixes;
+        for (int i = 0; i < nQueries; ++i)
+            prefixes.push_back(words[rng() % words.size()].substr(0, nPrefix));
+        std::vector<double> samples;
+        samples.reserve(nQueries);
+        const AllocationCounter::SNAPSHOT allocations = AllocationCounter::Now();
+        for (const std::wstring &prefix : prefixes)
+        {
+            const std::int64_t t0 = TestFramework::NowNs();
+            history.Suggest(prefix.c_str(), 5, results);
+            samples.push_back(static_cast<double>(TestFramework::NowNs() - t0));
+            g_nSink = g_nSink + results.size();
+        }
+        const double dAllocations = static_cast<double>(AllocationCounter::AllocationsSince(allocations)) / nQueries;
+        if (dAllocations > 0.01)
+            bAllocationFree = false;
+        const double dMax = TestFramework::Percentile(samples, 100.0);
+        std::printf("Suggest prefix len %d: p50=%.2f us  p99=%.2f us  max=%.1f us  allocs/query=%.3f\n", nPrefix,
+                    TestFramework::Percentile(samples, 50.0) / 1000.0, TestFramework::Percentile(samples, 99.0) / 1000.0,
+                    dMax / 1000.0, dAllocations);
+    }
+
+    std::vector<unsigned char> data;
+    nStart = TestFramework::NowNs();
+    history.Serialize(data);
+    const double dSaveMs = static_cast<double>(TestFramework::NowNs() - nStart) / 1e6;
+    CInputHistory loaded;
+    std::size_t nPos = 0;
+    nStart = TestFramework::NowNs();
+    const bool bLoaded = loaded.Deserialize(data.data(), data.size(), nPos);
+    const double dLoadMs = static_cast<double>(TestFramework::NowNs() - nStart) / 1e6;
+    std::printf("serialize %.0f ms (%.1f MB)  deserialize %.0f ms  ok=%d\n", dSaveMs, static_cast<double>(data.size()) / 1048576.0,
+                dLoadMs, bLoaded ? 1 : 0);
+
+    // 候補の計算は作業領域を再利用し、メモリを確保しないこと
+    return (bLoaded && loaded.GetEntryCount() == history.GetEntryCount() && bAllocationFree) ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+﻿/**
+ * @file InputHistoryTest.cpp
+ * @brief CInputHistory / CInputHistoryStore のテスト
+ * @details 上位 k 件の候補とその順序を、全ての登録の点数を総当たりで求めた結果と比べます。
+ * 使用による点数の更新 (SetScore) で兄弟の順序が入れ替わること、保存と読み込みで候補が変わらないこと、
+ * 途中で切れたバイト列や壊れたバイト列を読み込んだ場合に不正として空の履歴になることを確認します。
+ */
+#include "InputHistory.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/// @brief 候補の文字列の並びを返します。
+std::vector<std::wstring> SuggestTexts(CInputHistory &history, const wchar_t *pszPrefix, int nMaxCount)
+{
+    std::vector<int> results;
+    history.Suggest(pszPrefix, nMaxCount, results);
+    std::vector<std::wstring> texts;
+    for (int nEntry : results)
+    {
+        std::wstring text;
+        history.GetText(nEntry, text);
+        texts.push_back(text);
+    }
+    return texts;
+}
+
+/// @brief 'a'～'d' からなる短い語を指定数作ります (接頭辞を共有する語が多くなります)。
+std::vector<std::wstring> MakeWords(std::mt19937 &rng, int nCount)
+{
+    std::vector<std::wstring> words;
+    for (int i = 0; i < nCount; ++i)
+    {
+        std::wstring word;
+        const int nLength = 1 + static_cast<int>(rng() % 6);
+        for (int j = 0; j < nLength; ++j)
+            word.push_back(static_cast<wchar_t>(L'a' + rng() % 4));
+        words.push_back(word);
+    }
+    return words;
+}
+
+/// @brief 乱数の語を記録した履歴を作ります。
+void RecordRandom(CInputHistory &history, std::mt19937 &rng, const std::vector<std::wstring> &words, int nRecords)
+{
+    for (int i = 0; i < nRecords; ++i)
+        history.Record(words[rng() % words.size()].c_str());
+}
+}
+
+TEST_CASE(TopKMatchesBruteForce)
+{
+    std::mt19937 rng(1);
+    const std::vector<std::wstring> words = MakeWords(rng, 300);
+    CInputHistory history;
+    // 参照: 使うたびに 2^(確定の回数/半減期) を加算した点数 (log2 で比べます)
+    std::map<std::wstring, double> reference;
+    int nWrongCount = 0;
+    int nWrongOrder = 0;
+    for (int i = 1; i <= 5000; ++i)
+    {
+        const std::wstring &word = words[rng() % words.size()];
+        history.Record(word.c_str());
+        reference[word] += std::exp2(i / CInputHistory::HALF_LIFE_USES);
+        if (i % 25 != 0)
+            continue;
+
+        const std::wstring prefix = word.substr(0, rng() % (word.size() + 1));
+        const int nMaxCount = 1 + static_cast<int>(rng() % 6);
+        std::vector<double> expected;
+        for (const auto &item : reference)
+        {
+            if (item.first.size() > prefix.size() && item.first.compare(0, prefix.size(), prefix) == 0)
+                expected.push_back(std::log2(item.second));
+        }
+        std::sort(expected.rbegin(), expected.rend());
+        expected.resize((std::min)(expected.size(), static_cast<std::size_t>(nMaxCount)));
+
+        const std::vector<std::wstring> texts = SuggestTexts(history, prefix.c_str(), nMaxCount);
+        if (texts.size() != expected.size())
+        {
+            ++nWrongCount;
+            continue;
+        }
+        // 点数の並びが一致すれば順序は正しい (同点の入れ替わりは許します)
+        for (std::size_t k = 0; k < texts.size(); ++k)
+        {
+            if (std::fabs(std::log2(reference[texts[k]]) - expected[k]) > 1e-3 || texts[k] == prefix)
+                ++nWrongOrder;
+        }
+    }
+    CHECK_EQ(nWrongCount, 0);
+    CHECK_EQ(nWrongOrder, 0);
+}
+
+TEST_CASE(UseReordersSiblings)
+{
+    CInputHistory history;
+    history.Record(L"apple");
+    history.Record(L"apple");
+    history.Record(L"apple");
+    history.Record(L"apricot");
+    CHECK(SuggestTexts(history, L"ap", 5) == std::vector<std::wstring>({L"apple", L"apricot"}));
+    CHECK_EQ(history.GetUseCount(history.GetEntryCount() - 1), 1u);
+
+    // 使用が増えると部分木の最高点が上がり、兄弟の順序が入れ替わります
+    for (int i = 0; i < 4; ++i)
+        history.Record(L"apricot");
+    CHECK(SuggestTexts(history, L"ap", 5) == std::vector<std::wstring>({L"apricot", L"apple"}));
+    CHECK(SuggestTexts(history, L"a", 1) == std::vector<std::wstring>({L"apricot"}));
+
+    // 新しい使用ほど重みが大きく、古い10回より新しい1回が上位になります
+    history.Record(L"banana");
+    for (int i = 0; i < 10; ++i)
+        history.Record(L"band");
+    for (int i = 0; i < 2000; ++i)
+        history.Record((L"x" + std::to_wstring(i % 50)).c_str());
+    history.Record(L"banana");
+    CHECK(SuggestTexts(history, L"ban", 5) == std::vector<std::wstring>({L"banana", L"band"}));
+
+    // 接頭辞そのものは候補に含めず、空文字列は記録しません
+    CHECK(SuggestTexts(history, L"apple", 5).empty());
+    const int nEntries = history.GetEntryCount();
+    history.Record(L"");
+    CHECK_EQ(history.GetEntryCount(), nEntries);
+    CHECK(SuggestTexts(history, L"zzz", 5).empty());
+}
+
+TEST_CASE(SerializeRoundTrip)
+{
+    std::mt19937 rng(2);
+    const std::vector<std::wstring> words = MakeWords(rng, 500);
+    CInputHistory history;
+    RecordRandom(history, rng, words, 8000);
+    history.Record(L"日本語"); // ASCII 以外の文字
+
+    std::vector<unsigned char> data;
+    history.Serialize(data);
+    CInputHistory loaded;
+    std::size_t nPos = 0;
+    REQUIRE(loaded.Deserialize(data.data(), data.size(), nPos));
+    CHECK_EQ(nPos, data.size());
+    CHECK_EQ(loaded.GetEntryCount(), history.GetEntryCount());
+
+    int nDifferent = 0;
+    for (const std::wstring &word : words)
+    {
+        for (std::size_t n = 0; n <= word.size(); ++n)
+        {
+            if (SuggestTexts(history, word.substr(0, n).c_str(), 5) != SuggestTexts(loaded, word.substr(0, n).c_str(), 5))
+                ++nDifferent;
+        }
+    }
+    CHECK_EQ(nDifferent, 0);
+    CHECK(SuggestTexts(loaded, L"日", 1) == std::vector<std::wstring>({L"日本語"}));
+
+    // 読み込んだ履歴を書き出すと同じバイト列になり、続けて記録した結果も一致します
+    std::vector<unsigned char> again;
+    loaded.Serialize(again);
+    CHECK(again == data);
+    history.Record(words[0].c_str());
+    loaded.Record(words[0].c_str());
+    CHECK(SuggestTexts(history, L"", 10) == SuggestTexts(loaded, L"", 10));
+
+    // 複数の履歴を続けて書き出したバイト列は、先頭から順に読み込めます
+    CInputHistory small;
+    small.Record(L"one");
+    std::vector<unsigned char> pair;
+    small.Serialize(pair);
+    history.Serialize(pair);
+    CInputHistory first;
+    CInputHistory second;
+    nPos = 0;
+    CHECK(first.Deserialize(pair.data(), pair.size(), nPos));
+    CHECK(second.Deserialize(pair.data(), pair.size(), nPos));
+    CHECK_EQ(nPos, pair.size());
+    CHECK_EQ(first.GetEntryCount(), 1);
+    CHECK_EQ(second.GetEntryCount(), history.GetEntryCount());
+}
+
+TEST_CASE(TruncatedOrCorruptInputIsRejected)
+{
+    std::mt19937 rng(3);
+    const std::vector<std::wstring> words = MakeWords(rng, 200);
+    CInputHistory history;
+    RecordRandom(history, rng, words, 2000);
+    std::vector<unsigned char> data;
+    history.Serialize(data);
+
+    // どこで切れていても不正として扱い、履歴は空になります
+    int nAccepted = 0;
+    int nNotEmpty = 0;
+    for (std::size_t nSize = 0; nSize < data.size(); ++nSize)
+    {
+        CInputHistory loaded;
+        loaded.Record(L"old");
+        std::size_t nPos = 0;
+        if (loaded.Deserialize(data.data(), nSize, nPos))
+            ++nAccepted;
+        if (loaded.GetEntryCount() != 0)
+            ++nNotEmpty;
+    }
+    CHECK_EQ(nAccepted, 0);
+    CHECK_EQ(nNotEmpty, 0);
+
+    // 壊れたバイト列は、受け付けるか空になるかのどちらかで、範囲外を読みません
+    int nRejected = 0;
+    for (int nTrial = 0; nTrial < 2000; ++nTrial)
+    {
+        std::vector<unsigned char> corrupt = data;
+        for (int i = 0; i < 3; ++i)
+            corrupt[rng() % corrupt.size()] = static_cast<unsigned char>(rng());
+        CInputHistory loaded;
+        std::size_t nPos = 0;
+        if (!loaded.Deserialize(corrupt.data(), corrupt.size(), nPos))
+        {
+            ++nRejected;
+            CHECK_EQ(loaded.GetEntryCount(), 0);
+        }
+        else
+        {
+            CHECK(nPos <= corrupt.size());
+        }
+    }
+    std::printf("  corrupt inputs rejected: %d / 2000\n", nRejected);
+}
+
+TEST_CASE(StoreRoundTripKeepsFieldReferences)
+{
+    CInputHistoryStore store;
+    CInputHistory &name = store.GetField(L"name");
+    name.Record(L"hello");
+    name.Record(L"help");
+    store.GetField(L"value").Record(L"12.5");
+    std::vector<unsigned char> data;
+    store.Serialize(data);
+
+    CInputHistoryStore loaded;
+    CInputHistory &loadedName = loaded.GetField(L"name");
+    REQUIRE(loaded.Deserialize(data.data(), data.size()));
+    CHECK_EQ(loaded.GetFieldCount(), 2u);
+    CHECK(SuggestTexts(loadedName, L"hel", 5) == SuggestTexts(name, L"hel", 5));
+    CHECK(SuggestTexts(loaded.GetField(L"value"), L"1", 5) == std::vector<std::wstring>({L"12.5"}));
+
+    // 途中で切れたバイト列では全ての入力欄が空になりますが、取得済みの参照は有効なままです
+    int nAccepted = 0;
+    for (std::size_t nSize = 0; nSize < data.size(); ++nSize)
+    {
+        if (loaded.Deserialize(data.data(), nSize))
+            ++nAccepted;
+        if (loadedName.GetEntryCount() != 0)
+            ++nAccepted;
+    }
+    CHECK_EQ(nAccepted, 0);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,275 @@
+﻿/**
+ * @file InputTraceTest.cpp
+ * @brief CInputTrace のテスト
+ * @details リングバッファが容量を越えたときに古いイベントから上書きされること (ラップアラウンド) と、
+ * 書き出した Chrome トレースイベント形式が正しいJSONであり、スパンの開始・終了・区間が揃っていることを確認します。
+ */
+#include "InputTrace.h"
+#include "TestFramework.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/**
+ * @class CJsonValidator
+ * @brief JSONの構文だけを検証する最小限の再帰下降パーサー
+ */
+class CJsonValidator
+{
+public:
+    explicit CJsonValidator(const std::string &text)
+        : m_text(text), m_nPos(0)
+    {
+    }
+
+    /// @brief 文字列全体が1個のJSON値であればtrueを返します。
+    bool Validate()
+    {
+        if (!ParseValue())
+            return false;
+        SkipSpace();
+        return m_nPos == m_text.size();
+    }
+
+private:
+    void SkipSpace()
+    {
+        while (m_nPos < m_text.size() && (m_text[m_nPos] == ' ' || m_text[m_nPos] == '\n' || m_text[m_nPos] == '\r' || m_text[m_nPos] == '\t'))
+            ++m_nPos;
+    }
+    bool Consume(char ch)
+    {
+        SkipSpace();
+        if (m_nPos < m_text.size() && m_text[m_nPos] == ch)
+        {
+            ++m_nPos;
+            return true;
+        }
+        return false;
+    }
+    bool ParseValue()
+    {
+        SkipSpace();
+        if (m_nPos >= m_text.size())
+            return false;
+        const char ch = m_text[m_nPos];
+        if (ch == '{')
+            return ParseObject();
+        if (ch == '[')
+            return ParseArray();
+        if (ch == '"')
+            return ParseString();
+        if (ch == '-' || (ch >= '0' && ch <= '9'))
+            return ParseNumber();
+        for (const char *pszWord : {"true", "false", "null"})
+        {
+            if (m_text.compare(m_nPos, std::strlen(pszWord), pszWord) == 0)
+            {
+                m_nPos += std::strlen(pszWord);
+                return true;
+            }
+        }
+        return false;
+    }
+    bool ParseObject()
+    {
+        Consume('{');
+        if (Consume('}'))
+            return true;
+        do
+        {
+            SkipSpace();
+            if (!ParseString() || !Consume(':') || !ParseValue())
+                return false;
+        } while (Consume(','));
+        return Consume('}');
+    }
+    bool ParseArray()
+    {
+        Consume('[');
+        if (Consume(']'))
+            return true;
+        do
+        {
+            if (!ParseValue())
+                return false;
+        } while (Consume(','));
+        return Consume(']');
+    }
+    bool ParseString()
+    {
+        if (m_nPos >= m_text.size() || m_text[m_nPos] != '"')
+            return false;
+        for (++m_nPos; m_nPos < m_text.size(); ++m_nPos)
+        {
+            const unsigned char ch = static_cast<unsigned char>(m_text[m_nPos]);
+            if (ch == '"')
+            {
+                ++m_nPos;
+                return true;
+            }
+            if (ch < 0x20)
+                return false;
+            if (ch == '\\')
+            {
+                ++m_nPos;
+                if (m_nPos >= m_text.size())
+                    return false;
+                const char esc = m_text[m_nPos];
+                if (esc == 'u')
+                {
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        if (++m_nPos >= m_text.size() || !std::isxdigit(static_cast<unsigned char>(m_text[m_nPos])))
+                            return false;
+                    }
+                }
+                else if (std::strchr("\"\\/bfnrt", esc) == nullptr)
+                {
+                    return false;
+                }
+            }
+        }
+        return false;
+    }
+    bool ParseNumber()
+    {
+        const std::size_t nStart = m_nPos;
+        if (m_text[m_nPos] == '-')
+            ++m_nPos;
+        while (m_nPos < m_text.size() && (std::isdigit(static_cast<unsigned char>(m_text[m_nPos])) || m_text[m_nPos] == '.'))
+            ++m_nPos;
+        return m_nPos > nStart;
+    }
+
+    const std::string &m_text; ///< 検証する文字列
+    std::size_t m_nPos;        ///< 現在の読み取り位置
+};
+
+/// @brief 部分文字列の出現回数を返します。
+int CountOf(const std::string &text, const std::string &needle)
+{
+    int nCount = 0;
+    for (std::size_t p = text.find(needle); p != std::string::npos; p = text.find(needle, p + needle.size()))
+        ++nCount;
+    return nCount;
+}
+
+/**
+ * @brief "name":"<name>" のイベントの "dur" の値 (マイクロ秒の整数部) を全て取り出します。
+ */
+std::vector<long long> DurationsOf(const std::string &json, const std::string &name)
+{
+    std::vector<long long> durations;
+    const std::string key = "{\"name\":\"" + name + "\"";
+    for (std::size_t p = json.find(key); p != std::string::npos; p = json.find(key, p + 1))
+    {
+        const std::size_t nDur = json.find("\"dur\":", p);
+        if (nDur == std::string::npos)
+            break;
+        durations.push_back(std::atoll(json.c_str() + nDur + 6));
+    }
+    return durations;
+}
+}
+
+TEST_CASE(RingBufferKeepsNewestEventsAfterWrap)
+{
+    CInputTrace::SetEnabled(true);
+    CInputTrace::Clear();
+
+    // 専用のスレッドで容量を越えて記録します (所要時間 i マイクロ秒で各イベントを識別)
+    const int nTotal = CInputTrace::RING_CAPACITY * 2 + 123;
+    std::thread writer([nTotal]() {
+        CInputTrace::SetThreadName("writer");
+        for (int i = 0; i < nTotal; ++i)
+            CInputTrace::RecordComplete("wrap", CInputTrace::NowNs(), static_cast<std::uint64_t>(i) * 1000, 4);
+    });
+    writer.join();
+
+    const std::string json = CInputTrace::ToChromeJson();
+    CHECK(CJsonValidator(json).Validate());
+    const std::vector<long long> durations = DurationsOf(json, "wrap");
+    REQUIRE(static_cast<int>(durations.size()) == CInputTrace::RING_CAPACITY);
+    // 残っているのは最新の RING_CAPACITY 個で、記録順に並んでいます
+    for (int i = 0; i < CInputTrace::RING_CAPACITY; ++i)
+        CHECK_EQ(durations[i], static_cast<long long>(nTotal - CInputTrace::RING_CAPACITY + i));
+    CHECK_EQ(CountOf(json, "\"args\":{\"name\":\"writer\"}"), 1);
+
+    CInputTrace::Clear();
+    CHECK_EQ(CountOf(CInputTrace::ToChromeJson(), "\"wrap\""), 0);
+    CInputTrace::SetEnabled(false);
+}
+
+TEST_CASE(SpansExportAsAsyncEventsAndCompleteSlices)
+{
+    CInputTrace::SetEnabled(true);
+    CInputTrace::Clear();
+    CInputTrace::SetThreadName("UI");
+
+    const std::uint64_t nClick = CInputTrace::BeginInput(CInputTrace::INPUT_CLICK);
+    CHECK(nClick != 0);
+    CHECK_EQ(CInputTrace::GetCurrentSpan(), nClick);
+    {
+        CInputTraceScope scope("CMyDialog3::OnGridSelChanged");
+    }
+    {
+        CInputTraceScope scope("CGridCtrl::OnPaint", true);
+    }
+    CHECK_EQ(CInputTrace::GetCurrentSpan(), 0u);
+    {
+        // スパンが閉じた後の描画は記録されません
+        CInputTraceScope scope("CGridCtrl::OnPaint", true);
+    }
+    CInputTrace::BeginInput(CInputTrace::INPUT_KEY);
+    CInputTrace::BeginInput(CInputTrace::INPUT_TOUCH); // キーのスパンは描画前に置き換えられます
+    {
+        CInputTraceScope scope("quote\"back\\slash\ttab");
+    }
+
+    const std::string json = CInputTrace::ToChromeJson();
+    CHECK(CJsonValidator(json).Validate());
+    CHECK_EQ(json.compare(0, 15, "{\"displayTimeUn"), 0);
+    CHECK_EQ(CountOf(json, "\"ph\":\"b\""), 3);
+    CHECK_EQ(CountOf(json, "\"ph\":\"e\""), 2);
+    CHECK_EQ(CountOf(json, "\"ph\":\"X\""), 3);
+    CHECK_EQ(CountOf(json, "\"end\":\"CGridCtrl::OnPaint\""), 1);
+    CHECK_EQ(CountOf(json, "\"end\":\"superseded\""), 1);
+    CHECK_EQ(CountOf(json, "\"name\":\"CGridCtrl::OnPaint\""), 1);
+    CHECK_EQ(CountOf(json, "quote\\\"back\\\\slash\\u0009tab"), 1);
+    CHECK_EQ(CountOf(json, "\"args\":{\"name\":\"UI\"}"), 1);
+
+    CInputTrace::SetEnabled(false);
+    CHECK_EQ(CInputTrace::BeginInput(CInputTrace::INPUT_CLICK), 0u);
+}
+
+TEST_CASE(ExportWhileWritingStaysValid)
+{
+    CInputTrace::SetEnabled(true);
+    CInputTrace::Clear();
+    std::thread writer([]() {
+        for (int i = 0; i < 200000; ++i)
+            CInputTrace::RecordComplete("busy", CInputTrace::NowNs(), 1, 4);
+    });
+    int nInvalid = 0;
+    for (int i = 0; i < 20; ++i)
+    {
+        if (!CJsonValidator(CInputTrace::ToChromeJson()).Validate())
+            ++nInvalid;
+    }
+    writer.join();
+    CHECK_EQ(nInvalid, 0);
+    CHECK(CountOf(CInputTrace::ToChromeJson(), "\"busy\"") <= CInputTrace::RING_CAPACITY);
+    CInputTrace::SetEnabled(false);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
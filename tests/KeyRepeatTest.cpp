@@ -0,0 +1,145 @@
+﻿/**
+ * @file KeyRepeatTest.cpp
+ * @brief CKeyRepeat のテスト
+ * @details 時刻はテスト側の手動の時計から与え、最初の遅延・間隔の加速・最短間隔・大きな遅れの切り捨てを
+ * 期限の時刻まで含めて決定的に確認します。フレームタイマーの周期が揺らいでも、
+ * 期限どおりの回数だけ繰り返すことも確認します。
+ */
+#include "KeyRepeat.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+/**
+ * @class CManualClock
+ * @brief テストから進める時計 (ミリ秒)
+ */
+class CManualClock
+{
+public:
+    /// @brief 現在時刻を返します。
+    double Now() const { return m_dNowMs; }
+    /// @brief 時刻を進め、進めた後の時刻を返します。
+    double Advance(double dMs) { return m_dNowMs += dMs; }
+
+private:
+    double m_dNowMs = 1000.0; ///< 現在時刻 (0以外から始めます)
+};
+
+/// @brief 2つの時刻がほぼ等しいかを返します。
+bool Near(double a, double b)
+{
+    return std::fabs(a - b) < 1e-6;
+}
+}
+
+TEST_CASE(DelayThenAcceleratingIntervals)
+{
+    CManualClock clock;
+    CKeyRepeat repeat;
+    CHECK(!repeat.IsActive());
+    CHECK_EQ(repeat.Advance(clock.Now()), 0);
+
+    const double dPressMs = clock.Now();
+    repeat.Press(dPressMs);
+    CHECK(repeat.IsActive());
+    CHECK(Near(repeat.GetNextDueMs(), dPressMs + 400.0));
+    CHECK_EQ(repeat.Advance(clock.Advance(399.0)), 0);
+
+    // 期限の時刻ちょうどで1回ずつ進め、期限の並びを確認します: 400, +100, +85, +72.25, ... 最短25
+    std::vector<double> offsets;
+    for (int i = 0; i < 20; ++i)
+    {
+        const double dDueMs = repeat.GetNextDueMs();
+        offsets.push_back(dDueMs - dPressMs);
+        CHECK_EQ(repeat.Advance(dDueMs), 1);
+    }
+    CHECK(Near(offsets[0], 400.0));
+    CHECK(Near(offsets[1], 500.0));
+    CHECK(Near(offsets[2], 585.0));
+    CHECK(Near(offsets[3], 657.25));
+    double dInterval = 100.0;
+    int nWrong = 0;
+    for (std::size_t i = 1; i < offsets.size(); ++i)
+    {
+        if (!Near(offsets[i] - offsets[i - 1], dInterval))
+            ++nWrong;
+        dInterval = std::fmax(25.0, dInterval * 0.85);
+    }
+    CHECK_EQ(nWrong, 0);
+    CHECK(Near(offsets[19] - offsets[18], 25.0));
+    CHECK_EQ(repeat.GetRepeatCount(), 20);
+
+    repeat.Release();
+    CHECK(!repeat.IsActive());
+    CHECK_EQ(repeat.Advance(clock.Advance(10000.0)), 0);
+
+    // 押し直すと回数と間隔が初期値に戻ります
+    repeat.Press(clock.Now());
+    CHECK_EQ(repeat.GetRepeatCount(), 0);
+    CHECK_EQ(repeat.Advance(clock.Advance(500.0)), 2);
+}
+
+TEST_CASE(JitteredFrameTimerKeepsTheSchedule)
+{
+    // 1ms ごとに進めた場合 (理想) と、16ms ± 揺らぎのフレームタイマーで進めた場合の回数が一致します
+    std::mt19937 rng(2);
+    for (int nTrial = 0; nTrial < 100; ++nTrial)
+    {
+        const double dHoldMs = 500.0 + static_cast<double>(rng() % 3000);
+        CKeyRepeat ideal;
+        ideal.Press(0.0);
+        int nIdeal = 0;
+        for (double t = 1.0; t <= dHoldMs; t += 1.0)
+            nIdeal += ideal.Advance(t);
+
+        CManualClock clock;
+        const double dStart = clock.Now();
+        CKeyRepeat repeat;
+        repeat.Press(dStart);
+        int nTimer = 0;
+        while (clock.Now() - dStart < dHoldMs)
+        {
+            const double dStep = (std::min)(CKeyRepeat::FRAME_INTERVAL_MS + static_cast<double>(rng() % 17),
+                                            dHoldMs - (clock.Now() - dStart));
+            nTimer += repeat.Advance(clock.Advance(dStep));
+        }
+        CHECK_EQ(nTimer, nIdeal);
+    }
+}
+
+TEST_CASE(StallIsCappedAndRescheduled)
+{
+    CManualClock clock;
+    CKeyRepeat repeat;
+    repeat.Press(clock.Now());
+    // 5秒止まった後の Advance() は nMaxCatchUp 回で打ち切り、次の期限は現在時刻から数え直します
+    const double dNow = clock.Advance(5000.0);
+    CHECK_EQ(repeat.Advance(dNow), repeat.GetParams().nMaxCatchUp);
+    CHECK(repeat.GetNextDueMs() > dNow);
+    CHECK(repeat.GetNextDueMs() <= dNow + 100.0);
+    CHECK_EQ(repeat.Advance(dNow), 0);
+
+    // 加速なし・最短間隔より短い間隔の指定は最短間隔に丸められます
+    CKeyRepeat::Params params;
+    params.dDelayMs = 200.0;
+    params.dIntervalMs = 10.0;
+    params.dMinIntervalMs = 50.0;
+    params.dAcceleration = 1.0;
+    repeat.SetParams(params);
+    repeat.Press(0.0);
+    CHECK_EQ(repeat.Advance(199.0), 0);
+    CHECK_EQ(repeat.Advance(200.0), 1);
+    CHECK_EQ(repeat.Advance(349.0), 2);
+    CHECK(Near(repeat.GetNextDueMs(), 350.0));
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,102 @@
+﻿/**
+ * @file KeyboardLayoutTest.cpp
+ * @brief コンパイル済みのキーボードレイアウトのテスト
+ * @details キーの矩形の重なりとキーIDの連番はコンパイル時にも検査していますが (KeyboardLayout.cpp の static_assert)、
+ * ここでは公開されている検索関数 (FindKeyById / FindKeyByVirtKey) と CKeyboardSurface::HitTest が、
+ * 全てのレイアウトで矩形から総当たりで求めた結果と一致することを確認します。
+ */
+#include "KeyboardLayout.h"
+#include "KeyboardSurface.h"
+#include "TestFramework.h"
+
+namespace
+{
+/// @brief 座標を含むキーを総当たりで求めます。
+int BruteForceHitTest(const KEYBOARD_LAYOUT &layout, int x, int y)
+{
+    for (int i = 0; i < layout.nKeyCount; ++i)
+    {
+        const KEYBOARD_RECT &rc = layout.pRects[i];
+        if (x >= rc.left && x < rc.right && y >= rc.top && y < rc.bottom)
+            return i;
+    }
+    return -1;
+}
+}
+
+TEST_CASE(LookupByIdAndVirtKey)
+{
+    for (int nLayout = 0; nLayout < KEYBOARD_LAYOUT_COUNT; ++nLayout)
+    {
+        const KEYBOARD_LAYOUT &layout = GetKeyboardLayout(static_cast<EKeyboardLayout>(nLayout));
+        REQUIRE(layout.nKeyCount > 0 && layout.nKeyCount <= KEYBOARD_MAX_KEYS);
+        int nWrong = 0;
+        for (int i = 0; i < layout.nKeyCount; ++i)
+        {
+            if (FindKeyById(layout, layout.pInfos[i].uId) != i || layout.pInfos[i].uId != IDC_KEY_BASE + static_cast<unsigned>(i))
+                ++nWrong;
+            if (layout.pInfos[i].bVirtKey != 0 && FindKeyByVirtKey(layout, layout.pInfos[i].bVirtKey) != i)
+                ++nWrong;
+        }
+        CHECK_EQ(nWrong, 0);
+        CHECK_EQ(FindKeyById(layout, IDC_KEY_BASE + layout.nKeyCount), -1);
+        CHECK_EQ(FindKeyById(layout, IDC_KEY_BASE - 1), -1);
+        CHECK_EQ(FindKeyByVirtKey(layout, 0), -1);
+    }
+    // 範囲外のレイアウトはUS配列
+    CHECK(&GetKeyboardLayout(static_cast<EKeyboardLayout>(KEYBOARD_LAYOUT_COUNT)) == &GetKeyboardLayout(KEYBOARD_LAYOUT_US));
+}
+
+TEST_CASE(KeyRectsDoNotOverlapAndFitExtent)
+{
+    int nMaxWidth = 0;
+    int nMaxHeight = 0;
+    GetKeyboardLayoutExtent(nMaxWidth, nMaxHeight);
+    for (int nLayout = 0; nLayout < KEYBOARD_LAYOUT_COUNT; ++nLayout)
+    {
+        const KEYBOARD_LAYOUT &layout = GetKeyboardLayout(static_cast<EKeyboardLayout>(nLayout));
+        CHECK(layout.nWidth <= nMaxWidth && layout.nHeight <= nMaxHeight);
+        int nOverlaps = 0;
+        int nOutside = 0;
+        for (int i = 0; i < layout.nKeyCount; ++i)
+        {
+            const KEYBOARD_RECT &a = layout.pRects[i];
+            if (a.left < 0 || a.top < KEYBOARD_TITLE_BAR_HEIGHT || a.right > layout.nWidth || a.bottom > layout.nHeight)
+                ++nOutside;
+            for (int j = i + 1; j < layout.nKeyCount; ++j)
+            {
+                const KEYBOARD_RECT &b = layout.pRects[j];
+                if (a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom)
+                    ++nOverlaps;
+            }
+        }
+        CHECK_EQ(nOverlaps, 0);
+        CHECK_EQ(nOutside, 0);
+    }
+}
+
+TEST_CASE(HitTestMatchesRectsEverywhere)
+{
+    for (int nLayout = 0; nLayout < KEYBOARD_LAYOUT_COUNT; ++nLayout)
+    {
+        const KEYBOARD_LAYOUT &layout = GetKeyboardLayout(static_cast<EKeyboardLayout>(nLayout));
+        CKeyboardSurface surface;
+        surface.SetLayout(layout);
+        // 描画面の外側2ピクセルまで含めて全ピクセルを比べます (隙間とタイトルバーは-1)
+        int nMismatches = 0;
+        for (int y = -2; y < layout.nHeight + 2; ++y)
+        {
+            for (int x = -2; x < layout.nWidth + 2; ++x)
+            {
+                if (surface.HitTest(x, y) != BruteForceHitTest(layout, x, y))
+                    ++nMismatches;
+            }
+        }
+        CHECK_EQ(nMismatches, 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,193 @@
+﻿/**
+ * @file KeyboardRenderTest.cpp
+ * @brief CKeyboardPainter と CKeyboardSurface による1枚の描画面への描画のテスト
+ * @details キーボードを CSoftwareRenderTarget に描画し、通常のキーと ON 状態 (押下中の修飾キー) のキーの
+ * 背景色・文字色・枠線の色をピクセルで確認します。修飾キーを切り替えたときに描き直したキーの数を表示し、
+ * 変わったキーだけを描き直した結果が、全体を描き直した結果とピクセル単位で一致することを確認します。
+ */
+#include "KeyboardLayout.h"
+#include "KeyboardPainter.h"
+#include "KeyboardSurface.h"
+#include "RenderTarget.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+/// @brief KeyboardPainter.cpp と同じ色
+const RenderColor CLR_KEY_BLUE = RenderRgb(0, 102, 204);
+const RenderColor CLR_KEY_GRAY = RenderRgb(240, 240, 240);
+const RenderColor CLR_KEY_BORDER = RenderRgb(173, 173, 173);
+const RenderColor CLR_TEXT_BLACK = RenderRgb(0, 0, 0);
+const RenderColor CLR_TEXT_WHITE = RenderRgb(255, 255, 255);
+
+/// @brief 描画面の背景 (キーの隙間) の色
+const RenderColor COLOR_FACE = RenderRgb(200, 200, 200);
+
+/// @brief 枠と、指定した修飾キーの状態の全てのキーを新しい描画先に描画します。
+void RenderAll(CSoftwareRenderTarget &target, CKeyboardSurface &surface, unsigned nModifiers)
+{
+    const REGION_RECT rcClient = {0, 0, surface.GetWidth(), surface.GetHeight()};
+    const REGION_RECT rcTitleBar = {0, 0, surface.GetWidth(), KEYBOARD_TITLE_BAR_HEIGHT};
+    const REGION_RECT rcCloseBtn = {surface.GetWidth() - 32, 2, surface.GetWidth() - 2, 32};
+    CKeyboardPainter::RenderFrame(target, rcClient, rcTitleBar, rcCloseBtn, COLOR_FACE);
+    surface.InvalidateAll();
+    std::vector<int> dirty;
+    surface.SetModifiers(nModifiers, dirty);
+    for (int nIndex : dirty)
+        CKeyboardPainter::RenderKey(target, surface, nIndex);
+}
+
+/// @brief キーの矩形の中に指定色のピクセルがあるかを返します (枠線を除く)。
+bool HasColorInside(const CSoftwareRenderTarget &target, const KEYBOARD_RECT &rc, RenderColor color)
+{
+    for (int y = rc.top + 1; y < rc.bottom - 1; ++y)
+    {
+        for (int x = rc.left + 1; x < rc.right - 1; ++x)
+        {
+            if (target.GetPixel(x, y) == color)
+                return true;
+        }
+    }
+    return false;
+}
+
+/// @brief 空白以外の文字を含むかを返します (スペースキーのラベルは空白のみ)。
+bool HasVisibleText(const wchar_t *pszText)
+{
+    for (; pszText != nullptr && *pszText != L'\0'; ++pszText)
+    {
+        if (*pszText != L' ')
+            return true;
+    }
+    return false;
+}
+
+/// @brief 指定した修飾キーのビットを持つキーの番号を返します。
+std::vector<int> FindModifierKeys(const CKeyboardSurface &surface, unsigned nModifier)
+{
+    std::vector<int> keys;
+    for (int i = 0; i < surface.GetKeyCount(); ++i)
+    {
+        if (surface.GetKey(i).nModifier == nModifier)
+            keys.push_back(i);
+    }
+    return keys;
+}
+
+/**
+ * @brief キーの描画状態を確認します。
+ * @details 左上の角は枠線の色、枠線の内側の左下の隅 (ラベルの外) は背景色です。
+ * ON 状態のキーは青地に白、通常のキーは灰色地に黒の文字が含まれます (ラベルが空白のキーは文字を含みません)。
+ */
+int CountWrongKeys(const CSoftwareRenderTarget &target, const CKeyboardSurface &surface)
+{
+    int nWrong = 0;
+    for (int i = 0; i < surface.GetKeyCount(); ++i)
+    {
+        const KEYBOARD_RECT &rc = surface.GetKeyRect(i);
+        const bool bOn = surface.GetFace(i).bOn;
+        const RenderColor background = bOn ? CLR_KEY_BLUE : CLR_KEY_GRAY;
+        const RenderColor text = bOn ? CLR_TEXT_WHITE : CLR_TEXT_BLACK;
+        const bool bHasText = HasVisibleText(surface.GetFace(i).pszMain);
+        if (target.GetPixel(rc.left, rc.top) != CLR_KEY_BORDER || target.GetPixel(rc.left + 1, rc.bottom - 2) != background ||
+            HasColorInside(target, rc, text) != bHasText || HasColorInside(target, rc, bOn ? CLR_KEY_GRAY : CLR_KEY_BLUE))
+        {
+            std::printf("  key %d (%ls) drawn wrong, on=%d\n", i, surface.GetKey(i).pszLabel, bOn ? 1 : 0);
+            ++nWrong;
+        }
+    }
+    return nWrong;
+}
+}
+
+TEST_CASE(NormalAndOnKeysUseTheirColors)
+{
+    for (int nLayout = 0; nLayout < KEYBOARD_LAYOUT_COUNT; ++nLayout)
+    {
+        CKeyboardSurface surface;
+        surface.SetLayout(GetKeyboardLayout(static_cast<EKeyboardLayout>(nLayout)));
+        CSoftwareRenderTarget target(surface.GetWidth(), surface.GetHeight());
+        RenderAll(target, surface, 0);
+        CHECK_EQ(CountWrongKeys(target, surface), 0);
+        // キーの隙間は背景色のまま
+        const KEYBOARD_RECT &rc = surface.GetKeyRect(0);
+        CHECK_EQ(target.GetPixel(rc.right, rc.top + 2), COLOR_FACE);
+    }
+}
+
+TEST_CASE(ModifierOnKeysAreDrawnPressed)
+{
+    CKeyboardSurface surface;
+    surface.SetLayout(GetKeyboardLayout(KEYBOARD_LAYOUT_US));
+    const std::vector<int> shiftKeys = FindModifierKeys(surface, CKeyboardSurface::MOD_SHIFT);
+    const std::vector<int> capsKeys = FindModifierKeys(surface, CKeyboardSurface::MOD_CAPS);
+    REQUIRE(!shiftKeys.empty() && !capsKeys.empty());
+
+    CSoftwareRenderTarget target(surface.GetWidth(), surface.GetHeight());
+    RenderAll(target, surface, CKeyboardSurface::MOD_SHIFT | CKeyboardSurface::MOD_CAPS);
+    CHECK_EQ(CountWrongKeys(target, surface), 0);
+    int nOn = 0;
+    for (int i = 0; i < surface.GetKeyCount(); ++i)
+    {
+        if (surface.GetFace(i).bOn)
+            ++nOn;
+    }
+    CHECK_EQ(nOn, static_cast<int>(shiftKeys.size() + capsKeys.size()));
+    for (int nKey : shiftKeys)
+        CHECK(surface.GetFace(nKey).bOn);
+    CHECK(HasColorInside(target, surface.GetKeyRect(shiftKeys[0]), CLR_TEXT_WHITE));
+}
+
+TEST_CASE(IncrementalRedrawMatchesFullRedraw)
+{
+    CKeyboardSurface surface;
+    surface.SetLayout(GetKeyboardLayout(KEYBOARD_LAYOUT_US));
+    CSoftwareRenderTarget incremental(surface.GetWidth(), surface.GetHeight());
+    RenderAll(incremental, surface, 0);
+
+    struct STEP
+    {
+        const char *pszName;
+        unsigned nModifiers;
+    };
+    const STEP steps[] = {
+        {"Shift on", CKeyboardSurface::MOD_SHIFT},
+        {"Shift off", 0},
+        {"Caps on", CKeyboardSurface::MOD_CAPS},
+        {"Caps+Shift", CKeyboardSurface::MOD_CAPS | CKeyboardSurface::MOD_SHIFT},
+        {"Shift off", CKeyboardSurface::MOD_CAPS},
+        {"Caps off", 0},
+        {"Ctrl on", CKeyboardSurface::MOD_CTRL},
+        {"Ctrl+Alt", CKeyboardSurface::MOD_CTRL | CKeyboardSurface::MOD_ALT},
+        {"all off", 0},
+        {"same again", 0},
+    };
+    std::vector<int> dirty;
+    for (const STEP &step : steps)
+    {
+        // 変わったキーだけを描き直します
+        surface.SetModifiers(step.nModifiers, dirty);
+        for (int nIndex : dirty)
+            CKeyboardPainter::RenderKey(incremental, surface, nIndex);
+        std::printf("  %-12s redrawn %2zu of %d keys\n", step.pszName, dirty.size(), surface.GetKeyCount());
+        CHECK(static_cast<int>(dirty.size()) < surface.GetKeyCount());
+
+        // 同じ状態を最初から全て描いた結果と一致します
+        CKeyboardSurface fresh;
+        fresh.SetLayout(GetKeyboardLayout(KEYBOARD_LAYOUT_US));
+        CSoftwareRenderTarget full(fresh.GetWidth(), fresh.GetHeight());
+        RenderAll(full, fresh, step.nModifiers);
+        CHECK_EQ(incremental.GetChecksum(), full.GetChecksum());
+        CHECK_EQ(CountWrongKeys(incremental, surface), 0);
+    }
+    // 同じ状態の再設定では何も描き直しません
+    CHECK(dirty.empty());
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
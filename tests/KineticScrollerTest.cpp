@@ -0,0 +1,224 @@
+﻿/**
+ * @file KineticScrollerTest.cpp
+ * @brief CKineticScroller のテスト
+ * @details 時刻は固定周期 (16ms) で進める決定的な時計を使い、フリングとホイール追従が
+ * 範囲や目標を越えずに (行き過ぎなしで) 有限のフレーム数で停止することを確認します。
+ * Advance() 1回の計算時間がフレーム予算に対して十分小さいことも確認します。
+ */
+#include "KineticScroller.h"
+#include "TestFramework.h"
+
+#include <cmath>
+
+namespace
+{
+/**
+ * @class CFixedClock
+ * @brief 呼び出しごとに一定時間だけ進む時計
+ */
+class CFixedClock
+{
+public:
+    explicit CFixedClock(double dStepMs = CKineticScroller::FRAME_INTERVAL_MS)
+        : m_dNow(1000.0), m_dStep(dStepMs)
+    {
+    }
+    double Now() const { return m_dNow; }
+    double Tick() { return m_dNow += m_dStep; }
+
+private:
+    double m_dNow;  ///< 現在時刻 (ミリ秒)
+    double m_dStep; ///< 1フレームの時間 (ミリ秒)
+};
+
+/**
+ * @brief 一定速度でドラッグして離し、フリングを開始させます。
+ * @param[in] dVelocity ポインタの速度 (ピクセル/ミリ秒、正で下向き)
+ */
+void Flick(CKineticScroller &scroller, CFixedClock &clock, double dVelocity)
+{
+    double dCoord = 500.0;
+    scroller.BeginDrag(clock.Now(), dCoord);
+    for (int i = 0; i < 6; ++i)
+    {
+        dCoord += dVelocity * CKineticScroller::FRAME_INTERVAL_MS;
+        scroller.DragTo(clock.Tick(), dCoord);
+    }
+    scroller.EndDrag(clock.Now());
+}
+
+/**
+ * @brief フリングが停止するまでの理論上のフレーム数を返します (v0 e^(-t/τ) < 停止速度)。
+ */
+int ExpectedFlingFrames(const CKineticScroller::Params &params, double dVelocity)
+{
+    const double dMs = params.dDecelTimeMs * std::log(std::fabs(dVelocity) / params.dStopVelocity);
+    return static_cast<int>(std::ceil(dMs / CKineticScroller::FRAME_INTERVAL_MS)) + 1;
+}
+}
+
+TEST_CASE(FlingSettlesWithoutOvershoot)
+{
+    CKineticScroller scroller;
+    scroller.SetRange(100000.0);
+    scroller.SetPosition(50000.0);
+    CFixedClock clock;
+
+    // 上方向のフリック (ポインタが上へ動くと位置は増加します)
+    Flick(scroller, clock, -2.0);
+    REQUIRE(scroller.GetMode() == CKineticScroller::MODE_FLING);
+    const double v0 = scroller.GetVelocity();
+    CHECK(std::fabs(v0 - 2.0) < 0.05);
+
+    // 解析解の到達位置 p0 + v0 τ を越えず、単調に増加します
+    const double dStart = scroller.GetPosition();
+    const double dLimit = dStart + v0 * scroller.GetParams().dDecelTimeMs;
+    const int nBudget = ExpectedFlingFrames(scroller.GetParams(), v0);
+    double dPrev = dStart;
+    int nFrames = 0;
+    while (scroller.Advance(clock.Tick()))
+    {
+        ++nFrames;
+        CHECK(scroller.GetPosition() >= dPrev);
+        CHECK(scroller.GetPosition() <= dLimit);
+        dPrev = scroller.GetPosition();
+        REQUIRE(nFrames <= nBudget);
+    }
+    CHECK(nFrames + 1 <= nBudget);
+    CHECK(scroller.GetMode() == CKineticScroller::MODE_IDLE);
+    CHECK_EQ(scroller.GetVelocity(), 0.0);
+    // 停止時点で残りの移動量は停止速度 × τ 未満です
+    CHECK(dLimit - scroller.GetPosition() < scroller.GetParams().dStopVelocity * scroller.GetParams().dDecelTimeMs);
+}
+
+TEST_CASE(FlingClampsAtRangeEnd)
+{
+    CKineticScroller scroller;
+    scroller.SetRange(300.0);
+    scroller.SetPosition(100.0);
+    CFixedClock clock;
+
+    // 離した時点で約196、到達位置 196 + 1.0 × 325 は範囲外
+    Flick(scroller, clock, -1.0);
+    REQUIRE(scroller.GetMode() == CKineticScroller::MODE_FLING);
+
+    int nFrames = 0;
+    while (scroller.Advance(clock.Tick()))
+    {
+        CHECK(scroller.GetPosition() <= 300.0);
+        REQUIRE(++nFrames < 100);
+    }
+    CHECK_EQ(scroller.GetPosition(), 300.0);
+    CHECK(scroller.GetMode() == CKineticScroller::MODE_IDLE);
+
+    // 端に張り付いた状態で同じ方向にフリックしてもフリングしません
+    Flick(scroller, clock, -2.0);
+    CHECK(scroller.GetMode() == CKineticScroller::MODE_IDLE);
+    CHECK_EQ(scroller.GetPosition(), 300.0);
+}
+
+TEST_CASE(FlingVelocityIsCapped)
+{
+    CKineticScroller scroller;
+    scroller.SetRange(1e6);
+    scroller.SetPosition(5e5);
+    CFixedClock clock;
+    Flick(scroller, clock, 20.0);
+    REQUIRE(scroller.GetMode() == CKineticScroller::MODE_FLING);
+    CHECK_EQ(scroller.GetVelocity(), -scroller.GetParams().dMaxFlingVelocity);
+}
+
+TEST_CASE(SlowReleaseDoesNotFling)
+{
+    CKineticScroller scroller;
+    scroller.SetRange(1000.0);
+    scroller.SetPosition(500.0);
+    CFixedClock clock;
+    Flick(scroller, clock, -0.01);
+    CHECK(scroller.GetMode() == CKineticScroller::MODE_IDLE);
+    CHECK(!scroller.Advance(clock.Tick()));
+}
+
+TEST_CASE(FramePacingDoesNotChangeTrajectory)
+{
+    // 16ms 周期と不規則な周期で進めても、同じ時刻には同じ位置になります
+    CKineticScroller a;
+    CKineticScroller b;
+    for (CKineticScroller *p : {&a, &b})
+    {
+        p->SetRange(100000.0);
+        p->SetPosition(1000.0);
+    }
+    CFixedClock clockA;
+    CFixedClock clockB;
+    Flick(a, clockA, -3.0);
+    Flick(b, clockB, -3.0);
+
+    const double steps[] = {3.0, 29.0, 16.0, 1.0, 40.0, 7.0};
+    double dTime = clockB.Now();
+    for (int i = 0; i < 30; ++i)
+    {
+        dTime += steps[i % 6];
+        b.Advance(dTime);
+    }
+    a.Advance(dTime);
+    CHECK(std::fabs(a.GetPosition() - b.GetPosition()) < 1e-9);
+}
+
+TEST_CASE(WheelConvergesMonotonicallyToTarget)
+{
+    CKineticScroller scroller;
+    scroller.SetRange(5000.0);
+    scroller.SetPosition(1000.0);
+    CFixedClock clock;
+
+    // 下方向に3ノッチ (1ノッチ 40px) → 目標は 1120
+    for (int i = 0; i < 3; ++i)
+        scroller.AddWheelDelta(clock.Now(), -CKineticScroller::WHEEL_NOTCH, 40.0);
+    REQUIRE(scroller.GetMode() == CKineticScroller::MODE_WHEEL);
+
+    double dPrev = scroller.GetPosition();
+    int nFrames = 0;
+    while (scroller.Advance(clock.Tick()))
+    {
+        CHECK(scroller.GetPosition() >= dPrev);
+        CHECK(scroller.GetPosition() <= 1120.0);
+        dPrev = scroller.GetPosition();
+        REQUIRE(++nFrames < 60);
+    }
+    CHECK_EQ(scroller.GetPosition(), 1120.0);
+    // τw = 50ms で 120px が 0.5px 未満になるまで約 274ms (18フレーム)
+    CHECK(nFrames <= 18);
+
+    // 高分解能ホイールの端数も蓄積されます
+    for (int i = 0; i < 4; ++i)
+        scroller.AddWheelDelta(clock.Now(), 30, 40.0);
+    while (scroller.Advance(clock.Tick()))
+    {
+    }
+    CHECK_EQ(scroller.GetPosition(), 1080.0);
+
+    // 範囲外への入力は端でクランプされます
+    scroller.AddWheelDelta(clock.Now(), 100 * CKineticScroller::WHEEL_NOTCH, 40.0);
+    while (scroller.Advance(clock.Tick()))
+        CHECK(scroller.GetPosition() >= 0.0);
+    CHECK_EQ(scroller.GetPosition(), 0.0);
+}
+
+TEST_CASE(AdvanceFitsFrameBudget)
+{
+    // 1フレーム (16ms) の中で Advance() が占める時間は無視できる程度 (1%未満) であること
+    CKineticScroller scroller;
+    scroller.SetRange(1e12);
+    scroller.SetPosition(0.0);
+    CFixedClock clock(0.001);
+    Flick(scroller, clock, -8.0);
+    const double dNs = TestFramework::MeasureNsPerOp(100000, 3, [&]() { scroller.Advance(clock.Tick()); });
+    std::printf("  Advance: %.1f ns/frame\n", dNs);
+    CHECK(dNs < CKineticScroller::FRAME_INTERVAL_MS * 1e6 * 0.01);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,236 @@
+﻿/**
+ * @file LayerCompositorTest.cpp
+ * @brief CLayerCompositor のテスト
+ * @details 塗ったピクセルを記録する偽のレイヤーで Compose() を実行し、無効領域のうちレイヤーが覆うピクセルを
+ * ちょうど1回ずつ、一番上の表示中のレイヤーで塗ること (オーバードロー率1.0) と、
+ * COMPOSITOR_FRAME_STATS の面積が実際に塗ったピクセル数と一致することを確認します。
+ * 隠れた部分も描画した場合の面積 (比較用) は、各レイヤーの矩形と無効領域の共通部分を塗って数えた値と比べます。
+ */
+#include "LayerCompositor.h"
+#include "TestFramework.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+/// @brief 合成先の大きさ
+const int WIDTH = 64;
+const int HEIGHT = 48;
+
+/**
+ * @class CFakeCanvas
+ * @brief レイヤーが塗ったピクセルの回数と、最後に塗ったレイヤーを記録する合成先
+ */
+class CFakeCanvas
+{
+public:
+    CFakeCanvas() : m_counts(WIDTH * HEIGHT, 0), m_owners(WIDTH * HEIGHT, CLayerCompositor::INVALID_LAYER) {}
+
+    /// @brief Compose() に渡す描画関数を返します。
+    CLayerCompositor::PaintFunc Painter()
+    {
+        return [this](CLayerCompositor::LayerId nLayer, const CRectRegion &clip) {
+            ++m_nPaintCalls;
+            std::vector<REGION_RECT> rects;
+            clip.GetRects(rects);
+            for (const REGION_RECT &rect : rects)
+            {
+                for (int y = rect.top; y < rect.bottom; ++y)
+                {
+                    for (int x = rect.left; x < rect.right; ++x)
+                    {
+                        ++m_counts[y * WIDTH + x];
+                        m_owners[y * WIDTH + x] = nLayer;
+                    }
+                }
+            }
+        };
+    }
+
+    /// @brief 塗った回数
+    int Count(int x, int y) const { return m_counts[y * WIDTH + x]; }
+    /// @brief 最後に塗ったレイヤー
+    CLayerCompositor::LayerId Owner(int x, int y) const { return m_owners[y * WIDTH + x]; }
+    /// @brief 描画関数を呼び出した回数
+    int GetPaintCalls() const { return m_nPaintCalls; }
+
+    /// @brief 塗った回数の合計
+    std::uint64_t TotalPainted() const
+    {
+        std::uint64_t nTotal = 0;
+        for (int nCount : m_counts)
+            nTotal += static_cast<std::uint64_t>(nCount);
+        return nTotal;
+    }
+
+private:
+    std::vector<int> m_counts;                       ///< ピクセルごとの塗った回数
+    std::vector<CLayerCompositor::LayerId> m_owners; ///< ピクセルごとの最後に塗ったレイヤー
+    int m_nPaintCalls = 0;                           ///< 描画関数を呼び出した回数
+};
+
+/// @brief 偽のレイヤー (テスト側で持つ正解の計算用)
+struct FAKE_LAYER
+{
+    CLayerCompositor::LayerId nId; ///< 識別子
+    REGION_RECT rect;              ///< 矩形
+    int nZOrder;                   ///< 重なり順
+    int nOrder;                    ///< 追加した順
+    bool bVisible;                 ///< 表示中か
+};
+
+/// @brief 点を含むかを返します。
+bool Contains(const REGION_RECT &rect, int x, int y)
+{
+    return x >= rect.left && x < rect.right && y >= rect.top && y < rect.bottom;
+}
+
+/// @brief 点を覆う一番上の表示中のレイヤーを返します (なければ INVALID_LAYER)。
+CLayerCompositor::LayerId TopLayerAt(const std::vector<FAKE_LAYER> &layers, int x, int y)
+{
+    const FAKE_LAYER *pTop = nullptr;
+    for (const FAKE_LAYER &layer : layers)
+    {
+        if (!layer.bVisible || !Contains(layer.rect, x, y))
+            continue;
+        if (pTop == nullptr || layer.nZOrder > pTop->nZOrder || (layer.nZOrder == pTop->nZOrder && layer.nOrder > pTop->nOrder))
+            pTop = &layer;
+    }
+    return pTop != nullptr ? pTop->nId : CLayerCompositor::INVALID_LAYER;
+}
+
+/// @brief 合成先に収まる乱数の矩形を返します。
+REGION_RECT RandomRect(std::mt19937 &rng)
+{
+    const int nLeft = static_cast<int>(rng() % (WIDTH - 8));
+    const int nTop = static_cast<int>(rng() % (HEIGHT - 8));
+    return REGION_RECT{nLeft, nTop, nLeft + 1 + static_cast<int>(rng() % (WIDTH - nLeft)),
+                       nTop + 1 + static_cast<int>(rng() % (HEIGHT - nTop))};
+}
+}
+
+TEST_CASE(OverlappingViewsPaintEachPixelOnce)
+{
+    // CMFCApplication4Dlg と同じ配置: CView1 が CView2 の左半分を覆います
+    CLayerCompositor compositor;
+    const CLayerCompositor::LayerId nView2 = compositor.AddLayer(REGION_RECT{75, 0, 225, 150}, 0);
+    const CLayerCompositor::LayerId nView1 = compositor.AddLayer(REGION_RECT{0, 0, 150, 150}, 1);
+    CLayerCompositor::ResetTotals();
+
+    // 全体を無効にすると、各ビューは見える部分だけを1回ずつ塗ります
+    compositor.InvalidateRect(REGION_RECT{0, 0, 225, 150});
+    std::vector<CLayerCompositor::LayerId> painted;
+    std::uint64_t nPainted = 0;
+    const COMPOSITOR_FRAME_STATS stats = compositor.Compose([&](CLayerCompositor::LayerId nLayer, const CRectRegion &clip) {
+        painted.push_back(nLayer);
+        nPainted += clip.GetArea();
+    });
+    CHECK(painted == (std::vector<CLayerCompositor::LayerId>{nView2, nView1}));
+    CHECK_EQ(stats.nLayersPainted, 2u);
+    CHECK_EQ(stats.nDirtyArea, 225u * 150u);
+    CHECK_EQ(stats.nPaintedArea, nPainted);
+    CHECK_EQ(stats.nPaintedArea, 225u * 150u);
+    CHECK_EQ(stats.nNaiveArea, 2u * 150u * 150u);
+    CHECK(stats.GetOverdraw() == 1.0);
+    CHECK(stats.GetNaiveOverdraw() == 300.0 / 225.0);
+    CHECK(compositor.GetDirtyRegion().IsEmpty());
+
+    // 隠れた部分だけを無効にしても、CView2 は描画しません
+    compositor.InvalidateRect(REGION_RECT{80, 10, 140, 20});
+    painted.clear();
+    const COMPOSITOR_FRAME_STATS hidden = compositor.Compose([&](CLayerCompositor::LayerId nLayer, const CRectRegion &) {
+        painted.push_back(nLayer);
+    });
+    CHECK(painted == (std::vector<CLayerCompositor::LayerId>{nView1}));
+    CHECK_EQ(hidden.nPaintedArea, 60u * 10u);
+    CHECK_EQ(hidden.nNaiveArea, 2u * 60u * 10u);
+
+    // 無効領域がなければ何も描画しません
+    const COMPOSITOR_FRAME_STATS idle = compositor.Compose([&](CLayerCompositor::LayerId, const CRectRegion &) { CHECK(false); });
+    CHECK_EQ(idle.nLayersPainted, 0u);
+    CHECK(idle.GetOverdraw() == 0.0);
+
+    const CLayerCompositor::Totals totals = CLayerCompositor::GetTotals();
+    CHECK_EQ(totals.nFrames, 3u);
+    CHECK_EQ(totals.nDirtyArea, 225u * 150u + 600u);
+    CHECK_EQ(totals.nPaintedArea, totals.nDirtyArea);
+    CHECK(CLayerCompositor::FormatStats().find("overdraw=1.000") != std::string::npos);
+}
+
+TEST_CASE(RandomLayersMatchPixelModel)
+{
+    std::mt19937 rng(7);
+    int nWrongOwner = 0;
+    int nOverdrawn = 0;
+    int nWrongStats = 0;
+    for (int nTrial = 0; nTrial < 300; ++nTrial)
+    {
+        CLayerCompositor compositor;
+        std::vector<FAKE_LAYER> layers;
+        const int nLayers = 1 + static_cast<int>(rng() % 6);
+        for (int i = 0; i < nLayers; ++i)
+        {
+            const REGION_RECT rect = RandomRect(rng);
+            const int nZOrder = static_cast<int>(rng() % 3);
+            layers.push_back(FAKE_LAYER{compositor.AddLayer(rect, nZOrder), rect, nZOrder, i, true});
+        }
+        // 移動と非表示の後の見える領域も正しく求めます
+        for (FAKE_LAYER &layer : layers)
+        {
+            if (rng() % 4 == 0)
+            {
+                layer.rect = RandomRect(rng);
+                compositor.SetLayerRect(layer.nId, layer.rect);
+            }
+            if (rng() % 5 == 0)
+            {
+                layer.bVisible = false;
+                compositor.SetLayerVisible(layer.nId, false);
+            }
+        }
+        compositor.ClearDirty();
+
+        CRectRegion dirty;
+        const int nDirtyRects = 1 + static_cast<int>(rng() % 3);
+        for (int i = 0; i < nDirtyRects; ++i)
+            dirty.Union(CRectRegion(RandomRect(rng)));
+        compositor.Invalidate(dirty);
+        CFakeCanvas canvas;
+        const COMPOSITOR_FRAME_STATS stats = compositor.Compose(canvas.Painter());
+
+        std::uint64_t nCovered = 0;
+        std::uint64_t nNaive = 0;
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            for (int x = 0; x < WIDTH; ++x)
+            {
+                const CLayerCompositor::LayerId nTop = dirty.Contains(x, y) ? TopLayerAt(layers, x, y) : CLayerCompositor::INVALID_LAYER;
+                if (canvas.Owner(x, y) != nTop)
+                    ++nWrongOwner;
+                if (canvas.Count(x, y) > 1)
+                    ++nOverdrawn;
+                if (nTop == CLayerCompositor::INVALID_LAYER)
+                    continue;
+                ++nCovered;
+                for (const FAKE_LAYER &layer : layers)
+                {
+                    if (layer.bVisible && Contains(layer.rect, x, y))
+                        ++nNaive;
+                }
+            }
+        }
+        if (stats.nDirtyArea != nCovered || stats.nPaintedArea != canvas.TotalPainted() || stats.nPaintedArea != nCovered ||
+            stats.nNaiveArea != nNaive || stats.nLayersPainted != static_cast<std::uint32_t>(canvas.GetPaintCalls()) ||
+            (nCovered > 0 && stats.GetOverdraw() != 1.0))
+            ++nWrongStats;
+    }
+    CHECK_EQ(nWrongOwner, 0);
+    CHECK_EQ(nOverdrawn, 0);
+    CHECK_EQ(nWrongStats, 0);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,273 @@
+﻿/**
+ * @file NumericFieldTest.cpp
+ * @brief CNumericField のテスト
+ * @details 数値の書式 (符号・整数部・小数点・小数部) と最大文字数による入力の制限、増減キーの範囲への丸め、
+ * 確定時の整形を個別に確認します。最大文字数で書けない範囲の設定は狭めて報告し、増減や確定の結果が
+ * 最大文字数を超えないことも確認します。乱数のキー操作の列で、文字列が常に入力規則を満たすことも確認します。
+ */
+#include "NumericField.h"
+#include "TestFramework.h"
+
+#include <random>
+#include <string>
+
+namespace
+{
+/**
+ * @brief 空の入力欄に一連のキーを入力した結果を返します。
+ * @details '<' は BackSpace、'~' は符号の反転、'^' / 'v' は増減、それ以外はその文字の入力です。
+ */
+std::wstring Type(const CNumericField &field, const wchar_t *pszKeys)
+{
+    std::wstring text;
+    int nSelStart = 0;
+    int nSelEnd = 0;
+    for (const wchar_t *p = pszKeys; *p != L'\0'; ++p)
+    {
+        if (*p == L'<')
+            field.Backspace(text, nSelStart, nSelEnd);
+        else if (*p == L'~')
+            field.ToggleSign(text, nSelStart, nSelEnd);
+        else if (*p == L'^')
+            field.Step(1, text, nSelStart, nSelEnd);
+        else if (*p == L'v')
+            field.Step(-1, text, nSelStart, nSelEnd);
+        else
+            field.InsertChar(*p, text, nSelStart, nSelEnd);
+    }
+    return text;
+}
+
+/// @brief -9.9～99.9 の小数1桁、0.1刻みの入力欄の種類を返します。
+CNumericField::Params DecimalParams()
+{
+    CNumericField::Params params;
+    params.nDecimals = 1;
+    params.bSigned = true;
+    params.dStep = 0.1;
+    params.dMin = -9.9;
+    params.dMax = 99.9;
+    return params;
+}
+
+/// @brief 確定した結果を返します。
+std::wstring Finished(const CNumericField &field, std::wstring text)
+{
+    field.Finish(text);
+    return text;
+}
+}
+
+TEST_CASE(GrammarAcceptsPartialNumbersOnly)
+{
+    const CNumericField integer;
+    CHECK(integer.IsValid(L""));
+    CHECK(integer.IsValid(L"0042"));
+    CHECK(!integer.IsValid(L"-1"));
+    CHECK(!integer.IsValid(L"1.5"));
+    CHECK(!integer.IsValid(L"12345"));
+    CHECK(!integer.IsValid(L"1a"));
+
+    const CNumericField decimal(DecimalParams());
+    CHECK(decimal.IsValid(L"-"));
+    CHECK(decimal.IsValid(L"-."));
+    CHECK(decimal.IsValid(L"1."));
+    CHECK(decimal.IsValid(L".5"));
+    CHECK(decimal.IsValid(L"-1.2"));
+    CHECK(!decimal.IsValid(L"1.25"));
+    CHECK(!decimal.IsValid(L"1-"));
+    CHECK(!decimal.IsValid(L"--1"));
+    CHECK(!decimal.IsValid(L"1.2.3"));
+    CHECK(!decimal.IsValid(L"-12.3"));
+}
+
+TEST_CASE(TypingRespectsLengthSignAndDecimalLimits)
+{
+    const CNumericField integer;
+    CHECK(Type(integer, L"12345") == L"1234");
+    CHECK(Type(integer, L"1.5") == L"15");
+    CHECK(Type(integer, L"-1") == L"1");
+    CHECK(Type(integer, L"1~") == L"1");
+    CHECK(Type(integer, L"12<3") == L"13");
+
+    const CNumericField decimal(DecimalParams());
+    CHECK(Type(decimal, L"-1.25") == L"-1.2");
+    CHECK(Type(decimal, L"12.34") == L"12.3");
+    CHECK(Type(decimal, L"1-") == L"1");
+    CHECK(Type(decimal, L"1..") == L"1.");
+    CHECK(Type(decimal, L"12~") == L"-12");
+    CHECK(Type(decimal, L"12~~") == L"12");
+    CHECK(Type(decimal, L"12.3~") == L"12.3"); // 符号を書く文字数が残っていません
+
+    // 選択範囲の置き換えと削除、受け付けない編集は何も変更しません
+    std::wstring text = L"1234";
+    int nSelStart = 0;
+    int nSelEnd = 4;
+    CHECK(integer.InsertChar(L'5', text, nSelStart, nSelEnd));
+    CHECK(text == L"5");
+    CHECK_EQ(nSelStart, 1);
+    text = L"1234";
+    nSelStart = 3;
+    nSelEnd = 1;
+    CHECK(integer.Delete(text, nSelStart, nSelEnd));
+    CHECK(text == L"14");
+    CHECK_EQ(nSelStart, 1);
+    CHECK_EQ(nSelEnd, 1);
+    nSelStart = nSelEnd = 2;
+    CHECK(!integer.Delete(text, nSelStart, nSelEnd));
+    nSelStart = nSelEnd = 0;
+    CHECK(!integer.Backspace(text, nSelStart, nSelEnd));
+    CHECK(!integer.InsertChar(L'x', text, nSelStart, nSelEnd));
+    CHECK(text == L"14");
+}
+
+TEST_CASE(StepClampsToTheRange)
+{
+    const CNumericField integer;
+    CHECK(Type(integer, L"9^") == L"10");
+    CHECK(Type(integer, L"v") == L"0");
+    CHECK(Type(integer, L"9999^") == L"9999");
+
+    // 範囲の端では値が変わらず、false を返します
+    std::wstring text = L"9999";
+    int nSelStart = 0;
+    int nSelEnd = 0;
+    CHECK(!integer.Step(1, text, nSelStart, nSelEnd));
+    CHECK(text == L"9999");
+    CHECK_EQ(nSelStart, 4);
+    text = L"0";
+    CHECK(!integer.Step(-3, text, nSelStart, nSelEnd));
+
+    // 0.1刻みを繰り返しても誤差は累積しません
+    const CNumericField decimal(DecimalParams());
+    text = L"0";
+    for (int i = 0; i < 30; ++i)
+        decimal.Step(1, text, nSelStart, nSelEnd);
+    CHECK(text == L"3");
+    for (int i = 0; i < 7; ++i)
+        decimal.Step(-1, text, nSelStart, nSelEnd);
+    CHECK(text == L"2.3");
+    CHECK(decimal.Step(-1000, text, nSelStart, nSelEnd));
+    CHECK(text == L"-9.9");
+    CHECK(decimal.Step(5000, text, nSelStart, nSelEnd));
+    CHECK(text == L"99.9");
+    CHECK_EQ(nSelStart, 4);
+    CHECK_EQ(nSelEnd, 4);
+}
+
+TEST_CASE(RangeIsNarrowedToWhatFitsTheLength)
+{
+    // 既定値と数値入力欄の例は最大文字数に収まります
+    CNumericField field;
+    CHECK(field.SetParams(CNumericField::Params()));
+    CHECK(field.SetParams(DecimalParams()));
+    CHECK_EQ(field.GetMin(), -9.9);
+    CHECK_EQ(field.GetMax(), 99.9);
+
+    // 4文字に 0～99999 は書けないため 0～9999 に狭め、上端からの増加は最大文字数を超えずに止まります
+    CNumericField::Params params;
+    params.dMax = 99999.0;
+    CHECK(!field.SetParams(params));
+    CHECK_EQ(field.GetMax(), 9999.0);
+    std::wstring text = L"9998";
+    int nSelStart = 4;
+    int nSelEnd = 4;
+    CHECK(field.Step(5, text, nSelStart, nSelEnd));
+    CHECK(text == L"9999");
+    CHECK(!field.Step(1, text, nSelStart, nSelEnd));
+    CHECK(text == L"9999");
+
+    // 負の数は符号の1文字を除いた文字数で書ける範囲に狭めます (6文字・小数1桁: -999.9～9999.9)
+    params = DecimalParams();
+    params.nMaxLength = 6;
+    params.dMin = -5000.0;
+    params.dMax = 50000.0;
+    CHECK(!field.SetParams(params));
+    CHECK_EQ(field.GetMin(), -999.9);
+    CHECK_EQ(field.GetMax(), 9999.9);
+    CHECK(Finished(field, L"-") == L"");
+    text = L"";
+    CHECK(field.Step(-100000, text, nSelStart, nSelEnd));
+    CHECK(text == L"-999.9");
+    CHECK(field.IsValid(text));
+
+    // 負の数を入力できない入力欄の負の最小値は0に狭めます
+    params = CNumericField::Params();
+    params.dMin = -10.0;
+    CHECK(!field.SetParams(params));
+    CHECK_EQ(field.GetMin(), 0.0);
+
+    // 狭めた結果の範囲が空の場合は、書ける端の値だけにします
+    params = CNumericField::Params();
+    params.nMaxLength = 2;
+    params.dMin = 500.0;
+    params.dMax = 900.0;
+    CHECK(!field.SetParams(params));
+    CHECK_EQ(field.GetMin(), 99.0);
+    CHECK_EQ(field.GetMax(), 99.0);
+    CHECK(Finished(field, L"7") == L"99");
+}
+
+TEST_CASE(FinishNormalizesAndClamps)
+{
+    const CNumericField decimal(DecimalParams());
+    CHECK(Finished(decimal, L"-") == L"");
+    CHECK(Finished(decimal, L".") == L"");
+    CHECK(Finished(decimal, L"-.") == L"");
+    CHECK(Finished(decimal, L"1.") == L"1");
+    CHECK(Finished(decimal, L".5") == L"0.5");
+    CHECK(Finished(decimal, L"007") == L"7");
+    CHECK(Finished(decimal, L"-0") == L"0");
+    CHECK(Finished(decimal, L"-99") == L"-9.9");
+    CHECK(Finished(decimal, L"1.0") == L"1");
+
+    std::wstring text = L"2.5";
+    CHECK(!decimal.Finish(text));
+    CHECK(text == L"2.5");
+    text = L"";
+    CHECK(!decimal.Finish(text));
+}
+
+TEST_CASE(RandomKeysNeverProduceInvalidText)
+{
+    std::mt19937 rng(3);
+    const wchar_t szKeys[] = L"0123456789.-<~^vX";
+    const CNumericField fields[] = {CNumericField(), CNumericField(DecimalParams())};
+    int nInvalid = 0;
+    for (const CNumericField &field : fields)
+    {
+        for (int nTrial = 0; nTrial < 50000; ++nTrial)
+        {
+            std::wstring text;
+            for (int k = 0; k < 12; ++k)
+            {
+                const wchar_t ch = szKeys[rng() % 17];
+                int nSelStart = static_cast<int>(rng() % 6);
+                int nSelEnd = static_cast<int>(rng() % 6);
+                if (ch == L'<')
+                    field.Backspace(text, nSelStart, nSelEnd);
+                else if (ch == L'~')
+                    field.ToggleSign(text, nSelStart, nSelEnd);
+                else if (ch == L'^')
+                    field.Step(1 + static_cast<int>(rng() % 8), text, nSelStart, nSelEnd);
+                else if (ch == L'v')
+                    field.Step(-1 - static_cast<int>(rng() % 8), text, nSelStart, nSelEnd);
+                else if (ch == L'X')
+                    field.Delete(text, nSelStart, nSelEnd);
+                else
+                    field.InsertChar(ch, text, nSelStart, nSelEnd);
+                if (!field.IsValid(text))
+                    ++nInvalid;
+            }
+            field.Finish(text);
+            if (!field.IsValid(text))
+                ++nInvalid;
+        }
+    }
+    CHECK_EQ(nInvalid, 0);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
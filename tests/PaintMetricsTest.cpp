@@ -0,0 +1,190 @@
+﻿/**
+ * @file PaintMetricsTest.cpp
+ * @brief CPaintMetrics のテスト
+ * @details ヒストグラムのバケット境界と、集計したパーセンタイルの誤差が
+ * 相対誤差 1/64 以内 (実装はバケットの中央値を返すため 1/128 程度) に収まることを、
+ * 全サンプルを並べ替えて求めた正確なパーセンタイルと比較して確認します。
+ */
+#include "PaintMetrics.h"
+#include "TestFramework.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/**
+ * @brief 正確なパーセンタイル (最近傍順位法) を返します。
+ */
+std::uint64_t ExactPercentile(std::vector<std::uint64_t> samples, double dFraction)
+{
+    std::sort(samples.begin(), samples.end());
+    std::uint64_t nRank = static_cast<std::uint64_t>(std::ceil(dFraction * samples.size()));
+    if (nRank < 1)
+        nRank = 1;
+    return samples[nRank - 1];
+}
+
+/**
+ * @brief 集計したパーセンタイルが正確な値から許容誤差内にあるかを検証します。
+ */
+void CheckPercentile(std::uint64_t nReported, std::uint64_t nExact, const char *pszLabel)
+{
+    // 許容誤差: 値の 1/64 (1ns 刻みのバケットでは誤差なし)
+    const std::uint64_t nTolerance = nExact / CPaintMetrics::SUB_BUCKETS;
+    const std::uint64_t nError = (nReported > nExact) ? nReported - nExact : nExact - nReported;
+    if (nError > nTolerance)
+    {
+        std::printf("  %s: reported=%llu exact=%llu error=%llu tolerance=%llu\n", pszLabel,
+                    static_cast<unsigned long long>(nReported), static_cast<unsigned long long>(nExact),
+                    static_cast<unsigned long long>(nError), static_cast<unsigned long long>(nTolerance));
+    }
+    CHECK(nError <= nTolerance);
+}
+
+/**
+ * @brief サンプルを記録し、全パーセンタイルと合計・最大値を検証します。
+ */
+void CheckDistribution(const std::vector<std::uint64_t> &samples)
+{
+    const CPaintMetrics::Site site = CPaintMetrics::SITE_GRID_PAINT;
+    CPaintMetrics::Reset();
+    std::uint64_t nTotal = 0;
+    std::uint64_t nMax = 0;
+    for (std::uint64_t v : samples)
+    {
+        CPaintMetrics::Record(site, v, 2, 1);
+        nTotal += v;
+        nMax = (std::max)(nMax, v);
+    }
+    const CPaintMetrics::SiteStats stats = CPaintMetrics::GetStats(site);
+    CHECK_EQ(stats.nCount, static_cast<std::uint64_t>(samples.size()));
+    CHECK_EQ(stats.nTotalNs, nTotal);
+    CHECK_EQ(stats.nMaxNs, nMax);
+    CHECK_EQ(stats.nItems, 2 * static_cast<std::uint64_t>(samples.size()));
+    CHECK_EQ(stats.nAllocations, static_cast<std::uint64_t>(samples.size()));
+    CheckPercentile(stats.nP50Ns, ExactPercentile(samples, 0.50), "p50");
+    CheckPercentile(stats.nP90Ns, ExactPercentile(samples, 0.90), "p90");
+    CheckPercentile(stats.nP99Ns, ExactPercentile(samples, 0.99), "p99");
+    CheckPercentile(stats.nP999Ns, ExactPercentile(samples, 0.999), "p99.9");
+}
+}
+
+TEST_CASE(BucketBoundsContainValue)
+{
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 200000; ++i)
+    {
+        const std::uint64_t v = rng() >> (rng() % 30 + 28); // 0 〜 2^36 付近まで
+        const int nIndex = CPaintMetrics::BucketIndex(v);
+        REQUIRE(nIndex >= 0 && nIndex < CPaintMetrics::BUCKET_COUNT);
+        if (nIndex == CPaintMetrics::BUCKET_COUNT - 1)
+            continue;
+        const std::uint64_t nLower = CPaintMetrics::BucketLowerBound(nIndex);
+        const std::uint64_t nWidth = CPaintMetrics::BucketWidth(nIndex);
+        CHECK(nLower <= v && v < nLower + nWidth);
+        // バケットの幅は値の 1/64 以下 (小さい値は1刻み)
+        CHECK(nWidth == 1 || nWidth * CPaintMetrics::SUB_BUCKETS <= v);
+    }
+    // 隣り合うバケットは隙間なく連続しています
+    for (int i = 0; i + 1 < CPaintMetrics::BUCKET_COUNT; ++i)
+        CHECK_EQ(CPaintMetrics::BucketLowerBound(i) + CPaintMetrics::BucketWidth(i), CPaintMetrics::BucketLowerBound(i + 1));
+}
+
+TEST_CASE(PercentilesOfUniformDistribution)
+{
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<std::uint64_t> dist(1000, 5000000);
+    std::vector<std::uint64_t> samples(100000);
+    for (auto &v : samples)
+        v = dist(rng);
+    CheckDistribution(samples);
+}
+
+TEST_CASE(PercentilesOfLogNormalDistribution)
+{
+    // 描画時間に近い裾の長い分布 (中央値 約200us)
+    std::mt19937_64 rng(13);
+    std::lognormal_distribution<double> dist(std::log(200000.0), 0.8);
+    std::vector<std::uint64_t> samples(100000);
+    for (auto &v : samples)
+        v = static_cast<std::uint64_t>(dist(rng));
+    CheckDistribution(samples);
+}
+
+TEST_CASE(PercentilesOfBimodalDistributionWithOutliers)
+{
+    std::mt19937_64 rng(17);
+    std::normal_distribution<double> fast(50000.0, 5000.0);
+    std::normal_distribution<double> slow(16000000.0, 1000000.0);
+    std::vector<std::uint64_t> samples;
+    for (int i = 0; i < 50000; ++i)
+    {
+        const double d = (i % 100 < 97) ? fast(rng) : slow(rng);
+        samples.push_back(static_cast<std::uint64_t>((std::max)(1.0, d)));
+    }
+    samples.push_back(40ull * 1000 * 1000 * 1000); // 40秒の外れ値
+    CheckDistribution(samples);
+}
+
+TEST_CASE(SmallValuesAreExact)
+{
+    std::vector<std::uint64_t> samples;
+    for (std::uint64_t v = 0; v < 64; ++v)
+        samples.push_back(v);
+    CheckDistribution(samples);
+    const CPaintMetrics::SiteStats stats = CPaintMetrics::GetStats(CPaintMetrics::SITE_GRID_PAINT);
+    CHECK_EQ(stats.nP50Ns, 31u);
+}
+
+TEST_CASE(RecordsFromSeveralThreadsAreMerged)
+{
+    const CPaintMetrics::Site site = CPaintMetrics::SITE_VIEW1_DRAW;
+    CPaintMetrics::Reset();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([site, t]() {
+            for (int i = 0; i < 10000; ++i)
+                CPaintMetrics::Record(site, 1000 * (t + 1), 1, 0);
+        });
+    }
+    for (std::thread &th : threads)
+        th.join();
+    const CPaintMetrics::SiteStats stats = CPaintMetrics::GetStats(site);
+    CHECK_EQ(stats.nCount, 40000u);
+    CHECK_EQ(stats.nTotalNs, 10000u * (1000 + 2000 + 3000 + 4000));
+    CHECK_EQ(stats.nMaxNs, 4000u);
+    CheckPercentile(stats.nP50Ns, 2000, "p50");
+    CheckPercentile(stats.nP99Ns, 4000, "p99");
+}
+
+TEST_CASE(DisabledScopeRecordsNothing)
+{
+    CPaintMetrics::Reset();
+    CPaintMetrics::SetEnabled(false);
+    {
+        CPaintMetricsScope scope(CPaintMetrics::SITE_VIEW2_DRAW);
+        scope.AddItems(5);
+    }
+    CHECK_EQ(CPaintMetrics::GetStats(CPaintMetrics::SITE_VIEW2_DRAW).nCount, 0u);
+
+    CPaintMetrics::SetEnabled(true);
+    {
+        CPaintMetricsScope scope(CPaintMetrics::SITE_VIEW2_DRAW);
+        scope.AddItems(5);
+        scope.AddAllocations(2);
+    }
+    CPaintMetrics::SetEnabled(false);
+    const CPaintMetrics::SiteStats stats = CPaintMetrics::GetStats(CPaintMetrics::SITE_VIEW2_DRAW);
+    CHECK_EQ(stats.nCount, 1u);
+    CHECK_EQ(stats.nItems, 5u);
+    CHECK_EQ(stats.nAllocations, 2u);
+    CHECK(!CPaintMetrics::FormatReport().empty());
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,54 @@
+﻿/**
+ * @file PerCellGridPainter.h
+ * @brief 書式の表とまとめ描画を導入する前の、セルごとに描画する方式のグリッドの描画 (比較用)
+ * @details セルごとに背景・枠線・文字列の順で描画します。書式は CGridPainter と同じく GRID_CELL_STYLE から読みます。
+ * CGridPainter::Paint() と同じ結果になることの確認と、描画状態の切り替えの回数の比較に使用します。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include "GridPainter.h"
+
+#include <algorithm>
+
+namespace PerCellGridPainter
+{
+    /**
+     * @brief グリッド全体をセルごとに描画します。
+     * @param[in,out] target 描画先
+     * @param[in] state 描画に必要な状態
+     * @param[in] source セルの内容
+     */
+    inline void Paint(CRenderTarget &target, const GRID_PAINT_STATE &state, const CGridCellSource &source)
+    {
+        target.FillRect(REGION_RECT{0, 0, state.nWidth, state.nHeight}, RenderRgb(255, 255, 255));
+        const int nEndRow = std::min(state.nRows, state.nTopRow + state.nMaxVisibleRows + (state.nRowOffset > 0 ? 1 : 0));
+        for (int nRow = state.nTopRow; nRow < nEndRow; ++nRow)
+        {
+            const int nTop = (nRow - state.nTopRow) * state.nRowHeight - state.nRowOffset;
+            int nLeft = 0;
+            for (int nCol = 0; nCol < state.nCols; ++nCol)
+            {
+                const REGION_RECT rect = {nLeft, nTop, nLeft + state.pColWidths[nCol], nTop + state.nRowHeight};
+                nLeft = rect.right;
+                const GRID_CELL_VIEW cell = source.GetCellView(nRow, nCol);
+                const bool bSelected = (nRow == state.nSelectedRow && nCol == state.nSelectedCol);
+                RenderColor bgColor = 0;
+                RenderColor textColor = 0;
+                CGridPainter::GetCellColors(cell, bSelected, state.bEditing, bgColor, textColor);
+                target.FillRect(rect, bgColor);
+                if (cell.pStyle->nBorderWidth > 0)
+                    target.DrawFrame(rect, cell.pStyle->borderColor, cell.pStyle->nBorderWidth);
+                if (cell.nLength > 0)
+                {
+                    const unsigned nFormat =
+                        (cell.pStyle->nAlign & 3u) | RENDER_TEXT_VCENTER | (cell.pStyle->bBold != 0 ? RENDER_TEXT_BOLD : 0u);
+                    target.DrawString(cell.pszText, cell.nLength, REGION_RECT{rect.left + 4, rect.top + 2, rect.right - 4, rect.bottom - 2},
+                                      textColor, nFormat);
+                }
+            }
+        }
+        if (state.bActive)
+            target.DrawFrame(REGION_RECT{1, 1, state.nWidth - 1, state.nHeight - 1}, RenderRgb(0, 0, 255), 3);
+    }
+}
@@ -0,0 +1,96 @@
+﻿/**
+ * @file RectRegionBench.cpp
+ * @brief CRectRegion / CClipRegionCache のベンチマーク
+ * @details 乱数の矩形 N 個の和の領域を2つ作り、SetRects() による構築と、和・差・積の1回あたりの時間を計測します。
+ * SetRects() の結果は1つずつ Union() した結果と一致することも確認します。
+ * また、CView2 のウィンドウの領域の計算 (CClipRegionCache の参照と CWindowRegionState の判定) を、
+ * 配置が変わらない場合 (サイズ変更の繰り返し) について1回あたりの時間で計測します。
+ *
+ *   RectRegionBench          N = 100, 300, 1000 で計測
+ *   RectRegionBench --quick  ctest 用 (N = 100 だけ、回数を減らします)
+ */
+#include "RectRegion.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::size_t g_nSink = 0;
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nRepeats = bQuick ? 3 : 7;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> position(0, 2000);
+    std::uniform_int_distribution<int> size(10, 120);
+    bool bSame = true;
+
+    std::vector<int> counts = {100, 300, 1000};
+    if (bQuick)
+        counts.resize(1);
+    for (int nCount : counts)
+    {
+        std::vector<REGION_RECT> rects;
+        for (int i = 0; i < 2 * nCount; ++i)
+        {
+            const int nLeft = position(rng);
+            const int nTop = position(rng);
+            rects.push_back(REGION_RECT{nLeft, nTop, nLeft + size(rng), nTop + size(rng)});
+        }
+        CRectRegion a;
+        CRectRegion b;
+        const double dBuildNs = TestFramework::MeasureNsPerOp(bQuick ? 5 : 20, nRepeats, [&]() {
+            a.SetRects(rects.data(), nCount);
+            b.SetRects(rects.data() + nCount, nCount);
+            g_nSink = g_nSink + a.GetRectCount();
+        }) / 2.0;
+
+        CRectRegion incremental;
+        for (int i = 0; i < nCount; ++i)
+            incremental.Union(CRectRegion(rects[i]));
+        if (incremental != a)
+            bSame = false;
+
+        const int nIterations = bQuick ? 50 : 200;
+        CRectRegion result;
+        const double dSubtractNs = TestFramework::MeasureNsPerOp(nIterations, nRepeats, [&]() {
+            result = a;
+            result.Subtract(b);
+            g_nSink = g_nSink + result.GetRectCount();
+        });
+        const double dIntersectNs = TestFramework::MeasureNsPerOp(nIterations, nRepeats, [&]() {
+            result = a;
+            result.Intersect(b);
+            g_nSink = g_nSink + result.GetRectCount();
+        });
+        const double dUnionNs = TestFramework::MeasureNsPerOp(nIterations, nRepeats, [&]() {
+            result = a;
+            result.Union(b);
+            g_nSink = g_nSink + result.GetRectCount();
+        });
+        std::printf("N=%4d: SetRects %8.1f us  rects A=%zu B=%zu  A-B %7.1f us  A&B %7.1f us  A|B %7.1f us\n", nCount,
+                    dBuildNs / 1000.0, a.GetRectCount(), b.GetRectCount(), dSubtractNs / 1000.0, dIntersectNs / 1000.0,
+                    dUnionNs / 1000.0);
+    }
+
+    // 配置が変わらないサイズ変更: キャッシュの参照と、設定済みの領域との比較だけで終わります
+    CClipRegionCache cache;
+    CWindowRegionState state;
+    const REGION_RECT rcView2 = {0, 0, 150, 150};
+    const REGION_RECT rcView1 = {-75, 0, 75, 150};
+    int nApplied = 0;
+    const double dLayoutNs = TestFramework::MeasureNsPerOp(bQuick ? 10000 : 1000000, nRepeats, [&]() {
+        if (state.Update(cache.GetClip(rcView2, &rcView1, 1)))
+            ++nApplied;
+    });
+    std::printf("unchanged layout: %.1f ns (clip cache hit + region compare)  applies=%d computes=%llu\n", dLayoutNs, nApplied,
+                static_cast<unsigned long long>(cache.GetStats().nComputes));
+
+    return (bSame && nApplied == 1 && cache.GetStats().nComputes == 1) ? 0 : 1;
+}
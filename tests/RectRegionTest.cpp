@@ -0,0 +1,240 @@
+﻿/**
+ * @file RectRegionTest.cpp
+ * @brief CRectRegion / CClipRegionCache / CWindowRegionState のテスト
+ * @details 乱数の矩形で作った領域の和・差・積を、ピクセルごとのビットマップで同じ演算をした結果と比べます。
+ * GetRects() の矩形が重ならずに領域を覆うこと、同じ領域が同じ表現 (operator==) になることも確認します。
+ * また、CMFCApplication4Dlg::UpdateLayoutAndClipping() と同じ手順で、同じ配置を繰り返した場合に
+ * ウィンドウの領域の設定 (SetWindowRgn) を1回しか呼び出さないことを確認します。
+ */
+#include "LayerCompositor.h"
+#include "RectRegion.h"
+#include "TestFramework.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+/// @brief ビットマップの範囲 (座標 -OFFSET から SIZE - OFFSET まで)
+const int SIZE = 48;
+const int OFFSET = 6;
+
+/// @brief ピクセルごとの領域 (1なら含む)
+using BITMAP = std::vector<char>;
+
+/// @brief Contains() で求めたビットマップを返します。
+BITMAP FromContains(const CRectRegion &region)
+{
+    BITMAP bitmap(SIZE * SIZE);
+    for (int y = 0; y < SIZE; ++y)
+    {
+        for (int x = 0; x < SIZE; ++x)
+            bitmap[y * SIZE + x] = region.Contains(x - OFFSET, y - OFFSET) ? 1 : 0;
+    }
+    return bitmap;
+}
+
+/**
+ * @brief GetRects() の矩形を塗ったビットマップを返します。
+ * @param[out] nOverlaps 2回以上塗ったピクセルの数
+ */
+BITMAP FromRects(const CRectRegion &region, int &nOverlaps)
+{
+    BITMAP bitmap(SIZE * SIZE, 0);
+    std::vector<REGION_RECT> rects;
+    region.GetRects(rects);
+    for (const REGION_RECT &rect : rects)
+    {
+        for (int y = rect.top; y < rect.bottom; ++y)
+        {
+            for (int x = rect.left; x < rect.right; ++x)
+            {
+                char &pixel = bitmap[(y + OFFSET) * SIZE + (x + OFFSET)];
+                if (pixel != 0)
+                    ++nOverlaps;
+                pixel = 1;
+            }
+        }
+    }
+    return bitmap;
+}
+
+/// @brief 矩形をビットマップに塗ります (bSet が false なら消します)。
+void Paint(BITMAP &bitmap, const REGION_RECT &rect, bool bSet)
+{
+    for (int y = rect.top; y < rect.bottom; ++y)
+    {
+        for (int x = rect.left; x < rect.right; ++x)
+            bitmap[(y + OFFSET) * SIZE + (x + OFFSET)] = bSet ? 1 : 0;
+    }
+}
+
+/// @brief ビットマップの範囲に収まる乱数の矩形を返します (幅か高さが0の矩形も含みます)。
+REGION_RECT RandomRect(std::mt19937 &rng)
+{
+    const int nLeft = static_cast<int>(rng() % 30) - OFFSET;
+    const int nTop = static_cast<int>(rng() % 30) - OFFSET;
+    return REGION_RECT{nLeft, nTop, nLeft + static_cast<int>(rng() % 16), nTop + static_cast<int>(rng() % 16)};
+}
+
+/// @brief 乱数の和と差で領域と同じビットマップを作ります。
+void RandomRegion(std::mt19937 &rng, CRectRegion &region, BITMAP &bitmap)
+{
+    region.Clear();
+    bitmap.assign(SIZE * SIZE, 0);
+    const int nCount = static_cast<int>(rng() % 7);
+    for (int i = 0; i < nCount; ++i)
+    {
+        const REGION_RECT rect = RandomRect(rng);
+        if (rng() % 3 == 0)
+        {
+            region.Subtract(CRectRegion(rect));
+            Paint(bitmap, rect, false);
+        }
+        else
+        {
+            region.Union(CRectRegion(rect));
+            Paint(bitmap, rect, true);
+        }
+    }
+}
+}
+
+TEST_CASE(OperationsMatchBitmap)
+{
+    std::mt19937 rng(1);
+    int nWrong = 0;
+    int nOverlaps = 0;
+    int nNotCanonical = 0;
+    for (int nTrial = 0; nTrial < 20000; ++nTrial)
+    {
+        CRectRegion a;
+        CRectRegion b;
+        BITMAP bitmapA;
+        BITMAP bitmapB;
+        RandomRegion(rng, a, bitmapA);
+        RandomRegion(rng, b, bitmapB);
+
+        CRectRegion unionAB = a;
+        unionAB.Union(b);
+        CRectRegion subtractAB = a;
+        subtractAB.Subtract(b);
+        CRectRegion intersectAB = a;
+        intersectAB.Intersect(b);
+        BITMAP expectedUnion(SIZE * SIZE);
+        BITMAP expectedSubtract(SIZE * SIZE);
+        BITMAP expectedIntersect(SIZE * SIZE);
+        for (int i = 0; i < SIZE * SIZE; ++i)
+        {
+            expectedUnion[i] = bitmapA[i] | bitmapB[i];
+            expectedSubtract[i] = bitmapA[i] & !bitmapB[i];
+            expectedIntersect[i] = bitmapA[i] & bitmapB[i];
+        }
+
+        const struct
+        {
+            const CRectRegion &region;
+            const BITMAP &expected;
+        } cases[] = {{a, bitmapA}, {unionAB, expectedUnion}, {subtractAB, expectedSubtract}, {intersectAB, expectedIntersect}};
+        for (const auto &item : cases)
+        {
+            if (FromContains(item.region) != item.expected || FromRects(item.region, nOverlaps) != item.expected)
+                ++nWrong;
+        }
+
+        // 同じ領域は演算の順序によらず同じ表現になります
+        CRectRegion unionBA = b;
+        unionBA.Union(a);
+        CRectRegion rebuilt = subtractAB;
+        rebuilt.Union(intersectAB);
+        CRectRegion moved = a;
+        moved.Offset(3, -2);
+        moved.Offset(-3, 2);
+        std::vector<REGION_RECT> rects;
+        a.GetRects(rects);
+        rects.push_back(RandomRect(rng));
+        CRectRegion fromRects;
+        fromRects.SetRects(rects.data(), rects.size());
+        CRectRegion unionLast = a;
+        unionLast.Union(CRectRegion(rects.back()));
+        if (unionAB != unionBA || rebuilt != a || moved != a || fromRects != unionLast)
+            ++nNotCanonical;
+    }
+    CHECK_EQ(nWrong, 0);
+    CHECK_EQ(nOverlaps, 0);
+    CHECK_EQ(nNotCanonical, 0);
+}
+
+TEST_CASE(BoundsAreaAndEmpty)
+{
+    CRectRegion region(REGION_RECT{0, 0, 10, 10});
+    region.Subtract(CRectRegion(REGION_RECT{2, 2, 8, 8}));
+    CHECK_EQ(region.GetArea(), 64u);
+    CHECK_EQ(region.GetRectCount(), 4u);
+    const REGION_RECT bounds = region.GetBounds();
+    CHECK(bounds.left == 0 && bounds.top == 0 && bounds.right == 10 && bounds.bottom == 10);
+    CHECK(!region.Contains(5, 5));
+    CHECK(!region.Contains(10, 0)); // 右端と下端は含みません
+
+    region.Intersect(CRectRegion(REGION_RECT{3, 3, 7, 7}));
+    CHECK(region.IsEmpty());
+    CHECK(region == CRectRegion());
+    CHECK(CRectRegion(REGION_RECT{5, 5, 5, 9}).IsEmpty());
+}
+
+TEST_CASE(RepeatedLayoutDoesNotResetWindowRegion)
+{
+    // UpdateLayoutAndClipping() と同じ手順: 合成の見える領域を CView2 のウィンドウ座標にし、変わった場合だけ設定します
+    CLayerCompositor compositor;
+    const CLayerCompositor::LayerId nView1 = compositor.AddLayer(REGION_RECT{450, 50, 600, 200}, 1);
+    const CLayerCompositor::LayerId nView2 = compositor.AddLayer(REGION_RECT{525, 50, 675, 200}, 0);
+    CWindowRegionState state;
+    int nSetWindowRgn = 0;
+    CRectRegion lastRegion;
+    const CWindowRegionState::ApplyFunc setWindowRgn = [&](const CRectRegion &region) {
+        ++nSetWindowRgn;
+        lastRegion = region;
+    };
+    auto updateLayout = [&]() {
+        CRectRegion region = compositor.GetVisibleRegion(nView2);
+        const REGION_RECT rect = compositor.GetLayerRect(nView2);
+        region.Offset(-rect.left, -rect.top);
+        return state.Apply(region, setWindowRgn);
+    };
+
+    // 表示時に1回設定し、同じ配置の OnSize を繰り返しても設定しません
+    CHECK(updateLayout());
+    for (int i = 0; i < 100; ++i)
+    {
+        compositor.SetLayerRect(nView1, REGION_RECT{450, 50, 600, 200});
+        compositor.SetLayerRect(nView2, REGION_RECT{525, 50, 675, 200});
+        updateLayout();
+    }
+    CHECK_EQ(nSetWindowRgn, 1);
+    CHECK(lastRegion == CRectRegion(REGION_RECT{75, 0, 150, 150}));
+    CHECK_EQ(state.GetApplyCount(), 1u);
+    CHECK_EQ(state.GetSkipCount(), 100u);
+
+    // 重なりが変われば設定し、同じ領域になる移動 (両方のビューを同じだけ動かす) では設定しません
+    compositor.SetLayerRect(nView1, REGION_RECT{450, 50, 590, 200});
+    CHECK(updateLayout());
+    CHECK(lastRegion == CRectRegion(REGION_RECT{65, 0, 150, 150}));
+    compositor.SetLayerRect(nView1, REGION_RECT{460, 60, 600, 210});
+    compositor.SetLayerRect(nView2, REGION_RECT{535, 60, 685, 210});
+    CHECK(!updateLayout());
+    compositor.SetLayerVisible(nView1, false);
+    CHECK(updateLayout());
+    CHECK(lastRegion == CRectRegion(REGION_RECT{0, 0, 150, 150}));
+    CHECK_EQ(nSetWindowRgn, 3);
+
+    // ウィンドウを作り直した場合は、同じ領域でも設定します
+    state.Invalidate();
+    CHECK(updateLayout());
+    CHECK(!updateLayout());
+    CHECK_EQ(nSetWindowRgn, 4);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,307 @@
+﻿/**
+ * @file RenderGoldenTest.cpp
+ * @brief CGridPainter / CKeyboardPainter の描画結果のゴールデンイメージ比較
+ * @details CSoftwareRenderTarget に描画した結果のハッシュ値 (GetChecksum) を golden/render_checksums.txt の期待値と比べます。
+ * 期待値の比較に加えて、代表的なピクセルの色、同じ描画の繰り返しで結果が変わらないこと、
+ * スクロール途中の表示が1行大きく描画した結果をずらしたものと一致すること、
+ * キーボードの修飾キーの切り替えで差分だけ描き直した結果が全体を描き直した結果と一致することを確認します。
+ *
+ *   RenderGoldenTest                       期待値と比較 (tests/ を作業ディレクトリにして実行)
+ *   RenderGoldenTest --record              描画結果で期待値のファイルを書き直す (描画を意図して変えた場合)
+ *   RenderGoldenTest --save-bmp <dir>      比較した描画結果を <名前>.bmp として書き出す (目視の確認用)
+ */
+#include "GridPainter.h"
+#include "KeyboardLayout.h"
+#include "KeyboardPainter.h"
+#include "KeyboardSurface.h"
+#include "RenderTarget.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// @brief 期待値のファイル
+const char *const GOLDEN_PATH = "golden/render_checksums.txt";
+
+/// @brief 期待値 (名前からハッシュ値)
+std::map<std::string, std::uint64_t> g_golden;
+/// @brief 比較した名前
+std::set<std::string> g_compared;
+/// @brief 期待値を書き直すか
+bool g_bRecord = false;
+/// @brief 描画結果を書き出すディレクトリ (nullptr なら書き出しません)
+const char *g_pszBmpDir = nullptr;
+
+/// @brief 期待値のファイルを読み込みます。
+bool LoadGolden()
+{
+    std::ifstream in(GOLDEN_PATH);
+    std::string name;
+    unsigned long long nChecksum = 0;
+    while (in >> name >> nChecksum)
+        g_golden[name] = nChecksum;
+    return !g_golden.empty();
+}
+
+/// @brief 期待値のファイルを書き出します。
+bool SaveGolden()
+{
+    std::ofstream out(GOLDEN_PATH);
+    for (const auto &item : g_golden)
+        out << item.first << ' ' << static_cast<unsigned long long>(item.second) << '\n';
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief 描画結果を期待値と比べます。
+ * @details 書き直す場合は、比較せずに描画結果を期待値にします。
+ */
+void CompareGolden(const char *pszName, const CSoftwareRenderTarget &target)
+{
+    g_compared.insert(pszName);
+    if (g_pszBmpDir != nullptr)
+        target.SaveBmp((std::string(g_pszBmpDir) + "/" + pszName + ".bmp").c_str());
+    if (g_bRecord)
+    {
+        g_golden[pszName] = target.GetChecksum();
+        return;
+    }
+    const auto it = g_golden.find(pszName);
+    if (it == g_golden.end())
+    {
+        std::printf("  no golden checksum for %s (run with --record)\n", pszName);
+        CHECK(false);
+        return;
+    }
+    if (it->second != target.GetChecksum())
+        std::printf("  %s: checksum %llu, expected %llu\n", pszName, static_cast<unsigned long long>(target.GetChecksum()),
+                    static_cast<unsigned long long>(it->second));
+    CHECK(it->second == target.GetChecksum());
+}
+
+/**
+ * @class CTestGrid
+ * @brief 7種類のセル (空欄・正の数・負の数・文字列の編集可能なセルと、編集不可のセル) を繰り返すグリッドの内容
+ */
+class CTestGrid : public CGridCellSource
+{
+public:
+    CTestGrid(int nRows, int nCols) : m_nRows(nRows), m_nCols(nCols), m_texts(nRows * nCols), m_styles(nRows * nCols), m_widths(nCols)
+    {
+        for (int i = 0; i < nCols; ++i)
+            m_widths[i] = 60 + (i % 3) * 20;
+        GRID_CELL_STYLE editable = GRID_CELL_STYLE::Default(RenderRgb(255, 255, 255));
+        editable.nNumberRule = GRID_NUMBER_RULE_SIGN;
+        const int nEditable = m_table.Intern(editable);
+        const int nReadOnly = m_table.Intern(GRID_CELL_STYLE::Default(RenderRgb(240, 240, 240)));
+        static const wchar_t *const TEXTS[] = {L"", L" 12.5 ", L"-3", L"abc"};
+        for (int i = 0; i < nRows * nCols; ++i)
+        {
+            const int nKind = i % 7;
+            m_texts[i] = (nKind < 4) ? TEXTS[nKind] : std::to_wstring(i);
+            m_styles[i] = (nKind < 4) ? nEditable : nReadOnly;
+        }
+    }
+
+    virtual GRID_CELL_VIEW GetCellView(int nRow, int nCol) const override
+    {
+        const int nIndex = nRow * m_nCols + nCol;
+        const std::wstring &text = m_texts[nIndex];
+        return GRID_CELL_VIEW{text.c_str(), static_cast<int>(text.size()), &m_table.Get(m_styles[nIndex])};
+    }
+
+    /// @brief nVisibleRows 行を表示する、アクティブで選択のない描画状態を返します。
+    GRID_PAINT_STATE GetPaintState(int nVisibleRows) const
+    {
+        GRID_PAINT_STATE state = {};
+        for (int nWidth : m_widths)
+            state.nWidth += nWidth;
+        state.nHeight = nVisibleRows * 22;
+        state.nRows = m_nRows;
+        state.nCols = m_nCols;
+        state.pColWidths = m_widths.data();
+        state.nRowHeight = 22;
+        state.nMaxVisibleRows = nVisibleRows;
+        state.nSelectedRow = -1;
+        state.nSelectedCol = -1;
+        state.bActive = true;
+        return state;
+    }
+
+private:
+    int m_nRows;                       ///< 行数
+    int m_nCols;                       ///< 列数
+    std::vector<std::wstring> m_texts; ///< セルの文字列
+    std::vector<int> m_styles;         ///< セルの書式の番号
+    std::vector<int> m_widths;         ///< 列の幅
+    CGridStyleTable m_table;           ///< 書式の表
+};
+
+/// @brief キーボードの枠と入力候補欄を描画します。
+void RenderKeyboardFrame(CRenderTarget &target, const CKeyboardSurface &surface)
+{
+    const int nWidth = surface.GetWidth();
+    const REGION_RECT rcClient = {0, 0, nWidth, surface.GetHeight()};
+    const REGION_RECT rcTitleBar = {0, 0, nWidth, KEYBOARD_TITLE_BAR_HEIGHT};
+    const REGION_RECT rcClose = {nWidth - 30, 0, nWidth, 30};
+    const REGION_RECT rcSuggestions = {0, 0, rcClose.left - 2, KEYBOARD_TITLE_BAR_HEIGHT};
+    static const std::wstring SUGGESTIONS[3] = {L"hello", L"world", L"a very long suggestion text"};
+    CKeyboardPainter::RenderFrame(target, rcClient, rcTitleBar, rcClose, RenderRgb(240, 240, 240));
+    CKeyboardPainter::RenderSuggestions(target, rcSuggestions, 3, SUGGESTIONS, 3);
+}
+}
+
+TEST_CASE(GridMatchesGolden)
+{
+    CTestGrid grid(50, 5);
+    GRID_PAINT_STATE state = grid.GetPaintState(10);
+    CSoftwareRenderTarget target(state.nWidth, state.nHeight);
+    CHECK_EQ(CGridPainter::Paint(target, state, grid), 50);
+
+    // セル (0,0) は編集可能な空欄で薄黄色、枠線は銀色、外枠は青の3ピクセル
+    CHECK(target.GetPixel(40, 19) == RenderRgb(255, 255, 224));
+    CHECK(target.GetPixel(40, 21) == RenderRgb(192, 192, 192));
+    CHECK(target.GetPixel(59, 10) == RenderRgb(192, 192, 192));
+    CHECK(target.GetPixel(40, 0) == RenderRgb(0, 0, 255));
+    CHECK(target.GetPixel(2, 100) == RenderRgb(0, 0, 255));
+    CHECK(target.GetPixel(3, 100) != RenderRgb(0, 0, 255));
+    CHECK(target.GetPixel(state.nWidth - 1, 100) == RenderRgb(0, 0, 255));
+    // 正の数はオレンジ、負の数は水色、数値でない文字列は白の背景
+    CHECK(target.GetPixel(130, 19) == RenderRgb(255, 192, 128));
+    CHECK(target.GetPixel(230, 19) == RenderRgb(120, 210, 230));
+    CHECK(target.GetPixel(290, 19) == RenderRgb(255, 255, 255));
+    // 負の数は赤字
+    bool bRedText = false;
+    for (int y = 0; y < 22; ++y)
+    {
+        for (int x = 140; x < 200; ++x)
+            bRedText = bRedText || target.GetPixel(x, y) == RenderRgb(255, 0, 0);
+    }
+    CHECK(bRedText);
+    CompareGolden("grid_full", target);
+
+    // 同じ描画を繰り返しても結果は変わりません
+    const std::uint64_t nChecksum = target.GetChecksum();
+    CGridPainter::Paint(target, state, grid);
+    CHECK(target.GetChecksum() == nChecksum);
+
+    // 選択中のセルは青、編集中は薄黄色
+    state.nSelectedRow = 1;
+    state.nSelectedCol = 1;
+    CGridPainter::Paint(target, state, grid);
+    CHECK(target.GetPixel(130, 22 + 19) == RenderRgb(0, 0, 230));
+    CompareGolden("grid_selected", target);
+    state.bEditing = true;
+    CGridPainter::Paint(target, state, grid);
+    CHECK(target.GetPixel(130, 22 + 19) == RenderRgb(255, 255, 224));
+    CompareGolden("grid_editing", target);
+    state.bEditing = false;
+
+    state.nTopRow = 3;
+    state.nRowOffset = 11;
+    CGridPainter::Paint(target, state, grid);
+    CompareGolden("grid_scrolled", target);
+
+    // スクロール途中の表示は、1行多く描画した結果を上に11ピクセルずらしたものと同じです (外枠は除きます)
+    GRID_PAINT_STATE tall = state;
+    tall.nRowOffset = 0;
+    tall.nHeight = state.nHeight + 22;
+    tall.nMaxVisibleRows = 11;
+    tall.bActive = false;
+    CSoftwareRenderTarget tallTarget(tall.nWidth, tall.nHeight);
+    CGridPainter::Paint(tallTarget, tall, grid);
+    GRID_PAINT_STATE inactive = state;
+    inactive.bActive = false;
+    CGridPainter::Paint(target, inactive, grid);
+    int nDifferent = 0;
+    for (int y = 0; y < state.nHeight; ++y)
+    {
+        for (int x = 0; x < state.nWidth; ++x)
+        {
+            if (target.GetPixel(x, y) != tallTarget.GetPixel(x, y + 11))
+                ++nDifferent;
+        }
+    }
+    CHECK_EQ(nDifferent, 0);
+}
+
+TEST_CASE(KeyboardMatchesGolden)
+{
+    for (int nLayout = 0; nLayout < KEYBOARD_LAYOUT_COUNT; ++nLayout)
+    {
+        CKeyboardSurface surface;
+        surface.SetLayout(GetKeyboardLayout(static_cast<EKeyboardLayout>(nLayout)));
+        CSoftwareRenderTarget target(surface.GetWidth(), surface.GetHeight());
+        std::vector<int> dirty;
+        surface.InvalidateAll();
+        surface.SetModifiers(0, dirty);
+        CHECK_EQ(static_cast<int>(dirty.size()), surface.GetKeyCount());
+        RenderKeyboardFrame(target, surface);
+        for (int nKey : dirty)
+            CKeyboardPainter::RenderKey(target, surface, nKey);
+
+        // 閉じるボタンの × は白、キーの枠は灰色
+        CHECK(target.GetPixel(surface.GetWidth() - 15, 15) == RenderRgb(255, 255, 255));
+        const KEYBOARD_RECT &rcKey = surface.GetKeyRect(0);
+        CHECK(target.GetPixel(rcKey.left, rcKey.top + 5) == RenderRgb(173, 173, 173));
+        char szName[32];
+        std::snprintf(szName, sizeof(szName), "kbd%d_plain", nLayout);
+        CompareGolden(szName, target);
+
+        // 修飾キーを切り替えて差分だけ描き直した結果は、全体を描き直した結果と同じです
+        for (unsigned nModifiers : {1u, 3u, 0u, 2u})
+        {
+            surface.SetModifiers(nModifiers, dirty);
+            for (int nKey : dirty)
+                CKeyboardPainter::RenderKey(target, surface, nKey);
+            CSoftwareRenderTarget full(surface.GetWidth(), surface.GetHeight());
+            RenderKeyboardFrame(full, surface);
+            for (int nKey = 0; nKey < surface.GetKeyCount(); ++nKey)
+                CKeyboardPainter::RenderKey(full, surface, nKey);
+            CHECK(full.GetChecksum() == target.GetChecksum());
+            std::snprintf(szName, sizeof(szName), "kbd%d_mod%u", nLayout, nModifiers);
+            CompareGolden(szName, target);
+        }
+    }
+}
+
+TEST_CASE(EveryGoldenChecksumIsUsed)
+{
+    // 期待値のファイルに、描画しなくなった名前が残っていないことを確認します
+    int nUnused = 0;
+    for (const auto &item : g_golden)
+    {
+        if (g_compared.count(item.first) == 0)
+        {
+            std::printf("  unused golden checksum %s\n", item.first.c_str());
+            ++nUnused;
+        }
+    }
+    CHECK_EQ(nUnused, 0);
+}
+
+int main(int argc, char **argv)
+{
+    g_bRecord = TestFramework::HasFlag(argc, argv, "--record");
+    g_pszBmpDir = TestFramework::FlagValue(argc, argv, "--save-bmp");
+    if (!g_bRecord && !LoadGolden())
+    {
+        std::printf("cannot read %s (run from tests/, or with --record)\n", GOLDEN_PATH);
+        return 1;
+    }
+    // "--" で始まる引数はテスト名の絞り込みに使いません
+    const int nResult = TestFramework::RunAll((argc > 1 && argv[1][0] != '-') ? argc : 1, argv);
+    if (g_bRecord)
+    {
+        if (!SaveGolden())
+            return 1;
+        std::printf("recorded %zu golden checksums to %s\n", g_golden.size(), GOLDEN_PATH);
+    }
+    return nResult;
+}
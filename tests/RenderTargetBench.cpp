@@ -0,0 +1,191 @@
+﻿/**
+ * @file RenderTargetBench.cpp
+ * @brief CGridPainter / CKeyboardPainter の描画時間と描画呼び出し数のベンチマーク
+ * @details CSoftwareRenderTarget に描画し、1フレームあたりの時間と、描画先の基本操作の呼び出し回数
+ * (RENDER_TARGET_STATS の塗りつぶし・線分・文字列・描画状態の切り替え) を計測します。
+ * グリッドは 1000行×12列 を 10/40/100 行表示し、全体の描画・スクロール・選択の移動を計測します。
+ * キーボードは Shift の切り替えで、差分のキーだけ描き直す場合と全てのキーを描き直す場合を比べます。
+ * 時間は GDI への描画ではなくソフトウェア描画のものです。呼び出し回数は CGdiRenderTarget でも同じ数え方です。
+ *
+ *   RenderTargetBench          計測
+ *   RenderTargetBench --quick  ctest 用 (回数を減らします)
+ */
+#include "GridPainter.h"
+#include "KeyboardLayout.h"
+#include "KeyboardPainter.h"
+#include "KeyboardSurface.h"
+#include "RenderTarget.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::uint64_t g_nSink = 0;
+
+/**
+ * @class CBenchGrid
+ * @brief 7種類のセル (空欄・正の数・負の数・文字列の編集可能なセルと、編集不可のセル) を繰り返すグリッドの内容
+ */
+class CBenchGrid : public CGridCellSource
+{
+public:
+    CBenchGrid(int nRows, int nCols) : m_nCols(nCols), m_texts(nRows * nCols), m_styles(nRows * nCols), m_widths(nCols)
+    {
+        for (int i = 0; i < nCols; ++i)
+            m_widths[i] = 60 + (i % 3) * 20;
+        GRID_CELL_STYLE editable = GRID_CELL_STYLE::Default(RenderRgb(255, 255, 255));
+        editable.nNumberRule = GRID_NUMBER_RULE_SIGN;
+        const int nEditable = m_table.Intern(editable);
+        const int nReadOnly = m_table.Intern(GRID_CELL_STYLE::Default(RenderRgb(240, 240, 240)));
+        static const wchar_t *const TEXTS[] = {L"", L" 12.5 ", L"-3", L"abc"};
+        for (int i = 0; i < nRows * nCols; ++i)
+        {
+            const int nKind = i % 7;
+            m_texts[i] = (nKind < 4) ? TEXTS[nKind] : std::to_wstring(i);
+            m_styles[i] = (nKind < 4) ? nEditable : nReadOnly;
+        }
+        m_state.nRows = nRows;
+        m_state.nCols = nCols;
+    }
+
+    virtual GRID_CELL_VIEW GetCellView(int nRow, int nCol) const override
+    {
+        const int nIndex = nRow * m_nCols + nCol;
+        const std::wstring &text = m_texts[nIndex];
+        return GRID_CELL_VIEW{text.c_str(), static_cast<int>(text.size()), &m_table.Get(m_styles[nIndex])};
+    }
+
+    /// @brief nVisibleRows 行を表示する、アクティブで選択のない描画状態を返します。
+    GRID_PAINT_STATE GetPaintState(int nVisibleRows) const
+    {
+        GRID_PAINT_STATE state = m_state;
+        for (int nWidth : m_widths)
+            state.nWidth += nWidth;
+        state.nHeight = nVisibleRows * 22;
+        state.pColWidths = m_widths.data();
+        state.nRowHeight = 22;
+        state.nMaxVisibleRows = nVisibleRows;
+        state.nSelectedRow = -1;
+        state.nSelectedCol = -1;
+        state.bActive = true;
+        return state;
+    }
+
+private:
+    int m_nCols;                       ///< 列数
+    std::vector<std::wstring> m_texts; ///< セルの文字列
+    std::vector<int> m_styles;         ///< セルの書式の番号
+    std::vector<int> m_widths;         ///< 列の幅
+    CGridStyleTable m_table;           ///< 書式の表
+    GRID_PAINT_STATE m_state = {};     ///< 行数と列数を設定した描画状態
+};
+
+/// @brief 1フレームあたりの計測結果
+struct FRAME_RESULT
+{
+    double dMicros;      ///< 時間 (マイクロ秒、最良の回)
+    double dFills;       ///< 塗りつぶしの回数
+    double dLines;       ///< 線分の数
+    double dTexts;       ///< 文字列の描画の回数
+    double dStates;      ///< 描画状態の切り替えの回数
+};
+
+/**
+ * @brief フレームを nFrames 回描画し、時間と1フレームあたりの呼び出し回数を返します。
+ * @param[in] paint フレーム番号を受け取って1フレームを描画する関数
+ */
+template <class Fn>
+FRAME_RESULT MeasureFrames(CSoftwareRenderTarget &target, int nFrames, int nRepeats, Fn &&paint)
+{
+    int nFrame = 0;
+    target.ResetStats();
+    const double dNs = TestFramework::MeasureNsPerOp(nFrames, nRepeats, [&]() { paint(nFrame++); });
+    const RENDER_TARGET_STATS &stats = target.GetStats();
+    g_nSink = g_nSink + target.GetChecksum();
+    const double dTotal = static_cast<double>(nFrames) * nRepeats;
+    return FRAME_RESULT{dNs / 1000.0, stats.nFills / dTotal, stats.nLines / dTotal, stats.nTexts / dTotal, stats.nStateChanges / dTotal};
+}
+
+/// @brief 計測結果を1行で表示します。
+void PrintFrame(const char *pszLabel, const FRAME_RESULT &result)
+{
+    std::printf("  %-22s %8.1f us  fills %6.1f  lines %6.1f  texts %6.1f  state changes %5.1f\n", pszLabel, result.dMicros,
+                result.dFills, result.dLines, result.dTexts, result.dStates);
+}
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nRepeats = bQuick ? 2 : 5;
+    bool bPassed = true;
+
+    CBenchGrid grid(1000, 12);
+    std::vector<int> visibleRows = {10, 40, 100};
+    if (bQuick)
+        visibleRows.resize(1);
+    for (int nVisible : visibleRows)
+    {
+        GRID_PAINT_STATE state = grid.GetPaintState(nVisible);
+        CSoftwareRenderTarget target(state.nWidth, state.nHeight);
+        const int nFrames = bQuick ? 10 : 40;
+        std::printf("grid %d rows x 12 cols (%dx%d):\n", nVisible, state.nWidth, state.nHeight);
+        const FRAME_RESULT full = MeasureFrames(target, nFrames, nRepeats, [&](int) { CGridPainter::Paint(target, state, grid); });
+        PrintFrame("full", full);
+        const FRAME_RESULT scroll = MeasureFrames(target, nFrames, nRepeats, [&](int nFrame) {
+            state.nTopRow = (nFrame / 22) % 800;
+            state.nRowOffset = nFrame % 22;
+            CGridPainter::Paint(target, state, grid);
+        });
+        PrintFrame("scroll", scroll);
+        state.nTopRow = 0;
+        state.nRowOffset = 0;
+        const FRAME_RESULT selection = MeasureFrames(target, nFrames, nRepeats, [&](int nFrame) {
+            state.nSelectedRow = nFrame % nVisible;
+            state.nSelectedCol = nFrame % 12;
+            CGridPainter::Paint(target, state, grid);
+        });
+        PrintFrame("selection", selection);
+
+        // 背景は同じ色が続くセルをまとめて塗るため、塗りつぶしは表示中のセルの数より少なくなります
+        const double dCells = static_cast<double>(nVisible) * 12;
+        if (full.dFills >= dCells)
+        {
+            std::printf("  FAIL: %.1f fills for %.0f cells\n", full.dFills, dCells);
+            bPassed = false;
+        }
+    }
+
+    CKeyboardSurface surface;
+    surface.SetLayout(GetKeyboardLayout(KEYBOARD_LAYOUT_US));
+    CSoftwareRenderTarget target(surface.GetWidth(), surface.GetHeight());
+    std::vector<int> dirty;
+    const int nFrames = bQuick ? 200 : 2000;
+    std::size_t nDirtyKeys = 0;
+    const FRAME_RESULT dirtyOnly = MeasureFrames(target, nFrames, nRepeats, [&](int nFrame) {
+        surface.SetModifiers((nFrame & 1) != 0 ? 1u : 0u, dirty);
+        nDirtyKeys += dirty.size();
+        for (int nKey : dirty)
+            CKeyboardPainter::RenderKey(target, surface, nKey);
+    });
+    const FRAME_RESULT allKeys = MeasureFrames(target, nFrames, nRepeats, [&](int nFrame) {
+        surface.SetModifiers((nFrame & 1) != 0 ? 1u : 0u, dirty);
+        for (int nKey = 0; nKey < surface.GetKeyCount(); ++nKey)
+            CKeyboardPainter::RenderKey(target, surface, nKey);
+    });
+    std::printf("keyboard US (%d keys), Shift toggle (%.1f dirty keys per frame):\n", surface.GetKeyCount(),
+                static_cast<double>(nDirtyKeys) / (static_cast<double>(nFrames) * nRepeats));
+    PrintFrame("dirty keys only", dirtyOnly);
+    PrintFrame("all keys", allKeys);
+    if (dirtyOnly.dFills + dirtyOnly.dTexts >= allKeys.dFills + allKeys.dTexts)
+    {
+        std::printf("  FAIL: redrawing dirty keys only does not reduce draw calls\n");
+        bPassed = false;
+    }
+
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+﻿/**
+ * @file SoftwareKeyboardShowBench.cpp
+ * @brief CSoftwareKeyboardDlg::ShowFor の表示までの時間のベンチマーク (ウィンドウを使わない再現)
+ * @details ShowFor() のうちウィンドウに依存しない部分 (レイアウトの設定・裏画面の確保・裏画面への描画・画面への転送) を、
+ * CSoftwareKeyboardDlg と同じ手順で CSoftwareRenderTarget に対して行い、所要時間を計測します。
+ *   - 初回 (cold): 裏画面を全レイアウトが収まる大きさで確保し、枠・入力候補・全てのキーを描いて転送します
+ *     (Prepare() → OnInitDialog() → CreateSurface() → RedrawSurface() と最初の OnPaint() に相当)
+ *   - 2回目以降 (warm): 同じレイアウトで、表示内容が変わったキーと入力候補だけを描いて転送します
+ *   - 2回目以降でレイアウトを切り替える場合: ApplyLayout() → RedrawSurface() に相当します
+ * ウィンドウの生成 (CreateDialog)、SetWindowPos / UpdateWindow、GDIでの描画・転送の時間は含みません。
+ * 実機の表示までの時間は、描画計測値 SITE_KEYBOARD_SHOW で確認してください。
+ *
+ *   SoftwareKeyboardShowBench          全規模で計測
+ *   SoftwareKeyboardShowBench --quick  ctest 用 (回数を減らします)
+ */
+#include "KeyboardLayout.h"
+#include "KeyboardPainter.h"
+#include "KeyboardSurface.h"
+#include "RenderTarget.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::uint64_t g_nSink = 0;
+
+/// @brief 閉じるボタンのサイズ (SoftwareKeyboardDlg.cpp と同じ値)
+const int CLOSE_BTN_SIZE = 30;
+/// @brief 入力候補の最大数と1候補の最小幅 (SoftwareKeyboardDlg.h と同じ値)
+const int SUGGESTION_MAX_COUNT = 4;
+const int SUGGESTION_MIN_WIDTH = 96;
+/// @brief ボタンの表面の色 (GetSysColor(COLOR_BTNFACE) の既定値)
+const RenderColor COLOR_FACE = RenderRgb(240, 240, 240);
+
+/**
+ * @class CHeadlessKeyboard
+ * @brief CSoftwareKeyboardDlg の表示処理のうち、ウィンドウに依存しない部分の再現
+ */
+class CHeadlessKeyboard
+{
+public:
+    /**
+     * @brief ShowFor() の表示完了までの処理を行います。
+     * @return 描画したキーの数
+     */
+    int ShowFor(EKeyboardLayout eLayout, unsigned nModifiers, CSoftwareRenderTarget &screen)
+    {
+        if (!m_pBackBuffer)
+        {
+            // Prepare() → OnInitDialog(): レイアウトを設定し、裏画面を確保して全体を描きます
+            ApplyLayout(eLayout);
+            int nMaxWidth = 0;
+            int nMaxHeight = 0;
+            GetKeyboardLayoutExtent(nMaxWidth, nMaxHeight);
+            m_pBackBuffer.reset(new CSoftwareRenderTarget((std::max)(1, nMaxWidth), (std::max)(1, nMaxHeight)));
+            RedrawSurface();
+        }
+        else if (eLayout != m_eLayout)
+        {
+            ApplyLayout(eLayout);
+            RedrawSurface();
+        }
+        const int nKeys = UpdateAllKeys(nModifiers);
+        CKeyboardPainter::RenderSuggestions(*m_pBackBuffer, m_rcSuggestions, m_nSuggestionCells, m_suggestions.data(),
+                                           m_suggestions.size());
+
+        // SWP_SHOWWINDOW + UpdateWindow() による最初の OnPaint(): 裏画面から画面へ転送します
+        screen.Blit(0, 0, m_surface.GetWidth(), m_surface.GetHeight(), *m_pBackBuffer, 0, 0);
+        return nKeys;
+    }
+
+    /// @brief 入力候補を設定します。
+    void SetSuggestions(const std::vector<std::wstring> &suggestions) { m_suggestions = suggestions; }
+    /// @brief 裏画面を返します。
+    const CSoftwareRenderTarget &GetBackBuffer() const { return *m_pBackBuffer; }
+
+private:
+    /// @brief ApplyLayout() のうちウィンドウに依存しない部分
+    void ApplyLayout(EKeyboardLayout eLayout)
+    {
+        m_eLayout = eLayout;
+        m_surface.SetLayout(GetKeyboardLayout(eLayout));
+        const int nWidth = m_surface.GetWidth();
+        m_rcClient = {0, 0, nWidth, m_surface.GetHeight()};
+        m_rcTitleBar = {0, 0, nWidth, KEYBOARD_TITLE_BAR_HEIGHT};
+        m_rcCloseBtn = {nWidth - CLOSE_BTN_SIZE - 2, (KEYBOARD_TITLE_BAR_HEIGHT - CLOSE_BTN_SIZE) / 2, nWidth - 2,
+                        (KEYBOARD_TITLE_BAR_HEIGHT + CLOSE_BTN_SIZE) / 2};
+        m_rcSuggestions = {0, 0, (std::max)(0, m_rcCloseBtn.left - 2), KEYBOARD_TITLE_BAR_HEIGHT};
+        m_nSuggestionCells = (std::min)(SUGGESTION_MAX_COUNT, m_rcSuggestions.right / SUGGESTION_MIN_WIDTH);
+        if (m_suggestions.size() > static_cast<std::size_t>(m_nSuggestionCells))
+            m_suggestions.resize(m_nSuggestionCells);
+    }
+
+    /// @brief RedrawSurface(): 枠と入力候補を描き、全てのキーを未描画にします
+    void RedrawSurface()
+    {
+        CKeyboardPainter::RenderFrame(*m_pBackBuffer, m_rcClient, m_rcTitleBar, m_rcCloseBtn, COLOR_FACE);
+        CKeyboardPainter::RenderSuggestions(*m_pBackBuffer, m_rcSuggestions, m_nSuggestionCells, m_suggestions.data(),
+                                           m_suggestions.size());
+        m_surface.InvalidateAll();
+    }
+
+    /// @brief UpdateAllKeys(): 表示内容が変わったキーだけを描きます
+    int UpdateAllKeys(unsigned nModifiers)
+    {
+        m_surface.SetModifiers(nModifiers, m_dirtyKeys);
+        for (int nIndex : m_dirtyKeys)
+            CKeyboardPainter::RenderKey(*m_pBackBuffer, m_surface, nIndex);
+        return static_cast<int>(m_dirtyKeys.size());
+    }
+
+    CKeyboardSurface m_surface;                             ///< レイアウト・表示状態
+    std::unique_ptr<CSoftwareRenderTarget> m_pBackBuffer;   ///< 裏画面 (m_bmpSurface に相当)
+    EKeyboardLayout m_eLayout = KEYBOARD_LAYOUT_US;         ///< 現在のレイアウト
+    REGION_RECT m_rcClient = {};                            ///< 描画面全体
+    REGION_RECT m_rcTitleBar = {};                          ///< タイトルバー
+    REGION_RECT m_rcCloseBtn = {};                          ///< 閉じるボタン
+    REGION_RECT m_rcSuggestions = {};                       ///< 入力候補欄
+    int m_nSuggestionCells = 0;                             ///< 入力候補欄の区画の数
+    std::vector<std::wstring> m_suggestions;                ///< 入力候補
+    std::vector<int> m_dirtyKeys;                           ///< 描き直すキー
+};
+
+/// @brief 計測結果を表示します。
+void Report(const char *pszName, std::vector<double> &samples, double dKeys)
+{
+    std::printf("%-34s p50=%7.1f us  p99=%7.1f us  keys drawn=%.0f\n", pszName, TestFramework::Percentile(samples, 50.0) / 1000.0,
+                TestFramework::Percentile(samples, 99.0) / 1000.0, dKeys);
+}
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nRuns = bQuick ? 50 : 1000;
+    const std::vector<std::wstring> suggestions = {L"100.0", L"12.5", L"abc", L"hello"};
+
+    int nMaxWidth = 0;
+    int nMaxHeight = 0;
+    GetKeyboardLayoutExtent(nMaxWidth, nMaxHeight);
+    CSoftwareRenderTarget screen(nMaxWidth, nMaxHeight);
+
+    const EKeyboardLayout layouts[] = {KEYBOARD_LAYOUT_US, KEYBOARD_LAYOUT_KEYPAD};
+    const char *const names[] = {"US", "KEYPAD"};
+    for (int nLayout = 0; nLayout < 2; ++nLayout)
+    {
+        const EKeyboardLayout eLayout = layouts[nLayout];
+        std::vector<double> cold;
+        std::vector<double> warm;
+        std::vector<double> warmCaps;
+        std::vector<double> warmSwitch;
+        int nColdKeys = 0;
+        int nWarmKeys = 0;
+        int nCapsKeys = 0;
+        int nSwitchKeys = 0;
+        for (int i = 0; i < nRuns; ++i)
+        {
+            // 初回: 新しいダイアログに相当します
+            CHeadlessKeyboard keyboard;
+            keyboard.SetSuggestions(suggestions);
+            std::int64_t t0 = TestFramework::NowNs();
+            nColdKeys = keyboard.ShowFor(eLayout, 0, screen);
+            cold.push_back(static_cast<double>(TestFramework::NowNs() - t0));
+
+            // 2回目: 同じレイアウト・同じ修飾キー
+            t0 = TestFramework::NowNs();
+            nWarmKeys = keyboard.ShowFor(eLayout, 0, screen);
+            warm.push_back(static_cast<double>(TestFramework::NowNs() - t0));
+
+            // 2回目: CapsLock の状態が前回と異なる
+            t0 = TestFramework::NowNs();
+            nCapsKeys = keyboard.ShowFor(eLayout, CKeyboardSurface::MOD_CAPS, screen);
+            warmCaps.push_back(static_cast<double>(TestFramework::NowNs() - t0));
+
+            // 2回目: 別のレイアウトから切り替える
+            keyboard.ShowFor(eLayout == KEYBOARD_LAYOUT_US ? KEYBOARD_LAYOUT_KEYPAD : KEYBOARD_LAYOUT_US, 0, screen);
+            t0 = TestFramework::NowNs();
+            nSwitchKeys = keyboard.ShowFor(eLayout, 0, screen);
+            warmSwitch.push_back(static_cast<double>(TestFramework::NowNs() - t0));
+            g_nSink = g_nSink + keyboard.GetBackBuffer().GetPixel(1, 1);
+        }
+        std::printf("[%s]\n", names[nLayout]);
+        Report("cold (allocate + full render)", cold, nColdKeys);
+        Report("warm (same layout)", warm, nWarmKeys);
+        Report("warm (CapsLock changed)", warmCaps, nCapsKeys);
+        Report("warm (layout switched)", warmSwitch, nSwitchKeys);
+    }
+    std::printf("not measured: window creation, SetWindowPos/UpdateWindow, GDI drawing and BitBlt\n");
+    return 0;
+}
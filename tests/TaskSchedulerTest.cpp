@@ -0,0 +1,242 @@
+﻿/**
+ * @file TaskSchedulerTest.cpp
+ * @brief CTaskScheduler のテスト
+ * @details 結果がスレッドの実行順や処理速度に左右されないよう、待ち合わせで状況を固定してから検証します。
+ * ワークスティーリング (塞がったワーカーのキューを他のワーカーが消化すること)、タイマーホイールの順序と
+ * 1周を越える遅延、取り消しトークン、UiExecutor が未設定の場合の PostToUi() を確認します。
+ */
+#include "TaskScheduler.h"
+#include "TestFramework.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/**
+ * @brief 条件が成立するまで待ちます。
+ * @return 制限時間内に成立した場合はtrue
+ */
+template <typename Pred>
+bool WaitUntil(Pred pred, int nTimeoutMs = 5000)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(nTimeoutMs);
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/// @brief 経過時間 (ミリ秒) を返します。
+double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+TEST_CASE(BlockedWorkerQueueIsStolen)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(2));
+    CHECK_EQ(scheduler.GetWorkerCount(), 2);
+
+    // ワーカー上のタスクが自分のキューに100個積んでから、それらの完了を待って塞がります。
+    // 積んだタスクはもう1つのワーカーが盗まない限り実行されません。
+    const int nChildren = 100;
+    std::atomic<int> nDone(0);
+    std::atomic<bool> bParentFinished(false);
+    scheduler.Submit([&]() {
+        for (int i = 0; i < nChildren; ++i)
+            scheduler.Submit([&nDone]() { nDone.fetch_add(1); });
+        bParentFinished = WaitUntil([&]() { return nDone.load() == nChildren; });
+    });
+    CHECK(WaitUntil([&]() { return bParentFinished.load(); }));
+    CHECK_EQ(nDone.load(), nChildren);
+    CHECK(scheduler.GetStolenCount() >= static_cast<std::uint64_t>(nChildren));
+    CHECK(WaitUntil([&]() { return scheduler.GetExecutedCount() == static_cast<std::uint64_t>(nChildren + 1); }));
+    scheduler.Shutdown();
+    CHECK(!scheduler.IsRunning());
+}
+
+TEST_CASE(AllSubmittedTasksRunOnce)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(4));
+    const int nTasks = 100000;
+    std::vector<std::atomic<int>> runs(nTasks);
+    for (int i = 0; i < nTasks; ++i)
+        scheduler.Submit([&runs, i]() { runs[i].fetch_add(1); });
+    CHECK(WaitUntil([&]() { return scheduler.GetExecutedCount() == static_cast<std::uint64_t>(nTasks); }));
+    int nWrong = 0;
+    for (const std::atomic<int> &n : runs)
+    {
+        if (n.load() != 1)
+            ++nWrong;
+    }
+    CHECK_EQ(nWrong, 0);
+    scheduler.Shutdown();
+    CHECK(!scheduler.Submit([]() {}));
+}
+
+TEST_CASE(TimerWheelFiresInDeadlineOrderAndNotEarly)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(1));
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<double> firedAt(4, 0.0);
+    const std::uint32_t delays[] = {120, 15, 60, 90};
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4; ++i)
+    {
+        scheduler.ScheduleAfter(delays[i], [&, i]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            firedAt[i] = ElapsedMs(start);
+            order.push_back(i);
+        });
+    }
+    CHECK(WaitUntil([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return order.size() == 4;
+    }));
+    CHECK(order == std::vector<int>({1, 2, 3, 0}));
+    for (int i = 0; i < 4; ++i)
+        CHECK(firedAt[i] + 1.0 >= delays[i]);
+    scheduler.Shutdown();
+}
+
+TEST_CASE(DelayBeyondOneWheelRevolutionDoesNotWrap)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(1));
+    // 1周 (WHEEL_SLOTS * TIMER_TICK_MS) + 30ms の遅延は、30ms の遅延と同じスロットに入ります
+    const std::uint32_t nRevolutionMs = CTaskScheduler::WHEEL_SLOTS * CTaskScheduler::TIMER_TICK_MS;
+    std::atomic<bool> bLongFired(false);
+    std::atomic<bool> bShortFired(false);
+    scheduler.ScheduleAfter(nRevolutionMs + 30, [&]() { bLongFired = true; });
+    scheduler.ScheduleAfter(30, [&]() { bShortFired = true; });
+    CHECK(WaitUntil([&]() { return bShortFired.load(); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5 * CTaskScheduler::TIMER_TICK_MS));
+    CHECK(!bLongFired.load());
+
+    // 未到来のタイマーがあっても Shutdown() はすぐに戻ります
+    const auto start = std::chrono::steady_clock::now();
+    scheduler.Shutdown();
+    CHECK(ElapsedMs(start) < 1000.0);
+    CHECK(!bLongFired.load());
+}
+
+TEST_CASE(CancellationTokenSkipsPendingWork)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(2));
+
+    // 取り消し済みのトークンで登録したタスクは実行されません
+    CCancellationSource cancelled;
+    cancelled.Cancel();
+    std::atomic<int> nRan(0);
+    CHECK(scheduler.Submit([&]() { ++nRan; }, cancelled.GetToken()));
+    CHECK(WaitUntil([&]() { return scheduler.GetCancelledCount() == 1; }));
+    CHECK_EQ(nRan.load(), 0);
+
+    // 期限の前に取り消したタイマーは実行されません
+    CCancellationSource timer;
+    scheduler.ScheduleAfter(40, [&]() { ++nRan; }, timer.GetToken());
+    timer.Cancel();
+    std::atomic<bool> bMarker(false);
+    scheduler.ScheduleAfter(80, [&]() { bMarker = true; });
+    CHECK(WaitUntil([&]() { return bMarker.load(); }));
+    CHECK_EQ(nRan.load(), 0);
+
+    // 周期タスクは、タスク自身が5回目に取り消すとそれ以降は実行されません
+    CCancellationSource periodic;
+    std::atomic<int> nTicks(0);
+    scheduler.SchedulePeriodic(10, 10, [&]() {
+        if (++nTicks == 5)
+            periodic.Cancel();
+    }, periodic.GetToken());
+    CHECK(WaitUntil([&]() { return nTicks.load() >= 5; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    CHECK_EQ(nTicks.load(), 5);
+
+    // 既定構築のトークンは取り消されません
+    CCancellationToken none;
+    CHECK(!none.CanBeCancelled());
+    CHECK(!none.IsCancelled());
+    CHECK(periodic.GetToken().CanBeCancelled());
+    scheduler.Shutdown();
+}
+
+TEST_CASE(PostToUiWithoutExecutorReturnsFalse)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(1));
+    bool bRan = false;
+    CHECK(!scheduler.PostToUi([&]() { bRan = true; }));
+
+    // 実行関数を設定すると受け付け、解除すると再び false になります
+    std::mutex mutex;
+    std::vector<CTaskScheduler::Task> uiQueue;
+    scheduler.SetUiExecutor([&](CTaskScheduler::Task task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uiQueue.push_back(std::move(task));
+        return true;
+    });
+    CHECK(scheduler.PostToUi([&]() { bRan = true; }));
+    REQUIRE(uiQueue.size() == 1);
+    uiQueue[0]();
+    CHECK(bRan);
+
+    scheduler.SetUiExecutor(CTaskScheduler::UiExecutor());
+    CHECK(!scheduler.PostToUi([]() {}));
+
+    // 受け付けを拒否する実行関数では false が返ります
+    scheduler.SetUiExecutor([](CTaskScheduler::Task) { return false; });
+    CHECK(!scheduler.PostToUi([]() {}));
+    scheduler.Shutdown();
+}
+
+TEST_CASE(SubmitThenPostDeliversResultUnlessCancelled)
+{
+    CTaskScheduler scheduler;
+    REQUIRE(scheduler.Start(2));
+    std::mutex mutex;
+    std::vector<CTaskScheduler::Task> uiQueue;
+    scheduler.SetUiExecutor([&](CTaskScheduler::Task task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uiQueue.push_back(std::move(task));
+        return true;
+    });
+
+    int nResult = 0;
+    scheduler.SubmitThenPost([]() { return 42; }, [&](int r) { nResult = r; });
+    CHECK(WaitUntil([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return uiQueue.size() == 1;
+    }));
+
+    // UIスレッドで実行する前に取り消すと、後続処理は呼ばれません
+    CCancellationSource source;
+    int nCancelledResult = 0;
+    scheduler.SubmitThenPost([]() { return 7; }, [&](int r) { nCancelledResult = r; }, source.GetToken());
+    CHECK(WaitUntil([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return uiQueue.size() == 2;
+    }));
+    source.Cancel();
+    for (CTaskScheduler::Task &task : uiQueue)
+        task();
+    CHECK_EQ(nResult, 42);
+    CHECK_EQ(nCancelledResult, 0);
+    scheduler.Shutdown();
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,219 @@
+﻿/**
+ * @file TestFramework.h
+ * @brief ヘッドレスの単体テストとベンチマークのための最小限のテスト枠組み
+ * @details TEST_CASE でテストを登録し、CHECK 系のマクロで検証します。
+ * 各テストの実行ファイルは main() から TestFramework::RunAll() を呼び出します。
+ * ベンチマーク用に、時間計測・パーセンタイルの計算・コマンドライン引数の解析も提供します。
+ * MFCに依存しないため、Windows以外の環境でも単体でコンパイルできます。
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace TestFramework
+{
+    /**
+     * @struct TEST_ENTRY
+     * @brief 登録されたテスト
+     */
+    struct TEST_ENTRY
+    {
+        const char *pszName;          ///< テスト名
+        std::function<void()> body;   ///< テスト本体
+    };
+
+    /// @brief 登録されたテストの一覧を返します。
+    inline std::vector<TEST_ENTRY> &Registry()
+    {
+        static std::vector<TEST_ENTRY> entries;
+        return entries;
+    }
+
+    /// @brief 実行中のテストで失敗した検証の数を返します。
+    inline int &FailureCount()
+    {
+        static int nFailures = 0;
+        return nFailures;
+    }
+
+    /**
+     * @class CRegistrar
+     * @brief 静的初期化でテストを登録するための補助クラス
+     */
+    class CRegistrar
+    {
+    public:
+        CRegistrar(const char *pszName, std::function<void()> body)
+        {
+            Registry().push_back({pszName, std::move(body)});
+        }
+    };
+
+    /**
+     * @brief 検証の失敗を報告します。
+     */
+    inline void ReportFailure(const char *pszFile, int nLine, const char *pszExpr, const std::string &detail)
+    {
+        ++FailureCount();
+        if (detail.empty())
+            std::printf("  %s:%d: CHECK(%s) failed\n", pszFile, nLine, pszExpr);
+        else
+            std::printf("  %s:%d: CHECK(%s) failed (%s)\n", pszFile, nLine, pszExpr, detail.c_str());
+    }
+
+    /// @brief 比較の失敗時に値を表示するための文字列化
+    template <typename T>
+    std::string ToString(const T &value)
+    {
+        if constexpr (std::is_enum<T>::value)
+            return std::to_string(static_cast<long long>(value));
+        else if constexpr (std::is_pointer<T>::value)
+        {
+            char szBuf[32];
+            std::snprintf(szBuf, sizeof(szBuf), "%p", static_cast<const void *>(value));
+            return szBuf;
+        }
+        else if constexpr (std::is_arithmetic<T>::value)
+            return std::to_string(value);
+        else
+            return std::string("?");
+    }
+
+    /**
+     * @brief 登録された全てのテストを実行します。
+     * @param[in] argc コマンドライン引数の数 (第1引数にテスト名を指定すると、名前に含むテストだけを実行します)
+     * @param[in] argv コマンドライン引数
+     * @return 全て成功なら0、失敗があれば1
+     */
+    inline int RunAll(int argc = 0, char **argv = nullptr)
+    {
+        const char *pszFilter = (argc > 1) ? argv[1] : nullptr;
+        int nFailedTests = 0;
+        int nRun = 0;
+        for (const TEST_ENTRY &entry : Registry())
+        {
+            if (pszFilter != nullptr && std::strstr(entry.pszName, pszFilter) == nullptr)
+                continue;
+            const int nBefore = FailureCount();
+            entry.body();
+            ++nRun;
+            const bool bPassed = (FailureCount() == nBefore);
+            std::printf("[%s] %s\n", bPassed ? " OK " : "FAIL", entry.pszName);
+            if (!bPassed)
+                ++nFailedTests;
+        }
+        std::printf("%d/%d tests passed\n", nRun - nFailedTests, nRun);
+        return nFailedTests == 0 ? 0 : 1;
+    }
+
+    // --- ベンチマーク用の補助 ---
+
+    /// @brief 単調増加の時刻をナノ秒で返します。
+    inline std::int64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief 処理を nIterations 回実行し、1回あたりの所要時間 (ナノ秒) を返します。
+     * @details nRepeats 回測定した中の最小値を採用し、他のプロセスによる揺らぎを抑えます。
+     */
+    template <typename Fn>
+    double MeasureNsPerOp(int nIterations, int nRepeats, Fn &&fn)
+    {
+        double dBest = 0.0;
+        for (int rep = 0; rep < nRepeats; ++rep)
+        {
+            const std::int64_t nStart = NowNs();
+            for (int i = 0; i < nIterations; ++i)
+                fn();
+            const double dNs = static_cast<double>(NowNs() - nStart) / nIterations;
+            if (rep == 0 || dNs < dBest)
+                dBest = dNs;
+        }
+        return dBest;
+    }
+
+    /**
+     * @brief 標本のパーセンタイル (最近傍順位法) を返します。
+     * @param[in,out] samples 標本 (並べ替えられます)
+     * @param[in] dPercent パーセント (0〜100)
+     */
+    inline double Percentile(std::vector<double> &samples, double dPercent)
+    {
+        if (samples.empty())
+            return 0.0;
+        std::sort(samples.begin(), samples.end());
+        const double dRank = std::ceil(dPercent / 100.0 * static_cast<double>(samples.size()));
+        const std::size_t nIndex = static_cast<std::size_t>((std::max)(1.0, dRank)) - 1;
+        return samples[(std::min)(nIndex, samples.size() - 1)];
+    }
+
+    /// @brief コマンドライン引数に指定のフラグが含まれているかを返します。
+    inline bool HasFlag(int argc, char **argv, const char *pszFlag)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], pszFlag) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief コマンドライン引数でフラグの次に指定された値を返します (なければ nullptr)。
+    inline const char *FlagValue(int argc, char **argv, const char *pszFlag)
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+        {
+            if (std::strcmp(argv[i], pszFlag) == 0)
+                return argv[i + 1];
+        }
+        return nullptr;
+    }
+}
+
+/// @brief テストを定義して登録します。
+#define TEST_CASE(name)                                                                  \
+    static void name();                                                                  \
+    static const TestFramework::CRegistrar name##_registrar(#name, &name);               \
+    static void name()
+
+/// @brief 条件が真であることを検証します (失敗しても続行します)。
+#define CHECK(expr)                                                                      \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(expr))                                                                     \
+            TestFramework::ReportFailure(__FILE__, __LINE__, #expr, std::string());      \
+    } while (0)
+
+/// @brief 2つの値が等しいことを検証します (失敗時は両方の値を表示します)。
+#define CHECK_EQ(a, b)                                                                   \
+    do                                                                                   \
+    {                                                                                    \
+        const auto &check_a_ = (a);                                                      \
+        const auto &check_b_ = (b);                                                      \
+        if (!(check_a_ == check_b_))                                                     \
+            TestFramework::ReportFailure(__FILE__, __LINE__, #a " == " #b,               \
+                                         TestFramework::ToString(check_a_) + " vs " +    \
+                                             TestFramework::ToString(check_b_));         \
+    } while (0)
+
+/// @brief 条件が真であることを検証し、偽ならテストを打ち切ります。
+#define REQUIRE(expr)                                                                    \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(expr))                                                                     \
+        {                                                                                \
+            TestFramework::ReportFailure(__FILE__, __LINE__, #expr, std::string());      \
+            return;                                                                      \
+        }                                                                                \
+    } while (0)
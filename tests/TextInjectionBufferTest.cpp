@@ -0,0 +1,172 @@
+﻿/**
+ * @file TextInjectionBufferTest.cpp
+ * @brief CTextInjectionBuffer のテスト
+ * @details 1キーごとにエディットコントロールへ反映した場合 (参照モデル) と、バッファに蓄積して任意の時点で
+ * まとめて反映した場合の結果 (文字列と選択範囲) が一致することを乱数の入力列で確認します。
+ * また、Resolve() が求める置き換え範囲と、入力が打ち消し合った場合に反映しないことを個別に確認します。
+ */
+#include "TextInjectionBuffer.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+
+namespace
+{
+/**
+ * @struct REFERENCE_EDIT
+ * @brief 1キーごとに反映するエディットコントロールの参照モデル
+ */
+struct REFERENCE_EDIT
+{
+    std::wstring text; ///< 文字列
+    int nSelStart;     ///< 選択範囲の開始位置
+    int nSelEnd;       ///< 選択範囲の終了位置
+
+    /// @brief 選択範囲を文字で置き換えます。
+    void Insert(wchar_t ch)
+    {
+        text.replace(nSelStart, nSelEnd - nSelStart, 1, ch);
+        nSelEnd = ++nSelStart;
+    }
+    /// @brief 選択範囲、またはキャレットの前の1文字を削除します。
+    void Backspace()
+    {
+        if (nSelStart != nSelEnd)
+            text.erase(nSelStart, nSelEnd - nSelStart);
+        else if (nSelStart > 0)
+            text.erase(--nSelStart, 1);
+        nSelEnd = nSelStart;
+    }
+    /// @brief 選択範囲、またはキャレットの後ろの1文字を削除します。
+    void Delete()
+    {
+        if (nSelStart != nSelEnd)
+            text.erase(nSelStart, nSelEnd - nSelStart);
+        else if (nSelStart < static_cast<int>(text.size()))
+            text.erase(nSelStart, 1);
+        nSelEnd = nSelStart;
+    }
+};
+}
+
+TEST_CASE(BatchedFlushesMatchPerKeyEdits)
+{
+    std::mt19937 rng(1);
+    int nMismatches = 0;
+    int nKeys = 0;
+    int nFlushes = 0;
+    for (int nTrial = 0; nTrial < 50000; ++nTrial)
+    {
+        const int nLength = static_cast<int>(rng() % 10);
+        std::wstring text;
+        for (int i = 0; i < nLength; ++i)
+            text += static_cast<wchar_t>(L'a' + rng() % 26);
+        int nSelStart = static_cast<int>(rng() % (nLength + 1));
+        int nSelEnd = static_cast<int>(rng() % (nLength + 1));
+        if (nSelStart > nSelEnd)
+            std::swap(nSelStart, nSelEnd);
+
+        REFERENCE_EDIT reference = {text, nSelStart, nSelEnd};
+        CTextInjectionBuffer buffer;
+        const int nOps = static_cast<int>(rng() % 16);
+        for (int i = 0; i < nOps; ++i)
+        {
+            const unsigned nOp = rng() % 8;
+            if (nOp < 4)
+            {
+                const wchar_t ch = static_cast<wchar_t>(L'A' + rng() % 26);
+                reference.Insert(ch);
+                buffer.InsertChar(ch);
+            }
+            else if (nOp < 6)
+            {
+                reference.Backspace();
+                buffer.Backspace();
+            }
+            else
+            {
+                reference.Delete();
+                buffer.Delete();
+            }
+            ++nKeys;
+            // フレームの区切りに相当する任意の時点で反映し、バッファを消去します
+            if (rng() % 4 == 0)
+            {
+                buffer.ApplyTo(text, nSelStart, nSelEnd);
+                buffer.Clear();
+                ++nFlushes;
+            }
+        }
+        buffer.ApplyTo(text, nSelStart, nSelEnd);
+        if (text != reference.text || nSelStart != reference.nSelStart || nSelEnd != reference.nSelEnd)
+            ++nMismatches;
+    }
+    CHECK_EQ(nMismatches, 0);
+    std::printf("  keys=%d flushes=%d\n", nKeys, nFlushes);
+}
+
+TEST_CASE(ResolveReplacesSelectionAndSurroundingDeletes)
+{
+    CTextInjectionBuffer buffer;
+    int nStart = -1;
+    int nEnd = -1;
+    CHECK(buffer.IsEmpty());
+    CHECK(!buffer.Resolve(2, 2, 5, nStart, nEnd));
+
+    // "hello" のキャレット2に "abc" を挿入: 1回の置き換え (2, 2) → "abc"
+    buffer.InsertChar(L'a');
+    buffer.InsertChar(L'b');
+    buffer.InsertChar(L'c');
+    CHECK_EQ(buffer.GetKeyCount(), 3);
+    REQUIRE(buffer.Resolve(2, 2, 5, nStart, nEnd));
+    CHECK_EQ(nStart, 2);
+    CHECK_EQ(nEnd, 2);
+    CHECK(buffer.GetText() == L"abc");
+
+    // 挿入直後の BackSpace は挿入を取り消します
+    buffer.Backspace();
+    CHECK(buffer.GetText() == L"ab");
+    CHECK_EQ(buffer.GetKeyCount(), 4);
+
+    // BackSpace 2回 + Delete 1回: 範囲はキャレットの前2文字と後ろ1文字
+    buffer.Clear();
+    CHECK(buffer.IsEmpty());
+    buffer.Backspace();
+    buffer.Backspace();
+    buffer.Delete();
+    REQUIRE(buffer.Resolve(3, 3, 5, nStart, nEnd));
+    CHECK_EQ(nStart, 1);
+    CHECK_EQ(nEnd, 4);
+    CHECK(buffer.GetText().empty());
+    // 先頭や末尾を越える削除は文字列の範囲に切り詰めます
+    REQUIRE(buffer.Resolve(1, 1, 1, nStart, nEnd));
+    CHECK_EQ(nStart, 0);
+    CHECK_EQ(nEnd, 1);
+
+    // 選択範囲がある場合、最初の BackSpace は選択範囲だけを消します
+    buffer.Clear();
+    buffer.Backspace();
+    REQUIRE(buffer.Resolve(1, 4, 5, nStart, nEnd));
+    CHECK_EQ(nStart, 1);
+    CHECK_EQ(nEnd, 4);
+
+    // キャレットの位置で挿入して取り消すと、反映する編集はありません
+    buffer.Clear();
+    buffer.InsertChar(L'x');
+    buffer.Backspace();
+    CHECK(!buffer.IsEmpty());
+    CHECK(!buffer.Resolve(2, 2, 5, nStart, nEnd));
+    std::wstring text = L"hello";
+    int nSelStart = 2;
+    int nSelEnd = 2;
+    CHECK(!buffer.ApplyTo(text, nSelStart, nSelEnd));
+    CHECK(text == L"hello");
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
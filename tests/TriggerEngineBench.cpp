@@ -0,0 +1,87 @@
+﻿/**
+ * @file TriggerEngineBench.cpp
+ * @brief CTriggerEngine のベンチマーク
+ * @details 1000個の監視値と、それぞれ2個の監視値に依存する1万個の条件を登録し、
+ * 監視値1個の更新 (SetValue) の所要時間の p50 / p99 / p99.9 と、1回あたりの評価数を計測します。
+ * 比較として、更新のたびに全条件を評価した場合の所要時間も表示します。
+ *
+ *   TriggerEngineBench          全規模で計測
+ *   TriggerEngineBench --quick  ctest 用 (更新回数を減らします)
+ */
+#include "TriggerEngine.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile long g_nSink = 0;
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nValues = 1000;
+    const int nConditions = 10000;
+    const int nUpdates = bQuick ? 20000 : 200000;
+
+    CTriggerEngine engine;
+    std::vector<CTriggerEngine::ValueId> ids;
+    for (int i = 0; i < nValues; ++i)
+        ids.push_back(engine.RegisterValue(("v" + std::to_string(i)).c_str()));
+
+    std::mt19937 rng(1);
+    std::vector<std::pair<CTriggerEngine::ValueId, CTriggerEngine::ValueId>> deps;
+    std::vector<double> thresholds;
+    for (int c = 0; c < nConditions; ++c)
+    {
+        const CTriggerEngine::ValueId a = ids[rng() % nValues];
+        const CTriggerEngine::ValueId b = ids[rng() % nValues];
+        const double dThreshold = static_cast<double>(rng() % 100);
+        deps.emplace_back(a, b);
+        thresholds.push_back(dThreshold);
+        engine.AddCondition({a, b}, [a, b, dThreshold](const CTriggerEngine::Values &x) { return x[a] + x[b] > dThreshold; },
+                            [](bool) { g_nSink = g_nSink + 1; });
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(nUpdates);
+    const std::uint64_t nEvaluationsBefore = engine.GetEvaluationCount();
+    const std::int64_t nStart = TestFramework::NowNs();
+    for (int i = 0; i < nUpdates; ++i)
+    {
+        const CTriggerEngine::ValueId id = ids[rng() % nValues];
+        const double dValue = static_cast<double>(rng() % 60);
+        const std::int64_t t0 = TestFramework::NowNs();
+        engine.SetValue(id, dValue);
+        latencies.push_back(static_cast<double>(TestFramework::NowNs() - t0));
+    }
+    const double dAverage = static_cast<double>(TestFramework::NowNs() - nStart) / nUpdates;
+    const double dEvaluations = static_cast<double>(engine.GetEvaluationCount() - nEvaluationsBefore) / nUpdates;
+
+    // 比較: 更新のたびに1万個の条件を全て評価する場合
+    std::vector<double> values(nValues, 1.0);
+    const double dFullScan = TestFramework::MeasureNsPerOp(bQuick ? 20 : 200, 3, [&]() {
+        long nTrue = 0;
+        for (int c = 0; c < nConditions; ++c)
+        {
+            if (values[deps[c].first] + values[deps[c].second] > thresholds[c])
+                ++nTrue;
+        }
+        g_nSink = g_nSink + nTrue;
+    });
+
+    std::printf("conditions=%d values=%d updates=%d\n", nConditions, nValues, nUpdates);
+    std::printf("SetValue: avg=%.0f ns  p50=%.0f ns  p99=%.0f ns  p99.9=%.0f ns  evaluations/update=%.1f  fires=%llu\n",
+                dAverage, TestFramework::Percentile(latencies, 50.0), TestFramework::Percentile(latencies, 99.0),
+                TestFramework::Percentile(latencies, 99.9), dEvaluations,
+                static_cast<unsigned long long>(engine.GetFireCount()));
+    std::printf("full scan of all conditions (inlined, no std::function): %.0f ns/update\n", dFullScan);
+
+    // 依存する条件だけを評価していること (1万個の条件 × 依存2個 / 1000値 = 平均20個) を確認します
+    return (dEvaluations < 40.0) ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+﻿/**
+ * @file TriggerEngineTest.cpp
+ * @brief CTriggerEngine のテスト
+ * @details 遅延実行関数を手動で実行するキューに差し替え、デバウンスの待機中に評価結果が変わった場合に
+ * 世代番号の照合で古い待機が無効になることを、時刻に依存せず決定的に確認します。
+ */
+#include "TriggerEngine.h"
+#include "TestFramework.h"
+
+#include <functional>
+#include <vector>
+
+namespace
+{
+/**
+ * @class CManualDefer
+ * @brief 遅延実行の要求を溜めておき、テストから任意の順序で実行する遅延実行関数
+ */
+class CManualDefer
+{
+public:
+    /// @brief CTriggerEngine に渡す遅延実行関数を返します。
+    CTriggerEngine::DeferFunc Func()
+    {
+        return [this](std::uint32_t nDelayMs, std::function<void()> func) {
+            m_delays.push_back(nDelayMs);
+            m_pending.push_back(std::move(func));
+            return m_bAccept;
+        };
+    }
+    /// @brief 溜まっている要求の数を返します。
+    std::size_t GetPendingCount() const { return m_pending.size(); }
+    /// @brief 指定番目の要求の遅延時間を返します。
+    std::uint32_t GetDelay(std::size_t nIndex) const { return m_delays[nIndex]; }
+    /// @brief 指定番目の要求を実行します (デバウンス時間の経過に相当)。
+    void Run(std::size_t nIndex) { m_pending[nIndex](); }
+    /// @brief 要求を受け付けるかを設定します。
+    void SetAccept(bool bAccept) { m_bAccept = bAccept; }
+
+private:
+    std::vector<std::function<void()>> m_pending; ///< 実行待ちの関数
+    std::vector<std::uint32_t> m_delays;          ///< 要求された遅延時間
+    bool m_bAccept = true;                        ///< 要求を受け付けるか
+};
+}
+
+TEST_CASE(ModesFireOnTheirEdges)
+{
+    CTriggerEngine engine;
+    const CTriggerEngine::ValueId v = engine.RegisterValue("a");
+    CHECK_EQ(engine.RegisterValue("a"), v);
+    CHECK_EQ(engine.FindValue("missing"), CTriggerEngine::INVALID_ID);
+    int nRise = 0, nFall = 0, nLevel = 0, nBoth = 0;
+    auto pred = [v](const CTriggerEngine::Values &x) { return x[v] > 5; };
+    engine.AddCondition({v}, pred, [&](bool) { ++nRise; });
+    engine.AddCondition({v}, pred, [&](bool) { ++nFall; }, CTriggerEngine::MODE_FALLING_EDGE);
+    engine.AddCondition({v}, pred, [&](bool) { ++nLevel; }, CTriggerEngine::MODE_LEVEL);
+    engine.AddCondition({v}, pred, [&](bool) { ++nBoth; }, CTriggerEngine::MODE_BOTH_EDGES);
+
+    engine.SetValue(v, 6);
+    engine.SetValue(v, 7);
+    CHECK_EQ(engine.SetValue(v, 7), 0u); // 値が変わらなければ評価しません
+    engine.SetValue(v, 1);
+    engine.SetValue(v, 9);
+    CHECK_EQ(nRise, 2);
+    CHECK_EQ(nFall, 1);
+    CHECK_EQ(nLevel, 3);
+    CHECK_EQ(nBoth, 3);
+}
+
+TEST_CASE(OnlyDependentConditionsAreEvaluated)
+{
+    CTriggerEngine engine;
+    const CTriggerEngine::ValueId a = engine.RegisterValue("a");
+    const CTriggerEngine::ValueId b = engine.RegisterValue("b");
+    const CTriggerEngine::ValueId c = engine.RegisterValue("c");
+    for (int i = 0; i < 10; ++i)
+        engine.AddCondition({a}, [a](const CTriggerEngine::Values &x) { return x[a] > 0; }, [](bool) {});
+    engine.AddCondition({a, b}, [a, b](const CTriggerEngine::Values &x) { return x[a] + x[b] > 0; }, [](bool) {});
+    CHECK_EQ(engine.SetValue(b, 1), 1u);
+    CHECK_EQ(engine.SetValue(c, 1), 0u);
+    CHECK_EQ(engine.SetValue(a, 1), 11u);
+    // 一括更新では両方に依存する条件も1回だけ評価します
+    CHECK_EQ(engine.SetValues({{a, 2}, {b, 2}}), 11u);
+    CHECK_EQ(engine.AddCondition({99}, [](const CTriggerEngine::Values &) { return true; }, [](bool) {}),
+             CTriggerEngine::INVALID_ID);
+}
+
+TEST_CASE(DebounceGenerationDropsStaleTimers)
+{
+    CManualDefer defer;
+    CTriggerEngine engine(defer.Func());
+    const CTriggerEngine::ValueId v = engine.RegisterValue("x");
+    std::vector<bool> fired;
+    const CTriggerEngine::ConditionId id = engine.AddCondition(
+        {v}, [v](const CTriggerEngine::Values &x) { return x[v] > 0; }, [&](bool bState) { fired.push_back(bState); },
+        CTriggerEngine::MODE_BOTH_EDGES, 100);
+    CHECK_EQ(defer.GetPendingCount(), 0u);
+
+    // 成立 → (待機中に) 不成立 → 成立 と揺れた場合、最後の変化の待機だけが有効です
+    engine.SetValue(v, 1); // 世代1: 待機を登録
+    engine.SetValue(v, 0); // 世代2: 確定値 (不成立) に戻ったため待機は登録しない
+    engine.SetValue(v, 1); // 世代3: 待機を登録
+    REQUIRE(defer.GetPendingCount() == 2);
+    CHECK_EQ(defer.GetDelay(0), 100u);
+
+    defer.Run(0); // 世代1の待機は古いため何もしません
+    CHECK(fired.empty());
+    CHECK(!engine.GetConditionState(id));
+    defer.Run(1); // 世代3の待機で成立を確定します
+    CHECK(fired == std::vector<bool>({true}));
+    CHECK(engine.GetConditionState(id));
+    defer.Run(1); // 同じ待機が重ねて届いても、確定済みのため起動しません
+    CHECK_EQ(fired.size(), 1u);
+
+    // 不成立への変化もデバウンスされます
+    engine.SetValue(v, -1);
+    REQUIRE(defer.GetPendingCount() == 3);
+    engine.SetValue(v, -5); // 値は変わったが評価結果 (不成立) は同じ → 世代は進まず、待機も増えない
+    CHECK_EQ(defer.GetPendingCount(), 3u);
+    defer.Run(2); // 待機中の世代のままなので、不成立を確定します
+    CHECK(fired == std::vector<bool>({true, false}));
+
+    // 待機中に確定値 (不成立) へ戻ると、その後の待機の到来では起動しません
+    engine.SetValue(v, 3);
+    engine.SetValue(v, -2);
+    REQUIRE(defer.GetPendingCount() == 4);
+    defer.Run(3);
+    CHECK_EQ(fired.size(), 2u);
+}
+
+TEST_CASE(DebounceSettlesBackToStableValueWithoutFiring)
+{
+    CManualDefer defer;
+    CTriggerEngine engine(defer.Func());
+    const CTriggerEngine::ValueId v = engine.RegisterValue("x");
+    int nFires = 0;
+    engine.AddCondition({v}, [v](const CTriggerEngine::Values &x) { return x[v] != 0; }, [&](bool) { ++nFires; },
+                        CTriggerEngine::MODE_RISING_EDGE, 50);
+    engine.SetValue(v, 1);
+    engine.SetValue(v, 0); // チャタリング
+    REQUIRE(defer.GetPendingCount() == 1);
+    defer.Run(0);
+    CHECK_EQ(nFires, 0);
+}
+
+TEST_CASE(RemovedConditionIgnoresPendingDebounce)
+{
+    CManualDefer defer;
+    CTriggerEngine engine(defer.Func());
+    const CTriggerEngine::ValueId v = engine.RegisterValue("x", 1.0);
+    int nFires = 0;
+    // 登録時に成立している条件は、デバウンス後に不成立 → 成立として起動します
+    const CTriggerEngine::ConditionId id = engine.AddCondition(
+        {v}, [v](const CTriggerEngine::Values &x) { return x[v] != 0; }, [&](bool) { ++nFires; },
+        CTriggerEngine::MODE_RISING_EDGE, 50);
+    REQUIRE(defer.GetPendingCount() == 1);
+    engine.RemoveCondition(id);
+    defer.Run(0);
+    CHECK_EQ(nFires, 0);
+    CHECK_EQ(engine.SetValue(v, 0), 0u);
+}
+
+TEST_CASE(RejectedDeferSettlesImmediately)
+{
+    CManualDefer defer;
+    defer.SetAccept(false);
+    CTriggerEngine engine(defer.Func());
+    const CTriggerEngine::ValueId v = engine.RegisterValue("x");
+    int nFires = 0;
+    engine.AddCondition({v}, [v](const CTriggerEngine::Values &x) { return x[v] != 0; }, [&](bool) { ++nFires; },
+                        CTriggerEngine::MODE_RISING_EDGE, 50);
+    engine.SetValue(v, 1);
+    CHECK_EQ(nFires, 1);
+    CHECK_EQ(engine.GetFireCount(), 1u);
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
@@ -0,0 +1,98 @@
+﻿/**
+ * @file UiDispatcherBench.cpp
+ * @brief CUiDispatcher のベンチマーク
+ * @details 投稿から実行までの1項目あたりの時間 (単一スレッド、4スレッド同時投稿、結合キー付き) と、
+ * 投稿数に対する起床関数の呼び出し回数を計測します。
+ *
+ *   UiDispatcherBench          全規模で計測
+ *   UiDispatcherBench --quick  ctest 用 (投稿数を減らします)
+ */
+#include "UiDispatcher.h"
+#include "TestFramework.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::uint64_t g_nSink = 0;
+
+/**
+ * @brief 指定スレッド数から投稿し、別スレッドで Drain() し続けたときの1項目あたりの時間を計測します。
+ */
+void RunProducers(const char *pszName, int nProducers, int nPerProducer, bool bCoalesced)
+{
+    CUiDispatcher dispatcher;
+    std::atomic<bool> bWoken(false);
+    dispatcher.SetWakeFunc([&]() {
+        bWoken.store(true, std::memory_order_release);
+        return true;
+    });
+    std::atomic<int> nFinished(0);
+
+    const std::int64_t nStart = TestFramework::NowNs();
+    std::thread consumer([&]() {
+        for (;;)
+        {
+            const bool bDone = (nFinished.load(std::memory_order_acquire) == nProducers);
+            if (bWoken.exchange(false, std::memory_order_acq_rel) || bDone)
+            {
+                while (dispatcher.Drain())
+                {
+                }
+            }
+            if (bDone)
+                break;
+            std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> producers;
+    for (int p = 0; p < nProducers; ++p)
+    {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < nPerProducer; ++i)
+            {
+                if (bCoalesced)
+                    dispatcher.PostCoalesced(static_cast<std::uint32_t>(p + 1), [i]() { g_nSink = g_nSink + i; });
+                else
+                    dispatcher.Post([i]() { g_nSink = g_nSink + i; });
+            }
+            nFinished.fetch_add(1, std::memory_order_release);
+        });
+    }
+    for (std::thread &th : producers)
+        th.join();
+    consumer.join();
+    const double dNs = static_cast<double>(TestFramework::NowNs() - nStart);
+
+    const double dPosts = static_cast<double>(nProducers) * nPerProducer;
+    std::printf("%-22s producers=%d posts=%.0f  %.1f ns/post  executed=%llu coalesced=%llu wakes=%llu (%.6f/post)\n",
+                pszName, nProducers, dPosts, dNs / dPosts, static_cast<unsigned long long>(dispatcher.GetExecutedCount()),
+                static_cast<unsigned long long>(dispatcher.GetCoalescedCount()),
+                static_cast<unsigned long long>(dispatcher.GetWakeCount()),
+                static_cast<double>(dispatcher.GetWakeCount()) / dPosts);
+}
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nPosts = bQuick ? 20000 : 1000000;
+
+    // 同じスレッドで投稿と実行を繰り返す場合 (UIスレッド自身からの投稿)
+    {
+        CUiDispatcher dispatcher;
+        const double dNs = TestFramework::MeasureNsPerOp(nPosts, 3, [&]() {
+            dispatcher.Post([]() { g_nSink = g_nSink + 1; });
+            dispatcher.Drain();
+        });
+        std::printf("%-22s %.1f ns/item\n", "post+drain (same thr)", dNs);
+    }
+    RunProducers("post (cross-thread)", 1, nPosts, false);
+    RunProducers("post (cross-thread)", 4, nPosts / 4, false);
+    RunProducers("post coalesced", 4, nPosts / 4, true);
+    return 0;
+}
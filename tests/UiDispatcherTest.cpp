@@ -0,0 +1,264 @@
+﻿/**
+ * @file UiDispatcherTest.cpp
+ * @brief CUiDispatcher のテスト
+ * @details 複数の投稿スレッドから同時に投稿した場合に、起床関数が空 → 非空の変化のときだけ呼ばれること、
+ * 投稿スレッドごとの順序が保たれること、結合キーで置き換えられた項目が実行されないこと、
+ * Drain() が時間予算を守ることを確認します。
+ */
+#include "UiDispatcher.h"
+#include "TestFramework.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/// @brief 指定時間だけCPUを使って待ちます (sleep と違い、実行時間として計上されます)。
+void Spin(std::chrono::microseconds duration)
+{
+    const auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+}
+
+/// @brief テスト用の型付きイベント
+struct PROGRESS_EVENT
+{
+    int nTask;     ///< タスク番号
+    int nPercent;  ///< 進捗
+};
+}
+
+TEST_CASE(WakeOnlyOnEmptyToNonEmptyWithManyProducers)
+{
+    CUiDispatcher dispatcher;
+    std::atomic<int> nWakes(0);
+    dispatcher.SetWakeFunc([&]() {
+        ++nWakes;
+        return true;
+    });
+
+    // Drain() しない間は、4スレッドから何件投稿しても起床は1回だけです
+    const int nProducers = 4;
+    const int nPerProducer = 10000;
+    std::vector<std::vector<int>> received(nProducers);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < nProducers; ++p)
+    {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < nPerProducer; ++i)
+                dispatcher.Post([&received, p, i]() { received[p].push_back(i); });
+        });
+    }
+    for (std::thread &th : producers)
+        th.join();
+    CHECK_EQ(nWakes.load(), 1);
+    CHECK_EQ(dispatcher.GetWakeCount(), 1u);
+    CHECK_EQ(dispatcher.GetPostedCount(), static_cast<std::uint64_t>(nProducers * nPerProducer));
+
+    // 全て実行され、投稿スレッドごとの順序は保たれます
+    while (dispatcher.Drain(1000000))
+    {
+    }
+    for (int p = 0; p < nProducers; ++p)
+    {
+        REQUIRE(static_cast<int>(received[p].size()) == nPerProducer);
+        int nOutOfOrder = 0;
+        for (int i = 0; i < nPerProducer; ++i)
+        {
+            if (received[p][i] != i)
+                ++nOutOfOrder;
+        }
+        CHECK_EQ(nOutOfOrder, 0);
+    }
+
+    // キューが空になった後の最初の投稿で、再び1回だけ起床します
+    dispatcher.Post([]() {});
+    dispatcher.Post([]() {});
+    CHECK_EQ(nWakes.load(), 2);
+    dispatcher.Drain();
+}
+
+TEST_CASE(ConcurrentProducersAndConsumerLoseNoWakeups)
+{
+    // 起床関数でメッセージループ (別スレッド) を起こし、起こされたときだけ Drain() します
+    CUiDispatcher dispatcher;
+    std::mutex mutex;
+    std::condition_variable cv;
+    int nPendingWakes = 0;
+    dispatcher.SetWakeFunc([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++nPendingWakes;
+        cv.notify_one();
+        return true;
+    });
+
+    const int nProducers = 4;
+    const int nPerProducer = 20000;
+    std::atomic<int> nExecuted(0);
+    std::atomic<bool> bStop(false);
+    std::thread consumer([&]() {
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return nPendingWakes > 0 || bStop.load(); });
+                if (nPendingWakes == 0 && bStop.load())
+                    return;
+                --nPendingWakes;
+            }
+            // 予算切れで残った場合は、メッセージループが自分に起床要求を出し直すのと同じ扱い
+            while (dispatcher.Drain(200))
+            {
+            }
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < nProducers; ++p)
+    {
+        producers.emplace_back([&]() {
+            for (int i = 0; i < nPerProducer; ++i)
+                dispatcher.Post([&nExecuted]() { ++nExecuted; });
+        });
+    }
+    for (std::thread &th : producers)
+        th.join();
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (nExecuted.load() < nProducers * nPerProducer && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    bStop = true;
+    cv.notify_one();
+    consumer.join();
+
+    CHECK_EQ(nExecuted.load(), nProducers * nPerProducer);
+    // 起床は投稿数よりはるかに少なく、空 → 非空の変化の回数を越えません
+    CHECK(dispatcher.GetWakeCount() >= 1);
+    CHECK(dispatcher.GetWakeCount() < static_cast<std::uint64_t>(nProducers * nPerProducer));
+    std::printf("  posts=%d wakes=%llu\n", nProducers * nPerProducer, static_cast<unsigned long long>(dispatcher.GetWakeCount()));
+}
+
+TEST_CASE(SupersededItemsAreDropped)
+{
+    CUiDispatcher dispatcher;
+    const int nProducers = 4;
+    const int nPerProducer = 5000;
+    std::vector<int> lastSeen(nProducers, -1);
+    std::vector<int> runs(nProducers, 0);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < nProducers; ++p)
+    {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < nPerProducer; ++i)
+            {
+                dispatcher.PostCoalesced(static_cast<std::uint32_t>(p + 1), [&lastSeen, &runs, p, i]() {
+                    lastSeen[p] = i;
+                    ++runs[p];
+                });
+            }
+        });
+    }
+    for (std::thread &th : producers)
+        th.join();
+    while (dispatcher.Drain(1000000))
+    {
+    }
+    for (int p = 0; p < nProducers; ++p)
+    {
+        CHECK_EQ(runs[p], 1);
+        CHECK_EQ(lastSeen[p], nPerProducer - 1);
+    }
+    CHECK_EQ(dispatcher.GetExecutedCount(), static_cast<std::uint64_t>(nProducers));
+    CHECK_EQ(dispatcher.GetCoalescedCount(), static_cast<std::uint64_t>(nProducers * (nPerProducer - 1)));
+}
+
+TEST_CASE(CoalescedEventsKeepLatestPerSubKey)
+{
+    CUiDispatcher dispatcher;
+    std::vector<PROGRESS_EVENT> handled;
+    dispatcher.SetHandler<PROGRESS_EVENT>([&](PROGRESS_EVENT &e) { handled.push_back(e); });
+    for (int i = 0; i <= 100; i += 10)
+    {
+        dispatcher.PostEventCoalesced(PROGRESS_EVENT{1, i}, 1);
+        dispatcher.PostEventCoalesced(PROGRESS_EVENT{2, i / 2}, 2);
+    }
+    dispatcher.PostEvent(PROGRESS_EVENT{3, 5}); // 結合キーなしは全て処理されます
+    dispatcher.PostEvent(PROGRESS_EVENT{3, 6});
+    // クロージャの同じチャネル番号とは重なりません
+    bool bChannelRan = false;
+    dispatcher.PostCoalesced(1, [&]() { bChannelRan = true; });
+    dispatcher.Drain();
+
+    REQUIRE(handled.size() == 4);
+    CHECK_EQ(handled[0].nTask, 1);
+    CHECK_EQ(handled[0].nPercent, 100);
+    CHECK_EQ(handled[1].nTask, 2);
+    CHECK_EQ(handled[1].nPercent, 50);
+    CHECK_EQ(handled[2].nPercent, 5);
+    CHECK_EQ(handled[3].nPercent, 6);
+    CHECK(bChannelRan);
+}
+
+TEST_CASE(DrainRespectsTimeBudget)
+{
+    CUiDispatcher dispatcher;
+    int nRan = 0;
+    for (int i = 0; i < 20; ++i)
+    {
+        dispatcher.Post([&nRan]() {
+            Spin(std::chrono::microseconds(1000));
+            ++nRan;
+        });
+    }
+
+    // 予算 2.5ms: 1項目は少なくとも 1ms かかるので、遅くとも3項目目の後で打ち切られます
+    CHECK(dispatcher.Drain(2500));
+    CHECK(nRan >= 1 && nRan <= 3);
+
+    // 予算0でも最低1項目は実行します
+    const int nBefore = nRan;
+    CHECK(dispatcher.Drain(0));
+    CHECK_EQ(nRan, nBefore + 1);
+
+    // 残りは次の Drain() で実行され、投稿されたものは全て実行されます
+    while (dispatcher.Drain(2500))
+    {
+    }
+    CHECK_EQ(nRan, 20);
+}
+
+TEST_CASE(MoveOnlyClosuresAndClear)
+{
+    CUiDispatcher dispatcher;
+    int nValue = 0;
+    std::unique_ptr<int> pValue(new int(42));
+    dispatcher.Post([&nValue, p = std::move(pValue)]() { nValue = *p; });
+    dispatcher.Drain();
+    CHECK_EQ(nValue, 42);
+
+    dispatcher.Post([&nValue]() { nValue = -1; });
+    dispatcher.Clear();
+    CHECK(!dispatcher.Drain());
+    CHECK_EQ(nValue, 42);
+
+    // 起床関数の設定時に未実行の項目があれば、すぐに起床します
+    dispatcher.Post([]() {});
+    int nWakes = 0;
+    dispatcher.SetWakeFunc([&]() {
+        ++nWakes;
+        return true;
+    });
+    CHECK_EQ(nWakes, 1);
+    dispatcher.Clear();
+}
+
+int main(int argc, char **argv)
+{
+    return TestFramework::RunAll(argc, argv);
+}
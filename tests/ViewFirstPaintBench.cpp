@@ -0,0 +1,278 @@
+﻿/**
+ * @file ViewFirstPaintBench.cpp
+ * @brief ビューの作成から初回描画の完了までの時間のベンチマーク (ウィンドウを使わない再現)
+ * @details CViewComposer の2つの生成時期 (COMPOSE_ON_CREATE / COMPOSE_AFTER_FIRST_PAINT) と同じ手順で、
+ * CView2 の作成から初回描画の完了までを CLayerCompositor と CSoftwareRenderTarget に対して行い、所要時間を計測します。
+ *   - 作成 (OnCreate): 作成時刻を記録し、COMPOSE_ON_CREATE であれば子コントロールを生成します
+ *   - 初回描画 (OnPaint → CViewCompositor::PaintView): CView1 に隠れない部分だけを裏画面に合成して転送し、
+ *     OnDrawFinished() で初回描画までの時間を描画計測値 (SITE_VIEW1/2_FIRST_PAINT) に記録します
+ *   - 生成を遅らせた場合: 投稿した WM_APP_COMPOSE_CHILDREN に相当する処理で子コントロールを生成します
+ * 子コントロールの生成は CCenterEdit のウィンドウに依存しない部分 (状態の確保・書式矩形の計算・初回の描画) で再現します。
+ * ウィンドウの生成 (CreateWindowEx)・SetFont・SetWindowPos と、GDIでの描画・転送の時間は含みません。
+ * 作成時に生成する場合は、これらが子コントロールの数だけ初回描画の前に加わります
+ * (表の「windows before first paint」)。実機の時間は描画計測値 SITE_VIEW2_FIRST_PAINT で確認してください。
+ *
+ *   ViewFirstPaintBench          全回数で計測
+ *   ViewFirstPaintBench --quick  ctest 用 (回数を減らします)
+ */
+#include "FontMetricsCache.h"
+#include "LayerCompositor.h"
+#include "PaintMetrics.h"
+#include "RectRegion.h"
+#include "RenderTarget.h"
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// @brief 最適化で処理が消えないように結果を書き込む先
+volatile std::uint64_t g_nSink = 0;
+
+/// @brief ビューの背景色 (GetSysColor(COLOR_WINDOW) の既定値)
+const RenderColor COLOR_WINDOW_BK = RenderRgb(255, 255, 255);
+/// @brief CView1 の背景色 (View1.cpp と同じ値)
+const RenderColor COLOR_VIEW1_BK = RenderRgb(0xDD, 0x88, 0x11);
+/// @brief 子コントロールの文字色
+const RenderColor COLOR_TEXT = RenderRgb(0, 0, 0);
+
+/// @brief 子コントロールを生成する時期 (CViewComposer::EComposeTiming と同じ)
+enum EComposeTiming
+{
+    COMPOSE_ON_CREATE,
+    COMPOSE_AFTER_FIRST_PAINT
+};
+
+/**
+ * @struct CHILD_DESC
+ * @brief 子コントロールの宣言 (CHILD_CONTROL_DESC のうちウィンドウに依存しない項目)
+ */
+struct CHILD_DESC
+{
+    REGION_RECT rect;      ///< ビューのクライアント座標での位置とサイズ
+    const wchar_t *pszText; ///< 初期文字列
+};
+
+/// @brief CView2 に配置する子コントロールの宣言 (CView2.cpp と同じ値)
+const CHILD_DESC VIEW2_CHILDREN[] = {
+    {{60, 60, 110, 110}, L"1234"},
+    {{10, 10, 50, 50}, L"5678"},
+};
+
+/// @brief 偽のフォントの寸法 (ダイアログの既定フォントに相当)
+bool FakeMeasure(std::uintptr_t /*hFont*/, unsigned /*nDpi*/, FONT_METRICS &metrics)
+{
+    metrics = FONT_METRICS{16, 13, 3, 0, 7};
+    return true;
+}
+
+/**
+ * @class CHeadlessEdit
+ * @brief CCenterEdit の生成と初回描画のうち、ウィンドウに依存しない部分の再現
+ */
+class CHeadlessEdit
+{
+public:
+    /// @brief 生成します (PreSubclassWindow → OnSize → UpdateTextPosition に相当)。
+    CHeadlessEdit(const CHILD_DESC &desc) : m_rect(desc.rect), m_text(desc.pszText)
+    {
+        CCenteredTextLayout::FORMAT_RECT format = {};
+        m_textLayout.Update(m_rect.right - m_rect.left, m_rect.bottom - m_rect.top, 1, 96, format);
+        m_format = REGION_RECT{m_rect.left + format.left, m_rect.top + format.top, m_rect.left + format.right,
+                               m_rect.top + format.bottom};
+    }
+
+    /// @brief 初回の描画をします (エディットコントロールの WM_PAINT に相当)。
+    void Paint(CRenderTarget &target, int x, int y) const
+    {
+        const REGION_RECT rect = {m_rect.left + x, m_rect.top + y, m_rect.right + x, m_rect.bottom + y};
+        target.FillRect(rect, COLOR_WINDOW_BK);
+        target.DrawFrame(rect, COLOR_TEXT, 1);
+        const REGION_RECT format = {m_format.left + x, m_format.top + y, m_format.right + x, m_format.bottom + y};
+        target.DrawString(m_text.c_str(), static_cast<int>(m_text.size()), format, COLOR_TEXT, RENDER_TEXT_RIGHT);
+    }
+
+private:
+    REGION_RECT m_rect;                ///< 位置とサイズ
+    REGION_RECT m_format;              ///< 書式矩形 (ビューのクライアント座標)
+    std::wstring m_text;               ///< 文字列
+    CCenteredTextLayout m_textLayout;  ///< 書式矩形の計算
+};
+
+/**
+ * @class CHeadlessView2
+ * @brief CView2 (と CViewComposer) の作成から初回描画までの処理の再現
+ */
+class CHeadlessView2
+{
+public:
+    CHeadlessView2(EComposeTiming eTiming, const REGION_RECT &rect) : m_eTiming(eTiming), m_rect(rect) {}
+
+    /// @brief ウィンドウの作成時の処理です (CViewComposer::OnCreate)。
+    void OnCreate()
+    {
+        m_nCreatedNs = CPaintMetrics::NowNs();
+        if (m_eTiming == COMPOSE_ON_CREATE)
+            Compose();
+    }
+
+    /// @brief 描画の終わりの処理です (CViewComposer::OnDrawFinished)。初回だけ時間を記録し、生成を投稿します。
+    void OnDrawFinished(std::deque<std::function<void()>> &queue)
+    {
+        if (m_bFirstPaintDone)
+            return;
+        m_bFirstPaintDone = true;
+        m_nFirstPaintNs = CPaintMetrics::NowNs() - m_nCreatedNs;
+        m_nChildrenAtFirstPaint = static_cast<int>(m_children.size());
+        CPaintMetrics::Record(CPaintMetrics::SITE_VIEW2_FIRST_PAINT, m_nFirstPaintNs,
+                              static_cast<std::uint32_t>(m_children.size()), 0);
+        if (m_children.empty())
+            queue.push_back([this]() { Compose(); });
+    }
+
+    /// @brief 子コントロールを全て生成します (CViewComposer::Compose)。
+    void Compose()
+    {
+        if (!m_children.empty())
+            return;
+        CPaintMetricsScope metrics(CPaintMetrics::SITE_VIEW_COMPOSE);
+        for (const CHILD_DESC &desc : VIEW2_CHILDREN)
+            m_children.emplace_back(new CHeadlessEdit(desc));
+        metrics.AddItems(static_cast<std::uint32_t>(m_children.size()));
+        metrics.AddAllocations(static_cast<std::uint32_t>(m_children.size()));
+    }
+
+    /// @brief 子コントロールの初回の描画をします (子ウィンドウの WM_PAINT は親の描画の後に届きます)。
+    void PaintChildren(CRenderTarget &target) const
+    {
+        for (const std::unique_ptr<CHeadlessEdit> &pChild : m_children)
+            pChild->Paint(target, m_rect.left, m_rect.top);
+    }
+
+    std::uint64_t GetCreatedNs() const { return m_nCreatedNs; }
+    std::uint64_t GetFirstPaintNs() const { return m_nFirstPaintNs; }
+    int GetChildrenAtFirstPaint() const { return m_nChildrenAtFirstPaint; }
+    bool IsComposed() const { return !m_children.empty(); }
+
+private:
+    EComposeTiming m_eTiming;                              ///< 生成する時期
+    REGION_RECT m_rect;                                    ///< ホストのクライアント座標での位置
+    std::vector<std::unique_ptr<CHeadlessEdit>> m_children; ///< 生成した子コントロール
+    std::uint64_t m_nCreatedNs = 0;                        ///< 作成時刻
+    std::uint64_t m_nFirstPaintNs = 0;                     ///< 作成から初回描画の完了までの時間
+    int m_nChildrenAtFirstPaint = 0;                       ///< 初回描画の時点で生成済みの子コントロール数
+    bool m_bFirstPaintDone = false;                        ///< 初回描画を終えたか
+};
+
+/**
+ * @struct RESULT
+ * @brief 1つの生成時期の計測結果
+ */
+struct RESULT
+{
+    std::vector<double> firstPaint; ///< 作成から初回描画の完了まで (ns)
+    std::vector<double> ready;      ///< 作成から子コントロールの初回描画の完了まで (ns)
+    int nChildrenAtFirstPaint;      ///< 初回描画の時点で生成済みの子コントロール数
+    std::uint64_t nChecksum;        ///< 最後の画面のハッシュ値
+};
+
+/**
+ * @brief CView2 の作成から子コントロールの描画までを nIterations 回計測します。
+ * @details CView1 は作成済みで、合成の上の層に登録されています (MFCApplication4Dlg.cpp と同じ配置)。
+ */
+RESULT Measure(EComposeTiming eTiming, int nIterations)
+{
+    const REGION_RECT rectView1 = {450, 50, 600, 200};
+    const REGION_RECT rectView2 = {525, 50, 675, 200};
+    CSoftwareRenderTarget back(700, 260);
+    CSoftwareRenderTarget screen(700, 260);
+    std::vector<REGION_RECT> rects;
+
+    RESULT result = {};
+    for (int i = 0; i < nIterations; ++i)
+    {
+        CLayerCompositor compositor;
+        const CLayerCompositor::LayerId nView1 = compositor.AddLayer(rectView1, 1);
+        compositor.ClearDirty();
+        std::deque<std::function<void()>> queue;
+
+        // ShowView2(): 作成 (WM_CREATE) → 合成に下の層として登録 → 表示
+        CHeadlessView2 view(eTiming, rectView2);
+        view.OnCreate();
+        const CLayerCompositor::LayerId nView2 = compositor.AddLayer(rectView2, 0);
+        compositor.ClearDirty();
+
+        // 最初の WM_PAINT: 見える部分だけを合成して転送し、OnDraw の終わりで初回描画の完了を記録します
+        CRectRegion need(rectView2);
+        need.Intersect(compositor.GetVisibleRegion(nView2));
+        compositor.Invalidate(need);
+        compositor.Compose([&](CLayerCompositor::LayerId nLayer, const CRectRegion &clip) {
+            clip.GetRects(rects);
+            const RenderColor color = (nLayer == nView1) ? COLOR_VIEW1_BK : COLOR_WINDOW_BK;
+            for (const REGION_RECT &rect : rects)
+                back.FillRect(rect, color);
+        });
+        need.GetRects(rects);
+        for (const REGION_RECT &rect : rects)
+            screen.Blit(rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top, back, rect.left, rect.top);
+        view.OnDrawFinished(queue);
+
+        // 投稿されたメッセージ (WM_APP_COMPOSE_CHILDREN) を処理し、子コントロールが描画します
+        while (!queue.empty())
+        {
+            queue.front()();
+            queue.pop_front();
+        }
+        view.PaintChildren(screen);
+        const std::uint64_t nReadyNs = CPaintMetrics::NowNs() - view.GetCreatedNs();
+
+        result.firstPaint.push_back(static_cast<double>(view.GetFirstPaintNs()));
+        result.ready.push_back(static_cast<double>(nReadyNs));
+        result.nChildrenAtFirstPaint = view.GetChildrenAtFirstPaint();
+        g_nSink = g_nSink + (view.IsComposed() ? 1 : 0);
+    }
+    result.nChecksum = screen.GetChecksum();
+    return result;
+}
+
+/// @brief 計測結果を1行で表示します。
+void Print(const char *pszName, RESULT &result)
+{
+    std::printf("%-20s first paint p50=%6.2f us p99=%6.2f us | children painted p50=%6.2f us p99=%6.2f us | "
+                "windows before first paint=%d\n",
+                pszName, TestFramework::Percentile(result.firstPaint, 50.0) / 1000.0,
+                TestFramework::Percentile(result.firstPaint, 99.0) / 1000.0, TestFramework::Percentile(result.ready, 50.0) / 1000.0,
+                TestFramework::Percentile(result.ready, 99.0) / 1000.0, result.nChildrenAtFirstPaint);
+}
+}
+
+int main(int argc, char **argv)
+{
+    const bool bQuick = TestFramework::HasFlag(argc, argv, "--quick");
+    const int nIterations = bQuick ? 200 : 20000;
+    CFontMetricsCache::SetBackend(&FakeMeasure);
+    CPaintMetrics::SetEnabled(true);
+
+    Measure(COMPOSE_ON_CREATE, 20); // 作業領域とキャッシュを用意しておきます
+    CPaintMetrics::Reset();
+    RESULT onCreate = Measure(COMPOSE_ON_CREATE, nIterations);
+    RESULT deferred = Measure(COMPOSE_AFTER_FIRST_PAINT, nIterations);
+    Print("COMPOSE_ON_CREATE", onCreate);
+    Print("AFTER_FIRST_PAINT", deferred);
+
+    // 実機と同じ計測箇所にも記録されます (2つの生成時期の合計)
+    const CPaintMetrics::SiteStats stats = CPaintMetrics::GetStats(CPaintMetrics::SITE_VIEW2_FIRST_PAINT);
+    std::printf("SITE_VIEW2_FIRST_PAINT: count=%llu items=%llu p50=%.2f us\n", static_cast<unsigned long long>(stats.nCount),
+                static_cast<unsigned long long>(stats.nItems), static_cast<double>(stats.nP50Ns) / 1000.0);
+
+    // 遅らせた場合は初回描画の前にウィンドウを生成せず、どちらの時期でも最終的な画面は同じであること
+    const bool bOk = deferred.nChildrenAtFirstPaint == 0 &&
+                     onCreate.nChildrenAtFirstPaint == static_cast<int>(sizeof(VIEW2_CHILDREN) / sizeof(VIEW2_CHILDREN[0])) &&
+                     onCreate.nChecksum == deferred.nChecksum && stats.nCount == static_cast<std::uint64_t>(2 * nIterations);
+    return bOk ? 0 : 1;
+}